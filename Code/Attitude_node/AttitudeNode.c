@@ -69,14 +69,20 @@ uint8_t taskIds[NUM_TASKS] = {
 	TASK_TRANSMIT_STATUS,
 	TASK_TRANSMIT_IMU
 };
-uint16_t taskTimeSteps[NUM_TASKS][2][8] = {};
+uint8_t  taskTimestepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+uint16_t taskTimestepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+MessageScheduleSlot taskSlots[NUM_TASKS] = {};
 uint8_t  taskWeights[NUM_TASKS] = {1, 1, 1}; // All tasks have an equal weighting, as it doesn't matter.
 MessageSchedule taskSchedule = {
 	NUM_TASKS,
 	taskIds,
 	taskWeights,
 	0,
-	taskTimeSteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	taskTimestepLists,
+	taskTimestepBytes,
+	taskSlots
 };
 
 // Specify the frequency in Hz that these tasks should be executed at. Used with the message scheduler
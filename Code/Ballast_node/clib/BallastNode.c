@@ -49,14 +49,20 @@ static uint8_t ids[ECAN_MSGS_SIZE] = {
     SCHED_ID_TEMPERATURE,
     SCHED_ID_STATUS
 };
-static uint16_t tsteps[ECAN_MSGS_SIZE][2][8] = {};
+static uint8_t  tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+static uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+static MessageScheduleSlot slots[ECAN_MSGS_SIZE] = {};
 static uint8_t  mSizes[ECAN_MSGS_SIZE];
 static MessageSchedule sched = {
 	ECAN_MSGS_SIZE,
 	ids,
 	mSizes,
 	0,
-	tsteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	tstepLists,
+	tstepBytes,
+	slots
 };
 
 void BallastNodeInit(void)
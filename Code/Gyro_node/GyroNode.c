@@ -75,14 +75,20 @@ uint8_t taskIds[NUM_TASKS] = {
 	TASK_TRANSMIT_STATUS,
 	TASK_TRANSMIT_GYRO
 };
-uint16_t taskTimeSteps[NUM_TASKS][2][8] = {};
+uint8_t  taskTimestepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+uint16_t taskTimestepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+MessageScheduleSlot taskSlots[NUM_TASKS] = {};
 uint8_t  taskWeights[NUM_TASKS] = {1, 1, 1}; // All tasks have an equal weighting, as it doesn't matter.
 MessageSchedule taskSchedule = {
 	NUM_TASKS,
 	taskIds,
 	taskWeights,
 	0,
-	taskTimeSteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	taskTimestepLists,
+	taskTimestepBytes,
+	taskSlots
 };
 
 // Specify the frequency in Hz that these tasks should be executed at. Used with the message scheduler
@@ -172,19 +178,26 @@ void RunContinuousTasks(void)
 	// Keep track of state for the gyro data parser.
 	static Dsp3000Output o;
 
-	uint8_t c;
-	while (Uart1ReadByte(&c)) {
-		// If we've successfully decoded a message, make sure we know we're connected.
-		if (Dsp3000Parse((char)c, &o)) {
-			sensorAvailability.gyro.enabled_counter = 0;
-		}
-
-		// If the status bit was good, the gyro is active
-		if (o.status) {
-			sensorAvailability.gyro.active_counter = 0;
-			gyroData.zRate = o.zRate;
+	// Parse the received data in place and then release it all at once.
+	SpscBufferSpans spans;
+	const uint16_t length = Uart1GetReadSpans(&spans);
+	uint8_t i;
+	uint16_t j;
+	for (i = 0; i < 2; ++i) {
+		for (j = 0; j < spans.length[i]; ++j) {
+			// If we've successfully decoded a message, make sure we know we're connected.
+			if (Dsp3000Parse((char)spans.data[i][j], &o)) {
+				sensorAvailability.gyro.enabled_counter = 0;
+			}
+
+			// If the status bit was good, the gyro is active
+			if (o.status) {
+				sensorAvailability.gyro.active_counter = 0;
+				gyroData.zRate = o.zRate;
+			}
 		}
 	}
+	Uart1CommitRead(length);
 }
 
 void Run100HzTasks(void)
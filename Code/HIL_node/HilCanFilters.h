@@ -0,0 +1,42 @@
+/**
+ * @file   HilCanFilters.h
+ * @brief  The CAN messages the HIL node receives, see EcanFilterPlanner.h.
+ *
+ * These are the messages CanReceiveMessages() in HilNode.c handles, and everything else is
+ * rejected by the ECAN hardware, so anything handled there needs to be listed here too. They're
+ * shared with Scripts/C/EcanFilterReport.c.
+ */
+#ifndef HIL_CAN_FILTERS_H
+#define HIL_CAN_FILTERS_H
+
+#include "EcanFilterPlanner.h"
+#include "Acs300.h"
+#include "CanMessages.h"
+#include "Nmea2000.h"
+
+static const EcanFilterTarget hilCanFilterTargets[] = {
+	// From the ACS300
+	{ACS300_CAN_ID_WR_PARAM, false},
+	{ACS300_CAN_ID_HRTBT, false},
+
+	// From the other nodes and the IMU
+	{CAN_MSG_ID_STATUS, false},
+	{CAN_MSG_ID_IMU_DATA, false},
+	{CAN_MSG_ID_ANG_VEL_DATA, false},
+	{CAN_MSG_ID_ACCEL_DATA, false},
+	{CAN_MSG_ID_GPS_POS_DATA, false},
+	{CAN_MSG_ID_GPS_EST_POS_DATA, false},
+	{CAN_MSG_ID_GPS_VEL_DATA, false},
+
+	// Rudder commands and angles, and the NMEA2000 sensors
+	{PGN_ID_RUDDER, true},
+	{PGN_ID_SPEED, true},
+	{PGN_ID_ENV_PARAMETERS, true},
+	{PGN_ID_POSITION_RAP_UPD, true},
+	{PGN_ID_COG_SOG_RAP_UPD, true},
+	{PGN_ID_GNSS_DOPS, true},
+	{PGN_ID_MAG_VARIATION, true}
+};
+#define HIL_CAN_FILTER_TARGET_COUNT (sizeof(hilCanFilterTargets) / sizeof(hilCanFilterTargets[0]))
+
+#endif // HIL_CAN_FILTERS_H
@@ -14,6 +14,7 @@
 #include "Nmea2000Encode.h"
 #include "Node.h"
 #include "CanMessages.h"
+#include "HilCanFilters.h"
 #include "Timer2.h"
 #include "Timer4.h"
 #include "HilNode.h"
@@ -140,14 +141,20 @@ static uint8_t ids[ECAN_MSGS_SIZE] = {
     SCHED_ID_HIL_STATUS,
     SCHED_ID_IMU
 };
-static uint16_t tsteps[ECAN_MSGS_SIZE][2][8] = {};
+static uint8_t  tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+static uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+static MessageScheduleSlot slots[ECAN_MSGS_SIZE] = {};
 static uint8_t mSizes[ECAN_MSGS_SIZE];
 static MessageSchedule sched = {
     ECAN_MSGS_SIZE,
     ids,
     mSizes,
     0,
-    tsteps
+    MSCHED_DEFAULT_TIMESTEPS,
+    MSCHED_DEFAULT_TIMESTEP_RATE,
+    tstepLists,
+    tstepBytes,
+    slots
 };
 
 // Declare some function prototypes
@@ -245,8 +252,14 @@ void HilNodeInit(void)
     OpenTimer2(T2_ON & T2_IDLE_CON & T2_GATE_OFF & T2_PS_1_256 & T2_32BIT_MODE_OFF & T2_SOURCE_INT, UINT16_MAX);
     ConfigIntTimer2(T2_INT_PRIOR_1 & T2_INT_OFF);
 
-    // Initialize ECAN1
-    Ecan1Init(F_OSC, NODE_CAN_BAUD);
+    // Initialize ECAN1, only receiving the messages CanReceiveMessages() handles.
+    {
+        EcanFilterRegisters canFilters;
+        if (!EcanFilterPlan(hilCanFilterTargets, HIL_CAN_FILTER_TARGET_COUNT, &canFilters, NULL)) {
+            HIL_FATAL_ERROR();
+        }
+        Ecan1InitFiltered(F_OSC, NODE_CAN_BAUD, &canFilters);
+    }
 
     // Set a schedule for outgoing CAN messages
     // Transmit the rudder angle at 10Hz
@@ -75,14 +75,20 @@ uint8_t taskIds[NUM_TASKS] = {
 	TASK_TRANSMIT_STATUS,
 	TASK_TRANSMIT_IMU
 };
-uint16_t taskTimeSteps[NUM_TASKS][2][8] = {};
+uint8_t  taskTimestepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+uint16_t taskTimestepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+MessageScheduleSlot taskSlots[NUM_TASKS] = {};
 uint8_t  taskWeights[NUM_TASKS] = {1, 1, 1}; // All tasks have an equal weighting, as it doesn't matter.
 MessageSchedule taskSchedule = {
 	NUM_TASKS,
 	taskIds,
 	taskWeights,
 	0,
-	taskTimeSteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	taskTimestepLists,
+	taskTimestepBytes,
+	taskSlots
 };
 
 // Specify the frequency in Hz that these tasks should be executed at. Used with the message scheduler
@@ -170,16 +176,22 @@ void ImuNodeInit(uint32_t f_osc)
  */
 void RunContinuousTasks(void)
 {
-
-	uint8_t c;
-	while (Uart1ReadByte(&c)) {
-		// If we've successfully decoded a message...
-		if (TokimecParse((char)c, &tokimecData) > 0) {
-			// Log that the IMU is connected.
-			sensorAvailability.imu.enabled_counter = 0;
-			sensorAvailability.imu.active_counter = 0;
+	// Parse the received data in place and then release it all at once.
+	SpscBufferSpans spans;
+	const uint16_t length = Uart1GetReadSpans(&spans);
+	uint8_t i;
+	uint16_t j;
+	for (i = 0; i < 2; ++i) {
+		for (j = 0; j < spans.length[i]; ++j) {
+			// If we've successfully decoded a message...
+			if (TokimecParse((char)spans.data[i][j], &tokimecData) > 0) {
+				// Log that the IMU is connected.
+				sensorAvailability.imu.enabled_counter = 0;
+				sensorAvailability.imu.active_counter = 0;
+			}
 		}
 	}
+	Uart1CommitRead(length);
 }
 
 void Run100HzTasks(void)
@@ -10,14 +10,14 @@ void Acs300SendThrottleCommand(int16_t command)
 	// 0, put the ACS300 into standby.
 	if (command != 0) {
 		Acs300PackageVelocityCommand(&msg, 0, 0, ACS300_COMMAND_RUN);
-		Ecan1Transmit(&msg);
+		Ecan1TransmitPriority(&msg, ECAN_TX_PRIORITY_HIGH);
 	} else {
 		Acs300PackageVelocityCommand(&msg, 0, 0, ACS300_COMMAND_STANDBY);
-		Ecan1Transmit(&msg);
+		Ecan1TransmitPriority(&msg, ECAN_TX_PRIORITY_HIGH);
 	}
 
 	Acs300PackageWriteParam(&msg, ACS300_PARAM_CC, command);
-	Ecan1Transmit(&msg);
+	Ecan1TransmitPriority(&msg, ECAN_TX_PRIORITY_HIGH);
 }
 
 void Acs300PackageVelocityCommand(CanMessage *msg, int16_t torqueFeedForward, int16_t velCommand, uint16_t status)
@@ -0,0 +1,544 @@
+#include "CanBusMonitor.h"
+#include "Nmea2000.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// The bits from the start of frame to the end of the CRC, which are stuffed, without the payload.
+#define FRAME_STUFFED_BITS_STD 34
+#define FRAME_STUFFED_BITS_EXT 54
+// The CRC delimiter, ACK slot and delimiter, end of frame, and interframe space, which aren't.
+#define FRAME_UNSTUFFED_BITS 13
+
+/**
+ * Returns the bucket a key hashes to, see CanDispatch.c.
+ */
+static uint8_t CanBusMonitorHash(uint32_t key)
+{
+	const uint16_t folded = (uint16_t)key ^ (uint16_t)(key >> 11) ^ (uint16_t)(key >> 27);
+	return (uint16_t)(folded * 40503U) >> 10;
+}
+
+/**
+ * Returns the bucket holding a key, or the empty bucket it would go into.
+ */
+static uint8_t CanBusMonitorFind(const CanBusMonitor *m, uint32_t key)
+{
+	uint8_t bucket = CanBusMonitorHash(key);
+	while (m->Map[bucket] && m->Entries[m->Map[bucket] - 1].Key != key) {
+		bucket = (bucket + 1) & (CAN_BUS_MONITOR_BUCKETS - 1);
+	}
+	return bucket;
+}
+
+/**
+ * Returns the entry of a key, taking a new one if it doesn't have one yet, or NULL if there are no
+ * entries left.
+ */
+static CanBusMonitorEntry *CanBusMonitorTake(CanBusMonitor *m, uint32_t key)
+{
+	const uint8_t bucket = CanBusMonitorFind(m, key);
+	CanBusMonitorEntry *e;
+	if (m->Map[bucket]) {
+		return &m->Entries[m->Map[bucket] - 1];
+	}
+	if (m->Used == m->EntryCount || m->Used == CAN_BUS_MONITOR_MAX_ENTRIES) {
+		return NULL;
+	}
+
+	e = &m->Entries[m->Used];
+	memset(e, 0, sizeof(*e));
+	e->Key = key;
+	m->Map[bucket] = ++m->Used;
+	return e;
+}
+
+void CanBusMonitorInit(CanBusMonitor *m, uint32_t bitsPerSecond, uint16_t tickRate)
+{
+	memset(m->Map, 0, sizeof(m->Map));
+	memset(m->Sources, 0, sizeof(m->Sources));
+	m->Used = 0;
+	m->Frames = 0;
+	m->Untracked = 0;
+	m->BitRate = 0;
+	m->Rate = 0;
+	m->Load = 0;
+	m->PeakLoad = 0;
+	m->Drifting = 0;
+	m->BitsPerSecond = bitsPerSecond;
+	m->TickRate = tickRate;
+	m->Ticks = 0;
+	m->SecondFrames = 0;
+	m->SecondBits = 0;
+}
+
+bool CanBusMonitorExpect(CanBusMonitor *m, uint32_t id, bool pgn, uint16_t nominal)
+{
+	CanBusMonitorEntry *e;
+	if (id > (pgn ? 0x3FFFFUL : 0x7FFUL) || !(e = CanBusMonitorTake(m, pgn ? (id | CAN_BUS_MONITOR_PGN) : id))) {
+		return false;
+	}
+
+	// Start out at the nominal rate, so an ID that's never seen drifts away from it.
+	e->Nominal = nominal;
+	e->Average = nominal;
+	e->Expected = true;
+	return true;
+}
+
+uint16_t CanBusMonitorFrameBits(const CanMessage *msg)
+{
+	uint16_t stuffed = (msg->frame_type == CAN_FRAME_EXT) ? FRAME_STUFFED_BITS_EXT : FRAME_STUFFED_BITS_STD;
+	uint8_t uniform = 0;
+
+	// Remote frames have no payload, whatever their length says.
+	if (msg->message_type == CAN_MSG_DATA) {
+		const uint8_t length = (msg->validBytes < 8) ? msg->validBytes : 8;
+		uint8_t i;
+		for (i = 0; i < length; ++i) {
+			if (msg->payload[i] == 0 || msg->payload[i] == 0xFF) {
+				++uniform;
+			}
+		}
+		stuffed += 8 * length;
+	}
+
+	// A run of equal bits gets a stuff bit every 5 bits, while random bits only get one about every
+	// 30 bits.
+	return stuffed + FRAME_UNSTUFFED_BITS + (stuffed - 8 * uniform + 15) / 30 + (3 * uniform + 1) / 2;
+}
+
+void CanBusMonitorFrame(CanBusMonitor *m, const CanMessage *msg)
+{
+	const uint16_t bits = CanBusMonitorFrameBits(msg);
+	CanBusMonitorEntry *e;
+
+	++m->Frames;
+	++m->SecondFrames;
+	m->SecondBits += bits;
+
+	if (msg->frame_type == CAN_FRAME_EXT) {
+		const uint8_t address = (uint8_t)msg->id;
+		uint8_t i;
+		e = CanBusMonitorTake(m, Iso11783Decode(msg->id, NULL, NULL, NULL) | CAN_BUS_MONITOR_PGN);
+
+		// Sources are few enough to just search for. Sources that don't fit aren't tracked.
+		for (i = 0; i < CAN_BUS_MONITOR_SOURCES; ++i) {
+			CanBusMonitorSource *s = &m->Sources[i];
+			if (!s->Used) {
+				s->Used = true;
+				s->Address = address;
+			}
+			if (s->Address == address) {
+				++s->Frames;
+				++s->SecondFrames;
+				s->SecondBits += bits;
+				break;
+			}
+		}
+	} else {
+		e = CanBusMonitorTake(m, msg->id & 0x7FF);
+	}
+
+	if (e) {
+		++e->Frames;
+		++e->SecondFrames;
+		e->SecondBits += bits;
+	} else {
+		++m->Untracked;
+	}
+}
+
+/**
+ * Rolls over the statistics of an ID at the end of a second.
+ */
+static void CanBusMonitorSecond(CanBusMonitorEntry *e)
+{
+	const uint32_t rate = (e->SecondFrames < UINT16_MAX / 16) ? e->SecondFrames * 16UL : UINT16_MAX;
+
+	e->Rate = e->SecondFrames;
+	e->BitRate = e->SecondBits;
+	e->SecondFrames = 0;
+	e->SecondBits = 0;
+
+	// An ID seen for the first time was only seen for part of the second, so its average starts
+	// with the first full second.
+	if (e->Expected || e->Age > 1) {
+		e->Average = (uint16_t)((int32_t)e->Average + ((int32_t)rate - (int32_t)e->Average) / 4);
+	} else if (e->Age == 1) {
+		e->Average = (uint16_t)rate;
+	}
+	if (e->Age < UINT8_MAX) {
+		++e->Age;
+	}
+
+	// IDs slower than half a frame a second aren't learned, as they'd need a longer average.
+	if (!e->Expected && e->Age == CAN_BUS_MONITOR_LEARN_SECONDS && e->Average >= 8) {
+		e->Nominal = e->Average;
+	}
+
+	if (e->Nominal) {
+		uint16_t tolerance = (uint32_t)e->Nominal * CAN_BUS_MONITOR_DRIFT_PERCENT / 100;
+		const uint16_t error = (e->Average > e->Nominal) ? e->Average - e->Nominal : e->Nominal - e->Average;
+		if (tolerance < 8) {
+			tolerance = 8;
+		}
+		e->Drifting = error > tolerance;
+	}
+}
+
+void CanBusMonitorTick(CanBusMonitor *m)
+{
+	uint8_t i;
+
+	if (++m->Ticks < m->TickRate) {
+		return;
+	}
+	m->Ticks = 0;
+
+	m->Rate = m->SecondFrames;
+	m->BitRate = m->SecondBits;
+	m->SecondFrames = 0;
+	m->SecondBits = 0;
+	m->Load = (uint16_t)((m->BitRate * 1000 + m->BitsPerSecond / 2) / m->BitsPerSecond);
+	if (m->Load > m->PeakLoad) {
+		m->PeakLoad = m->Load;
+	}
+
+	m->Drifting = 0;
+	for (i = 0; i < m->Used; ++i) {
+		CanBusMonitorSecond(&m->Entries[i]);
+		m->Drifting += m->Entries[i].Drifting;
+	}
+
+	for (i = 0; i < CAN_BUS_MONITOR_SOURCES; ++i) {
+		CanBusMonitorSource *s = &m->Sources[i];
+		s->Rate = s->SecondFrames;
+		s->BitRate = s->SecondBits;
+		s->SecondFrames = 0;
+		s->SecondBits = 0;
+	}
+}
+
+const CanBusMonitorEntry *CanBusMonitorGetEntry(const CanBusMonitor *m, uint32_t id, bool pgn)
+{
+	const uint8_t i = m->Map[CanBusMonitorFind(m, pgn ? (id | CAN_BUS_MONITOR_PGN) : id)];
+	return i ? &m->Entries[i - 1] : NULL;
+}
+
+void CanBusMonitorGetTotals(const CanBusMonitor *m, CanBusMonitorTotals *totals)
+{
+	totals->Frames = m->Frames;
+	totals->Untracked = m->Untracked;
+	totals->BitRate = m->BitRate;
+	totals->Rate = m->Rate;
+	totals->Load = m->Load;
+	totals->PeakLoad = m->PeakLoad;
+	totals->Ids = m->Used;
+	totals->Drifting = m->Drifting;
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_CAN_BUS_MONITOR
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#define BIT_RATE 250000UL
+#define TICK_RATE 100
+
+/**
+ * Returns the exact length of a frame on the bus by encoding it bit by bit, with its CRC and stuff
+ * bits, plus the interframe space.
+ */
+static uint16_t ExactFrameBits(const CanMessage *msg)
+{
+	uint8_t bits[160];
+	uint16_t n = 0, crc = 0, stuff = 0, i;
+	uint8_t run = 0, last = 2;
+	const uint8_t length = (msg->message_type == CAN_MSG_DATA) ? msg->validBytes : 0;
+	int b;
+
+#define PUT(value, count) for (b = (count) - 1; b >= 0; --b) bits[n++] = ((value) >> b) & 1
+	PUT(0, 1); // Start of frame
+	if (msg->frame_type == CAN_FRAME_EXT) {
+		PUT(msg->id >> 18, 11);
+		PUT(3, 2); // SRR and IDE
+		PUT(msg->id & 0x3FFFF, 18);
+		PUT(msg->message_type == CAN_MSG_RTR, 1);
+		PUT(0, 2); // r1 and r0
+	} else {
+		PUT(msg->id, 11);
+		PUT(msg->message_type == CAN_MSG_RTR, 1);
+		PUT(0, 2); // IDE and r0
+	}
+	PUT(msg->validBytes, 4);
+	for (i = 0; i < length; ++i) {
+		PUT(msg->payload[i], 8);
+	}
+	for (i = 0; i < n; ++i) {
+		const uint8_t next = bits[i] ^ ((crc >> 14) & 1);
+		crc = (crc << 1) & 0x7FFF;
+		if (next) {
+			crc ^= 0x4599;
+		}
+	}
+	PUT(crc, 15);
+#undef PUT
+
+	for (i = 0; i < n; ++i) {
+		if (bits[i] == last) {
+			++run;
+		} else {
+			run = 1;
+			last = bits[i];
+		}
+		if (run == 5) {
+			++stuff;
+			last = !last;
+			run = 1;
+		}
+	}
+	return n + stuff + FRAME_UNSTUFFED_BITS;
+}
+
+/**
+ * A stream of periodic frames on the simulated bus.
+ */
+typedef enum {
+	PAYLOAD_RANDOM,  // Sensor data.
+	PAYLOAD_PADDED,  // Half sensor data, half 0xFF padding like most NMEA2000 messages.
+	PAYLOAD_ZERO     // Flags and counters that are mostly 0.
+} PayloadKind;
+
+typedef struct {
+	uint32_t Id;       // A standard ID, or a PGN.
+	bool Pgn;
+	uint8_t Source;    // The source address of PGNs.
+	uint8_t Length;
+	PayloadKind Kind;
+	uint16_t Rate;     // Frames per second.
+	uint16_t Acc;      // Bresenham accumulator to spread frames evenly over the ticks.
+} Stream;
+
+static Stream streams[] = {
+	{0x402, false, 0, 8, PAYLOAD_RANDOM, 50},  // ACS300 heartbeat
+	{0x090, false, 0, 8, PAYLOAD_ZERO, 14},    // Node status
+	{0x080, false, 0, 7, PAYLOAD_RANDOM, 10},  // Rudder details
+	{0x102, false, 0, 8, PAYLOAD_RANDOM, 25},  // IMU
+	{0x106, false, 0, 8, PAYLOAD_RANDOM, 25},
+	{0x107, false, 0, 8, PAYLOAD_RANDOM, 25},
+	{127245, true, 10, 8, PAYLOAD_PADDED, 20}, // Rudder angle from the rudder node
+	{127245, true, 12, 8, PAYLOAD_PADDED, 10}, // Rudder commands from the RC node
+	{127508, true, 20, 8, PAYLOAD_PADDED, 2},  // Battery status
+	{128259, true, 30, 8, PAYLOAD_PADDED, 2},  // DST800
+	{128267, true, 30, 8, PAYLOAD_PADDED, 2},
+	{130310, true, 30, 8, PAYLOAD_PADDED, 1},
+	{129025, true, 40, 8, PAYLOAD_RANDOM, 5},  // GPS
+	{129026, true, 40, 8, PAYLOAD_PADDED, 5},
+	{130306, true, 50, 8, PAYLOAD_PADDED, 2}   // WSO100
+};
+#define STREAM_COUNT (sizeof(streams) / sizeof(streams[0]))
+
+static CanMessage StreamFrame(const Stream *s)
+{
+	CanMessage m;
+	uint8_t i;
+	memset(&m, 0, sizeof(m));
+	m.message_type = CAN_MSG_DATA;
+	m.validBytes = s->Length;
+	if (s->Pgn) {
+		m.frame_type = CAN_FRAME_EXT;
+		m.id = Iso11783Encode(s->Id, s->Source, 0xFF, 2);
+	} else {
+		m.frame_type = CAN_FRAME_STD;
+		m.id = s->Id;
+	}
+	for (i = 0; i < s->Length; ++i) {
+		switch (s->Kind) {
+		case PAYLOAD_RANDOM: m.payload[i] = rand(); break;
+		case PAYLOAD_PADDED: m.payload[i] = (i < s->Length / 2) ? rand() : 0xFF; break;
+		case PAYLOAD_ZERO: m.payload[i] = (i == 0) ? rand() : 0; break;
+		}
+	}
+	return m;
+}
+
+/**
+ * Runs the streams for a number of seconds, with their rates multiplied by `scale`, counting every
+ * frame with the monitor.
+ * @return The exact number of bits sent during the last second.
+ */
+static uint32_t RunBus(CanBusMonitor *m, uint16_t seconds, uint16_t scale)
+{
+	uint32_t bits = 0;
+	uint32_t tick;
+	uint8_t i;
+	for (tick = 0; tick < (uint32_t)seconds * TICK_RATE; ++tick) {
+		if (tick % TICK_RATE == 0) {
+			bits = 0;
+		}
+		for (i = 0; i < STREAM_COUNT; ++i) {
+			Stream *s = &streams[i];
+			for (s->Acc += s->Rate * scale; s->Acc >= TICK_RATE; s->Acc -= TICK_RATE) {
+				const CanMessage f = StreamFrame(s);
+				CanBusMonitorFrame(m, &f);
+				bits += ExactFrameBits(&f);
+			}
+		}
+		CanBusMonitorTick(m);
+	}
+	return bits;
+}
+
+int main(void)
+{
+	static CanBusMonitorEntry entries[CAN_BUS_MONITOR_MAX_ENTRIES];
+	static CanBusMonitor monitor = {.Entries = entries, .EntryCount = CAN_BUS_MONITOR_MAX_ENTRIES};
+	uint8_t i;
+
+	srand(11);
+
+	// First check the length estimates against the exact lengths of all kinds of frames.
+	{
+		const PayloadKind kinds[] = {PAYLOAD_RANDOM, PAYLOAD_PADDED, PAYLOAD_ZERO};
+		const char *names[] = {"random", "0xFF padded", "mostly 0"};
+		uint8_t k, ext;
+		printf("%-24s %8s %8s %8s\n", "frames", "exact", "estimate", "max err");
+		for (ext = 0; ext < 2; ++ext) {
+			for (k = 0; k < 3; ++k) {
+				uint32_t exact = 0, estimate = 0;
+				int maxError = 0;
+				int n;
+				for (n = 0; n < 10000; ++n) {
+					Stream s = {ext ? rand() & 0x3FFFF : rand() & 0x7FF, ext, rand(), 8, kinds[k]};
+					if (ext && ((s.Id >> 8) & 0xFF) < 240) {
+						s.Id &= ~0xFFUL;
+					}
+					const CanMessage f = StreamFrame(&s);
+					const int e = CanBusMonitorFrameBits(&f), x = ExactFrameBits(&f);
+					exact += x;
+					estimate += e;
+					if (abs(e - x) > maxError) {
+						maxError = abs(e - x);
+					}
+				}
+				printf("%-3s %-20s %8.2f %8.2f %8d\n", ext ? "ext" : "std", names[k], exact / 10000.0, estimate / 10000.0, maxError);
+				assert(fabs(((double)estimate - exact) / exact) < 0.01);
+			}
+		}
+
+		// Remote frames have no payload.
+		CanMessage rtr = {0x123, 0, CAN_MSG_RTR, CAN_FRAME_STD, {0}, 8};
+		assert(CanBusMonitorFrameBits(&rtr) == FRAME_STUFFED_BITS_STD + FRAME_UNSTUFFED_BITS + 1);
+		assert(abs(CanBusMonitorFrameBits(&rtr) - ExactFrameBits(&rtr)) <= 3);
+	}
+
+	// Then run the bus at a range of loads, which have to be measured to within 1% of the exact
+	// load, and the rate of every ID and source to the frame.
+	{
+		const uint16_t scales[] = {1, 3, 6};
+		printf("%-12s %12s %12s\n", "", "exact load", "measured");
+		for (i = 0; i < sizeof(scales) / sizeof(scales[0]); ++i) {
+			uint8_t j;
+			CanBusMonitorInit(&monitor, BIT_RATE, TICK_RATE);
+			const uint32_t bits = RunBus(&monitor, 5, scales[i]);
+			const double exact = 100.0 * bits / BIT_RATE, measured = monitor.Load / 10.0;
+			printf("%u x traffic %11.1f%% %11.1f%%\n", scales[i], exact, measured);
+			assert(fabs(exact - measured) < exact / 100 + 0.1);
+			assert(monitor.PeakLoad == monitor.Load);
+			{
+				CanBusMonitorTotals totals;
+				CanBusMonitorGetTotals(&monitor, &totals);
+				assert(totals.Load == monitor.Load && totals.Frames == monitor.Frames && totals.Ids == monitor.Used);
+			}
+
+			for (j = 0; j < STREAM_COUNT; ++j) {
+				const CanBusMonitorEntry *e = CanBusMonitorGetEntry(&monitor, streams[j].Id, streams[j].Pgn);
+				uint16_t rate = 0;
+				uint8_t k;
+				for (k = 0; k < STREAM_COUNT; ++k) {
+					if (streams[k].Id == streams[j].Id && streams[k].Pgn == streams[j].Pgn) {
+						rate += streams[k].Rate * scales[i];
+					}
+				}
+				assert(e && e->Rate == rate && e->Frames == 5UL * rate && !e->Drifting);
+			}
+			for (j = 0; j < CAN_BUS_MONITOR_SOURCES && monitor.Sources[j].Used; ++j) {
+				const CanBusMonitorSource *s = &monitor.Sources[j];
+				uint16_t rate = 0;
+				uint8_t k;
+				for (k = 0; k < STREAM_COUNT; ++k) {
+					if (streams[k].Pgn && streams[k].Source == s->Address) {
+						rate += streams[k].Rate * scales[i];
+					}
+				}
+				assert(rate && s->Rate == rate);
+			}
+			assert(j == 6 && monitor.Untracked == 0 && monitor.Used == 14);
+		}
+	}
+
+	// Now learn the nominal rates, then halve the rate of the IMU and stop the battery status, and
+	// expect an ID that never shows up. All three have to be flagged within a few seconds, and
+	// nothing else. The 1Hz stream is sent at 0 and 2Hz alternately, which is tolerated.
+	{
+		const CanBusMonitorEntry *imu, *battery, *missing, *env;
+		uint16_t second;
+		CanBusMonitorInit(&monitor, BIT_RATE, TICK_RATE);
+		assert(CanBusMonitorExpect(&monitor, 0x10A, false, 5 * 16));
+		assert(!CanBusMonitorExpect(&monitor, 0x800, false, 16));
+		RunBus(&monitor, CAN_BUS_MONITOR_LEARN_SECONDS + 1, 1);
+		imu = CanBusMonitorGetEntry(&monitor, 0x102, false);
+		battery = CanBusMonitorGetEntry(&monitor, 127508, true);
+		missing = CanBusMonitorGetEntry(&monitor, 0x10A, false);
+		env = CanBusMonitorGetEntry(&monitor, 130310, true);
+		assert(imu->Nominal == 25 * 16 && battery->Nominal == 2 * 16 && env->Nominal == 16);
+		assert(missing->Drifting && monitor.Drifting == 1);
+
+		streams[3].Rate = 12;
+		streams[8].Rate = 0;
+		for (second = 1; second <= 10 && monitor.Drifting < 3; ++second) {
+			streams[11].Rate = (second & 1) * 2;
+			RunBus(&monitor, 1, 1);
+			assert(!env->Drifting);
+		}
+		printf("Halved and stopped IDs flagged after %u seconds.\n", second - 1);
+		assert(imu->Drifting && battery->Drifting && monitor.Drifting == 3 && second <= 6);
+
+		// They're back to normal as soon as they recover.
+		streams[3].Rate = 25;
+		streams[8].Rate = 2;
+		streams[11].Rate = 1;
+		RunBus(&monitor, 10, 1);
+		assert(!imu->Drifting && !battery->Drifting && monitor.Drifting == 1);
+	}
+
+	// Finally fill up the entries and sources. Frames without one are still part of the load.
+	{
+		CanMessage f = {0, 0, CAN_MSG_DATA, CAN_FRAME_EXT, {0}, 0};
+		uint16_t n;
+		CanBusMonitorInit(&monitor, BIT_RATE, TICK_RATE);
+		for (n = 0; n < 40; ++n) {
+			f.id = Iso11783Encode(130816 + n, n, 0xFF, 6);
+			CanBusMonitorFrame(&monitor, &f);
+		}
+		for (n = 0; n < TICK_RATE; ++n) {
+			CanBusMonitorTick(&monitor);
+		}
+		assert(monitor.Used == CAN_BUS_MONITOR_MAX_ENTRIES && monitor.Untracked == 40 - CAN_BUS_MONITOR_MAX_ENTRIES);
+		assert(monitor.Rate == 40 && monitor.BitRate == 40UL * CanBusMonitorFrameBits(&f));
+		assert(monitor.Sources[CAN_BUS_MONITOR_SOURCES - 1].Address == CAN_BUS_MONITOR_SOURCES - 1);
+		assert(!CanBusMonitorExpect(&monitor, 0x100, false, 16));
+		printf("Untracked frames counted in the totals.\n");
+	}
+
+	printf("All tests passed.\n");
+	return EXIT_SUCCESS;
+}
+
+#endif // UNIT_TEST_CAN_BUS_MONITOR
@@ -0,0 +1,177 @@
+/**
+ * @file   CanBusMonitor.h
+ * @brief  Measures CAN bus load and the traffic of every ID, PGN, and source address.
+ *
+ * Every frame a node sees is counted with CanBusMonitorFrame(): against its standard ID or PGN, and
+ * for extended frames against its source address too. Frames are also counted in bits, estimated
+ * from their length including stuff bits, from which the bus load is worked out. The bus load is
+ * only that of the frames the monitor is given, so with acceptance filters in place it doesn't
+ * include the frames they reject.
+ *
+ * CanBusMonitorTick() must be called at the rate given to CanBusMonitorInit(). Once a second it
+ * rolls over the per-second frame and bit rates and the bus load, and checks every ID against its
+ * nominal rate. IDs are flagged as drifting while a running average of their rate is off by more
+ * than CAN_BUS_MONITOR_DRIFT_PERCENT from nominal, or at least half a frame a second for slow ones.
+ * Nominal rates are either given with CanBusMonitorExpect(), or learned from the average rate of an
+ * ID over its first CAN_BUS_MONITOR_LEARN_SECONDS seconds. An expected ID that's never seen is
+ * flagged as well.
+ *
+ * Entries for IDs are provided by the user and taken by IDs as they're first seen, and there's a
+ * fixed number of source address entries. Frames that don't get an entry are still counted in the
+ * bus totals. Frames can be counted from an interrupt, as long as it's disabled while the monitor is
+ * ticked; all the statistics of the last second can be read at any time in between.
+ *
+ * Rates are kept in units of 1/16 frames per second, so that slow IDs have useful averages.
+ *
+ * Unit testing, which feeds the monitor synthetic traffic with known loads and rates, is done on
+ * x86 by compiling with the UNIT_TEST_CAN_BUS_MONITOR macro:
+ * `gcc CanBusMonitor.c Nmea2000.c -DUNIT_TEST_CAN_BUS_MONITOR -I. -O2 -Wall -lm`
+ */
+#ifndef CAN_BUS_MONITOR_H
+#define CAN_BUS_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "EcanDefines.h"
+
+// The size of the ID hash table, which holds up to half this many IDs.
+#define CAN_BUS_MONITOR_BUCKETS 64
+#define CAN_BUS_MONITOR_MAX_ENTRIES (CAN_BUS_MONITOR_BUCKETS / 2)
+
+// The number of source addresses tracked.
+#define CAN_BUS_MONITOR_SOURCES 16
+
+// How far an ID's rate can be off from nominal, in percent, before it's flagged.
+#define CAN_BUS_MONITOR_DRIFT_PERCENT 25
+
+// How long the rates of IDs without a nominal rate are averaged before that becomes their nominal rate.
+#define CAN_BUS_MONITOR_LEARN_SECONDS 16
+
+/**
+ * Set in the key of entries for a PGN. Standard IDs and PGNs never have this bit set.
+ */
+#define CAN_BUS_MONITOR_PGN 0x80000000UL
+
+/**
+ * The traffic of a standard ID or PGN.
+ */
+typedef struct {
+	uint32_t Key;      // The standard ID, or the PGN with CAN_BUS_MONITOR_PGN set.
+	uint32_t Frames;   // Frames since initialization.
+	uint32_t BitRate;  // Bits during the last second.
+	uint16_t Rate;     // Frames during the last second.
+	uint16_t Average;  // The running average of Rate, in 1/16 frames/s.
+	uint16_t Nominal;  // The expected rate in 1/16 frames/s, or 0 if there isn't one (yet).
+	uint8_t Age;       // Seconds since the ID was first seen, up to UINT8_MAX.
+	bool Expected;     // Whether Nominal was given rather than learned.
+	bool Drifting;     // Whether Average is too far from Nominal.
+
+	// Bookkeeping for the current second.
+	uint16_t SecondFrames;
+	uint32_t SecondBits;
+} CanBusMonitorEntry;
+
+/**
+ * The traffic of a source address.
+ */
+typedef struct {
+	uint32_t Frames;   // Frames since initialization.
+	uint32_t BitRate;  // Bits during the last second.
+	uint16_t Rate;     // Frames during the last second.
+	uint8_t Address;
+	bool Used;
+
+	// Bookkeeping for the current second.
+	uint16_t SecondFrames;
+	uint32_t SecondBits;
+} CanBusMonitorSource;
+
+/**
+ * A bus monitor. `Entries` and `EntryCount` are set when declaring it, then it's initialized with
+ * CanBusMonitorInit().
+ */
+typedef struct {
+	// The entry of every ID, by hash, numbered starting at 1 so that 0 marks an empty bucket.
+	uint8_t Map[CAN_BUS_MONITOR_BUCKETS];
+	// Storage for the IDs. Contains `EntryCount` entries.
+	CanBusMonitorEntry *const Entries;
+	const uint8_t EntryCount;
+	// The number of entries taken so far.
+	uint8_t Used;
+	CanBusMonitorSource Sources[CAN_BUS_MONITOR_SOURCES];
+
+	uint32_t Frames;         // Frames since initialization.
+	uint32_t Untracked;      // Frames since initialization that didn't get an ID entry.
+	uint32_t BitRate;        // Bits during the last second.
+	uint16_t Rate;           // Frames during the last second.
+	uint16_t Load;           // Bus load during the last second, in units of 0.1%.
+	uint16_t PeakLoad;       // The highest Load since initialization.
+	uint8_t Drifting;        // The number of IDs currently drifting.
+
+	// Bookkeeping for the current second.
+	uint32_t BitsPerSecond;  // The bit rate of the bus.
+	uint16_t TickRate;       // How often CanBusMonitorTick() is called, in Hz.
+	uint16_t Ticks;          // Ticks so far during the current second.
+	uint16_t SecondFrames;
+	uint32_t SecondBits;
+} CanBusMonitor;
+
+/**
+ * The totals of a monitor, see CanBusMonitorGetTotals().
+ */
+typedef struct {
+	uint32_t Frames;    // Frames since initialization.
+	uint32_t Untracked; // Frames since initialization that didn't get an ID entry.
+	uint32_t BitRate;   // Bits during the last second.
+	uint16_t Rate;      // Frames during the last second.
+	uint16_t Load;      // Bus load during the last second, in units of 0.1%.
+	uint16_t PeakLoad;  // The highest Load since initialization.
+	uint8_t Ids;        // The number of ID entries taken.
+	uint8_t Drifting;   // The number of IDs currently drifting.
+} CanBusMonitorTotals;
+
+/**
+ * Clears all entries and statistics.
+ * @param bitsPerSecond The bit rate of the bus.
+ * @param tickRate The rate CanBusMonitorTick() will be called at, in Hz.
+ */
+void CanBusMonitorInit(CanBusMonitor *m, uint32_t bitsPerSecond, uint16_t tickRate);
+
+/**
+ * Gives a standard ID or PGN a nominal rate, taking an entry for it if it doesn't have one yet.
+ * @param pgn Whether `id` is a PGN, received in extended frames.
+ * @param nominal The expected rate in 1/16 frames/s.
+ * @return False if there are no entries left, a standard ID doesn't fit 11 bits, or a PGN doesn't
+ *         fit 18 bits.
+ */
+bool CanBusMonitorExpect(CanBusMonitor *m, uint32_t id, bool pgn, uint16_t nominal);
+
+/**
+ * Counts a frame that was sent or received.
+ */
+void CanBusMonitorFrame(CanBusMonitor *m, const CanMessage *msg);
+
+/**
+ * Advances time by one tick, updating the per-second statistics once every second.
+ */
+void CanBusMonitorTick(CanBusMonitor *m);
+
+/**
+ * Returns the entry of a standard ID or PGN, or NULL if it doesn't have one.
+ */
+const CanBusMonitorEntry *CanBusMonitorGetEntry(const CanBusMonitor *m, uint32_t id, bool pgn);
+
+/**
+ * Copies the totals of a monitor. Frames counted from an interrupt need it disabled around this.
+ */
+void CanBusMonitorGetTotals(const CanBusMonitor *m, CanBusMonitorTotals *totals);
+
+/**
+ * Estimates how long a frame takes on the bus in bits, including stuff bits and the interframe
+ * space. Stuff bits are estimated from the payload: bytes of all 0s or 1s, common as padding, add
+ * about 1.5 stuff bits each while every 30 other bits add about one.
+ */
+uint16_t CanBusMonitorFrameBits(const CanMessage *msg);
+
+#endif // CAN_BUS_MONITOR_H
@@ -0,0 +1,498 @@
+#include "CanDispatch.h"
+#include "Nmea2000.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Returns the bucket a key hashes to. The key is folded into 16 bits and then hashed
+ * multiplicatively, which is cheap on a 16-bit processor.
+ */
+static uint8_t CanDispatchHash(uint32_t key)
+{
+	const uint16_t folded = (uint16_t)key ^ (uint16_t)(key >> 11) ^ (uint16_t)(key >> 27);
+	return (uint16_t)(folded * 40503U) >> 10;
+}
+
+/**
+ * Returns the bucket holding a key, or the empty bucket it would go into. There's always an empty
+ * bucket, as a table holds at most half as many keys as it has buckets.
+ */
+static uint8_t CanDispatchFind(const CanDispatchTable *table, uint32_t key)
+{
+	uint8_t bucket = CanDispatchHash(key);
+	while (table->Map[bucket] && table->Slots[table->Map[bucket] - 1].Key != key) {
+		bucket = (bucket + 1) & (CAN_DISPATCH_BUCKETS - 1);
+	}
+	return bucket;
+}
+
+void CanDispatchInit(CanDispatchTable *table, uint32_t (*clock)(void))
+{
+	memset(table->Map, 0, sizeof(table->Map));
+	memset(table->Slots, 0, table->SlotCount * sizeof(CanDispatchSlot));
+	table->Registered = 0;
+	table->Unhandled = 0;
+	table->Clock = clock;
+}
+
+bool CanDispatchRegister(CanDispatchTable *table, uint32_t id, bool pgn, CanHandler handler)
+{
+	if (id > (pgn ? 0x3FFFFUL : 0x7FFUL) || table->Registered == table->SlotCount ||
+	    table->Registered == CAN_DISPATCH_MAX_SLOTS) {
+		return false;
+	}
+
+	const uint32_t key = pgn ? (id | CAN_DISPATCH_PGN) : id;
+	const uint8_t bucket = CanDispatchFind(table, key);
+	if (table->Map[bucket]) {
+		return false;
+	}
+
+	CanDispatchSlot *slot = &table->Slots[table->Registered];
+	slot->Handler = handler;
+	slot->Key = key;
+	memset(&slot->Stats, 0, sizeof(slot->Stats));
+	table->Map[bucket] = ++table->Registered;
+	return true;
+}
+
+bool CanDispatch(CanDispatchTable *table, const CanMessage *msg)
+{
+	const uint32_t key = (msg->frame_type == CAN_FRAME_EXT) ?
+	                     (Iso11783Decode(msg->id, NULL, NULL, NULL) | CAN_DISPATCH_PGN) : msg->id;
+	const uint8_t i = table->Map[CanDispatchFind(table, key)];
+	if (!i) {
+		++table->Unhandled;
+		return false;
+	}
+
+	CanDispatchSlot *slot = &table->Slots[i - 1];
+	slot->Handler(msg);
+	++slot->Stats.Count;
+	if (table->Clock) {
+		slot->Stats.LastSeen = table->Clock();
+	}
+	return true;
+}
+
+const CanDispatchStats *CanDispatchGetStats(const CanDispatchTable *table, uint32_t id, bool pgn)
+{
+	const uint8_t i = table->Map[CanDispatchFind(table, pgn ? (id | CAN_DISPATCH_PGN) : id)];
+	return i ? &table->Slots[i - 1].Stats : NULL;
+}
+
+void CanDispatchResetStats(CanDispatchTable *table)
+{
+	uint8_t i;
+	for (i = 0; i < table->Registered; ++i) {
+		memset(&table->Slots[i].Stats, 0, sizeof(table->Slots[i].Stats));
+	}
+	table->Unhandled = 0;
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_CAN_DISPATCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0
+#endif
+
+#include "Acs300.h"
+#include "CanMessages.h"
+
+// Every handler just records what it was called with, in an order-dependent checksum.
+static uint32_t handled;
+static uint32_t checksum;
+static uint32_t lastId;
+
+static void Handle(const CanMessage *msg)
+{
+	++handled;
+	checksum = checksum * 31 + msg->id;
+	lastId = msg->id;
+}
+
+static uint32_t TestClock(void)
+{
+	static uint32_t t = 0;
+	return t += 5;
+}
+
+static CanMessage MakeFrame(uint32_t id, bool extended)
+{
+	CanMessage m;
+	memset(&m, 0, sizeof(m));
+	m.id = id;
+	m.frame_type = extended ? CAN_FRAME_EXT : CAN_FRAME_STD;
+	m.validBytes = 8;
+	return m;
+}
+
+// The messages the primary node handles, in the order ProcessAllEcanMessages() used to check them.
+static const uint32_t primaryIds[] = {
+	ACS300_CAN_ID_HRTBT, ACS300_CAN_ID_WR_PARAM, CAN_MSG_ID_STATUS, CAN_MSG_ID_RUDDER_DETAILS,
+	CAN_MSG_ID_IMU_DATA, CAN_MSG_ID_ANG_VEL_DATA, CAN_MSG_ID_ACCEL_DATA, CAN_MSG_ID_GPS_POS_DATA,
+	CAN_MSG_ID_GPS_EST_POS_DATA, CAN_MSG_ID_GPS_VEL_DATA
+};
+static const uint32_t primaryPgns[] = {
+	PGN_ID_SYSTEM_TIME, PGN_ID_RUDDER, PGN_ID_BATTERY_STATUS, PGN_ID_SPEED, PGN_ID_WATER_DEPTH,
+	PGN_ID_POSITION_RAP_UPD, PGN_ID_COG_SOG_RAP_UPD, PGN_ID_GNSS_DOPS, PGN_ID_WIND_DATA,
+	PGN_ID_ENV_PARAMETERS, PGN_ID_ENV_PARAMETERS2, PGN_ID_DC_SOURCE_STATUS, PGN_ID_GNSS_POSITION_DATA
+};
+#define PRIMARY_ID_COUNT (sizeof(primaryIds) / sizeof(primaryIds[0]))
+#define PRIMARY_PGN_COUNT (sizeof(primaryPgns) / sizeof(primaryPgns[0]))
+
+/**
+ * The dispatch of ProcessAllEcanMessages() before it used a table, with every branch calling the
+ * same handler.
+ */
+static __attribute__((noinline)) bool ChainDispatch(const CanMessage *msg)
+{
+	if (msg->frame_type == CAN_FRAME_STD) {
+		if (msg->id == ACS300_CAN_ID_HRTBT) {
+			Handle(msg);
+		} else if (msg->id == ACS300_CAN_ID_WR_PARAM) {
+			Handle(msg);
+		} else if (msg->id == CAN_MSG_ID_STATUS) {
+			Handle(msg);
+		} else if (msg->id == CAN_MSG_ID_RUDDER_DETAILS) {
+			Handle(msg);
+		} else if (msg->id == CAN_MSG_ID_IMU_DATA) {
+			Handle(msg);
+		} else if (msg->id == CAN_MSG_ID_ANG_VEL_DATA) {
+			Handle(msg);
+		} else if (msg->id == CAN_MSG_ID_ACCEL_DATA) {
+			Handle(msg);
+		} else if (msg->id == CAN_MSG_ID_GPS_POS_DATA) {
+			Handle(msg);
+		} else if (msg->id == CAN_MSG_ID_GPS_EST_POS_DATA) {
+			Handle(msg);
+		} else if (msg->id == CAN_MSG_ID_GPS_VEL_DATA) {
+			Handle(msg);
+		} else {
+			return false;
+		}
+	} else {
+		switch (Iso11783Decode(msg->id, NULL, NULL, NULL)) {
+		case PGN_ID_SYSTEM_TIME: Handle(msg); break;
+		case PGN_ID_RUDDER: Handle(msg); break;
+		case PGN_ID_BATTERY_STATUS: Handle(msg); break;
+		case PGN_ID_SPEED: Handle(msg); break;
+		case PGN_ID_WATER_DEPTH: Handle(msg); break;
+		case PGN_ID_POSITION_RAP_UPD: Handle(msg); break;
+		case PGN_ID_COG_SOG_RAP_UPD: Handle(msg); break;
+		case PGN_ID_GNSS_DOPS: Handle(msg); break;
+		case PGN_ID_WIND_DATA: Handle(msg); break;
+		case PGN_ID_ENV_PARAMETERS: Handle(msg); break;
+		case PGN_ID_ENV_PARAMETERS2: Handle(msg); break;
+		case PGN_ID_DC_SOURCE_STATUS: Handle(msg); break;
+		case PGN_ID_GNSS_POSITION_DATA: Handle(msg); break;
+		default: return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * The traffic the primary node receives in a second, after its acceptance filters: every message
+ * it handles at roughly the rate it's sent at, and the unwanted ones the filters let through.
+ */
+typedef struct {
+	uint32_t Id; // A standard ID, or an extended one built from a PGN.
+	bool Pgn;
+	uint8_t PerSecond;
+} TrafficRate;
+
+static const TrafficRate traffic[] = {
+	{ACS300_CAN_ID_HRTBT, false, 50},
+	{ACS300_CAN_ID_WR_PARAM, false, 10},
+	{CAN_MSG_ID_STATUS, false, 14},
+	{CAN_MSG_ID_RUDDER_DETAILS, false, 10},
+	{CAN_MSG_ID_IMU_DATA, false, 25},
+	{CAN_MSG_ID_ANG_VEL_DATA, false, 25},
+	{CAN_MSG_ID_ACCEL_DATA, false, 25},
+	{CAN_MSG_ID_GPS_POS_DATA, false, 5},
+	{CAN_MSG_ID_GPS_EST_POS_DATA, false, 5},
+	{CAN_MSG_ID_GPS_VEL_DATA, false, 5},
+	{PGN_ID_SYSTEM_TIME, true, 1},
+	{PGN_ID_RUDDER, true, 20},
+	{PGN_ID_BATTERY_STATUS, true, 2},
+	{PGN_ID_SPEED, true, 2},
+	{PGN_ID_WATER_DEPTH, true, 2},
+	{PGN_ID_POSITION_RAP_UPD, true, 5},
+	{PGN_ID_COG_SOG_RAP_UPD, true, 5},
+	{PGN_ID_GNSS_DOPS, true, 1},
+	{PGN_ID_WIND_DATA, true, 2},
+	{PGN_ID_ENV_PARAMETERS, true, 1},
+	{PGN_ID_ENV_PARAMETERS2, true, 1},
+	{PGN_ID_DC_SOURCE_STATUS, true, 3},
+	{PGN_ID_GNSS_POSITION_DATA, true, 7},
+	// False accepts.
+	{127250, true, 10},
+	{127251, true, 10},
+	{130312, true, 1},
+	{0x100, false, 10}
+};
+
+#define STREAM_LENGTH 4096
+#define BENCH_ROUNDS 2000
+
+static CanMessage frames[STREAM_LENGTH];
+static uint16_t frameCount;
+
+/**
+ * Fills `frames` with the traffic above in a random order.
+ */
+static void GenerateTraffic(void)
+{
+	uint16_t total = 0, i;
+	for (i = 0; i < sizeof(traffic) / sizeof(traffic[0]); ++i) {
+		total += traffic[i].PerSecond;
+	}
+
+	srand(7);
+	for (frameCount = 0; frameCount < STREAM_LENGTH; ++frameCount) {
+		int pick = rand() % total;
+		for (i = 0; pick >= traffic[i].PerSecond; pick -= traffic[i].PerSecond, ++i);
+		if (traffic[i].Pgn) {
+			frames[frameCount] = MakeFrame(Iso11783Encode(traffic[i].Id, 1 + rand() % 40, 0xFF, 2 + rand() % 4), true);
+		} else {
+			frames[frameCount] = MakeFrame(traffic[i].Id, false);
+		}
+	}
+}
+
+/**
+ * Appends the frames of a SocketCAN log file to `frames`, like Scripts/C/EcanFilterReport.c reads
+ * them, until it's full.
+ * @return False if the file couldn't be read.
+ */
+static bool ReadTrace(const char *path)
+{
+	char line[256];
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		return false;
+	}
+
+	while (frameCount < STREAM_LENGTH && fgets(line, sizeof(line), f)) {
+		char *hash = strchr(line, '#');
+		char *start, *end;
+		uint32_t id;
+		if (!hash) {
+			continue;
+		}
+		for (start = hash; start > line && start[-1] != ' '; --start);
+		id = strtoul(start, &end, 16);
+		if (end != hash || (hash - start != 3 && hash - start != 8)) {
+			continue;
+		}
+		frames[frameCount++] = MakeFrame(id, hash - start == 8);
+	}
+	fclose(f);
+	return true;
+}
+
+/**
+ * Runs every frame through either the chain or a table and returns the average cost of a dispatch
+ * in TSC cycles.
+ */
+static double Benchmark(CanDispatchTable *table)
+{
+	uint64_t start = CYCLES();
+	int round, i;
+	for (round = 0; round < BENCH_ROUNDS; ++round) {
+		for (i = 0; i < frameCount; ++i) {
+			if (table) {
+				CanDispatch(table, &frames[i]);
+			} else {
+				ChainDispatch(&frames[i]);
+			}
+		}
+	}
+	return (double)(CYCLES() - start) / ((double)BENCH_ROUNDS * frameCount);
+}
+
+int main(int argc, char *argv[])
+{
+	static CanDispatchSlot slots[CAN_DISPATCH_MAX_SLOTS + 1];
+	static CanDispatchTable table = {.Slots = slots, .SlotCount = CAN_DISPATCH_MAX_SLOTS + 1};
+	CanMessage m;
+	uint32_t i;
+
+	// Registration fails for duplicates, invalid IDs, and when the table is full.
+	{
+		static CanDispatchSlot small[2];
+		static CanDispatchTable t = {.Slots = small, .SlotCount = 2};
+		CanDispatchInit(&t, NULL);
+		assert(!CanDispatchRegister(&t, 0x800, false, Handle));
+		assert(!CanDispatchRegister(&t, 0x40000, true, Handle));
+		assert(CanDispatchRegister(&t, CAN_MSG_ID_STATUS, false, Handle));
+		assert(!CanDispatchRegister(&t, CAN_MSG_ID_STATUS, false, Handle));
+		assert(CanDispatchRegister(&t, CAN_MSG_ID_STATUS, true, Handle));
+		assert(!CanDispatchRegister(&t, PGN_ID_RUDDER, true, Handle));
+		assert(CanDispatchGetStats(&t, PGN_ID_RUDDER, true) == NULL);
+		assert(CanDispatchGetStats(&t, CAN_MSG_ID_STATUS, false) != CanDispatchGetStats(&t, CAN_MSG_ID_STATUS, true));
+
+		CanDispatchInit(&table, NULL);
+		for (i = 0; i < CAN_DISPATCH_MAX_SLOTS; ++i) {
+			assert(CanDispatchRegister(&table, i, false, Handle));
+		}
+		assert(!CanDispatchRegister(&table, i, false, Handle));
+		printf("Registration refuses duplicates, invalid IDs, and overflow.\n");
+	}
+
+	// Frames go to the handler of their ID or PGN regardless of priority, source, and for PDU1
+	// PGNs destination, with the right statistics.
+	{
+		CanDispatchInit(&table, TestClock);
+		assert(CanDispatchRegister(&table, CAN_MSG_ID_STATUS, false, Handle));
+		assert(CanDispatchRegister(&table, PGN_ID_RUDDER, true, Handle));
+		assert(CanDispatchRegister(&table, 59904, true, Handle)); // ISO Request, a PDU1 PGN.
+
+		handled = 0;
+		m = MakeFrame(CAN_MSG_ID_STATUS, false);
+		assert(CanDispatch(&table, &m) && lastId == CAN_MSG_ID_STATUS);
+		m = MakeFrame(Iso11783Encode(PGN_ID_RUDDER, 10, 0xFF, 2), true);
+		assert(CanDispatch(&table, &m));
+		m = MakeFrame(Iso11783Encode(PGN_ID_RUDDER, 33, 0xFF, 6), true);
+		assert(CanDispatch(&table, &m));
+		m = MakeFrame(Iso11783Encode(59904, 33, 12, 6), true);
+		assert(CanDispatch(&table, &m));
+		m = MakeFrame(Iso11783Encode(59904, 20, 0xFF, 6), true);
+		assert(CanDispatch(&table, &m));
+		assert(handled == 5);
+
+		const CanDispatchStats *s = CanDispatchGetStats(&table, PGN_ID_RUDDER, true);
+		assert(s->Count == 2 && s->LastSeen == 15);
+		s = CanDispatchGetStats(&table, CAN_MSG_ID_STATUS, false);
+		assert(s->Count == 1 && s->LastSeen == 5);
+		assert(CanDispatchGetStats(&table, 59904, true)->Count == 2);
+
+		// Unhandled frames are counted but nothing else changes, including a standard frame with
+		// the number of a handled PGN and the other way around.
+		m = MakeFrame(PGN_ID_RUDDER & 0x7FF, false);
+		assert(!CanDispatch(&table, &m));
+		m = MakeFrame(Iso11783Encode(CAN_MSG_ID_STATUS, 10, 0xFF, 2), true);
+		assert(!CanDispatch(&table, &m));
+		m = MakeFrame(CAN_MSG_ID_IMU_DATA, false);
+		assert(!CanDispatch(&table, &m));
+		assert(table.Unhandled == 3 && handled == 5);
+
+		CanDispatchResetStats(&table);
+		assert(table.Unhandled == 0 && CanDispatchGetStats(&table, PGN_ID_RUDDER, true)->Count == 0);
+		printf("Frames dispatched by ID and PGN with correct statistics.\n");
+	}
+
+	// A full table of random keys finds every one of them, through whatever collisions there are.
+	{
+		uint32_t keys[CAN_DISPATCH_MAX_SLOTS];
+		srand(3);
+		CanDispatchInit(&table, NULL);
+		for (i = 0; i < CAN_DISPATCH_MAX_SLOTS; ++i) {
+			const bool pgn = rand() & 1;
+			do {
+				keys[i] = pgn ? (rand() & 0x3FFFF) | CAN_DISPATCH_PGN : rand() & 0x7FF;
+				if (pgn && ((keys[i] >> 8) & 0xFF) < 240) {
+					keys[i] &= ~0xFFUL; // PDU1 PGNs leave the destination out.
+				}
+			} while (!CanDispatchRegister(&table, keys[i] & ~CAN_DISPATCH_PGN, pgn, Handle));
+		}
+		for (i = 0; i < CAN_DISPATCH_MAX_SLOTS; ++i) {
+			if (keys[i] & CAN_DISPATCH_PGN) {
+				m = MakeFrame(Iso11783Encode(keys[i] & ~CAN_DISPATCH_PGN, 1, 0xFF, 3), true);
+			} else {
+				m = MakeFrame(keys[i], false);
+			}
+			assert(CanDispatch(&table, &m));
+			assert(CanDispatchGetStats(&table, keys[i] & ~CAN_DISPATCH_PGN, keys[i] & CAN_DISPATCH_PGN)->Count == 1);
+		}
+		assert(table.Unhandled == 0);
+		printf("A full table of %u random keys dispatches every one of them.\n", CAN_DISPATCH_MAX_SLOTS);
+	}
+
+	// Now replay traffic through the chain and a table of the same messages, which have to handle
+	// exactly the same frames.
+	{
+		static CanDispatchSlot primarySlots[PRIMARY_ID_COUNT + PRIMARY_PGN_COUNT];
+		static CanDispatchTable primary = {.Slots = primarySlots, .SlotCount = PRIMARY_ID_COUNT + PRIMARY_PGN_COUNT};
+		uint32_t chainHandled, chainChecksum;
+		int arg;
+		double cost;
+
+		frameCount = 0;
+		for (arg = 1; arg < argc; ++arg) {
+			if (!ReadTrace(argv[arg])) {
+				printf("Failed to read '%s'.\n", argv[arg]);
+				return EXIT_FAILURE;
+			}
+		}
+		if (argc > 1) {
+			printf("Replaying the first %u frames of the given traces.\n", frameCount);
+		} else {
+			GenerateTraffic();
+			printf("Replaying %u frames of generated primary node traffic.\n", frameCount);
+		}
+		if (!frameCount) {
+			printf("No frames found.\n");
+			return EXIT_FAILURE;
+		}
+
+		CanDispatchInit(&primary, NULL);
+		for (i = 0; i < PRIMARY_ID_COUNT; ++i) {
+			assert(CanDispatchRegister(&primary, primaryIds[i], false, Handle));
+		}
+		for (i = 0; i < PRIMARY_PGN_COUNT; ++i) {
+			assert(CanDispatchRegister(&primary, primaryPgns[i], true, Handle));
+		}
+
+		handled = checksum = 0;
+		for (i = 0; i < frameCount; ++i) {
+			ChainDispatch(&frames[i]);
+		}
+		chainHandled = handled;
+		chainChecksum = checksum;
+		handled = checksum = 0;
+		for (i = 0; i < frameCount; ++i) {
+			CanDispatch(&primary, &frames[i]);
+		}
+		assert(handled == chainHandled && checksum == chainChecksum);
+		assert(primary.Unhandled == frameCount - handled);
+		printf("Both handle the same %u frames and skip %u.\n", handled, primary.Unhandled);
+
+		printf("%-40s %12s\n", "", "cycles/frame");
+		cost = Benchmark(NULL);
+		printf("%-40s %12.1f\n", "if/else chain and switch", cost);
+		cost = Benchmark(&primary);
+		printf("%-40s %12.1f\n", "table", cost);
+		primary.Clock = TestClock;
+		cost = Benchmark(&primary);
+		printf("%-40s %12.1f\n", "table, timestamped", cost);
+
+		// Show the statistics of a single pass, as the benchmark overflows the timestamps.
+		CanDispatchResetStats(&primary);
+		for (i = 0; i < frameCount; ++i) {
+			CanDispatch(&primary, &frames[i]);
+		}
+		printf("%-10s %-8s %8s %10s\n", "message", "type", "count", "last seen");
+		for (i = 0; i < primary.Registered; ++i) {
+			const CanDispatchSlot *slot = &primarySlots[i];
+			printf("%-10lu %-8s %8u %10u\n", (unsigned long)(slot->Key & ~CAN_DISPATCH_PGN),
+			       (slot->Key & CAN_DISPATCH_PGN) ? "PGN" : "std", slot->Stats.Count, slot->Stats.LastSeen);
+		}
+	}
+
+	printf("All tests passed.\n");
+	return EXIT_SUCCESS;
+}
+
+#endif // UNIT_TEST_CAN_DISPATCH
@@ -0,0 +1,126 @@
+/**
+ * @file   CanDispatch.h
+ * @brief  Dispatch tables mapping CAN IDs and NMEA2000 PGNs to handlers, with per-message statistics.
+ *
+ * A dispatch table replaces an if/else chain on the ID of standard frames and a `switch` on the PGN
+ * of extended frames, like MavlinkDispatch does for MAVLink. Handlers are registered for a standard
+ * ID or a PGN, and looked up in a small hash table with open addressing, so a lookup costs about
+ * the same no matter how many handlers there are or where in the list a message would have been.
+ * The PGN of an extended frame is decoded with Iso11783Decode(), so frames are matched regardless
+ * of their priority and source and, for PDU1 PGNs, destination address. Only the hash table is
+ * sized for the most handlers a table can have; the handler slots themselves are provided by the
+ * user and sized for the messages actually handled.
+ *
+ * Every slot counts how often its handler ran, and if a clock function is given to the table also
+ * when it last did, in whatever unit that clock counts. The statistics are plain fields that can
+ * be read at any time, either directly or through CanDispatchGetStats().
+ *
+ * Usage:
+ * ```
+ * static CanDispatchSlot slots[2];
+ * static CanDispatchTable table = {.Slots = slots, .SlotCount = 2};
+ * CanDispatchInit(&table, NULL);
+ * CanDispatchRegister(&table, CAN_MSG_ID_STATUS, false, HandleStatus);
+ * CanDispatchRegister(&table, PGN_ID_RUDDER, true, HandleRudder);
+ * ...
+ * CanDispatch(&table, &msg);
+ * ```
+ *
+ * Unit testing, including a benchmark that replays CAN traffic through the tables and the if/else
+ * chain and `switch` of ProcessAllEcanMessages() they replaced, is done on x86 by compiling with the
+ * UNIT_TEST_CAN_DISPATCH macro:
+ * `gcc CanDispatch.c Nmea2000.c -DUNIT_TEST_CAN_DISPATCH -I. -O2 -Wall -lm`
+ * It replays the SocketCAN log files given on the command line, as recorded with `candump -l`, or
+ * generated traffic like the primary node sees if there are none.
+ */
+#ifndef CAN_DISPATCH_H
+#define CAN_DISPATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "EcanDefines.h"
+
+// The size of the hash table. Tables hold up to half this many handlers, so that lookups rarely
+// need more than a probe or two.
+#define CAN_DISPATCH_BUCKETS 64
+#define CAN_DISPATCH_MAX_SLOTS (CAN_DISPATCH_BUCKETS / 2)
+
+/**
+ * A message handler, passed the received frame.
+ */
+typedef void (*CanHandler)(const CanMessage *msg);
+
+/**
+ * The statistics kept for every registered message.
+ */
+typedef struct {
+	uint32_t Count;    // How many times the handler was run.
+	uint32_t LastSeen; // The table's clock when the handler last ran. 0 if there's no clock.
+} CanDispatchStats;
+
+/**
+ * A registered handler.
+ */
+typedef struct {
+	CanHandler Handler;
+	uint32_t Key; // The standard ID, or the PGN with CAN_DISPATCH_PGN set.
+	CanDispatchStats Stats;
+} CanDispatchSlot;
+
+/**
+ * A dispatch table. `Slots` and `SlotCount` are set when declaring it, then it's initialized with
+ * CanDispatchInit().
+ */
+typedef struct {
+	// The slot of every registered key, by hash, numbered starting at 1 so that 0 marks an empty
+	// bucket.
+	uint8_t Map[CAN_DISPATCH_BUCKETS];
+	// Storage for the registered handlers. Contains `SlotCount` entries.
+	CanDispatchSlot *const Slots;
+	const uint8_t SlotCount;
+	// The number of slots registered so far.
+	uint8_t Registered;
+	// How many frames were dispatched without a handler.
+	uint16_t Unhandled;
+	// Returns the current time for the statistics, or NULL to not keep track of it.
+	uint32_t (*Clock)(void);
+} CanDispatchTable;
+
+/**
+ * Set in the key of slots that handle a PGN. Standard IDs and PGNs never have this bit set.
+ */
+#define CAN_DISPATCH_PGN 0x80000000UL
+
+/**
+ * Clears all registered handlers and statistics.
+ * @param table The table to initialize.
+ * @param clock A clock to timestamp handled messages with, or NULL.
+ */
+void CanDispatchInit(CanDispatchTable *table, uint32_t (*clock)(void));
+
+/**
+ * Registers a handler for a standard ID or a PGN.
+ * @param pgn Whether `id` is a PGN, received in extended frames.
+ * @return False if the message already has a handler, there are no slots left, a standard ID
+ *         doesn't fit 11 bits, or a PGN doesn't fit 18 bits.
+ */
+bool CanDispatchRegister(CanDispatchTable *table, uint32_t id, bool pgn, CanHandler handler);
+
+/**
+ * Runs the handler for a frame and updates its statistics.
+ * @return False if there's no handler for this frame.
+ */
+bool CanDispatch(CanDispatchTable *table, const CanMessage *msg);
+
+/**
+ * Returns the statistics of a standard ID or PGN, or NULL if it has no handler.
+ */
+const CanDispatchStats *CanDispatchGetStats(const CanDispatchTable *table, uint32_t id, bool pgn);
+
+/**
+ * Zeroes the statistics of every handler, leaving them registered.
+ */
+void CanDispatchResetStats(CanDispatchTable *table);
+
+#endif // CAN_DISPATCH_H
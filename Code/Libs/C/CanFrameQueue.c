@@ -0,0 +1,373 @@
+/*
+ * Copyright Bryant Mairs 2012
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses.
+ */
+
+/**
+ * @file   CanFrameQueue.c
+ * @brief  A fixed-record FIFO queue of CanMessage structs.
+ *
+ * See CanFrameQueue.h for details.
+ */
+#include "CanFrameQueue.h"
+
+#include <stddef.h>
+#include <string.h>
+
+bool CFQ_Init(CanFrameQueue *q, CanMessage *slots, uint8_t capacity)
+{
+	if (!q || !slots || capacity == 0) {
+		return false;
+	}
+
+	q->slots = slots;
+	q->capacity = capacity;
+	q->head = 0;
+	q->tail = 0;
+	q->count = 0;
+	q->highWater = 0;
+	q->overflowCount = 0;
+
+	return true;
+}
+
+bool CFQ_Push(CanFrameQueue *q, const CanMessage *msg)
+{
+	if (q->count == q->capacity) {
+		++q->overflowCount;
+		return false;
+	}
+
+	q->slots[q->head] = *msg;
+	if (++q->head == q->capacity) {
+		q->head = 0;
+	}
+	if (++q->count > q->highWater) {
+		q->highWater = q->count;
+	}
+
+	return true;
+}
+
+bool CFQ_Pop(CanFrameQueue *q, CanMessage *msg)
+{
+	if (q->count == 0) {
+		return false;
+	}
+
+	if (msg) {
+		*msg = q->slots[q->tail];
+	}
+	if (++q->tail == q->capacity) {
+		q->tail = 0;
+	}
+	--q->count;
+
+	return true;
+}
+
+uint8_t CFQ_PopMany(CanFrameQueue *q, CanMessage *msgs, uint8_t maxFrames)
+{
+	const uint8_t n = (maxFrames < q->count) ? maxFrames : q->count;
+	const CanMessage *src = &q->slots[q->tail];
+	const CanMessage *end = &q->slots[q->capacity];
+	uint8_t i;
+
+	// Copy the frames out with a single wrap check per frame rather than the full head/tail/count
+	// bookkeeping of CFQ_Pop(), and update that bookkeeping once at the end.
+	for (i = 0; i < n; ++i) {
+		msgs[i] = *src;
+		if (++src == end) {
+			src = q->slots;
+		}
+	}
+	q->tail = (uint8_t)(src - q->slots);
+	q->count -= n;
+
+	return n;
+}
+
+const CanMessage *CFQ_Peek(const CanFrameQueue *q)
+{
+	if (q->count == 0) {
+		return NULL;
+	}
+	return &q->slots[q->tail];
+}
+
+void CFQ_Clear(CanFrameQueue *q)
+{
+	q->head = 0;
+	q->tail = 0;
+	q->count = 0;
+}
+
+uint8_t CFQ_GetDepth(const CanFrameQueue *q)
+{
+	return q->count;
+}
+
+uint8_t CFQ_GetHighWater(const CanFrameQueue *q)
+{
+	return q->highWater;
+}
+
+void CFQ_ResetHighWater(CanFrameQueue *q)
+{
+	q->highWater = q->count;
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_CAN_FRAME_QUEUE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+#include "CircularBuffer.h"
+
+static CanMessage MakeFrame(uint32_t i)
+{
+	CanMessage m;
+	memset(&m, 0, sizeof(m));
+	m.id = i;
+	m.frame_type = (i & 1) ? CAN_FRAME_EXT : CAN_FRAME_STD;
+	m.validBytes = 8;
+	memcpy(m.payload, &i, sizeof(i));
+	return m;
+}
+
+/**
+ * Stand-in for the interrupt enable bit that Ecan1.c toggles around every queue access, so that the
+ * cost of entering/leaving critical sections shows up in the benchmark.
+ */
+static volatile uint16_t fakeC1IE = 1;
+
+// The length of an extended 8-byte data frame without stuff bits: SOF, 32 bits of arbitration,
+// 6 control bits, 64 data bits, a 16-bit CRC field, 2 ACK bits, 7 EOF bits, and 3 bits of
+// interframe space. This is the shortest and therefore most frequent a fully-loaded frame can be.
+#define BENCH_FRAME_BITS 131
+#define BENCH_BITRATE 250000UL
+#define BENCH_FRAMES_PER_SECOND (BENCH_BITRATE / BENCH_FRAME_BITS)
+#define BENCH_SECONDS 3600UL
+#define BENCH_QUEUE_LENGTH 12
+#define BENCH_BATCH 8
+
+typedef enum {
+	BENCH_CIRCULAR_BUFFER,
+	BENCH_QUEUE_SINGLE,
+	BENCH_QUEUE_BATCH
+} BenchMode;
+
+/**
+ * Replay BENCH_SECONDS of a saturated bus through one of the three queue implementations. The
+ * "ISR" pushes every frame as it arrives, and the "main loop" drains the queue every `interval`
+ * frames the same way ProcessAllEcanMessages() does: a frame at a time for the first two modes, or
+ * a batch at a time. Returns ns per frame and fills in the number of critical sections entered, an
+ * order-dependent checksum of everything received, and the high-water mark.
+ */
+static double BenchmarkReplay(BenchMode mode, uint8_t interval, uint32_t *criticalSections, uint32_t *checksum, uint8_t *highWater)
+{
+	CircularBuffer cb;
+	uint8_t cbData[BENCH_QUEUE_LENGTH * sizeof(CanMessage)];
+	CanFrameQueue q;
+	CanMessage slots[BENCH_QUEUE_LENGTH];
+	CanMessage frames[64];
+	CanMessage batch[BENCH_BATCH];
+	const uint32_t total = BENCH_FRAMES_PER_SECOND * BENCH_SECONDS;
+	uint32_t sent = 0, sections = 0, sum = 0, i;
+
+	for (i = 0; i < 64; ++i) {
+		frames[i] = MakeFrame(0x18000000 + i * 0x100 + (i & 3));
+	}
+	CB_Init(&cb, cbData, sizeof(cbData));
+	CFQ_Init(&q, slots, BENCH_QUEUE_LENGTH);
+
+	clock_t start = clock();
+	while (sent < total) {
+		// Frames arrive from the bus.
+		for (i = 0; i < interval && sent < total; ++i, ++sent) {
+			const CanMessage *m = &frames[sent & 63];
+			if (mode == BENCH_CIRCULAR_BUFFER) {
+				CB_WriteMany(&cb, m, sizeof(CanMessage), true);
+			} else {
+				CFQ_Push(&q, m);
+			}
+		}
+
+		// Then the main loop gets around to processing them.
+		if (mode == BENCH_QUEUE_BATCH) {
+			uint8_t n;
+			do {
+				fakeC1IE = 0;
+				n = CFQ_PopMany(&q, batch, BENCH_BATCH);
+				fakeC1IE = 1;
+				++sections;
+				for (i = 0; i < n; ++i) {
+					sum = sum * 31 + batch[i].id + batch[i].payload[0];
+				}
+			} while (n == BENCH_BATCH);
+		} else {
+			bool found;
+			do {
+				CanMessage m;
+				fakeC1IE = 0;
+				if (mode == BENCH_CIRCULAR_BUFFER) {
+					found = CB_ReadMany(&cb, &m, sizeof(CanMessage));
+				} else {
+					found = CFQ_Pop(&q, &m);
+				}
+				fakeC1IE = 1;
+				++sections;
+				if (found) {
+					sum = sum * 31 + m.id + m.payload[0];
+				}
+			} while (found);
+		}
+	}
+	clock_t end = clock();
+
+	*criticalSections = sections;
+	*checksum = sum;
+	*highWater = (mode == BENCH_CIRCULAR_BUFFER) ? 0 : CFQ_GetHighWater(&q);
+	return (double)(end - start) / CLOCKS_PER_SEC * 1e9 / total;
+}
+
+int main(void)
+{
+	// Initialization.
+	{
+		CanFrameQueue q;
+		CanMessage slots[4];
+		assert(!CFQ_Init(NULL, slots, 4));
+		assert(!CFQ_Init(&q, NULL, 4));
+		assert(!CFQ_Init(&q, slots, 0));
+		assert(CFQ_Init(&q, slots, 4));
+		assert(CFQ_GetDepth(&q) == 0);
+		assert(CFQ_GetHighWater(&q) == 0);
+		assert(CFQ_Peek(&q) == NULL);
+		assert(!CFQ_Pop(&q, NULL));
+	}
+
+	// Push/pop ordering, overflow, and the high-water mark.
+	{
+		CanFrameQueue q;
+		CanMessage slots[4];
+		CanMessage m;
+		uint32_t i;
+		CFQ_Init(&q, slots, 4);
+		for (i = 0; i < 4; ++i) {
+			m = MakeFrame(i);
+			assert(CFQ_Push(&q, &m));
+		}
+		m = MakeFrame(99);
+		assert(!CFQ_Push(&q, &m));
+		assert(q.overflowCount == 1);
+		assert(CFQ_GetDepth(&q) == 4 && CFQ_GetHighWater(&q) == 4);
+
+		assert(CFQ_Peek(&q)->id == 0);
+		assert(CFQ_Pop(&q, &m) && m.id == 0);
+		assert(CFQ_Pop(&q, NULL));
+		assert(CFQ_GetDepth(&q) == 2 && CFQ_GetHighWater(&q) == 4);
+		CFQ_ResetHighWater(&q);
+		assert(CFQ_GetHighWater(&q) == 2);
+
+		// Wrap the head around the end of the slots.
+		for (i = 4; i < 6; ++i) {
+			m = MakeFrame(i);
+			assert(CFQ_Push(&q, &m));
+		}
+		for (i = 2; i < 6; ++i) {
+			assert(CFQ_Pop(&q, &m) && m.id == i && m.payload[0] == i);
+		}
+		assert(!CFQ_Pop(&q, &m));
+
+		m = MakeFrame(7);
+		CFQ_Push(&q, &m);
+		CFQ_Clear(&q);
+		assert(CFQ_GetDepth(&q) == 0 && CFQ_Peek(&q) == NULL);
+		assert(CFQ_GetHighWater(&q) == 4);
+	}
+
+	// Batch dequeues of every size at every starting offset.
+	{
+		CanFrameQueue q;
+		CanMessage slots[7];
+		CanMessage out[10];
+		uint8_t offset, fill, want;
+		for (offset = 0; offset < 7; ++offset) {
+			for (fill = 0; fill <= 7; ++fill) {
+				for (want = 0; want <= 9; ++want) {
+					CanMessage m;
+					uint8_t i, n;
+					CFQ_Init(&q, slots, 7);
+					for (i = 0; i < offset; ++i) {
+						m = MakeFrame(1000);
+						CFQ_Push(&q, &m);
+						CFQ_Pop(&q, NULL);
+					}
+					for (i = 0; i < fill; ++i) {
+						m = MakeFrame(i);
+						CFQ_Push(&q, &m);
+					}
+					n = CFQ_PopMany(&q, out, want);
+					assert(n == ((want < fill) ? want : fill));
+					for (i = 0; i < n; ++i) {
+						assert(out[i].id == i);
+					}
+					assert(CFQ_GetDepth(&q) == fill - n);
+					if (fill > n) {
+						assert(CFQ_Peek(&q)->id == n);
+					}
+				}
+			}
+		}
+	}
+
+	printf("All tests passed.\n");
+
+	// Replay a saturated bus at a range of main-loop service intervals, from draining after every
+	// frame to only every BENCH_QUEUE_LENGTH frames (~6.3ms at this rate).
+	{
+		const uint8_t intervals[] = {1, 2, 4, 8, 12};
+		const char *names[] = {"CircularBuffer", "queue, 1/pop", "queue, batch"};
+		unsigned int i;
+		int mode;
+		printf("\nReplaying %lus of a saturated %lukbit/s bus (%lu frames/s), %u-frame queue:\n",
+		       BENCH_SECONDS, BENCH_BITRATE / 1000, BENCH_FRAMES_PER_SECOND, BENCH_QUEUE_LENGTH);
+		printf("%-8s %-15s %10s %16s %10s\n", "interval", "mode", "ns/frame", "crit. sections/f", "highwater");
+		for (i = 0; i < sizeof(intervals) / sizeof(intervals[0]); ++i) {
+			uint32_t reference = 0;
+			for (mode = BENCH_CIRCULAR_BUFFER; mode <= BENCH_QUEUE_BATCH; ++mode) {
+				uint32_t sections, checksum;
+				uint8_t highWater;
+				double ns = BenchmarkReplay((BenchMode)mode, intervals[i], &sections, &checksum, &highWater);
+				if (mode == BENCH_CIRCULAR_BUFFER) {
+					reference = checksum;
+				}
+				assert(checksum == reference);
+				printf("%-8u %-15s %10.1f %16.2f %10u\n", intervals[i], names[mode], ns,
+				       (double)sections / (BENCH_FRAMES_PER_SECOND * BENCH_SECONDS), highWater);
+			}
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+#endif // UNIT_TEST_CAN_FRAME_QUEUE
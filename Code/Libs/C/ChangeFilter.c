@@ -0,0 +1,407 @@
+#include "ChangeFilter.h"
+
+#include <string.h>
+
+/**
+ * Returns the size of a single element of a field, or 0 for types wider than 32 bits.
+ */
+static uint8_t _Width(mavlink_message_type_t type)
+{
+	switch (type) {
+	case MAVLINK_TYPE_CHAR:
+	case MAVLINK_TYPE_UINT8_T:
+	case MAVLINK_TYPE_INT8_T:
+		return 1;
+	case MAVLINK_TYPE_UINT16_T:
+	case MAVLINK_TYPE_INT16_T:
+		return 2;
+	case MAVLINK_TYPE_UINT32_T:
+	case MAVLINK_TYPE_INT32_T:
+	case MAVLINK_TYPE_FLOAT:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Returns the value of a single element of a field. The element is copied out as payloads don't
+ * keep their fields aligned.
+ */
+static float _Value(const uint8_t *p, mavlink_message_type_t type)
+{
+	switch (type) {
+	case MAVLINK_TYPE_UINT8_T: return *p;
+	case MAVLINK_TYPE_INT8_T:  return (int8_t)*p;
+	case MAVLINK_TYPE_UINT16_T: { uint16_t v; memcpy(&v, p, 2); return v; }
+	case MAVLINK_TYPE_INT16_T:  { int16_t v;  memcpy(&v, p, 2); return v; }
+	case MAVLINK_TYPE_UINT32_T: { uint32_t v; memcpy(&v, p, 4); return v; }
+	case MAVLINK_TYPE_INT32_T:  { int32_t v;  memcpy(&v, p, 4); return v; }
+	case MAVLINK_TYPE_FLOAT:    { float v;    memcpy(&v, p, 4); return v; }
+	default: return 0;
+	}
+}
+
+bool ChangeFilterInit(ChangeFilter *f, const mavlink_message_info_t *info, const float *deadbands, uint16_t maxInterval)
+{
+	uint16_t length = 0;
+	uint8_t i;
+
+	for (i = 0; i < info->num_fields; ++i) {
+		const mavlink_field_info_t *field = &info->fields[i];
+		uint8_t width = _Width(field->type);
+		if (!width) {
+			width = 8;
+		}
+		const uint16_t end = field->wire_offset + width * (field->array_length ? field->array_length : 1);
+		if (end > length) {
+			length = end;
+		}
+	}
+	if (length > CHANGE_FILTER_MAX_PAYLOAD_LEN) {
+		return false;
+	}
+
+	f->Info = info;
+	f->Deadbands = deadbands;
+	f->Length = length;
+	f->MaxInterval = maxInterval;
+	f->LastSentAt = 0;
+	f->Primed = false;
+	f->Sent = 0;
+	f->Suppressed = 0;
+	return true;
+}
+
+/**
+ * Returns whether a field moved further than its deadband from the value last sent.
+ */
+static bool _FieldChanged(const ChangeFilter *f, uint8_t i, const uint8_t *payload)
+{
+	const mavlink_field_info_t *field = &f->Info->fields[i];
+	const uint8_t width = _Width(field->type);
+	const uint8_t count = field->array_length ? field->array_length : 1;
+	const uint8_t *now = &payload[field->wire_offset];
+	const uint8_t *last = &f->Last[field->wire_offset];
+
+	if (memcmp(now, last, (width ? width : 8) * count) == 0) {
+		return false;
+	}
+	if (!f->Deadbands || f->Deadbands[i] <= 0 || !width || field->type == MAVLINK_TYPE_CHAR) {
+		return true;
+	}
+
+	uint8_t j;
+	for (j = 0; j < count; ++j, now += width, last += width) {
+		const float a = _Value(now, field->type);
+		const float b = _Value(last, field->type);
+		// NaNs compare unequal to everything, so a field becoming or stopping being NaN is a change.
+		// Two NaNs are the same.
+		if (a != a || b != b) {
+			if ((a != a) != (b != b)) {
+				return true;
+			}
+		} else if (a - b > f->Deadbands[i] || b - a > f->Deadbands[i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ChangeFilterCheck(ChangeFilter *f, const void *payload, uint32_t now)
+{
+	uint8_t i;
+
+	if (!f->Primed || now - f->LastSentAt >= f->MaxInterval) {
+		return true;
+	}
+	for (i = 0; i < f->Info->num_fields; ++i) {
+		if (_FieldChanged(f, i, payload)) {
+			return true;
+		}
+	}
+	++f->Suppressed;
+	return false;
+}
+
+void ChangeFilterSent(ChangeFilter *f, const void *payload, uint32_t now)
+{
+	memcpy(f->Last, payload, f->Length);
+	f->LastSentAt = now;
+	f->Primed = true;
+	++f->Sent;
+}
+
+#ifdef UNIT_TEST_CHANGE_FILTER
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+
+#define RATE 100                  // Ticks per second, like nodeSystemTime.
+#define MAX_INTERVAL (5 * RATE)
+#define HOUR (3600 * RATE)
+
+static const mavlink_message_info_t wso100Info = MAVLINK_MESSAGE_INFO_WSO100;
+static const mavlink_message_info_t dst800Info = MAVLINK_MESSAGE_INFO_DST800;
+static const mavlink_message_info_t rudderRawInfo = MAVLINK_MESSAGE_INFO_RUDDER_RAW;
+static const mavlink_message_info_t mainPowerInfo = MAVLINK_MESSAGE_INFO_MAIN_POWER;
+static const mavlink_message_info_t nodeStatusInfo = MAVLINK_MESSAGE_INFO_NODE_STATUS;
+static const mavlink_message_info_t paramValueInfo = MAVLINK_MESSAGE_INFO_PARAM_VALUE;
+
+static const float wso100Deadbands[] = {0.2f, 0.05f, 0.2f, 20.0f, 1.0f};
+static const float dst800Deadbands[] = {0.05f, 0.2f, 0.2f};
+static const float rudderRawDeadbands[] = {4, 0, 0, 0, 0, 0};
+static const float mainPowerDeadbands[] = {50, 50, 50, 50, 50, 50};
+static const float nodeStatusDeadbands[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // Status and errors.
+	1, 5, 1, 1, 5, 1, 1, 5, 1, 1, 5, 1, 1, 5, 1, 1, 5, 1 // Temperature, load, and voltage of every node.
+};
+
+static double Noise(double amplitude)
+{
+	return amplitude * ((double)rand() / RAND_MAX * 2 - 1);
+}
+
+/**
+ * Checks a single field deadband against the value last sent rather than the last one checked, so a
+ * slow drift is still sent once it adds up.
+ */
+static void TestDeadband(void)
+{
+	ChangeFilter f;
+	mavlink_dst800_t dst800 = {.speed = 1.0f, .temperature = 15.0f, .depth = 10.0f};
+	uint32_t now = 0;
+
+	assert(ChangeFilterInit(&f, &dst800Info, dst800Deadbands, MAX_INTERVAL));
+	assert(f.Length == MAVLINK_MSG_ID_DST800_LEN);
+
+	// The first message always goes out.
+	assert(ChangeFilterCheck(&f, &dst800, now));
+	ChangeFilterSent(&f, &dst800, now);
+
+	// Identical and within-deadband messages are suppressed, even when drifting the whole time.
+	int i;
+	for (i = 0; i < 4; ++i) {
+		dst800.speed += 0.01f;
+		assert(!ChangeFilterCheck(&f, &dst800, ++now));
+	}
+	assert(f.Suppressed == 4);
+	dst800.speed += 0.02f;
+	assert(ChangeFilterCheck(&f, &dst800, ++now));
+	ChangeFilterSent(&f, &dst800, now);
+
+	// Moving in either direction counts.
+	dst800.depth -= 0.25f;
+	assert(ChangeFilterCheck(&f, &dst800, ++now));
+
+	// Until it was sent, the last value sent is still the reference.
+	dst800.depth += 0.25f;
+	assert(!ChangeFilterCheck(&f, &dst800, ++now));
+
+	// NaN only matters when it starts or stops.
+	dst800.temperature = NAN;
+	assert(ChangeFilterCheck(&f, &dst800, ++now));
+	ChangeFilterSent(&f, &dst800, now);
+	assert(!ChangeFilterCheck(&f, &dst800, ++now));
+	dst800.temperature = 15.0f;
+	assert(ChangeFilterCheck(&f, &dst800, ++now));
+	ChangeFilterSent(&f, &dst800, now);
+
+	// Fields without a deadband send on any change.
+	mavlink_rudder_raw_t rudderRaw = {.raw_position = 512, .port_limit_val = 100, .starboard_limit_val = 900};
+	assert(ChangeFilterInit(&f, &rudderRawInfo, rudderRawDeadbands, MAX_INTERVAL));
+	assert(f.Length == MAVLINK_MSG_ID_RUDDER_RAW_LEN);
+	ChangeFilterSent(&f, &rudderRaw, now);
+	rudderRaw.raw_position += 4;
+	assert(!ChangeFilterCheck(&f, &rudderRaw, now));
+	rudderRaw.starboard_limit = 1;
+	assert(ChangeFilterCheck(&f, &rudderRaw, now));
+	rudderRaw.starboard_limit = 0;
+	rudderRaw.raw_position += 1;
+	assert(ChangeFilterCheck(&f, &rudderRaw, now));
+
+	// And so do all fields without deadbands, as do character fields regardless.
+	mavlink_param_value_t param = {.param_value = 1.0f, .param_count = 13, .param_id = "MODE"};
+	const float paramDeadbands[] = {10.0f, 10.0f, 10.0f, 10.0f, 10.0f};
+	assert(ChangeFilterInit(&f, &paramValueInfo, NULL, MAX_INTERVAL));
+	ChangeFilterSent(&f, &param, now);
+	param.param_index = 1;
+	assert(ChangeFilterCheck(&f, &param, now));
+	assert(ChangeFilterInit(&f, &paramValueInfo, paramDeadbands, MAX_INTERVAL));
+	ChangeFilterSent(&f, &param, now);
+	assert(!ChangeFilterCheck(&f, &param, now));
+	param.param_id[0] = 'N';
+	assert(ChangeFilterCheck(&f, &param, now));
+
+	printf("Deadbands: OK\n");
+}
+
+/**
+ * An unchanging message is still sent every MaxInterval, and a message that couldn't be queued isn't
+ * counted as sent.
+ */
+static void TestKeepAlive(void)
+{
+	ChangeFilter f;
+	mavlink_main_power_t mainPower = {.electronics_voltage = 12600, .actuator_voltage = 24800};
+	uint32_t now = UINT32_MAX - 3 * MAX_INTERVAL / 2; // Wraps around halfway through.
+	uint32_t i, sent = 0;
+
+	assert(ChangeFilterInit(&f, &mainPowerInfo, mainPowerDeadbands, MAX_INTERVAL));
+	for (i = 0; i < 10 * MAX_INTERVAL; i += RATE / 2, now += RATE / 2) {
+		if (ChangeFilterCheck(&f, &mainPower, now)) {
+			ChangeFilterSent(&f, &mainPower, now);
+			++sent;
+		}
+	}
+	assert(sent == 10 && f.Sent == 10 && f.Suppressed == 90);
+
+	// A changed message that couldn't be queued is allowed again next time.
+	mainPower.actuator_current = 2000;
+	assert(ChangeFilterCheck(&f, &mainPower, now));
+	assert(ChangeFilterCheck(&f, &mainPower, now + 1));
+
+	// Payloads that don't fit are refused.
+	static const mavlink_message_info_t controllerDataInfo = MAVLINK_MESSAGE_INFO_CONTROLLER_DATA;
+	assert(!ChangeFilterInit(&f, &controllerDataInfo, NULL, MAX_INTERVAL));
+	assert(ChangeFilterInit(&f, &nodeStatusInfo, NULL, MAX_INTERVAL));
+	assert(f.Length == MAVLINK_MSG_ID_NODE_STATUS_LEN);
+
+	printf("Keep-alive: OK\n");
+}
+
+/**
+ * The sensor messages of the groundstation schedule at their scheduled rates.
+ */
+typedef struct {
+	ChangeFilter filter;
+	uint8_t rate;     // In Hz.
+	uint32_t frames;  // Scheduled.
+	uint32_t bytes;   // Scheduled, as MAVLink 1 frames.
+	uint32_t sentBytes;
+} SimMessage;
+
+enum { SIM_WSO100, SIM_DST800, SIM_RUDDER_RAW, SIM_MAIN_POWER, SIM_NODE_STATUS, SIM_MESSAGES };
+
+static const char *const simNames[SIM_MESSAGES] = {"WSO100", "DST800", "RUDDER_RAW", "MAIN_POWER", "NODE_STATUS"};
+
+static void SimSend(SimMessage *m, const void *payload, uint32_t now)
+{
+	const uint16_t size = m->filter.Length + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+	++m->frames;
+	m->bytes += size;
+	if (ChangeFilterCheck(&m->filter, payload, now)) {
+		ChangeFilterSent(&m->filter, payload, now);
+		m->sentBytes += size;
+	}
+}
+
+/**
+ * Runs an hour of groundstation telemetry, with the sensors either sitting still at the dock, where
+ * only their noise changes, or with the boat underway, where the wind shifts and the rudder works.
+ */
+static void SimulateHour(const char *name, bool underway)
+{
+	SimMessage m[SIM_MESSAGES] = {{.rate = 1}, {.rate = 1}, {.rate = 1}, {.rate = 2}, {.rate = 1}};
+	mavlink_wso100_t wso100;
+	mavlink_dst800_t dst800;
+	mavlink_rudder_raw_t rudderRaw = {.port_limit_val = 120, .starboard_limit_val = 900};
+	mavlink_main_power_t mainPower;
+	mavlink_node_status_t nodeStatus = {.primary_status = 0x0001, .rc_status = 0x0003};
+	double windDirection = 1.0, depth = 4.0, rudder = 510, battery = 12.8;
+	uint32_t now;
+	uint8_t i;
+
+	assert(ChangeFilterInit(&m[SIM_WSO100].filter, &wso100Info, wso100Deadbands, MAX_INTERVAL));
+	assert(ChangeFilterInit(&m[SIM_DST800].filter, &dst800Info, dst800Deadbands, MAX_INTERVAL));
+	assert(ChangeFilterInit(&m[SIM_RUDDER_RAW].filter, &rudderRawInfo, rudderRawDeadbands, MAX_INTERVAL));
+	assert(ChangeFilterInit(&m[SIM_MAIN_POWER].filter, &mainPowerInfo, mainPowerDeadbands, MAX_INTERVAL));
+	assert(ChangeFilterInit(&m[SIM_NODE_STATUS].filter, &nodeStatusInfo, nodeStatusDeadbands, MAX_INTERVAL));
+
+	srand(1);
+	for (now = 0; now < HOUR; ++now) {
+		// The sensors update at their own rates, so their values are kept up to date every tick and
+		// only sampled when the schedule sends them.
+		if (underway) {
+			windDirection += Noise(0.002);
+			depth += Noise(0.01);
+			if (depth < 2) {
+				depth = 2;
+			}
+			rudder = 510 + 150 * sin(now * 2 * M_PI / (20 * RATE)) + Noise(3);
+		} else {
+			rudder = 510 + Noise(1.5);
+		}
+		battery -= 0.5 / HOUR;
+
+		if (now % (RATE / m[SIM_WSO100].rate) == 0) {
+			wso100 = (mavlink_wso100_t){
+				.speed = (underway ? 6.0 : 3.0) + Noise(underway ? 1.0 : 0.1),
+				.direction = windDirection + Noise(0.02),
+				.temperature = 18.0 + Noise(0.05),
+				.pressure = 101325 + Noise(5),
+				.humidity = 70 + Noise(0.4)
+			};
+			SimSend(&m[SIM_WSO100], &wso100, now);
+		}
+		if (now % (RATE / m[SIM_DST800].rate) == 0) {
+			dst800 = (mavlink_dst800_t){
+				.speed = underway ? 2.0 + Noise(0.1) : 0,
+				.temperature = 12.0 + Noise(0.1),
+				.depth = depth + Noise(0.05)
+			};
+			SimSend(&m[SIM_DST800], &dst800, now);
+		}
+		if (now % (RATE / m[SIM_RUDDER_RAW].rate) == 0) {
+			rudderRaw.raw_position = (uint16_t)rudder;
+			SimSend(&m[SIM_RUDDER_RAW], &rudderRaw, now);
+		}
+		if (now % (RATE / m[SIM_MAIN_POWER].rate) == 0) {
+			mainPower = (mavlink_main_power_t){
+				.electronics_voltage = (uint16_t)(battery * 1000 + Noise(20)),
+				.electronics_current = (uint16_t)((underway ? 1500 : 600) + Noise(30)),
+				.actuator_voltage = (uint16_t)(2 * battery * 1000 + Noise(20)),
+				.actuator_current = (uint16_t)(underway ? 8000 + Noise(1000) : 0)
+			};
+			SimSend(&m[SIM_MAIN_POWER], &mainPower, now);
+		}
+		if (now % (RATE / m[SIM_NODE_STATUS].rate) == 0) {
+			// Loads jump around by a percent, everything else holds steady.
+			nodeStatus.primary_load = 40 + rand() % 2;
+			nodeStatus.rudder_load = underway ? 20 + rand() % 3 : 5;
+			nodeStatus.primary_temp = 30;
+			nodeStatus.primary_voltage = (uint8_t)(battery * 10);
+			SimSend(&m[SIM_NODE_STATUS], &nodeStatus, now);
+		}
+	}
+
+	uint32_t bytes = 0, sentBytes = 0;
+	printf("\n%s, an hour with a %ds keep-alive:\n", name, MAX_INTERVAL / RATE);
+	printf("  %-12s %8s %8s %10s %10s %7s\n", "Message", "Frames", "Sent", "Bytes", "Sent B", "Saved");
+	for (i = 0; i < SIM_MESSAGES; ++i) {
+		printf("  %-12s %8u %8u %10u %10u %6.1f%%\n", simNames[i], m[i].frames, m[i].filter.Sent, m[i].bytes,
+		       m[i].sentBytes, 100.0 * (m[i].bytes - m[i].sentBytes) / m[i].bytes);
+		assert(m[i].filter.Sent + m[i].filter.Suppressed == m[i].frames);
+		// Never quieter than the keep-alive.
+		assert(m[i].filter.Sent >= HOUR / MAX_INTERVAL);
+		bytes += m[i].bytes;
+		sentBytes += m[i].sentBytes;
+	}
+	printf("  %-12s %8s %8s %10u %10u %6.1f%%, %.1f B/s freed\n", "Total", "", "", bytes, sentBytes,
+	       100.0 * (bytes - sentBytes) / bytes, (double)(bytes - sentBytes) / (HOUR / RATE));
+}
+
+int main(void)
+{
+	TestDeadband();
+	TestKeepAlive();
+	SimulateHour("Docked", false);
+	SimulateHour("Underway", true);
+	printf("\nAll tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_CHANGE_FILTER
@@ -0,0 +1,72 @@
+/**
+ * @file   ChangeFilter.h
+ * @brief  Skips transmissions of telemetry messages whose contents didn't change.
+ *
+ * Much of the telemetry sent on a fixed schedule, like sensor readings that sit still while the boat
+ * is docked or node status that only changes on a fault, repeats the same contents over and over. A
+ * ChangeFilter compares every message it's given to the one it last sent, field by field:
+ *  * Every field can have a deadband, in the units of that field. It only counts as changed once it
+ *    moved further than that from the value that was last sent, so slow drift is still sent
+ *    eventually while noise isn't. Fields without a deadband count as changed on any difference, and
+ *    so do character fields, fields wider than 32 bits, and floats that became or stopped being NaN.
+ *  * A message is sent anyway once `MaxInterval` passed since the last one, so receivers can tell a
+ *    silent link from an unchanging value.
+ *
+ * The caller measures time in whatever unit it likes, and tells the filter when a message actually
+ * went out with ChangeFilterSent(), so a message that couldn't be queued is tried again next time.
+ *
+ * Unit testing, which includes a simulation of the bandwidth saved on the groundstation sensor
+ * messages over an hour at the dock and an hour underway, is done on x86 by compiling with the
+ * UNIT_TEST_CHANGE_FILTER macro:
+ * `gcc ChangeFilter.c -DUNIT_TEST_CHANGE_FILTER -I../MAVLink/seaslug -O2 -Wall -lm`
+ * Recorded runs are replayed through the groundstation's filters with Scripts/C/TelemetryReplay.c.
+ */
+#ifndef CHANGE_FILTER_H
+#define CHANGE_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <mavlink.h>
+
+// The largest payload that can be filtered, in bytes.
+#define CHANGE_FILTER_MAX_PAYLOAD_LEN 48
+
+/**
+ * The filter of a single message type. Initialize with ChangeFilterInit().
+ */
+typedef struct {
+	const mavlink_message_info_t *Info;
+	const float *Deadbands; // One per field of Info, in its order, or NULL to send on any change.
+	uint8_t Length;         // The size of the payload in bytes.
+	uint16_t MaxInterval;   // The longest time between two transmissions.
+	uint32_t LastSentAt;
+	bool Primed;            // Whether Last holds a message that was sent.
+	uint8_t Last[CHANGE_FILTER_MAX_PAYLOAD_LEN];
+	uint32_t Sent;          // Messages sent.
+	uint32_t Suppressed;    // Messages skipped as unchanged.
+} ChangeFilter;
+
+/**
+ * Sets up a filter that lets the first message through.
+ * @param info The MAVLink field information of the message, MAVLINK_MESSAGE_INFO_*.
+ * @param deadbands One per field of `info`, in its order. NULL to send on any change.
+ * @param maxInterval The longest time between two transmissions, in the unit of `now` below.
+ * @return False if the payload is larger than CHANGE_FILTER_MAX_PAYLOAD_LEN.
+ */
+bool ChangeFilterInit(ChangeFilter *f, const mavlink_message_info_t *info, const float *deadbands, uint16_t maxInterval);
+
+/**
+ * Decides whether a message should be sent. Skipped messages are counted as suppressed.
+ * @param payload The message's payload, generally a mavlink_*_t struct.
+ * @param now The current time.
+ * @return True if a field changed beyond its deadband, or `MaxInterval` passed since the last message.
+ */
+bool ChangeFilterCheck(ChangeFilter *f, const void *payload, uint32_t now);
+
+/**
+ * Records that a message was sent, after ChangeFilterCheck() allowed it.
+ */
+void ChangeFilterSent(ChangeFilter *f, const void *payload, uint32_t now);
+
+#endif // CHANGE_FILTER_H
@@ -34,6 +34,73 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+/**
+ * Advance the index `i` by `n` bytes, wrapping around the end of the buffer. `n` must be no larger
+ * than the buffer size. Power-of-two buffers wrap with a mask, all others with a single subtraction.
+ */
+static inline uint16_t CB_Advance(const CircularBuffer *b, uint16_t i, uint16_t n)
+{
+	if (b->mask) {
+		return (uint16_t)((i + n) & b->mask);
+	} else {
+		uint32_t x = (uint32_t)i + n;
+		if (x >= b->staticSize) {
+			x -= b->staticSize;
+		}
+		return (uint16_t)x;
+	}
+}
+
+// Transfers shorter than this are copied with a plain loop, as the call overhead of memcpy()
+// dominates for them.
+#define CB_SHORT_COPY 8
+
+/**
+ * Copy a contiguous block of `n` bytes.
+ */
+static inline void CB_Copy(uint8_t *dst, const uint8_t *src, uint16_t n)
+{
+	if (n == 1) {
+		*dst = *src;
+	} else if (n < CB_SHORT_COPY) {
+		while (n--) {
+			*dst++ = *src++;
+		}
+	} else {
+		memcpy(dst, src, n);
+	}
+}
+
+/**
+ * Copy `size` bytes starting at index `start` out of the buffer. This is done with at most two
+ * block copies, one on either side of the wrap-around point.
+ */
+static void CB_CopyOut(const CircularBuffer *b, uint16_t start, uint8_t *outData, uint16_t size)
+{
+	const uint16_t firstChunk = b->staticSize - start;
+	if (size <= firstChunk) {
+		CB_Copy(outData, &b->data[start], size);
+	} else {
+		CB_Copy(outData, &b->data[start], firstChunk);
+		CB_Copy(&outData[firstChunk], b->data, size - firstChunk);
+	}
+}
+
+/**
+ * Copy `size` bytes into the buffer starting at index `start`. The inverse of CB_CopyOut().
+ */
+static void CB_CopyIn(CircularBuffer *b, uint16_t start, const uint8_t *inData, uint16_t size)
+{
+	const uint16_t firstChunk = b->staticSize - start;
+	if (size <= firstChunk) {
+		CB_Copy(&b->data[start], inData, size);
+	} else {
+		CB_Copy(&b->data[start], inData, firstChunk);
+		CB_Copy(b->data, &inData[firstChunk], size - firstChunk);
+	}
+}
 
 int CB_Init(CircularBuffer *b, uint8_t *buffer, const uint16_t size)
 {
@@ -50,10 +117,7 @@ int CB_Init(CircularBuffer *b, uint8_t *buffer, const uint16_t size)
 	// Store the buffer pointer and initialize it all to zero.
 	// This is not necessary, but makes debugging easier.
 	b->data = buffer;
-	uint16_t i;
-	for (i = 0; i < size; ++i) {
-		b->data[i] = 0;
-	}
+	memset(b->data, 0, size);
 
 	// Initialize all variables. The only one of note is `empty`, which is initialized to true.
 	b->readIndex = 0;
@@ -62,6 +126,9 @@ int CB_Init(CircularBuffer *b, uint8_t *buffer, const uint16_t size)
 	b->dataSize = 0;
 	b->overflowCount = 0;
 
+	// Power-of-two buffers get to use a mask for wrapping their indices.
+	b->mask = ((size & (size - 1)) == 0) ? size - 1 : 0;
+
 	return true;
 }
 
@@ -71,14 +138,8 @@ int CB_ReadByte(CircularBuffer *b, uint8_t *outData)
 		if (b->dataSize) {
 			// Copies the last element from the buffer to data
 			*outData = b->data[b->readIndex];
-			// Sets the buffer empty if there was only one element in it
-			if (b->dataSize == 1) {
-				// Checks for wrap around
-				b->readIndex = b->readIndex < (b->staticSize - 1)?b->readIndex + 1:0;
-			} else {
-				// Checks for wrap around and moves indicies
-				b->readIndex = b->readIndex < (b->staticSize - 1)?b->readIndex + 1:0;
-			}
+			// Checks for wrap around and moves indicies
+			b->readIndex = CB_Advance(b, b->readIndex, 1);
 			--b->dataSize;
 			return true;
 		}
@@ -88,24 +149,12 @@ int CB_ReadByte(CircularBuffer *b, uint8_t *outData)
 
 int CB_ReadMany(CircularBuffer *b, void *outData, uint16_t size)
 {
-	int16_t i;
 	if (b && outData) {
-		// Cast data so that it can be used to ready bytes
-		uint8_t *data_u = (uint8_t*)outData;
 		// Check if there are enough items in the buffer to read
 		if (b->dataSize >= size) {
-
-			// And read the data.
-			for (i = 0; i < size; ++i) {
-				data_u[i] = b->data[b->readIndex];
-
-				// Update the readIndex taking into account wrap-around.
-				if (b->readIndex < b->staticSize - 1) {
-					++b->readIndex;
-				} else {
-					b->readIndex = 0;
-				}
-			}
+			// Read the data in at most two chunks and then update the readIndex.
+			CB_CopyOut(b, b->readIndex, (uint8_t*)outData, size);
+			b->readIndex = CB_Advance(b, b->readIndex, size);
 			b->dataSize -= size;
 			return true;
 		}
@@ -123,7 +172,7 @@ int CB_WriteByte(CircularBuffer *b, uint8_t inData)
 		} else {
 			b->data[b->writeIndex] = inData;
 			// Now update the writeIndex taking into account wrap-around.
-			b->writeIndex = b->writeIndex < (b->staticSize - 1) ? b->writeIndex + 1: 0;
+			b->writeIndex = CB_Advance(b, b->writeIndex, 1);
 			++b->dataSize;
 			return true;
 		}
@@ -134,44 +183,28 @@ int CB_WriteByte(CircularBuffer *b, uint8_t inData)
 int CB_WriteMany(CircularBuffer *b, const void *inData, uint16_t size, bool failEarly)
 {
 	if (b && inData) {
-		uint8_t *data_u = (uint8_t*)inData;
-		// If the fail early value is set
-		if (failEarly) {
-			// Checks to make sure there is enough space
-			if (b->staticSize - b->dataSize < size) {
+		const uint16_t space = b->staticSize - b->dataSize;
+		uint16_t toWrite = size;
+
+		// Check that there's enough space for everything. If not, either bail out now or write as
+		// much data as we can and record the rest as overflow.
+		if (space < size) {
+			if (failEarly) {
 				return false;
-			} else {
-				int i = 0;
-				//runs size times
-				while (i < size) {
-					//writes to the buffer
-					b->data[b->writeIndex] = data_u[i];
-					++i;
-					//checks for wrap around and moves the indicies
-					b->writeIndex = b->writeIndex < (b->staticSize - 1) ? b->writeIndex + 1: 0;
-				}
-				b->dataSize += i;
-				return true;
 			}
+			toWrite = space;
 		}
-		// Otherwise we try and write as much data as we can.
-		else {
-			int i = 0;
-			while (i < size) {
-				// If the buffer is full the overflow count is increased and false is returned
-				if (b->dataSize == b->staticSize) {
-					b->overflowCount += (size - i);
-					return false;
-				}
-				// Reads an element from the buffer to data
-				b->data[b->writeIndex] = data_u[i];
-				++i;
-				++b->dataSize;
-				// Move the indicies and check for wrap around
-				b->writeIndex = (b->writeIndex < (b->staticSize - 1)) ? b->writeIndex + 1: 0;
-			}
-			return true;
+
+		// Write the data in at most two chunks and update the writeIndex.
+		CB_CopyIn(b, b->writeIndex, (const uint8_t*)inData, toWrite);
+		b->writeIndex = CB_Advance(b, b->writeIndex, toWrite);
+		b->dataSize += toWrite;
+
+		if (toWrite < size) {
+			b->overflowCount += (size - toWrite);
+			return false;
 		}
+		return true;
 	}
 	return false;
 }
@@ -189,24 +222,10 @@ int CB_Peek(const CircularBuffer *b, uint8_t *outData)
 
 int CB_PeekMany (const CircularBuffer *b, void *outData, uint16_t size)
 {
-	uint16_t i;
-	int tmpHead;
-
 	if (b) {
-		uint8_t *data_u = (uint8_t*)outData;
-		// Make sure there's enough data to read off and read them off one-by-one.
+		// Make sure there's enough data to read off and copy it out without touching readIndex.
 		if (b->dataSize >= size) {
-			tmpHead = b->readIndex;
-			for (i = 0; i < size; ++i) {
-				data_u[i] = b->data[tmpHead];
-
-				// Handle wrapping around the buffer.
-				if (tmpHead < b->staticSize - 1) {
-					++tmpHead;
-				} else {
-					tmpHead = 0;
-				}
-			}
+			CB_CopyOut(b, b->readIndex, (uint8_t*)outData, size);
 			return true;
 		}
 	}
@@ -216,13 +235,7 @@ int CB_PeekMany (const CircularBuffer *b, void *outData, uint16_t size)
 int CB_Remove(CircularBuffer *b, uint16_t size){
 	// If there are more elements in the buffer.
 	if (b->dataSize > size) {
-		// Checks to see if the buffer will wrap around.
-		if ((b->staticSize - b->readIndex) < size) {
-			b-> readIndex = size - (b->staticSize - b->readIndex);
-		} else {
-			// If the buffer will not wrap around size is added to read index.
-			b->readIndex = b->readIndex + size;
-		}
+		b->readIndex = CB_Advance(b, b->readIndex, size);
 		b->dataSize -= size;
 		return true;
 	}
@@ -234,6 +247,62 @@ int CB_Remove(CircularBuffer *b, uint16_t size){
 	}
 }
 
+/**
+ * Describe the `size` bytes starting at index `start` as at most two spans.
+ */
+static void CB_FillSpans(const CircularBuffer *b, uint16_t start, uint16_t size, CircularBufferSpans *spans)
+{
+	const uint16_t firstChunk = b->staticSize - start;
+	spans->data[0] = &b->data[start];
+	spans->data[1] = b->data;
+	if (size <= firstChunk) {
+		spans->length[0] = size;
+		spans->length[1] = 0;
+	} else {
+		spans->length[0] = firstChunk;
+		spans->length[1] = size - firstChunk;
+	}
+}
+
+uint16_t CB_GetReadSpans(const CircularBuffer *b, CircularBufferSpans *spans)
+{
+	if (b && spans) {
+		CB_FillSpans(b, b->readIndex, b->dataSize, spans);
+		return b->dataSize;
+	}
+	return 0;
+}
+
+int CB_CommitRead(CircularBuffer *b, uint16_t size)
+{
+	if (b && size <= b->dataSize) {
+		b->readIndex = CB_Advance(b, b->readIndex, size);
+		b->dataSize -= size;
+		return true;
+	}
+	return false;
+}
+
+uint16_t CB_GetWriteSpans(CircularBuffer *b, CircularBufferSpans *spans)
+{
+	if (b && spans) {
+		const uint16_t space = b->staticSize - b->dataSize;
+		CB_FillSpans(b, b->writeIndex, space, spans);
+		return space;
+	}
+	return 0;
+}
+
+int CB_CommitWrite(CircularBuffer *b, uint16_t size)
+{
+	if (b && size <= b->staticSize - b->dataSize) {
+		b->writeIndex = CB_Advance(b, b->writeIndex, size);
+		b->dataSize += size;
+		return true;
+	}
+	return false;
+}
+
 /**
  * This begins the unit testing code. Directions for compilation are at the top of the header file.
  */
@@ -242,6 +311,7 @@ int CB_Remove(CircularBuffer *b, uint16_t size){
 #include <string.h>
 #include <stdio.h>
 #include <assert.h>
+#include <time.h>
 
 /**
  * @brief A struct used for testing.
@@ -264,6 +334,294 @@ int TestStructEqual(const TestStruct *a, const TestStruct *b)
 	        a->bar == b->bar);
 }
 
+/**
+ * The original byte-at-a-time implementations of the bulk transfer functions. These are kept here
+ * only as a baseline for BenchmarkCircularBuffer().
+ */
+int CB_ReadManyBytewise(CircularBuffer *b, void *outData, uint16_t size)
+{
+	uint16_t i;
+	if (b && outData) {
+		uint8_t *data_u = (uint8_t*)outData;
+		if (b->dataSize >= size) {
+			for (i = 0; i < size; ++i) {
+				data_u[i] = b->data[b->readIndex];
+				if (b->readIndex < b->staticSize - 1) {
+					++b->readIndex;
+				} else {
+					b->readIndex = 0;
+				}
+			}
+			b->dataSize -= size;
+			return true;
+		}
+	}
+	return false;
+}
+
+int CB_WriteManyBytewise(CircularBuffer *b, const void *inData, uint16_t size)
+{
+	if (b && inData) {
+		const uint8_t *data_u = (const uint8_t*)inData;
+		if (b->staticSize - b->dataSize < size) {
+			return false;
+		} else {
+			uint16_t i = 0;
+			while (i < size) {
+				b->data[b->writeIndex] = data_u[i];
+				++i;
+				b->writeIndex = b->writeIndex < (b->staticSize - 1) ? b->writeIndex + 1: 0;
+			}
+			b->dataSize += i;
+			return true;
+		}
+	}
+	return false;
+}
+
+int CB_PeekManyBytewise(const CircularBuffer *b, void *outData, uint16_t size)
+{
+	uint16_t i;
+	uint16_t tmpHead;
+	if (b) {
+		uint8_t *data_u = (uint8_t*)outData;
+		if (b->dataSize >= size) {
+			tmpHead = b->readIndex;
+			for (i = 0; i < size; ++i) {
+				data_u[i] = b->data[tmpHead];
+				if (tmpHead < b->staticSize - 1) {
+					++tmpHead;
+				} else {
+					tmpHead = 0;
+				}
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Measure the throughput of writing, peeking, and reading `length`-byte chunks through a buffer of
+ * `size` bytes. Returns the MB/s achieved. If `bytewise` is true the original implementations are
+ * used instead.
+ */
+static double BenchmarkTransfer(uint16_t size, uint16_t length, bool bytewise)
+{
+	CircularBuffer b;
+	uint8_t *storage = (uint8_t*)malloc(size);
+	uint8_t chunk[1024];
+	memset(chunk, 0xA5, sizeof(chunk));
+	CB_Init(&b, storage, size);
+
+	// Start off with the buffer part-full so that transfers straddle the wrap-around point.
+	CB_WriteMany(&b, chunk, size / 3, true);
+
+	const uint32_t totalBytes = 64UL * 1024UL * 1024UL;
+	const uint32_t iterations = totalBytes / length;
+	uint32_t i;
+	clock_t start = clock();
+	for (i = 0; i < iterations; ++i) {
+		if (bytewise) {
+			CB_WriteManyBytewise(&b, chunk, length);
+			CB_PeekManyBytewise(&b, chunk, length);
+			CB_ReadManyBytewise(&b, chunk, length);
+		} else {
+			CB_WriteMany(&b, chunk, length, true);
+			CB_PeekMany(&b, chunk, length);
+			CB_ReadMany(&b, chunk, length);
+		}
+	}
+	clock_t end = clock();
+	free(storage);
+
+	// Make sure the compiler can't throw the loop away.
+	assert(chunk[0] == 0xA5);
+
+	double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+	if (seconds <= 0.0) {
+		seconds = 1.0 / CLOCKS_PER_SEC;
+	}
+	return ((double)iterations * length) / seconds / 1e6;
+}
+
+/**
+ * A small framed-packet parser used to benchmark in-place parsing. Packets are STX (0xFE), a length
+ * byte, the payload, and a two-byte X.25 CRC, which is roughly what mavlink_parse_char() does per
+ * byte. Returns true when a packet with a valid CRC has been completed.
+ */
+typedef struct {
+	uint8_t state;
+	uint8_t length;
+	uint8_t count;
+	uint16_t crc;
+	uint16_t rxCrc;
+} TestParser;
+
+static bool TestParse(TestParser *p, uint8_t c)
+{
+	switch (p->state) {
+	case 0:
+		if (c == 0xFE) {
+			p->state = 1;
+			p->crc = 0xFFFF;
+		}
+		break;
+	case 1:
+		p->length = c;
+		p->count = 0;
+		p->state = c ? 2 : 3;
+		break;
+	case 2:
+	{
+		uint8_t tmp = c ^ (uint8_t)(p->crc & 0xFF);
+		tmp ^= (tmp << 4);
+		p->crc = (p->crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+		if (++p->count == p->length) {
+			p->state = 3;
+		}
+		break;
+	}
+	case 3:
+		p->rxCrc = c;
+		p->state = 4;
+		break;
+	default:
+		p->rxCrc |= (uint16_t)c << 8;
+		p->state = 0;
+		return p->rxCrc == p->crc;
+	}
+	return false;
+}
+
+/**
+ * Fill `out` with back-to-back packets of the given payload length. Returns the number of bytes.
+ */
+static uint16_t MakeTestPackets(uint8_t *out, uint16_t maxLength, uint8_t payloadLength)
+{
+	uint16_t n = 0;
+	while (n + payloadLength + 4 <= maxLength) {
+		TestParser p = {0};
+		uint8_t i;
+		p.crc = 0xFFFF;
+		out[n++] = 0xFE;
+		out[n++] = payloadLength;
+		for (i = 0; i < payloadLength; ++i) {
+			out[n] = (uint8_t)(n * 31);
+			p.state = 2;
+			p.length = 0;
+			TestParse(&p, out[n++]);
+		}
+		out[n++] = (uint8_t)p.crc;
+		out[n++] = (uint8_t)(p.crc >> 8);
+	}
+	return n;
+}
+
+/**
+ * Compare parsing a stream byte-by-byte through CB_ReadByte() against parsing it in place through
+ * CB_GetReadSpans()/CB_CommitRead(). Each iteration models a main-loop pass: a chunk of `burst`
+ * bytes arrives and is then fully parsed. Prints MB/s for both and checks they found the same
+ * packets.
+ */
+static void BenchmarkParse(uint16_t size, uint16_t burst, uint8_t payloadLength)
+{
+	CircularBuffer b;
+	uint8_t *storage = (uint8_t*)malloc(size);
+	uint8_t stream[1024];
+	const uint16_t streamLength = MakeTestPackets(stream, sizeof(stream), payloadLength);
+	const uint32_t totalBytes = 32UL * 1024UL * 1024UL;
+	uint32_t packets[2] = {0, 0};
+	double rates[2];
+	int mode;
+
+	for (mode = 0; mode < 2; ++mode) {
+		TestParser p = {0};
+		uint32_t processed = 0;
+		uint16_t offset = 0;
+		CB_Init(&b, storage, size);
+		clock_t start = clock();
+		while (processed < totalBytes) {
+			// Simulate the arrival of `burst` bytes of the stream.
+			uint16_t remaining = burst;
+			while (remaining) {
+				uint16_t n = streamLength - offset;
+				if (n > remaining) {
+					n = remaining;
+				}
+				CB_WriteMany(&b, &stream[offset], n, true);
+				offset = (offset + n) % streamLength;
+				remaining -= n;
+			}
+
+			if (mode == 0) {
+				uint8_t c;
+				while (CB_ReadByte(&b, &c)) {
+					packets[mode] += TestParse(&p, c);
+				}
+			} else {
+				CircularBufferSpans spans;
+				uint16_t total = CB_GetReadSpans(&b, &spans);
+				uint8_t i;
+				for (i = 0; i < 2; ++i) {
+					const uint8_t *d = spans.data[i];
+					uint16_t j;
+					for (j = 0; j < spans.length[i]; ++j) {
+						packets[mode] += TestParse(&p, d[j]);
+					}
+				}
+				CB_CommitRead(&b, total);
+			}
+			processed += burst;
+		}
+		double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+		if (seconds <= 0.0) {
+			seconds = 1.0 / CLOCKS_PER_SEC;
+		}
+		rates[mode] = processed / seconds / 1e6;
+	}
+	free(storage);
+
+	assert(packets[0] == packets[1] && packets[0] > 0);
+	printf("%5u | %5u | %7u | %8.1f | %7.1f | %6.2fx\n", size, burst, payloadLength, rates[0], rates[1], rates[1] / rates[0]);
+}
+
+/**
+ * Compare the throughput of the original bytewise transfers with the block-copy engine across a
+ * number of buffer sizes (both power-of-two and not) and transfer lengths. The transfer lengths are
+ * chosen to represent single bytes, a CAN payload, a CanMessage on the dsPIC, a typical MAVLink
+ * message, and a maximum-size MAVLink message.
+ */
+void BenchmarkCircularBuffer(void)
+{
+	const uint16_t sizes[] = {192, 256, 1000, 1024};
+	const uint16_t lengths[] = {1, 8, 18, 64, 263};
+	uint8_t i, j;
+
+	puts("\nThroughput (MB/s) of write+peek+read, bytewise vs. block copy:");
+	puts(" size | length | bytewise |  block  | speedup");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+		for (j = 0; j < sizeof(lengths) / sizeof(lengths[0]); ++j) {
+			if (lengths[j] > sizes[i] / 2) {
+				continue;
+			}
+			double oldRate = BenchmarkTransfer(sizes[i], lengths[j], true);
+			double newRate = BenchmarkTransfer(sizes[i], lengths[j], false);
+			printf("%5u | %6u | %8.1f | %7.1f | %6.2fx\n", sizes[i], lengths[j], oldRate, newRate, newRate / oldRate);
+		}
+	}
+
+	// Bursts correspond to what arrives in 10ms at 115200 baud (~115 bytes) and 57600 baud, as well
+	// as a mostly-full buffer after a slow main-loop pass.
+	puts("\nParse throughput (MB/s), CB_ReadByte() vs. in-place spans:");
+	puts(" size | burst | payload |  per-byte |  spans  | speedup");
+	BenchmarkParse(1024, 58, 9);
+	BenchmarkParse(1024, 115, 9);
+	BenchmarkParse(1024, 115, 36);
+	BenchmarkParse(1024, 900, 36);
+	BenchmarkParse(1000, 115, 36);
+}
+
 /**
  * @brief Run various unit tests confirming proper operation of the CircularBuffer.
  *
@@ -273,6 +631,7 @@ int TestStructEqual(const TestStruct *a, const TestStruct *b)
  * $ a.out
  * Running unit tests.
  * All tests passed.
+ * (benchmark table)
  * $
  */
 int main()
@@ -917,8 +1276,183 @@ int main()
             assert(!memcmp(testIn, testOut, 20));
         }
 
+	/* This tests the block-copy paths across the wrap-around point for both power-of-two and
+	non-power-of-two buffers, checking against a simple reference model.
+	*/
+	{
+		const uint16_t sizes[] = {2, 3, 16, 30, 64, 100, 256};
+		uint16_t s;
+		for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+			CircularBuffer b;
+			uint8_t storage[256];
+			assert(CB_Init(&b, storage, sizes[s]));
+			assert(b.mask == (((sizes[s] & (sizes[s] - 1)) == 0) ? sizes[s] - 1 : 0));
+
+			// Push and pop a variety of transfer lengths so that every offset gets wrapped over.
+			uint8_t in[256], out[256];
+			uint8_t next = 0, expected = 0;
+			int k;
+			for (k = 0; k < 2000; ++k) {
+				uint16_t len = (uint16_t)((k * 7) % sizes[s]) + 1;
+				uint16_t j;
+				for (j = 0; j < len; ++j) {
+					in[j] = next + j;
+				}
+				if (b.staticSize - b.dataSize >= len) {
+					assert(CB_WriteMany(&b, in, len, true));
+					next += len;
+				} else {
+					assert(!CB_WriteMany(&b, in, len, true));
+				}
+
+				uint16_t rlen = (uint16_t)((k * 5) % sizes[s]) + 1;
+				if (b.dataSize >= rlen) {
+					assert(CB_PeekMany(&b, out, rlen));
+					uint8_t peeked[256];
+					memcpy(peeked, out, rlen);
+					assert(CB_ReadMany(&b, out, rlen));
+					assert(!memcmp(peeked, out, rlen));
+					for (j = 0; j < rlen; ++j) {
+						assert(out[j] == (uint8_t)(expected + j));
+					}
+					expected += rlen;
+				} else {
+					assert(!CB_ReadMany(&b, out, rlen));
+				}
+				assert(b.readIndex < b.staticSize && b.writeIndex < b.staticSize);
+			}
+
+			// And confirm that a partial write across the wrap point fills the buffer exactly.
+			CB_Remove(&b, b.staticSize);
+			assert(!CB_WriteMany(&b, in, b.staticSize + 3, false));
+			assert(b.dataSize == b.staticSize);
+			assert(b.overflowCount == 3);
+			assert(CB_ReadMany(&b, out, b.staticSize));
+			assert(!memcmp(in, out, b.staticSize));
+		}
+	}
+
+	/* This tests CB_Remove() landing exactly on the end of the backing array.
+	*/
+	{
+		CircularBuffer b;
+		uint8_t storage[20];
+		uint8_t d;
+		CB_Init(&b, storage, 20);
+		uint8_t in[20] = {0};
+		CB_WriteMany(&b, in, 7, true);
+		CB_Remove(&b, 7);
+		CB_WriteMany(&b, in, 14, true);
+		assert(CB_Remove(&b, 13));
+		assert(b.readIndex == 0);
+		assert(b.dataSize == 1);
+		assert(CB_ReadByte(&b, &d));
+		assert(b.dataSize == 0);
+	}
+
+	/* This tests the zero-copy span interface, both for a region that fits before the end of the
+	backing array and one that wraps around it.
+	*/
+	{
+		CircularBuffer b;
+		CircularBufferSpans spans;
+		uint8_t storage[10];
+		uint8_t in[10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+		uint8_t out[10];
+		CB_Init(&b, storage, 10);
+
+		assert(CB_GetReadSpans(NULL, &spans) == 0);
+		assert(CB_GetReadSpans(&b, NULL) == 0);
+		assert(CB_GetReadSpans(&b, &spans) == 0);
+		assert(spans.length[0] == 0 && spans.length[1] == 0);
+		assert(!CB_CommitRead(&b, 1));
+
+		// An empty buffer exposes all of its space as a single span.
+		assert(CB_GetWriteSpans(&b, &spans) == 10);
+		assert(spans.data[0] == storage && spans.length[0] == 10 && spans.length[1] == 0);
+
+		// Fill 6 bytes in place, then read 4 of them in place.
+		memcpy(spans.data[0], in, 6);
+		assert(!CB_CommitWrite(&b, 11));
+		assert(CB_CommitWrite(&b, 6));
+		assert(b.dataSize == 6 && b.writeIndex == 6);
+		assert(CB_GetReadSpans(&b, &spans) == 6);
+		assert(spans.data[0] == storage && spans.length[0] == 6 && spans.length[1] == 0);
+		assert(CB_CommitRead(&b, 4));
+		assert(b.readIndex == 4 && b.dataSize == 2);
+
+		// The free space now wraps: 4 bytes at the end and 4 at the start.
+		assert(CB_GetWriteSpans(&b, &spans) == 8);
+		assert(spans.data[0] == &storage[6] && spans.length[0] == 4);
+		assert(spans.data[1] == storage && spans.length[1] == 4);
+		memcpy(spans.data[0], &in[6], 4);
+		memcpy(spans.data[1], in, 3);
+		assert(CB_CommitWrite(&b, 7));
+		assert(b.dataSize == 9 && b.writeIndex == 3);
+
+		// And so does the readable data.
+		assert(CB_GetReadSpans(&b, &spans) == 9);
+		assert(spans.data[0] == &storage[4] && spans.length[0] == 6);
+		assert(spans.data[1] == storage && spans.length[1] == 3);
+		assert(CB_ReadMany(&b, out, 9));
+		assert(out[0] == 5 && out[1] == 6 && out[2] == 7 && out[5] == 10 && out[6] == 1 && out[8] == 3);
+		assert(!CB_CommitRead(&b, 1));
+
+		// A full buffer has no write spans.
+		CB_WriteMany(&b, in, 10, true);
+		assert(CB_GetWriteSpans(&b, &spans) == 0);
+		assert(spans.length[0] == 0 && spans.length[1] == 0);
+		assert(!CB_CommitWrite(&b, 1));
+		assert(CB_CommitRead(&b, 10));
+	}
+
+	/* This checks that parsing through spans finds exactly the same packets as parsing bytewise,
+	including packets straddling the wrap-around point.
+	*/
+	{
+		CircularBuffer a, c;
+		uint8_t sa[100], sc[100];
+		uint8_t stream[1000];
+		uint16_t streamLength = MakeTestPackets(stream, sizeof(stream), 17);
+		TestParser pa = {0}, pc = {0};
+		uint16_t found[2] = {0, 0};
+		uint16_t offset = 0;
+		int k;
+		CB_Init(&a, sa, sizeof(sa));
+		CB_Init(&c, sc, sizeof(sc));
+		for (k = 0; k < 500; ++k) {
+			uint16_t n = (uint16_t)((k * 13) % 60) + 1;
+			uint8_t d;
+			if (offset + n > streamLength) {
+				offset = 0;
+			}
+			assert(CB_WriteMany(&a, &stream[offset], n, true));
+			assert(CB_WriteMany(&c, &stream[offset], n, true));
+			offset += n;
+
+			while (CB_ReadByte(&a, &d)) {
+				found[0] += TestParse(&pa, d);
+			}
+
+			CircularBufferSpans spans;
+			uint16_t total = CB_GetReadSpans(&c, &spans);
+			uint16_t i, j;
+			assert(total == spans.length[0] + spans.length[1]);
+			for (i = 0; i < 2; ++i) {
+				for (j = 0; j < spans.length[i]; ++j) {
+					found[1] += TestParse(&pc, spans.data[i][j]);
+				}
+			}
+			assert(CB_CommitRead(&c, total));
+			assert(found[0] == found[1]);
+		}
+		assert(found[0] > 100);
+	}
+
 	printf("All tests passed.\n");
 
+	BenchmarkCircularBuffer();
+
 	return 0;
 
 }
@@ -28,6 +28,15 @@
  * Unit testing has been completed on x86 by compiling with the UNIT_TEST_CIRCULAR_BUFFER macro.
  * With gcc: `gcc CircularBuffer.c -DUNIT_TEST_CIRCULAR_BUFFER`
  *
+ * All multi-byte transfers (CB_ReadMany(), CB_WriteMany(), CB_PeekMany()) are performed as at most
+ * two block copies: one up to the end of the backing array and one from its start. Buffers whose
+ * size is a power of two additionally wrap their indices with a bitmask instead of a comparison, so
+ * prefer sizes like 256 or 1024 for high-throughput buffers.
+ *
+ * For parsing in place, CB_GetReadSpans() exposes all unread data as at most two contiguous spans
+ * which are then consumed with a single CB_CommitRead(). Producers can likewise fill the buffer
+ * directly through CB_GetWriteSpans() and publish the data with CB_CommitWrite().
+ *
  * Note that the Read/Write function calls are not threadsafe with the same CircularBuffer struct.
  * This means that calling CB_Read*()/CB_Write*() is not safe in interrupts if they can interrupt
  * calls to these same functions in regular code.
@@ -51,11 +60,24 @@ typedef struct {
 	uint16_t readIndex;    //!< Holds the index of the tail of the list. Always points to valid data when empty is false.
 	uint16_t writeIndex;   //!< Holds the index of the head of the list. Always points to empty space except when buffer is full.
 	uint16_t staticSize;   //!< Stores the static size of the buffer. The actual number of data bytes stored can be retrieved by CB_LENGTH() or CB_GetLength().
+	uint16_t mask;         //!< staticSize - 1 if staticSize is a power of two, otherwise 0. Used to wrap indices with a single AND.
 	uint16_t dataSize;     //!< The actual number of unread bytes in the buffer.
 	uint8_t overflowCount; //!< Tracks how many bytes have been attempted to be written while the buffer was full.
 	uint8_t *data;         //!< A pointer to the actual data managed by this buffer.
 } CircularBuffer;
 
+/**
+ * @brief A view of a region of a CircularBuffer as at most two contiguous spans.
+ *
+ * The first span always starts at the current read or write position. The second span is only
+ * non-empty if the region wraps around the end of the backing array, and then always starts at the
+ * beginning of it.
+ */
+typedef struct {
+	uint8_t *data[2];   //!< Pointers to the start of each span.
+	uint16_t length[2]; //!< The number of bytes in each span. length[1] is 0 if the region doesn't wrap.
+} CircularBufferSpans;
+
 /**
  * @brief CB_Init initializes the buffer.
  *
@@ -222,5 +244,66 @@ int CB_PeekMany(const CircularBuffer *b, void *outData, uint16_t size);
  */
 int CB_Remove(CircularBuffer *b, uint16_t size); 
 
+/**
+ * @brief CB_GetReadSpans() exposes the unread data in the buffer without copying it.
+ *
+ * All unread data is described by `spans` and the total number of bytes is returned. The data
+ * remains in the buffer until it is consumed with CB_CommitRead(), so a parser can run over the spans
+ * directly and then commit however many bytes it used. The spans stay valid until the next call that
+ * reads from the buffer; writes never touch them.
+ *
+ * Example:
+ * ```
+ * CircularBufferSpans s;
+ * uint16_t total = CB_GetReadSpans(&b, &s);
+ * for (i = 0; i < 2; ++i) {
+ *   for (j = 0; j < s.length[i]; ++j) {
+ *     Parse(s.data[i][j]);
+ *   }
+ * }
+ * CB_CommitRead(&b, total);
+ * ```
+ *
+ * @param b A pointer to the CircularBuffer struct.
+ * @param spans Filled with the readable region.
+ * @return The total number of readable bytes, 0 if `b` or `spans` is NULL.
+ */
+uint16_t CB_GetReadSpans(const CircularBuffer *b, CircularBufferSpans *spans);
+
+/**
+ * @brief CB_CommitRead() consumes bytes previously exposed by CB_GetReadSpans().
+ *
+ * Unlike CB_Remove() this fails, and does nothing, if `size` is larger than the amount of data in
+ * the buffer.
+ *
+ * @param b A pointer to the CircularBuffer struct.
+ * @param size The number of bytes to remove from the front of the buffer.
+ */
+int CB_CommitRead(CircularBuffer *b, uint16_t size);
+
+/**
+ * @brief CB_GetWriteSpans() exposes the free space in the buffer for filling in place.
+ *
+ * All free space is described by `spans` and its total size is returned. Nothing written into the
+ * spans becomes part of the buffer until CB_CommitWrite() is called, so a producer can format a
+ * packet straight into the ring and then commit it (or simply not commit if formatting failed). The
+ * spans stay valid until the next call that writes to the buffer.
+ *
+ * @param b A pointer to the CircularBuffer struct.
+ * @param spans Filled with the writable region.
+ * @return The total number of writable bytes, 0 if `b` or `spans` is NULL.
+ */
+uint16_t CB_GetWriteSpans(CircularBuffer *b, CircularBufferSpans *spans);
+
+/**
+ * @brief CB_CommitWrite() appends bytes previously filled in through CB_GetWriteSpans().
+ *
+ * Fails, and does nothing, if `size` is larger than the free space in the buffer.
+ *
+ * @param b A pointer to the CircularBuffer struct.
+ * @param size The number of bytes to append to the buffer.
+ */
+int CB_CommitWrite(CircularBuffer *b, uint16_t size);
+
 
 #endif /* CIRCULAR_BUFFER_H */
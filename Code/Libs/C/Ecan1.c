@@ -1,6 +1,7 @@
 // Include custom library headers
 #include "Ecan1.h"
-#include "CircularBuffer.h"
+#include "CanFrameQueue.h"
+#include "EcanTxScheduler.h"
 
 // Include standard C library headers
 #include <string.h>
@@ -18,44 +19,99 @@
  * @brief  Provides C functions for ECAN blocks
  */
 
-// Specify the number of 8-byte CAN messages buffer supports.
-// This can be overridden by user code.
-#ifndef ECAN1_BUFFERSIZE
-#define ECAN1_BUFFERSIZE 8 * 24
+// Specify the number of CAN messages the receive queue and the normal-priority transmit queue can
+// hold, and the number the high- and low-priority transmit queues can hold.
+// These can be overridden by user code.
+#ifndef ECAN1_QUEUE_LENGTH
+#define ECAN1_QUEUE_LENGTH 12
+#endif
+#ifndef ECAN1_TX_HIGH_QUEUE_LENGTH
+#define ECAN1_TX_HIGH_QUEUE_LENGTH 4
+#endif
+#ifndef ECAN1_TX_LOW_QUEUE_LENGTH
+#define ECAN1_TX_LOW_QUEUE_LENGTH 4
 #endif
 
 // Declare space for our message buffer in DMA
-// NOTE: This DMA space is aligned along 64-byte boundaries to make sure there's enough room for
-// all 64-bytes of memory required.
+// NOTE: This DMA space is aligned along 128-byte boundaries to make sure there's enough room for
+// all 128-bytes of memory required.
 #ifdef __dsPIC33FJ128MC802__
-static volatile uint16_t ecan1MsgBuf[4][8] __attribute__((space(dma), aligned(64)));
+static volatile uint16_t ecan1MsgBuf[8][8] __attribute__((space(dma), aligned(128)));
 #elif __dsPIC33EP256MC502__
-static volatile uint16_t ecan1MsgBuf[4][8] __attribute__((aligned(64)));
+static volatile uint16_t ecan1MsgBuf[8][8] __attribute__((aligned(128)));
 #endif
 
-// Initialize our circular buffers and data arrays for transreceiving CAN messages
-static CircularBuffer ecan1RxCBuffer;
-static uint8_t rxDataArray[ECAN1_BUFFERSIZE];
-static CircularBuffer ecan1TxCBuffer;
-static uint8_t txDataArray[ECAN1_BUFFERSIZE];
-
-// Track whether or not we're currently transmitting
-static bool currentlyTransmitting = 0;
-
-// Also track how many messages are pending for reading.
-static uint8_t receivedMessagesPending = 0;
+// All buffers but the reception buffer (1) transmit. They're the scheduler's slots, and the
+// module sends the highest-numbered one of a priority first, so that's the order they're listed in.
+static const uint8_t txBuffers[] = {7, 6, 5, 4, 3, 2, 0};
+static const EcanTxPriority txPriorities[] = {
+    ECAN_TX_PRIORITY_HIGH, ECAN_TX_PRIORITY_HIGH,
+    ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_NORMAL,
+    ECAN_TX_PRIORITY_LOW, ECAN_TX_PRIORITY_LOW
+};
+#define ECAN1_TX_SLOTS (sizeof(txBuffers) / sizeof(txBuffers[0]))
+
+// Initialize our frame queues and their storage for transreceiving CAN messages
+static CanFrameQueue ecan1RxQueue;
+static CanMessage rxSlots[ECAN1_QUEUE_LENGTH];
+static EcanTxScheduler ecan1Tx;
+static CanMessage txHighSlots[ECAN1_TX_HIGH_QUEUE_LENGTH];
+static CanMessage txNormalSlots[ECAN1_QUEUE_LENGTH];
+static CanMessage txLowSlots[ECAN1_TX_LOW_QUEUE_LENGTH];
 
 // Track when the buffers have overflowed. These are cleared as soon as they are read.
 static bool txBufferOverflow = false;
 static bool rxBufferOverflow = false;
 
+// Counts every frame received and sent, if set.
+static CanBusMonitor *monitor = NULL;
+
+/**
+ * Loads acceptance filters into the ECAN1 registers. Requires C1CTRL1bits.WIN to be set.
+ */
+static void Ecan1SetFilters(const EcanFilterRegisters *filters)
+{
+    // The mask and filter registers are laid out as consecutive SID/EID pairs.
+    volatile uint16_t *const masks = &C1RXM0SID;
+    volatile uint16_t *const filterRegs = &C1RXF0SID;
+    uint8_t i;
+
+    for (i = 0; i < ECAN_FILTER_MASK_COUNT; ++i) {
+        masks[2 * i] = filters->MaskSid[i];
+        masks[2 * i + 1] = filters->MaskEid[i];
+    }
+    for (i = 0; i < ECAN_FILTER_COUNT; ++i) {
+        filterRegs[2 * i] = filters->FilterSid[i];
+        filterRegs[2 * i + 1] = filters->FilterEid[i];
+    }
+    C1FMSKSEL1 = filters->MaskSelect[0];
+    C1FMSKSEL2 = filters->MaskSelect[1];
+
+    // Point every filter to our reception buffer (Buffer 1).
+    C1BUFPNT1 = 0x1111;
+    C1BUFPNT2 = 0x1111;
+    C1BUFPNT3 = 0x1111;
+    C1BUFPNT4 = 0x1111;
+
+    C1FEN1 = filters->Enable;
+}
+
 void Ecan1Init(uint32_t f_osc, uint32_t f_baud)
 {
-    // Initialize our circular buffers. If this fails, we crash and burn.
-    if (!CB_Init(&ecan1TxCBuffer, txDataArray, ECAN1_BUFFERSIZE)) {
+    Ecan1InitFiltered(f_osc, f_baud, NULL);
+}
+
+void Ecan1InitFiltered(uint32_t f_osc, uint32_t f_baud, const EcanFilterRegisters *filters)
+{
+    // Initialize our frame queues. If this fails, we crash and burn.
+    CanMessage *const txStorage[ECAN_TX_PRIORITY_COUNT] = {txHighSlots, txNormalSlots, txLowSlots};
+    const uint8_t txCapacity[ECAN_TX_PRIORITY_COUNT] = {
+        ECAN1_TX_HIGH_QUEUE_LENGTH, ECAN1_QUEUE_LENGTH, ECAN1_TX_LOW_QUEUE_LENGTH
+    };
+    if (!EcanTxInit(&ecan1Tx, txStorage, txCapacity, txPriorities, ECAN1_TX_SLOTS)) {
         while (1);
     }
-    if (!CB_Init(&ecan1RxCBuffer, rxDataArray, ECAN1_BUFFERSIZE)) {
+    if (!CFQ_Init(&ecan1RxQueue, rxSlots, ECAN1_QUEUE_LENGTH)) {
         while (1);
     }
 
@@ -75,26 +131,30 @@ void Ecan1Init(uint32_t f_osc, uint32_t f_baud)
     CAN1Initialize(CAN_SYNC_JUMP_WIDTH4 & CAN_BAUD_PRE_SCALE(brp),
             CAN_WAKEUP_BY_FILTER_DIS & CAN_PROPAGATIONTIME_SEG_TQ(propagationSegmentLength) & CAN_PHASE_SEG1_TQ(phaseSegment1Length) & CAN_PHASE_SEG2_TQ(phaseSegment2Length) & CAN_SEG2_FREE_PROG & CAN_SAMPLE3TIMES);
 
-    // Use 4 buffers in DMA RAM (smallest value we can choose), other option is irrelevant.
-    CAN1FIFOCon(CAN_DMA_BUF_SIZE_4 & CAN_FIFO_AREA_TRB0);
+    // Use 8 buffers in DMA RAM, all the ones that can transmit, other option is irrelevant.
+    CAN1FIFOCon(CAN_DMA_BUF_SIZE_8 & CAN_FIFO_AREA_TRB0);
 
     // Setup message filters and masks.
     C1CTRL1bits.WIN = 1; // Allow configuration of masks and filters
 
-    // Set Mask 0 to allow everything.
-    CAN1SetMask(0, CAN_MASK_SID(0) & CAN_IGNORE_FILTER_TYPE, CAN_MASK_EID(0));
+    if (filters) {
+        Ecan1SetFilters(filters);
+    } else {
+        // Set Mask 0 to allow everything.
+        CAN1SetMask(0, CAN_MASK_SID(0) & CAN_IGNORE_FILTER_TYPE, CAN_MASK_EID(0));
 
-    // Set Filter 0 to use Mask 0.
-    CAN1SetMaskSource(CAN_MASK_FILTER0_MASK0, CAN_MASK_FILTER8_NO_MASK);
+        // Set Filter 0 to use Mask 0.
+        CAN1SetMaskSource(CAN_MASK_FILTER0_MASK0, CAN_MASK_FILTER8_NO_MASK);
 
-    // Set Filter 0 to allow everything.
-    CAN1SetFilter(0, CAN_FILTER_SID(0) & CAN_RX_EID_DIS, CAN_FILTER_EID(0));
+        // Set Filter 0 to allow everything.
+        CAN1SetFilter(0, CAN_FILTER_SID(0) & CAN_RX_EID_DIS, CAN_FILTER_EID(0));
 
-    // Point filter 0 to our reception buffer (Buffer 1).
-    CAN1SetBUFPNT1(CAN_FILTER0_RX_BUFFER1);
+        // Point filter 0 to our reception buffer (Buffer 1).
+        CAN1SetBUFPNT1(CAN_FILTER0_RX_BUFFER1);
 
-    // Enable Filter 0.
-    CAN1EnableFilter(0);
+        // Enable Filter 0.
+        CAN1EnableFilter(0);
+    }
 
     C1CTRL1bits.WIN = 0;
 
@@ -107,9 +167,21 @@ void Ecan1Init(uint32_t f_osc, uint32_t f_baud)
             CAN_INT_ENABLE & CAN_INT_PRI_7);
 
     // Configure buffer settings.
-    // Specify details on the reception buffer (1) and the transmission buffer (0)
-    CAN1SetTXRXMode(0, CAN_BUFFER0_IS_TX & CAN_ABORT_REQUEST_BUFFER0 & CAN_AUTOREMOTE_DISABLE_BUFFER0 & CAN_TX_HIGH_PRI_BUFFER0 &
-            CAN_BUFFER1_IS_RX & CAN_ABORT_REQUEST_BUFFER1 & CAN_AUTOREMOTE_DISABLE_BUFFER1 & CAN_TX_HIGH_PRI_BUFFER1);
+    // Buffer 1 receives, and every transmission buffer gets the TXnPRI of its priority, so the most
+    // urgent frame loaded is the one offered to the bus. Each buffer has a byte of its C1TRmnCON
+    // register, with TXENn in bit 7 and TXnPRI in bits 1-0.
+    {
+        volatile uint16_t *const bufferCtrlRegs = &C1TR01CON;
+        uint8_t i;
+
+        for (i = 0; i < 4; ++i) {
+            bufferCtrlRegs[i] = 0;
+        }
+        for (i = 0; i < ECAN1_TX_SLOTS; ++i) {
+            const uint8_t buffer = txBuffers[i];
+            bufferCtrlRegs[buffer >> 1] |= (0x0080 | (3 - txPriorities[i])) << ((buffer & 1) << 3);
+        }
+    }
 
     /// Set up necessary DMA channels for transmission and reception
     // ECAN1 transmission over DMA2
@@ -140,30 +212,103 @@ void Ecan1Init(uint32_t f_osc, uint32_t f_baud)
 int Ecan1Receive(CanMessage *msg, uint8_t *messagesLeft)
 {
     IEC2bits.C1IE = 0; // Disable the ECAN1 receive interrupt to avoid write-during-read collisions
-    int foundOne = CB_ReadMany(&ecan1RxCBuffer, msg, sizeof (CanMessage));
+    int foundOne = CFQ_Pop(&ecan1RxQueue, msg);
+    uint8_t left = CFQ_GetDepth(&ecan1RxQueue);
     IEC2bits.C1IE = 1;
 
     if (messagesLeft) {
-        if (foundOne) {
-            *messagesLeft = --receivedMessagesPending;
-        } else {
-            *messagesLeft = 0;
-        }
+        *messagesLeft = left;
     }
 
     return foundOne;
 }
 
+uint8_t Ecan1ReceiveMany(CanMessage *msgs, uint8_t maxMessages, uint8_t *messagesLeft)
+{
+    IEC2bits.C1IE = 0; // Disable the ECAN1 receive interrupt to avoid write-during-read collisions
+    uint8_t found = CFQ_PopMany(&ecan1RxQueue, msgs, maxMessages);
+    uint8_t left = CFQ_GetDepth(&ecan1RxQueue);
+    IEC2bits.C1IE = 1;
+
+    if (messagesLeft) {
+        *messagesLeft = left;
+    }
+
+    return found;
+}
+
+void Ecan1SetMonitor(CanBusMonitor *m)
+{
+    IEC2bits.C1IE = 0;
+    monitor = m;
+    IEC2bits.C1IE = 1;
+}
+
+void Ecan1TickMonitor(void)
+{
+    if (monitor) {
+        IEC2bits.C1IE = 0;
+        CanBusMonitorTick(monitor);
+        IEC2bits.C1IE = 1;
+    }
+}
+
+bool Ecan1GetMonitorTotals(CanBusMonitorTotals *totals)
+{
+    bool found = false;
+    IEC2bits.C1IE = 0;
+    if (monitor) {
+        CanBusMonitorGetTotals(monitor, totals);
+        found = true;
+    }
+    IEC2bits.C1IE = 1;
+    return found;
+}
+
+bool Ecan1GetMonitorEntry(uint8_t index, CanBusMonitorEntry *entry)
+{
+    bool found = false;
+    IEC2bits.C1IE = 0;
+    if (monitor && index < monitor->Used) {
+        *entry = monitor->Entries[index];
+        found = true;
+    }
+    IEC2bits.C1IE = 1;
+    return found;
+}
+
+bool Ecan1GetMonitorSource(uint8_t index, CanBusMonitorSource *source)
+{
+    bool found = false;
+    IEC2bits.C1IE = 0;
+    if (monitor && index < CAN_BUS_MONITOR_SOURCES && monitor->Sources[index].Used) {
+        *source = monitor->Sources[index];
+        found = true;
+    }
+    IEC2bits.C1IE = 1;
+    return found;
+}
+
+void Ecan1GetQueueStats(EcanQueueStats *stats)
+{
+    IEC2bits.C1IE = 0;
+    stats->rxDepth = CFQ_GetDepth(&ecan1RxQueue);
+    stats->rxHighWater = CFQ_GetHighWater(&ecan1RxQueue);
+    stats->txDepth = EcanTxGetDepth(&ecan1Tx);
+    stats->txHighWater = EcanTxGetHighWater(&ecan1Tx);
+    IEC2bits.C1IE = 1;
+}
+
 /**
- * This function transmits a CAN message on the ECAN1 CAN bus.
- * This function is for internal use only as it bypasses the circular buffer. This means that it
+ * This function transmits a CAN message on the ECAN1 CAN bus out of the given buffer.
+ * This function is for internal use only as it bypasses the transmission queues. This means that it
  * can squash existing transfers in progress.
  */
-void _ecan1TransmitHelper(const CanMessage *message)
+static void _ecan1TransmitHelper(const CanMessage *message, uint8_t buffer)
 {
     uint16_t word0 = 0, word1 = 0, word2 = 0;
     uint16_t sid10_0 = 0, eid5_0 = 0, eid17_6 = 0;
-    volatile uint16_t *ecan_msg_buf_ptr = ecan1MsgBuf[message->buffer];
+    volatile uint16_t *ecan_msg_buf_ptr = ecan1MsgBuf[buffer];
 
     // Variables for setting correct TXREQ bit
     uint16_t bit_to_set;
@@ -200,37 +345,47 @@ void _ecan1TransmitHelper(const CanMessage *message)
     ecan_msg_buf_ptr[6] = ((uint16_t)message->payload[7] << 8 | ((uint16_t)message->payload[6]));
 
     // Set the correct transfer intialization bit (TXREQ) based on message buffer.
-    offset = message->buffer >> 1;
+    offset = buffer >> 1;
     bufferCtrlRegAddr = (uint16_t *)(&C1TR01CON + offset);
-    bit_to_set = 1 << (3 | ((message->buffer & 1) << 3));
+    bit_to_set = 1 << (3 | ((buffer & 1) << 3));
     *bufferCtrlRegAddr |= bit_to_set;
-
-    // Keep track of whether we're in a transmission train or not.
-    currentlyTransmitting = 1;
 }
 
 /**
- * Transmits a CanMessage using the transmission circular buffer.
+ * Loads every transmission buffer that's free and has a frame waiting for it.
+ * Must be called with the ECAN1 interrupt disabled or from within it.
  */
+static void _ecan1LoadTransmitBuffers(void)
+{
+    CanMessage message;
+    int8_t slot;
+
+    while ((slot = EcanTxNext(&ecan1Tx, &message)) >= 0) {
+        _ecan1TransmitHelper(&message, txBuffers[slot]);
+    }
+}
+
 bool Ecan1Transmit(const CanMessage *msg)
 {
-    // Append the message to the queue.
-    // Message are only removed upon successful transmission.
-    // They will be overwritten by newer message overflowing
-    // the circular buffer however.
+    return Ecan1TransmitPriority(msg, ECAN_TX_PRIORITY_NORMAL);
+}
+
+/**
+ * Transmits a CanMessage using the transmission queue of the given priority.
+ */
+bool Ecan1TransmitPriority(const CanMessage *msg, EcanTxPriority priority)
+{
+    // Append the message to its queue and load it right away if a buffer is free for it.
+    // If the queue is full the new message is dropped.
     IEC2bits.C1IE = 0; // Disable the ECAN1 transmit interrupt to avoid read-during-write collisions
-    if (!CB_WriteMany(&ecan1TxCBuffer, msg, sizeof (CanMessage), true)) {
+    if (!EcanTxQueue(&ecan1Tx, msg, priority)) {
+        txBufferOverflow = true;
         IEC2bits.C1IE = 1;
         return false;
     }
+    _ecan1LoadTransmitBuffers();
     IEC2bits.C1IE = 1;
 
-    // If this is the only message in the queue, attempt to
-    // transmit it.
-    if (!currentlyTransmitting) {
-        _ecan1TransmitHelper(msg);
-    }
-
     return true;
 }
 
@@ -277,6 +432,59 @@ void Ecan1GetErrorCounts(uint8_t *txErrors, uint8_t *rxErrors)
     *rxErrors = C1ECbits.RERRCNT;
 }
 
+/**
+ * Unpacks the frame in an ECAN1 DMA buffer. Both received and transmitted frames are laid out the
+ * same way.
+ */
+static void _ecan1ReadBuffer(volatile const uint16_t *ecan_msg_buf_ptr, CanMessage *message)
+{
+    uint8_t ide = 0;
+    uint8_t srr = 0;
+    uint32_t id = 0;
+
+    // Read the first word to see the message type
+    ide = ecan_msg_buf_ptr[0] & 0x0001;
+    srr = ecan_msg_buf_ptr[0] & 0x0002;
+
+    /* Format the message properly according to whether it
+     * uses an extended identifier or not.
+     */
+    if (ide == 0) {
+        message->frame_type = CAN_FRAME_STD;
+
+        message->id = (uint32_t)((ecan_msg_buf_ptr[0] & 0x1FFC) >> 2);
+    } else {
+        message->frame_type = CAN_FRAME_EXT;
+
+        id = ecan_msg_buf_ptr[0] & 0x1FFC;
+        message->id = id << 16;
+        id = ecan_msg_buf_ptr[1] & 0x0FFF;
+        message->id |= id << 6;
+        id = ecan_msg_buf_ptr[2] & 0xFC00;
+        message->id |= id >> 10;
+    }
+
+    /* If message is a remote transmit request, mark it as such.
+     * Otherwise it will be a regular transmission so fill its
+     * payload with the relevant data.
+     */
+    if (srr == 1) {
+        message->message_type = CAN_MSG_RTR;
+    } else {
+        message->message_type = CAN_MSG_DATA;
+
+        message->validBytes = (uint8_t)(ecan_msg_buf_ptr[2] & 0x000F);
+        message->payload[0] = (uint8_t)ecan_msg_buf_ptr[3];
+        message->payload[1] = (uint8_t)((ecan_msg_buf_ptr[3] & 0xFF00) >> 8);
+        message->payload[2] = (uint8_t)ecan_msg_buf_ptr[4];
+        message->payload[3] = (uint8_t)((ecan_msg_buf_ptr[4] & 0xFF00) >> 8);
+        message->payload[4] = (uint8_t)ecan_msg_buf_ptr[5];
+        message->payload[5] = (uint8_t)((ecan_msg_buf_ptr[5] & 0xFF00) >> 8);
+        message->payload[6] = (uint8_t)ecan_msg_buf_ptr[6];
+        message->payload[7] = (uint8_t)((ecan_msg_buf_ptr[6] & 0xFF00) >> 8);
+    }
+}
+
 /**
  * This is an interrupt handler for the ECAN1 peripheral.
  * It clears interrupt bits and pushes received message into
@@ -286,37 +494,31 @@ void _ISR _C1Interrupt(void)
 {
     // Give us a CAN message struct to populate and use
     CanMessage message;
-    uint8_t ide = 0;
-    uint8_t srr = 0;
-    uint32_t id = 0;
     volatile uint16_t *ecan_msg_buf_ptr; // TODO: Move this to using a proper ECAN bitfield instead
 
-    // If the interrupt was set because of a transmit, check to
-    // see if more messages are in the circular buffer and start
-    // transmitting them.
+    // If the interrupt was set because of a transmit, free every
+    // buffer that has been sent and refill them from the queues.
     if (C1INTFbits.TBIF) {
+        volatile uint16_t *const bufferCtrlRegs = &C1TR01CON;
+        uint8_t i;
 
-        // After a successfully sent message, there should be at least
-        // one message in the queue, so pop it off.
-        CB_ReadMany(&ecan1TxCBuffer, &message, sizeof (CanMessage));
-
-        // Check for a buffer overflow. Then clear the entire buffer if there was.
-        if (ecan1TxCBuffer.overflowCount) {
-            txBufferOverflow = true;
-            CB_Init(&ecan1TxCBuffer, txDataArray, ECAN1_BUFFERSIZE);
-        }
+        // Clear the flag first, so a buffer finishing while we're in here fires again.
+        C1INTFbits.TBIF = 0;
 
-        // Now if there's still a message left in the buffer,
-        // try to transmit it.
-        if (ecan1TxCBuffer.dataSize >= sizeof (CanMessage)) {
-            CanMessage msg;
-            CB_PeekMany(&ecan1TxCBuffer, &msg, sizeof (CanMessage));
-            _ecan1TransmitHelper(&msg);
-        } else {
-            currentlyTransmitting = 0;
+        // More than one buffer may have been sent since the last interrupt, so check them all:
+        // the module clears TXREQ once a buffer is sent.
+        for (i = 0; i < ECAN1_TX_SLOTS; ++i) {
+            const uint8_t buffer = txBuffers[i];
+            if (EcanTxIsLoaded(&ecan1Tx, i) && !(bufferCtrlRegs[buffer >> 1] & (1 << (3 | ((buffer & 1) << 3))))) {
+                // Count the frame now that it's actually been on the bus.
+                if (monitor) {
+                    _ecan1ReadBuffer(ecan1MsgBuf[buffer], &message);
+                    CanBusMonitorFrame(monitor, &message);
+                }
+                EcanTxSent(&ecan1Tx, i);
+            }
         }
-
-        C1INTFbits.TBIF = 0;
+        _ecan1LoadTransmitBuffers();
     }
 
     // If the interrupt was fired because of a received message
@@ -335,62 +537,23 @@ void _ISR _C1Interrupt(void)
             C1RXFUL1 &= ~(1 << message.buffer);
         }
 
-        //  Move the message from the DMA buffer to a data structure and then push it into our circular buffer.
-
-        // Read the first word to see the message type
-        ide = ecan_msg_buf_ptr[0] & 0x0001;
-        srr = ecan_msg_buf_ptr[0] & 0x0002;
+        //  Move the message from the DMA buffer to a data structure and then push it into our queue.
 
-        /* Format the message properly according to whether it
-         * uses an extended identifier or not.
-         */
-        if (ide == 0) {
-            message.frame_type = CAN_FRAME_STD;
-
-            message.id = (uint32_t)((ecan_msg_buf_ptr[0] & 0x1FFC) >> 2);
-        } else {
-            message.frame_type = CAN_FRAME_EXT;
-
-            id = ecan_msg_buf_ptr[0] & 0x1FFC;
-            message.id = id << 16;
-            id = ecan_msg_buf_ptr[1] & 0x0FFF;
-            message.id |= id << 6;
-            id = ecan_msg_buf_ptr[2] & 0xFC00;
-            message.id |= id >> 10;
-        }
+        _ecan1ReadBuffer(ecan_msg_buf_ptr, &message);
 
-        /* If message is a remote transmit request, mark it as such.
-         * Otherwise it will be a regular transmission so fill its
-         * payload with the relevant data.
-         */
-        if (srr == 1) {
-            message.message_type = CAN_MSG_RTR;
-        } else {
-            message.message_type = CAN_MSG_DATA;
-
-            message.validBytes = (uint8_t)(ecan_msg_buf_ptr[2] & 0x000F);
-            message.payload[0] = (uint8_t)ecan_msg_buf_ptr[3];
-            message.payload[1] = (uint8_t)((ecan_msg_buf_ptr[3] & 0xFF00) >> 8);
-            message.payload[2] = (uint8_t)ecan_msg_buf_ptr[4];
-            message.payload[3] = (uint8_t)((ecan_msg_buf_ptr[4] & 0xFF00) >> 8);
-            message.payload[4] = (uint8_t)ecan_msg_buf_ptr[5];
-            message.payload[5] = (uint8_t)((ecan_msg_buf_ptr[5] & 0xFF00) >> 8);
-            message.payload[6] = (uint8_t)ecan_msg_buf_ptr[6];
-            message.payload[7] = (uint8_t)((ecan_msg_buf_ptr[6] & 0xFF00) >> 8);
+        if (monitor) {
+            CanBusMonitorFrame(monitor, &message);
         }
 
-        // Store the message in the buffer and update our messages-in-queue value.
-        if (CB_WriteMany(&ecan1RxCBuffer, &message, sizeof (CanMessage), true)) {
-            ++receivedMessagesPending;
-        } else {
-            // If writing fails, log the error and clear the buffer. This ensures we are at least
+        // Store the message in the queue.
+        if (!CFQ_Push(&ecan1RxQueue, &message)) {
+            // If writing fails, log the error and clear the queue. This ensures we are at least
             // receiving the most recent data
             rxBufferOverflow = true;
-            CB_Init(&ecan1RxCBuffer, rxDataArray, ECAN1_BUFFERSIZE);
+            CFQ_Clear(&ecan1RxQueue);
 
             // Try to log this message again
-            CB_WriteMany(&ecan1RxCBuffer, &message, sizeof (CanMessage), true);
-            receivedMessagesPending = 1;
+            CFQ_Push(&ecan1RxQueue, &message);
         }
 
         // Be sure to clear the interrupt flag.
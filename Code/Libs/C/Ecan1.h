@@ -13,10 +13,15 @@
 #ifndef ECAN1_H
 #define ECAN1_H
 
-//If simulating, remove the include xc.h  Otherwise, leave it.
+// On the host, Ecan1Host.c implements this interface on a virtual bus instead.
+#if defined(__XC16__)
 #include <xc.h>
+#endif
 #include "EcanDefines.h"
 #include "CircularBuffer.h"
+#include "EcanFilterPlanner.h"
+#include "EcanTxScheduler.h"
+#include "CanBusMonitor.h"
 
 #include <stdbool.h>
 
@@ -34,6 +39,18 @@ typedef struct {
     EcanError RxError: 2;
 } EcanStatus;
 
+/**
+ * Occupancy of the ECAN1 software queues, in frames. The high-water marks are the deepest each queue
+ * has been since initialization. The transmit figures cover the queues of all priorities together,
+ * and not the frames already loaded into the transmission buffers.
+ */
+typedef struct {
+    uint8_t rxDepth;
+    uint8_t rxHighWater;
+    uint8_t txDepth;
+    uint8_t txHighWater;
+} EcanQueueStats;
+
 /**
  * Initialize the CAN hardware. This DOES NOT enable any pins that may be
  * necessary to map as inputs/outputs or using peripheral pin select hardware.
@@ -43,18 +60,87 @@ typedef struct {
  */
 void Ecan1Init(uint32_t f_osc, uint32_t f_baud);
 
+/**
+ * Like Ecan1Init(), but only receives the frames that pass the given acceptance filters, while
+ * Ecan1Init() receives everything. Rejected frames never reach the reception queue or wake the CPU.
+ * @param filters Generally planned with EcanFilterPlan().
+ */
+void Ecan1InitFiltered(uint32_t f_osc, uint32_t f_baud, const EcanFilterRegisters *filters);
+
 /**
  * Pops the top message from the ECAN1 reception buffer.
  * @return A tCanMessage struct with the older message data.
  */
 int Ecan1Receive(CanMessage *msg, uint8_t *messagesLeft);
 
+/**
+ * Pops up to `maxMessages` of the oldest messages from the ECAN1 reception queue into `msgs`. This
+ * only disables the ECAN1 interrupt once for the whole batch, so prefer it to repeatedly calling
+ * Ecan1Receive() when draining the queue.
+ * @param msgs An array with room for at least `maxMessages` messages.
+ * @param maxMessages The most messages to return.
+ * @param messagesLeft If not NULL, set to the number of messages still queued afterwards.
+ * @return The number of messages written to `msgs`.
+ */
+uint8_t Ecan1ReceiveMany(CanMessage *msgs, uint8_t maxMessages, uint8_t *messagesLeft);
+
+/**
+ * Returns the current depth and high-water mark of the ECAN1 transmit and receive queues.
+ */
+void Ecan1GetQueueStats(EcanQueueStats *stats);
+
+/**
+ * Has every frame received from and sent on ECAN1 counted by a bus monitor from then on. Received
+ * frames are only those that pass the acceptance filters, and sent frames are counted once their
+ * buffer is freed, so the monitor's bus load doesn't include traffic between other nodes that the
+ * filters reject.
+ * @param m An initialized monitor, or NULL to stop counting.
+ */
+void Ecan1SetMonitor(CanBusMonitor *m);
+
+/**
+ * Copies the totals of the bus monitor given to Ecan1SetMonitor(), with the ECAN1 interrupt
+ * disabled so no counter is read halfway through a frame being counted. The monitor itself must
+ * not be read directly while it's set.
+ * @return False if there's no monitor.
+ */
+bool Ecan1GetMonitorTotals(CanBusMonitorTotals *totals);
+
+/**
+ * Copies an ID entry of the bus monitor, like Ecan1GetMonitorTotals().
+ * @param index The entry, up to the number of IDs in the totals.
+ * @return False if there's no monitor or no such entry.
+ */
+bool Ecan1GetMonitorEntry(uint8_t index, CanBusMonitorEntry *entry);
+
+/**
+ * Copies a source address entry of the bus monitor, like Ecan1GetMonitorTotals().
+ * @param index The entry, up to CAN_BUS_MONITOR_SOURCES.
+ * @return False if there's no monitor or the entry isn't in use.
+ */
+bool Ecan1GetMonitorSource(uint8_t index, CanBusMonitorSource *source);
+
+/**
+ * Ticks the bus monitor given to Ecan1SetMonitor(), with the ECAN1 interrupt disabled so no frame
+ * is counted in the middle of it. Must be called at the tick rate the monitor was initialized with.
+ */
+void Ecan1TickMonitor(void);
+
 /**
  * Transmits a CAN message via a circular buffer interface
- * similar to that used by CAN message reception.
+ * similar to that used by CAN message reception. Uses ECAN_TX_PRIORITY_NORMAL.
  */
 bool Ecan1Transmit(const CanMessage *message);
 
+/**
+ * Like Ecan1Transmit(), but with the given priority. Every priority has its own queue and
+ * transmission buffers, so a frame is only ever held up by the frames queued before it at its own
+ * priority, the ones queued at higher priorities, and the one on the bus. Frames of one priority
+ * are sent in the order they were queued.
+ * @return False if the queue of that priority was full and the frame was dropped.
+ */
+bool Ecan1TransmitPriority(const CanMessage *message, EcanTxPriority priority);
+
 /**
  * Returns the error status of the ECAN1 peripheral.
  * Returns an enum
@@ -0,0 +1,290 @@
+// Include custom library headers
+#include "Ecan1.h"
+#include "Ecan1Host.h"
+#include "CanFrameQueue.h"
+#include "EcanTxScheduler.h"
+#include "Node.h"
+
+// Include standard C library headers
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+/**
+ * @file   Ecan1Host.c
+ * @brief  Implements Ecan1.h on a virtual CAN bus, see Ecan1Host.h.
+ */
+
+// The queue lengths match Ecan1.c, and can be overridden the same way.
+#ifndef ECAN1_QUEUE_LENGTH
+#define ECAN1_QUEUE_LENGTH 12
+#endif
+#ifndef ECAN1_TX_HIGH_QUEUE_LENGTH
+#define ECAN1_TX_HIGH_QUEUE_LENGTH 4
+#endif
+#ifndef ECAN1_TX_LOW_QUEUE_LENGTH
+#define ECAN1_TX_LOW_QUEUE_LENGTH 4
+#endif
+
+// The same slots as Ecan1.c, with the virtual bus sending the lowest-numbered buffer first.
+static const EcanTxPriority txPriorities[] = {
+    ECAN_TX_PRIORITY_HIGH, ECAN_TX_PRIORITY_HIGH,
+    ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_NORMAL,
+    ECAN_TX_PRIORITY_LOW, ECAN_TX_PRIORITY_LOW
+};
+#define ECAN1_TX_SLOTS (sizeof(txPriorities) / sizeof(txPriorities[0]))
+
+static CanFrameQueue ecan1RxQueue;
+static CanMessage rxSlots[ECAN1_QUEUE_LENGTH];
+static EcanTxScheduler ecan1Tx;
+static CanMessage txHighSlots[ECAN1_TX_HIGH_QUEUE_LENGTH];
+static CanMessage txNormalSlots[ECAN1_QUEUE_LENGTH];
+static CanMessage txLowSlots[ECAN1_TX_LOW_QUEUE_LENGTH];
+// The frame loaded into every transmission buffer, counted by the monitor once it's sent.
+static CanMessage txLoaded[ECAN1_TX_SLOTS];
+
+// Track when the buffers have overflowed. These are cleared as soon as they are read.
+static bool txBufferOverflow = false;
+static bool rxBufferOverflow = false;
+
+// Counts every frame received and sent, if set.
+static CanBusMonitor *monitor = NULL;
+
+// The bus to attach to, and the connection to it once attached.
+static const char *busName = "autoboat";
+static bool busSocketCan = false;
+static bool busConfigured = false;
+static VirtualCanConfig busConfig;
+static VirtualCanPort port;
+static bool attached = false;
+
+void Ecan1HostSetBus(const char *name, bool socketCan, const VirtualCanConfig *config)
+{
+    busName = name;
+    busSocketCan = socketCan;
+    busConfigured = config != NULL;
+    if (config) {
+        busConfig = *config;
+    }
+}
+
+void Ecan1HostGetStats(VirtualCanStats *stats)
+{
+    if (attached) {
+        VirtualCanGetStats(&port, stats);
+    } else {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+void Ecan1HostClose(void)
+{
+    if (attached) {
+        VirtualCanClose(&port);
+        attached = false;
+    }
+}
+
+/**
+ * Does what the ECAN1 interrupt does on the dsPIC: frees the transmission buffers that have been
+ * sent, reloads them, and queues every received frame.
+ */
+static void _ecan1Service(void)
+{
+    CanMessage messages[8];
+    uint8_t count, i;
+    int8_t slot;
+
+    if (!attached) {
+        return;
+    }
+
+    VirtualCanService(&port);
+    for (i = 0; i < ECAN1_TX_SLOTS; ++i) {
+        if (EcanTxIsLoaded(&ecan1Tx, i) && !VirtualCanIsLoaded(&port, i)) {
+            if (monitor) {
+                CanBusMonitorFrame(monitor, &txLoaded[i]);
+            }
+            EcanTxSent(&ecan1Tx, i);
+        }
+    }
+    while ((slot = EcanTxNext(&ecan1Tx, &messages[0])) >= 0) {
+        txLoaded[slot] = messages[0];
+        VirtualCanLoad(&port, slot, &messages[0]);
+    }
+    // Offer the frames just loaded to the bus right away.
+    VirtualCanService(&port);
+
+    while ((count = VirtualCanReceive(&port, messages, sizeof(messages) / sizeof(messages[0])))) {
+        for (i = 0; i < count; ++i) {
+            if (monitor) {
+                CanBusMonitorFrame(monitor, &messages[i]);
+            }
+            // Like Ecan1.c, clear the queue when it overflows to at least keep the latest frames.
+            if (!CFQ_Push(&ecan1RxQueue, &messages[i])) {
+                rxBufferOverflow = true;
+                CFQ_Clear(&ecan1RxQueue);
+                CFQ_Push(&ecan1RxQueue, &messages[i]);
+            }
+        }
+    }
+}
+
+void Ecan1Init(uint32_t f_osc, uint32_t f_baud)
+{
+    Ecan1InitFiltered(f_osc, f_baud, NULL);
+}
+
+void Ecan1InitFiltered(uint32_t f_osc, uint32_t f_baud, const EcanFilterRegisters *filters)
+{
+    CanMessage *const txStorage[ECAN_TX_PRIORITY_COUNT] = {txHighSlots, txNormalSlots, txLowSlots};
+    const uint8_t txCapacity[ECAN_TX_PRIORITY_COUNT] = {
+        ECAN1_TX_HIGH_QUEUE_LENGTH, ECAN1_QUEUE_LENGTH, ECAN1_TX_LOW_QUEUE_LENGTH
+    };
+    VirtualCanConfig config = {f_baud, 0, 1};
+    bool opened;
+
+    (void)f_osc;
+
+    if (!EcanTxInit(&ecan1Tx, txStorage, txCapacity, txPriorities, ECAN1_TX_SLOTS) ||
+        !CFQ_Init(&ecan1RxQueue, rxSlots, ECAN1_QUEUE_LENGTH)) {
+        FATAL_ERROR();
+    }
+
+    Ecan1HostClose();
+    if (busConfigured) {
+        config = busConfig;
+    }
+    if (busSocketCan) {
+        opened = VirtualCanOpenSocket(&port, busName, &config);
+    } else {
+        opened = VirtualCanOpen(&port, busName, &config);
+    }
+    if (!opened) {
+        fprintf(stderr, "Can't attach to the CAN bus %s.\n", busName);
+        FATAL_ERROR();
+    }
+    VirtualCanSetFilters(&port, filters);
+    attached = true;
+}
+
+int Ecan1Receive(CanMessage *msg, uint8_t *messagesLeft)
+{
+    _ecan1Service();
+    int foundOne = CFQ_Pop(&ecan1RxQueue, msg);
+
+    if (messagesLeft) {
+        *messagesLeft = CFQ_GetDepth(&ecan1RxQueue);
+    }
+
+    return foundOne;
+}
+
+uint8_t Ecan1ReceiveMany(CanMessage *msgs, uint8_t maxMessages, uint8_t *messagesLeft)
+{
+    _ecan1Service();
+    uint8_t found = CFQ_PopMany(&ecan1RxQueue, msgs, maxMessages);
+
+    if (messagesLeft) {
+        *messagesLeft = CFQ_GetDepth(&ecan1RxQueue);
+    }
+
+    return found;
+}
+
+void Ecan1SetMonitor(CanBusMonitor *m)
+{
+    monitor = m;
+}
+
+void Ecan1TickMonitor(void)
+{
+    if (monitor) {
+        _ecan1Service();
+        CanBusMonitorTick(monitor);
+    }
+}
+
+bool Ecan1GetMonitorTotals(CanBusMonitorTotals *totals)
+{
+    bool found = false;
+    if (monitor) {
+        CanBusMonitorGetTotals(monitor, totals);
+        found = true;
+    }
+    return found;
+}
+
+bool Ecan1GetMonitorEntry(uint8_t index, CanBusMonitorEntry *entry)
+{
+    bool found = false;
+    if (monitor && index < monitor->Used) {
+        *entry = monitor->Entries[index];
+        found = true;
+    }
+    return found;
+}
+
+bool Ecan1GetMonitorSource(uint8_t index, CanBusMonitorSource *source)
+{
+    bool found = false;
+    if (monitor && index < CAN_BUS_MONITOR_SOURCES && monitor->Sources[index].Used) {
+        *source = monitor->Sources[index];
+        found = true;
+    }
+    return found;
+}
+
+void Ecan1GetQueueStats(EcanQueueStats *stats)
+{
+    stats->rxDepth = CFQ_GetDepth(&ecan1RxQueue);
+    stats->rxHighWater = CFQ_GetHighWater(&ecan1RxQueue);
+    stats->txDepth = EcanTxGetDepth(&ecan1Tx);
+    stats->txHighWater = EcanTxGetHighWater(&ecan1Tx);
+}
+
+bool Ecan1Transmit(const CanMessage *msg)
+{
+    return Ecan1TransmitPriority(msg, ECAN_TX_PRIORITY_NORMAL);
+}
+
+bool Ecan1TransmitPriority(const CanMessage *msg, EcanTxPriority priority)
+{
+    if (!EcanTxQueue(&ecan1Tx, msg, priority)) {
+        txBufferOverflow = true;
+        return false;
+    }
+    _ecan1Service();
+
+    return true;
+}
+
+EcanStatus Ecan1GetErrorStatus(void)
+{
+    EcanStatus status = {};
+
+    // Set overflow errors. The virtual bus never has transmission or reception errors.
+    if (txBufferOverflow) {
+        status.TxBufferOverflow = 1;
+        txBufferOverflow = false;
+    }
+    if (rxBufferOverflow) {
+        status.RxBufferOverflow = 1;
+        rxBufferOverflow = false;
+    }
+    status.TxError = ECAN_ERROR_NONE;
+    status.RxError = ECAN_ERROR_NONE;
+
+    return status;
+}
+
+void Ecan1GetErrorCounts(uint8_t *txErrors, uint8_t *rxErrors)
+{
+    *txErrors = 0;
+    *rxErrors = 0;
+}
+
+void DmaInit(const uint16_t parameters[6])
+{
+    (void)parameters;
+}
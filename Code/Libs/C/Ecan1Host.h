@@ -0,0 +1,45 @@
+/**
+ * @file   Ecan1Host.h
+ * @brief  Runs node code that uses Ecan1.h as a Linux process, on a virtual CAN bus.
+ *
+ * Ecan1Host.c implements everything in Ecan1.h on a VirtualCan bus instead of the ECAN module, so
+ * node code builds for the host by compiling it instead of Ecan1.c. Node processes attached to the
+ * same bus then exchange frames just like the nodes do on the boat. Transmission is scheduled into
+ * buffers with EcanTxScheduler like on the dsPIC, and the acceptance filters given to
+ * Ecan1InitFiltered() are applied by the bus.
+ *
+ * There are no interrupts on the host, so the bus is serviced whenever the node calls into
+ * Ecan1: received frames are only queued once the node checks for them, and a node that stops
+ * calling in stops sending.
+ *
+ * The bus is picked with Ecan1HostSetBus() before calling Ecan1Init() or Ecan1InitFiltered(). By
+ * default nodes attach to a shared memory bus named "autoboat", which runs at the bit rate the
+ * first node to attach initializes ECAN1 with.
+ */
+#ifndef ECAN1_HOST_H
+#define ECAN1_HOST_H
+
+#include <stdbool.h>
+
+#include "VirtualCan.h"
+
+/**
+ * Picks the bus the next call to Ecan1Init() or Ecan1InitFiltered() attaches to.
+ * @param name The name of a shared memory bus, or of a SocketCAN interface like "vcan0".
+ * @param socketCan Whether `name` is a SocketCAN interface.
+ * @param config How a newly created shared memory bus behaves, or NULL to run it at the bit rate
+ *               ECAN1 is initialized with. With SocketCAN, only the loss injection applies.
+ */
+void Ecan1HostSetBus(const char *name, bool socketCan, const VirtualCanConfig *config);
+
+/**
+ * Returns the statistics of this node on the bus.
+ */
+void Ecan1HostGetStats(VirtualCanStats *stats);
+
+/**
+ * Detaches from the bus, dropping anything still queued.
+ */
+void Ecan1HostClose(void);
+
+#endif // ECAN1_HOST_H
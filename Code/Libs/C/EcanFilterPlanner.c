@@ -0,0 +1,463 @@
+#include "EcanFilterPlanner.h"
+
+// The bits of a 29-bit ID, laid out like in the ECAN registers, that a standard ID is compared in.
+#define STANDARD_BITS 0x1FFC0000UL
+// The data page, PDU format and PDU specific bits of an extended ID, which make up a PGN.
+#define PGN_BITS      0x03FFFF00UL
+// The PDU specific bits, which are a destination address for PDU1 PGNs.
+#define PS_BITS       0x0000FF00UL
+
+// The kinds of targets, which can't share a mask as they're matched on different bits.
+enum {
+	CLASS_STANDARD,
+	CLASS_PDU2,
+	CLASS_PDU1
+};
+
+// The register bits that mark a filter as extended and make a mask match it.
+#define EXIDE 0x0008
+#define MIDE  0x0008
+
+/**
+ * A target as the ID bits it needs, laid out like in the ECAN registers.
+ */
+typedef struct {
+	uint32_t Value;
+	uint32_t Care;
+	uint8_t Class;
+} Pattern;
+
+/**
+ * Converts a target into the bits it's matched on.
+ * @return False if it isn't valid.
+ */
+static bool ToPattern(const EcanFilterTarget *t, Pattern *p)
+{
+	if (!t->Pgn) {
+		if (t->Id > 0x7FF) {
+			return false;
+		}
+		p->Value = t->Id << 18;
+		p->Care = STANDARD_BITS;
+		p->Class = CLASS_STANDARD;
+		return true;
+	}
+
+	if (t->Id > 0x3FFFF) {
+		return false;
+	}
+	p->Value = t->Id << 8;
+	if (((t->Id >> 8) & 0xFF) < 240) {
+		if (t->Id & 0xFF) {
+			return false;
+		}
+		p->Care = PGN_BITS & ~PS_BITS;
+		p->Class = CLASS_PDU1;
+	} else {
+		p->Care = PGN_BITS;
+		p->Class = CLASS_PDU2;
+	}
+	return true;
+}
+
+/**
+ * The number of IDs a filter using `mask` accepts: standard IDs, or PGN/destination pairs.
+ */
+static uint32_t Span(uint8_t class, uint32_t mask)
+{
+	uint32_t free = (class == CLASS_STANDARD ? STANDARD_BITS : PGN_BITS) & ~mask;
+	uint32_t span = 1;
+	for (; free; free &= free - 1) {
+		span <<= 1;
+	}
+	return span;
+}
+
+/**
+ * The number of IDs a target is, counted like Span().
+ */
+static uint32_t Slots(const Pattern *p)
+{
+	return (p->Class == CLASS_PDU1) ? 256 : 1;
+}
+
+/**
+ * Counts the filters the targets using mask register `m` need if it's set to `mask`, and the
+ * unwanted IDs they accept.
+ */
+static uint8_t CountFilters(const Pattern *patterns, const uint8_t *maskOf, uint8_t count, uint8_t m, uint32_t mask,
+                            uint32_t *falseAccepts)
+{
+	uint8_t filters = 0, i, j;
+	uint32_t accepted = 0, wanted = 0;
+	for (i = 0; i < count; ++i) {
+		if (maskOf[i] != m) {
+			continue;
+		}
+		for (j = 0; j < i; ++j) {
+			if (maskOf[j] == m && !((patterns[i].Value ^ patterns[j].Value) & mask)) {
+				break;
+			}
+		}
+		if (j == i) {
+			++filters;
+			accepted += Span(patterns[i].Class, mask);
+		}
+		wanted += Slots(&patterns[i]);
+	}
+	*falseAccepts = accepted - wanted;
+	return filters;
+}
+
+/**
+ * Converts an ID laid out like in the ECAN registers into the SID and EID register values.
+ */
+static void ToRegisters(uint32_t id, uint16_t flags, uint16_t *sid, uint16_t *eid)
+{
+	*sid = (uint16_t)(((id >> 18) & 0x7FF) << 5) | flags | (uint16_t)((id >> 16) & 0x3);
+	*eid = (uint16_t)id;
+}
+
+static uint32_t FromRegisters(uint16_t sid, uint16_t eid)
+{
+	return ((uint32_t)(sid >> 5) << 18) | ((uint32_t)(sid & 0x3) << 16) | eid;
+}
+
+bool EcanFilterPlan(const EcanFilterTarget *targets, uint8_t count, EcanFilterRegisters *regs, uint32_t *falseAccepts)
+{
+	static const uint32_t exactMasks[] = {STANDARD_BITS, PGN_BITS, PGN_BITS & ~PS_BITS};
+	Pattern patterns[ECAN_FILTER_MAX_TARGETS];
+	uint8_t maskOf[ECAN_FILTER_MAX_TARGETS]; // The mask register every target uses.
+	uint8_t moved[ECAN_FILTER_MAX_TARGETS];
+	uint32_t masks[ECAN_FILTER_MASK_COUNT] = {0};
+	uint8_t filters[ECAN_FILTER_MASK_COUNT];
+	uint32_t costs[ECAN_FILTER_MASK_COUNT];
+	uint8_t n = 0, used = 0, total, i, j, k, m, class;
+
+	if (!count || count > ECAN_FILTER_MAX_TARGETS) {
+		return false;
+	}
+
+	// Listing the same ID twice doesn't take another filter.
+	for (i = 0; i < count; ++i) {
+		if (!ToPattern(&targets[i], &patterns[n])) {
+			return false;
+		}
+		for (j = 0; j < n; ++j) {
+			if (patterns[j].Class == patterns[n].Class && patterns[j].Value == patterns[n].Value) {
+				break;
+			}
+		}
+		if (j == n) {
+			++n;
+		}
+	}
+
+	// Start out with an exact mask for every class of targets.
+	for (class = 0; class < ECAN_FILTER_MASK_COUNT; ++class) {
+		bool found = false;
+		for (i = 0; i < n; ++i) {
+			if (patterns[i].Class == class) {
+				maskOf[i] = used;
+				found = true;
+			}
+		}
+		if (found) {
+			masks[used++] = exactMasks[class];
+		}
+	}
+
+	// Then merge filters until they all fit, picking whatever merge lets through the fewest unwanted
+	// IDs per filter saved. Filters saved beyond what's needed aren't worth anything. Two targets are
+	// merged into one filter by clearing the mask bits they differ in, either in the mask they use,
+	// which affects all of its other filters too, or in an exact mask of their class in a spare mask
+	// register, which they and whatever targets then match move to.
+	while (true) {
+		uint8_t bestI = 0, bestM = 0, bestSaved = 0;
+		uint32_t bestMask = 0;
+		int32_t bestAdded = 0;
+		bool bestSpare = false;
+
+		for (m = 0, total = 0; m < used; ++m) {
+			filters[m] = CountFilters(patterns, maskOf, n, m, masks[m], &costs[m]);
+			total += filters[m];
+		}
+		if (total <= ECAN_FILTER_COUNT) {
+			break;
+		}
+
+		for (i = 0; i < n; ++i) {
+			m = maskOf[i];
+			for (j = i + 1; j < n; ++j) {
+				uint8_t spare;
+				if (maskOf[j] != m) {
+					continue;
+				}
+				for (spare = 0; spare < 2; ++spare) {
+					const uint32_t mask = (spare ? exactMasks[patterns[i].Class] : masks[m]) & ~(patterns[i].Value ^ patterns[j].Value);
+					uint32_t cost, spareCost = 0;
+					uint8_t f, saved;
+					int32_t added;
+					if (spare && used == ECAN_FILTER_MASK_COUNT) {
+						continue;
+					}
+					if (spare) {
+						for (k = 0; k < n; ++k) {
+							moved[k] = (maskOf[k] == m && !((patterns[k].Value ^ patterns[i].Value) & mask)) ? used : maskOf[k];
+						}
+						f = CountFilters(patterns, moved, n, m, masks[m], &cost) +
+						    CountFilters(patterns, moved, n, used, mask, &spareCost);
+					} else {
+						f = CountFilters(patterns, maskOf, n, m, mask, &cost);
+					}
+					if (f >= filters[m]) {
+						continue;
+					}
+					added = (int32_t)(cost + spareCost) - (int32_t)costs[m];
+					saved = filters[m] - f;
+					if (saved > total - ECAN_FILTER_COUNT) {
+						saved = total - ECAN_FILTER_COUNT;
+					}
+					if (!bestSaved || (int64_t)added * bestSaved < (int64_t)bestAdded * saved) {
+						bestI = i;
+						bestM = m;
+						bestMask = mask;
+						bestSpare = spare;
+						bestSaved = saved;
+						bestAdded = added;
+					}
+				}
+			}
+		}
+
+		if (bestSpare) {
+			for (k = 0; k < n; ++k) {
+				if (maskOf[k] == bestM && !((patterns[k].Value ^ patterns[bestI].Value) & bestMask)) {
+					maskOf[k] = used;
+				}
+			}
+			masks[used++] = bestMask;
+		} else {
+			masks[bestM] = bestMask;
+		}
+	}
+
+	// And finally lay every distinct filter out in the registers.
+	regs->MaskSelect[0] = 0;
+	regs->MaskSelect[1] = 0;
+	regs->Enable = 0;
+	for (m = 0; m < ECAN_FILTER_MASK_COUNT; ++m) {
+		ToRegisters(masks[m], MIDE, &regs->MaskSid[m], &regs->MaskEid[m]);
+	}
+	total = 0;
+	for (i = 0; i < n; ++i) {
+		const uint32_t mask = masks[maskOf[i]];
+		for (j = 0; j < total; ++j) {
+			const uint8_t select = (regs->MaskSelect[j / 8] >> (2 * (j % 8))) & 0x3;
+			if (select == maskOf[i] && !((FromRegisters(regs->FilterSid[j], regs->FilterEid[j]) ^ patterns[i].Value) & mask)) {
+				break;
+			}
+		}
+		if (j == total) {
+			ToRegisters(patterns[i].Value & mask, patterns[i].Class == CLASS_STANDARD ? 0 : EXIDE,
+			            &regs->FilterSid[total], &regs->FilterEid[total]);
+			regs->MaskSelect[total / 8] |= (uint16_t)maskOf[i] << (2 * (total % 8));
+			regs->Enable |= 1 << total;
+			++total;
+		}
+	}
+	for (j = total; j < ECAN_FILTER_COUNT; ++j) {
+		regs->FilterSid[j] = 0;
+		regs->FilterEid[j] = 0;
+	}
+
+	if (falseAccepts) {
+		*falseAccepts = 0;
+		for (m = 0; m < used; ++m) {
+			*falseAccepts += costs[m];
+		}
+	}
+	return true;
+}
+
+bool EcanFilterAccepts(const EcanFilterRegisters *regs, uint32_t id, bool extended)
+{
+	const uint32_t frame = extended ? id : id << 18;
+	uint8_t i;
+	for (i = 0; i < ECAN_FILTER_COUNT; ++i) {
+		uint32_t mask = 0;
+		uint8_t select;
+		if (!(regs->Enable & (1 << i))) {
+			continue;
+		}
+
+		// Mask 3 means no mask, so every frame of the filter's type is accepted.
+		select = (regs->MaskSelect[i / 8] >> (2 * (i % 8))) & 0x3;
+		if (select < ECAN_FILTER_MASK_COUNT) {
+			mask = FromRegisters(regs->MaskSid[select], regs->MaskEid[select]);
+			if ((regs->MaskSid[select] & MIDE) && ((regs->FilterSid[i] & EXIDE) != 0) != extended) {
+				continue;
+			}
+		} else if (((regs->FilterSid[i] & EXIDE) != 0) != extended) {
+			continue;
+		}
+
+		// Standard frames only have an SID to compare.
+		if (!extended) {
+			mask &= STANDARD_BITS;
+		}
+		if (!((frame ^ FromRegisters(regs->FilterSid[i], regs->FilterEid[i])) & mask)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool EcanFilterWanted(const EcanFilterTarget *targets, uint8_t count, uint32_t id, bool extended)
+{
+	const uint32_t frame = extended ? id : id << 18;
+	uint8_t i;
+	for (i = 0; i < count; ++i) {
+		Pattern p;
+		if (targets[i].Pgn == extended && ToPattern(&targets[i], &p) && !((frame ^ p.Value) & p.Care)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+#ifdef UNIT_TEST_ECAN_FILTER_PLANNER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+/**
+ * Checks every standard ID and every PGN/destination pair, with a random priority and source, against
+ * the filters. No target may be rejected.
+ * @return The unwanted IDs that were accepted, counted like EcanFilterPlan() does.
+ */
+static uint32_t CheckAll(const EcanFilterTarget *targets, uint8_t count, const EcanFilterRegisters *regs)
+{
+	uint32_t id, falseAccepts = 0;
+	for (id = 0; id <= 0x7FF; ++id) {
+		const bool wanted = EcanFilterWanted(targets, count, id, false);
+		const bool accepted = EcanFilterAccepts(regs, id, false);
+		assert(accepted || !wanted);
+		falseAccepts += accepted && !wanted;
+	}
+	for (id = 0; id <= 0x3FFFF; ++id) {
+		const uint32_t frame = ((uint32_t)(rand() & 0x7) << 26) | (id << 8) | (rand() & 0xFF);
+		const bool wanted = EcanFilterWanted(targets, count, frame, true);
+		const bool accepted = EcanFilterAccepts(regs, frame, true);
+		assert(accepted || !wanted);
+		falseAccepts += accepted && !wanted;
+	}
+	return falseAccepts;
+}
+
+static uint8_t EnabledFilters(const EcanFilterRegisters *regs)
+{
+	uint8_t i, n = 0;
+	for (i = 0; i < ECAN_FILTER_COUNT; ++i) {
+		n += (regs->Enable >> i) & 1;
+	}
+	return n;
+}
+
+int main(void)
+{
+	EcanFilterRegisters regs;
+	uint32_t falseAccepts;
+	uint8_t i;
+
+	srand(1);
+
+	// Invalid targets.
+	{
+		const EcanFilterTarget tooLong = {0x800, false}, tooLongPgn = {0x40000, true}, addressed = {59904 + 5, true};
+		assert(!EcanFilterPlan(&tooLong, 1, &regs, NULL));
+		assert(!EcanFilterPlan(&tooLongPgn, 1, &regs, NULL));
+		assert(!EcanFilterPlan(&addressed, 1, &regs, NULL));
+		assert(!EcanFilterPlan(&tooLong, 0, &regs, NULL));
+		assert(!EcanFilterPlan(&tooLong, ECAN_FILTER_MAX_TARGETS + 1, &regs, NULL));
+	}
+
+	// A single standard ID, like the RC node's, is matched exactly, and extended frames with the same
+	// bits aren't let through.
+	{
+		const EcanFilterTarget status = {0x090, false};
+		assert(EcanFilterPlan(&status, 1, &regs, &falseAccepts));
+		assert(falseAccepts == 0 && EnabledFilters(&regs) == 1);
+		assert(EcanFilterAccepts(&regs, 0x090, false));
+		assert(!EcanFilterAccepts(&regs, 0x091, false));
+		assert(!EcanFilterAccepts(&regs, 0x090UL << 18, true));
+		assert(CheckAll(&status, 1, &regs) == 0);
+	}
+
+	// Up to 16 targets of all three kinds fit exactly, with duplicates sharing a filter.
+	{
+		const EcanFilterTarget targets[] = {
+			{0x080, false}, {0x081, false}, {0x082, false}, {0x090, false}, {0x090, false},
+			{127245, true}, {129025, true}, {130306, true}, {127245, true},
+			{59904, true}, {60928, true}, {126208, true}
+		};
+		const uint8_t count = sizeof(targets) / sizeof(targets[0]);
+		assert(EcanFilterPlan(targets, count, &regs, &falseAccepts));
+		assert(falseAccepts == 0 && EnabledFilters(&regs) == 10);
+		assert(CheckAll(targets, count, &regs) == 0);
+
+		// PDU1 PGNs are accepted for any destination and source.
+		assert(EcanFilterAccepts(&regs, 0x18EA0512, true));
+		assert(EcanFilterAccepts(&regs, 0x18EAFF00, true));
+		assert(!EcanFilterAccepts(&regs, 0x18EB0512, true));
+		// PDU2 PGNs for any priority and source.
+		assert(EcanFilterAccepts(&regs, 0x09F10D23, true));
+		assert(EcanFilterAccepts(&regs, 0x1DF10DFE, true));
+		assert(!EcanFilterAccepts(&regs, 0x09F10E23, true));
+	}
+
+	// The primary node's targets don't fit, so some have to share filters. Whatever is let through on
+	// top has to match what the planner counted.
+	{
+		const EcanFilterTarget targets[] = {
+			{0x402, false}, {0x301, false}, {0x090, false}, {0x080, false}, {0x102, false},
+			{0x106, false}, {0x107, false}, {0x108, false}, {0x109, false}, {0x10A, false},
+			{126992, true}, {127245, true}, {127508, true}, {128259, true}, {128267, true},
+			{129025, true}, {129026, true}, {129539, true}, {130306, true}, {130310, true},
+			{130311, true}, {127173, true}, {129029, true}
+		};
+		const uint8_t count = sizeof(targets) / sizeof(targets[0]);
+		assert(EcanFilterPlan(targets, count, &regs, &falseAccepts));
+		assert(EnabledFilters(&regs) <= ECAN_FILTER_COUNT);
+		assert(CheckAll(targets, count, &regs) == falseAccepts);
+		printf("Primary node: %u targets in %u filters, %u false accepts of %u standard IDs and %u PGN/destination pairs.\n",
+		       count, EnabledFilters(&regs), falseAccepts, 0x800, 0x40000);
+	}
+
+	// Random sets of targets never lose a wanted frame and always fit.
+	for (i = 0; i < 20; ++i) {
+		EcanFilterTarget targets[ECAN_FILTER_MAX_TARGETS];
+		const uint8_t count = 1 + rand() % ECAN_FILTER_MAX_TARGETS;
+		uint8_t j;
+		for (j = 0; j < count; ++j) {
+			targets[j].Pgn = rand() % 2;
+			if (!targets[j].Pgn) {
+				targets[j].Id = rand() & 0x7FF;
+			} else if (rand() % 4) {
+				targets[j].Id = 0x1F000 | (rand() & 0xFFF);
+			} else {
+				targets[j].Id = (rand() & 0x1EF) << 8;
+			}
+		}
+		assert(EcanFilterPlan(targets, count, &regs, &falseAccepts));
+		assert(EnabledFilters(&regs) <= ECAN_FILTER_COUNT);
+		// Filters of different classes can overlap, which is counted twice.
+		assert(CheckAll(targets, count, &regs) <= falseAccepts);
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_ECAN_FILTER_PLANNER
@@ -0,0 +1,80 @@
+/**
+ * @file   EcanFilterPlanner.h
+ * @brief  Plans the hardware acceptance filters of a dsPIC33 ECAN module.
+ *
+ * The ECAN module can reject frames in hardware before they reach the reception buffer, DMA, and
+ * the receive interrupt, using 16 filters that each compare the bits of a frame's ID selected by one
+ * of 3 masks. A node lists the standard IDs and NMEA2000 PGNs it actually handles, and
+ * EcanFilterPlan() works out filters and masks that accept all of them and as little else as it can.
+ *
+ * PGNs are matched regardless of the priority and source address of a frame, and PDU1 PGNs, which
+ * carry a destination address, regardless of that too. This matches Iso11783Decode().
+ *
+ * When there are more IDs than filters, IDs have to share filters with coarser masks, which lets
+ * some unwanted frames through. The planner starts with an exact mask each for the standard IDs,
+ * PDU2 PGNs, and PDU1 PGNs there are, and then repeatedly merges whichever filters cost the fewest
+ * false accepts per filter saved until everything fits, either by coarsening a mask or by moving
+ * some IDs onto a coarser mask of their own in a spare mask register. False accepts are counted as
+ * the unwanted standard IDs and PGN/destination pairs the filters let through. This is cheap enough
+ * to run at startup.
+ *
+ * Unit testing is done on x86 by compiling with the UNIT_TEST_ECAN_FILTER_PLANNER macro:
+ * `gcc EcanFilterPlanner.c -DUNIT_TEST_ECAN_FILTER_PLANNER -I. -O2 -Wall`
+ * How the nodes' filters fare against recorded bus traffic is reported by
+ * Scripts/C/EcanFilterReport.c.
+ */
+#ifndef ECAN_FILTER_PLANNER_H
+#define ECAN_FILTER_PLANNER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// The acceptance filters and masks of an ECAN module.
+#define ECAN_FILTER_COUNT 16
+#define ECAN_FILTER_MASK_COUNT 3
+
+// The most IDs a single plan can cover.
+#define ECAN_FILTER_MAX_TARGETS 32
+
+/**
+ * A standard ID or PGN a node receives.
+ */
+typedef struct {
+	uint32_t Id;  // A standard 11-bit ID, or a PGN.
+	bool Pgn;     // Whether Id is a PGN, received in extended frames.
+} EcanFilterTarget;
+
+/**
+ * The acceptance filter configuration of an ECAN module, as the values of its registers. Every
+ * filter is meant to store into the same reception buffer, so the buffer pointers aren't included.
+ */
+typedef struct {
+	uint16_t MaskSid[ECAN_FILTER_MASK_COUNT];   // CiRXMnSID
+	uint16_t MaskEid[ECAN_FILTER_MASK_COUNT];   // CiRXMnEID
+	uint16_t FilterSid[ECAN_FILTER_COUNT];      // CiRXFnSID
+	uint16_t FilterEid[ECAN_FILTER_COUNT];      // CiRXFnEID
+	uint16_t MaskSelect[2];                     // CiFMSKSEL1 and CiFMSKSEL2
+	uint16_t Enable;                            // CiFEN1
+} EcanFilterRegisters;
+
+/**
+ * Plans the acceptance filters for a set of IDs.
+ * @param falseAccepts If not NULL, set to the unwanted IDs the filters accept, see above.
+ * @return False if there are no targets or more than ECAN_FILTER_MAX_TARGETS, a standard ID doesn't
+ *         fit 11 bits, a PGN doesn't fit 18 bits, or a PDU1 PGN has a destination address in it.
+ */
+bool EcanFilterPlan(const EcanFilterTarget *targets, uint8_t count, EcanFilterRegisters *regs, uint32_t *falseAccepts);
+
+/**
+ * Decides whether a frame passes the acceptance filters, like the ECAN module would.
+ * @param id The 11-bit or 29-bit ID of the frame.
+ */
+bool EcanFilterAccepts(const EcanFilterRegisters *regs, uint32_t id, bool extended);
+
+/**
+ * Decides whether a frame is one of the targets.
+ * @param id The 11-bit or 29-bit ID of the frame.
+ */
+bool EcanFilterWanted(const EcanFilterTarget *targets, uint8_t count, uint32_t id, bool extended);
+
+#endif // ECAN_FILTER_PLANNER_H
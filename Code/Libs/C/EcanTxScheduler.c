@@ -0,0 +1,705 @@
+/**
+ * @file   EcanTxScheduler.c
+ * @brief  Decides which queued CAN frames go into which ECAN transmission buffers.
+ *
+ * See EcanTxScheduler.h for details.
+ */
+#include "EcanTxScheduler.h"
+
+#include <stddef.h>
+
+bool EcanTxInit(EcanTxScheduler *s, CanMessage *const storage[ECAN_TX_PRIORITY_COUNT],
+                const uint8_t capacity[ECAN_TX_PRIORITY_COUNT], const EcanTxPriority *slotPriority,
+                uint8_t slotCount)
+{
+	uint8_t i, p;
+
+	if (!s || !slotPriority || slotCount == 0 || slotCount > ECAN_TX_MAX_SLOTS) {
+		return false;
+	}
+
+	for (p = 0; p < ECAN_TX_PRIORITY_COUNT; ++p) {
+		if (!CFQ_Init(&s->queues[p], storage[p], capacity[p])) {
+			return false;
+		}
+	}
+
+	// Every priority needs a slot, or its frames would never be sent.
+	for (i = 0; i < slotCount; ++i) {
+		if ((uint8_t)slotPriority[i] >= ECAN_TX_PRIORITY_COUNT) {
+			return false;
+		}
+		s->slotPriority[i] = slotPriority[i];
+	}
+	for (p = 0; p < ECAN_TX_PRIORITY_COUNT; ++p) {
+		for (i = 0; i < slotCount && s->slotPriority[i] != p; ++i);
+		if (i == slotCount) {
+			return false;
+		}
+	}
+
+	s->slotCount = slotCount;
+	s->loaded = 0;
+	s->highWater = 0;
+
+	return true;
+}
+
+bool EcanTxQueue(EcanTxScheduler *s, const CanMessage *msg, EcanTxPriority priority)
+{
+	uint8_t depth;
+
+	if ((uint8_t)priority >= ECAN_TX_PRIORITY_COUNT || !CFQ_Push(&s->queues[priority], msg)) {
+		return false;
+	}
+
+	depth = EcanTxGetDepth(s);
+	if (depth > s->highWater) {
+		s->highWater = depth;
+	}
+
+	return true;
+}
+
+int8_t EcanTxNext(EcanTxScheduler *s, CanMessage *msg)
+{
+	uint8_t p, i;
+
+	for (p = 0; p < ECAN_TX_PRIORITY_COUNT; ++p) {
+		const CanMessage *head = CFQ_Peek(&s->queues[p]);
+		int8_t slot = -1;
+
+		if (!head) {
+			continue;
+		}
+
+		// Find the first free slot of this priority that is sent after all of its loaded ones.
+		for (i = 0; i < s->slotCount; ++i) {
+			if (s->slotPriority[i] != p) {
+				continue;
+			}
+			if (s->loaded & (1 << i)) {
+				slot = -1;
+			} else if (slot < 0) {
+				slot = i;
+			}
+		}
+
+		if (slot >= 0) {
+			CFQ_Pop(&s->queues[p], msg);
+			s->loaded |= 1 << slot;
+			return slot;
+		}
+	}
+
+	return -1;
+}
+
+void EcanTxSent(EcanTxScheduler *s, uint8_t slot)
+{
+	s->loaded &= ~(1 << slot);
+}
+
+bool EcanTxIsLoaded(const EcanTxScheduler *s, uint8_t slot)
+{
+	return (s->loaded & (1 << slot)) != 0;
+}
+
+uint8_t EcanTxGetDepth(const EcanTxScheduler *s)
+{
+	uint8_t p, depth = 0;
+
+	for (p = 0; p < ECAN_TX_PRIORITY_COUNT; ++p) {
+		depth += CFQ_GetDepth(&s->queues[p]);
+	}
+
+	return depth;
+}
+
+uint8_t EcanTxGetHighWater(const EcanTxScheduler *s)
+{
+	return s->highWater;
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_ECAN_TX_SCHEDULER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "Acs300.h"
+
+static CanMessage MakeFrame(uint32_t id, uint8_t frameType, uint8_t validBytes)
+{
+	CanMessage m;
+	memset(&m, 0, sizeof(m));
+	m.id = id;
+	m.frame_type = frameType;
+	m.message_type = CAN_MSG_DATA;
+	m.validBytes = validBytes;
+	return m;
+}
+
+/**
+ * Initializes a scheduler with 4-frame queues and the given slots.
+ */
+static bool InitScheduler(EcanTxScheduler *s, CanMessage storage[ECAN_TX_PRIORITY_COUNT][4],
+                          const EcanTxPriority *slots, uint8_t slotCount)
+{
+	CanMessage *const queues[ECAN_TX_PRIORITY_COUNT] = {storage[0], storage[1], storage[2]};
+	const uint8_t capacity[ECAN_TX_PRIORITY_COUNT] = {4, 4, 4};
+	return EcanTxInit(s, queues, capacity, slots, slotCount);
+}
+
+/**
+ * The transmission side of the ECAN module at the register level: the buffer control registers
+ * C1TR01CON to C1TR67CON and the message buffers in DMA RAM. Buffers are configured and loaded
+ * the same way Ecan1.c does it, and the module picks the buffer it offers the bus from the loaded
+ * ones by TXnPRI and then buffer number.
+ */
+static uint16_t mockTrCon[4];
+static uint16_t mockMsgBuf[8][8];
+
+static void MockConfigureTx(uint8_t buffer, uint8_t txPri)
+{
+	mockTrCon[buffer >> 1] |= (0x0080 | txPri) << ((buffer & 1) << 3);
+}
+
+static bool MockTxRequested(uint8_t buffer)
+{
+	return (mockTrCon[buffer >> 1] & (1 << (3 | ((buffer & 1) << 3)))) != 0;
+}
+
+static void MockLoad(const CanMessage *message, uint8_t buffer)
+{
+	volatile uint16_t *ecan_msg_buf_ptr = mockMsgBuf[buffer];
+	uint16_t word0 = 0, word1 = 0, word2 = 0;
+
+	if (message->frame_type == CAN_FRAME_EXT) {
+		word0 = 1 | (((message->id >> 18) & 0x7FF) << 2);
+		word1 = (message->id >> 6) & 0xFFF;
+		word2 = (message->id & 0x3F) << 10;
+	} else {
+		word0 = (message->id & 0x7FF) << 2;
+	}
+	ecan_msg_buf_ptr[0] = word0;
+	ecan_msg_buf_ptr[1] = word1;
+	ecan_msg_buf_ptr[2] = ((word2 & 0xFFF0) + message->validBytes);
+	ecan_msg_buf_ptr[3] = ((uint16_t)message->payload[1] << 8 | ((uint16_t)message->payload[0]));
+	ecan_msg_buf_ptr[4] = ((uint16_t)message->payload[3] << 8 | ((uint16_t)message->payload[2]));
+	ecan_msg_buf_ptr[5] = ((uint16_t)message->payload[5] << 8 | ((uint16_t)message->payload[4]));
+	ecan_msg_buf_ptr[6] = ((uint16_t)message->payload[7] << 8 | ((uint16_t)message->payload[6]));
+
+	assert(!MockTxRequested(buffer));
+	mockTrCon[buffer >> 1] |= 1 << (3 | ((buffer & 1) << 3));
+}
+
+/**
+ * Returns the loaded buffer the module offers the bus, or -1 if there's none.
+ */
+static int8_t MockPick(void)
+{
+	int8_t best = -1;
+	uint8_t bestPri = 0;
+	uint8_t buffer;
+
+	for (buffer = 0; buffer < 8; ++buffer) {
+		const uint8_t reg = mockTrCon[buffer >> 1] >> ((buffer & 1) << 3);
+		if ((reg & 0x80) && (reg & 0x08) && (best < 0 || (reg & 3) >= bestPri)) {
+			best = buffer;
+			bestPri = reg & 3;
+		}
+	}
+
+	return best;
+}
+
+/**
+ * Reads a frame back out of a message buffer, like the reception code in Ecan1.c.
+ */
+static void MockRead(uint8_t buffer, CanMessage *m)
+{
+	const uint16_t *w = mockMsgBuf[buffer];
+	memset(m, 0, sizeof(*m));
+	if (w[0] & 1) {
+		m->frame_type = CAN_FRAME_EXT;
+		m->id = ((uint32_t)(w[0] & 0x1FFC) << 16) | ((uint32_t)(w[1] & 0x0FFF) << 6) | ((w[2] & 0xFC00) >> 10);
+	} else {
+		m->frame_type = CAN_FRAME_STD;
+		m->id = (w[0] & 0x1FFC) >> 2;
+	}
+	m->validBytes = w[2] & 0xF;
+	memcpy(m->payload, &w[3], 8);
+}
+
+static void MockSent(uint8_t buffer)
+{
+	mockTrCon[buffer >> 1] &= ~(1 << (3 | ((buffer & 1) << 3)));
+}
+
+// The transmission buffers and their priorities, as Ecan1.c configures them.
+static const uint8_t benchTxBuffers[] = {7, 6, 5, 4, 3, 2, 0};
+static const EcanTxPriority benchTxPriorities[] = {
+	ECAN_TX_PRIORITY_HIGH, ECAN_TX_PRIORITY_HIGH,
+	ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_NORMAL,
+	ECAN_TX_PRIORITY_LOW, ECAN_TX_PRIORITY_LOW
+};
+#define BENCH_TX_SLOTS (sizeof(benchTxBuffers) / sizeof(benchTxBuffers[0]))
+
+// The bus runs at 250kbit/s and is simulated a bit at a time. Frame lengths don't include stuff
+// bits, and include the 3 bits of interframe space, during which a sent buffer is already free.
+#define BENCH_BITRATE 250000UL
+#define BENCH_SECONDS 60UL
+#define BENCH_INTERFRAME 3
+#define BENCH_QUEUE_LENGTH 12
+
+// The primary node's traffic: every 10ms a burst of sensor telemetry followed by the rudder and
+// throttle commands of the control loop, and every 100ms its status. Other nodes fill about a
+// third of the bus on top of that.
+#define BENCH_PERIOD (BENCH_BITRATE / 100)
+#define BENCH_TELEMETRY_FRAMES 8
+#define BENCH_FOREIGN_FRAMES_PER_SECOND 650
+#define BENCH_RUDDER_ID 0x09F10D0AUL // PGN 127245 at priority 2 from node 10.
+#define BENCH_MAX_FRAMES (((BENCH_TELEMETRY_FRAMES + 3) * 100 + 10) * BENCH_SECONDS)
+#define BENCH_FOREIGN_PENDING 32
+
+typedef enum {
+	BENCH_SINGLE_BUFFER, // The original transmission code: one queue, one buffer in flight.
+	BENCH_SCHEDULED      // All transmission buffers kept loaded by an EcanTxScheduler.
+} BenchMode;
+
+typedef struct {
+	uint32_t offered[ECAN_TX_PRIORITY_COUNT];
+	uint32_t sent[ECAN_TX_PRIORITY_COUNT];
+	uint32_t dropped[ECAN_TX_PRIORITY_COUNT];
+	uint64_t latencySum[ECAN_TX_PRIORITY_COUNT]; // In bits, from being queued to being sent.
+	uint32_t latencyMax[ECAN_TX_PRIORITY_COUNT];
+	uint32_t idleWaiting; // Bits the bus was idle while this node had frames to send.
+	uint32_t reordered;   // Frames sent before an earlier frame with the same ID.
+} BenchResult;
+
+typedef struct {
+	BenchMode mode;
+	CanFrameQueue queue;           // BENCH_SINGLE_BUFFER
+	CanMessage slots[BENCH_QUEUE_LENGTH];
+	bool transmitting;
+	EcanTxScheduler scheduler;     // BENCH_SCHEDULED
+	CanMessage storage[ECAN_TX_PRIORITY_COUNT][BENCH_QUEUE_LENGTH];
+} BenchNode;
+
+static uint32_t benchRandom;
+
+static uint32_t BenchRandom(void)
+{
+	benchRandom = benchRandom * 1103515245 + 12345;
+	return benchRandom >> 8;
+}
+
+/**
+ * Compares the arbitration fields of two frames: the one with the lower key wins.
+ */
+static uint32_t ArbitrationKey(const CanMessage *m)
+{
+	if (m->frame_type == CAN_FRAME_EXT) {
+		return ((m->id >> 18) << 19) | (1UL << 18) | (m->id & 0x3FFFF);
+	}
+	return m->id << 19;
+}
+
+static uint32_t FrameBits(const CanMessage *m)
+{
+	return ((m->frame_type == CAN_FRAME_EXT) ? 64 : 44) + 8 * m->validBytes + BENCH_INTERFRAME;
+}
+
+static void BenchLoadAll(BenchNode *n)
+{
+	CanMessage m;
+	int8_t slot;
+	while ((slot = EcanTxNext(&n->scheduler, &m)) >= 0) {
+		MockLoad(&m, benchTxBuffers[slot]);
+	}
+}
+
+/**
+ * Ecan1Transmit() of either version.
+ */
+static bool BenchTransmit(BenchNode *n, const CanMessage *m, EcanTxPriority priority)
+{
+	if (n->mode == BENCH_SINGLE_BUFFER) {
+		if (!CFQ_Push(&n->queue, m)) {
+			return false;
+		}
+		if (!n->transmitting) {
+			MockLoad(m, 0);
+			n->transmitting = true;
+		}
+		return true;
+	}
+
+	if (!EcanTxQueue(&n->scheduler, m, priority)) {
+		return false;
+	}
+	BenchLoadAll(n);
+	return true;
+}
+
+/**
+ * The transmission part of _C1Interrupt() of either version.
+ */
+static void BenchInterrupt(BenchNode *n)
+{
+	if (n->mode == BENCH_SINGLE_BUFFER) {
+		const CanMessage *next;
+		CFQ_Pop(&n->queue, NULL);
+		next = CFQ_Peek(&n->queue);
+		if (next) {
+			MockLoad(next, 0);
+		} else {
+			n->transmitting = false;
+		}
+	} else {
+		uint8_t slot;
+		for (slot = 0; slot < BENCH_TX_SLOTS; ++slot) {
+			if (EcanTxIsLoaded(&n->scheduler, slot) && !MockTxRequested(benchTxBuffers[slot])) {
+				EcanTxSent(&n->scheduler, slot);
+			}
+		}
+		BenchLoadAll(n);
+	}
+}
+
+/**
+ * Runs BENCH_SECONDS of the mixed load through one version of the transmission code, with the
+ * transmission interrupt running `isrLatency` bits after a frame was sent.
+ */
+static void Benchmark(BenchMode mode, uint32_t isrLatency, BenchResult *r)
+{
+	static uint32_t queuedAt[BENCH_MAX_FRAMES];
+	static uint8_t queuedPriority[BENCH_MAX_FRAMES];
+	static BenchNode n;
+	CanMessage foreign[BENCH_FOREIGN_PENDING];
+	uint8_t foreignCount = 0;
+	uint32_t lastSerial[BENCH_TELEMETRY_FRAMES + 4];
+	uint32_t serial = 0;
+	const uint32_t end = BENCH_BITRATE * BENCH_SECONDS;
+	uint32_t t, i;
+
+	// The buffer of this node's frame on the bus, if any.
+	int8_t onBus = -1;
+	uint32_t sentAt = 0, busFreeAt = 0;
+	uint32_t interruptAt = UINT32_MAX;
+
+	memset(r, 0, sizeof(*r));
+	memset(lastSerial, 0xFF, sizeof(lastSerial));
+	memset(mockTrCon, 0, sizeof(mockTrCon));
+	benchRandom = 1;
+
+	n.mode = mode;
+	if (mode == BENCH_SINGLE_BUFFER) {
+		CFQ_Init(&n.queue, n.slots, BENCH_QUEUE_LENGTH);
+		n.transmitting = false;
+		MockConfigureTx(0, 3);
+	} else {
+		CanMessage *const queues[ECAN_TX_PRIORITY_COUNT] = {n.storage[0], n.storage[1], n.storage[2]};
+		const uint8_t capacity[ECAN_TX_PRIORITY_COUNT] = {4, BENCH_QUEUE_LENGTH, 4};
+		assert(EcanTxInit(&n.scheduler, queues, capacity, benchTxPriorities, BENCH_TX_SLOTS));
+		for (i = 0; i < BENCH_TX_SLOTS; ++i) {
+			MockConfigureTx(benchTxBuffers[i], 3 - benchTxPriorities[i]);
+		}
+	}
+
+	for (t = 0; t < end; ++t) {
+		// A frame has been sent.
+		if (onBus >= 0 && t == sentAt) {
+			CanMessage m;
+			uint32_t s, latency;
+			MockRead(onBus, &m);
+			MockSent(onBus);
+			s = m.payload[4] | ((uint32_t)m.payload[5] << 8) | ((uint32_t)m.payload[6] << 16) |
+			    ((uint32_t)m.payload[7] << 24);
+			latency = t - queuedAt[s];
+			++r->sent[queuedPriority[s]];
+			r->latencySum[queuedPriority[s]] += latency;
+			if (latency > r->latencyMax[queuedPriority[s]]) {
+				r->latencyMax[queuedPriority[s]] = latency;
+			}
+			if (lastSerial[m.payload[0]] != UINT32_MAX && lastSerial[m.payload[0]] > s) {
+				++r->reordered;
+			}
+			lastSerial[m.payload[0]] = s;
+			if (interruptAt == UINT32_MAX) {
+				interruptAt = t + isrLatency;
+			}
+			onBus = -1;
+		}
+
+		// The node queues its frames, tagged with the index of their ID and a serial number.
+		{
+			const uint32_t phase = t % BENCH_PERIOD;
+			CanMessage m;
+			EcanTxPriority priority;
+			uint8_t count = 0, k;
+			CanMessage frames[BENCH_TELEMETRY_FRAMES + 4];
+			EcanTxPriority priorities[BENCH_TELEMETRY_FRAMES + 4];
+			if (phase == 0) {
+				for (k = 0; k < BENCH_TELEMETRY_FRAMES; ++k) {
+					frames[count] = MakeFrame(0x0DF00000UL + ((k & 3) << 8) + 10, CAN_FRAME_EXT, 8);
+					priorities[count++] = ECAN_TX_PRIORITY_NORMAL;
+				}
+				frames[count] = MakeFrame(BENCH_RUDDER_ID, CAN_FRAME_EXT, 8);
+				priorities[count++] = ECAN_TX_PRIORITY_HIGH;
+				frames[count] = MakeFrame(ACS300_CAN_ID_VEL_CMD, CAN_FRAME_STD, 6);
+				priorities[count++] = ECAN_TX_PRIORITY_HIGH;
+				frames[count] = MakeFrame(ACS300_CAN_ID_WR_PARAM, CAN_FRAME_STD, 4);
+				priorities[count++] = ECAN_TX_PRIORITY_HIGH;
+				if (t % (10 * BENCH_PERIOD) == 0) {
+					frames[count] = MakeFrame(0x18FF000AUL, CAN_FRAME_EXT, 8);
+					priorities[count++] = ECAN_TX_PRIORITY_LOW;
+				}
+			}
+			for (k = 0; k < count; ++k) {
+				m = frames[k];
+				priority = priorities[k];
+				m.payload[0] = (k < BENCH_TELEMETRY_FRAMES) ? (k & 3) : k;
+				memcpy(&m.payload[4], &serial, 4);
+				queuedAt[serial] = t;
+				queuedPriority[serial] = priority;
+				++r->offered[priority];
+				if (BenchTransmit(&n, &m, priority)) {
+					++serial;
+				} else {
+					++r->dropped[priority];
+				}
+			}
+		}
+
+		// Other nodes queue theirs.
+		if (BenchRandom() % BENCH_BITRATE < BENCH_FOREIGN_FRAMES_PER_SECOND && foreignCount < BENCH_FOREIGN_PENDING) {
+			static const uint32_t foreignIds[] = {0x09F80103UL, 0x0DF50B05UL, 0x19F21106UL, 0x402};
+			const uint32_t id = foreignIds[BenchRandom() % 4];
+			foreign[foreignCount++] = MakeFrame(id, (id > 0x7FF) ? CAN_FRAME_EXT : CAN_FRAME_STD, 8);
+		}
+
+		if (t >= interruptAt) {
+			interruptAt = UINT32_MAX;
+			BenchInterrupt(&n);
+		}
+
+		// Start the next frame once the bus is free, letting the lowest ID win arbitration.
+		if (t >= busFreeAt) {
+			const int8_t buffer = MockPick();
+			int8_t winner = -1;
+			uint32_t bestKey = UINT32_MAX;
+			CanMessage m;
+			if (buffer >= 0) {
+				MockRead(buffer, &m);
+				bestKey = ArbitrationKey(&m);
+			}
+			for (i = 0; i < foreignCount; ++i) {
+				if (ArbitrationKey(&foreign[i]) < bestKey) {
+					bestKey = ArbitrationKey(&foreign[i]);
+					winner = i;
+				}
+			}
+			if (winner >= 0) {
+				busFreeAt = t + FrameBits(&foreign[winner]);
+				foreign[winner] = foreign[--foreignCount];
+			} else if (buffer >= 0) {
+				busFreeAt = t + FrameBits(&m);
+				sentAt = busFreeAt - BENCH_INTERFRAME;
+				onBus = buffer;
+			} else {
+				const bool waiting = (mode == BENCH_SINGLE_BUFFER) ?
+				        CFQ_GetDepth(&n.queue) > 0 : (n.scheduler.loaded || EcanTxGetDepth(&n.scheduler));
+				r->idleWaiting += waiting;
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	// Initialization.
+	{
+		EcanTxScheduler s;
+		CanMessage storage[ECAN_TX_PRIORITY_COUNT][4];
+		const EcanTxPriority slots[] = {ECAN_TX_PRIORITY_HIGH, ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_LOW};
+		const EcanTxPriority noLow[] = {ECAN_TX_PRIORITY_HIGH, ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_NORMAL};
+		const EcanTxPriority invalid[] = {ECAN_TX_PRIORITY_HIGH, ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_COUNT};
+		const EcanTxPriority many[ECAN_TX_MAX_SLOTS + 1] = {ECAN_TX_PRIORITY_HIGH, ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_LOW};
+		CanMessage *const noStorage[ECAN_TX_PRIORITY_COUNT] = {storage[0], NULL, storage[2]};
+		const uint8_t capacity[ECAN_TX_PRIORITY_COUNT] = {4, 4, 4};
+		assert(!InitScheduler(NULL, storage, slots, 3));
+		assert(!InitScheduler(&s, storage, slots, 0));
+		assert(!InitScheduler(&s, storage, many, ECAN_TX_MAX_SLOTS + 1));
+		assert(!InitScheduler(&s, storage, noLow, 3));
+		assert(!InitScheduler(&s, storage, invalid, 3));
+		assert(!EcanTxInit(&s, noStorage, capacity, slots, 3));
+		assert(InitScheduler(&s, storage, many, ECAN_TX_MAX_SLOTS));
+		assert(InitScheduler(&s, storage, slots, 3));
+		assert(EcanTxGetDepth(&s) == 0 && EcanTxGetHighWater(&s) == 0);
+		CanMessage m;
+		assert(EcanTxNext(&s, &m) == -1);
+	}
+
+	// The most urgent frame is loaded first, and each goes into a slot of its priority.
+	{
+		EcanTxScheduler s;
+		CanMessage storage[ECAN_TX_PRIORITY_COUNT][4];
+		const EcanTxPriority slots[] = {ECAN_TX_PRIORITY_LOW, ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_HIGH};
+		CanMessage m;
+		assert(InitScheduler(&s, storage, slots, 3));
+		m = MakeFrame(3, CAN_FRAME_STD, 1);
+		assert(EcanTxQueue(&s, &m, ECAN_TX_PRIORITY_LOW));
+		m = MakeFrame(2, CAN_FRAME_STD, 1);
+		assert(EcanTxQueue(&s, &m, ECAN_TX_PRIORITY_NORMAL));
+		m = MakeFrame(1, CAN_FRAME_STD, 1);
+		assert(EcanTxQueue(&s, &m, ECAN_TX_PRIORITY_HIGH));
+		assert(!EcanTxQueue(&s, &m, ECAN_TX_PRIORITY_COUNT));
+		assert(EcanTxGetDepth(&s) == 3 && EcanTxGetHighWater(&s) == 3);
+		assert(EcanTxNext(&s, &m) == 2 && m.id == 1);
+		assert(EcanTxNext(&s, &m) == 1 && m.id == 2);
+		assert(EcanTxNext(&s, &m) == 0 && m.id == 3);
+		assert(EcanTxNext(&s, &m) == -1);
+		assert(EcanTxIsLoaded(&s, 0) && EcanTxIsLoaded(&s, 1) && EcanTxIsLoaded(&s, 2));
+		assert(EcanTxGetDepth(&s) == 0 && EcanTxGetHighWater(&s) == 3);
+
+		// A full slot holds up its own priority only.
+		m = MakeFrame(4, CAN_FRAME_STD, 1);
+		assert(EcanTxQueue(&s, &m, ECAN_TX_PRIORITY_HIGH));
+		assert(EcanTxNext(&s, &m) == -1);
+		EcanTxSent(&s, 1);
+		assert(!EcanTxIsLoaded(&s, 1));
+		assert(EcanTxNext(&s, &m) == -1);
+		EcanTxSent(&s, 2);
+		assert(EcanTxNext(&s, &m) == 2 && m.id == 4);
+	}
+
+	// Slots of a priority are filled in the order they're sent, and a freed slot isn't reloaded while
+	// a slot sent after it is still loaded.
+	{
+		EcanTxScheduler s;
+		CanMessage storage[ECAN_TX_PRIORITY_COUNT][4];
+		const EcanTxPriority slots[] = {ECAN_TX_PRIORITY_HIGH, ECAN_TX_PRIORITY_NORMAL, ECAN_TX_PRIORITY_HIGH,
+		                                ECAN_TX_PRIORITY_LOW};
+		CanMessage m;
+		uint8_t i;
+		assert(InitScheduler(&s, storage, slots, 4));
+		for (i = 0; i < 4; ++i) {
+			m = MakeFrame(5, CAN_FRAME_EXT, 8);
+			m.payload[0] = i;
+			assert(EcanTxQueue(&s, &m, ECAN_TX_PRIORITY_HIGH));
+		}
+		m = MakeFrame(8, CAN_FRAME_EXT, 8);
+		assert(!EcanTxQueue(&s, &m, ECAN_TX_PRIORITY_HIGH));
+		assert(s.queues[ECAN_TX_PRIORITY_HIGH].overflowCount == 1);
+		assert(EcanTxQueue(&s, &m, ECAN_TX_PRIORITY_NORMAL));
+		assert(EcanTxGetHighWater(&s) == 5);
+
+		assert(EcanTxNext(&s, &m) == 0 && m.payload[0] == 0);
+		assert(EcanTxNext(&s, &m) == 2 && m.payload[0] == 1);
+		assert(EcanTxNext(&s, &m) == 1 && m.id == 8);
+		assert(EcanTxNext(&s, &m) == -1);
+
+		// Slot 0 is sent first, but a frame loaded into it again would overtake the one in slot 2.
+		EcanTxSent(&s, 0);
+		assert(EcanTxNext(&s, &m) == -1);
+		EcanTxSent(&s, 2);
+		assert(EcanTxNext(&s, &m) == 0 && m.payload[0] == 2);
+		assert(EcanTxNext(&s, &m) == 2 && m.payload[0] == 3);
+		assert(EcanTxGetDepth(&s) == 0);
+
+		// Frames loaded behind the last loaded slot don't have to wait.
+		EcanTxSent(&s, 2);
+		m = MakeFrame(6, CAN_FRAME_STD, 0);
+		assert(EcanTxQueue(&s, &m, ECAN_TX_PRIORITY_HIGH));
+		assert(EcanTxNext(&s, &m) == 2 && m.id == 6);
+	}
+
+	// The register mock picks buffers like the ECAN module.
+	{
+		CanMessage m, out;
+		memset(mockTrCon, 0, sizeof(mockTrCon));
+		MockConfigureTx(0, 1);
+		MockConfigureTx(2, 3);
+		MockConfigureTx(3, 3);
+		assert(MockPick() == -1);
+		m = MakeFrame(BENCH_RUDDER_ID, CAN_FRAME_EXT, 8);
+		m.payload[7] = 0xA5;
+		MockLoad(&m, 0);
+		assert(MockPick() == 0);
+		MockLoad(&m, 2);
+		assert(MockPick() == 2);
+		m = MakeFrame(ACS300_CAN_ID_VEL_CMD, CAN_FRAME_STD, 6);
+		MockLoad(&m, 3);
+		assert(MockPick() == 3);
+		MockRead(3, &out);
+		assert(out.id == ACS300_CAN_ID_VEL_CMD && out.frame_type == CAN_FRAME_STD && out.validBytes == 6);
+		MockSent(3);
+		MockRead(MockPick(), &out);
+		assert(out.id == BENCH_RUDDER_ID && out.frame_type == CAN_FRAME_EXT && out.payload[7] == 0xA5);
+		MockSent(2);
+		assert(MockPick() == 0);
+		MockSent(0);
+		assert(MockPick() == -1);
+	}
+
+	printf("All tests passed.\n");
+
+	// Compare the latencies with the transmission interrupt running right away, and delayed by
+	// about the length of a frame, like when the main loop has it disabled.
+	{
+		const uint32_t latencies[] = {1, 20, 120};
+		const char *modes[] = {"single buffer", "scheduled"};
+		const char *priorities[] = {"high", "normal", "low"};
+		BenchResult results[2];
+		unsigned int i;
+		uint8_t mode, p;
+		printf("\n%lus of a %lukbit/s bus with %u frames/s from other nodes, latencies in us:\n",
+		       BENCH_SECONDS, BENCH_BITRATE / 1000, BENCH_FOREIGN_FRAMES_PER_SECOND);
+		printf("%-7s %-14s %-7s %8s %8s %10s %10s %8s %12s\n", "ISR us", "mode", "prio", "offered", "dropped",
+		       "mean", "max", "reorder", "idle us/s");
+		for (i = 0; i < sizeof(latencies) / sizeof(latencies[0]); ++i) {
+			for (mode = BENCH_SINGLE_BUFFER; mode <= BENCH_SCHEDULED; ++mode) {
+				BenchResult *r = &results[mode];
+				Benchmark((BenchMode)mode, latencies[i], r);
+				for (p = 0; p < ECAN_TX_PRIORITY_COUNT; ++p) {
+					printf("%-7lu %-14s %-7s %8u %8u %10.0f %10lu", latencies[i] * 1000000 / BENCH_BITRATE,
+					       modes[mode], priorities[p], r->offered[p], r->dropped[p],
+					       r->sent[p] ? (double)r->latencySum[p] / r->sent[p] * 1e6 / BENCH_BITRATE : 0.0,
+					       r->latencyMax[p] * 1000000UL / BENCH_BITRATE);
+					if (p == 0) {
+						printf(" %8u %12.0f\n", r->reordered, (double)r->idleWaiting / BENCH_SECONDS * 1e6 / BENCH_BITRATE);
+					} else {
+						printf("\n");
+					}
+				}
+
+				// Every offered frame was sent, dropped, or is still waiting, and no frame
+				// overtook an earlier one with its ID.
+				for (p = 0; p < ECAN_TX_PRIORITY_COUNT; ++p) {
+					assert(r->sent[p] + r->dropped[p] <= r->offered[p]);
+					assert(r->offered[p] - r->sent[p] - r->dropped[p] <= BENCH_QUEUE_LENGTH + BENCH_TX_SLOTS);
+				}
+				assert(r->reordered == 0);
+			}
+
+			// Commands are never held up by telemetry anymore, and the bus isn't left idle any
+			// longer than before.
+			assert(results[BENCH_SCHEDULED].latencyMax[ECAN_TX_PRIORITY_HIGH] <
+			       results[BENCH_SINGLE_BUFFER].latencyMax[ECAN_TX_PRIORITY_HIGH]);
+			assert(results[BENCH_SCHEDULED].latencySum[ECAN_TX_PRIORITY_HIGH] <
+			       results[BENCH_SINGLE_BUFFER].latencySum[ECAN_TX_PRIORITY_HIGH]);
+			assert(results[BENCH_SCHEDULED].idleWaiting <= results[BENCH_SINGLE_BUFFER].idleWaiting);
+			assert(results[BENCH_SCHEDULED].dropped[ECAN_TX_PRIORITY_HIGH] == 0);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+#endif // UNIT_TEST_ECAN_TX_SCHEDULER
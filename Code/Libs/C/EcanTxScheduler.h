@@ -0,0 +1,107 @@
+/**
+ * @file   EcanTxScheduler.h
+ * @brief  Decides which queued CAN frames go into which ECAN transmission buffers.
+ *
+ * Frames are queued first in, first out in one CanFrameQueue per priority. The ECAN module has
+ * several transmission buffers and always offers the bus the frame in the loaded buffer with the
+ * highest TXnPRI, so rather than keeping a single frame in flight every transmission buffer is
+ * given a priority, called a slot here, and is refilled from the queue of that priority as soon as
+ * it has been sent. An urgent frame then only waits for the frame already on the bus, and as long
+ * as other slots are loaded the module has the next frame ready before the current one is done,
+ * instead of the bus going idle until the interrupt has reloaded the only buffer.
+ *
+ * Between buffers of the same TXnPRI the module sends the highest-numbered one first, so a frame
+ * loaded into a buffer that was just freed could overtake ones loaded earlier. To keep the frames of
+ * each priority in the order they were queued, like successive commands or the frames of a
+ * multi-frame transfer, a frame only goes into a free slot that is sent after all the loaded slots
+ * of its priority. The freed slots are then reloaded together once the last of those has been sent.
+ *
+ * This only keeps the books: Ecan1.c writes the frames into the buffers, and tells the scheduler
+ * which ones have been sent. Like CanFrameQueue, this is not threadsafe.
+ *
+ * Unit testing, and a benchmark of the frame latencies on a busy 250kbit/s bus against a mock of
+ * the ECAN transmission registers, are done on x86 by compiling with the
+ * UNIT_TEST_ECAN_TX_SCHEDULER macro:
+ * `gcc EcanTxScheduler.c CanFrameQueue.c -DUNIT_TEST_ECAN_TX_SCHEDULER -I. -Wall -O2 -g`
+ */
+#ifndef ECAN_TX_SCHEDULER_H
+#define ECAN_TX_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "EcanDefines.h"
+#include "CanFrameQueue.h"
+
+/**
+ * Transmission priorities, most urgent first.
+ */
+typedef enum {
+	ECAN_TX_PRIORITY_HIGH,   // Time-critical frames, like actuator commands.
+	ECAN_TX_PRIORITY_NORMAL, // Everything else.
+	ECAN_TX_PRIORITY_LOW,    // Frames that can wait for all the others, like periodic status.
+	ECAN_TX_PRIORITY_COUNT
+} EcanTxPriority;
+
+// The most transmission buffers a scheduler can manage.
+#define ECAN_TX_MAX_SLOTS 8
+
+/**
+ * The state of a scheduler. Use the EcanTx*() functions instead of accessing it directly.
+ */
+typedef struct {
+	CanFrameQueue queues[ECAN_TX_PRIORITY_COUNT];
+	uint8_t slotPriority[ECAN_TX_MAX_SLOTS]; // The priority of the frames each slot sends.
+	uint8_t slotCount;
+	uint8_t loaded;                          // Bit n is set while slot n holds a frame.
+	uint8_t highWater;                       // The most frames queued at once.
+} EcanTxScheduler;
+
+/**
+ * Initializes the scheduler with empty queues and slots.
+ * @param storage An array of CanMessages for the queue of each priority to use.
+ * @param capacity The number of frames each of those arrays holds.
+ * @param slotPriority The priority of each slot. The slots of a priority are listed in the order
+ *                     the module sends them in, and are loaded in that order.
+ * @return False if a queue couldn't be initialized, there are no slots or more than
+ *         ECAN_TX_MAX_SLOTS, or a priority has no slot.
+ */
+bool EcanTxInit(EcanTxScheduler *s, CanMessage *const storage[ECAN_TX_PRIORITY_COUNT],
+                const uint8_t capacity[ECAN_TX_PRIORITY_COUNT], const EcanTxPriority *slotPriority,
+                uint8_t slotCount);
+
+/**
+ * Queues a frame for transmission. If the queue of its priority is full, it's dropped.
+ * @return False if the frame was dropped or the priority isn't valid.
+ */
+bool EcanTxQueue(EcanTxScheduler *s, const CanMessage *msg, EcanTxPriority priority);
+
+/**
+ * Takes the most urgent frame that can be loaded right now off its queue and marks the slot it
+ * goes into as loaded. Call this until it returns -1 whenever frames were queued or sent.
+ * @param msg Set to the frame.
+ * @return The slot to load the frame into, or -1 if there's nothing to load.
+ */
+int8_t EcanTxNext(EcanTxScheduler *s, CanMessage *msg);
+
+/**
+ * Frees a loaded slot once its frame has been sent.
+ */
+void EcanTxSent(EcanTxScheduler *s, uint8_t slot);
+
+/**
+ * Returns whether a slot holds a frame that hasn't been sent yet.
+ */
+bool EcanTxIsLoaded(const EcanTxScheduler *s, uint8_t slot);
+
+/**
+ * Returns the number of frames queued, not counting the ones already loaded.
+ */
+uint8_t EcanTxGetDepth(const EcanTxScheduler *s);
+
+/**
+ * Returns the most frames that have been queued at once since initialization.
+ */
+uint8_t EcanTxGetHighWater(const EcanTxScheduler *s);
+
+#endif // ECAN_TX_SCHEDULER_H
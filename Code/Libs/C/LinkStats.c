@@ -0,0 +1,342 @@
+#include "LinkStats.h"
+
+#include <string.h>
+
+void LinkStatsInit(LinkStats *s, uint16_t tickRate)
+{
+	memset(s, 0, sizeof(*s));
+	s->TickRate = tickRate;
+}
+
+void LinkStatsReceive(LinkStats *s, uint16_t buffered, uint16_t consumed, uint16_t discarded)
+{
+	s->RxBytes += consumed;
+	s->RxDiscarded += discarded;
+	if (buffered > s->RxHighWater) {
+		s->RxHighWater = buffered;
+	}
+}
+
+void LinkStatsReceiveMessage(LinkStats *s, bool fromPeer, uint8_t seq)
+{
+	++s->RxMessages;
+	if (fromPeer) {
+		// Any messages between the last one and this one were lost. Sequence numbers wrap at 256, so
+		// a run of more losses than that can't be told apart from a shorter one.
+		if (s->SeqValid) {
+			s->RxLost += (uint8_t)(seq - s->LastSeq - 1);
+		}
+		s->LastSeq = seq;
+		s->SeqValid = true;
+	}
+}
+
+void LinkStatsTransmit(LinkStats *s, uint16_t bytes, bool queued, uint16_t buffered)
+{
+	if (queued) {
+		s->TxBytes += bytes;
+		++s->TxMessages;
+	} else {
+		s->TxDropped += bytes;
+	}
+	if (buffered > s->TxHighWater) {
+		s->TxHighWater = buffered;
+	}
+}
+
+void LinkStatsSetScheduledRate(LinkStats *s, uint16_t bytesPerSecond)
+{
+	s->TxScheduledRate = bytesPerSecond;
+}
+
+void LinkStatsTick(LinkStats *s)
+{
+	if (++s->Ticks >= s->TickRate) {
+		s->Ticks = 0;
+		s->RxRate = (uint16_t)(s->RxBytes - s->RxBytesAtSecond);
+		s->TxRate = (uint16_t)(s->TxBytes - s->TxBytesAtSecond);
+		s->RxBytesAtSecond = s->RxBytes;
+		s->TxBytesAtSecond = s->TxBytes;
+	}
+}
+
+void LinkStatsEncode(const LinkStats *s, uint8_t channel, mavlink_link_stats_t *msg)
+{
+	msg->rx_bytes = s->RxBytes;
+	msg->rx_messages = s->RxMessages;
+	msg->rx_discarded = s->RxDiscarded;
+	msg->rx_lost = s->RxLost;
+	msg->tx_bytes = s->TxBytes;
+	msg->tx_messages = s->TxMessages;
+	msg->tx_dropped = s->TxDropped;
+	msg->rx_rate = s->RxRate;
+	msg->tx_rate = s->TxRate;
+	msg->tx_scheduled_rate = s->TxScheduledRate;
+	msg->rx_high_water = s->RxHighWater;
+	msg->tx_high_water = s->TxHighWater;
+	msg->channel = channel;
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_LINK_STATS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "MavlinkReceiver.h"
+#include "MavlinkSerializer.h"
+#include "SpscBuffer.h"
+
+#define RING_SIZE 1024
+#define TICK_RATE 100
+#define MAX_FRAMES 64
+
+/**
+ * A simulated link: the sender queues frames into its transmit ring, the radio drains that ring at
+ * a fixed rate and then drops or corrupts whole frames before they end up in the receiver's ring.
+ */
+typedef struct {
+	// Configuration.
+	uint32_t offeredRate;   // Bytes per second the sender tries to transmit.
+	uint32_t airRate;       // Bytes per second the radio can carry.
+	double dropRate;        // Chance that a frame is lost on the air.
+	double garbageRate;     // Chance that noise is received before a frame.
+
+	// State.
+	SpscBuffer tx, rx;
+	uint8_t txData[RING_SIZE], rxData[RING_SIZE];
+	uint16_t frameLengths[MAX_FRAMES]; // The frames in the transmit ring, in order.
+	uint8_t frameCount;
+	uint16_t drained;       // Bytes of the first frame already drained.
+	uint32_t offeredCredit; // Bytes the sender may still send this tick, in units of 1/TICK_RATE.
+	uint32_t airCredit;
+	MavlinkReceiver receiver;
+	LinkStats sender, recipient;
+
+	// What actually happened, to check the statistics against.
+	uint32_t offeredBytes, refusedBytes, deliveredFrames, deliveredBytes, droppedFrames, garbageBytes;
+	uint32_t droppedBeforeLastDelivery;
+	uint32_t txBytesLastSecond, rxBytesLastSecond, txBytesThisSecond, rxBytesThisSecond;
+	uint32_t maxBuffered;
+} SimLink;
+
+static void SimInit(SimLink *l, uint32_t offeredRate, uint32_t airRate, double dropRate, double garbageRate)
+{
+	memset(l, 0, sizeof(*l));
+	l->offeredRate = offeredRate;
+	l->airRate = airRate;
+	l->dropRate = dropRate;
+	l->garbageRate = garbageRate;
+	SPSC_Init(&l->tx, l->txData, RING_SIZE);
+	SPSC_Init(&l->rx, l->rxData, RING_SIZE);
+	MavlinkReceiverInit(&l->receiver);
+	LinkStatsInit(&l->sender, TICK_RATE);
+	LinkStatsInit(&l->recipient, TICK_RATE);
+	LinkStatsSetScheduledRate(&l->sender, (uint16_t)offeredRate);
+}
+
+static bool Chance(double p)
+{
+	return rand() / (RAND_MAX + 1.0) < p;
+}
+
+/**
+ * Simulates one tick of the main loop on both ends of the link.
+ */
+static void SimTick(SimLink *l)
+{
+	// The sender queues random telemetry messages, as much as its schedule calls for.
+	l->offeredCredit += l->offeredRate;
+	while (l->offeredCredit >= TICK_RATE * (MAVLINK_MSG_ID_NODE_STATUS_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES)) {
+		mavlink_node_status_t status = {.hil_status = (uint16_t)rand()};
+		mavlink_dst800_t dst = {.depth = (float)rand()};
+		SpscBufferSpans spans;
+		uint16_t space = SPSC_GetWriteSpans(&l->tx, &spans);
+		uint16_t length, n;
+		if (rand() & 1) {
+			length = MAVLINK_MSG_ID_NODE_STATUS_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+			n = MAVLINK_SERIALIZE(&spans, space, MAVLINK_COMM_0, 1, 1, NODE_STATUS, &status);
+		} else {
+			length = MAVLINK_MSG_ID_DST800_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+			n = MAVLINK_SERIALIZE(&spans, space, MAVLINK_COMM_0, 1, 1, DST800, &dst);
+		}
+		l->offeredCredit -= TICK_RATE * length;
+		l->offeredBytes += length;
+		if (n) {
+			assert(l->frameCount < MAX_FRAMES);
+			SPSC_CommitWrite(&l->tx, n);
+			l->frameLengths[l->frameCount++] = n;
+			l->txBytesThisSecond += n;
+		} else {
+			l->refusedBytes += length;
+		}
+		LinkStatsTransmit(&l->sender, length, n != 0, SPSC_GetLength(&l->tx));
+		if (SPSC_GetLength(&l->tx) > l->maxBuffered) {
+			l->maxBuffered = SPSC_GetLength(&l->tx);
+		}
+	}
+
+	// The radio carries as many bytes as it can, and only once a whole frame has made it across
+	// does it decide what happened to it.
+	l->airCredit += l->airRate;
+	while (l->frameCount && l->airCredit >= TICK_RATE) {
+		uint16_t frameLength = l->frameLengths[0];
+		uint16_t n = frameLength - l->drained;
+		if (n > l->airCredit / TICK_RATE) {
+			n = l->airCredit / TICK_RATE;
+		}
+		l->drained += n;
+		l->airCredit -= n * TICK_RATE;
+		if (l->drained < frameLength) {
+			break;
+		}
+
+		uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+		assert(SPSC_ReadMany(&l->tx, frame, frameLength));
+		memmove(l->frameLengths, &l->frameLengths[1], --l->frameCount * sizeof(l->frameLengths[0]));
+		l->drained = 0;
+
+		if (Chance(l->garbageRate)) {
+			// Noise never contains an STX, so exactly these bytes get discarded.
+			uint16_t i, count = 1 + rand() % 16;
+			for (i = 0; i < count; ++i) {
+				assert(SPSC_WriteByte(&l->rx, (uint8_t)(rand() % MAVLINK_STX)));
+			}
+			l->garbageBytes += count;
+			l->rxBytesThisSecond += count;
+		}
+		if (Chance(l->dropRate)) {
+			++l->droppedFrames;
+		} else {
+			assert(SPSC_WriteMany(&l->rx, frame, frameLength, true));
+			++l->deliveredFrames;
+			l->deliveredBytes += frameLength;
+			l->rxBytesThisSecond += frameLength;
+			l->droppedBeforeLastDelivery = l->droppedFrames;
+		}
+	}
+	if (!l->frameCount) {
+		l->airCredit = 0;
+	}
+
+	// The recipient runs its receive loop, just like MavLinkReceive().
+	{
+		SpscBufferSpans spans;
+		mavlink_message_t msg;
+		uint16_t length = SPSC_GetReadSpans(&l->rx, &spans);
+		uint16_t offset = 0;
+		uint32_t discarded = l->receiver.stats.discardedBytes;
+		while (MavlinkReceiverNext(&l->receiver, &spans, length, &offset, &msg)) {
+			LinkStatsReceiveMessage(&l->recipient, true, msg.seq);
+		}
+		SPSC_CommitRead(&l->rx, offset);
+		LinkStatsReceive(&l->recipient, length, offset, (uint16_t)(l->receiver.stats.discardedBytes - discarded));
+	}
+
+	LinkStatsTick(&l->sender);
+	LinkStatsTick(&l->recipient);
+}
+
+/**
+ * Runs a link for the given number of seconds, checking the per-second rates every second, and
+ * then checks the totals.
+ */
+static void SimRun(SimLink *l, const char *name, uint16_t seconds)
+{
+	uint32_t tick;
+	for (tick = 0; tick < (uint32_t)seconds * TICK_RATE; ++tick) {
+		SimTick(l);
+		if ((tick + 1) % TICK_RATE == 0) {
+			assert(l->sender.TxRate == l->txBytesThisSecond);
+			assert(l->recipient.RxRate == l->rxBytesThisSecond);
+			l->txBytesLastSecond = l->txBytesThisSecond;
+			l->rxBytesLastSecond = l->rxBytesThisSecond;
+			l->txBytesThisSecond = 0;
+			l->rxBytesThisSecond = 0;
+		}
+	}
+
+	// Everything the sender tried to send was either queued or refused.
+	assert(l->sender.TxBytes + l->sender.TxDropped == l->offeredBytes);
+	assert(l->sender.TxDropped == l->refusedBytes);
+	assert(l->sender.TxHighWater == l->maxBuffered && l->sender.TxHighWater <= RING_SIZE);
+
+	// Everything that came off the air was counted, and only the noise was discarded.
+	assert(l->recipient.RxMessages == l->deliveredFrames);
+	assert(l->recipient.RxDiscarded == l->garbageBytes);
+	assert(l->recipient.RxBytes + SPSC_GetLength(&l->rx) == l->deliveredBytes + l->garbageBytes);
+
+	// Lost frames only show up as a gap once a later frame arrives.
+	assert(l->recipient.RxLost == l->droppedBeforeLastDelivery);
+
+	mavlink_link_stats_t tx, rx;
+	LinkStatsEncode(&l->sender, 0, &tx);
+	LinkStatsEncode(&l->recipient, 0, &rx);
+	printf("%-22s tx %7u B (%5u dropped, hwm %4u, %4u B/s of %4u scheduled)  rx %7u B %5u msgs (%4u lost, %4u discarded, %4u B/s)\n",
+	       name, tx.tx_bytes, tx.tx_dropped, tx.tx_high_water, tx.tx_rate, tx.tx_scheduled_rate,
+	       rx.rx_bytes, rx.rx_messages, rx.rx_lost, rx.rx_discarded, rx.rx_rate);
+}
+
+int main(void)
+{
+	static SimLink link;
+	srand(42);
+
+	// Sequence gaps, including across the wrap, and messages from other senders.
+	{
+		LinkStats s;
+		LinkStatsInit(&s, TICK_RATE);
+		LinkStatsReceiveMessage(&s, true, 250);
+		LinkStatsReceiveMessage(&s, true, 251);
+		LinkStatsReceiveMessage(&s, false, 17);
+		LinkStatsReceiveMessage(&s, true, 254);
+		LinkStatsReceiveMessage(&s, true, 3);
+		assert(s.RxMessages == 5 && s.RxLost == 2 + 4);
+		printf("Sequence gaps are counted across the wrap.\n");
+	}
+
+	// The counters are 32-bit, so they outlast the 16-bit ones they replace.
+	{
+		LinkStats s;
+		uint32_t i;
+		LinkStatsInit(&s, TICK_RATE);
+		for (i = 0; i < 70000; ++i) {
+			LinkStatsReceiveMessage(&s, true, (uint8_t)i);
+			LinkStatsTransmit(&s, 40, true, 40);
+		}
+		assert(s.RxMessages == 70000 && s.TxMessages == 70000 && s.TxBytes == 2800000 && s.RxLost == 0);
+		printf("Counters don't wrap at 16 bits.\n");
+	}
+
+	// A clean link with room to spare delivers everything.
+	SimInit(&link, 3000, 6400, 0, 0);
+	SimRun(&link, "clean", 30);
+	assert(link.sender.TxDropped == 0 && link.recipient.RxLost == 0 && link.recipient.RxDiscarded == 0);
+
+	// A lossy link loses and corrupts frames on the air.
+	SimInit(&link, 3000, 6400, 0.05, 0.05);
+	SimRun(&link, "lossy", 30);
+	assert(link.recipient.RxLost > 0 && link.recipient.RxDiscarded > 0);
+
+	// A saturated link backs up until the transmit buffer is full and drops the excess, while the
+	// radio keeps running at its own rate.
+	SimInit(&link, 12800, 6400, 0, 0);
+	SimRun(&link, "saturated", 30);
+	assert(link.sender.TxDropped > 0);
+	assert(link.sender.TxHighWater > RING_SIZE - MAVLINK_MAX_PACKET_LEN);
+	assert(link.sender.TxRate > 6400 - 2 * MAVLINK_MAX_PACKET_LEN && link.sender.TxRate < 6400 + 2 * MAVLINK_MAX_PACKET_LEN);
+	assert(link.sender.TxScheduledRate == 12800);
+
+	// And both at once.
+	SimInit(&link, 12800, 6400, 0.1, 0.1);
+	SimRun(&link, "lossy and saturated", 30);
+	assert(link.sender.TxDropped > 0 && link.recipient.RxLost > 0 && link.recipient.RxDiscarded > 0);
+
+	printf("All tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_LINK_STATS
@@ -0,0 +1,105 @@
+/**
+ * @file   LinkStats.h
+ * @brief  Health and throughput statistics for a single MAVLink link.
+ *
+ * A LinkStats struct is kept for every link and fed from the places that touch it: the receive loop
+ * reports how much of the receive buffer it consumed and every message it found, and the transmit
+ * path reports every frame it tried to queue. From that it keeps:
+ *  * Cumulative 32-bit byte and message counters in both directions, so they don't wrap during a
+ *    deployment.
+ *  * Bytes discarded by the receiver and messages lost according to gaps in the sequence numbers of
+ *    the peer.
+ *  * Bytes that couldn't be transmitted because the transmit buffer was full.
+ *  * The high-water marks of both buffers.
+ *  * The bytes actually received and transmitted during the last second, next to the rate of
+ *    telemetry that was scheduled.
+ *
+ * LinkStatsTick() must be called at the rate given to LinkStatsInit() to roll over the per-second
+ * rates. LinkStatsEncode() fills in a LINK_STATS message for transmission.
+ *
+ * Unit testing, which simulates lossy and saturated links and checks the reported numbers, is done
+ * on x86 by compiling with the UNIT_TEST_LINK_STATS macro:
+ * `gcc LinkStats.c MavlinkReceiver.c MavlinkSerializer.c SpscBuffer.c MavlinkHelpers.c -DUNIT_TEST_LINK_STATS -DMAVLINK_SEPARATE_HELPERS -I../MAVLink/seaslug -O2 -Wall`
+ */
+#ifndef LINK_STATS_H
+#define LINK_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <mavlink.h>
+
+/**
+ * The statistics of a single link. Initialize with LinkStatsInit(), all fields can be read at any
+ * time.
+ */
+typedef struct {
+	uint32_t RxBytes;         // Bytes consumed from the receive buffer.
+	uint32_t RxMessages;      // Messages received with a valid length and checksum.
+	uint32_t RxDiscarded;     // Received bytes that weren't part of a valid message.
+	uint32_t RxLost;          // Messages from the peer missing from its sequence numbers.
+	uint32_t TxBytes;         // Bytes queued for transmission.
+	uint32_t TxMessages;      // Messages queued for transmission.
+	uint32_t TxDropped;       // Bytes not queued because the transmit buffer was full.
+	uint16_t RxRate;          // Bytes received during the last second.
+	uint16_t TxRate;          // Bytes queued during the last second.
+	uint16_t TxScheduledRate; // Bytes per second of scheduled telemetry.
+	uint16_t RxHighWater;     // The most bytes seen waiting in the receive buffer.
+	uint16_t TxHighWater;     // The most bytes seen waiting in the transmit buffer.
+
+	// Bookkeeping for the per-second rates and the sequence tracking.
+	uint32_t RxBytesAtSecond; // RxBytes at the start of the current second.
+	uint32_t TxBytesAtSecond; // TxBytes at the start of the current second.
+	uint16_t TickRate;        // How often LinkStatsTick() is called, in Hz.
+	uint16_t Ticks;           // Ticks so far during the current second.
+	uint8_t LastSeq;          // The sequence number of the last message from the peer.
+	bool SeqValid;            // Whether LastSeq has been set yet.
+} LinkStats;
+
+/**
+ * Clears all statistics.
+ * @param tickRate The rate LinkStatsTick() will be called at, in Hz.
+ */
+void LinkStatsInit(LinkStats *s, uint16_t tickRate);
+
+/**
+ * Records a pass over the receive buffer.
+ * @param buffered The bytes that were waiting in the buffer.
+ * @param consumed The bytes that were released from it, including discarded ones.
+ * @param discarded The bytes among those that weren't part of a valid message.
+ */
+void LinkStatsReceive(LinkStats *s, uint16_t buffered, uint16_t consumed, uint16_t discarded);
+
+/**
+ * Records a received message.
+ * @param fromPeer True if the message came from the peer whose sequence numbers are tracked. Other
+ *                 senders, such as the radios, have sequences of their own.
+ * @param seq The sequence number of the message.
+ */
+void LinkStatsReceiveMessage(LinkStats *s, bool fromPeer, uint8_t seq);
+
+/**
+ * Records an attempt to queue a frame for transmission.
+ * @param bytes The size of the frame.
+ * @param queued False if the frame didn't fit into the transmit buffer.
+ * @param buffered The bytes waiting in the transmit buffer afterwards.
+ */
+void LinkStatsTransmit(LinkStats *s, uint16_t bytes, bool queued, uint16_t buffered);
+
+/**
+ * Sets the rate of telemetry scheduled for this link, in bytes per second.
+ */
+void LinkStatsSetScheduledRate(LinkStats *s, uint16_t bytesPerSecond);
+
+/**
+ * Advances time by one tick, updating the per-second rates once every second.
+ */
+void LinkStatsTick(LinkStats *s);
+
+/**
+ * Fills in a LINK_STATS message with the current statistics.
+ * @param channel The channel to report these statistics as.
+ */
+void LinkStatsEncode(const LinkStats *s, uint8_t channel, mavlink_link_stats_t *msg);
+
+#endif // LINK_STATS_H
@@ -0,0 +1,514 @@
+#include "LogStream.h"
+
+#include <string.h>
+
+#include <../checksum.h>
+
+#define HEADER_LEN 4
+
+bool LogSchemaInit(LogSchema *s, uint8_t msgid, const mavlink_message_info_t *info)
+{
+	uint16_t offset = 0;
+
+	s->MsgId = msgid;
+	s->Count = 0;
+
+	// The fields are listed in the order of the XML, so put them in wire order by their offsets.
+	while (true) {
+		unsigned i;
+		for (i = 0; i < info->num_fields && info->fields[i].wire_offset != offset; ++i);
+		if (i == info->num_fields) {
+			break;
+		}
+
+		uint8_t width;
+		switch (info->fields[i].type) {
+		case MAVLINK_TYPE_CHAR:
+		case MAVLINK_TYPE_UINT8_T:
+		case MAVLINK_TYPE_INT8_T:
+			width = 1;
+			break;
+		case MAVLINK_TYPE_UINT16_T:
+		case MAVLINK_TYPE_INT16_T:
+			width = 2;
+			break;
+		case MAVLINK_TYPE_UINT32_T:
+		case MAVLINK_TYPE_INT32_T:
+		case MAVLINK_TYPE_FLOAT:
+			width = 4;
+			break;
+		default:
+			return false;
+		}
+
+		unsigned n = info->fields[i].array_length ? info->fields[i].array_length : 1;
+		if (s->Count + n > LOG_STREAM_MAX_FIELDS || offset + n * width > LOG_STREAM_MAX_PAYLOAD_LEN) {
+			return false;
+		}
+		while (n--) {
+			s->Widths[s->Count++] = width;
+			offset += width;
+		}
+	}
+
+	s->Length = offset;
+	return s->Count > 0;
+}
+
+void LogEncoderInit(LogEncoder *e, const LogSchema *schema, uint8_t keyframeInterval)
+{
+	e->Schema = schema;
+	e->KeyframeInterval = keyframeInterval;
+	e->Seq = 0;
+	LogEncoderRestart(e);
+}
+
+void LogEncoderRestart(LogEncoder *e)
+{
+	e->SinceKeyframe = e->KeyframeInterval;
+}
+
+/**
+ * Returns the difference between two little-endian fields, wrapped to the field's width.
+ */
+static int32_t _Delta(const uint8_t *a, const uint8_t *b, uint8_t width)
+{
+	switch (width) {
+	case 1:
+		return (int8_t)(a[0] - b[0]);
+	case 2:
+		return (int16_t)((a[0] | (a[1] << 8)) - (b[0] | (b[1] << 8)));
+	default:
+		return (int32_t)(((uint32_t)a[0] | ((uint32_t)a[1] << 8) | ((uint32_t)a[2] << 16) | ((uint32_t)a[3] << 24)) -
+		                 ((uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24)));
+	}
+}
+
+/**
+ * Writes the changed fields and their differences to `out`.
+ * @return The size of the delta payload, or 0 if it would be at least as large as the raw one.
+ */
+static uint8_t _EncodeDelta(const LogSchema *s, const uint8_t *current, const uint8_t *previous, uint8_t *out)
+{
+	const uint8_t bitmapLength = (s->Count + 7) / 8;
+	const uint8_t *const end = out + s->Length;
+	uint8_t *p = out + bitmapLength;
+	uint8_t i;
+
+	memset(out, 0, bitmapLength);
+	for (i = 0; i < s->Count; ++i) {
+		const uint8_t width = s->Widths[i];
+		const int32_t d = _Delta(current, previous, width);
+		current += width;
+		previous += width;
+		if (!d) {
+			continue;
+		}
+
+		out[i >> 3] |= 1 << (i & 7);
+
+		// Zigzag-encode so small negative differences stay small, then write 7 bits per byte.
+		uint32_t z = d < 0 ? ~((uint32_t)d << 1) : (uint32_t)d << 1;
+		do {
+			if (p == end) {
+				return 0;
+			}
+			*p = z & 0x7F;
+			z >>= 7;
+			if (z) {
+				*p |= 0x80;
+			}
+			++p;
+		} while (z);
+	}
+	return p == end ? 0 : p - out;
+}
+
+uint16_t LogEncode(LogEncoder *e, const void *payload, uint8_t *frame)
+{
+	const LogSchema *s = e->Schema;
+	uint8_t length = 0;
+
+	if (e->SinceKeyframe < e->KeyframeInterval) {
+		length = _EncodeDelta(s, payload, e->Previous, &frame[HEADER_LEN]);
+	}
+	if (length) {
+		frame[3] = e->Seq;
+		++e->SinceKeyframe;
+	} else {
+		length = s->Length;
+		memcpy(&frame[HEADER_LEN], payload, length);
+		frame[3] = e->Seq | LOG_STREAM_KEYFRAME;
+		e->SinceKeyframe = 1;
+	}
+	memcpy(e->Previous, payload, s->Length);
+	e->Seq = (e->Seq + 1) & ~LOG_STREAM_KEYFRAME;
+
+	frame[0] = LOG_STREAM_SYNC;
+	frame[1] = length;
+	frame[2] = s->MsgId;
+	const uint16_t crc = crc_calculate(&frame[1], HEADER_LEN - 1 + length);
+	frame[HEADER_LEN + length] = crc & 0xFF;
+	frame[HEADER_LEN + length + 1] = crc >> 8;
+	return length + LOG_STREAM_NUM_NON_PAYLOAD_BYTES;
+}
+
+uint16_t LogStreamNextFrame(const uint8_t *data, uint16_t length, uint16_t *offset)
+{
+	while (*offset < length) {
+		const uint8_t *frame = &data[*offset];
+		const uint16_t available = length - *offset;
+		if (frame[0] != LOG_STREAM_SYNC) {
+			++*offset;
+			continue;
+		}
+		if (available < 2 || available < frame[1] + LOG_STREAM_NUM_NON_PAYLOAD_BYTES) {
+			return 0;
+		}
+
+		const uint16_t payloadEnd = HEADER_LEN + frame[1];
+		const uint16_t crc = crc_calculate(&frame[1], payloadEnd - 1);
+		if (frame[payloadEnd] == (crc & 0xFF) && frame[payloadEnd + 1] == (crc >> 8)) {
+			return payloadEnd + 2;
+		}
+
+		// Not a frame after all, so one may start within it.
+		++*offset;
+	}
+	return 0;
+}
+
+void LogDecoderInit(LogDecoder *d, const LogSchema *schema)
+{
+	memset(d, 0, sizeof(*d));
+	d->Schema = schema;
+}
+
+/**
+ * Adds a difference to a little-endian field, wrapping at the field's width.
+ */
+static void _Apply(uint8_t *field, uint8_t width, uint32_t delta)
+{
+	uint8_t i;
+	uint32_t value = 0;
+	for (i = 0; i < width; ++i) {
+		value |= (uint32_t)field[i] << (8 * i);
+	}
+	value += delta;
+	for (i = 0; i < width; ++i) {
+		field[i] = value >> (8 * i);
+	}
+}
+
+/**
+ * Applies a delta payload to `values`.
+ * @return False if the payload is malformed.
+ */
+static bool _DecodeDelta(const LogSchema *s, const uint8_t *in, uint8_t length, uint8_t *values)
+{
+	const uint8_t bitmapLength = (s->Count + 7) / 8;
+	const uint8_t *p = in + bitmapLength;
+	const uint8_t *const end = in + length;
+	uint8_t i;
+
+	if (length < bitmapLength) {
+		return false;
+	}
+	for (i = 0; i < s->Count; ++i) {
+		if (in[i >> 3] & (1 << (i & 7))) {
+			uint32_t z = 0;
+			uint8_t shift = 0;
+			do {
+				if (p == end || shift > 28) {
+					return false;
+				}
+				z |= (uint32_t)(*p & 0x7F) << shift;
+				shift += 7;
+			} while (*p++ & 0x80);
+			_Apply(values, s->Widths[i], (z >> 1) ^ -(z & 1));
+		}
+		values += s->Widths[i];
+	}
+	return p == end;
+}
+
+bool LogDecode(LogDecoder *d, const uint8_t *frame, void *payload)
+{
+	const LogSchema *s = d->Schema;
+	const uint8_t length = frame[1];
+	const uint8_t seq = frame[3] & ~LOG_STREAM_KEYFRAME;
+
+	if (frame[3] & LOG_STREAM_KEYFRAME) {
+		d->Synced = (length == s->Length);
+		if (d->Synced) {
+			memcpy(d->Previous, &frame[HEADER_LEN], length);
+			++d->Keyframes;
+		}
+	} else if (d->Synced && seq == d->NextSeq) {
+		d->Synced = _DecodeDelta(s, &frame[HEADER_LEN], length, d->Previous);
+	} else {
+		d->Synced = false;
+	}
+
+	if (!d->Synced) {
+		++d->Skipped;
+		return false;
+	}
+	d->NextSeq = (seq + 1) & ~LOG_STREAM_KEYFRAME;
+	memcpy(payload, d->Previous, s->Length);
+	++d->Frames;
+	return true;
+}
+
+#ifdef UNIT_TEST_LOG_STREAM
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include <time.h>
+
+#define RUN_LENGTH (60 * 100)  // One minute of 100Hz samples.
+#define KEYFRAME_INTERVAL 100
+#define STREAM_SIZE (RUN_LENGTH * LOG_STREAM_MAX_FRAME_LEN)
+
+static mavlink_controller_data_t run[RUN_LENGTH];
+static uint8_t stream[STREAM_SIZE];
+
+static double Noise(double amplitude)
+{
+	return amplitude * ((double)rand() / RAND_MAX * 2 - 1);
+}
+
+/**
+ * Simulates a boat following a waypoint at 2m/s while slowly weaving, with the IMU at 100Hz, GPS at
+ * 5Hz, and everything scaled like MavLinkSendControllerData() does.
+ */
+static void SimulateRun(void)
+{
+	double yaw = 0.5, north = 0, east = 0;
+	uint16_t i;
+	srand(1);
+	for (i = 0; i < RUN_LENGTH; ++i) {
+		const double t = i / 100.0;
+		const double yawRate = 0.05 * sin(t / 5);
+		yaw += yawRate / 100;
+		north += 2 * cos(yaw) / 100;
+		east += 2 * sin(yaw) / 100;
+
+		mavlink_controller_data_t *c = &run[i];
+		memset(c, 0, sizeof(*c));
+		c->time_boot_ms = 123450 + i * 10;
+		c->last_wp_north = 0;
+		c->last_wp_east = 0;
+		c->next_wp_north = 2000;
+		c->next_wp_east = 500;
+		c->yaw = (yaw + Noise(0.001)) * 8192;
+		c->pitch = (0.02 * sin(t * 2) + Noise(0.001)) * 8192;
+		c->roll = (0.05 * sin(t * 3) + Noise(0.001)) * 8192;
+		c->x_angle_vel = Noise(0.005) * 4096;
+		c->y_angle_vel = Noise(0.005) * 4096;
+		c->z_angle_vel = (yawRate + Noise(0.005)) * 4096;
+		c->x_accel = Noise(0.05) * 256;
+		c->y_accel = Noise(0.05) * 256;
+		c->z_accel = (-9.81 + Noise(0.05)) * 256;
+		c->water_speed = (2 + Noise(0.01)) * 1e4;
+		c->north = north * 1e3;
+		c->east = east * 1e3;
+		c->north_speed = 2 * cos(yaw) * 1e3;
+		c->east_speed = 2 * sin(yaw) * 1e3;
+		c->yaw_rate = yawRate * 4096;
+		c->commanded_rudder_angle = -yawRate * 1e4;
+		c->actual_commanded_rudder_angle = c->commanded_rudder_angle;
+		c->commanded_throttle = 600;
+		c->actual_commanded_throttle = 600;
+		c->rudder_angle = c->commanded_rudder_angle + Noise(2);
+
+		// The GPS data only changes with every new fix.
+		if (i % 20 == 0) {
+			c->new_gps_fix = 1;
+			c->lat = 365000000 + (int32_t)(north / 1.11e-2);
+			c->lon = -1220000000 + (int32_t)(east / 0.89e-2);
+			c->sog = 200 + Noise(5);
+			c->cog = (uint16_t)(yaw * 18000 / M_PI + 36000) % 36000;
+			c->hdop = 120;
+		} else {
+			c->lat = run[i - 1].lat;
+			c->lon = run[i - 1].lon;
+			c->sog = run[i - 1].sog;
+			c->cog = run[i - 1].cog;
+			c->hdop = run[i - 1].hdop;
+		}
+	}
+}
+
+/**
+ * Decodes a stream and checks that it matches the run, apart from `missing` samples.
+ * @return The number of samples decoded.
+ */
+static uint32_t CheckStream(const LogSchema *schema, uint32_t length, const bool missing[])
+{
+	LogDecoder d;
+	mavlink_controller_data_t decoded;
+	uint16_t offset = 0, frameLength, i = 0;
+	uint32_t base = 0, count = 0;
+
+	LogDecoderInit(&d, schema);
+	while (base < length) {
+		const uint16_t chunk = length - base > UINT16_MAX ? UINT16_MAX : length - base;
+		offset = 0;
+		while ((frameLength = LogStreamNextFrame(&stream[base], chunk, &offset))) {
+			const uint8_t *frame = &stream[base + offset];
+			offset += frameLength;
+			if (frame[2] != MAVLINK_MSG_ID_CONTROLLER_DATA) {
+				continue;
+			}
+			// Skip to the sample this frame belongs to.
+			while (missing[i]) {
+				++i;
+			}
+			if (LogDecode(&d, frame, &decoded)) {
+				assert(memcmp(&decoded, &run[i], MAVLINK_MSG_ID_CONTROLLER_DATA_LEN) == 0);
+				++count;
+			}
+			++i;
+		}
+		if (base + chunk == length) {
+			break;
+		}
+		base += offset;
+	}
+	return count;
+}
+
+int main(void)
+{
+	LogSchema schema;
+	LogEncoder e;
+	const mavlink_message_info_t info = MAVLINK_MESSAGE_INFO_CONTROLLER_DATA;
+	static bool missing[RUN_LENGTH + 1];
+	uint32_t length, i;
+
+	assert(LogSchemaInit(&schema, MAVLINK_MSG_ID_CONTROLLER_DATA, &info));
+	assert(schema.Length == MAVLINK_MSG_ID_CONTROLLER_DATA_LEN && schema.Count == 35);
+	assert(schema.Widths[0] == 4 && schema.Widths[5] == 2 && schema.Widths[34] == 1);
+	SimulateRun();
+
+	// Samples survive exactly, with MAVLink frames in between.
+	{
+		mavlink_message_t msg;
+		uint32_t heartbeats = 0;
+		LogEncoderInit(&e, &schema, KEYFRAME_INTERVAL);
+		for (i = 0, length = 0; i < RUN_LENGTH; ++i) {
+			const uint16_t n = LogEncode(&e, &run[i], &stream[length]);
+			assert(n <= MAVLINK_MSG_ID_CONTROLLER_DATA_LEN + LOG_STREAM_NUM_NON_PAYLOAD_BYTES);
+			assert((i % KEYFRAME_INTERVAL == 0) == !!(stream[length + 3] & LOG_STREAM_KEYFRAME));
+			length += n;
+			if (i % 50 == 0) {
+				mavlink_msg_heartbeat_pack(1, 1, &msg, MAV_TYPE_SURFACE_BOAT, MAV_AUTOPILOT_GENERIC, 0, 0, 0);
+				length += mavlink_msg_to_send_buffer(&stream[length], &msg);
+				++heartbeats;
+			}
+		}
+		assert(CheckStream(&schema, length, missing) == RUN_LENGTH);
+		printf("Decoded %u samples exactly, skipping %u MAVLink frames.\n", RUN_LENGTH, heartbeats);
+	}
+
+	// Decoding picks up again at the next keyframe after a frame was lost or corrupted.
+	{
+		uint32_t lost = 150, corrupt = 420;
+		LogEncoderInit(&e, &schema, KEYFRAME_INTERVAL);
+		for (i = 0, length = 0; i < RUN_LENGTH; ++i) {
+			const uint16_t n = LogEncode(&e, &run[i], &stream[length]);
+			if (i == lost) {
+				missing[i] = true;
+				continue;
+			}
+			if (i == corrupt) {
+				stream[length + 5] ^= 0x10;
+				missing[i] = true;
+			}
+			length += n;
+		}
+		uint32_t decoded = CheckStream(&schema, length, missing);
+		assert(decoded == RUN_LENGTH - (200 - lost) - (500 - corrupt));
+		memset(missing, 0, sizeof(missing));
+
+		// And restarting the encoder after a lost frame only loses that frame.
+		LogEncoderInit(&e, &schema, KEYFRAME_INTERVAL);
+		for (i = 0, length = 0; i < RUN_LENGTH; ++i) {
+			const uint16_t n = LogEncode(&e, &run[i], &stream[length]);
+			if (i == lost) {
+				missing[i] = true;
+				LogEncoderRestart(&e);
+				continue;
+			}
+			length += n;
+		}
+		assert(CheckStream(&schema, length, missing) == RUN_LENGTH - 1);
+		memset(missing, 0, sizeof(missing));
+		printf("Recovered from a lost and a corrupted frame.\n");
+	}
+
+	// Incompressible samples are sent as keyframes, so frames are never larger than those.
+	{
+		LogEncoderInit(&e, &schema, KEYFRAME_INTERVAL);
+		for (i = 0, length = 0; i < 500; ++i) {
+			uint8_t j, *p = (uint8_t *)&run[i];
+			for (j = 0; j < sizeof(run[i]); ++j) {
+				p[j] = rand();
+			}
+			const uint16_t n = LogEncode(&e, &run[i], &stream[length]);
+			assert(n <= MAVLINK_MSG_ID_CONTROLLER_DATA_LEN + LOG_STREAM_NUM_NON_PAYLOAD_BYTES);
+			length += n;
+		}
+		LogDecoder d;
+		mavlink_controller_data_t decoded;
+		uint16_t offset = 0, n;
+		LogDecoderInit(&d, &schema);
+		for (i = 0; (n = LogStreamNextFrame(stream, length, &offset)); ++i) {
+			assert(LogDecode(&d, &stream[offset], &decoded));
+			assert(memcmp(&decoded, &run[i], MAVLINK_MSG_ID_CONTROLLER_DATA_LEN) == 0);
+			offset += n;
+		}
+		assert(i == 500);
+		printf("Random samples round-trip too.\n");
+	}
+
+	// Benchmark the size and encoding time on the simulated run.
+	{
+		const uint16_t repeats = 200;
+		uint8_t frame[LOG_STREAM_MAX_FRAME_LEN];
+		uint32_t keyframes = 0;
+		uint16_t r;
+		SimulateRun();
+		LogEncoderInit(&e, &schema, KEYFRAME_INTERVAL);
+		for (i = 0, length = 0; i < RUN_LENGTH; ++i) {
+			length += LogEncode(&e, &run[i], frame);
+			keyframes += !!(frame[3] & LOG_STREAM_KEYFRAME);
+		}
+		const uint32_t mavlinkLength = RUN_LENGTH * (MAVLINK_MSG_ID_CONTROLLER_DATA_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+
+		clock_t start = clock();
+		for (r = 0; r < repeats; ++r) {
+			LogEncoderInit(&e, &schema, KEYFRAME_INTERVAL);
+			for (i = 0; i < RUN_LENGTH; ++i) {
+				LogEncode(&e, &run[i], frame);
+			}
+		}
+		const double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / repeats / RUN_LENGTH;
+
+		printf("\nCONTROLLER_DATA at 100Hz over %u s, one keyframe per %u frames:\n", RUN_LENGTH / 100, KEYFRAME_INTERVAL);
+		printf("  MAVLink 1:   %7u B, %5.1f B/frame, %5u B/s\n", mavlinkLength, (double)mavlinkLength / RUN_LENGTH, mavlinkLength / (RUN_LENGTH / 100));
+		printf("  Log stream:  %7u B, %5.1f B/frame, %5u B/s (%u keyframes)\n", length, (double)length / RUN_LENGTH, length / (RUN_LENGTH / 100), keyframes);
+		printf("  Ratio:       %.2f\n", (double)mavlinkLength / length);
+		printf("  Encoding:    %.0f ns/frame on this host\n", ns);
+		assert(length * 2 < mavlinkLength);
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_LOG_STREAM
@@ -0,0 +1,121 @@
+/**
+ * @file   LogStream.h
+ * @brief  Compact binary frames for logging MAVLink payloads at high rates.
+ *
+ * Logged messages change little from one sample to the next, yet every MAVLink frame carries the
+ * whole payload. A LogEncoder instead sends the difference of every field to the previous sample:
+ *  * Every frame starts with a bitmap of the fields that changed, followed by their differences as
+ *    zigzag varints, so unchanged fields cost a single bit and small changes a single byte.
+ *    Differences wrap at the width of their field, so decoding reconstructs the exact values.
+ *  * Every so often a keyframe carries the raw payload instead. Decoding can start at any
+ *    keyframe, and picks up again at the next one after a lost or corrupted frame. Frames whose
+ *    differences wouldn't be any smaller than the raw payload are sent as keyframes too.
+ *
+ * Frames are laid out as:
+ *   | LOG_STREAM_SYNC | payload length | message ID | keyframe bit + 7-bit sequence | payload | CRC |
+ * where the CRC is the MAVLink X.25 checksum of everything but the sync byte. They can share a link
+ * with regular MAVLink frames, which receivers skip over like any other noise.
+ *
+ * The fields of a message are described by a LogSchema, built from the field information the MAVLink
+ * generator emits for every message (MAVLINK_MESSAGE_INFO_*). Fields wider than 32 bits aren't
+ * supported.
+ *
+ * Unit testing, which includes a benchmark of the compression ratio and encoding time on a
+ * simulated run of CONTROLLER_DATA messages, is done on x86 by compiling with the
+ * UNIT_TEST_LOG_STREAM macro:
+ * `gcc LogStream.c -DUNIT_TEST_LOG_STREAM -I../MAVLink/seaslug -O2 -Wall -lm`
+ * Recorded runs are decoded and benchmarked with Scripts/C/LogDecode.c.
+ */
+#ifndef LOG_STREAM_H
+#define LOG_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <mavlink.h>
+
+#define LOG_STREAM_SYNC 0xA5
+
+// The sync byte, length, message ID, and sequence number, plus the 2-byte CRC.
+#define LOG_STREAM_NUM_NON_PAYLOAD_BYTES 6
+#define LOG_STREAM_MAX_PAYLOAD_LEN 255
+#define LOG_STREAM_MAX_FRAME_LEN (LOG_STREAM_MAX_PAYLOAD_LEN + LOG_STREAM_NUM_NON_PAYLOAD_BYTES)
+
+// The most fields a message can have, counting every element of an array as its own field.
+#define LOG_STREAM_MAX_FIELDS 64
+
+// Set in the sequence byte of keyframes.
+#define LOG_STREAM_KEYFRAME 0x80
+
+/**
+ * The layout of a message's payload, shared by its encoder and decoder.
+ */
+typedef struct {
+	uint8_t MsgId;
+	uint8_t Length;                        // The size of the payload in bytes.
+	uint8_t Count;                         // The number of fields.
+	uint8_t Widths[LOG_STREAM_MAX_FIELDS]; // The size of every field in bytes, in wire order.
+} LogSchema;
+
+typedef struct {
+	const LogSchema *Schema;
+	uint8_t KeyframeInterval; // Frames from one keyframe to the next.
+	uint8_t SinceKeyframe;    // Frames sent since the last keyframe.
+	uint8_t Seq;
+	uint8_t Previous[LOG_STREAM_MAX_PAYLOAD_LEN];
+} LogEncoder;
+
+typedef struct {
+	const LogSchema *Schema;
+	bool Synced;              // Whether the last frame was decoded, so the next delta can be.
+	uint8_t NextSeq;
+	uint8_t Previous[LOG_STREAM_MAX_PAYLOAD_LEN];
+	uint32_t Frames;          // Frames decoded.
+	uint32_t Keyframes;       // Keyframes among those.
+	uint32_t Skipped;         // Frames that couldn't be decoded while waiting for a keyframe.
+} LogDecoder;
+
+/**
+ * Describes a message from its MAVLink field information.
+ * @return False if a field is wider than 32 bits or there are too many of them.
+ */
+bool LogSchemaInit(LogSchema *s, uint8_t msgid, const mavlink_message_info_t *info);
+
+/**
+ * Sets up an encoder, whose first frame will be a keyframe.
+ * @param keyframeInterval Sends a keyframe every this many frames.
+ */
+void LogEncoderInit(LogEncoder *e, const LogSchema *schema, uint8_t keyframeInterval);
+
+/**
+ * Makes the next frame a keyframe. Call this if a frame couldn't be sent, as every later frame
+ * depends on it.
+ */
+void LogEncoderRestart(LogEncoder *e);
+
+/**
+ * Encodes a payload into a complete frame.
+ * @param payload The message's payload, generally a mavlink_*_t struct.
+ * @param frame At least schema->Length + LOG_STREAM_NUM_NON_PAYLOAD_BYTES bytes.
+ * @return The size of the frame, never more than that.
+ */
+uint16_t LogEncode(LogEncoder *e, const void *payload, uint8_t *frame);
+
+/**
+ * Finds the next complete frame with a valid checksum, starting at `*offset`. Anything before it
+ * isn't a frame and can be discarded.
+ * @return The size of the frame, which starts at `*offset`. 0 if there's none, in which case
+ *         everything before `*offset` can be discarded, and the rest may still start a frame once
+ *         more data has arrived.
+ */
+uint16_t LogStreamNextFrame(const uint8_t *data, uint16_t length, uint16_t *offset);
+
+void LogDecoderInit(LogDecoder *d, const LogSchema *schema);
+
+/**
+ * Reconstructs the payload of a frame for the decoder's message, from LogStreamNextFrame().
+ * @return False if the frame can't be decoded because an earlier one was lost.
+ */
+bool LogDecode(LogDecoder *d, const uint8_t *frame, void *payload);
+
+#endif // LOG_STREAM_H
@@ -0,0 +1,423 @@
+#include "MavlinkBatch.h"
+
+#include <string.h>
+
+#include <../checksum.h>
+#include <mavlink.h>
+
+void MavlinkBatchInit(MavlinkBatch *b, uint8_t chan, uint8_t sysid, uint8_t compid)
+{
+	b->Chan = chan;
+	b->Count = 0;
+	b->Length = 0;
+	b->Frame[0] = MAVLINK_BATCH_SYNC;
+	b->Frame[3] = sysid;
+	b->Frame[4] = compid;
+}
+
+bool MavlinkBatchAdd(MavlinkBatch *b, uint8_t msgid, const void *payload, uint8_t length)
+{
+	mavlink_status_t *status = mavlink_get_channel_status(b->Chan);
+	length = _mav_trim_payload((const char *)payload, length);
+	if (b->Length + MAVLINK_BATCH_ENTRY_HEADER_LEN + length > MAVLINK_BATCH_MAX_PAYLOAD_LEN) {
+		return false;
+	}
+
+	if (!b->Count) {
+		b->Frame[2] = status->current_tx_seq;
+	}
+	uint8_t *entry = &b->Frame[MAVLINK_BATCH_HEADER_LEN + b->Length];
+	entry[0] = msgid;
+	entry[1] = length;
+	memcpy(&entry[MAVLINK_BATCH_ENTRY_HEADER_LEN], payload, length);
+	b->Length += MAVLINK_BATCH_ENTRY_HEADER_LEN + length;
+	++b->Count;
+	++status->current_tx_seq;
+	return true;
+}
+
+uint16_t MavlinkBatchFinish(MavlinkBatch *b)
+{
+	if (!b->Count) {
+		return 0;
+	}
+
+	const uint16_t end = MAVLINK_BATCH_HEADER_LEN + b->Length;
+	b->Frame[1] = b->Length;
+	const uint16_t crc = crc_calculate(&b->Frame[1], end - 1);
+	b->Frame[end] = crc & 0xFF;
+	b->Frame[end + 1] = crc >> 8;
+
+	b->Count = 0;
+	b->Length = 0;
+	return end + 2;
+}
+
+uint16_t MavlinkBatchNextFrame(const uint8_t *data, uint16_t length, uint16_t *offset)
+{
+	while (*offset < length) {
+		const uint8_t *frame = &data[*offset];
+		const uint16_t available = length - *offset;
+		if (frame[0] != MAVLINK_BATCH_SYNC) {
+			++*offset;
+			continue;
+		}
+		if (available < 2 || available < frame[1] + MAVLINK_BATCH_NUM_NON_PAYLOAD_BYTES) {
+			return 0;
+		}
+
+		const uint16_t end = MAVLINK_BATCH_HEADER_LEN + frame[1];
+		const uint16_t crc = crc_calculate(&frame[1], end - 1);
+		if (frame[end] == (crc & 0xFF) && frame[end + 1] == (crc >> 8)) {
+			return end + 2;
+		}
+
+		// Not a batch after all, so one may start within it.
+		++*offset;
+	}
+	return 0;
+}
+
+bool MavlinkBatchNextEntry(const uint8_t *frame, uint16_t *position, MavlinkBatchEntry *entry)
+{
+	const uint8_t *messages = &frame[MAVLINK_BATCH_HEADER_LEN];
+	const uint16_t length = frame[1];
+	uint16_t p, seq = 0;
+
+	// Every message used up a sequence number, so count the ones before this.
+	for (p = 0; p < *position; p += MAVLINK_BATCH_ENTRY_HEADER_LEN + messages[p + 1]) {
+		++seq;
+	}
+	if (p + MAVLINK_BATCH_ENTRY_HEADER_LEN > length || p + MAVLINK_BATCH_ENTRY_HEADER_LEN + messages[p + 1] > length) {
+		return false;
+	}
+
+	entry->MsgId = messages[p];
+	entry->Length = messages[p + 1];
+	entry->Payload = &messages[p + MAVLINK_BATCH_ENTRY_HEADER_LEN];
+	entry->Seq = frame[2] + seq;
+	entry->SysId = frame[3];
+	entry->CompId = frame[4];
+	*position = p + MAVLINK_BATCH_ENTRY_HEADER_LEN + entry->Length;
+	return true;
+}
+
+#ifdef UNIT_TEST_MAVLINK_BATCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define CHAN MAVLINK_COMM_0
+
+static const uint8_t messageLengths[256] = MAVLINK_MESSAGE_LENGTHS;
+
+/**
+ * Fills a payload with data that's zero as often as telemetry tends to be.
+ */
+static void RandomPayload(uint8_t *payload, uint8_t length)
+{
+	uint8_t i;
+	for (i = 0; i < length; ++i) {
+		payload[i] = (rand() % 10 < 3) ? 0 : (uint8_t)rand();
+	}
+}
+
+/**
+ * Batches random payloads of every seaslug message and unpacks them again, with MAVLink frames and
+ * noise around the batches and corrupted batches that have to be skipped.
+ */
+static void TestRoundTrip(void)
+{
+	static uint8_t stream[1 << 16];
+	static uint8_t sent[1 << 12][MAVLINK_MAX_PAYLOAD_LEN];
+	static uint8_t sentIds[1 << 12];
+	MavlinkBatch b;
+	uint16_t streamLength = 0, nSent = 0, n;
+	uint16_t i;
+
+	srand(1);
+	mavlink_get_channel_status(CHAN)->current_tx_seq = 250; // Wraps around within a batch.
+	MavlinkBatchInit(&b, CHAN, 42, 200);
+
+	// An empty batch isn't a frame.
+	assert(MavlinkBatchFinish(&b) == 0);
+
+	uint16_t corrupted = 0xFFFF;
+	while (nSent < (1 << 12) - 64 && streamLength < sizeof(stream) - 2 * MAVLINK_BATCH_MAX_FRAME_LEN) {
+		// Fill a batch with random messages until one doesn't fit.
+		while (true) {
+			uint8_t msgid = (uint8_t)rand();
+			if (!messageLengths[msgid] || messageLengths[msgid] + MAVLINK_BATCH_ENTRY_HEADER_LEN > MAVLINK_BATCH_MAX_PAYLOAD_LEN) {
+				continue;
+			}
+			RandomPayload(sent[nSent], messageLengths[msgid]);
+			const uint8_t seq = mavlink_get_channel_status(CHAN)->current_tx_seq;
+			if (!MavlinkBatchAdd(&b, msgid, sent[nSent], messageLengths[msgid])) {
+				// Nothing changed.
+				assert(mavlink_get_channel_status(CHAN)->current_tx_seq == seq);
+				break;
+			}
+			sentIds[nSent++] = msgid;
+		}
+		n = MavlinkBatchFinish(&b);
+		assert(n > MAVLINK_BATCH_NUM_NON_PAYLOAD_BYTES && n <= MAVLINK_BATCH_MAX_FRAME_LEN);
+
+		// A stray sync byte, and a MAVLink frame that happens to contain one, before the batch.
+		stream[streamLength++] = MAVLINK_BATCH_SYNC;
+		mavlink_message_t msg;
+		mavlink_msg_gps200_pack_chan(1, 1, MAVLINK_COMM_1, &msg, 0.0f);
+		_MAV_PAYLOAD_NON_CONST(&msg)[0] = MAVLINK_BATCH_SYNC;
+		streamLength += mavlink_msg_to_send_buffer(&stream[streamLength], &msg);
+		memcpy(&stream[streamLength], b.Frame, n);
+
+		// Corrupt one batch, whose messages are then expected to be lost.
+		if (corrupted == 0xFFFF && nSent > 1000) {
+			stream[streamLength + n / 2] ^= 0x10;
+			corrupted = streamLength;
+		}
+		streamLength += n;
+	}
+
+	// Unpack everything, comparing it against what was batched.
+	uint16_t offset = 0, frameLength, received = 0, frames = 0;
+	uint8_t expectedSeq = 250;
+	while ((frameLength = MavlinkBatchNextFrame(stream, streamLength, &offset))) {
+		const uint8_t *frame = &stream[offset];
+		MavlinkBatchEntry entry;
+		uint16_t position = 0;
+		assert(offset != corrupted);
+		// Skip the messages of the corrupted batch.
+		while (frame[2] != expectedSeq) {
+			++received;
+			++expectedSeq;
+		}
+		while (MavlinkBatchNextEntry(frame, &position, &entry)) {
+			assert(entry.MsgId == sentIds[received]);
+			assert(entry.Seq == expectedSeq);
+			assert(entry.SysId == 42 && entry.CompId == 200);
+			assert(entry.Length <= messageLengths[entry.MsgId]);
+			assert(memcmp(entry.Payload, sent[received], entry.Length) == 0);
+			for (i = entry.Length; i < messageLengths[entry.MsgId]; ++i) {
+				assert(sent[received][i] == 0);
+			}
+			++received;
+			++expectedSeq;
+		}
+		offset += frameLength;
+		++frames;
+	}
+	assert(corrupted != 0xFFFF && received == nSent);
+	printf("Round trip: OK, %u messages in %u batches\n", nSent, frames);
+}
+
+// The radio link, as assumed by MavLinkInit(): 64kbps over the air, halved by error correction.
+// Every packet the radio sends costs its preamble, header, and checksum on top, and it sends
+// whatever it has queued whenever it's done with the previous packet.
+#define RADIO_BYTES_PER_SECOND (64000.0 / 10 / 2)
+#define RADIO_MAX_PACKET 252
+#define RADIO_PACKET_OVERHEAD 13
+#define RADIO_BUFFER 1024        // The UART1 transmit buffer, plus nothing in the radio itself.
+
+#define TICK_RATE 100
+#define SIM_SECONDS 60
+#define MAX_QUEUED 4096
+
+/**
+ * The groundstation telemetry messages and their rates, from MavLinkInit().
+ */
+static const struct {
+	uint8_t msgid;
+	uint8_t rate;
+} telemetry[] = {
+	{MAVLINK_MSG_ID_HEARTBEAT, 2}, {MAVLINK_MSG_ID_SYS_STATUS, 2}, {MAVLINK_MSG_ID_SYSTEM_TIME, 1},
+	{MAVLINK_MSG_ID_LOCAL_POSITION_NED, 5}, {MAVLINK_MSG_ID_ATTITUDE, 4}, {MAVLINK_MSG_ID_GPS_RAW_INT, 4},
+	{MAVLINK_MSG_ID_WSO100, 1}, {MAVLINK_MSG_ID_BASIC_STATE2, 1}, {MAVLINK_MSG_ID_RUDDER_RAW, 1},
+	{MAVLINK_MSG_ID_DST800, 1}, {MAVLINK_MSG_ID_MAIN_POWER, 2}, {MAVLINK_MSG_ID_NODE_STATUS, 1},
+	{MAVLINK_MSG_ID_WAYPOINT_STATUS, 1}, {MAVLINK_MSG_ID_VFR_HUD, 5}, {MAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT, 2},
+	{MAVLINK_MSG_ID_LINK_STATS, 2}
+};
+#define TELEMETRY_MESSAGES (sizeof(telemetry) / sizeof(telemetry[0]))
+
+/**
+ * A frame queued for the radio: a single MAVLink frame, or a batch of several messages.
+ */
+typedef struct {
+	uint16_t bytes;    // Still to be sent.
+	uint8_t messages;
+	uint16_t payload;  // The bytes of message payloads it carries.
+	double queuedAt;
+} SimFrame;
+
+typedef struct {
+	uint32_t offered;
+	uint32_t messages;      // Delivered.
+	uint32_t payloadBytes;  // Delivered.
+	uint32_t dropped;       // Messages that didn't fit into the transmit buffer.
+	double latencySum;
+	double latencyMax;
+	uint32_t latencyHistogram[1000]; // In ms.
+} SimResult;
+
+/**
+ * Queues a frame for the radio, unless the transmit buffer doesn't have room for it.
+ */
+static void SimQueue(SimFrame *queue, uint16_t *tail, uint32_t *buffered, SimFrame f, SimResult *r)
+{
+	if (*buffered + f.bytes > RADIO_BUFFER) {
+		r->dropped += f.messages;
+		return;
+	}
+	*buffered += f.bytes;
+	queue[*tail] = f;
+	*tail = (*tail + 1) % MAX_QUEUED;
+}
+
+/**
+ * Runs a minute of telemetry at `load` times the rates of the schedule through the radio, either as
+ * MAVLink 2 frames like the groundstation link sends them, or batched per timestep.
+ */
+static SimResult Simulate(uint8_t load, bool batched)
+{
+	static SimFrame queue[MAX_QUEUED];
+	uint16_t head = 0, tail = 0;
+	uint32_t buffered = 0;
+	double radioTime = 0;
+	SimResult r = {};
+	MavlinkBatch b;
+	SimFrame batch = {};
+	uint32_t tick;
+	uint8_t payload[MAVLINK_MAX_PAYLOAD_LEN];
+
+	srand(2);
+	MavlinkBatchInit(&b, CHAN, 1, 1);
+	for (tick = 0; tick < SIM_SECONDS * TICK_RATE; ++tick) {
+		const double now = (double)tick / TICK_RATE;
+		uint8_t i, copy;
+
+		// Queue this timestep's messages, with every copy of a message spread out like the scheduler
+		// would.
+		for (copy = 0; copy < load; ++copy) {
+			for (i = 0; i < TELEMETRY_MESSAGES; ++i) {
+				const uint16_t period = TICK_RATE / telemetry[i].rate;
+				if ((tick + i * 7 + copy * 13) % period) {
+					continue;
+				}
+				const uint8_t msgid = telemetry[i].msgid, length = messageLengths[msgid];
+				RandomPayload(payload, length);
+				++r.offered;
+				if (batched) {
+					if (!MavlinkBatchAdd(&b, msgid, payload, length)) {
+						batch.bytes = MavlinkBatchFinish(&b);
+						SimQueue(queue, &tail, &buffered, batch, &r);
+						batch = (SimFrame){.queuedAt = now};
+						MavlinkBatchAdd(&b, msgid, payload, length);
+					}
+					batch.queuedAt = now;
+					++batch.messages;
+					batch.payload += length;
+				} else {
+					const uint8_t trimmed = _mav_trim_payload((const char *)payload, length);
+					SimFrame f = {length + MAVLINK_NUM_NON_PAYLOAD_BYTES, 1, length, now};
+					if (trimmed + MAVLINK2_NUM_NON_PAYLOAD_BYTES < f.bytes) {
+						f.bytes = trimmed + MAVLINK2_NUM_NON_PAYLOAD_BYTES;
+					}
+					SimQueue(queue, &tail, &buffered, f, &r);
+				}
+			}
+		}
+		if (batched && (batch.bytes = MavlinkBatchFinish(&b))) {
+			SimQueue(queue, &tail, &buffered, batch, &r);
+			batch = (SimFrame){};
+		}
+
+		// Send packets until the next timestep. A frame is delivered with the packet carrying its last
+		// byte, as that's when its checksum can be verified.
+		const double end = now + 1.0 / TICK_RATE;
+		while (head != tail) {
+			if (radioTime < queue[head].queuedAt) {
+				radioTime = queue[head].queuedAt;
+			}
+			if (radioTime >= end) {
+				break;
+			}
+			uint16_t n = 0, h = head;
+			while (h != tail && n < RADIO_MAX_PACKET) {
+				const uint16_t take = queue[h].bytes < RADIO_MAX_PACKET - n ? queue[h].bytes : RADIO_MAX_PACKET - n;
+				queue[h].bytes -= take;
+				n += take;
+				if (queue[h].bytes) {
+					break;
+				}
+				h = (h + 1) % MAX_QUEUED;
+			}
+			radioTime += (n + RADIO_PACKET_OVERHEAD) / RADIO_BYTES_PER_SECOND;
+			buffered -= n;
+			for (; head != h; head = (head + 1) % MAX_QUEUED) {
+				const double latency = radioTime - queue[head].queuedAt;
+				const uint16_t ms = latency * 1000 < 999 ? (uint16_t)(latency * 1000) : 999;
+				r.messages += queue[head].messages;
+				r.payloadBytes += queue[head].payload;
+				r.latencySum += latency * queue[head].messages;
+				r.latencyHistogram[ms] += queue[head].messages;
+				if (latency > r.latencyMax) {
+					r.latencyMax = latency;
+				}
+			}
+		}
+	}
+	return r;
+}
+
+/**
+ * Returns the latency that 99% of the messages were delivered within, in ms.
+ */
+static uint16_t Percentile99(const SimResult *r)
+{
+	uint32_t count = 0;
+	uint16_t ms;
+	for (ms = 0; ms < 999; ++ms) {
+		count += r->latencyHistogram[ms];
+		if (count * 100 >= r->messages * 99) {
+			break;
+		}
+	}
+	return ms + 1;
+}
+
+/**
+ * Compares plain MAVLink 2 frames against batches on the radio link, at the rates of the
+ * groundstation schedule and multiples of them until the link saturates.
+ */
+static void Benchmark(void)
+{
+	uint8_t load;
+
+	printf("\nGroundstation telemetry over a %.0f B/s radio with %d bytes per packet, %d s per run:\n",
+	       RADIO_BYTES_PER_SECOND, RADIO_PACKET_OVERHEAD, SIM_SECONDS);
+	printf("%5s %8s | %-36s | %-36s\n", "", "", "MAVLink 2 frames", "Batched per timestep");
+	printf("%5s %8s | %8s %8s %8s %8s | %8s %8s %8s %8s\n", "Load", "Offered", "Msgs/s", "Data B/s",
+	       "Mean ms", "99% ms", "Msgs/s", "Data B/s", "Mean ms", "99% ms");
+	for (load = 1; load <= 6; ++load) {
+		const SimResult plain = Simulate(load, false), batched = Simulate(load, true);
+		assert(batched.offered == plain.offered);
+		printf("%4ux %8.1f | %8.1f %8.0f %8.1f %8u | %8.1f %8.0f %8.1f %8u\n", load, (double)plain.offered / SIM_SECONDS,
+		       (double)plain.messages / SIM_SECONDS, (double)plain.payloadBytes / SIM_SECONDS,
+		       1000 * plain.latencySum / plain.messages, Percentile99(&plain),
+		       (double)batched.messages / SIM_SECONDS, (double)batched.payloadBytes / SIM_SECONDS,
+		       1000 * batched.latencySum / batched.messages, Percentile99(&batched));
+
+		// Batching never delivers less.
+		assert(batched.messages >= plain.messages);
+	}
+}
+
+int main(void)
+{
+	TestRoundTrip();
+	Benchmark();
+	printf("\nAll tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_MAVLINK_BATCH
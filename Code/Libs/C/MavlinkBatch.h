@@ -0,0 +1,105 @@
+/**
+ * @file   MavlinkBatch.h
+ * @brief  Packs several short MAVLink messages into a single frame.
+ *
+ * Most scheduled telemetry messages are only 10-30 bytes long, yet each one carries 8 bytes of
+ * MAVLink 1 framing, or 12 of MAVLink 2. A MavlinkBatch instead collects all of the messages sent
+ * during a timestep into one frame with one header and one checksum, which leaves 2 bytes of framing
+ * per message. Payloads have their trailing zeros trimmed like in MAVLink 2.
+ *
+ * Frames are laid out as:
+ *   | MAVLINK_BATCH_SYNC | length | sequence | system ID | component ID | messages | CRC |
+ * where every message is:
+ *   | message ID | payload length | payload |
+ * The length counts the bytes of all messages, and the CRC is the MAVLink X.25 checksum of
+ * everything but the sync byte. The sequence number is that of the first message. Every message
+ * uses up a sequence number of the channel it's batched for, shared with the frames
+ * MavlinkSerialize() writes, so batched and regular frames can be mixed and the receiving end can
+ * still tell how many messages were lost.
+ *
+ * Batches aren't understood by groundstations, so on the ground they're unpacked back into regular
+ * MAVLink frames with MavlinkBatchNextFrame() and MavlinkBatchNextEntry(). Scripts/C/MavlinkUnbatch.c
+ * does this as a proxy between the radio and QGroundControl.
+ *
+ * Unit testing, which includes a benchmark of the effective throughput and latency of a 64kbps
+ * radio link carrying the groundstation telemetry with and without batching, is done on x86 by
+ * compiling with the UNIT_TEST_MAVLINK_BATCH macro:
+ * `gcc MavlinkBatch.c MavlinkHelpers.c -DUNIT_TEST_MAVLINK_BATCH -DMAVLINK_SEPARATE_HELPERS -I../MAVLink/seaslug -O2 -Wall`
+ */
+#ifndef MAVLINK_BATCH_H
+#define MAVLINK_BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAVLINK_BATCH_SYNC 0xB5
+
+// The sync byte, length, sequence number, system and component IDs, plus the 2-byte CRC.
+#define MAVLINK_BATCH_HEADER_LEN 5
+#define MAVLINK_BATCH_NUM_NON_PAYLOAD_BYTES 7
+// The message ID and payload length in front of every message.
+#define MAVLINK_BATCH_ENTRY_HEADER_LEN 2
+#define MAVLINK_BATCH_MAX_PAYLOAD_LEN 255
+#define MAVLINK_BATCH_MAX_FRAME_LEN (MAVLINK_BATCH_MAX_PAYLOAD_LEN + MAVLINK_BATCH_NUM_NON_PAYLOAD_BYTES)
+
+/**
+ * A batch being collected. Initialize with MavlinkBatchInit().
+ */
+typedef struct {
+	uint8_t Chan;      // The MAVLink channel whose sequence numbers are used.
+	uint8_t Count;     // Messages in the batch.
+	uint16_t Length;   // Bytes of messages in the batch.
+	uint8_t Frame[MAVLINK_BATCH_MAX_FRAME_LEN];
+} MavlinkBatch;
+
+/**
+ * A message unpacked from a batch. The payload points into the frame and is trimmed, so it has to
+ * be padded with zeros up to the message's full length.
+ */
+typedef struct {
+	uint8_t MsgId;
+	uint8_t Seq;
+	uint8_t SysId;
+	uint8_t CompId;
+	uint8_t Length;
+	const uint8_t *Payload;
+} MavlinkBatchEntry;
+
+/**
+ * Sets up an empty batch.
+ */
+void MavlinkBatchInit(MavlinkBatch *b, uint8_t chan, uint8_t sysid, uint8_t compid);
+
+/**
+ * Adds a message to the batch, taking the next sequence number of its channel.
+ * @param payload The message's payload, generally a mavlink_*_t struct.
+ * @return False if the batch doesn't have room for it, in which case nothing changed. Payloads that
+ *         are still longer than MAVLINK_BATCH_MAX_PAYLOAD_LEN - MAVLINK_BATCH_ENTRY_HEADER_LEN bytes
+ *         once trimmed never fit.
+ */
+bool MavlinkBatchAdd(MavlinkBatch *b, uint8_t msgid, const void *payload, uint8_t length);
+
+/**
+ * Completes the frame in `Frame` and empties the batch for the next one. The frame stays valid
+ * until the next MavlinkBatchAdd().
+ * @return The size of the frame, or 0 if the batch was empty.
+ */
+uint16_t MavlinkBatchFinish(MavlinkBatch *b);
+
+/**
+ * Finds the next complete batch with a valid checksum, starting at `*offset`. Anything before it
+ * isn't part of a batch, like regular MAVLink frames.
+ * @return The size of the frame, which starts at `*offset`. 0 if there's none, in which case
+ *         nothing before `*offset` is part of a batch, and the rest may still start one once more
+ *         data has arrived.
+ */
+uint16_t MavlinkBatchNextFrame(const uint8_t *data, uint16_t length, uint16_t *offset);
+
+/**
+ * Unpacks the messages of a frame from MavlinkBatchNextFrame() one at a time.
+ * @param position The message to unpack, starting at 0 for the first. Advanced to the next one.
+ * @return False once there are no messages left.
+ */
+bool MavlinkBatchNextEntry(const uint8_t *frame, uint16_t *position, MavlinkBatchEntry *entry);
+
+#endif // MAVLINK_BATCH_H
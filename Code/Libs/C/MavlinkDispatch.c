@@ -0,0 +1,278 @@
+#include "MavlinkDispatch.h"
+
+#include <string.h>
+
+void MavlinkDispatchInit(MavlinkDispatchTable *table, uint32_t (*clock)(void))
+{
+	memset(table->Map, 0, sizeof(table->Map));
+	memset(table->Slots, 0, table->SlotCount * sizeof(MavlinkDispatchSlot));
+	table->Registered = 0;
+	table->Unhandled = 0;
+	table->Clock = clock;
+}
+
+bool MavlinkDispatchRegister(MavlinkDispatchTable *table, uint8_t msgid, MavlinkHandler handler)
+{
+	if (table->Map[msgid] || table->Registered == table->SlotCount) {
+		return false;
+	}
+
+	MavlinkDispatchSlot *slot = &table->Slots[table->Registered];
+	slot->Handler = handler;
+	slot->MsgId = msgid;
+	memset(&slot->Stats, 0, sizeof(slot->Stats));
+	table->Map[msgid] = ++table->Registered;
+	return true;
+}
+
+bool MavlinkDispatch(MavlinkDispatchTable *table, uint8_t channel, uint8_t msgid, const mavlink_message_t *msg)
+{
+	const uint8_t i = table->Map[msgid];
+	if (!i) {
+		++table->Unhandled;
+		return false;
+	}
+
+	MavlinkDispatchSlot *slot = &table->Slots[i - 1];
+	uint16_t queued;
+	if (table->Clock) {
+		const uint32_t start = table->Clock();
+		queued = slot->Handler(channel, msg);
+		slot->Stats.Cycles += table->Clock() - start;
+	} else {
+		queued = slot->Handler(channel, msg);
+	}
+	++slot->Stats.Count;
+	slot->Stats.Bytes += msg ? mavlink_msg_get_send_buffer_length(msg) : queued;
+	return true;
+}
+
+const MavlinkDispatchStats *MavlinkDispatchGetStats(const MavlinkDispatchTable *table, uint8_t msgid)
+{
+	const uint8_t i = table->Map[msgid];
+	return i ? &table->Slots[i - 1].Stats : NULL;
+}
+
+void MavlinkDispatchResetStats(MavlinkDispatchTable *table)
+{
+	uint8_t i;
+	for (i = 0; i < table->Registered; ++i) {
+		memset(&table->Slots[i].Stats, 0, sizeof(table->Slots[i].Stats));
+	}
+	table->Unhandled = 0;
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_MAVLINK_DISPATCH
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0
+#endif
+
+// The payload length of every known message, indexed by message ID.
+static const uint8_t messageLengths[256] = MAVLINK_MESSAGE_LENGTHS;
+
+// What every handler claims to queue when transmitting.
+#define TX_BYTES 17
+
+// Every handler just records what it was called with.
+static uint32_t handled[256];
+static uint8_t lastChannel;
+
+static uint16_t Handle(uint8_t channel, const mavlink_message_t *msg)
+{
+	lastChannel = channel;
+	++handled[msg ? msg->msgid : 0];
+	return msg ? 0 : TX_BYTES;
+}
+
+static uint32_t TestClock(void)
+{
+	static uint32_t t = 0;
+	return t += 5;
+}
+
+static uint32_t Rdtsc(void)
+{
+	return (uint32_t)CYCLES();
+}
+
+// The messages the primary node handles on reception, which is what the `switch` being replaced
+// looked like.
+static const uint8_t receivedIds[] = {
+	MAVLINK_MSG_ID_COMMAND_LONG, MAVLINK_MSG_ID_SET_MODE, MAVLINK_MSG_ID_MANUAL_CONTROL,
+	MAVLINK_MSG_ID_MISSION_COUNT, MAVLINK_MSG_ID_MISSION_ITEM, MAVLINK_MSG_ID_MISSION_REQUEST_LIST,
+	MAVLINK_MSG_ID_MISSION_REQUEST, MAVLINK_MSG_ID_MISSION_CLEAR_ALL, MAVLINK_MSG_ID_MISSION_SET_CURRENT,
+	MAVLINK_MSG_ID_MISSION_ACK, MAVLINK_MSG_ID_PARAM_REQUEST_LIST, MAVLINK_MSG_ID_PARAM_REQUEST_READ,
+	MAVLINK_MSG_ID_PARAM_SET, MAVLINK_MSG_ID_RADIO_STATUS
+};
+
+static __attribute__((noinline)) bool SwitchDispatch(uint8_t channel, const mavlink_message_t *msg)
+{
+	switch (msg->msgid) {
+		case MAVLINK_MSG_ID_COMMAND_LONG: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_SET_MODE: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_MANUAL_CONTROL: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_MISSION_COUNT: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_MISSION_ITEM: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_MISSION_REQUEST_LIST: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_MISSION_REQUEST: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_MISSION_CLEAR_ALL: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_MISSION_SET_CURRENT: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_MISSION_ACK: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_PARAM_REQUEST_LIST: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_PARAM_REQUEST_READ: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_PARAM_SET: Handle(channel, msg); break;
+		case MAVLINK_MSG_ID_RADIO_STATUS: Handle(channel, msg); break;
+		default: return false;
+	}
+	return true;
+}
+
+#define STREAM_LENGTH 4096
+#define BENCH_ROUNDS 2000
+
+static mavlink_message_t messages[STREAM_LENGTH];
+
+/**
+ * Runs every message in `messages` through either the switch or a table and returns the average
+ * cost of a dispatch in TSC cycles.
+ */
+static double Benchmark(MavlinkDispatchTable *table)
+{
+	uint64_t start = CYCLES();
+	int round, i;
+	for (round = 0; round < BENCH_ROUNDS; ++round) {
+		for (i = 0; i < STREAM_LENGTH; ++i) {
+			if (table) {
+				MavlinkDispatch(table, 0, messages[i].msgid, &messages[i]);
+			} else {
+				SwitchDispatch(0, &messages[i]);
+			}
+		}
+	}
+	return (double)(CYCLES() - start) / ((double)BENCH_ROUNDS * STREAM_LENGTH);
+}
+
+int main(void)
+{
+	static MavlinkDispatchSlot slots[256];
+	static MavlinkDispatchTable table = {.Slots = slots, .SlotCount = 255};
+	uint16_t ids[256], nIds = 0, i;
+
+	for (i = 0; i < 256; ++i) {
+		if (messageLengths[i]) {
+			ids[nIds++] = i;
+		}
+	}
+
+	// Registration fails for duplicates and when the table is full.
+	{
+		static MavlinkDispatchSlot small[2];
+		static MavlinkDispatchTable t = {.Slots = small, .SlotCount = 2};
+		MavlinkDispatchInit(&t, NULL);
+		assert(MavlinkDispatchRegister(&t, MAVLINK_MSG_ID_HEARTBEAT, Handle));
+		assert(!MavlinkDispatchRegister(&t, MAVLINK_MSG_ID_HEARTBEAT, Handle));
+		assert(MavlinkDispatchRegister(&t, MAVLINK_MSG_ID_SYS_STATUS, Handle));
+		assert(!MavlinkDispatchRegister(&t, MAVLINK_MSG_ID_ATTITUDE, Handle));
+		assert(MavlinkDispatchGetStats(&t, MAVLINK_MSG_ID_ATTITUDE) == NULL);
+		printf("Registration refuses duplicates and overflow.\n");
+	}
+
+	// Every message of the dialect goes to its handler with the right statistics, both received and
+	// transmitted.
+	{
+		mavlink_message_t msg = {.magic = MAVLINK_STX};
+		MavlinkDispatchInit(&table, TestClock);
+		for (i = 0; i < nIds; ++i) {
+			assert(MavlinkDispatchRegister(&table, ids[i], Handle));
+		}
+		memset(handled, 0, sizeof(handled));
+		for (i = 0; i < nIds; ++i) {
+			msg.msgid = ids[i];
+			msg.len = messageLengths[ids[i]];
+			assert(MavlinkDispatch(&table, 3, ids[i], &msg));
+			assert(handled[ids[i]] == 1 && lastChannel == 3);
+			assert(MavlinkDispatch(&table, 1, ids[i], NULL));
+			assert(lastChannel == 1);
+
+			const MavlinkDispatchStats *s = MavlinkDispatchGetStats(&table, ids[i]);
+			assert(s->Count == 2);
+			assert(s->Bytes == messageLengths[ids[i]] + MAVLINK_NUM_NON_PAYLOAD_BYTES + TX_BYTES);
+			assert(s->Cycles == 10);
+		}
+
+		// Unhandled IDs are counted but nothing else changes.
+		for (i = 0; i < 256; ++i) {
+			if (!messageLengths[i]) {
+				assert(!MavlinkDispatch(&table, 0, i, NULL));
+			}
+		}
+		assert(table.Unhandled == 256 - nIds);
+
+		MavlinkDispatchResetStats(&table);
+		assert(table.Unhandled == 0 && MavlinkDispatchGetStats(&table, ids[0])->Count == 0);
+		printf("All %u seaslug messages dispatched with correct statistics.\n", nIds);
+	}
+
+	// Now benchmark dispatch over a random stream of every seaslug message. The table holds either
+	// just the received messages, like the switch does, or the whole dialect, with and without
+	// timing every handler.
+	{
+		static MavlinkDispatchSlot rxSlots[sizeof(receivedIds)];
+		static MavlinkDispatchTable rxTable = {.Slots = rxSlots, .SlotCount = sizeof(receivedIds)};
+		double cost;
+
+		srand(7);
+		for (i = 0; i < STREAM_LENGTH; ++i) {
+			// Half of the stream is messages that are actually handled, like a real uplink.
+			messages[i].msgid = (rand() & 1) ? receivedIds[rand() % sizeof(receivedIds)] : ids[rand() % nIds];
+			messages[i].len = messageLengths[messages[i].msgid];
+		}
+
+		MavlinkDispatchInit(&rxTable, NULL);
+		for (i = 0; i < sizeof(receivedIds); ++i) {
+			MavlinkDispatchRegister(&rxTable, receivedIds[i], Handle);
+		}
+		MavlinkDispatchInit(&table, NULL);
+		for (i = 0; i < nIds; ++i) {
+			MavlinkDispatchRegister(&table, ids[i], Handle);
+		}
+
+		printf("%-40s %12s\n", "", "cycles/msg");
+		cost = Benchmark(NULL);
+		printf("%-40s %12.1f\n", "switch, 14 received messages", cost);
+		cost = Benchmark(&rxTable);
+		printf("%-40s %12.1f\n", "table, 14 received messages", cost);
+		cost = Benchmark(&table);
+		printf("%-40s %12.1f\n", "table, all seaslug messages", cost);
+		table.Clock = Rdtsc;
+		cost = Benchmark(&table);
+		printf("%-40s %12.1f\n", "table, all seaslug messages, profiled", cost);
+
+		// Show what the statistics look like for a few of them after a single pass over the stream,
+		// as the benchmark overflows the counters.
+		MavlinkDispatchResetStats(&table);
+		for (i = 0; i < STREAM_LENGTH; ++i) {
+			MavlinkDispatch(&table, 0, messages[i].msgid, &messages[i]);
+		}
+		printf("%-24s %8s %10s %14s\n", "message", "count", "bytes", "cycles/call");
+		for (i = 0; i < 5; ++i) {
+			const MavlinkDispatchStats *s = MavlinkDispatchGetStats(&table, receivedIds[i]);
+			printf("%-24u %8u %10u %14.1f\n", receivedIds[i], s->Count, s->Bytes, (double)s->Cycles / s->Count);
+		}
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_MAVLINK_DISPATCH
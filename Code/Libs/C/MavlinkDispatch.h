@@ -0,0 +1,119 @@
+/**
+ * @file   MavlinkDispatch.h
+ * @brief  Dispatch tables mapping MAVLink message IDs to handlers, with per-message statistics.
+ *
+ * A dispatch table replaces a `switch` on the message ID. Handlers are registered for individual
+ * message IDs and a 256-entry map from message ID to handler slot makes every lookup a single
+ * indexed load, regardless of how many handlers there are or which message comes in. Only the map
+ * is sized for every possible ID; the handler slots themselves are provided by the user and sized
+ * for the messages actually handled, like the storage of a MessageSchedule.
+ *
+ * Every slot counts how often its handler ran and how many bytes of MAVLink frames it handled. If a
+ * clock function is given to the table, the time spent in every handler is accumulated as well, in
+ * whatever unit that clock counts. The statistics are plain fields that can be read at any time,
+ * either directly or through MavlinkDispatchGetStats().
+ *
+ * The same table type serves both directions: for received messages the handler is passed the
+ * message, for transmission it's passed NULL and is expected to send the message itself, returning
+ * how many bytes it queued.
+ *
+ * Usage:
+ * ```
+ * static MavlinkDispatchSlot rxSlots[3];
+ * static MavlinkDispatchTable rxTable = {.Slots = rxSlots, .SlotCount = 3};
+ * MavlinkDispatchInit(&rxTable, NULL);
+ * MavlinkDispatchRegister(&rxTable, MAVLINK_MSG_ID_PARAM_SET, ReceiveParamSet);
+ * ...
+ * MavlinkDispatch(&rxTable, MAVLINK_CHAN_GROUNDSTATION, msg.msgid, &msg);
+ * ```
+ *
+ * Unit testing, including a benchmark of the dispatch cost for every message of the seaslug dialect
+ * against an equivalent `switch`, is done on x86 by compiling with the UNIT_TEST_MAVLINK_DISPATCH
+ * macro:
+ * `gcc MavlinkDispatch.c -DUNIT_TEST_MAVLINK_DISPATCH -DMAVLINK_SEPARATE_HELPERS -I../MAVLink/seaslug -O2 -Wall`
+ */
+#ifndef MAVLINK_DISPATCH_H
+#define MAVLINK_DISPATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <mavlink.h>
+
+/**
+ * A message handler. `msg` is the received message, or NULL when dispatching a transmission.
+ * Returns the number of bytes queued for a transmission, which may be 0 if nothing was sent.
+ * Received messages are counted at their own size instead, so receive handlers return 0.
+ */
+typedef uint16_t (*MavlinkHandler)(uint8_t channel, const mavlink_message_t *msg);
+
+/**
+ * The statistics kept for every registered message.
+ */
+typedef struct {
+	uint16_t Count;  // How many times the handler was run.
+	uint32_t Bytes;  // The total size of the frames handled, including the MAVLink framing. Transmissions count what their handler queued.
+	uint32_t Cycles; // The total time spent in the handler, in units of the table's clock. 0 if there's no clock.
+} MavlinkDispatchStats;
+
+/**
+ * A registered handler.
+ */
+typedef struct {
+	MavlinkHandler Handler;
+	uint8_t MsgId;
+	MavlinkDispatchStats Stats;
+} MavlinkDispatchSlot;
+
+/**
+ * A dispatch table. `Slots` and `SlotCount` are set when declaring it, then it's initialized with
+ * MavlinkDispatchInit().
+ */
+typedef struct {
+	// The slot of every message ID, numbered starting at 1 so that 0 can mark an unhandled ID.
+	uint8_t Map[256];
+	// Storage for the registered handlers. Contains `SlotCount` entries.
+	MavlinkDispatchSlot *const Slots;
+	const uint8_t SlotCount;
+	// The number of slots registered so far.
+	uint8_t Registered;
+	// How many messages were dispatched without a handler.
+	uint16_t Unhandled;
+	// Returns the current time for profiling handlers, or NULL to not profile them.
+	uint32_t (*Clock)(void);
+} MavlinkDispatchTable;
+
+/**
+ * Clears all registered handlers and statistics.
+ * @param table The table to initialize.
+ * @param clock A free-running clock to time handlers with, or NULL.
+ */
+void MavlinkDispatchInit(MavlinkDispatchTable *table, uint32_t (*clock)(void));
+
+/**
+ * Registers a handler for a message ID.
+ * @return False if the message already has a handler or there are no slots left.
+ */
+bool MavlinkDispatchRegister(MavlinkDispatchTable *table, uint8_t msgid, MavlinkHandler handler);
+
+/**
+ * Runs the handler for a message ID and updates its statistics.
+ * @param table The table to dispatch through.
+ * @param channel The MAVLink channel, passed on to the handler.
+ * @param msgid The ID of the message.
+ * @param msg The received message, or NULL when dispatching a transmission.
+ * @return False if there's no handler for this message.
+ */
+bool MavlinkDispatch(MavlinkDispatchTable *table, uint8_t channel, uint8_t msgid, const mavlink_message_t *msg);
+
+/**
+ * Returns the statistics of a message ID, or NULL if it has no handler.
+ */
+const MavlinkDispatchStats *MavlinkDispatchGetStats(const MavlinkDispatchTable *table, uint8_t msgid);
+
+/**
+ * Zeroes the statistics of every handler, leaving them registered.
+ */
+void MavlinkDispatchResetStats(MavlinkDispatchTable *table);
+
+#endif // MAVLINK_DISPATCH_H
@@ -51,6 +51,35 @@ MAVLINK_HELPER void mavlink_reset_channel_status(uint8_t chan)
 	status->parse_state = MAVLINK_PARSE_STATE_IDLE;
 }
 
+/**
+ * @brief Set the protocol version used for sending on a channel.
+ *
+ * Channels start out sending MAVLink 1. With version 2 frames whose payload ends in enough zero
+ * bytes are sent as MAVLink 2 with those zeros trimmed off, see _mav_use_mavlink2(). Both versions
+ * are always accepted on reception.
+ */
+MAVLINK_HELPER void mavlink_set_proto_version(uint8_t chan, unsigned int version)
+{
+	mavlink_status_t *status = mavlink_get_channel_status(chan);
+	if (version > 1) {
+		status->flags |= MAVLINK_STATUS_FLAG_OUT_MAVLINK2;
+	} else {
+		status->flags &= ~MAVLINK_STATUS_FLAG_OUT_MAVLINK2;
+	}
+}
+
+/**
+ * @brief Get the protocol version used for sending on a channel.
+ */
+MAVLINK_HELPER unsigned int mavlink_get_proto_version(uint8_t chan)
+{
+	return (mavlink_get_channel_status(chan)->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK2) ? 2 : 1;
+}
+
+// Writes the header of a message as it goes out on the wire, see _mav_put_header().
+#define _mav_put_msg_header(buf, msg) \
+	_mav_put_header(buf, (msg)->magic, (msg)->len, (msg)->seq, (msg)->sysid, (msg)->compid, (msg)->msgid)
+
 /**
  * @brief Finalize a MAVLink message with channel assignment
  *
@@ -71,15 +100,20 @@ MAVLINK_HELPER uint16_t mavlink_finalize_message_chan(mavlink_message_t* msg, ui
 						      uint8_t chan, uint8_t length)
 #endif
 {
+	mavlink_status_t *status = mavlink_get_channel_status(chan);
+	uint8_t header[MAVLINK2_NUM_HEADER_BYTES];
+	uint8_t headerLength;
+
 	// This code part is the same for all messages;
-	msg->magic = MAVLINK_STX;
+	msg->magic = _mav_use_mavlink2(status, _MAV_PAYLOAD(msg), &length) ? MAVLINK_STX_MAVLINK2 : MAVLINK_STX;
 	msg->len = length;
 	msg->sysid = system_id;
 	msg->compid = component_id;
 	// One sequence number per component
-	msg->seq = mavlink_get_channel_status(chan)->current_tx_seq;
-	mavlink_get_channel_status(chan)->current_tx_seq = mavlink_get_channel_status(chan)->current_tx_seq+1;
-	msg->checksum = crc_calculate(((const uint8_t*)(msg)) + 3, MAVLINK_CORE_HEADER_LEN);
+	msg->seq = status->current_tx_seq;
+	status->current_tx_seq = status->current_tx_seq+1;
+	headerLength = _mav_put_msg_header(header, msg);
+	msg->checksum = crc_calculate(&header[1], headerLength - 1);
 	crc_accumulate_buffer(&msg->checksum, _MAV_PAYLOAD(msg), msg->len);
 #if MAVLINK_CRC_EXTRA
 	crc_accumulate(crc_extra, &msg->checksum);
@@ -87,7 +121,7 @@ MAVLINK_HELPER uint16_t mavlink_finalize_message_chan(mavlink_message_t* msg, ui
 	mavlink_ck_a(msg) = (uint8_t)(msg->checksum & 0xFF);
 	mavlink_ck_b(msg) = (uint8_t)(msg->checksum >> 8);
 
-	return length + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+	return length + headerLength + MAVLINK_NUM_CHECKSUM_BYTES;
 }
 
 
@@ -122,17 +156,15 @@ MAVLINK_HELPER void _mav_finalize_message_chan_send(mavlink_channel_t chan, uint
 #endif
 {
 	uint16_t checksum;
-	uint8_t buf[MAVLINK_NUM_HEADER_BYTES];
+	uint8_t buf[MAVLINK2_NUM_HEADER_BYTES];
 	uint8_t ck[2];
+	uint8_t headerLength;
 	mavlink_status_t *status = mavlink_get_channel_status(chan);
-	buf[0] = MAVLINK_STX;
-	buf[1] = length;
-	buf[2] = status->current_tx_seq;
-	buf[3] = mavlink_system.sysid;
-	buf[4] = mavlink_system.compid;
-	buf[5] = msgid;
+	uint8_t magic = _mav_use_mavlink2(status, packet, &length) ? MAVLINK_STX_MAVLINK2 : MAVLINK_STX;
+	headerLength = _mav_put_header(buf, magic, length, status->current_tx_seq, mavlink_system.sysid,
+	                               mavlink_system.compid, msgid);
 	status->current_tx_seq++;
-	checksum = crc_calculate((const uint8_t*)&buf[1], MAVLINK_CORE_HEADER_LEN);
+	checksum = crc_calculate((const uint8_t*)&buf[1], headerLength - 1);
 	crc_accumulate_buffer(&checksum, packet, length);
 #if MAVLINK_CRC_EXTRA
 	crc_accumulate(crc_extra, &checksum);
@@ -140,11 +172,11 @@ MAVLINK_HELPER void _mav_finalize_message_chan_send(mavlink_channel_t chan, uint
 	ck[0] = (uint8_t)(checksum & 0xFF);
 	ck[1] = (uint8_t)(checksum >> 8);
 
-	MAVLINK_START_UART_SEND(chan, MAVLINK_NUM_NON_PAYLOAD_BYTES + (uint16_t)length);
-	_mavlink_send_uart(chan, (const char *)buf, MAVLINK_NUM_HEADER_BYTES);
+	MAVLINK_START_UART_SEND(chan, headerLength + MAVLINK_NUM_CHECKSUM_BYTES + (uint16_t)length);
+	_mavlink_send_uart(chan, (const char *)buf, headerLength);
 	_mavlink_send_uart(chan, packet, length);
 	_mavlink_send_uart(chan, (const char *)ck, 2);
-	MAVLINK_END_UART_SEND(chan, MAVLINK_NUM_NON_PAYLOAD_BYTES + (uint16_t)length);
+	MAVLINK_END_UART_SEND(chan, headerLength + MAVLINK_NUM_CHECKSUM_BYTES + (uint16_t)length);
 }
 
 /**
@@ -154,16 +186,18 @@ MAVLINK_HELPER void _mav_finalize_message_chan_send(mavlink_channel_t chan, uint
 MAVLINK_HELPER void _mavlink_resend_uart(mavlink_channel_t chan, const mavlink_message_t *msg)
 {
 	uint8_t ck[2];
+	uint8_t buf[MAVLINK2_NUM_HEADER_BYTES];
+	uint8_t headerLength = _mav_put_msg_header(buf, msg);
 
 	ck[0] = (uint8_t)(msg->checksum & 0xFF);
 	ck[1] = (uint8_t)(msg->checksum >> 8);
 	// XXX use the right sequence here
 
-	MAVLINK_START_UART_SEND(chan, MAVLINK_NUM_NON_PAYLOAD_BYTES + msg->len);
-	_mavlink_send_uart(chan, (const char *)&msg->magic, MAVLINK_NUM_HEADER_BYTES);
+	MAVLINK_START_UART_SEND(chan, mavlink_msg_get_send_buffer_length(msg));
+	_mavlink_send_uart(chan, (const char *)buf, headerLength);
 	_mavlink_send_uart(chan, _MAV_PAYLOAD(msg), msg->len);
 	_mavlink_send_uart(chan, (const char *)ck, 2);
-	MAVLINK_END_UART_SEND(chan, MAVLINK_NUM_NON_PAYLOAD_BYTES + msg->len);
+	MAVLINK_END_UART_SEND(chan, mavlink_msg_get_send_buffer_length(msg));
 }
 #endif // MAVLINK_USE_CONVENIENCE_FUNCTIONS
 
@@ -172,14 +206,15 @@ MAVLINK_HELPER void _mavlink_resend_uart(mavlink_channel_t chan, const mavlink_m
  */
 MAVLINK_HELPER uint16_t mavlink_msg_to_send_buffer(uint8_t *buffer, const mavlink_message_t *msg)
 {
-	memcpy(buffer, (const uint8_t *)&msg->magic, MAVLINK_NUM_HEADER_BYTES + (uint16_t)msg->len);
+	uint8_t headerLength = _mav_put_msg_header(buffer, msg);
+	memcpy(buffer + headerLength, _MAV_PAYLOAD(msg), msg->len);
 
-	uint8_t *ck = buffer + (MAVLINK_NUM_HEADER_BYTES + (uint16_t)msg->len);
+	uint8_t *ck = buffer + (headerLength + (uint16_t)msg->len);
 
 	ck[0] = (uint8_t)(msg->checksum & 0xFF);
 	ck[1] = (uint8_t)(msg->checksum >> 8);
 
-	return MAVLINK_NUM_NON_PAYLOAD_BYTES + (uint16_t)msg->len;
+	return headerLength + MAVLINK_NUM_CHECKSUM_BYTES + (uint16_t)msg->len;
 }
 
 union __mavlink_bitfield {
@@ -202,6 +237,25 @@ MAVLINK_HELPER void mavlink_update_checksum(mavlink_message_t* msg, uint8_t c)
 	crc_accumulate(c, &msg->checksum);
 }
 
+/**
+ * Starts parsing a new frame if `c` is the start of either a MAVLink 1 or a MAVLink 2 frame.
+ */
+static void _mav_parse_start(mavlink_message_t* rxmsg, mavlink_status_t* status, uint8_t c)
+{
+	if (c == MAVLINK_STX || c == MAVLINK_STX_MAVLINK2)
+	{
+		status->parse_state = MAVLINK_PARSE_STATE_GOT_STX;
+		if (c == MAVLINK_STX_MAVLINK2) {
+			status->flags |= MAVLINK_STATUS_FLAG_IN_MAVLINK2;
+		} else {
+			status->flags &= ~MAVLINK_STATUS_FLAG_IN_MAVLINK2;
+		}
+		rxmsg->len = 0;
+		rxmsg->magic = c;
+		mavlink_start_checksum(rxmsg);
+	}
+}
+
 /**
  * This is a convenience function which handles the complete MAVLink parsing.
  * the function will parse one byte at a time and return the complete packet once
@@ -261,12 +315,12 @@ MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_messa
  medium is prone to missing (or extra) characters (e.g. a radio that fades in
  and out). Only use if the channel will only contain messages types listed in
  the headers.
+
+ The lengths are needed regardless to zero-fill the trimmed payload of MAVLink 2 frames.
 */
-#ifdef MAVLINK_CHECK_MESSAGE_LENGTH
 #ifndef MAVLINK_MESSAGE_LENGTH
 	static const uint8_t mavlink_message_lengths[256] = MAVLINK_MESSAGE_LENGTHS;
 #define MAVLINK_MESSAGE_LENGTH(msgid) mavlink_message_lengths[msgid]
-#endif
 #endif
 
 	mavlink_message_t* rxmsg = mavlink_get_channel_buffer(chan); ///< The currently decoded message
@@ -279,13 +333,7 @@ MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_messa
 	{
 	case MAVLINK_PARSE_STATE_UNINIT:
 	case MAVLINK_PARSE_STATE_IDLE:
-		if (c == MAVLINK_STX)
-		{
-			status->parse_state = MAVLINK_PARSE_STATE_GOT_STX;
-			rxmsg->len = 0;
-			rxmsg->magic = c;
-			mavlink_start_checksum(rxmsg);
-		}
+		_mav_parse_start(rxmsg, status, c);
 		break;
 
 	case MAVLINK_PARSE_STATE_GOT_STX:
@@ -313,6 +361,31 @@ MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_messa
 		break;
 
 	case MAVLINK_PARSE_STATE_GOT_LENGTH:
+		if (status->flags & MAVLINK_STATUS_FLAG_IN_MAVLINK2)
+		{
+			// Signed frames, or anything else that changes the framing, can't be handled.
+			if (c != 0)
+			{
+				status->parse_error++;
+				status->parse_state = MAVLINK_PARSE_STATE_IDLE;
+				break;
+			}
+			mavlink_update_checksum(rxmsg, c);
+			status->parse_state = MAVLINK_PARSE_STATE_GOT_INCOMPAT_FLAGS;
+			break;
+		}
+		rxmsg->seq = c;
+		mavlink_update_checksum(rxmsg, c);
+		status->parse_state = MAVLINK_PARSE_STATE_GOT_SEQ;
+		break;
+
+	case MAVLINK_PARSE_STATE_GOT_INCOMPAT_FLAGS:
+		// Compatibility flags can be ignored by definition.
+		mavlink_update_checksum(rxmsg, c);
+		status->parse_state = MAVLINK_PARSE_STATE_GOT_COMPAT_FLAGS;
+		break;
+
+	case MAVLINK_PARSE_STATE_GOT_COMPAT_FLAGS:
 		rxmsg->seq = c;
 		mavlink_update_checksum(rxmsg, c);
 		status->parse_state = MAVLINK_PARSE_STATE_GOT_SEQ;
@@ -331,6 +404,13 @@ MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_messa
 		break;
 
 	case MAVLINK_PARSE_STATE_GOT_COMPID:
+		rxmsg->msgid = c;
+		mavlink_update_checksum(rxmsg, c);
+		if (status->flags & MAVLINK_STATUS_FLAG_IN_MAVLINK2)
+		{
+			status->parse_state = MAVLINK_PARSE_STATE_GOT_MSGID1;
+			break;
+		}
 #ifdef MAVLINK_CHECK_MESSAGE_LENGTH
 	        if (rxmsg->len != MAVLINK_MESSAGE_LENGTH(c))
 		{
@@ -339,8 +419,40 @@ MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_messa
 			break;
 	    }
 #endif
-		rxmsg->msgid = c;
+		if (rxmsg->len == 0)
+		{
+			status->parse_state = MAVLINK_PARSE_STATE_GOT_PAYLOAD;
+		}
+		else
+		{
+			status->parse_state = MAVLINK_PARSE_STATE_GOT_MSGID;
+		}
+		break;
+
+	case MAVLINK_PARSE_STATE_GOT_MSGID1:
+	case MAVLINK_PARSE_STATE_GOT_MSGID2:
+		// The upper bytes of the message ID. Only IDs that fit into mavlink_message_t are supported.
+		if (c != 0)
+		{
+			status->parse_error++;
+			status->parse_state = MAVLINK_PARSE_STATE_IDLE;
+			break;
+		}
 		mavlink_update_checksum(rxmsg, c);
+		if (status->parse_state == MAVLINK_PARSE_STATE_GOT_MSGID1)
+		{
+			status->parse_state = MAVLINK_PARSE_STATE_GOT_MSGID2;
+			break;
+		}
+#ifdef MAVLINK_CHECK_MESSAGE_LENGTH
+		// Trimmed payloads can be shorter, but never longer.
+	        if (rxmsg->len > MAVLINK_MESSAGE_LENGTH(rxmsg->msgid))
+		{
+			status->parse_error++;
+			status->parse_state = MAVLINK_PARSE_STATE_IDLE;
+			break;
+	    }
+#endif
 		if (rxmsg->len == 0)
 		{
 			status->parse_state = MAVLINK_PARSE_STATE_GOT_PAYLOAD;
@@ -353,9 +465,10 @@ MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_messa
 
 	case MAVLINK_PARSE_STATE_GOT_MSGID:
 		_MAV_PAYLOAD_NON_CONST(rxmsg)[status->packet_idx++] = (char)c;
-		mavlink_update_checksum(rxmsg, c);
 		if (status->packet_idx == rxmsg->len)
 		{
+			// The payload is checksummed all at once, as that's much faster than byte by byte.
+			crc_accumulate_buffer(&rxmsg->checksum, _MAV_PAYLOAD(rxmsg), rxmsg->len);
 			status->parse_state = MAVLINK_PARSE_STATE_GOT_PAYLOAD;
 		}
 		break;
@@ -384,6 +497,11 @@ MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_messa
                 status->parse_state = MAVLINK_PARSE_STATE_IDLE;
                 _MAV_PAYLOAD_NON_CONST(rxmsg)[status->packet_idx+1] = (char)c;
                 memcpy(r_message, rxmsg, sizeof(mavlink_message_t));
+		// Put back the zeros trimmed off a MAVLink 2 payload, so it can be decoded as usual.
+		if (status->msg_received == MAVLINK_FRAMING_OK && rxmsg->len < MAVLINK_MESSAGE_LENGTH(rxmsg->msgid))
+		{
+			memset(_MAV_PAYLOAD_NON_CONST(r_message) + rxmsg->len, 0, MAVLINK_MESSAGE_LENGTH(rxmsg->msgid) - rxmsg->len);
+		}
 		break;
 	}
 
@@ -476,12 +594,7 @@ MAVLINK_HELPER uint8_t mavlink_parse_char(uint8_t chan, uint8_t c, mavlink_messa
 	    status->parse_error++;
 	    status->msg_received = MAVLINK_FRAMING_INCOMPLETE;
 	    status->parse_state = MAVLINK_PARSE_STATE_IDLE;
-	    if (c == MAVLINK_STX)
-	    {
-		    status->parse_state = MAVLINK_PARSE_STATE_GOT_STX;
-		    rxmsg->len = 0;
-		    mavlink_start_checksum(rxmsg);
-	    }
+	    _mav_parse_start(rxmsg, status, c);
 	    return 0;
     }
     return msg_received;
@@ -626,3 +739,277 @@ MAVLINK_HELPER void _mavlink_send_uart(mavlink_channel_t chan, const char *buf,
 #endif
 }
 #endif // MAVLINK_USE_CONVENIENCE_FUNCTIONS
+
+#ifdef UNIT_TEST
+/**
+ * Verifies the table-driven CRC engine in checksum.h against the original bit-serial X.25
+ * implementation, round-trips every seaslug message through the packer and parser in both MAVLink 1
+ * and MAVLink 2 framing, and benchmarks the CRC variants. Build on the host with something like:
+ *   gcc MavlinkHelpers.c -DUNIT_TEST -DMAVLINK_SEPARATE_HELPERS -DMAVLINK_CRC_SLICING=8 -I../MAVLink/seaslug -O2 -Wall
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <stdbool.h>
+
+// The bit-serial CRC-16/X.25 step that checksum.h originally shipped with.
+static void ReferenceAccumulate(uint8_t data, uint16_t *crcAccum)
+{
+	uint8_t tmp = data ^ (uint8_t)(*crcAccum & 0xff);
+	tmp ^= (tmp << 4);
+	*crcAccum = (*crcAccum >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+}
+
+static uint16_t ReferenceCrc(const uint8_t *buf, uint16_t len, uint16_t crc)
+{
+	while (len--) {
+		ReferenceAccumulate(*buf++, &crc);
+	}
+	return crc;
+}
+
+static double Seconds(void)
+{
+	return (double)clock() / CLOCKS_PER_SEC;
+}
+
+int main(void)
+{
+	static uint8_t data[65536 + 8];
+	uint32_t i;
+	srand(12345);
+	for (i = 0; i < sizeof(data); ++i) {
+		data[i] = (uint8_t)rand();
+	}
+
+	// Every byte value from every CRC state must match the bit-serial update.
+	{
+		uint32_t crc;
+		for (crc = 0; crc < 0x10000; ++crc) {
+			uint16_t b;
+			for (b = 0; b < 256; ++b) {
+				uint16_t a = (uint16_t)crc, r = (uint16_t)crc;
+				crc_accumulate((uint8_t)b, &a);
+				ReferenceAccumulate((uint8_t)b, &r);
+				assert(a == r);
+			}
+		}
+		printf("crc_accumulate matches the reference for all states and bytes.\n");
+	}
+
+	// Every length up to a full packet, from every alignment, so the 8- and 4-byte slices and the
+	// byte-wise tail all get exercised.
+	{
+		uint16_t len, offset;
+		for (offset = 0; offset < 8; ++offset) {
+			for (len = 0; len <= MAVLINK_MAX_PACKET_LEN; ++len) {
+				uint16_t crc = X25_INIT_CRC ^ (len * 31 + offset);
+				uint16_t expected = ReferenceCrc(&data[offset], len, crc);
+				crc_accumulate_buffer(&crc, (const char *)&data[offset], len);
+				assert(crc == expected);
+				assert(crc_calculate(&data[offset], len) == ReferenceCrc(&data[offset], len, X25_INIT_CRC));
+			}
+		}
+		printf("crc_accumulate_buffer/crc_calculate match the reference for all lengths and alignments.\n");
+	}
+
+	// Pack every seaslug message with a random payload, check the checksum against the reference
+	// computed over the header, payload, and CRC_EXTRA, and then parse it back byte-by-byte.
+	{
+		static const uint8_t crcs[] = MAVLINK_MESSAGE_CRCS;
+		static const uint8_t lengths[] = MAVLINK_MESSAGE_LENGTHS;
+		uint16_t id, messages = 0;
+		for (id = 0; id < 256; ++id) {
+			mavlink_message_t msg, parsed;
+			mavlink_status_t status;
+			uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+			uint16_t n, j, expected;
+			bool gotMessage = false;
+
+			if (lengths[id] == 0) {
+				continue;
+			}
+			memset(&msg, 0, sizeof(msg));
+			msg.msgid = (uint8_t)id;
+			for (j = 0; j < lengths[id]; ++j) {
+				_MAV_PAYLOAD_NON_CONST(&msg)[j] = (char)rand();
+			}
+			mavlink_finalize_message_chan(&msg, 1, 2, MAVLINK_COMM_0, lengths[id], crcs[id]);
+
+			n = mavlink_msg_to_send_buffer(buf, &msg);
+			assert(n == lengths[id] + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+			expected = ReferenceCrc(&buf[1], MAVLINK_CORE_HEADER_LEN + lengths[id], X25_INIT_CRC);
+			ReferenceAccumulate(crcs[id], &expected);
+			assert(msg.checksum == expected);
+			assert(buf[n - 2] == (expected & 0xFF) && buf[n - 1] == (expected >> 8));
+
+			for (j = 0; j < n; ++j) {
+				if (mavlink_parse_char(MAVLINK_COMM_1, buf[j], &parsed, &status)) {
+					assert(j == n - 1);
+					gotMessage = true;
+				}
+			}
+			assert(gotMessage);
+			assert(parsed.msgid == id && parsed.len == lengths[id] && parsed.checksum == expected);
+			assert(memcmp(_MAV_PAYLOAD(&parsed), _MAV_PAYLOAD(&msg), lengths[id]) == 0);
+
+			// And a single corrupted payload byte must be rejected.
+			buf[MAVLINK_NUM_HEADER_BYTES + rand() % lengths[id]] ^= 0x10;
+			for (j = 0; j < n; ++j) {
+				assert(!mavlink_parse_char(MAVLINK_COMM_1, buf[j], &parsed, &status));
+			}
+			// The parser resyncs on a bad CRC byte that happens to be STX, so start clean.
+			mavlink_get_channel_status(MAVLINK_COMM_1)->parse_state = MAVLINK_PARSE_STATE_IDLE;
+			++messages;
+		}
+		printf("%u seaslug messages packed and parsed with matching checksums.\n", messages);
+	}
+
+	// Now with MAVLink 2 allowed on the sending channel. Every message is sent with every number of
+	// trailing zeros, and must come out as MAVLink 2 exactly when that's shorter, with the zeros
+	// filled back in by the parser.
+	{
+		static const uint8_t crcs[] = MAVLINK_MESSAGE_CRCS;
+		static const uint8_t lengths[] = MAVLINK_MESSAGE_LENGTHS;
+		uint32_t v1Bytes = 0, sentBytes = 0, frames = 0, v2Frames = 0;
+		uint16_t id;
+
+		assert(mavlink_get_proto_version(MAVLINK_COMM_2) == 1);
+		mavlink_set_proto_version(MAVLINK_COMM_2, 2);
+		assert(mavlink_get_proto_version(MAVLINK_COMM_2) == 2);
+		mavlink_reset_channel_status(MAVLINK_COMM_3);
+
+		for (id = 0; id < 256; ++id) {
+			uint16_t zeros;
+			if (lengths[id] == 0) {
+				continue;
+			}
+			for (zeros = 0; zeros <= lengths[id]; ++zeros) {
+				uint8_t payload[MAVLINK_MAX_PAYLOAD_LEN];
+				uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+				mavlink_message_t msg, parsed;
+				mavlink_status_t status;
+				uint16_t n, j, expected, headerLength;
+				uint8_t trimmed;
+				bool gotMessage = false;
+
+				for (j = 0; j < lengths[id]; ++j) {
+					payload[j] = (j < lengths[id] - zeros) ? (uint8_t)(1 + rand() % 255) : 0;
+				}
+				trimmed = (zeros == lengths[id]) ? 1 : lengths[id] - zeros;
+
+				memset(&msg, 0, sizeof(msg));
+				memcpy(_MAV_PAYLOAD_NON_CONST(&msg), payload, lengths[id]);
+				msg.msgid = (uint8_t)id;
+				n = mavlink_finalize_message_chan(&msg, 1, 2, MAVLINK_COMM_2, lengths[id], crcs[id]);
+				if (trimmed + MAVLINK2_NUM_NON_PAYLOAD_BYTES < lengths[id] + MAVLINK_NUM_NON_PAYLOAD_BYTES) {
+					assert(msg.magic == MAVLINK_STX_MAVLINK2 && msg.len == trimmed);
+					headerLength = MAVLINK2_NUM_HEADER_BYTES;
+					++v2Frames;
+				} else {
+					assert(msg.magic == MAVLINK_STX && msg.len == lengths[id]);
+					headerLength = MAVLINK_NUM_HEADER_BYTES;
+				}
+
+				assert(mavlink_msg_to_send_buffer(buf, &msg) == n);
+				assert(n == mavlink_msg_get_send_buffer_length(&msg));
+				assert(n <= lengths[id] + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+				expected = ReferenceCrc(&buf[1], headerLength - 1 + msg.len, X25_INIT_CRC);
+				ReferenceAccumulate(crcs[id], &expected);
+				assert(msg.checksum == expected);
+				assert(buf[n - 2] == (expected & 0xFF) && buf[n - 1] == (expected >> 8));
+
+				// Leave junk in the parse buffer past the trimmed payload, so that the zero-fill is
+				// actually tested.
+				memset(_MAV_PAYLOAD_NON_CONST(mavlink_get_channel_buffer(MAVLINK_COMM_3)), 0x55, MAVLINK_MAX_PAYLOAD_LEN);
+				for (j = 0; j < n; ++j) {
+					if (mavlink_parse_char(MAVLINK_COMM_3, buf[j], &parsed, &status)) {
+						assert(j == n - 1);
+						gotMessage = true;
+					}
+				}
+				assert(gotMessage);
+				assert(parsed.msgid == id && parsed.magic == msg.magic && parsed.len == msg.len);
+				assert(memcmp(_MAV_PAYLOAD(&parsed), payload, lengths[id]) == 0);
+
+				v1Bytes += lengths[id] + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+				sentBytes += n;
+				++frames;
+			}
+		}
+		printf("%u frames round-tripped with MAVLink 2 allowed, %u of them as MAVLink 2, %u bytes instead of %u.\n",
+		       frames, v2Frames, sentBytes, v1Bytes);
+
+		// Frames that can't be represented are dropped: signed ones and ones with a message ID past
+		// 255. Both are otherwise valid, so only the header check can reject them.
+		{
+			const uint8_t signedFrame[] = {MAVLINK_STX_MAVLINK2, 1, MAVLINK_IFLAG_SIGNED, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0};
+			const uint8_t bigIdFrame[] = {MAVLINK_STX_MAVLINK2, 1, 0, 0, 0, 1, 1, 0, 1, 0, 0, 0, 0};
+			mavlink_message_t parsed;
+			mavlink_status_t status;
+			uint16_t errors = 0;
+			for (id = 0; id < sizeof(signedFrame); ++id) {
+				assert(!mavlink_parse_char(MAVLINK_COMM_3, signedFrame[id], &parsed, &status));
+				errors += status.packet_rx_drop_count;
+			}
+			for (id = 0; id < sizeof(bigIdFrame); ++id) {
+				assert(!mavlink_parse_char(MAVLINK_COMM_3, bigIdFrame[id], &parsed, &status));
+				errors += status.packet_rx_drop_count;
+			}
+			assert(errors == 2);
+		}
+
+		// And switching back to MAVLink 1 sends everything as before.
+		{
+			mavlink_message_t msg;
+			mavlink_set_proto_version(MAVLINK_COMM_2, 1);
+			memset(&msg, 0, sizeof(msg));
+			msg.msgid = MAVLINK_MSG_ID_HEARTBEAT;
+			assert(mavlink_finalize_message_chan(&msg, 1, 2, MAVLINK_COMM_2, MAVLINK_MSG_ID_HEARTBEAT_LEN, MAVLINK_MSG_ID_HEARTBEAT_CRC) ==
+			       MAVLINK_MSG_ID_HEARTBEAT_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+			assert(msg.magic == MAVLINK_STX);
+		}
+		printf("Unsupported MAVLink 2 frames are rejected and MAVLink 1 can be restored.\n");
+	}
+
+	// Throughput of each implementation over the same 64KiB buffer.
+	{
+		const int reps = 200;
+		const double bytes = (double)reps * 65536;
+		volatile uint16_t sink = 0;
+		double start;
+		int r;
+
+		start = Seconds();
+		for (r = 0; r < reps; ++r) {
+			sink ^= ReferenceCrc(data, 65535, X25_INIT_CRC);
+			sink ^= ReferenceCrc(&data[65535], 1, X25_INIT_CRC);
+		}
+		printf("bit-serial:        %8.1f MB/s\n", bytes / (Seconds() - start) / 1e6);
+
+		start = Seconds();
+		for (r = 0; r < reps; ++r) {
+			uint16_t crc = X25_INIT_CRC;
+			for (i = 0; i < 65536; ++i) {
+				crc_accumulate(data[i], &crc);
+			}
+			sink ^= crc;
+		}
+		printf("crc_accumulate:    %8.1f MB/s\n", bytes / (Seconds() - start) / 1e6);
+
+		start = Seconds();
+		for (r = 0; r < reps; ++r) {
+			uint16_t crc = X25_INIT_CRC;
+			crc_accumulate_buffer(&crc, (const char *)data, 65535);
+			crc_accumulate_buffer(&crc, (const char *)&data[65535], 1);
+			sink ^= crc;
+		}
+		printf("buffer (slice %d):  %8.1f MB/s\n", MAVLINK_CRC_SLICING, bytes / (Seconds() - start) / 1e6);
+		(void)sink;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
+#endif // UNIT_TEST
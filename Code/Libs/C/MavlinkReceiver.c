@@ -0,0 +1,550 @@
+#include "MavlinkReceiver.h"
+
+#include <string.h>
+
+#include <../checksum.h>
+
+/**
+ * The CRC_EXTRA seed and the payload length of every known message, indexed by message ID. A
+ * length of 0 indicates a message ID that isn't part of the dialect.
+ */
+static const uint8_t messageCrcs[256] = MAVLINK_MESSAGE_CRCS;
+static const uint8_t messageLengths[256] = MAVLINK_MESSAGE_LENGTHS;
+
+/**
+ * Returns the byte at index `i` of the region described by `spans`.
+ */
+static inline uint8_t _At(const SpscBufferSpans *spans, uint16_t i)
+{
+	return (i < spans->length[0]) ? spans->data[0][i] : spans->data[1][i - spans->length[0]];
+}
+
+/**
+ * Returns the index of the first `c` at or after `from`, or `length` if there isn't one.
+ */
+static uint16_t _FindByte(const SpscBufferSpans *spans, uint16_t from, uint16_t length, uint8_t c)
+{
+	const uint8_t *p;
+	if (from < spans->length[0]) {
+		uint16_t end = (length < spans->length[0]) ? length : spans->length[0];
+		p = (const uint8_t *)memchr(spans->data[0] + from, c, end - from);
+		if (p) {
+			return (uint16_t)(p - spans->data[0]);
+		}
+		from = end;
+	}
+	if (from < length) {
+		p = (const uint8_t *)memchr(spans->data[1] + (from - spans->length[0]), c, length - from);
+		if (p) {
+			return spans->length[0] + (uint16_t)(p - spans->data[1]);
+		}
+	}
+	return length;
+}
+
+/**
+ * Returns the index of the first MAVLink 1 or MAVLink 2 STX at or after `from`, or `length` if there
+ * isn't one. The second search only has to cover what the first one skipped.
+ */
+static uint16_t _FindStx(const SpscBufferSpans *spans, uint16_t from, uint16_t length)
+{
+	const uint16_t stx1 = _FindByte(spans, from, length, MAVLINK_STX);
+	return _FindByte(spans, from, stx1, MAVLINK_STX_MAVLINK2);
+}
+
+/**
+ * Copies `n` bytes starting at index `from` of the spans into `dst`, or if `dst` is NULL
+ * accumulates them into `crc` instead.
+ */
+static void _Gather(const SpscBufferSpans *spans, uint16_t from, uint16_t n, uint8_t *dst, uint16_t *crc)
+{
+	while (n) {
+		const uint8_t *src;
+		uint16_t k;
+		if (from < spans->length[0]) {
+			src = spans->data[0] + from;
+			k = spans->length[0] - from;
+		} else {
+			src = spans->data[1] + (from - spans->length[0]);
+			k = n;
+		}
+		if (k > n) {
+			k = n;
+		}
+		if (dst) {
+			memcpy(dst, src, k);
+			dst += k;
+		} else {
+			crc_accumulate_buffer(crc, (const char *)src, k);
+		}
+		from += k;
+		n -= k;
+	}
+}
+
+/**
+ * Records that `n` bytes were thrown away, which also means synchronization was lost if it hadn't
+ * been already.
+ */
+static void _Discard(MavlinkReceiver *r, uint16_t n)
+{
+	r->stats.discardedBytes += n;
+	if (r->inSync) {
+		r->inSync = false;
+		++r->stats.resyncs;
+	}
+}
+
+void MavlinkReceiverInit(MavlinkReceiver *r)
+{
+	memset(r, 0, sizeof(*r));
+}
+
+bool MavlinkReceiverNext(MavlinkReceiver *r, const SpscBufferSpans *spans, uint16_t length,
+                         uint16_t *offset, mavlink_message_t *msg)
+{
+	uint16_t pos = *offset;
+	while (pos < length) {
+		// Skip straight to the next possible start of a frame.
+		const uint16_t start = _FindStx(spans, pos, length);
+		if (start != pos) {
+			_Discard(r, start - pos);
+			pos = start;
+			*offset = pos;
+			if (pos == length) {
+				break;
+			}
+		}
+
+		// Wait for the whole header before judging the candidate.
+		const bool mavlink2 = (_At(spans, pos) == MAVLINK_STX_MAVLINK2);
+		const uint8_t headerLength = mavlink2 ? MAVLINK2_NUM_HEADER_BYTES : MAVLINK_NUM_HEADER_BYTES;
+		if (length - pos < headerLength) {
+			break;
+		}
+
+		// Known messages always have the same length, or up to that length once MAVLink 2 trimmed
+		// their trailing zeros, so anything else can't be a real frame. MAVLink 2 frames also can't
+		// be handled if they're signed or their message ID doesn't fit into a byte.
+		const uint8_t len = _At(spans, pos + 1);
+		uint8_t msgid;
+		uint16_t seqPos;
+		bool plausible;
+		if (mavlink2) {
+			msgid = _At(spans, pos + 7);
+			seqPos = pos + 4;
+			plausible = !_At(spans, pos + 2) && !_At(spans, pos + 8) && !_At(spans, pos + 9) &&
+			            (!messageLengths[msgid] || (len && len <= messageLengths[msgid]));
+		} else {
+			msgid = _At(spans, pos + 5);
+			seqPos = pos + 2;
+			plausible = !messageLengths[msgid] || len == messageLengths[msgid];
+		}
+		if (plausible) {
+			// Wait for the rest of the frame before checking its CRC.
+			const uint16_t frameLength = headerLength + len + MAVLINK_NUM_CHECKSUM_BYTES;
+			if (length - pos < frameLength) {
+				break;
+			}
+
+			uint16_t crc;
+			crc_init(&crc);
+			_Gather(spans, pos + 1, headerLength - 1 + len, NULL, &crc);
+			crc_accumulate(messageCrcs[msgid], &crc);
+			const uint16_t ckPos = pos + headerLength + len;
+			if (crc == (_At(spans, ckPos) | ((uint16_t)_At(spans, ckPos + 1) << 8))) {
+				msg->magic = mavlink2 ? MAVLINK_STX_MAVLINK2 : MAVLINK_STX;
+				msg->len = len;
+				msg->seq = _At(spans, seqPos);
+				msg->sysid = _At(spans, seqPos + 1);
+				msg->compid = _At(spans, seqPos + 2);
+				msg->msgid = msgid;
+				msg->checksum = crc;
+				_Gather(spans, pos + headerLength, len, (uint8_t *)_MAV_PAYLOAD_NON_CONST(msg), NULL);
+				// Put back the zeros trimmed off a MAVLink 2 payload, so it can be decoded as usual.
+				if (len < messageLengths[msgid]) {
+					memset(_MAV_PAYLOAD_NON_CONST(msg) + len, 0, messageLengths[msgid] - len);
+				}
+
+				*offset = pos + frameLength;
+				r->inSync = true;
+				++r->stats.messages;
+				return true;
+			}
+		}
+
+		// Not a frame after all. Only the STX is dropped as a real frame may start right after it.
+		++r->stats.badFrames;
+		_Discard(r, 1);
+		++pos;
+		*offset = pos;
+	}
+	return false;
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_MAVLINK_RECEIVER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+
+#define RING_SIZE 1024
+
+// The clean stream, and the offset and length of every frame within it.
+static uint8_t *stream;
+static uint32_t streamLength;
+static uint32_t *frameOffsets;
+static uint32_t frameCount;
+
+// The stream after corruption.
+static uint8_t *corrupted;
+static uint32_t corruptedLength;
+
+/**
+ * Appends a byte to the corrupted stream.
+ */
+static void Emit(uint8_t c)
+{
+	corrupted[corruptedLength++] = c;
+}
+
+/**
+ * Generates a clean stream of `count` random seaslug messages with random payloads, like what the
+ * boat streams out. Half of the payloads end in a run of zeros, and MAVLink 2 is allowed, so the
+ * stream mixes both protocol versions.
+ */
+static void GenerateStream(uint32_t count)
+{
+	uint8_t ids[256];
+	uint16_t nIds = 0, i;
+	for (i = 0; i < 256; ++i) {
+		if (messageLengths[i]) {
+			ids[nIds++] = (uint8_t)i;
+		}
+	}
+
+	stream = malloc((size_t)count * MAVLINK_MAX_PACKET_LEN);
+	mavlink_set_proto_version(MAVLINK_COMM_0, 2);
+	frameOffsets = malloc(count * sizeof(uint32_t));
+	streamLength = 0;
+	for (frameCount = 0; frameCount < count; ++frameCount) {
+		mavlink_message_t msg;
+		uint8_t id = ids[rand() % nIds];
+		uint8_t zeros = (rand() & 1) ? rand() % (messageLengths[id] + 1) : 0;
+		for (i = 0; i < messageLengths[id]; ++i) {
+			_MAV_PAYLOAD_NON_CONST(&msg)[i] = (i < messageLengths[id] - zeros) ? (char)rand() : 0;
+		}
+		msg.msgid = id;
+		mavlink_finalize_message_chan(&msg, 20, 0, MAVLINK_COMM_0, messageLengths[id], messageCrcs[id]);
+		frameOffsets[frameCount] = streamLength;
+		streamLength += mavlink_msg_to_send_buffer(&stream[streamLength], &msg);
+	}
+}
+
+/**
+ * Loads a recorded raw byte stream. The frames in it are whatever mavlink_parse_char() finds.
+ */
+static bool LoadStream(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return false;
+	}
+	fseek(f, 0, SEEK_END);
+	streamLength = (uint32_t)ftell(f);
+	fseek(f, 0, SEEK_SET);
+	stream = malloc(streamLength);
+	frameOffsets = malloc((streamLength / MAVLINK_NUM_NON_PAYLOAD_BYTES + 1) * sizeof(uint32_t));
+	if (fread(stream, 1, streamLength, f) != streamLength) {
+		fclose(f);
+		return false;
+	}
+	fclose(f);
+
+	mavlink_message_t msg;
+	mavlink_status_t status;
+	uint32_t i;
+	frameCount = 0;
+	mavlink_reset_channel_status(MAVLINK_COMM_2);
+	for (i = 0; i < streamLength; ++i) {
+		if (mavlink_parse_char(MAVLINK_COMM_2, stream[i], &msg, &status)) {
+			frameOffsets[frameCount++] = i + 1 - mavlink_msg_get_send_buffer_length(&msg);
+		}
+	}
+	return true;
+}
+
+/**
+ * Copies the clean stream into the corrupted one, applying random bit flips, dropped and inserted
+ * bytes, and bursts of noise that's rich in STX bytes of both versions at a rate of about `rate`
+ * events per byte.
+ * The stream is padded with a frame's worth of zeros so that both parsers can finish.
+ */
+static void Corrupt(double rate)
+{
+	uint32_t i;
+	corruptedLength = 0;
+	for (i = 0; i < streamLength; ++i) {
+		double p = rand() / (RAND_MAX + 1.0);
+		if (p < rate * 0.6) {
+			Emit(stream[i] ^ (1 << (rand() % 8)));
+		} else if (p < rate * 0.8) {
+			// Drop this byte.
+		} else if (p < rate * 0.9) {
+			Emit((uint8_t)rand());
+			Emit(stream[i]);
+		} else if (p < rate) {
+			int n = 1 + rand() % 64, j;
+			for (j = 0; j < n; ++j) {
+				int r = rand() % 16;
+				Emit((r > 1) ? (uint8_t)rand() : (r ? MAVLINK_STX : MAVLINK_STX_MAVLINK2));
+			}
+			Emit(stream[i]);
+		} else {
+			Emit(stream[i]);
+		}
+	}
+	for (i = 0; i < MAVLINK_MAX_PACKET_LEN; ++i) {
+		Emit(0);
+	}
+}
+
+/**
+ * Tracks which frames a parser has produced, matching them in order against the clean stream.
+ */
+typedef struct {
+	uint32_t next;     // The index of the next frame in the clean stream that may match.
+	uint32_t genuine;  // Frames that matched one in the clean stream.
+	uint32_t spurious; // Frames with valid CRCs that were never sent.
+} FrameTally;
+
+static void Tally(FrameTally *t, const mavlink_message_t *msg)
+{
+	uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+	uint16_t n = mavlink_msg_to_send_buffer(buf, msg);
+	uint32_t j;
+	for (j = t->next; j < frameCount && j < t->next + 64; ++j) {
+		if (memcmp(&stream[frameOffsets[j]], buf, n) == 0) {
+			t->next = j + 1;
+			++t->genuine;
+			return;
+		}
+	}
+	++t->spurious;
+}
+
+/**
+ * Runs the stock byte-at-a-time parser over `data`.
+ */
+static void RunStock(const uint8_t *data, uint32_t n, FrameTally *t)
+{
+	mavlink_message_t msg;
+	mavlink_status_t status;
+	uint32_t i;
+	mavlink_reset_channel_status(MAVLINK_COMM_1);
+	for (i = 0; i < n; ++i) {
+		if (mavlink_parse_char(MAVLINK_COMM_1, data[i], &msg, &status) && t) {
+			Tally(t, &msg);
+		}
+	}
+}
+
+/**
+ * Runs the receiver over `data`, pushing it through a ring in chunks of 1 to `maxChunk` bytes like
+ * the UART ISR would, and draining the ring after every chunk like MavLinkReceive() does.
+ */
+static void RunReceiver(MavlinkReceiver *r, const uint8_t *data, uint32_t n, uint16_t maxChunk, FrameTally *t)
+{
+	static uint8_t ringData[RING_SIZE];
+	SpscBuffer ring;
+	mavlink_message_t msg;
+	uint32_t i = 0;
+
+	SPSC_Init(&ring, ringData, sizeof(ringData));
+	MavlinkReceiverInit(r);
+	while (i < n) {
+		uint16_t chunk = (maxChunk > 1) ? 1 + rand() % maxChunk : maxChunk;
+		uint16_t space = SPSC_GetSpace(&ring);
+		if (chunk > space) {
+			chunk = space;
+		}
+		if (chunk > n - i) {
+			chunk = (uint16_t)(n - i);
+		}
+		assert(SPSC_WriteMany(&ring, &data[i], chunk, true));
+		i += chunk;
+
+		SpscBufferSpans spans;
+		uint16_t length = SPSC_GetReadSpans(&ring, &spans);
+		uint16_t offset = 0;
+		while (MavlinkReceiverNext(r, &spans, length, &offset, &msg)) {
+			if (t) {
+				Tally(t, &msg);
+			}
+		}
+		assert(offset <= length);
+		assert(SPSC_CommitRead(&ring, offset));
+		// A partial frame is never more than a frame long, so the ring can't fill up with one.
+		assert(SPSC_GetLength(&ring) < MAVLINK_MAX_PACKET_LEN);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	srand(1234);
+	if (argc > 1) {
+		if (!LoadStream(argv[1])) {
+			printf("Failed to load '%s'.\n", argv[1]);
+			return 1;
+		}
+		printf("Loaded %u bytes containing %u frames from '%s'.\n", streamLength, frameCount, argv[1]);
+	} else {
+		GenerateStream(20000);
+		uint32_t i, v2Frames = 0;
+		for (i = 0; i < frameCount; ++i) {
+			v2Frames += (stream[frameOffsets[i]] == MAVLINK_STX_MAVLINK2);
+		}
+		printf("Generated %u bytes containing %u frames, %u of them MAVLink 2.\n", streamLength, frameCount, v2Frames);
+	}
+	corrupted = malloc(streamLength * 3 + MAVLINK_MAX_PACKET_LEN);
+
+	// A clean stream comes through whole, without discarding anything, however it's chunked.
+	{
+		const uint16_t chunks[] = {1, 7, 64, 300, RING_SIZE};
+		uint16_t i;
+		for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+			MavlinkReceiver r;
+			FrameTally t = {};
+			RunReceiver(&r, stream, streamLength, chunks[i], &t);
+			assert(t.genuine == frameCount && t.spurious == 0);
+			assert(r.stats.messages == (uint16_t)frameCount);
+			assert(r.stats.badFrames == 0 && r.stats.resyncs == 0 && r.stats.discardedBytes == 0);
+		}
+		printf("Clean stream received intact for all chunk sizes.\n");
+	}
+
+	// A trimmed MAVLink 2 payload comes out with its zeros filled back in, whatever was in the
+	// message before.
+	{
+		MavlinkReceiver r;
+		SpscBuffer ring;
+		SpscBufferSpans spans;
+		uint8_t ringData[64], frame[MAVLINK_MAX_PACKET_LEN];
+		mavlink_message_t msg;
+		mavlink_sys_status_t status = {.onboard_control_sensors_present = 0x1234}, decoded;
+		uint16_t n, offset = 0;
+
+		memset(&msg, 0, sizeof(msg));
+		memcpy(_MAV_PAYLOAD_NON_CONST(&msg), &status, sizeof(status));
+		msg.msgid = MAVLINK_MSG_ID_SYS_STATUS;
+		mavlink_set_proto_version(MAVLINK_COMM_3, 2);
+		mavlink_finalize_message_chan(&msg, 20, 0, MAVLINK_COMM_3, MAVLINK_MSG_ID_SYS_STATUS_LEN, MAVLINK_MSG_ID_SYS_STATUS_CRC);
+		assert(msg.magic == MAVLINK_STX_MAVLINK2 && msg.len < MAVLINK_MSG_ID_SYS_STATUS_LEN);
+		n = mavlink_msg_to_send_buffer(frame, &msg);
+
+		SPSC_Init(&ring, ringData, sizeof(ringData));
+		assert(SPSC_WriteMany(&ring, frame, n, true));
+		MavlinkReceiverInit(&r);
+		memset(&msg, 0x55, sizeof(msg));
+		uint16_t length = SPSC_GetReadSpans(&ring, &spans);
+		assert(MavlinkReceiverNext(&r, &spans, length, &offset, &msg) && offset == n);
+		assert(msg.magic == MAVLINK_STX_MAVLINK2 && mavlink_msg_get_send_buffer_length(&msg) == n);
+		mavlink_msg_sys_status_decode(&msg, &decoded);
+		assert(memcmp(&decoded, &status, sizeof(status)) == 0);
+		printf("Trimmed MAVLink 2 payloads are zero-filled (%u byte frame instead of %u).\n",
+		       n, MAVLINK_MSG_ID_SYS_STATUS_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES);
+	}
+
+	// Leading garbage without any STX is discarded in one go and doesn't count as a resync, as sync
+	// was never acquired. Garbage between frames does.
+	{
+		MavlinkReceiver r;
+		FrameTally t = {};
+		uint32_t firstFrame = frameOffsets[1] - frameOffsets[0];
+		uint32_t i;
+		corruptedLength = 0;
+		for (i = 0; i < 100; ++i) {
+			Emit(0x55);
+		}
+		for (i = 0; i < firstFrame; ++i) {
+			Emit(stream[i]);
+		}
+		for (i = 0; i < 10; ++i) {
+			Emit(0xAA);
+		}
+		for (i = firstFrame; i < frameOffsets[2]; ++i) {
+			Emit(stream[i]);
+		}
+		RunReceiver(&r, corrupted, corruptedLength, RING_SIZE, &t);
+		assert(t.genuine == 2 && r.stats.discardedBytes == 110 && r.stats.resyncs == 1 && r.stats.badFrames == 0);
+		printf("Garbage between frames is discarded and counted.\n");
+	}
+
+	// Now fuzz: the receiver must never produce anything the stock parser wouldn't have accepted as
+	// well, and it should recover at least as many of the real frames.
+	{
+		const double rates[] = {0.0005, 0.002, 0.01, 0.05};
+		uint16_t i, run;
+		printf("%-8s %14s %14s %9s %9s %12s\n", "rate", "stock frames", "rx frames", "resyncs", "bad", "discarded");
+		for (i = 0; i < sizeof(rates) / sizeof(rates[0]); ++i) {
+			FrameTally stock = {}, rx = {};
+			uint32_t resyncs = 0, badFrames = 0, discarded = 0;
+			for (run = 0; run < 5; ++run) {
+				MavlinkReceiver r;
+				Corrupt(rates[i]);
+				RunStock(corrupted, corruptedLength, &stock);
+				stock.next = 0;
+				RunReceiver(&r, corrupted, corruptedLength, 1 + rand() % 400, &rx);
+				rx.next = 0;
+				resyncs += r.stats.resyncs;
+				badFrames += r.stats.badFrames;
+				discarded += r.stats.discardedBytes;
+			}
+			printf("%-8g %14u %14u %9u %9u %12u\n", rates[i], stock.genuine, rx.genuine, resyncs, badFrames, discarded);
+			assert(rx.genuine >= stock.genuine);
+			assert(rx.spurious <= stock.spurious + rx.genuine / 10000);
+		}
+	}
+
+	// And the throughput of both on a clean and a corrupted stream.
+	{
+		MavlinkReceiver r;
+		clock_t start;
+		double stock, rx;
+		int rep;
+
+		start = clock();
+		for (rep = 0; rep < 10; ++rep) {
+			RunStock(stream, streamLength, NULL);
+		}
+		stock = 10.0 * streamLength / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1e6;
+		start = clock();
+		for (rep = 0; rep < 10; ++rep) {
+			RunReceiver(&r, stream, streamLength, 256, NULL);
+		}
+		rx = 10.0 * streamLength / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1e6;
+		printf("Clean stream:      stock %7.1f MB/s, receiver %7.1f MB/s\n", stock, rx);
+
+		Corrupt(0.01);
+		start = clock();
+		for (rep = 0; rep < 10; ++rep) {
+			RunStock(corrupted, corruptedLength, NULL);
+		}
+		stock = 10.0 * corruptedLength / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1e6;
+		start = clock();
+		for (rep = 0; rep < 10; ++rep) {
+			RunReceiver(&r, corrupted, corruptedLength, 256, NULL);
+		}
+		rx = 10.0 * corruptedLength / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1e6;
+		printf("Corrupted stream:  stock %7.1f MB/s, receiver %7.1f MB/s\n", stock, rx);
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_MAVLINK_RECEIVER
@@ -0,0 +1,83 @@
+/**
+ * @file   MavlinkReceiver.h
+ * @brief  Frame-at-a-time MAVLink reception straight out of a receive ring.
+ *
+ * mavlink_parse_char() runs every received byte through its state machine, which is also how it
+ * searches for the next frame after corruption: a bad frame is only noticed once its checksum
+ * arrives, and any real frame that started inside it is lost as well.
+ *
+ * This receiver instead works on all bytes received so far, as exposed by SPSC_GetReadSpans() or
+ * Uart*GetReadSpans(). It finds start-of-frame candidates with memchr(), rejects a candidate whose
+ * length doesn't match its message ID, and only accepts a frame once its whole length has arrived and
+ * its checksum matches. Both MAVLink 1 and unsigned MAVLink 2 frames are accepted, and the zeros
+ * trimmed off the end of a MAVLink 2 payload are filled back in. A rejected candidate only costs its STX byte, and the search resumes right
+ * after it. Bytes belonging to a frame that hasn't been fully received yet are left in the ring, so
+ * there's no need for a separate reassembly buffer and frames split across the end of the ring are
+ * handled transparently.
+ *
+ * Usage:
+ * ```
+ * SpscBufferSpans spans;
+ * uint16_t length = Uart1GetReadSpans(&spans);
+ * uint16_t offset = 0;
+ * while (MavlinkReceiverNext(&receiver, &spans, length, &offset, &msg)) {
+ *   // Handle msg.
+ * }
+ * Uart1CommitRead(offset);
+ * ```
+ *
+ * Unit testing, including a fuzzer that corrupts a stream of seaslug messages (or a recorded raw
+ * capture passed as the first argument) and compares the result with mavlink_parse_char(), plus a
+ * throughput comparison, is done on x86 by compiling with the UNIT_TEST_MAVLINK_RECEIVER macro:
+ * `gcc MavlinkReceiver.c SpscBuffer.c MavlinkHelpers.c -DUNIT_TEST_MAVLINK_RECEIVER -DMAVLINK_SEPARATE_HELPERS -I../MAVLink/seaslug -O2 -Wall`
+ */
+#ifndef MAVLINK_RECEIVER_H
+#define MAVLINK_RECEIVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <mavlink.h>
+
+#include "SpscBuffer.h"
+
+/**
+ * Reception statistics for a single channel.
+ */
+typedef struct {
+	uint16_t messages;       //!< Frames received with a valid length and checksum.
+	uint16_t badFrames;      //!< Start-of-frame candidates rejected for their length or checksum.
+	uint16_t resyncs;        //!< The number of times frame synchronization was lost.
+	uint32_t discardedBytes; //!< Bytes thrown away while searching for the next frame.
+} MavlinkReceiverStats;
+
+/**
+ * The receive state of a single channel. Initialize with MavlinkReceiverInit().
+ */
+typedef struct {
+	MavlinkReceiverStats stats;
+	bool inSync; //!< True while the last thing seen was a valid frame.
+} MavlinkReceiver;
+
+/**
+ * Resets the receiver state and clears its statistics.
+ */
+void MavlinkReceiverInit(MavlinkReceiver *r);
+
+/**
+ * Finds the next valid frame in the received data.
+ *
+ * Any bytes that can't be the start of a valid frame are skipped and counted as discarded. `offset`
+ * is advanced past those and past the returned frame, but never into a frame that's still being
+ * received, so it's always the number of bytes that can be released from the receive buffer.
+ * @param r The receiver for this channel.
+ * @param spans The received data.
+ * @param length The total number of bytes in `spans`.
+ * @param offset Where to start looking, updated to just past the consumed data.
+ * @param msg Filled in with the frame if one was found.
+ * @return True if a frame was found.
+ */
+bool MavlinkReceiverNext(MavlinkReceiver *r, const SpscBufferSpans *spans, uint16_t length,
+                         uint16_t *offset, mavlink_message_t *msg);
+
+#endif // MAVLINK_RECEIVER_H
@@ -0,0 +1,303 @@
+#include "MavlinkSerializer.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+#include <../checksum.h>
+#include <mavlink.h>
+
+/**
+ * Copies `length` bytes into the spans starting `offset` bytes into the first one, continuing into
+ * the second span if the first runs out.
+ */
+static void _SpanCopy(const SpscBufferSpans *spans, uint16_t offset, const void *data, uint16_t length)
+{
+	const uint8_t *d = (const uint8_t *)data;
+	if (offset < spans->length[0]) {
+		uint16_t n = spans->length[0] - offset;
+		if (n > length) {
+			n = length;
+		}
+		memcpy(spans->data[0] + offset, d, n);
+		d += n;
+		length -= n;
+		offset = 0;
+	} else {
+		offset -= spans->length[0];
+	}
+	if (length) {
+		memcpy(spans->data[1] + offset, d, length);
+	}
+}
+
+uint16_t MavlinkSerialize(const SpscBufferSpans *spans, uint16_t space, uint8_t chan, uint8_t sysid,
+                          uint8_t compid, uint8_t msgid, const void *payload, uint8_t length,
+                          uint8_t crcExtra)
+{
+	mavlink_status_t *status = mavlink_get_channel_status(chan);
+	const bool mavlink2 = _mav_use_mavlink2(status, (const char *)payload, &length);
+	const uint8_t headerLength = mavlink2 ? MAVLINK2_NUM_HEADER_BYTES : MAVLINK_NUM_HEADER_BYTES;
+	const uint16_t frameLength = headerLength + length + MAVLINK_NUM_CHECKSUM_BYTES;
+	if (space < frameLength) {
+		return 0;
+	}
+
+	uint8_t header[MAVLINK2_NUM_HEADER_BYTES];
+	_mav_put_header(header, mavlink2 ? MAVLINK_STX_MAVLINK2 : MAVLINK_STX, length, status->current_tx_seq,
+	                sysid, compid, msgid);
+	++status->current_tx_seq;
+
+	// The checksum covers everything but the STX, followed by the message's CRC_EXTRA.
+	uint16_t crc;
+	crc_init(&crc);
+	crc_accumulate_buffer(&crc, (const char *)&header[1], headerLength - 1);
+	crc_accumulate_buffer(&crc, (const char *)payload, length);
+	crc_accumulate(crcExtra, &crc);
+	const uint8_t checksum[2] = {crc & 0xFF, crc >> 8};
+
+	_SpanCopy(spans, 0, header, headerLength);
+	_SpanCopy(spans, headerLength, payload, length);
+	_SpanCopy(spans, headerLength + length, checksum, 2);
+
+	return frameLength;
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_MAVLINK_SERIALIZER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#define CYCLES() 0
+#endif
+
+#define RING_SIZE 1024
+
+static SpscBuffer ring;
+static uint8_t ringData[RING_SIZE];
+
+/**
+ * The stock transmit path as used before: pack into a mavlink_message_t, flatten that into a
+ * buffer, and copy the buffer into the ring.
+ */
+static uint16_t StockSend(const mavlink_message_t *msg)
+{
+	static uint8_t buf[MAVLINK_MAX_PACKET_LEN];
+	uint16_t len = mavlink_msg_to_send_buffer(buf, msg);
+	return SPSC_WriteMany(&ring, buf, len, true) ? len : 0;
+}
+
+static uint16_t SerializerSend(uint8_t chan, uint8_t msgid, const void *payload, uint8_t length, uint8_t crcExtra)
+{
+	SpscBufferSpans spans;
+	uint16_t space = SPSC_GetWriteSpans(&ring, &spans);
+	uint16_t n = MavlinkSerialize(&spans, space, chan, 1, 2, msgid, payload, length, crcExtra);
+	if (n) {
+		SPSC_CommitWrite(&ring, n);
+	}
+	return n;
+}
+
+typedef enum {
+	BENCH_HEARTBEAT,
+	BENCH_SYS_STATUS,
+	BENCH_CONTROLLER_DATA
+} BenchMessage;
+
+static const char *const benchNames[] = {"HEARTBEAT", "SYS_STATUS", "CONTROLLER_DATA"};
+
+/**
+ * Sends `count` messages of the given type through one of the two paths, draining the ring whenever
+ * it fills up like the UART ISR would. The payload is changed every message so nothing can be
+ * hoisted out of the loop. Returns the elapsed time in seconds and the TSC cycles in `cycles`.
+ */
+static double Benchmark(BenchMessage type, bool serializer, uint32_t count, uint64_t *cycles)
+{
+	mavlink_heartbeat_t hb = {.custom_mode = 0, .type = MAV_TYPE_SURFACE_BOAT, .autopilot = MAV_AUTOPILOT_GENERIC, .base_mode = 0, .system_status = MAV_STATE_ACTIVE};
+	mavlink_sys_status_t ss = {.onboard_control_sensors_present = 0x1234, .voltage_battery = 12000, .battery_remaining = -1};
+	mavlink_controller_data_t cd = {.lat = 365000000, .lon = -1220000000, .reset = 0};
+	mavlink_message_t msg;
+	volatile uint16_t sink = 0;
+	uint32_t i;
+
+	SPSC_Init(&ring, ringData, sizeof(ringData));
+	clock_t start = clock();
+	uint64_t startCycles = CYCLES();
+	for (i = 0; i < count; ++i) {
+		uint16_t n;
+		if (SPSC_GetSpace(&ring) < MAVLINK_MAX_PACKET_LEN) {
+			SPSC_Remove(&ring, SPSC_GetLength(&ring));
+		}
+		switch (type) {
+		case BENCH_HEARTBEAT:
+			hb.custom_mode = i;
+			if (serializer) {
+				n = SerializerSend(MAVLINK_COMM_0, MAVLINK_MSG_ID_HEARTBEAT, &hb, MAVLINK_MSG_ID_HEARTBEAT_LEN, MAVLINK_MSG_ID_HEARTBEAT_CRC);
+			} else {
+				mavlink_msg_heartbeat_encode(1, 2, &msg, &hb);
+				n = StockSend(&msg);
+			}
+			break;
+		case BENCH_SYS_STATUS:
+			ss.load = (uint16_t)i;
+			if (serializer) {
+				n = SerializerSend(MAVLINK_COMM_0, MAVLINK_MSG_ID_SYS_STATUS, &ss, MAVLINK_MSG_ID_SYS_STATUS_LEN, MAVLINK_MSG_ID_SYS_STATUS_CRC);
+			} else {
+				mavlink_msg_sys_status_encode(1, 2, &msg, &ss);
+				n = StockSend(&msg);
+			}
+			break;
+		default:
+			cd.time_boot_ms = i;
+			if (serializer) {
+				n = SerializerSend(MAVLINK_COMM_0, MAVLINK_MSG_ID_CONTROLLER_DATA, &cd, MAVLINK_MSG_ID_CONTROLLER_DATA_LEN, MAVLINK_MSG_ID_CONTROLLER_DATA_CRC);
+			} else {
+				mavlink_msg_controller_data_encode(1, 2, &msg, &cd);
+				n = StockSend(&msg);
+			}
+			break;
+		}
+		sink ^= n;
+	}
+	*cycles = CYCLES() - startCycles;
+	(void)sink;
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(void)
+{
+	static const uint8_t crcs[] = MAVLINK_MESSAGE_CRCS;
+	static const uint8_t lengths[] = MAVLINK_MESSAGE_LENGTHS;
+	srand(5);
+
+	// Every seaslug message, starting at every position in the ring so that each part of the frame
+	// gets split across the wrap at some point, must come out byte-identical to the stock path.
+	{
+		uint16_t id, offset, messages = 0;
+		for (id = 0; id < 256; ++id) {
+			if (lengths[id] == 0) {
+				continue;
+			}
+			for (offset = 0; offset < MAVLINK_MAX_PACKET_LEN; offset += 7) {
+				uint8_t payload[MAVLINK_MAX_PAYLOAD_LEN];
+				uint8_t expected[MAVLINK_MAX_PACKET_LEN], actual[MAVLINK_MAX_PACKET_LEN];
+				mavlink_message_t msg;
+				uint16_t i, n;
+
+				for (i = 0; i < lengths[id]; ++i) {
+					payload[i] = (uint8_t)rand();
+				}
+
+				// Run the stock path on channel 1 and the serializer on channel 2, which should be
+				// in lock-step as far as their sequence numbers go.
+				memcpy(_MAV_PAYLOAD_NON_CONST(&msg), payload, lengths[id]);
+				msg.msgid = (uint8_t)id;
+				mavlink_finalize_message_chan(&msg, 1, 2, MAVLINK_COMM_1, lengths[id], crcs[id]);
+				n = mavlink_msg_to_send_buffer(expected, &msg);
+
+				SPSC_Init(&ring, ringData, sizeof(ringData));
+				ring.head = ring.tail = RING_SIZE - offset;
+				assert(SerializerSend(MAVLINK_COMM_2, (uint8_t)id, payload, lengths[id], crcs[id]) == n);
+				assert(SPSC_GetLength(&ring) == n);
+				assert(SPSC_ReadMany(&ring, actual, n));
+				assert(memcmp(expected, actual, n) == 0);
+			}
+			++messages;
+		}
+		printf("%u messages serialized identically to mavlink_msg_to_send_buffer().\n", messages);
+	}
+
+	// The same with MAVLink 2 allowed on both channels and payloads ending in a random number of
+	// zeros, so that frames of both versions come out.
+	{
+		uint16_t id, offset, v2Frames = 0, frames = 0;
+		mavlink_set_proto_version(MAVLINK_COMM_1, 2);
+		mavlink_set_proto_version(MAVLINK_COMM_2, 2);
+		for (id = 0; id < 256; ++id) {
+			if (lengths[id] == 0) {
+				continue;
+			}
+			for (offset = 0; offset < MAVLINK_MAX_PACKET_LEN; offset += 7) {
+				uint8_t payload[MAVLINK_MAX_PAYLOAD_LEN];
+				uint8_t expected[MAVLINK_MAX_PACKET_LEN], actual[MAVLINK_MAX_PACKET_LEN];
+				mavlink_message_t msg;
+				uint16_t i, n, zeros = rand() % (lengths[id] + 1);
+
+				for (i = 0; i < lengths[id]; ++i) {
+					payload[i] = (i < lengths[id] - zeros) ? (uint8_t)rand() : 0;
+				}
+
+				memcpy(_MAV_PAYLOAD_NON_CONST(&msg), payload, lengths[id]);
+				msg.msgid = (uint8_t)id;
+				mavlink_finalize_message_chan(&msg, 1, 2, MAVLINK_COMM_1, lengths[id], crcs[id]);
+				n = mavlink_msg_to_send_buffer(expected, &msg);
+				v2Frames += (msg.magic == MAVLINK_STX_MAVLINK2);
+				++frames;
+
+				SPSC_Init(&ring, ringData, sizeof(ringData));
+				ring.head = ring.tail = RING_SIZE - offset;
+				assert(SerializerSend(MAVLINK_COMM_2, (uint8_t)id, payload, lengths[id], crcs[id]) == n);
+				assert(SPSC_GetLength(&ring) == n);
+				assert(SPSC_ReadMany(&ring, actual, n));
+				assert(memcmp(expected, actual, n) == 0);
+			}
+		}
+		mavlink_set_proto_version(MAVLINK_COMM_1, 1);
+		mavlink_set_proto_version(MAVLINK_COMM_2, 1);
+		assert(v2Frames > 0 && v2Frames < frames);
+		printf("%u frames, %u of them MAVLink 2, serialized identically to mavlink_msg_to_send_buffer().\n", frames, v2Frames);
+	}
+
+	// When the frame doesn't fit nothing may change: not the ring and not the sequence number.
+	{
+		mavlink_heartbeat_t hb = {};
+		uint8_t seq = mavlink_get_channel_status(MAVLINK_COMM_3)->current_tx_seq;
+		SpscBufferSpans spans;
+
+		SPSC_Init(&ring, ringData, sizeof(ringData));
+		memset(ringData, 0xA5, sizeof(ringData));
+		assert(SPSC_WriteMany(&ring, ringData, RING_SIZE - (MAVLINK_MSG_ID_HEARTBEAT_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES - 1), true));
+		uint16_t space = SPSC_GetWriteSpans(&ring, &spans);
+		assert(MAVLINK_SERIALIZE(&spans, space, MAVLINK_COMM_3, 1, 2, HEARTBEAT, &hb) == 0);
+		assert(mavlink_get_channel_status(MAVLINK_COMM_3)->current_tx_seq == seq);
+		uint16_t i;
+		for (i = 0; i < RING_SIZE; ++i) {
+			assert(ringData[i] == 0xA5);
+		}
+
+		// One more byte of room is enough though.
+		uint8_t c;
+		assert(SPSC_ReadByte(&ring, &c));
+		space = SPSC_GetWriteSpans(&ring, &spans);
+		assert(MAVLINK_SERIALIZE(&spans, space, MAVLINK_COMM_3, 1, 2, HEARTBEAT, &hb) == space);
+		assert(mavlink_get_channel_status(MAVLINK_COMM_3)->current_tx_seq == (uint8_t)(seq + 1));
+		printf("Frames that don't fit leave the ring and sequence number untouched.\n");
+	}
+
+	// And the throughput of both paths for the most common messages.
+	{
+		const uint32_t count = 2000000;
+		int type;
+		printf("%-16s %22s %22s\n", "", "stock (msg/s, cyc/msg)", "serializer");
+		for (type = BENCH_HEARTBEAT; type <= BENCH_CONTROLLER_DATA; ++type) {
+			uint64_t stockCycles, serializerCycles;
+			double stock = Benchmark(type, false, count, &stockCycles);
+			double serializer = Benchmark(type, true, count, &serializerCycles);
+			printf("%-16s %12.0f %9.1f %12.0f %9.1f\n", benchNames[type],
+			       count / stock, (double)stockCycles / count,
+			       count / serializer, (double)serializerCycles / count);
+		}
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_MAVLINK_SERIALIZER
@@ -0,0 +1,62 @@
+/**
+ * @file   MavlinkSerializer.h
+ * @brief  Serializes MAVLink messages straight into a transmit ring.
+ *
+ * The stock MAVLink path packs a message into a mavlink_message_t, copies that into a flat buffer
+ * with mavlink_msg_to_send_buffer(), and that buffer is then copied again into the UART's ring.
+ * MavlinkSerialize() instead takes the message's payload struct (mavlink_*_t, which is laid out
+ * exactly like the wire payload on the little-endian dsPIC) and writes the header, payload, and
+ * checksum directly into the free space of the ring as exposed by SPSC_GetWriteSpans() or
+ * Uart*GetWriteSpans(). The caller then publishes the whole frame with a single commit, so the
+ * consumer never sees a partial message.
+ *
+ * Frames share the transmit sequence numbers and protocol version of the regular MAVLink helpers for
+ * the same channel, so both can be mixed freely. On a channel set to MAVLink 2 with
+ * mavlink_set_proto_version(), payloads with enough trailing zeros go out as MAVLink 2 frames with
+ * those zeros trimmed off.
+ *
+ * Unit testing, including a comparison against mavlink_msg_to_send_buffer() for every seaslug
+ * message and a benchmark of the stock path against this one, is done on x86 by compiling with the
+ * UNIT_TEST_MAVLINK_SERIALIZER macro:
+ * `gcc MavlinkSerializer.c SpscBuffer.c MavlinkHelpers.c -DUNIT_TEST_MAVLINK_SERIALIZER -DMAVLINK_SEPARATE_HELPERS -I../MAVLink/seaslug -O2 -Wall`
+ */
+#ifndef MAVLINK_SERIALIZER_H
+#define MAVLINK_SERIALIZER_H
+
+#include <stdint.h>
+
+#include "SpscBuffer.h"
+
+/**
+ * Serializes a message into a transmit buffer, using the _LEN and _CRC constants that the MAVLink
+ * generator emits for every message. For example:
+ * ```
+ * mavlink_dsp3000_t dsp = {.z_rate = rate};
+ * n = MAVLINK_SERIALIZE(&spans, space, chan, sysid, compid, DSP3000, &dsp);
+ * ```
+ */
+#define MAVLINK_SERIALIZE(spans, space, chan, sysid, compid, name, payload) \
+	MavlinkSerialize(spans, space, chan, sysid, compid, MAVLINK_MSG_ID_##name, payload, \
+	                 MAVLINK_MSG_ID_##name##_LEN, MAVLINK_MSG_ID_##name##_CRC)
+
+/**
+ * Writes a complete MAVLink 1 or MAVLink 2 frame into the free space described by `spans`. If the
+ * frame doesn't fit into `space` bytes nothing is written and the channel's sequence number is left
+ * alone. Otherwise the frame is written starting at the beginning of the spans, wrapping into the
+ * second span as necessary, and it's up to the caller to commit the returned number of bytes.
+ * @param spans The free space of the transmit buffer, from SPSC_GetWriteSpans() or similar.
+ * @param space The total number of bytes in `spans`.
+ * @param chan The MAVLink channel, which selects the sequence counter and protocol version to use.
+ * @param sysid The system ID of the sender.
+ * @param compid The component ID of the sender.
+ * @param msgid The ID of the message.
+ * @param payload The message's payload, generally a mavlink_*_t struct.
+ * @param length The size of the payload in bytes.
+ * @param crcExtra The CRC_EXTRA seed of the message.
+ * @return The size of the frame in bytes, or 0 if it didn't fit.
+ */
+uint16_t MavlinkSerialize(const SpscBufferSpans *spans, uint16_t space, uint8_t chan, uint8_t sysid,
+                          uint8_t compid, uint8_t msgid, const void *payload, uint8_t length,
+                          uint8_t crcExtra);
+
+#endif // MAVLINK_SERIALIZER_H
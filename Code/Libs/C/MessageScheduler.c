@@ -8,31 +8,995 @@
 
 // Include system libraries
 #include <stdlib.h>
+#include <string.h>
 #include <limits.h>
-#include <math.h>
 
-// These constants are used for indexing into `MessageSchedule.schedule->Timesteps` for
-// dealing with either the transient or the repeating messages.
+// These constants are used for indexing into `MessageScheduleSlot.Next` for dealing with either the
+// transient or the repeating messages.
 #define MSCHED_REPEATING 0
 #define	MSCHED_TRANSIENT 1
 
-// Helper macros for incrementing and decrementing a value while keeping it in the range [0, 99]
-// TODO: Add tests for these
-#define INCR_WRAP_TO_99(x) do {if ((x) >= 99) { (x) = 0; } else { ++(x); }} while (0)
-#define DECR_WRAP_TO_99(x) do {if ((x) == 0) { (x) = 99; } else { --(x); }} while (0)
+// Every message has a repeating and a transient entry that can be linked into the timestep lists.
+// They're numbered starting at 1, so that 0 can end a list, with the low bit selecting which of the
+// two entries it is.
+#define MSCHED_ENTRY(mid, type) ((uint8_t)((((mid) << 1) | (type)) + 1))
+#define MSCHED_ENTRY_MID(entry) ((uint8_t)(((entry) - 1) >> 1))
+#define MSCHED_ENTRY_TYPE(entry) ((uint8_t)(((entry) - 1) & 1))
+
+// Helper macros for incrementing and decrementing a timestep while keeping it in the range
+// [0, schedule->TimestepCount)
+#define INCR_WRAP(schedule, x) do {if ((x) >= (schedule)->TimestepCount - 1) { (x) = 0; } else { ++(x); }} while (0)
+#define DECR_WRAP(schedule, x) do {if ((x) == 0) { (x) = (schedule)->TimestepCount - 1; } else { --(x); }} while (0)
+
+/**
+ * Find out which internal message ID is used for the given message ID.
+ * @return The index of this message or -1 if it's not part of this schedule.
+ */
+static int _FindMessage(const MessageSchedule *schedule, uint8_t id)
+{
+	int i;
+	for (i = 0; i < schedule->MessageTypes; ++i) {
+		if (schedule->MessageIds[i] == id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Returns the timestep of the given repetition of a repeating message. The repetitions are spread
+ * out over the cycle as evenly as possible, even when they don't divide it evenly.
+ */
+static uint16_t _OccurrenceStep(const MessageSchedule *schedule, const MessageScheduleSlot *slot, uint16_t occurrence)
+{
+	return slot->Offset + (uint16_t)(((uint32_t)occurrence * schedule->TimestepCount) / slot->Count);
+}
+
+/**
+ * Returns the first repetition of a repeating message that's at or after the given timestep, or
+ * `slot->Count` if there is none.
+ */
+static uint16_t _FirstOccurrenceFrom(const MessageSchedule *schedule, const MessageScheduleSlot *slot, uint16_t timestep)
+{
+	if (timestep <= slot->Offset) {
+		return 0;
+	}
+	// Solve Offset + (i * TimestepCount) / Count >= timestep for the smallest i.
+	return (uint16_t)(((uint32_t)(timestep - slot->Offset) * slot->Count + schedule->TimestepCount - 1) / schedule->TimestepCount);
+}
+
+/**
+ * Returns whether a repeating message is sent at the given timestep.
+ */
+static bool _IsOccurrence(const MessageSchedule *schedule, const MessageScheduleSlot *slot, uint16_t timestep)
+{
+	if (!slot->Count) {
+		return false;
+	}
+	uint16_t occurrence = _FirstOccurrenceFrom(schedule, slot, timestep);
+	return occurrence < slot->Count && _OccurrenceStep(schedule, slot, occurrence) == timestep;
+}
+
+/**
+ * Returns whether a repeating message is actually sent at the given timestep, which it isn't if
+ * that's the next timestep and its repetition was displaced by an urgent message.
+ */
+static bool _IsSentAt(const MessageSchedule *schedule, const MessageScheduleSlot *slot, uint16_t timestep)
+{
+	return _IsOccurrence(schedule, slot, timestep) && !(slot->Displaced && timestep == schedule->CurrentTimestep);
+}
+
+/**
+ * Link a message's entry onto the front of the list for the given timestep.
+ */
+static void _PushEntry(MessageSchedule *schedule, uint16_t timestep, uint8_t entry)
+{
+	schedule->Slots[MSCHED_ENTRY_MID(entry)].Next[MSCHED_ENTRY_TYPE(entry)] = schedule->TimestepLists[timestep];
+	schedule->TimestepLists[timestep] = entry;
+}
+
+/**
+ * Unlink a message's entry from the list for the given timestep.
+ */
+static void _UnlinkEntry(MessageSchedule *schedule, uint16_t timestep, uint8_t entry)
+{
+	uint8_t *link = &schedule->TimestepLists[timestep];
+	while (*link) {
+		if (*link == entry) {
+			*link = schedule->Slots[MSCHED_ENTRY_MID(entry)].Next[MSCHED_ENTRY_TYPE(entry)];
+			return;
+		}
+		link = &schedule->Slots[MSCHED_ENTRY_MID(*link)].Next[MSCHED_ENTRY_TYPE(*link)];
+	}
+}
+
+/**
+ * Removes the repeating schedule of a message along with its contribution to the timestep costs.
+ */
+static void _RemoveRepeating(MessageSchedule *schedule, uint8_t mid)
+{
+	MessageScheduleSlot *slot = &schedule->Slots[mid];
+	if (!slot->Count) {
+		return;
+	}
+
+	_UnlinkEntry(schedule, _OccurrenceStep(schedule, slot, slot->Occurrence), MSCHED_ENTRY(mid, MSCHED_REPEATING));
+
+	uint16_t i;
+	for (i = 0; i < slot->Count; ++i) {
+		schedule->TimestepBytes[_OccurrenceStep(schedule, slot, i)] -= schedule->MessageSizes[mid];
+	}
+	slot->Count = 0;
+	slot->Displaced = false;
+}
+
+/**
+ * Removes a pending one-off transmission of a message.
+ */
+static void _RemoveTransient(MessageSchedule *schedule, uint8_t mid)
+{
+	MessageScheduleSlot *slot = &schedule->Slots[mid];
+	if (slot->TransientPending) {
+		_UnlinkEntry(schedule, slot->TransientStep, MSCHED_ENTRY(mid, MSCHED_TRANSIENT));
+		slot->TransientPending = false;
+	}
+}
+
+/**
+ * Returns the number of bytes of one-off transmissions pending at the given timestep.
+ */
+static uint16_t _TransientBytes(const MessageSchedule *schedule, uint16_t timestep)
+{
+	uint16_t bytes = 0;
+	uint8_t entry = schedule->TimestepLists[timestep];
+	while (entry) {
+		const uint8_t mid = MSCHED_ENTRY_MID(entry);
+		const uint8_t type = MSCHED_ENTRY_TYPE(entry);
+		if (type == MSCHED_TRANSIENT) {
+			bytes += schedule->MessageSizes[mid];
+		}
+		entry = schedule->Slots[mid].Next[type];
+	}
+	return bytes;
+}
+
+/**
+ * Returns the bytes of all pending one-off transmissions.
+ */
+static uint32_t _PendingTransientBytes(const MessageSchedule *schedule)
+{
+	uint32_t bytes = 0;
+	uint8_t mid;
+	for (mid = 0; mid < schedule->MessageTypes; ++mid) {
+		if (schedule->Slots[mid].TransientPending) {
+			bytes += schedule->MessageSizes[mid];
+		}
+	}
+	return bytes;
+}
+
+/**
+ * Returns the bytes of repeating messages sent every cycle.
+ */
+static uint32_t _CycleBytes(const MessageSchedule *schedule)
+{
+	uint32_t total = 0;
+	uint8_t mid;
+	for (mid = 0; mid < schedule->MessageTypes; ++mid) {
+		total += (uint32_t)schedule->MessageSizes[mid] * schedule->Slots[mid].Count;
+	}
+	return total;
+}
+
+/**
+ * Find the best offset for a repeating message sent `count` times a cycle. Every possible offset is
+ * checked for the total bytes already sent at the timesteps it'd use and the emptiest one is
+ * chosen. Only repeating messages are counted as transient messages will disappear and not be a
+ * factor over the long-term. Offsets that would exceed the per-timestep budget are skipped.
+ * @return False if there is no offset that fits within the budget.
+ */
+static bool _FindOffset(MessageSchedule *schedule, uint8_t mid, uint16_t count, uint16_t *bestOffset)
+{
+	MessageScheduleSlot *slot = &schedule->Slots[mid];
+	const uint16_t size = schedule->MessageSizes[mid];
+	const uint16_t period = schedule->TimestepCount / count;
+	uint32_t lastCost = UINT32_MAX;
+	uint16_t offset;
+	slot->Count = count;
+	for (offset = 0; offset < period; offset++) {
+		slot->Offset = offset;
+		uint32_t currentCost = 0;
+		uint16_t i;
+		for (i = 0; i < count; i++) {
+			const uint16_t bytes = schedule->TimestepBytes[_OccurrenceStep(schedule, slot, i)];
+			if (schedule->TimestepBudget && (uint32_t)bytes + size > schedule->TimestepBudget) {
+				break;
+			}
+			currentCost += bytes;
+		}
+		// If we've found a better offset that fits, store it.
+		if (i == count && currentCost < lastCost) {
+			*bestOffset = offset;
+			lastCost = currentCost;
+		}
+	}
+	slot->Count = 0;
+
+	return lastCost != UINT32_MAX;
+}
+
+/**
+ * Schedule a repeating message `count` times a cycle starting at the given offset.
+ */
+static void _PlaceRepeating(MessageSchedule *schedule, uint8_t mid, uint16_t count, uint16_t offset)
+{
+	MessageScheduleSlot *slot = &schedule->Slots[mid];
+	slot->Count = count;
+	slot->Offset = offset;
+	uint16_t i;
+	for (i = 0; i < count; i++) {
+		schedule->TimestepBytes[_OccurrenceStep(schedule, slot, i)] += schedule->MessageSizes[mid];
+	}
+
+	// A pending one-off transmission that now lines up with a repetition would be a duplicate.
+	if (slot->TransientPending && _IsOccurrence(schedule, slot, slot->TransientStep)) {
+		_RemoveTransient(schedule, mid);
+	}
+
+	// And queue up the first repetition that hasn't already passed this cycle.
+	slot->Occurrence = _FirstOccurrenceFrom(schedule, slot, schedule->CurrentTimestep);
+	if (slot->Occurrence >= count) {
+		slot->Occurrence = 0;
+	}
+	_PushEntry(schedule, _OccurrenceStep(schedule, slot, slot->Occurrence), MSCHED_ENTRY(mid, MSCHED_REPEATING));
+}
+
+/**
+ * Returns whether a one-off transmission of a message fits within the per-timestep budget at the
+ * given timestep. It always fits if the message is already being sent then.
+ */
+static bool _TransientFits(const MessageSchedule *schedule, uint8_t mid, uint16_t timestep)
+{
+	if (!schedule->TimestepBudget || _IsSentAt(schedule, &schedule->Slots[mid], timestep)) {
+		return true;
+	}
+	const uint32_t bytes = schedule->TimestepBytes[timestep] + _TransientBytes(schedule, timestep);
+	return bytes + schedule->MessageSizes[mid] <= schedule->TimestepBudget;
+}
+
+/**
+ * Returns the number of timesteps that one-off messages are placed within, which is the next
+ * second or the whole cycle if that's shorter.
+ */
+static uint16_t _TransientWindow(const MessageSchedule *schedule)
+{
+	return schedule->TimestepRate < schedule->TimestepCount ? schedule->TimestepRate : schedule->TimestepCount;
+}
+
+/**
+ * Schedules a one-off transmission of a message at the given timestep.
+ */
+static void _PlaceTransient(MessageSchedule *schedule, uint8_t mid, uint16_t timestep)
+{
+	schedule->Slots[mid].TransientStep = timestep;
+	schedule->Slots[mid].TransientPending = true;
+	_PushEntry(schedule, timestep, MSCHED_ENTRY(mid, MSCHED_TRANSIENT));
+}
+
+/**
+ * Returns the number of bytes that will actually be sent with the next dispatched timestep. Unlike
+ * any other timestep, every message due then is already on its list, so this is exact.
+ */
+static uint16_t _NextTimestepBytes(const MessageSchedule *schedule)
+{
+	uint16_t bytes = 0;
+	uint8_t entry = schedule->TimestepLists[schedule->CurrentTimestep];
+	while (entry) {
+		const uint8_t mid = MSCHED_ENTRY_MID(entry);
+		const uint8_t type = MSCHED_ENTRY_TYPE(entry);
+		if (type == MSCHED_TRANSIENT || !schedule->Slots[mid].Displaced) {
+			bytes += schedule->MessageSizes[mid];
+		}
+		entry = schedule->Slots[mid].Next[type];
+	}
+	return bytes;
+}
+
+/**
+ * Returns the message with the repetition due at the next timestep that's best displaced by an
+ * urgent message: the lowest priority below `priority`, then the largest. Returns -1 if there's none.
+ */
+static int _FindDisplaceable(const MessageSchedule *schedule, uint8_t urgentMid, uint8_t priority)
+{
+	int best = -1;
+	uint8_t entry = schedule->TimestepLists[schedule->CurrentTimestep];
+	while (entry) {
+		const uint8_t mid = MSCHED_ENTRY_MID(entry);
+		const uint8_t type = MSCHED_ENTRY_TYPE(entry);
+		const MessageScheduleSlot *slot = &schedule->Slots[mid];
+		if (type == MSCHED_REPEATING && mid != urgentMid && !slot->Displaced && slot->Priority < priority &&
+		    (best == -1 || slot->Priority < schedule->Slots[best].Priority ||
+		     (slot->Priority == schedule->Slots[best].Priority && schedule->MessageSizes[mid] > schedule->MessageSizes[best]))) {
+			best = mid;
+		}
+		entry = slot->Next[type];
+	}
+	return best;
+}
+
+/**
+ * Displaces the repetition of a message due at the next timestep. It's sent as a one-off message at
+ * the soonest later timestep with room before its next repetition instead, if there is one. Its
+ * bytes are already part of the per-second budget so that isn't checked.
+ */
+static void _DisplaceRepetition(MessageSchedule *schedule, uint8_t mid)
+{
+	MessageScheduleSlot *slot = &schedule->Slots[mid];
+	slot->Displaced = true;
+
+	// If a one-off transmission is already pending that'll have to do.
+	if (slot->TransientPending) {
+		return;
+	}
+
+	const uint16_t now = schedule->CurrentTimestep;
+	const uint16_t nextStep = _OccurrenceStep(schedule, slot, slot->Occurrence + 1 < slot->Count ? slot->Occurrence + 1 : 0);
+	uint16_t step = now;
+	for (;;) {
+		INCR_WRAP(schedule, step);
+		if (step == nextStep || step == now) {
+			break;
+		}
+		if (_TransientFits(schedule, mid, step)) {
+			_PlaceTransient(schedule, mid, step);
+			break;
+		}
+	}
+}
+
+void SetScheduleBudget(MessageSchedule *schedule, uint32_t bytesPerSecond, uint16_t bytesPerTimestep)
+{
+	schedule->SecondBudget = bytesPerSecond;
+	schedule->TimestepBudget = bytesPerTimestep;
+}
+
+/**
+ * Adds a repeating message that is sent `count` times every cycle.
+ */
+static bool _AddMessageRepeatingCount(MessageSchedule *schedule, uint8_t id, uint16_t count)
+{
+	// Be sure that we only process messages at reasonable rates: at most once per timestep.
+	if (count < 1 || count > schedule->TimestepCount) {
+		schedule->LastResult = SCHED_RESULT_INVALID_RATE;
+		return false;
+	}
+
+	// Find out which internal message ID we should use. If one isn't found,
+	// return an error.
+	int mid = _FindMessage(schedule, id);
+	if (mid == -1) {
+		schedule->LastResult = SCHED_RESULT_UNKNOWN_MESSAGE;
+		return false;
+	}
+
+	// Adding a message that's already scheduled replaces its old rate. The old one is remembered
+	// in case the new one can't be scheduled.
+	const uint16_t oldCount = schedule->Slots[mid].Count;
+	const uint16_t oldOffset = schedule->Slots[mid].Offset;
+	_RemoveRepeating(schedule, mid);
+
+	// Limit the rate to whatever is left of the per-second budget. This is done per cycle, so
+	// that the budget can be compared against the cycle's bytes without any rounding.
+	uint16_t newCount = count;
+	const uint16_t size = schedule->MessageSizes[mid];
+	if (schedule->SecondBudget && size) {
+		const uint64_t cycleBudget = (uint64_t)schedule->SecondBudget * schedule->TimestepCount / schedule->TimestepRate;
+		const uint32_t used = _CycleBytes(schedule);
+		const uint64_t left = used < cycleBudget ? cycleBudget - used : 0;
+		if (left / size < newCount) {
+			newCount = (uint16_t)(left / size);
+		}
+	}
+	ScheduleResult result = newCount ? SCHED_RESULT_OK : SCHED_RESULT_OVER_SECOND_BUDGET;
+
+	// Then find the highest rate that has an offset which fits within the per-timestep budget.
+	uint16_t offset = 0;
+	while (newCount && !_FindOffset(schedule, mid, newCount, &offset)) {
+		--newCount;
+		if (!newCount) {
+			result = SCHED_RESULT_OVER_TIMESTEP_BUDGET;
+		}
+	}
+
+	if (result != SCHED_RESULT_OK) {
+		if (oldCount) {
+			_PlaceRepeating(schedule, mid, oldCount, oldOffset);
+		}
+		schedule->LastResult = result;
+		return false;
+	}
+
+	// Finally add this message onto the list of messages to send using the
+	// best offset that was found.
+	_PlaceRepeating(schedule, mid, newCount, offset);
+	schedule->LastResult = newCount < count ? SCHED_RESULT_DOWNGRADED : SCHED_RESULT_OK;
+
+	return true;
+}
 
 bool AddMessageRepeating(MessageSchedule *schedule, uint8_t id, uint8_t rate)
 {
-	// Be sure that we only process messages are reasonable rates
-	if (rate < 1 || rate > 100) {
+	return AddMessageRepeatingMillihertz(schedule, id, (uint32_t)rate * 1000);
+}
+
+bool AddMessageRepeatingMillihertz(MessageSchedule *schedule, uint8_t id, uint32_t rate)
+{
+	// Convert the rate into transmissions per cycle, rounding to the nearest.
+	const uint64_t perMilliCycle = (uint64_t)rate * schedule->TimestepCount;
+	const uint32_t milliCycleRate = (uint32_t)schedule->TimestepRate * 1000;
+	const uint64_t count = (perMilliCycle + milliCycleRate / 2) / milliCycleRate;
+	if (rate > milliCycleRate || count > UINT16_MAX) {
+		schedule->LastResult = SCHED_RESULT_INVALID_RATE;
 		return false;
 	}
+	return _AddMessageRepeatingCount(schedule, id, (uint16_t)count);
+}
 
-	// Just store this for future use as it's used quite often.
-	const float period = 100.0/((float)rate);
-	
+// TODO: Only add this message between now and the next time this message is scheduled.
+// There's no reason to transmit this one-off message if it comes after a regularly scheduled
+// one.
+bool AddMessageOnce(MessageSchedule *schedule, uint8_t id, AddMethod method)
+{
 	// Find out which internal message ID we should use. If one isn't found,
 	// return an error.
+	int mid = _FindMessage(schedule, id);
+	if (mid == -1) {
+		schedule->LastResult = SCHED_RESULT_UNKNOWN_MESSAGE;
+		return false;
+	}
+	MessageScheduleSlot *slot = &schedule->Slots[mid];
+
+	// If this message is already waiting to go out, there's nothing more to do.
+	if (slot->TransientPending) {
+		schedule->LastResult = SCHED_RESULT_OK;
+		return true;
+	}
+
+	// Make sure there's room left in this second for it.
+	if (schedule->SecondBudget &&
+	    GetBps(schedule) + _PendingTransientBytes(schedule) + schedule->MessageSizes[mid] > schedule->SecondBudget) {
+		schedule->LastResult = SCHED_RESULT_OVER_SECOND_BUDGET;
+		return false;
+	}
+
+	// Find the timestep within the next second to transmit this message at, skipping any that
+	// don't have room for it.
+	const uint16_t window = _TransientWindow(schedule);
+	ScheduleResult result = SCHED_RESULT_OK;
+	uint16_t bestTimestep = schedule->CurrentTimestep;
+	bool found = false;
+	uint16_t i;
+	switch (method) {
+	case ADD_METHOD_BEST: {
+		// Select the smallest bracket.
+		uint32_t lastCost = UINT32_MAX;
+		for (i = 0; i < window; ++i) {
+			uint16_t testTimestep = (uint16_t)(((uint32_t)schedule->CurrentTimestep + i) % schedule->TimestepCount);
+			if (!_TransientFits(schedule, mid, testTimestep)) {
+				continue;
+			}
+
+			// Add up the cost of every message at this timestep. This time we count transient
+			// messages.
+			uint32_t currentCost = (uint32_t)schedule->TimestepBytes[testTimestep] +
+			                       _TransientBytes(schedule, testTimestep);
+
+			// Now if this is the best timestep, choose this one. If the cost is > 0, we keep searching
+			// for a lower-cost timestep.
+			if (currentCost == 0) {
+				bestTimestep = testTimestep;
+				found = true;
+				break;
+			} else if (currentCost < lastCost) {
+				bestTimestep = testTimestep;
+				lastCost = currentCost;
+				found = true;
+			}
+		}
+	} break;
+	case ADD_METHOD_LATEST:
+		// Select the last timestep and work backwards from there.
+		bestTimestep = (uint16_t)(((uint32_t)schedule->CurrentTimestep + window - 1) % schedule->TimestepCount);
+		for (i = 0; i < window && !found; ++i) {
+			if (_TransientFits(schedule, mid, bestTimestep)) {
+				found = true;
+			} else {
+				DECR_WRAP(schedule, bestTimestep);
+			}
+		}
+		break;
+	case ADD_METHOD_SOONEST:
+		// The current timestep is the next one to be dispatched, so work forwards from there.
+		for (i = 0; i < window && !found; ++i) {
+			if (_TransientFits(schedule, mid, bestTimestep)) {
+				found = true;
+			} else {
+				INCR_WRAP(schedule, bestTimestep);
+			}
+		}
+		break;
+	}
+	if (!found) {
+		schedule->LastResult = SCHED_RESULT_OVER_TIMESTEP_BUDGET;
+		return false;
+	}
+	if (method != ADD_METHOD_BEST && i > 1) {
+		result = SCHED_RESULT_DEFERRED;
+	}
+	schedule->LastResult = result;
+
+	// If this message is already being sent at that timestep, this would just be a duplicate.
+	if (_IsSentAt(schedule, slot, bestTimestep)) {
+		return true;
+	}
+
+	// Now that we have the best timestep to add this in, do it.
+	_PlaceTransient(schedule, mid, bestTimestep);
+
+	return true;
+}
+
+bool AddMessageUrgent(MessageSchedule *schedule, uint8_t id, uint8_t priority, uint16_t deadline)
+{
+	int mid = _FindMessage(schedule, id);
+	if (mid == -1) {
+		schedule->LastResult = SCHED_RESULT_UNKNOWN_MESSAGE;
+		return false;
+	}
+	MessageScheduleSlot *slot = &schedule->Slots[mid];
+	const uint16_t now = schedule->CurrentTimestep;
+	const uint16_t size = schedule->MessageSizes[mid];
+
+	// If this message is already going out with the next timestep, there's nothing more to do.
+	if (_IsSentAt(schedule, slot, now) ||
+	    (slot->TransientPending && slot->TransientStep == now)) {
+		schedule->LastResult = SCHED_RESULT_OK;
+		return true;
+	}
+
+	// A pending one-off transmission is just moved up, so it's already part of the per-second
+	// budget. Otherwise make sure there's room left in this second for it.
+	if (!slot->TransientPending && schedule->SecondBudget &&
+	    GetBps(schedule) + _PendingTransientBytes(schedule) + size > schedule->SecondBudget) {
+		schedule->LastResult = SCHED_RESULT_OVER_SECOND_BUDGET;
+		return false;
+	}
+
+	// If it doesn't fit with the next timestep, check if displacing lower-priority repetitions
+	// would make enough room before actually displacing any of them.
+	ScheduleResult result = SCHED_RESULT_OK;
+	uint16_t timestep = now;
+	if (schedule->TimestepBudget) {
+		uint32_t bytes = _NextTimestepBytes(schedule);
+		uint32_t displaceable = 0;
+		uint8_t entry = schedule->TimestepLists[now];
+		while (entry) {
+			const uint8_t emid = MSCHED_ENTRY_MID(entry);
+			const uint8_t type = MSCHED_ENTRY_TYPE(entry);
+			const MessageScheduleSlot *eslot = &schedule->Slots[emid];
+			if (type == MSCHED_REPEATING && emid != mid && !eslot->Displaced && eslot->Priority < priority) {
+				displaceable += schedule->MessageSizes[emid];
+			}
+			entry = eslot->Next[type];
+		}
+
+		if (bytes + size > schedule->TimestepBudget && bytes - displaceable + size <= schedule->TimestepBudget) {
+			while (bytes + size > schedule->TimestepBudget) {
+				const uint8_t dmid = (uint8_t)_FindDisplaceable(schedule, mid, priority);
+				bytes -= schedule->MessageSizes[dmid];
+				_DisplaceRepetition(schedule, dmid);
+			}
+			result = SCHED_RESULT_DISPLACED;
+		} else if (bytes + size > schedule->TimestepBudget) {
+			// Otherwise go out with the soonest timestep before the deadline that has room, which
+			// might be with a repetition of this message.
+			const uint16_t window = deadline < schedule->TimestepCount ? deadline : schedule->TimestepCount;
+			uint16_t i;
+			for (i = 1; i < window; ++i) {
+				INCR_WRAP(schedule, timestep);
+				if (_IsSentAt(schedule, slot, timestep) ||
+				    (slot->TransientPending && slot->TransientStep == timestep) ||
+				    _TransientFits(schedule, mid, timestep)) {
+					break;
+				}
+			}
+			if (i >= window) {
+				schedule->LastResult = SCHED_RESULT_MISSED_DEADLINE;
+				return false;
+			}
+			result = SCHED_RESULT_DEFERRED;
+		}
+	}
+	schedule->LastResult = result;
+
+	// Move any pending transmission to the chosen timestep, unless it'd be a duplicate.
+	if (slot->TransientPending && slot->TransientStep == timestep) {
+		return true;
+	}
+	_RemoveTransient(schedule, mid);
+	if (!_IsSentAt(schedule, slot, timestep)) {
+		_PlaceTransient(schedule, mid, timestep);
+	}
+
+	return true;
+}
+
+bool SetMessagePriority(MessageSchedule *schedule, uint8_t id, uint8_t priority)
+{
+	int mid = _FindMessage(schedule, id);
+	if (mid == -1) {
+		return false;
+	}
+	schedule->Slots[mid].Priority = priority;
+	return true;
+}
+
+void RemoveMessage(MessageSchedule *schedule, uint8_t id)
+{
+	// Find out which internal message ID we should use. If one isn't found,
+	// return an error.
+	int mid = _FindMessage(schedule, id);
+	if (mid == -1) {
+		return;
+	}
+	
+	// Now clear that message from the schedule.
+	_RemoveRepeating(schedule, mid);
+	_RemoveTransient(schedule, mid);
+}
+
+void ClearSchedule(MessageSchedule *schedule)
+{
+	// Remove all repeating and transient messages.
+	memset(schedule->TimestepLists, 0, schedule->TimestepCount * sizeof(schedule->TimestepLists[0]));
+	memset(schedule->TimestepBytes, 0, schedule->TimestepCount * sizeof(schedule->TimestepBytes[0]));
+	memset(schedule->Slots, 0, schedule->MessageTypes * sizeof(MessageScheduleSlot));
+
+	// And finally clear the current timestep. This concludes all state.
+	schedule->CurrentTimestep = 0;
+}
+
+uint8_t GetMessagesForTimestep(MessageSchedule *schedule, uint8_t *messages)
+{
+	// Take the whole list of messages for this timestep. Repeating messages are relinked onto the
+	// list for the timestep of their next repetition, which may be this one again in the next
+	// cycle, while transient messages are done with. A message is only in a single list as both a
+	// repeating and a transient entry if its repetition was displaced, so every message is transmit
+	// at most once per timestep.
+	const uint16_t timestep = schedule->CurrentTimestep;
+	uint8_t entry = schedule->TimestepLists[timestep];
+	schedule->TimestepLists[timestep] = 0;
+
+	uint8_t messageCount = 0;
+	while (entry) {
+		const uint8_t mid = MSCHED_ENTRY_MID(entry);
+		const uint8_t type = MSCHED_ENTRY_TYPE(entry);
+		MessageScheduleSlot *slot = &schedule->Slots[mid];
+		entry = slot->Next[type];
+
+		if (type == MSCHED_REPEATING) {
+			// A repetition that was displaced by an urgent message is skipped this time around.
+			if (slot->Displaced) {
+				slot->Displaced = false;
+			} else {
+				messages[messageCount++] = schedule->MessageIds[mid];
+			}
+			if (++slot->Occurrence >= slot->Count) {
+				slot->Occurrence = 0;
+			}
+			_PushEntry(schedule, _OccurrenceStep(schedule, slot, slot->Occurrence), MSCHED_ENTRY(mid, MSCHED_REPEATING));
+		} else {
+			messages[messageCount++] = schedule->MessageIds[mid];
+			slot->TransientPending = false;
+		}
+	}
+
+	// And finally increment the timestep
+	INCR_WRAP(schedule, schedule->CurrentTimestep);
+
+	return messageCount;
+}
+
+void ResetTimestep(MessageSchedule *schedule)
+{
+	schedule->CurrentTimestep = 0;
+
+	// Every repeating message now starts over at its first repetition, so rebuild the timestep
+	// lists from scratch.
+	memset(schedule->TimestepLists, 0, schedule->TimestepCount * sizeof(schedule->TimestepLists[0]));
+	uint8_t mid;
+	for (mid = 0; mid < schedule->MessageTypes; ++mid) {
+		MessageScheduleSlot *slot = &schedule->Slots[mid];
+		slot->Displaced = false;
+		if (slot->Count) {
+			slot->Occurrence = 0;
+			_PushEntry(schedule, slot->Offset, MSCHED_ENTRY(mid, MSCHED_REPEATING));
+		}
+		if (slot->TransientPending) {
+			_PushEntry(schedule, slot->TransientStep, MSCHED_ENTRY(mid, MSCHED_TRANSIENT));
+		}
+	}
+}
+
+uint32_t GetBps(const MessageSchedule *schedule)
+{
+    // We only count repeating messages as transient messages will disappear and
+    // not be a factor over the long-term.
+    return (uint32_t)((uint64_t)_CycleBytes(schedule) * schedule->TimestepRate / schedule->TimestepCount);
+}
+
+uint16_t GetTimestepSpareBytes(const MessageSchedule *schedule)
+{
+	if (!schedule->TimestepBudget) {
+		return UINT16_MAX;
+	}
+	const uint16_t bytes = _NextTimestepBytes(schedule);
+	return bytes < schedule->TimestepBudget ? schedule->TimestepBudget - bytes : 0;
+}
+
+uint32_t GetSpareBps(const MessageSchedule *schedule)
+{
+	if (!schedule->SecondBudget) {
+		return UINT32_MAX;
+	}
+	const uint32_t bps = GetBps(schedule);
+	return bps < schedule->SecondBudget ? schedule->SecondBudget - bps : 0;
+}
+
+ScheduleResult GetScheduleResult(const MessageSchedule *schedule)
+{
+	return schedule->LastResult;
+}
+
+/**
+ * Returns the estimated load of a single transmission of a message.
+ */
+static uint16_t _MessageLoad(const MessageSchedule *schedule, uint8_t mid)
+{
+	return schedule->MessageSizes[mid] + MSCHED_MESSAGE_COST;
+}
+
+/**
+ * Moves a repeating message to the offset where the worst timestep it's sent at has the lowest
+ * combined load, breaking ties by the lowest sum of squared loads so the rest are flattened too. Offsets that would exceed the schedule's
+ * per-timestep budget are skipped, and it's only moved if that's strictly better.
+ * @param load The combined load of every timestep, which is kept up to date.
+ * @return Whether the message was moved.
+ */
+static bool _RebalanceRepeating(MessageSchedule *schedule, uint8_t mid, uint16_t load[])
+{
+	MessageScheduleSlot *slot = &schedule->Slots[mid];
+	const uint16_t count = slot->Count;
+	const uint16_t oldOffset = slot->Offset;
+	const uint16_t size = schedule->MessageSizes[mid];
+	const uint16_t weight = _MessageLoad(schedule, mid);
+	const uint16_t period = schedule->TimestepCount / count;
+	uint16_t i;
+
+	// Take this message out of the schedule and the load so it doesn't compete with itself.
+	for (i = 0; i < count; i++) {
+		load[_OccurrenceStep(schedule, slot, i)] -= weight;
+	}
+	_RemoveRepeating(schedule, mid);
+
+	uint16_t bestOffset = oldOffset;
+	uint32_t bestPeak = UINT32_MAX;
+	uint64_t bestTotal = UINT64_MAX;
+	uint16_t offset;
+	slot->Count = count;
+	for (offset = 0; offset < period; offset++) {
+		slot->Offset = offset;
+		uint32_t peak = 0;
+		uint64_t total = 0;
+		for (i = 0; i < count; i++) {
+			const uint16_t step = _OccurrenceStep(schedule, slot, i);
+			if (schedule->TimestepBudget && (uint32_t)schedule->TimestepBytes[step] + size > schedule->TimestepBudget) {
+				break;
+			}
+			const uint32_t stepLoad = (uint32_t)load[step] + weight;
+			if (stepLoad > peak) {
+				peak = stepLoad;
+			}
+			total += (uint64_t)stepLoad * stepLoad;
+		}
+		if (i < count) {
+			continue;
+		}
+
+		// The current offset wins all ties, so messages only move when it actually helps.
+		if (peak < bestPeak || (peak == bestPeak && total < bestTotal) ||
+		    (peak == bestPeak && total == bestTotal && offset == oldOffset)) {
+			bestOffset = offset;
+			bestPeak = peak;
+			bestTotal = total;
+		}
+	}
+	slot->Count = 0;
+
+	_PlaceRepeating(schedule, mid, count, bestOffset);
+	for (i = 0; i < count; i++) {
+		load[_OccurrenceStep(schedule, slot, i)] += weight;
+	}
+
+	return bestOffset != oldOffset;
+}
+
+/**
+ * Returns the order that BalanceSchedules() places messages in, highest first. Messages sent more
+ * often have fewer offsets to choose from, so they go first, and then the heaviest of those.
+ */
+static uint32_t _BalanceOrder(const MessageSchedule *schedule, uint8_t mid)
+{
+	return ((uint32_t)schedule->Slots[mid].Count << 16) | _MessageLoad(schedule, mid);
+}
+
+void GetScheduleLoad(MessageSchedule *const schedules[], uint8_t scheduleCount, uint16_t load[])
+{
+	memset(load, 0, schedules[0]->TimestepCount * sizeof(load[0]));
+	uint8_t s;
+	for (s = 0; s < scheduleCount; ++s) {
+		const MessageSchedule *schedule = schedules[s];
+		uint8_t mid;
+		for (mid = 0; mid < schedule->MessageTypes; ++mid) {
+			const MessageScheduleSlot *slot = &schedule->Slots[mid];
+			uint16_t i;
+			for (i = 0; i < slot->Count; ++i) {
+				load[_OccurrenceStep(schedule, slot, i)] += _MessageLoad(schedule, mid);
+			}
+		}
+	}
+}
+
+bool BalanceSchedules(MessageSchedule *const schedules[], uint8_t scheduleCount, uint16_t load[])
+{
+	// The load can only be combined timestep by timestep if every schedule shares the same timebase.
+	uint8_t s;
+	for (s = 1; s < scheduleCount; ++s) {
+		if (schedules[s]->TimestepCount != schedules[0]->TimestepCount ||
+		    schedules[s]->TimestepRate != schedules[0]->TimestepRate) {
+			return false;
+		}
+	}
+	if (!scheduleCount) {
+		return true;
+	}
+
+	GetScheduleLoad(schedules, scheduleCount, load);
+
+	// Every pass moves each message to its best offset given all of the others, in the order given
+	// by _BalanceOrder(). No move can raise the peak load, so this stops once a pass doesn't move
+	// anything.
+	uint8_t pass;
+	for (pass = 0; pass < MSCHED_BALANCE_PASSES; ++pass) {
+		bool moved = false;
+		uint32_t order = UINT32_MAX;
+		for (;;) {
+			// Find the next message in the order.
+			uint32_t next = 0;
+			for (s = 0; s < scheduleCount; ++s) {
+				uint8_t mid;
+				for (mid = 0; mid < schedules[s]->MessageTypes; ++mid) {
+					const uint32_t o = _BalanceOrder(schedules[s], mid);
+					if (schedules[s]->Slots[mid].Count && o < order && o > next) {
+						next = o;
+					}
+				}
+			}
+			if (!next) {
+				break;
+			}
+			order = next;
+
+			// And rebalance every message that's equal in the order.
+			for (s = 0; s < scheduleCount; ++s) {
+				uint8_t mid;
+				for (mid = 0; mid < schedules[s]->MessageTypes; ++mid) {
+					if (schedules[s]->Slots[mid].Count && _BalanceOrder(schedules[s], mid) == order) {
+						moved |= _RebalanceRepeating(schedules[s], mid, load);
+					}
+				}
+			}
+		}
+		if (!moved) {
+			break;
+		}
+	}
+
+	return true;
+}
+
+#ifdef UNIT_TEST
+#include <stdio.h>
+#include <assert.h>
+#include <time.h>
+
+/**
+ * This function prints out all of the messages for every timestep. Useful for debugging with
+ * gdb when it can be called at any point manually via `call PrintAllTimesteps(&sched)`. Otherwise
+ * this function isn't used by any code.
+ */
+void PrintAllTimesteps(const MessageSchedule *schedule)
+{
+	puts("schedule->Timesteps:\n");
+	uint16_t t;
+	for (t = 0; t < schedule->TimestepCount; ++t) {
+		printf("%2d (%3d bytes):", t, schedule->TimestepBytes[t]);
+		uint8_t mid;
+		for (mid = 0; mid < schedule->MessageTypes; ++mid) {
+			if (_IsOccurrence(schedule, &schedule->Slots[mid], t)) {
+				printf(" %d", schedule->MessageIds[mid]);
+			}
+		}
+		putchar('\n');
+	}
+}
+
+/**
+ * Prints the combined load of every timestep of several schedules sharing a timebase, along with
+ * the worst-case bytes, messages, and load of any single timestep. This is the host-side view of
+ * what BalanceSchedules() is trying to flatten.
+ * @return The peak load.
+ */
+uint16_t PrintLoadProfile(const char *label, MessageSchedule *const schedules[], uint8_t scheduleCount)
+{
+	const uint16_t steps = schedules[0]->TimestepCount;
+	uint16_t load[steps];
+	GetScheduleLoad(schedules, scheduleCount, load);
+
+	uint32_t peakBytes = 0, peakLoad = 0, peakMessages = 0, total = 0;
+	uint16_t t;
+	for (t = 0; t < steps; ++t) {
+		uint32_t bytes = 0, messages = 0;
+		uint8_t s;
+		for (s = 0; s < scheduleCount; ++s) {
+			bytes += schedules[s]->TimestepBytes[t];
+			uint8_t mid;
+			for (mid = 0; mid < schedules[s]->MessageTypes; ++mid) {
+				messages += _IsOccurrence(schedules[s], &schedules[s]->Slots[mid], t);
+			}
+		}
+		// The load is exactly the bytes plus the fixed cost of every message.
+		assert(load[t] == bytes + messages * MSCHED_MESSAGE_COST);
+		peakBytes = bytes > peakBytes ? bytes : peakBytes;
+		peakMessages = messages > peakMessages ? messages : peakMessages;
+		peakLoad = load[t] > peakLoad ? load[t] : peakLoad;
+		total += load[t];
+	}
+
+	printf("%s: peak %u bytes, %u messages, %u load (mean %.1f) per timestep\n", label,
+	       (unsigned)peakBytes, (unsigned)peakMessages, (unsigned)peakLoad, (double)total / steps);
+	for (t = 0; t < steps; ++t) {
+		printf("%4u%c", load[t], (t % 20 == 19 || t == steps - 1) ? '\n' : ' ');
+	}
+	return (uint16_t)peakLoad;
+}
+
+/**
+ * The original bitfield-based scheduler, kept here only as a baseline for BenchmarkScheduler().
+ * Every message has a 100-bit field marking the timesteps it's sent at, so dispatching a timestep
+ * needs to test a bit for every message type.
+ */
+typedef struct {
+	uint8_t MessageTypes;
+	uint8_t *MessageIds;
+	uint8_t *MessageSizes;
+	uint8_t CurrentTimestep;
+	uint16_t (*Timesteps)[8];
+} BitfieldSchedule;
+
+bool BitfieldAddMessageRepeating(BitfieldSchedule *schedule, uint8_t id, uint8_t rate)
+{
+	const float period = 100.0/((float)rate);
 	int mid = -1;
 	int i;
 	for (i = 0; i < schedule->MessageTypes; ++i) {
@@ -45,17 +1009,6 @@ bool AddMessageRepeating(MessageSchedule *schedule, uint8_t id, uint8_t rate)
 		return false;
 	}
 
-	//TODO: Add a verification step that this message can even be safely added.
-	// This would require knowing the size of the new message and then comparing
-	// the integral of all timestep bytes with MESSAGE_TRANSMISSION_RATE. If it's
-	// over the top we should return a failure.
-	
-	// Now find a decent offset for this message to use for its transfer rate.
-	// We first go through every possible offset and determine which one provides
-	// the emptiest channel for transmission based on total bytes sent during that
-	// transmission	window.
-	
-	// So we search through every offset and check the number of bytes transmit in a given offset.
 	uint8_t bestOffset = 0;
 	uint16_t lastCost = USHRT_MAX;
 	uint8_t offset;
@@ -66,272 +1019,468 @@ bool AddMessageRepeating(MessageSchedule *schedule, uint8_t id, uint8_t rate)
 		for (i = 0; i < rate && timestep < 100; timestep += period, i++) {
 			int currentTimestepWord = (timestep & 0x70) >> 4;
 			uint16_t timestepIndex = 1 << (timestep & 0x0F);
-			// Add up the cost of every message at this timestep
 			uint16_t j;
 			for	(j = 0; j < schedule->MessageTypes; ++j) {
-				// We only count repeating messages as transient messages will disappear and
-				// not be a factor over the long-term.
-				if (schedule->Timesteps[j][MSCHED_REPEATING][currentTimestepWord] & timestepIndex) {
+				if (schedule->Timesteps[j][currentTimestepWord] & timestepIndex) {
 					currentCost += schedule->MessageSizes[j];
 				}
 			}
 		}
-		// If we've found a better offset, store it.
 		if (currentCost < lastCost) {
 			bestOffset = offset;
 			lastCost = currentCost;
 		}
 	}
-	
-	// Finally add this message onto the list of messages to send using the
-	// best offset that was found.
+
 	uint8_t timestep = bestOffset;
 	for (i = 0; i < rate && timestep < 100; timestep += period, i++) {
 		int currentTimestepWord = (timestep & 0x70) >> 4;
 		uint16_t timestepIndex = 1 << (timestep & 0x0F);
-		schedule->Timesteps[mid][MSCHED_REPEATING][currentTimestepWord] |= timestepIndex;
+		schedule->Timesteps[mid][currentTimestepWord] |= timestepIndex;
 	}
 
 	return true;
 }
 
-// TODO: Only add this message between now and the next time this message is scheduled.
-// There's no reason to transmit this one-off message if it comes after a regularly scheduled
-// one. Really I should just add these as long as it's below the bandwidth limit for a single
-// timestep.
-bool AddMessageOnce(MessageSchedule *schedule, uint8_t id, AddMethod method)
+uint8_t BitfieldGetMessagesForTimestep(BitfieldSchedule *schedule, uint8_t *messages)
 {
-	// Find out which internal message ID we should use. If one isn't found,
-	// return an error.
-	int mid = -1;
+	uint8_t messageCount = 0;
+	int currentTimestepWord = (schedule->CurrentTimestep & 0x70) >> 4;
+	uint16_t timestepIndex = 1 << (schedule->CurrentTimestep & 0x0F);
 	int i;
 	for (i = 0; i < schedule->MessageTypes; ++i) {
-		if (schedule->MessageIds[i] == id) {
-			mid = i;
-			break;
+		if (schedule->Timesteps[i][currentTimestepWord] & timestepIndex) {
+			messages[messageCount++] = schedule->MessageIds[i];
 		}
 	}
-	if (mid == -1) {
-		return false;
-	}
-
-	// Find the smallest bracket in the next second to transmit this message
-        uint8_t bestTimestep = 0;
-        switch (method) {
-        case ADD_METHOD_BEST: {
-                uint16_t lastCost = USHRT_MAX;
-                for (i = 0; i < 100; ++i) {
-                        uint8_t testTimestep = (schedule->CurrentTimestep + i) % 100;
-                        int currentTimestepWord = (testTimestep & 0x70) >> 4;
-                        uint16_t timestepIndex = 1 << (testTimestep & 0x0F);
-                        // Add up the cost of every message at this timestep. This time we count transient
-                        // messages.
-                        uint16_t j;
-                        uint16_t currentCost = 0;
-                        for	(j = 0; j < schedule->MessageTypes; ++j) {
-                                if ((schedule->Timesteps[j][MSCHED_REPEATING][currentTimestepWord] |
-                                        schedule->Timesteps[j][MSCHED_TRANSIENT][currentTimestepWord]) &
-                                        timestepIndex) {
-                                        currentCost += schedule->MessageSizes[j];
-                                }
-                        }
-
-                        // Now if this is the best timestep, choose this one. If the cost is > 0, we keep searching
-                        // for a lower-cost timestep.
-                        if (currentCost == 0) {
-                                bestTimestep = testTimestep;
-                                break;
-                        } else if (currentCost < lastCost) {
-                                bestTimestep = testTimestep;
-                                lastCost = currentCost;
-                        }
-                }
-            } break;
-        case ADD_METHOD_LATEST:
-            DECR_WRAP_TO_99(schedule->CurrentTimestep);
-            break;
-        case ADD_METHOD_SOONEST:
-            INCR_WRAP_TO_99(schedule->CurrentTimestep);
-            break;
-        }
-	
-	// Now that we have the best timestep to add this in, do it.
-	int currentTimestepWord = (bestTimestep & 0x70) >> 4;
-	uint16_t timestepIndex = 1 << (bestTimestep & 0x0F);
-	schedule->Timesteps[mid][MSCHED_TRANSIENT][currentTimestepWord] |= timestepIndex;
-
-	return true;
+	schedule->CurrentTimestep = schedule->CurrentTimestep >= 99 ? 0 : schedule->CurrentTimestep + 1;
+	return messageCount;
 }
 
-void RemoveMessage(MessageSchedule *schedule, uint8_t id)
+/**
+ * A channel budget to test the Primary node's MAVLink schedules against.
+ */
+typedef struct {
+	const char *name;
+	uint32_t bytesPerSecond;
+	uint16_t bytesPerTimestep;
+} TestChannel;
+
+/**
+ * Adds every message in a MAVLink configuration to a schedule limited to the given channel and
+ * then checks that the resulting schedule actually stays within its budgets when dispatched. The
+ * outcome of every message is stored in `results`.
+ * @param rates The requested rate of every message. 0 means it isn't added.
+ */
+static void TestChannelBudget(MessageSchedule *sched, const uint8_t *rates, const TestChannel *channel, ScheduleResult *results)
 {
-	// Find out which internal message ID we should use. If one isn't found,
-	// return an error.
-	int mid = -1;
-	int i;
-	for (i = 0; i < schedule->MessageTypes; ++i) {
-		if (schedule->MessageIds[i] == id) {
-			mid = i;
-			break;
+	ClearSchedule(sched);
+	SetScheduleBudget(sched, channel->bytesPerSecond, channel->bytesPerTimestep);
+	uint8_t i;
+	uint8_t ok = 0, downgraded = 0, refused = 0;
+	for (i = 0; i < sched->MessageTypes; ++i) {
+		results[i] = SCHED_RESULT_OK;
+		if (rates[i]) {
+			bool added = AddMessageRepeating(sched, sched->MessageIds[i], rates[i]);
+			results[i] = GetScheduleResult(sched);
+			assert(added == (results[i] == SCHED_RESULT_OK || results[i] == SCHED_RESULT_DOWNGRADED));
+			if (results[i] == SCHED_RESULT_OK) {
+				assert(sched->Slots[i].Count == rates[i]);
+				++ok;
+			} else if (results[i] == SCHED_RESULT_DOWNGRADED) {
+				assert(sched->Slots[i].Count < rates[i]);
+				++downgraded;
+			} else {
+				assert(sched->Slots[i].Count == 0);
+				++refused;
+			}
 		}
 	}
-	if (mid == -1) {
-		return;
+
+	// Now run a whole second, checking every timestep against its budget and that every message
+	// goes out at the rate it was scheduled at.
+	uint8_t counts[256] = {};
+	uint16_t peak = 0;
+	uint8_t t;
+	for (t = 0; t < sched->TimestepCount; ++t) {
+		uint8_t msgs[32];
+		uint16_t bytes = 0;
+		uint8_t count = GetMessagesForTimestep(sched, msgs);
+		while (count) {
+			uint8_t id = msgs[--count];
+			++counts[id];
+			uint8_t j;
+			for (j = 0; sched->MessageIds[j] != id; ++j);
+			bytes += sched->MessageSizes[j];
+		}
+		assert(bytes == sched->TimestepBytes[t]);
+		assert(bytes <= channel->bytesPerTimestep);
+		if (bytes > peak) {
+			peak = bytes;
+		}
 	}
-	
-	// Now clear that message from the schedule.
-	schedule->Timesteps[mid][MSCHED_REPEATING][0] = 0;
-	schedule->Timesteps[mid][MSCHED_REPEATING][1] = 0;
-	schedule->Timesteps[mid][MSCHED_REPEATING][2] = 0;
-	schedule->Timesteps[mid][MSCHED_REPEATING][3] = 0;
-	schedule->Timesteps[mid][MSCHED_REPEATING][4] = 0;
-	schedule->Timesteps[mid][MSCHED_REPEATING][5] = 0;
-	schedule->Timesteps[mid][MSCHED_REPEATING][6] = 0;
-	schedule->Timesteps[mid][MSCHED_REPEATING][7] = 0;
-	schedule->Timesteps[mid][MSCHED_TRANSIENT][0] = 0;
-	schedule->Timesteps[mid][MSCHED_TRANSIENT][1] = 0;
-	schedule->Timesteps[mid][MSCHED_TRANSIENT][2] = 0;
-	schedule->Timesteps[mid][MSCHED_TRANSIENT][3] = 0;
-	schedule->Timesteps[mid][MSCHED_TRANSIENT][4] = 0;
-	schedule->Timesteps[mid][MSCHED_TRANSIENT][5] = 0;
-	schedule->Timesteps[mid][MSCHED_TRANSIENT][6] = 0;
-	schedule->Timesteps[mid][MSCHED_TRANSIENT][7] = 0;
+	for (i = 0; i < sched->MessageTypes; ++i) {
+		assert(counts[sched->MessageIds[i]] == sched->Slots[i].Count);
+	}
+	assert(GetBps(sched) <= channel->bytesPerSecond);
+
+	printf("%-20s | %2u | %2u | %2u | %5u / %5u | %3u / %3u\n", channel->name, ok, downgraded, refused,
+	       GetBps(sched), channel->bytesPerSecond, peak, channel->bytesPerTimestep);
 }
 
-void ClearSchedule(MessageSchedule *schedule)
+// How a simulated mission upload queues its replies.
+typedef enum {
+	SIM_REPLY_DIRECT,  // Written straight to the UART, bypassing the schedule, as it used to be.
+	SIM_REPLY_BEST,    // AddMessageOnce() with ADD_METHOD_BEST.
+	SIM_REPLY_SOONEST, // AddMessageOnce() with ADD_METHOD_SOONEST.
+	SIM_REPLY_URGENT   // AddMessageUrgent().
+} SimReplyMethod;
+
+/**
+ * Simulates uploading a mission of `items` waypoints to the primary node while its 18-message
+ * groundstation schedule keeps sending telemetry over the 64kbps radio. Every 10ms the radio sends
+ * 32 bytes out of the UART's queue. The groundstation answers every MISSION_REQUEST with a
+ * MISSION_ITEM that arrives 50ms after the request was sent, and the upload ends once the final
+ * MISSION_ACK has been sent.
+ * @param telemetrySkipped Set to the number of telemetry repetitions that weren't sent.
+ * @param peakBytes Set to the most bytes written to the UART in a single timestep.
+ * @return The upload time in timesteps.
+ */
+static uint16_t SimulateMissionUpload(SimReplyMethod method, uint16_t timestepBudget, uint8_t items,
+                                      uint16_t *telemetrySkipped, uint16_t *peakBytes)
 {
-	// Remove all repeating and transient messages.
+	// The groundstation schedule along with the MISSION_REQUEST and MISSION_ACK replies.
+	enum { REQUEST = 40, ACK = 47, LINK_BYTES_PER_TIMESTEP = 32, ITEM_DELAY = 5 };
+	uint8_t lists[MSCHED_DEFAULT_TIMESTEPS] = {};
+	uint16_t bytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+	MessageScheduleSlot slots[20] = {};
+	uint8_t ids[20] = {0, 1, 2, 32, 30, 24, 160, 175, 150, 161, 172, 163, 173, 174, 165, 109, 74, 62, REQUEST, ACK};
+	uint8_t sizes[20] = {17, 39, 20, 36, 36, 38, 28, 50, 17, 20, 20, 12, 50, 40, 50, 17, 28, 34, 12, 11};
+	const uint8_t rates[18] = {2, 2, 1, 5, 4, 4, 1, 1, 1, 1, 2, 0, 1, 1, 1, 0, 5, 2};
+	MessageSchedule sched = {
+		20,
+		ids,
+		sizes,
+		0,
+		MSCHED_DEFAULT_TIMESTEPS,
+		MSCHED_DEFAULT_TIMESTEP_RATE,
+		lists,
+		bytes,
+		slots
+	};
+	SetScheduleBudget(&sched, 64000 / 10 / 2 * 80 / 100, timestepBudget);
 	uint8_t i;
-	for (i = 0; i < schedule->MessageTypes; ++i) {
-		schedule->Timesteps[i][MSCHED_REPEATING][0] = 0;
-		schedule->Timesteps[i][MSCHED_REPEATING][1] = 0;
-		schedule->Timesteps[i][MSCHED_REPEATING][2] = 0;
-		schedule->Timesteps[i][MSCHED_REPEATING][3] = 0;
-		schedule->Timesteps[i][MSCHED_REPEATING][4] = 0;
-		schedule->Timesteps[i][MSCHED_REPEATING][5] = 0;
-		schedule->Timesteps[i][MSCHED_REPEATING][6] = 0;
-		schedule->Timesteps[i][MSCHED_REPEATING][7] = 0;
-		schedule->Timesteps[i][MSCHED_TRANSIENT][0] = 0;
-		schedule->Timesteps[i][MSCHED_TRANSIENT][1] = 0;
-		schedule->Timesteps[i][MSCHED_TRANSIENT][2] = 0;
-		schedule->Timesteps[i][MSCHED_TRANSIENT][3] = 0;
-		schedule->Timesteps[i][MSCHED_TRANSIENT][4] = 0;
-		schedule->Timesteps[i][MSCHED_TRANSIENT][5] = 0;
-		schedule->Timesteps[i][MSCHED_TRANSIENT][6] = 0;
-		schedule->Timesteps[i][MSCHED_TRANSIENT][7] = 0;
+	for (i = 0; i < 18; i++) {
+		if (rates[i]) {
+			assert(AddMessageRepeating(&sched, ids[i], rates[i]));
+		}
 	}
 
-	// And finally clear the current timestep. This concludes all state.
-	schedule->CurrentTimestep = 0;
+	// Track the bytes written to and sent from the UART, and when the last reply will have been
+	// sent in full.
+	uint32_t written = 0, sent = 0, replySent = 0;
+	uint16_t itemArrives = 0, scheduled = 0, telemetry = 0;
+	uint8_t seq = 0;
+	uint8_t reply = 0;
+	*peakBytes = 0;
+	uint16_t tick;
+	for (tick = 0; tick < UINT16_MAX; tick++) {
+		uint16_t tickBytes = 0;
+
+		// The MISSION_COUNT, and then every MISSION_ITEM, is answered with the next request or the
+		// final ACK.
+		if (tick == itemArrives) {
+			reply = seq++ < items ? REQUEST : ACK;
+			const uint8_t size = sizes[reply == REQUEST ? 18 : 19];
+			switch (method) {
+			case SIM_REPLY_DIRECT:
+				written += size;
+				tickBytes += size;
+				replySent = written;
+				break;
+			case SIM_REPLY_BEST:
+				assert(AddMessageOnce(&sched, reply, ADD_METHOD_BEST));
+				break;
+			case SIM_REPLY_SOONEST:
+				assert(AddMessageOnce(&sched, reply, ADD_METHOD_SOONEST));
+				break;
+			case SIM_REPLY_URGENT:
+				assert(AddMessageUrgent(&sched, reply, 1, 1));
+				break;
+			}
+		}
+
+		// Then the telemetry, with the reply if it was scheduled.
+		for (i = 0; i < 18; i++) {
+			scheduled += _IsOccurrence(&sched, &slots[i], sched.CurrentTimestep);
+		}
+		uint8_t msgs[20];
+		const uint8_t count = GetMessagesForTimestep(&sched, msgs);
+		uint8_t j;
+		for (j = 0; j < count; j++) {
+			const uint8_t id = msgs[j];
+			uint8_t mid;
+			for (mid = 0; ids[mid] != id; mid++);
+			written += sizes[mid];
+			tickBytes += sizes[mid];
+			if (id == reply) {
+				replySent = written;
+			} else {
+				telemetry++;
+			}
+		}
+		if (tickBytes > *peakBytes) {
+			*peakBytes = tickBytes;
+		}
+
+		// And the radio sends what it can.
+		sent = sent + LINK_BYTES_PER_TIMESTEP < written ? sent + LINK_BYTES_PER_TIMESTEP : written;
+		if (replySent && sent >= replySent) {
+			replySent = 0;
+			if (reply == ACK) {
+				break;
+			}
+			itemArrives = tick + ITEM_DELAY;
+		}
+	}
+	// Displaced telemetry that's made up for later can be sent more often than it was scheduled.
+	*telemetrySkipped = scheduled > telemetry ? scheduled - telemetry : 0;
+	return tick + 1;
 }
 
-uint8_t GetMessagesForTimestep(MessageSchedule *schedule, uint8_t *messages)
+/**
+ * Checks every rate from 0.05Hz to 500Hz that a schedule with the given timestep rate supports and
+ * then benchmarks it with all of them scheduled at once. The schedule uses a 20s cycle so that the
+ * slowest rate is sent once a cycle. Every rate is checked to be sent exactly as often as it should
+ * be, with its repetitions never more than a timestep away from being evenly spaced, while sharing
+ * the schedule with some other traffic.
+ */
+static void TestTimebase(uint16_t timestepRate)
 {
-	/// First clean up any non-recurring messages from the previous timestep.
-	// Determine what the previous timestep was
-	uint8_t cleanupTimestep;
-	if (schedule->CurrentTimestep == 0) {
-		cleanupTimestep = 99;
-	} else {
-		cleanupTimestep = schedule->CurrentTimestep - 1;
+	static const uint32_t rates[] = {50, 100, 200, 300, 1000, 3000, 7000, 25000, 100000, 333000, 500000};
+	const uint8_t numRates = sizeof(rates) / sizeof(rates[0]);
+	const uint16_t cycle = 20;
+	const uint16_t timesteps = timestepRate * cycle;
+	uint8_t *lists = (uint8_t*)calloc(timesteps, sizeof(uint8_t));
+	uint16_t *bytes = (uint16_t*)calloc(timesteps, sizeof(uint16_t));
+	uint8_t ids[16];
+	uint8_t sizes[16];
+	MessageScheduleSlot slots[16];
+	uint8_t i;
+	for (i = 0; i < 16; i++) {
+		ids[i] = i;
+		sizes[i] = 10 + i;
 	}
+	MessageSchedule sched = {
+		16,
+		ids,
+		sizes,
+		0,
+		timesteps,
+		timestepRate,
+		lists,
+		bytes,
+		slots
+	};
+	uint16_t *last = (uint16_t*)malloc(16 * sizeof(uint16_t));
+	uint16_t *first = (uint16_t*)malloc(16 * sizeof(uint16_t));
+	uint16_t *counts = (uint16_t*)malloc(16 * sizeof(uint16_t));
+	uint16_t *minGap = (uint16_t*)malloc(16 * sizeof(uint16_t));
+	uint16_t *maxGap = (uint16_t*)malloc(16 * sizeof(uint16_t));
 
-	// Now clear all transients for the last timestep. A check isn't performed
-	// as it's probably faster just to clear them all instead.
-	int i;
-	int currentTimestepWord = (cleanupTimestep & 0x70) >> 4;
-	uint16_t timestepIndex = 1 << (cleanupTimestep & 0x0F);
-	for (i = 0; i < schedule->MessageTypes; ++i) {
-		schedule->Timesteps[i][MSCHED_TRANSIENT][currentTimestepWord] &= ~timestepIndex;
+	// Check each rate on its own alongside a 1Hz and a 0.1Hz message.
+	for (i = 0; i < numRates; i++) {
+		ClearSchedule(&sched);
+		memset(slots, 0, sizeof(slots));
+		assert(AddMessageRepeating(&sched, 14, 1));
+		assert(AddMessageRepeatingMillihertz(&sched, 15, 100));
+		if (rates[i] > (uint32_t)timestepRate * 1000) {
+			assert(!AddMessageRepeatingMillihertz(&sched, 0, rates[i]));
+			assert(GetScheduleResult(&sched) == SCHED_RESULT_INVALID_RATE);
+			continue;
+		}
+		assert(AddMessageRepeatingMillihertz(&sched, 0, rates[i]));
+
+		// Run two cycles, measuring the gaps between repetitions during the second one.
+		memset(counts, 0, 16 * sizeof(uint16_t));
+		uint32_t t;
+		for (t = 0; t < 2UL * timesteps; t++) {
+			uint8_t msgs[16];
+			uint8_t count = GetMessagesForTimestep(&sched, msgs);
+			while (count) {
+				uint8_t id = msgs[--count];
+				if (id != 0 || t < timesteps) {
+					continue;
+				}
+				uint16_t step = (uint16_t)(t - timesteps);
+				if (counts[0]) {
+					uint16_t gap = step - last[0];
+					if (counts[0] == 1 || gap < minGap[0]) {
+						minGap[0] = gap;
+					}
+					if (counts[0] == 1 || gap > maxGap[0]) {
+						maxGap[0] = gap;
+					}
+				} else {
+					first[0] = step;
+				}
+				last[0] = step;
+				++counts[0];
+			}
+		}
+		assert(counts[0] == rates[i] * cycle / 1000);
+		if (counts[0] > 1) {
+			// Include the gap wrapping around into the next cycle.
+			uint16_t gap = timesteps - last[0] + first[0];
+			if (gap < minGap[0]) {
+				minGap[0] = gap;
+			}
+			if (gap > maxGap[0]) {
+				maxGap[0] = gap;
+			}
+			assert(maxGap[0] - minGap[0] <= 1);
+		}
 	}
 
-	// Finally return the logged data for this current timestep. We check both the repeating
-	// and the transient timesteps and add a message if it occurs in either. This prevents
-	// duplicate message transmission during a single timestep. This means the most messages that
-	// can be transmit during a single timestep is 1 of every message, which seems a reasonable
-	// limit.
-	uint8_t messageCount = 0;
-	currentTimestepWord = (schedule->CurrentTimestep & 0x70) >> 4;
-	timestepIndex = 1 << (schedule->CurrentTimestep & 0x0F);
-	for (i = 0; i < schedule->MessageTypes; ++i) {
-		if ((schedule->Timesteps[i][MSCHED_REPEATING][currentTimestepWord] | 
-		    schedule->Timesteps[i][MSCHED_TRANSIENT][currentTimestepWord]) & 
-			timestepIndex) {
-			messages[messageCount++] = schedule->MessageIds[i];
+	// Then benchmark adding and dispatching all of the rates at once.
+	const uint16_t builds = 50;
+	uint16_t n;
+	clock_t start = clock();
+	uint8_t added = 0;
+	for (n = 0; n < builds; n++) {
+		ClearSchedule(&sched);
+		added = 0;
+		for (i = 0; i < numRates; i++) {
+			if (rates[i] <= (uint32_t)timestepRate * 1000) {
+				assert(AddMessageRepeatingMillihertz(&sched, i, rates[i]));
+				++added;
+			}
 		}
 	}
+	double addNs = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / builds / added;
 
-	// And finally increment the timestep
-	if (schedule->CurrentTimestep == 99) {
-		schedule->CurrentTimestep = 0;
-	} else {
-		++schedule->CurrentTimestep;
+	const uint32_t ticks = 2000000;
+	uint32_t t, total = 0;
+	start = clock();
+	for (t = 0; t < ticks; t++) {
+		uint8_t msgs[16];
+		total += GetMessagesForTimestep(&sched, msgs);
 	}
+	double tickNs = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / ticks;
 
-	return messageCount;
-}
+	// The expected messages per tick is the sum of the rates over the timestep rate.
+	uint32_t expected = 0;
+	for (i = 0; i < numRates; i++) {
+		if (rates[i] <= (uint32_t)timestepRate * 1000) {
+			expected += rates[i] * cycle / 1000;
+		}
+	}
+	assert((uint64_t)total * timesteps / ticks <= expected + 1);
 
-void ResetTimestep(MessageSchedule *schedule)
-{
-	schedule->CurrentTimestep = 0;
+	printf("%5u | %5u | %6u | %5u | %7.1f | %5.1f\n", timestepRate, timesteps,
+	       (unsigned)(timesteps * (sizeof(uint8_t) + sizeof(uint16_t)) + sizeof(slots)), added, addNs, tickNs);
+
+	free(lists);
+	free(bytes);
+	free(last);
+	free(first);
+	free(counts);
+	free(minGap);
+	free(maxGap);
 }
 
 /**
- * Calculate the Hamming distance for a 16-bit number.
- * @param i The number to analyze
- * @return The number of bits that are set.
+ * Time scheduling and then dispatching `types` message types with both the bitfield and the list
+ * schedulers. The rates and sizes are a spread of typical telemetry values. Both schedulers are
+ * checked to transmit every message exactly `rate` times a cycle.
  */
-uint16_t _HammingDistance(uint16_t i)
-{
-     i = i - ((i >> 1) & 0x55555555);
-     i = (i & 0x33333333) + ((i >> 2) & 0x33333333);
-     return (((i + (i >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
-}
-
-uint32_t GetBps(const MessageSchedule *schedule)
+static void BenchmarkScheduler(uint8_t types)
 {
-    uint32_t total = 0;
-
-    uint16_t mid;
-    for (mid = 0; mid < schedule->MessageTypes; ++mid) {
-        // Calculate the size of this message
-        const uint16_t size = schedule->MessageSizes[mid];
+	static const uint8_t rates[] = {1, 1, 2, 2, 4, 5, 10, 25, 50};
+	uint8_t ids[MSCHED_MAX_MESSAGE_TYPES];
+	uint8_t sizes[MSCHED_MAX_MESSAGE_TYPES];
+	uint8_t msgRates[MSCHED_MAX_MESSAGE_TYPES];
+	uint8_t counts[256];
+	uint8_t msgs[MSCHED_MAX_MESSAGE_TYPES];
+	uint32_t seed = 12345;
+	uint8_t i;
+	for (i = 0; i < types; ++i) {
+		seed = seed * 1103515245 + 12345;
+		ids[i] = 255 - i;
+		sizes[i] = 9 + (seed >> 16) % 28;
+		msgRates[i] = rates[(seed >> 8) % sizeof(rates)];
+	}
 
-        // We only count repeating messages as transient messages will disappear and
-        // not be a factor over the long-term.
-        uint8_t i;
-        for (i = 0; i < 8; ++i) {
-            total += size * _HammingDistance(schedule->Timesteps[mid][MSCHED_REPEATING][i]);
-        }
-    }
+	uint16_t bitfields[MSCHED_MAX_MESSAGE_TYPES][8];
+	BitfieldSchedule oldSched = {types, ids, sizes, 0, bitfields};
+	uint8_t tstepLists[MSCHED_DEFAULT_TIMESTEPS];
+	uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS];
+	MessageScheduleSlot slots[MSCHED_MAX_MESSAGE_TYPES];
+	MessageSchedule newSched = {
+		types, ids, sizes, 0,
+		MSCHED_DEFAULT_TIMESTEPS, MSCHED_DEFAULT_TIMESTEP_RATE, tstepLists, tstepBytes,
+		slots
+	};
 
-    return total;
-}
+	// Time building the whole schedule.
+	const uint32_t builds = 2000;
+	uint32_t n;
+	clock_t start = clock();
+	for (n = 0; n < builds; ++n) {
+		memset(bitfields, 0, sizeof(bitfields));
+		for (i = 0; i < types; ++i) {
+			BitfieldAddMessageRepeating(&oldSched, ids[i], msgRates[i]);
+		}
+	}
+	double oldAdd = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / builds / types;
+	start = clock();
+	for (n = 0; n < builds; ++n) {
+		ClearSchedule(&newSched);
+		for (i = 0; i < types; ++i) {
+			AddMessageRepeating(&newSched, ids[i], msgRates[i]);
+		}
+	}
+	double newAdd = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / builds / types;
 
-#ifdef UNIT_TEST
-#include <stdio.h>
-#include <assert.h>
-#include <stdio.h>
+	// Check that both transmit every message at its rate.
+	memset(counts, 0, sizeof(counts));
+	for (n = 0; n < MSCHED_DEFAULT_TIMESTEPS; ++n) {
+		uint8_t count = BitfieldGetMessagesForTimestep(&oldSched, msgs);
+		while (count) {
+			++counts[msgs[--count]];
+		}
+	}
+	for (i = 0; i < types; ++i) {
+		assert(counts[ids[i]] == msgRates[i]);
+	}
+	memset(counts, 0, sizeof(counts));
+	for (n = 0; n < MSCHED_DEFAULT_TIMESTEPS; ++n) {
+		uint8_t count = GetMessagesForTimestep(&newSched, msgs);
+		while (count) {
+			++counts[msgs[--count]];
+		}
+	}
+	for (i = 0; i < types; ++i) {
+		assert(counts[ids[i]] == msgRates[i]);
+	}
 
-/**
- * This function prints out all of the messages for every timestep. Useful for debugging with
- * gdb when it can be called at any point manually via `call PrintAllschedule->Timesteps()`. Otherwise
- * this function isn't used by any code.
- */
-void PrintAllTimesteps(const MessageSchedule *schedule)
-{
-	puts("schedule->Timesteps:\n");
-	uint8_t i;
-	for (i = 0; i < schedule->MessageTypes; ++i) {
-		printf("%3d: %04x %04x %04x %04x %04x %04x %04x %04x\n", schedule->MessageIds[i], schedule->Timesteps[i][MSCHED_REPEATING][0],
-		                                                            schedule->Timesteps[i][MSCHED_REPEATING][1],
-		                                                            schedule->Timesteps[i][MSCHED_REPEATING][2],
-		                                                            schedule->Timesteps[i][MSCHED_REPEATING][3],
-		                                                            schedule->Timesteps[i][MSCHED_REPEATING][4],
-		                                                            schedule->Timesteps[i][MSCHED_REPEATING][5],
-		                                                            schedule->Timesteps[i][MSCHED_REPEATING][6],
-		                                                            schedule->Timesteps[i][MSCHED_REPEATING][7]);
+	// And time dispatching.
+	const uint32_t ticks = 2000000;
+	uint32_t total = 0;
+	start = clock();
+	for (n = 0; n < ticks; ++n) {
+		total += BitfieldGetMessagesForTimestep(&oldSched, msgs);
+	}
+	double oldTick = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / ticks;
+	start = clock();
+	for (n = 0; n < ticks; ++n) {
+		total -= GetMessagesForTimestep(&newSched, msgs);
 	}
+	double newTick = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / ticks;
+	assert(total == 0);
+
+	printf("%5u | %9.1f | %7.1f | %6.2fx | %11.1f | %9.1f | %6.2fx\n", types,
+	       oldAdd, newAdd, oldAdd / newAdd, oldTick, newTick, oldTick / newTick);
 }
 
 // Set up the necessary constants for the messages.
@@ -352,7 +1501,9 @@ enum {
 
 // Set up a schedule struct and supporting data structures.
 #define NUM_MSGS 5
-uint16_t tsteps[NUM_MSGS][2][8] = {};
+uint8_t tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+MessageScheduleSlot slots[NUM_MSGS] = {};
 uint8_t mIds[NUM_MSGS] = {MSG_ID_1, MSG_ID_2, MSG_ID_3, MSG_ID_4, MSG_ID_5};
 uint8_t mSizes[NUM_MSGS] = {MSG_ID_1_SIZE, MSG_ID_2_SIZE, MSG_ID_3_SIZE, MSG_ID_4_SIZE, MSG_ID_5_SIZE};
 MessageSchedule sched = {
@@ -360,7 +1511,11 @@ MessageSchedule sched = {
 	mIds,
 	mSizes,
 	0,
-	tsteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	tstepLists,
+	tstepBytes,
+	slots
 };
 
 int main(void)
@@ -454,7 +1609,9 @@ int main(void)
 
 	// Now test handling of a bunch of different types of messages.
 	{
-		uint16_t tsteps[101][2][8] = {};
+		uint8_t tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot slots[101] = {};
 		uint8_t mIds[101] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51,52,53,54,55,56,57,58,59,60,61,62,63,64,65,66,67,68,69,70,71,72,73,74,75,76,77,78,79,80,81,82,83,84,85,86,87,88,89,90,91,92,93,94,95,96,97,98,99,100};
 		uint8_t mSizes[101] = {
 			1,1,1,1,1,1,1,1,1,1,
@@ -472,7 +1629,11 @@ int main(void)
 			mIds,
 			mSizes,
 			0,
-			tsteps
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			tstepLists,
+			tstepBytes,
+			slots
 		};
 		// Then include 100 1Hz messages and confirm that the different messages all end up by themselves in a single timestep.
 		uint8_t i;
@@ -511,7 +1672,9 @@ int main(void)
 	// Test that all acceptable rates are handled correctly.
 	// NOTE: All tests until now used fairly safe transmission rates.
 	{
-		uint16_t tsteps[101][2][8] = {};
+		uint8_t tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot slots[101] = {};
 		uint8_t mIds[101] = {0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,48,49,50,51,52,53,54,55,56,57,58,59,60,61,62,63,64,65,66,67,68,69,70,71,72,73,74,75,76,77,78,79,80,81,82,83,84,85,86,87,88,89,90,91,92,93,94,95,96,97,98,99,100};
 		uint8_t mSizes[101] = {
 			1,1,1,1,1,1,1,1,1,1,
@@ -529,7 +1692,11 @@ int main(void)
 			mIds,
 			mSizes,
 			0,
-			tsteps
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			tstepLists,
+			tstepBytes,
+			slots
 		};
 		uint8_t i;
 		for (i = 1; i < 100; i++) {
@@ -556,7 +1723,9 @@ int main(void)
 	// Check transient message handling.
 	{
 		// Initialize our schedule.
-		uint16_t tsteps[2][2][8] = {};
+		uint8_t tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot slots[2] = {};
 		uint8_t mIds[2] = {111, 143};
 		uint8_t mSizes[2] = {1,1};
 		MessageSchedule sched = {
@@ -564,7 +1733,11 @@ int main(void)
 			mIds,
 			mSizes,
 			0,
-			tsteps
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			tstepLists,
+			tstepBytes,
+			slots
 		};
 	
 		// First add a 100Hz message, change the current timestep, and then check that the message
@@ -581,7 +1754,7 @@ int main(void)
 		
 		uint8_t count = GetMessagesForTimestep(&sched, msgs);
 		assert(count == 2);
-		assert(msgs[1] = 143);
+		assert(msgs[0] == 143 || msgs[1] == 143);
 		
 		// Now that this transient message has been handled if we loop around again it should be gone.
 		// We also should also not encounter this message until then.
@@ -597,12 +1770,524 @@ int main(void)
 		assert(msgs[0] == 111);
 	}
 
+	// Check the other transient placement methods and that transients never duplicate a repetition.
+	{
+		uint8_t tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot slots[2] = {};
+		uint8_t mIds[2] = {111, 143};
+		uint8_t mSizes[2] = {1,1};
+		MessageSchedule sched = {
+			2,
+			mIds,
+			mSizes,
+			0,
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			tstepLists,
+			tstepBytes,
+			slots
+		};
+		uint8_t msgs[2];
+		uint8_t i;
+		for (i = 0; i < 40; i++) {
+			assert(!GetMessagesForTimestep(&sched, msgs));
+		}
+
+		// SOONEST goes out with the very next timestep.
+		assert(AddMessageOnce(&sched, 143, ADD_METHOD_SOONEST));
+		assert(GetMessagesForTimestep(&sched, msgs) == 1);
+		assert(msgs[0] == 143);
+
+		// LATEST goes out with the last timestep before this one comes around again.
+		assert(AddMessageOnce(&sched, 143, ADD_METHOD_LATEST));
+		for (i = 0; i < 99; i++) {
+			assert(!GetMessagesForTimestep(&sched, msgs));
+		}
+		assert(GetMessagesForTimestep(&sched, msgs) == 1);
+		assert(msgs[0] == 143);
+
+		// A removed transient never goes out.
+		assert(AddMessageOnce(&sched, 143, ADD_METHOD_SOONEST));
+		RemoveMessage(&sched, 143);
+		for (i = 0; i < 100; i++) {
+			assert(!GetMessagesForTimestep(&sched, msgs));
+		}
+
+		// A transient at the same timestep as a repetition of that message is only sent once. The
+		// one-off message is also merged into a repeating one added afterwards.
+		assert(AddMessageOnce(&sched, 111, ADD_METHOD_SOONEST));
+		assert(AddMessageRepeating(&sched, 111, 100));
+		assert(AddMessageOnce(&sched, 111, ADD_METHOD_SOONEST));
+		for (i = 0; i < 100; i++) {
+			assert(GetMessagesForTimestep(&sched, msgs) == 1);
+			assert(msgs[0] == 111);
+		}
+
+		// Changing the rate of a message replaces the old one.
+		assert(AddMessageRepeating(&sched, 111, 4));
+		assert(GetBps(&sched) == 4);
+		uint8_t counter = 0;
+		for (i = 0; i < 100; i++) {
+			counter += GetMessagesForTimestep(&sched, msgs);
+		}
+		assert(counter == 4);
+	}
+
+	// Check that the budgets are enforced for repeating and one-off messages.
+	{
+		uint8_t tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot slots[3] = {};
+		uint8_t mIds[3] = {10, 11, 12};
+		uint8_t mSizes[3] = {10, 10, 10};
+		MessageSchedule sched = {
+			3,
+			mIds,
+			mSizes,
+			0,
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			tstepLists,
+			tstepBytes,
+			slots
+		};
+
+		// The reasons for refusing bad input are reported.
+		assert(!AddMessageRepeating(&sched, 10, 0));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_INVALID_RATE);
+		assert(!AddMessageRepeating(&sched, 99, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_UNKNOWN_MESSAGE);
+		assert(!AddMessageOnce(&sched, 99, ADD_METHOD_BEST));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_UNKNOWN_MESSAGE);
+
+		// With 100 bytes/s a 10-byte message only fits 10 times a second.
+		SetScheduleBudget(&sched, 100, 0);
+		assert(AddMessageRepeating(&sched, 10, 20));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_DOWNGRADED);
+		assert(GetBps(&sched) == 100);
+		assert(!AddMessageRepeating(&sched, 11, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_OVER_SECOND_BUDGET);
+		assert(GetSpareBps(&sched) == 0 && GetTimestepSpareBytes(&sched) == UINT16_MAX);
+		assert(!AddMessageOnce(&sched, 11, ADD_METHOD_BEST));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_OVER_SECOND_BUDGET);
+
+		// Lowering the rate of a message frees up room for another.
+		assert(AddMessageRepeating(&sched, 10, 5));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_OK);
+		assert(AddMessageRepeating(&sched, 11, 5));
+		assert(GetBps(&sched) == 100);
+
+		// With only room for a single message per timestep, two 50Hz messages interleave and a
+		// third can't be fit in anywhere.
+		ClearSchedule(&sched);
+		SetScheduleBudget(&sched, 0, 10);
+		assert(AddMessageRepeating(&sched, 10, 50));
+		assert(AddMessageRepeating(&sched, 11, 100));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_DOWNGRADED);
+		assert(slots[1].Count == 50);
+		assert(!AddMessageRepeating(&sched, 12, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_OVER_TIMESTEP_BUDGET);
+		assert(!AddMessageOnce(&sched, 12, ADD_METHOD_SOONEST));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_OVER_TIMESTEP_BUDGET);
+
+		// A message that's refused keeps its old rate.
+		SetScheduleBudget(&sched, 0, 5);
+		assert(!AddMessageRepeating(&sched, 10, 25));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_OVER_TIMESTEP_BUDGET);
+		assert(slots[0].Count == 50);
+		assert(GetBps(&sched) == 1000);
+
+		// Then a one-off message is moved to the nearest timestep with room.
+		ClearSchedule(&sched);
+		SetScheduleBudget(&sched, 0, 10);
+		assert(AddMessageRepeating(&sched, 10, 1));
+		assert(AddMessageOnce(&sched, 11, ADD_METHOD_SOONEST));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_DEFERRED);
+		assert(AddMessageOnce(&sched, 12, ADD_METHOD_BEST));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_OK);
+		assert(GetSpareBps(&sched) == UINT32_MAX);
+		uint8_t msgs[3];
+		uint8_t i;
+		for (i = 0; i < 3; i++) {
+			assert(GetTimestepSpareBytes(&sched) == 0);
+			assert(GetMessagesForTimestep(&sched, msgs) == 1);
+			assert(msgs[0] == 10 + i);
+		}
+		for (i = 3; i < 100; i++) {
+			assert(GetTimestepSpareBytes(&sched) == 10);
+			assert(!GetMessagesForTimestep(&sched, msgs));
+		}
+	}
+
+	// Check that urgent messages displace lower-priority repetitions to go out with the next timestep.
+	{
+		uint8_t tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot slots[4] = {};
+		uint8_t mIds[4] = {10, 11, 12, 13};
+		uint8_t mSizes[4] = {30, 20, 25, 40};
+		MessageSchedule sched = {
+			4,
+			mIds,
+			mSizes,
+			0,
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			tstepLists,
+			tstepBytes,
+			slots
+		};
+		uint8_t msgs[4];
+
+		assert(!SetMessagePriority(&sched, 99, 1));
+		assert(!AddMessageUrgent(&sched, 99, 1, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_UNKNOWN_MESSAGE);
+
+		// Without a higher priority than the repeating messages there's no room for it, but with
+		// room to spare it just goes out with the next timestep.
+		SetScheduleBudget(&sched, 0, 60);
+		assert(AddMessageRepeating(&sched, 10, 100));
+		assert(AddMessageRepeating(&sched, 11, 100));
+		assert(!AddMessageUrgent(&sched, 13, 0, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_MISSED_DEADLINE);
+		SetScheduleBudget(&sched, 0, 100);
+		assert(AddMessageUrgent(&sched, 13, 0, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_OK);
+		assert(GetMessagesForTimestep(&sched, msgs) == 3);
+		assert(msgs[0] == 13);
+
+		// Otherwise the largest repetition goes to make room. At 100Hz it can't be sent any later
+		// before its next repetition, so it's skipped.
+		SetScheduleBudget(&sched, 0, 60);
+		assert(AddMessageUrgent(&sched, 12, 1, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_DISPLACED);
+		assert(GetMessagesForTimestep(&sched, msgs) == 2);
+		assert(msgs[0] == 12 || msgs[1] == 12);
+		assert(msgs[0] == 11 || msgs[1] == 11);
+		assert(GetMessagesForTimestep(&sched, msgs) == 2);
+		assert(msgs[0] != 12 && msgs[1] != 12);
+
+		// Higher-priority repetitions are left alone, so there's not enough room to displace.
+		assert(SetMessagePriority(&sched, 10, 2));
+		assert(!AddMessageUrgent(&sched, 13, 1, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_MISSED_DEADLINE);
+		assert(AddMessageUrgent(&sched, 12, 1, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_DISPLACED);
+		assert(GetMessagesForTimestep(&sched, msgs) == 2);
+		assert(msgs[0] == 10 || msgs[1] == 10);
+		assert(msgs[0] == 12 || msgs[1] == 12);
+
+		// A slower message that's displaced is sent as soon as there's room before it's due again.
+		ClearSchedule(&sched);
+		SetScheduleBudget(&sched, 0, 60);
+		assert(AddMessageRepeating(&sched, 10, 10));
+		assert(AddMessageRepeating(&sched, 11, 100));
+				assert(AddMessageUrgent(&sched, 13, 1, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_DISPLACED);
+		assert(GetMessagesForTimestep(&sched, msgs) == 2);
+		assert(msgs[0] == 13 || msgs[1] == 13);
+		assert(msgs[0] != 10 && msgs[1] != 10);
+		assert(GetMessagesForTimestep(&sched, msgs) == 2);
+		assert(msgs[0] == 10 || msgs[1] == 10);
+		uint8_t i, sent = 0;
+		for (i = 2; i < 100; i++) {
+			uint8_t count = GetMessagesForTimestep(&sched, msgs);
+			while (count) {
+				sent += msgs[--count] == 10;
+			}
+		}
+		assert(sent == 9);
+
+		// A pending one-off message is moved up, and an urgent message that can't displace anything
+		// goes out with the soonest timestep with room before its deadline.
+		ClearSchedule(&sched);
+		SetScheduleBudget(&sched, 0, 50);
+		assert(AddMessageRepeating(&sched, 13, 1));
+		assert(SetMessagePriority(&sched, 13, 2));
+		assert(AddMessageOnce(&sched, 12, ADD_METHOD_LATEST));
+		assert(!AddMessageUrgent(&sched, 12, 1, 1));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_MISSED_DEADLINE);
+		assert(slots[2].TransientPending && slots[2].TransientStep == 99);
+		assert(AddMessageUrgent(&sched, 12, 1, 2));
+		assert(GetScheduleResult(&sched) == SCHED_RESULT_DEFERRED);
+		assert(GetMessagesForTimestep(&sched, msgs) == 1);
+		assert(msgs[0] == 13);
+		assert(GetMessagesForTimestep(&sched, msgs) == 1);
+		assert(msgs[0] == 12);
+		for (i = 2; i < 100; i++) {
+			assert(!GetMessagesForTimestep(&sched, msgs));
+		}
+	}
+
+	// Simulate uploading a mission over the radio with every way of queueing the replies, both
+	// with the primary node's limit of a quarter of the transmit buffer per timestep and with a
+	// limit barely above the largest message. Writing replies straight to the UART breaks the
+	// tighter limit, while urgent replies don't and are as quick as scheduling allows.
+	{
+		const char *methods[] = {"direct", "best", "soonest", "urgent"};
+		const uint16_t budgets[] = {256, 56};
+		uint16_t uploadTime[2][4];
+		puts("\nUploading a 32-item mission over the 64kbps radio:");
+		puts("budget/timestep | replies | upload (ms) | telemetry skipped | peak bytes/timestep");
+		uint8_t b, m;
+		for (b = 0; b < 2; b++) {
+			for (m = SIM_REPLY_DIRECT; m <= SIM_REPLY_URGENT; m++) {
+				uint16_t skipped, peak;
+				uploadTime[b][m] = SimulateMissionUpload(m, budgets[b], 32, &skipped, &peak);
+				printf("%15u | %7s | %11u | %17u | %u\n", budgets[b], methods[m],
+				       uploadTime[b][m] * 10, skipped, peak);
+				if (m != SIM_REPLY_DIRECT) {
+					assert(peak <= budgets[b]);
+				}
+			}
+			// Urgent replies are never slower than any other way of scheduling them.
+			assert(uploadTime[b][SIM_REPLY_URGENT] <= uploadTime[b][SIM_REPLY_SOONEST]);
+			assert(uploadTime[b][SIM_REPLY_URGENT] < uploadTime[b][SIM_REPLY_BEST]);
+		}
+	}
+
+	// Now drive the Primary node's groundstation and datalogger MAVLink schedules against the
+	// channels they could be connected to. Message sizes include the 8 bytes of MAVLink framing.
+	// The radios have a 64kbps air rate with ECC halving that and 20% of it is left for missions
+	// and parameters. A 115200 baud link has 10% left free. No timestep can fill more than a
+	// quarter of the 1024-byte transmit buffer, or in the strict case more than can be sent over a
+	// 115200 baud link in a single 10ms timestep.
+	{
+		const TestChannel channels[] = {
+			{"64kbps radio", 64000 / 10 / 2 * 80 / 100, 256},
+			{"115200 baud", 115200 / 10 * 90 / 100, 256},
+			{"115200 baud, strict", 115200 / 10 * 90 / 100, 115200 / 10 / 100}
+		};
+		ScheduleResult results[18];
+
+		puts("\nMAVLink schedules against channel budgets:");
+		puts("channel              | ok | dn | no |    bytes/s    | peak/timestep");
+
+		// HEARTBEAT, SYS_STATUS, SYSTEM_TIME, LOCAL_POSITION_NED, ATTITUDE, GPS_RAW_INT, WSO100,
+		// BASIC_STATE2, RUDDER_RAW, DST800, MAIN_POWER, GPS200, NODE_STATUS, WAYPOINT_STATUS, TOKIMEC,
+		// RADIO_STATUS, VFR_HUD, NAV_CONTROLLER_OUTPUT
+		uint8_t gsLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t gsBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot gsSlots[18] = {};
+		uint8_t gsIds[18] = {0, 1, 2, 32, 30, 24, 160, 175, 150, 161, 172, 163, 173, 174, 165, 109, 74, 62};
+		uint8_t gsSizes[18] = {17, 39, 20, 36, 36, 38, 28, 50, 17, 20, 20, 12, 50, 40, 50, 17, 28, 34};
+		const uint8_t gsRates[18] = {2, 2, 1, 5, 4, 4, 1, 1, 1, 1, 2, 0, 1, 1, 1, 0, 5, 2};
+		MessageSchedule gsSched = {
+			18,
+			gsIds,
+			gsSizes,
+			0,
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			gsLists,
+			gsBytes,
+			gsSlots
+		};
+		puts("groundstation:");
+		uint8_t i, j;
+		for (i = 0; i < sizeof(channels) / sizeof(channels[0]); i++) {
+			TestChannelBudget(&gsSched, gsRates, &channels[i], results);
+			// The groundstation schedule fits on every channel.
+			for (j = 0; j < 18; j++) {
+				assert(results[j] == SCHED_RESULT_OK);
+			}
+		}
+
+		// HEARTBEAT, SYS_STATUS, NODE_STATUS, TOKIMEC_WITH_TIME, CONTROLLER_DATA,
+		// PARAM_VALUE_WITH_TIME, SYSTEM_TIME, GPS_RAW_INT, MAIN_POWER
+		uint8_t dlLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t dlBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot dlSlots[9] = {};
+		uint8_t dlIds[9] = {0, 1, 173, 181, 180, 182, 2, 24, 172};
+		uint8_t dlSizes[9] = {17, 39, 50, 54, 86, 37, 20, 38, 20};
+		const uint8_t dlRates[9] = {2, 2, 5, 0, 100, 0, 1, 5, 10};
+		MessageSchedule dlSched = {
+			9,
+			dlIds,
+			dlSizes,
+			0,
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			dlLists,
+			dlBytes,
+			dlSlots
+		};
+		puts("datalogger:");
+
+		// The 100Hz CONTROLLER_DATA doesn't fit over the radio, so it's downgraded to what's left
+		// and the messages after it are refused.
+		TestChannelBudget(&dlSched, dlRates, &channels[0], results);
+		assert(results[4] == SCHED_RESULT_DOWNGRADED);
+		assert(results[7] == SCHED_RESULT_OVER_SECOND_BUDGET);
+
+		// But it does over a serial link.
+		TestChannelBudget(&dlSched, dlRates, &channels[1], results);
+		for (j = 0; j < 9; j++) {
+			assert(results[j] == SCHED_RESULT_OK);
+		}
+
+		// Unless no timestep can go over what the link can send in that time, in which case
+		// CONTROLLER_DATA is slowed down to fit between the other messages.
+		TestChannelBudget(&dlSched, dlRates, &channels[2], results);
+		assert(results[4] == SCHED_RESULT_DOWNGRADED);
+
+		// Parameters are still sent as one-off messages with either budget.
+		for (i = 1; i < 3; i++) {
+			ClearSchedule(&dlSched);
+			SetScheduleBudget(&dlSched, channels[i].bytesPerSecond, channels[i].bytesPerTimestep);
+			for (j = 0; j < 9; j++) {
+				if (dlRates[j]) {
+					AddMessageRepeating(&dlSched, dlIds[j], dlRates[j]);
+				}
+			}
+			assert(AddMessageOnce(&dlSched, 182, ADD_METHOD_SOONEST));
+			uint8_t msgs[9];
+			uint16_t bytes = 0;
+			uint8_t t;
+			bool sent = false;
+			for (t = 0; t < 100; t++) {
+				uint8_t count = GetMessagesForTimestep(&dlSched, msgs);
+				bytes = 0;
+				while (count) {
+					uint8_t id = msgs[--count];
+					for (j = 0; dlIds[j] != id; ++j);
+					bytes += dlSizes[j];
+					sent |= id == 182;
+				}
+				assert(bytes <= channels[i].bytesPerTimestep);
+			}
+			assert(sent);
+		}
+	}
+
+	// The primary node dispatches both of its MAVLink schedules from the same 100Hz loop, so check
+	// that balancing them together flattens their combined load without changing any rates or
+	// breaking either budget.
+	{
+		uint8_t gsLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t gsBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot gsSlots[18] = {};
+		uint8_t gsIds[18] = {0, 1, 2, 32, 30, 24, 160, 175, 150, 161, 172, 163, 173, 174, 165, 109, 74, 62};
+		uint8_t gsSizes[18] = {17, 39, 20, 36, 36, 38, 28, 50, 17, 20, 20, 12, 50, 40, 50, 17, 28, 34};
+		const uint8_t gsRates[18] = {2, 2, 1, 5, 4, 4, 1, 1, 1, 1, 2, 0, 1, 1, 1, 0, 5, 2};
+		MessageSchedule gsSched = {
+			18,
+			gsIds,
+			gsSizes,
+			0,
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			gsLists,
+			gsBytes,
+			gsSlots
+		};
+		uint8_t dlLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t dlBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot dlSlots[9] = {};
+		uint8_t dlIds[9] = {0, 1, 173, 181, 180, 182, 2, 24, 172};
+		uint8_t dlSizes[9] = {17, 39, 50, 54, 86, 37, 20, 38, 20};
+		const uint8_t dlRates[9] = {2, 2, 5, 0, 100, 0, 1, 5, 10};
+		MessageSchedule dlSched = {
+			9,
+			dlIds,
+			dlSizes,
+			0,
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			dlLists,
+			dlBytes,
+			dlSlots
+		};
+		SetScheduleBudget(&gsSched, 64000 / 10 / 2 * 80 / 100, 256);
+		SetScheduleBudget(&dlSched, 115200 / 10 * 90 / 100, 256);
+		uint8_t i;
+		for (i = 0; i < 18; i++) {
+			if (gsRates[i]) {
+				assert(AddMessageRepeating(&gsSched, gsIds[i], gsRates[i]));
+			}
+		}
+		for (i = 0; i < 9; i++) {
+			if (dlRates[i]) {
+				assert(AddMessageRepeating(&dlSched, dlIds[i], dlRates[i]));
+			}
+		}
+		// Also queue up a one-off message, which should survive being rebalanced.
+		assert(AddMessageOnce(&dlSched, 182, ADD_METHOD_LATEST));
+		const uint32_t gsBps = GetBps(&gsSched), dlBps = GetBps(&dlSched);
+
+		MessageSchedule *const both[2] = {&gsSched, &dlSched};
+		puts("\nCombined load per timestep of the groundstation and datalogger schedules:");
+		uint16_t before = PrintLoadProfile("before balancing", both, 2);
+		uint16_t load[MSCHED_DEFAULT_TIMESTEPS];
+		assert(BalanceSchedules(both, 2, load));
+		uint16_t after = PrintLoadProfile("after balancing", both, 2);
+		assert(after <= before);
+
+		// Balancing again shouldn't find anything left to improve.
+		uint16_t balanced[MSCHED_DEFAULT_TIMESTEPS];
+		memcpy(balanced, load, sizeof(load));
+		assert(BalanceSchedules(both, 2, load));
+		assert(memcmp(balanced, load, sizeof(load)) == 0);
+
+		// Every message is still sent at its original rate and the budgets still hold.
+		assert(GetBps(&gsSched) == gsBps);
+		assert(GetBps(&dlSched) == dlBps);
+		uint8_t msgs[18];
+		uint8_t counts[256] = {};
+		bool sentOnce = false;
+		uint8_t t;
+		for (t = 0; t < 100; t++) {
+			uint8_t count = GetMessagesForTimestep(&gsSched, msgs);
+			assert(gsBytes[t] <= 256);
+			while (count) {
+				counts[msgs[--count]]++;
+			}
+			count = GetMessagesForTimestep(&dlSched, msgs);
+			assert(dlBytes[t] <= 256);
+			while (count) {
+				uint8_t id = msgs[--count];
+				if (id == 182) {
+					sentOnce = true;
+				} else {
+					counts[id]++;
+				}
+			}
+		}
+		assert(sentOnce);
+		// Both schedules send the HEARTBEAT, SYS_STATUS, SYSTEM_TIME, GPS_RAW_INT, NODE_STATUS, and
+		// MAIN_POWER messages, so their counts add up.
+		for (i = 0; i < 18; i++) {
+			uint8_t expected = gsRates[i];
+			uint8_t j;
+			for (j = 0; j < 9; j++) {
+				if (dlIds[j] == gsIds[i]) {
+					expected += dlRates[j];
+				}
+			}
+			assert(counts[gsIds[i]] == expected);
+		}
+		assert(counts[180] == 100);
+
+		// But schedules with different timebases can't be balanced together.
+		uint8_t slowLists[200] = {};
+		uint16_t slowBytes[200] = {};
+		MessageScheduleSlot slowSlots[1] = {};
+		uint8_t slowIds[1] = {0};
+		uint8_t slowSizes[1] = {17};
+		MessageSchedule slowSched = {1, slowIds, slowSizes, 0, 200, 100, slowLists, slowBytes, slowSlots};
+		MessageSchedule *const mismatched[2] = {&gsSched, &slowSched};
+		assert(!BalanceSchedules(mismatched, 2, load));
+	}
+
 	// Now attempt a realistic message scheduling scenario.
 	// I don't actually do any automated checking here, but this can
 	// be useful to confirm things by hand.
 	{
 		// Initialize our schedule.
-		uint16_t tsteps[12][2][8] = {};
+		uint8_t tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+		uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+		MessageScheduleSlot slots[12] = {};
 		uint8_t mIds[12] = {0, 1, 30, 32, 74, 24, 171, 161, 162, 170, 160, 150};
 		uint8_t mSizes[12] = {9, 31, 28, 28, 20, 30, 19, 22, 10, 4, 36, 7};
 		MessageSchedule sched = {
@@ -610,7 +2295,11 @@ int main(void)
 			mIds,
 			mSizes,
 			0,
-			tsteps
+			MSCHED_DEFAULT_TIMESTEPS,
+			MSCHED_DEFAULT_TIMESTEP_RATE,
+			tstepLists,
+			tstepBytes,
+			slots
 		};
 		assert(AddMessageRepeating(&sched, 0, 1)); // Heartbeat at 1Hz
 		assert(AddMessageRepeating(&sched, 1, 1)); // System status at 1Hz
@@ -628,6 +2317,26 @@ int main(void)
 		PrintAllTimesteps(&sched);
 	}
 	
+	// Finally compare the performance against the original bitfield scheduler for a growing number
+	// of message types.
+	puts("\nTime (ns) to add a message and to dispatch a timestep, bitfields vs. lists:");
+	puts("types | add (bits) | (lists) | speedup | tick (bits) | (lists) | speedup");
+	BenchmarkScheduler(8);
+	BenchmarkScheduler(18);
+	BenchmarkScheduler(32);
+	BenchmarkScheduler(64);
+	BenchmarkScheduler(127);
+
+	// And check all timebases from 10Hz to 1kHz with rates from 0.05Hz to 500Hz.
+	puts("\nTimebases with a 20s cycle and every supported rate from 0.05Hz to 500Hz:");
+	puts(" rate | steps | memory | rates | add(ns) | tick(ns)");
+	TestTimebase(10);
+	TestTimebase(50);
+	TestTimebase(100);
+	TestTimebase(200);
+	TestTimebase(500);
+	TestTimebase(1000);
+
 	// And display success!
 	puts("\nAll tests passed successfully.");
 	return EXIT_SUCCESS;
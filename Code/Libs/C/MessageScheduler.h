@@ -7,22 +7,51 @@
  * DESCRIPTION:
  * This library contains a message scheduler designed for transmission of both repeating messages
  * and one off messages. It attempts to schedule new messages over timesteps with the lowest amount
- * of data necessary for transmission. This library is timestep agnostic, but only supports 100
- * timesteps at this point.
+ * of data necessary for transmission. This library is timestep agnostic: every schedule repeats
+ * over a cycle of `TimestepCount` timesteps dispatched at `TimestepRate` Hz, both chosen when the
+ * schedule is declared. Most nodes use a 1s cycle of 100 timesteps at 100Hz, but a longer cycle
+ * allows sub-Hz rates and a faster timestep rate allows rates above 100Hz. Rates that don't divide
+ * the cycle evenly are spread across it as evenly as possible using only integer arithmetic.
+ *
+ * Every timestep keeps a short linked list of the messages due at it, so dispatching a timestep
+ * only touches the messages actually being sent. Every message type owns exactly two list entries,
+ * one for its repeating schedule and one for a pending one-off transmission. When a repeating
+ * message is dispatched its entry is moved onto the list of the next timestep it's due, so the
+ * memory used doesn't depend on the message rates, only on the number of message types and the
+ * number of timesteps in the cycle. The number of bytes of repeating messages at
+ * every timestep is also cached, so finding the best placement for a new message doesn't need to
+ * look at every other message type.
+ *
+ * Every schedule can optionally be given a budget of bytes per timestep and per second with
+ * SetScheduleBudget(). Repeating messages that don't fit are downgraded to the highest rate that
+ * does, and one-off messages are moved to another timestep. If a message doesn't fit at all it's
+ * refused. GetScheduleResult() reports what happened to the last message added. Urgent one-off
+ * messages, like protocol replies, can instead displace repetitions of lower-priority messages so
+ * that they still go out with the next timestep.
+ *
+ * Several schedules that are dispatched from the same loop can be balanced against each other with
+ * BalanceSchedules(), which moves their messages around so their combined worst-case timestep is as
+ * light as possible.
  *
  * REQUIREMENTS:
  * This library has no prerequisites outside of the C standard library.
  *
  * USAGE:
- * 1) Set your code to call `IncrementTimestep()` at 100Hz and to process the list of message IDs.
+ * 1) Set your code to call `GetMessagesForTimestep()` at `TimestepRate` and to process the list of
+ *    message IDs.
  * 2) Add an initialization function to add all desired repeating messages using AddMessage*().
  * 3) Add support for a heap (probably at least 512). This library relies on malloc() and free(). 
  * 4) That's it! If you'd like to change the dispatched messages you may at any time.
  *
  * TESTING:
  * A unit-testing framework is built-in to this library and available by running with the UNIT_TEST
- * preprocessor macro defined. For example: 
- *   `gcc MessageScheduler.c -DUNIT_TEST -g -Wall -lm`
+ * preprocessor macro defined. It also benchmarks the dispatcher against the original bitfield
+ * implementation for 8 up to 127 message types and across a matrix of 10Hz to 1kHz timestep rates
+ * and 0.05Hz to 500Hz message rates, and prints the combined load of the primary node's two MAVLink
+ * schedules for every timestep before and after BalanceSchedules(). Finally it simulates a mission
+ * upload over the groundstation radio with the replies sent directly, as one-off messages, and as
+ * urgent messages, and prints how long each took. For example:
+ *   `gcc MessageScheduler.c -DUNIT_TEST -O2 -g -Wall -lm`
  */
 #ifndef MESSAGE_SCHEDULER_H
 #define MESSAGE_SCHEDULER_H
@@ -30,6 +59,52 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+// The timebase used by most nodes: a 1s cycle of 10ms timesteps.
+#define MSCHED_DEFAULT_TIMESTEPS 100
+#define MSCHED_DEFAULT_TIMESTEP_RATE 100
+
+// The most message types a single schedule supports.
+#define MSCHED_MAX_MESSAGE_TYPES 127
+
+// The estimated processing cost of dispatching a single message on top of that of its bytes, in
+// bytes. BalanceSchedules() counts every message as its size plus this, as every message has some
+// fixed overhead to pack and queue it regardless of its length.
+#ifndef MSCHED_MESSAGE_COST
+#define MSCHED_MESSAGE_COST 16
+#endif
+
+// The most passes BalanceSchedules() makes over the messages.
+#define MSCHED_BALANCE_PASSES 4
+
+/**
+ * The scheduling state of a single message type. Should be zero-initialized.
+ */
+typedef struct {
+	uint16_t Count;        // How many times this message is sent every cycle, or 0 if it isn't repeating.
+	uint16_t Offset;       // The first timestep this message is sent at every cycle.
+	uint16_t Occurrence;   // Which repetition within this cycle is sent next, in [0, Count).
+	uint16_t TransientStep;// The timestep a pending one-off transmission is scheduled for.
+	bool TransientPending; // Whether a one-off transmission is pending.
+	bool Displaced;        // Whether the next repetition was displaced by an urgent message and is skipped.
+	uint8_t Priority;      // Repetitions may only be displaced by urgent messages of a higher priority.
+	uint8_t Next[2];       // The next entry in the timestep list for the repeating and the one-off entries.
+} MessageScheduleSlot;
+
+/**
+ * The outcome of the last call to AddMessageRepeating() or AddMessageOnce().
+ */
+typedef enum {
+	SCHED_RESULT_OK,                  // The message was scheduled as requested.
+	SCHED_RESULT_DOWNGRADED,          // A repeating message was scheduled at a lower rate to fit the budget.
+	SCHED_RESULT_DEFERRED,            // A one-off message was moved to another timestep to fit the budget.
+	SCHED_RESULT_DISPLACED,           // An urgent message displaced lower-priority repetitions to fit the budget.
+	SCHED_RESULT_INVALID_RATE,        // Refused, the rate was above the timestep rate or below once a cycle.
+	SCHED_RESULT_UNKNOWN_MESSAGE,     // Refused, the message isn't part of this schedule.
+	SCHED_RESULT_OVER_SECOND_BUDGET,  // Refused, there's no room left in the per-second budget.
+	SCHED_RESULT_OVER_TIMESTEP_BUDGET,// Refused, there's no timestep with room left for it.
+	SCHED_RESULT_MISSED_DEADLINE      // Refused, there's no room for an urgent message before its deadline.
+} ScheduleResult;
+
 /**
  * This struct stores all of the state information necessary for the message schedular to operate.
  * Note that the IDs used for messages must be sequential and start at 0!
@@ -42,13 +117,25 @@ typedef struct {
 	// The size in bytes of every message type. Contains `MessageTypes` entries. The data is left unconstant so that the initialization functions can manipulate it.
 	uint8_t *const MessageSizes;
 	// Tracks the current timestep that we're executing at.
-	uint8_t CurrentTimestep;
-	// Keep a 128-bit schedule for every message. First dimension is messagetype,
-	// second is repeating or transient messages, and the last is the actual bitfield
-	// storing the boolean values for each timestep.
-	// We use 16-bit integers here because this is likely running on a 16-bit MCU and
-	// this will be substantially faster than doing 32-bit operations.
-	uint16_t (* const Timesteps)[2][8];
+	uint16_t CurrentTimestep;
+	// The number of timesteps in a single cycle of the schedule.
+	const uint16_t TimestepCount;
+	// The rate in Hz at which GetMessagesForTimestep() is called.
+	const uint16_t TimestepRate;
+	// The first entry in the list of messages due at every timestep. Entries are numbered starting
+	// at 1 so that 0 can mark an empty list. Contains `TimestepCount` zero-initialized entries.
+	uint8_t *const TimestepLists;
+	// The total size in bytes of the repeating messages scheduled at every timestep. Contains
+	// `TimestepCount` zero-initialized entries.
+	uint16_t *const TimestepBytes;
+	// The scheduling state of every message. Contains `MessageTypes` entries.
+	MessageScheduleSlot *const Slots;
+	// The most bytes that may be sent during a single timestep, or 0 for no limit.
+	uint16_t TimestepBudget;
+	// The most bytes of messages that may be sent every second, or 0 for no limit.
+	uint32_t SecondBudget;
+	// What happened to the last message added to this schedule.
+	ScheduleResult LastResult;
 } MessageSchedule;
 
 /**
@@ -57,22 +144,75 @@ typedef struct {
 typedef enum {
     ADD_METHOD_BEST, // Select the timestep with the least data use within the next 1s
     ADD_METHOD_SOONEST, // Select the next timestep
-    ADD_METHOD_LATEST // Select the last timestep, so ~1s from now
+    ADD_METHOD_LATEST // Select the last timestep within the next 1s
 } AddMethod;
 
 /// These functions handle adding/removing messages from the schedule.
 
 /**
- * Adds the specified message at the given rate (in Hz, from 1 to 100) to the dispatcher.
+ * Limits the bytes of messages sent by this schedule. Messages already scheduled are left alone, so
+ * this should be called before adding any. Either budget can be 0 for no limit.
+ * @param bytesPerSecond The most bytes of repeating and pending one-off messages every second.
+ * @param bytesPerTimestep The most bytes of messages sent during any single timestep.
+ */
+void SetScheduleBudget(MessageSchedule *schedule, uint32_t bytesPerSecond, uint16_t bytesPerTimestep);
+
+/**
+ * Adds the specified message at the given rate (in Hz, from 1 to `TimestepRate`) to the dispatcher.
+ * If this message was already repeating, its old rate is replaced.
+ *
+ * If the message doesn't fit within the schedule's budget at this rate it is added at the highest
+ * rate that does fit. If it doesn't fit at all false is returned and any previous rate is kept.
+ * Check GetScheduleResult() for the specifics.
  */
 bool AddMessageRepeating(MessageSchedule *schedule, uint8_t id, uint8_t rate);
 
+/**
+ * Like AddMessageRepeating(), but with the rate given in mHz so that sub-Hz rates can be used. The
+ * rate is rounded to the nearest whole number of transmissions per cycle, so a cycle of N timesteps
+ * can only represent multiples of `TimestepRate / N` Hz. Rates that round to 0, or are above the
+ * timestep rate, are refused.
+ */
+bool AddMessageRepeatingMillihertz(MessageSchedule *schedule, uint8_t id, uint32_t rate);
+
 /**
  * Adds a one-time message to the dispatcher. Note that sequential calls to this function may not
  * persist that ordering within the dispatcher as messages are placed in the lowest cost bin first.
+ * Only a single one-off transmission can be pending per message, so if one already is this does
+ * nothing and returns true.
+ *
+ * If the timestep chosen by `method` doesn't have room in the schedule's per-timestep budget the
+ * message goes out with the closest one that does instead: later for ADD_METHOD_SOONEST and
+ * earlier for ADD_METHOD_LATEST. If there's no room anywhere, or the per-second budget is used up,
+ * false is returned. Check GetScheduleResult() for the specifics.
  */
 bool AddMessageOnce(MessageSchedule *schedule, uint8_t id, AddMethod method);
 
+/**
+ * Sets the priority of a message, which starts out as 0 and is reset by ClearSchedule().
+ * Repetitions of a message can only be displaced by urgent messages of a higher priority, see
+ * AddMessageUrgent().
+ * @return False if the message isn't part of this schedule.
+ */
+bool SetMessagePriority(MessageSchedule *schedule, uint8_t id, uint8_t priority);
+
+/**
+ * Adds an urgent one-time message, like a reply to a request, that needs to be sent within
+ * `deadline` timesteps. A deadline of 1 (or 0) means the next dispatched timestep.
+ *
+ * It always goes out with the next timestep if that fits within the per-timestep budget. If it
+ * doesn't, the repetitions due then of messages with a lower priority than `priority` are
+ * displaced to make room, largest and lowest priority first. Displaced messages are moved to the
+ * soonest later timestep that has room before their next repetition, or skipped if there is none.
+ * If even that doesn't make enough room, the message goes out with the soonest timestep before the
+ * deadline that has room. A one-off transmission of this message that's already pending is moved
+ * up.
+ *
+ * If it can't be sent before the deadline, or the per-second budget is used up, false is returned.
+ * Check GetScheduleResult() for the specifics.
+ */
+bool AddMessageUrgent(MessageSchedule *schedule, uint8_t id, uint8_t priority, uint16_t deadline);
+
 /**
  * Removes all messages of a given ID from the dispatcher. This will apply to transient AND
  * repeating messages.
@@ -89,7 +229,8 @@ void ClearSchedule(MessageSchedule *schedule);
 /**
  * This is the actual dispatching function. It is called to determine the messages that should be
  * transmit. It returns the ID of the messages scheduled for this timestep into `messages`. This
- * array should therefore be at least `MessageTypes` long.
+ * array should therefore be at least `MessageTypes` long. The order of the returned messages is
+ * unspecified.
  * @return The number of messages at this specific timestep.
  */
 uint8_t GetMessagesForTimestep(MessageSchedule *schedule, uint8_t messages[]);
@@ -100,10 +241,50 @@ uint8_t GetMessagesForTimestep(MessageSchedule *schedule, uint8_t messages[]);
 void ResetTimestep(MessageSchedule *schedule);
 
 /**
- * Calculates the bytes/s expected from this message schedule for recurring messages. So transient
- * messages are ignored.
+ * Calculates the bytes/s expected from this message schedule for recurring messages, averaged over
+ * a cycle. So transient messages are ignored.
  * @return The bytes/s output by this message schedule.
  */
 uint32_t GetBps(const MessageSchedule *schedule);
 
+/**
+ * Returns the bytes left in the per-timestep budget at the next timestep to be dispatched, once
+ * every message due then is sent. This is meant for filling that timestep with unscheduled
+ * messages, so it should be called right before GetMessagesForTimestep(). Returns UINT16_MAX if the
+ * schedule has no per-timestep budget.
+ */
+uint16_t GetTimestepSpareBytes(const MessageSchedule *schedule);
+
+/**
+ * Returns the bytes per second left in the per-second budget after the repeating messages, or
+ * UINT32_MAX if the schedule has no per-second budget.
+ */
+uint32_t GetSpareBps(const MessageSchedule *schedule);
+
+/**
+ * Returns what happened to the last message given to AddMessageRepeating() or AddMessageOnce().
+ */
+ScheduleResult GetScheduleResult(const MessageSchedule *schedule);
+
+/// These functions balance the load of several schedules dispatched from the same loop.
+
+/**
+ * Fills `load` with the estimated load of every timestep across all of the given schedules, which
+ * must share the same timebase. Every repeating message counts as its size plus
+ * MSCHED_MESSAGE_COST, while one-off messages are ignored.
+ * @param load An array of `TimestepCount` entries.
+ */
+void GetScheduleLoad(MessageSchedule *const schedules[], uint8_t scheduleCount, uint16_t load[]);
+
+/**
+ * Moves the repeating messages of several schedules that are dispatched from the same loop so that
+ * their combined load, as given by GetScheduleLoad(), is spread as evenly as possible. Every
+ * schedule places its own messages without knowing about the others, so their busiest timesteps
+ * can line up. This only changes the offsets of messages, not their rates, and still keeps to every
+ * schedule's per-timestep budget. It should be called again after any messages are added.
+ * @param load An array of `TimestepCount` entries. Filled with the balanced load on return.
+ * @return False if the schedules don't share the same timebase, in which case nothing is changed.
+ */
+bool BalanceSchedules(MessageSchedule *const schedules[], uint8_t scheduleCount, uint16_t load[]);
+
 #endif // MESSAGE_SCHEDULER_H
@@ -0,0 +1,554 @@
+#include "MissionTransfer.h"
+
+#include <string.h>
+
+void MissionTransferInit(MissionTransfer *t)
+{
+	memset(t, 0, sizeof(*t));
+	t->State = MISSION_TRANSFER_IDLE;
+	t->Timeout = MISSION_TRANSFER_INITIAL_TIMEOUT;
+}
+
+void MissionTransferTick(MissionTransfer *t)
+{
+	++t->Now;
+}
+
+/**
+ * Updates the retransmission timeout with a new round-trip time sample, see RFC 6298. Only
+ * requests that were sent once are sampled, as it's unknown which copy a reply to a retransmitted
+ * one belongs to.
+ */
+static void _RttSample(MissionTransfer *t, uint16_t rtt)
+{
+	if (rtt > MISSION_TRANSFER_MAX_TIMEOUT) {
+		rtt = MISSION_TRANSFER_MAX_TIMEOUT;
+	}
+	if (!t->RttValid) {
+		t->Srtt8 = rtt << 3;
+		t->Rttvar4 = rtt << 1;
+		t->RttValid = true;
+	} else {
+		int16_t err = (int16_t)rtt - (int16_t)(t->Srtt8 >> 3);
+		t->Srtt8 += err;
+		if (err < 0) {
+			err = -err;
+		}
+		err -= t->Rttvar4 >> 2;
+		t->Rttvar4 += err;
+	}
+
+	t->Timeout = (t->Srtt8 >> 3) + t->Rttvar4;
+	if (t->Timeout < MISSION_TRANSFER_MIN_TIMEOUT) {
+		t->Timeout = MISSION_TRANSFER_MIN_TIMEOUT;
+	} else if (t->Timeout > MISSION_TRANSFER_MAX_TIMEOUT) {
+		t->Timeout = MISSION_TRANSFER_MAX_TIMEOUT;
+	}
+}
+
+/**
+ * Doubles the timeout after a loss. It stays that long until a request that didn't need resending
+ * gives a new sample, so a link that got slower than the timeout still gets measured.
+ */
+static void _Backoff(MissionTransfer *t)
+{
+	t->Timeout = t->Timeout < MISSION_TRANSFER_MAX_TIMEOUT / 2 ? t->Timeout << 1 : MISSION_TRANSFER_MAX_TIMEOUT;
+}
+
+void MissionTransferStartReceive(MissionTransfer *t, uint16_t count)
+{
+	t->State = MISSION_TRANSFER_RECEIVING;
+	t->Count = count;
+	t->Base = 0;
+	t->Requested = 0;
+	t->Received = 0;
+}
+
+MissionItemResult MissionTransferItem(MissionTransfer *t, const mavlink_mission_item_t *item)
+{
+	if (t->State == MISSION_TRANSFER_COMPLETE) {
+		return item->seq < t->Count ? MISSION_ITEM_REACK : MISSION_ITEM_UNEXPECTED;
+	} else if (t->State != MISSION_TRANSFER_RECEIVING) {
+		return MISSION_ITEM_UNEXPECTED;
+	}
+
+	// Only items inside the window have room, anything earlier has been delivered already.
+	if (item->seq < t->Base || item->seq >= t->Base + MISSION_TRANSFER_WINDOW || item->seq >= t->Count) {
+		return MISSION_ITEM_IGNORED;
+	}
+	const uint8_t slot = item->seq % MISSION_TRANSFER_WINDOW;
+	const uint16_t bit = 1 << slot;
+	if (t->Received & bit) {
+		return MISSION_ITEM_IGNORED;
+	}
+
+	if ((t->Requested & bit) && t->Tries[slot] == 1) {
+		_RttSample(t, t->Now - t->SentAt[slot]);
+	}
+	t->Items[slot] = *item;
+	t->Received |= bit;
+	return MISSION_ITEM_NEW;
+}
+
+bool MissionTransferNext(MissionTransfer *t, mavlink_mission_item_t *item)
+{
+	if (t->State != MISSION_TRANSFER_RECEIVING) {
+		return false;
+	}
+	const uint8_t slot = t->Base % MISSION_TRANSFER_WINDOW;
+	const uint16_t bit = 1 << slot;
+	if (!(t->Received & bit)) {
+		return false;
+	}
+
+	*item = t->Items[slot];
+	t->Received &= ~bit;
+	t->Requested &= ~bit;
+	if (++t->Base == t->Count) {
+		t->State = MISSION_TRANSFER_COMPLETE;
+	}
+	return true;
+}
+
+void MissionTransferStartSend(MissionTransfer *t, uint16_t count)
+{
+	t->State = MISSION_TRANSFER_SENDING;
+	t->Count = count;
+	t->LastSent = MISSION_TRANSFER_COUNT;
+	t->LastSentAt = t->Now;
+	t->LastTries = 1;
+}
+
+bool MissionTransferRequest(MissionTransfer *t, uint16_t seq)
+{
+	if (t->State != MISSION_TRANSFER_SENDING || seq >= t->Count) {
+		return false;
+	}
+
+	// Only the first request is a reply to something the vehicle sent, later ones are paced by
+	// the groundstation.
+	if (t->LastSent == MISSION_TRANSFER_COUNT && t->LastTries == 1) {
+		_RttSample(t, t->Now - t->LastSentAt);
+	}
+	t->LastSent = seq;
+	t->LastSentAt = t->Now;
+	t->LastTries = 1;
+	return true;
+}
+
+void MissionTransferEnd(MissionTransfer *t)
+{
+	t->State = MISSION_TRANSFER_IDLE;
+}
+
+uint8_t MissionTransferDue(MissionTransfer *t, uint16_t seqs[])
+{
+	uint8_t n = 0;
+	bool lost = false;
+
+	if (t->State == MISSION_TRANSFER_RECEIVING) {
+		uint16_t seq;
+		for (seq = t->Base; seq < t->Base + MISSION_TRANSFER_WINDOW && seq < t->Count; ++seq) {
+			const uint8_t slot = seq % MISSION_TRANSFER_WINDOW;
+			const uint16_t bit = 1 << slot;
+			if (t->Received & bit) {
+				continue;
+			}
+			if (!(t->Requested & bit)) {
+				t->Requested |= bit;
+				t->Tries[slot] = 1;
+			} else if ((uint16_t)(t->Now - t->SentAt[slot]) >= t->Timeout) {
+				if (t->Tries[slot] >= MISSION_TRANSFER_MAX_TRIES) {
+					t->State = MISSION_TRANSFER_FAILED;
+					return 0;
+				}
+				++t->Tries[slot];
+				lost = true;
+			} else {
+				continue;
+			}
+			t->SentAt[slot] = t->Now;
+			seqs[n++] = seq;
+		}
+	} else if (t->State == MISSION_TRANSFER_SENDING) {
+		if ((uint16_t)(t->Now - t->LastSentAt) >= t->Timeout) {
+			if (t->LastTries >= MISSION_TRANSFER_MAX_TRIES) {
+				t->State = MISSION_TRANSFER_FAILED;
+				return 0;
+			}
+			++t->LastTries;
+			lost = true;
+			t->LastSentAt = t->Now;
+			seqs[n++] = t->LastSent;
+		}
+	}
+
+	// Back off once for everything that timed out together.
+	if (lost) {
+		_Backoff(t);
+	}
+	return n;
+}
+
+#ifdef UNIT_TEST_MISSION_TRANSFER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define TICK_RATE 100
+#define LINK_DELAY 5         // One-way latency of the radio, in ticks.
+#define LINK_RATE 16         // Bytes per tick in each direction, half of the 64kbps radio with ECC.
+#define ITEM_BYTES (MAVLINK_MSG_ID_MISSION_ITEM_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES)
+#define REQUEST_BYTES (MAVLINK_MSG_ID_MISSION_REQUEST_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES)
+#define ACK_BYTES (MAVLINK_MSG_ID_MISSION_ACK_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES)
+#define COUNT_BYTES (MAVLINK_MSG_ID_MISSION_COUNT_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES)
+#define GCS_TIMEOUT TICK_RATE // How long the groundstation waits for the vehicle before retrying.
+#define GCS_MAX_RETRIES 5     // How often the groundstation retries before restarting the upload.
+#define MAX_TICKS (600 * TICK_RATE)
+#define MAX_ITEMS 255
+#define OLD_RESEND_TIMEOUT 100 // MISSION_RESEND_TIMEOUT of the original protocol.
+
+typedef enum {
+	MSG_COUNT,
+	MSG_ITEM,
+	MSG_REQUEST,
+	MSG_ACK
+} SimMsgType;
+
+typedef struct {
+	SimMsgType type;
+	uint16_t seq;
+	uint32_t arrival;
+} SimMsg;
+
+// One direction of the radio: messages queue up behind each other at LINK_RATE and then take
+// LINK_DELAY to arrive, unless they're lost.
+typedef struct {
+	SimMsg msgs[256];
+	uint16_t head, count;
+	uint32_t busyUntil; // When the radio is done sending what's queued, in bytes since the start.
+	double loss;
+} SimPipe;
+
+static void PipeSend(SimPipe *p, uint32_t now, SimMsgType type, uint16_t seq, uint16_t bytes)
+{
+	if (p->busyUntil < now * LINK_RATE) {
+		p->busyUntil = now * LINK_RATE;
+	}
+	p->busyUntil += bytes;
+	if ((double)rand() / RAND_MAX < p->loss || p->count == 256) {
+		return;
+	}
+	SimMsg *m = &p->msgs[(p->head + p->count++) % 256];
+	m->type = type;
+	m->seq = seq;
+	m->arrival = (p->busyUntil + LINK_RATE - 1) / LINK_RATE + LINK_DELAY;
+}
+
+static bool PipeReceive(SimPipe *p, uint32_t now, SimMsg *m)
+{
+	if (!p->count || p->msgs[p->head].arrival > now) {
+		return false;
+	}
+	*m = p->msgs[p->head];
+	p->head = (p->head + 1) % 256;
+	--p->count;
+	return true;
+}
+
+// The original vehicle side of an upload: one request at a time, resent three times after a fixed
+// timeout before giving up.
+typedef struct {
+	bool active;
+	uint16_t count, current, timer;
+	uint8_t tries;
+} OldVehicle;
+
+/**
+ * Simulates uploading `count` items from a groundstation that answers every MISSION_REQUEST with
+ * its item, resends its last message if the vehicle goes quiet, and restarts the whole upload if
+ * that doesn't help or the vehicle rejects it.
+ * @return The ticks until the groundstation got the final MISSION_ACK, or MAX_TICKS.
+ */
+static uint32_t SimulateUpload(bool pipelined, uint16_t count, double loss, MissionTransfer *t)
+{
+	SimPipe up = {.loss = loss}, down = {.loss = loss};
+	OldVehicle old = {};
+	bool stored[MAX_ITEMS];
+	uint16_t storedCount = 0;
+	uint32_t gcsLastHeard = 0, now;
+	uint8_t gcsRetries = 0;
+	SimMsgType gcsLastType = MSG_COUNT;
+	uint16_t gcsLastSeq = 0;
+
+	// Round-trip estimates carry over between uploads in the vehicle, start each one afresh.
+	MissionTransferInit(t);
+	PipeSend(&up, 0, MSG_COUNT, count, COUNT_BYTES);
+
+	for (now = 0; now < MAX_TICKS; ++now) {
+		SimMsg m;
+		uint16_t seqs[MISSION_TRANSFER_WINDOW];
+		uint8_t n, i;
+
+		// The vehicle.
+		MissionTransferTick(t);
+		while (PipeReceive(&up, now, &m)) {
+			if (m.type == MSG_COUNT) {
+				memset(stored, 0, sizeof(stored));
+				storedCount = 0;
+				if (pipelined) {
+					MissionTransferStartReceive(t, m.seq);
+				} else {
+					old = (OldVehicle){true, m.seq, 0, 0, 1};
+					PipeSend(&down, now, MSG_REQUEST, 0, REQUEST_BYTES);
+				}
+			} else if (m.type == MSG_ITEM) {
+				if (pipelined) {
+					mavlink_mission_item_t item = {.seq = m.seq};
+					MissionItemResult r = MissionTransferItem(t, &item);
+					if (r == MISSION_ITEM_NEW) {
+						while (MissionTransferNext(t, &item)) {
+							assert(item.seq == storedCount && !stored[item.seq]);
+							stored[item.seq] = true;
+							++storedCount;
+						}
+						if (t->State == MISSION_TRANSFER_COMPLETE) {
+							PipeSend(&down, now, MSG_ACK, MAV_MISSION_ACCEPTED, ACK_BYTES);
+						}
+					} else if (r == MISSION_ITEM_REACK) {
+						PipeSend(&down, now, MSG_ACK, MAV_MISSION_ACCEPTED, ACK_BYTES);
+					}
+				} else if (old.active && m.seq == old.current) {
+					++storedCount;
+					if (++old.current == old.count) {
+						old.active = false;
+						PipeSend(&down, now, MSG_ACK, MAV_MISSION_ACCEPTED, ACK_BYTES);
+					} else {
+						old.timer = 0;
+						old.tries = 1;
+						PipeSend(&down, now, MSG_REQUEST, old.current, REQUEST_BYTES);
+					}
+				} else if (!old.active) {
+					// The original protocol rejects items while it's idle.
+					PipeSend(&down, now, MSG_ACK, MAV_MISSION_ERROR, ACK_BYTES);
+				}
+			}
+		}
+		if (pipelined) {
+			n = MissionTransferDue(t, seqs);
+			for (i = 0; i < n; ++i) {
+				PipeSend(&down, now, MSG_REQUEST, seqs[i], REQUEST_BYTES);
+			}
+			if (t->State == MISSION_TRANSFER_FAILED) {
+				PipeSend(&down, now, MSG_ACK, MAV_MISSION_ERROR, ACK_BYTES);
+				MissionTransferEnd(t);
+			}
+		} else if (old.active && ++old.timer >= OLD_RESEND_TIMEOUT) {
+			if (old.tries == 3) {
+				old.active = false;
+			} else {
+				++old.tries;
+				old.timer = 0;
+				PipeSend(&down, now, MSG_REQUEST, old.current, REQUEST_BYTES);
+			}
+		}
+
+		// The groundstation.
+		while (PipeReceive(&down, now, &m)) {
+			gcsLastHeard = now;
+			gcsRetries = 0;
+			if (m.type == MSG_REQUEST && m.seq < count) {
+				gcsLastType = MSG_ITEM;
+				gcsLastSeq = m.seq;
+				PipeSend(&up, now, MSG_ITEM, m.seq, ITEM_BYTES);
+			} else if (m.type == MSG_ACK) {
+				if (m.seq == MAV_MISSION_ACCEPTED) {
+					assert(storedCount == count);
+					return now + 1;
+				}
+				gcsLastType = MSG_COUNT;
+				PipeSend(&up, now, MSG_COUNT, count, COUNT_BYTES);
+			}
+		}
+		if (now - gcsLastHeard >= GCS_TIMEOUT) {
+			gcsLastHeard = now;
+			if (++gcsRetries > GCS_MAX_RETRIES) {
+				gcsRetries = 0;
+				gcsLastType = MSG_COUNT;
+			}
+			if (gcsLastType == MSG_COUNT) {
+				PipeSend(&up, now, MSG_COUNT, count, COUNT_BYTES);
+			} else {
+				PipeSend(&up, now, MSG_ITEM, gcsLastSeq, ITEM_BYTES);
+			}
+		}
+	}
+	return MAX_TICKS;
+}
+
+int main(void)
+{
+	MissionTransfer t;
+	mavlink_mission_item_t item = {};
+	uint16_t seqs[MISSION_TRANSFER_WINDOW];
+	uint8_t n, i;
+
+	// An upload requests a full window at once, then only what's missing.
+	MissionTransferInit(&t);
+	MissionTransferStartReceive(&t, 10);
+	n = MissionTransferDue(&t, seqs);
+	assert(n == MISSION_TRANSFER_WINDOW);
+	for (i = 0; i < n; ++i) {
+		assert(seqs[i] == i);
+	}
+	assert(MissionTransferDue(&t, seqs) == 0);
+
+	// Items arriving out of order are held back until the gap is filled.
+	for (i = 0; i < 3; ++i) {
+		MissionTransferTick(&t);
+	}
+	item.seq = 1;
+	assert(MissionTransferItem(&t, &item) == MISSION_ITEM_NEW);
+	assert(MissionTransferItem(&t, &item) == MISSION_ITEM_IGNORED);
+	assert(!MissionTransferNext(&t, &item));
+	item.seq = 9;
+	assert(MissionTransferItem(&t, &item) == MISSION_ITEM_IGNORED);
+	item.seq = 0;
+	assert(MissionTransferItem(&t, &item) == MISSION_ITEM_NEW);
+	assert(MissionTransferNext(&t, &item) && item.seq == 0);
+	assert(MissionTransferNext(&t, &item) && item.seq == 1);
+	assert(!MissionTransferNext(&t, &item));
+	assert(t.RttValid && t.Timeout == MISSION_TRANSFER_MIN_TIMEOUT);
+
+	// The window slides along, and the gaps are re-requested after the timeout.
+	n = MissionTransferDue(&t, seqs);
+	assert(n == 2 && seqs[0] == 8 && seqs[1] == 9);
+	for (i = 0; i < MISSION_TRANSFER_MIN_TIMEOUT - 3; ++i) {
+		MissionTransferTick(&t);
+	}
+	n = MissionTransferDue(&t, seqs);
+	assert(n == 6 && seqs[0] == 2 && seqs[5] == 7);
+	for (i = 2; i < 10; ++i) {
+		item.seq = i;
+		assert(MissionTransferItem(&t, &item) == MISSION_ITEM_NEW);
+		assert(MissionTransferNext(&t, &item) && item.seq == i);
+	}
+	assert(t.State == MISSION_TRANSFER_COMPLETE);
+
+	// A resent item of the completed upload is acknowledged again.
+	item.seq = 9;
+	assert(MissionTransferItem(&t, &item) == MISSION_ITEM_REACK);
+	item.seq = 10;
+	assert(MissionTransferItem(&t, &item) == MISSION_ITEM_UNEXPECTED);
+	printf("Uploads are windowed and delivered in order.\n");
+
+	// Requests back off exponentially and the upload is given up on eventually.
+	{
+		uint32_t ticks = 0, sends = 0;
+		MissionTransferInit(&t);
+		MissionTransferStartReceive(&t, 1);
+		while (t.State == MISSION_TRANSFER_RECEIVING) {
+			sends += MissionTransferDue(&t, seqs);
+			MissionTransferTick(&t);
+			++ticks;
+		}
+		assert(t.State == MISSION_TRANSFER_FAILED && sends == MISSION_TRANSFER_MAX_TRIES);
+		assert(ticks > 100 + 200 + 300 + 300 && ticks < 100 + 200 + 300 + 300 + 300 + 2);
+		printf("Gave up after %u sends over %u ticks.\n", sends, ticks);
+	}
+
+	// Round-trip times drive the timeout, which adapts to a slower link.
+	{
+		uint16_t rtt;
+		MissionTransferInit(&t);
+		for (rtt = 20; rtt <= 60; rtt += 40) {
+			// Every item comes back exactly `rtt` ticks after it was requested.
+			uint16_t replyAt[50], s, delivered = 0;
+			MissionTransferStartReceive(&t, 50);
+			while (delivered < 50) {
+				n = MissionTransferDue(&t, seqs);
+				for (i = 0; i < n; ++i) {
+					replyAt[seqs[i]] = t.Now + rtt;
+				}
+				MissionTransferTick(&t);
+				for (s = delivered; s < delivered + MISSION_TRANSFER_WINDOW && s < 50; ++s) {
+					if ((t.Requested & (1 << (s % MISSION_TRANSFER_WINDOW))) && replyAt[s] == t.Now) {
+						item.seq = s;
+						assert(MissionTransferItem(&t, &item) == MISSION_ITEM_NEW);
+					}
+				}
+				while (MissionTransferNext(&t, &item)) {
+					++delivered;
+				}
+			}
+			printf("Round trips of %u ticks give a timeout of %u ticks.\n", rtt, t.Timeout);
+			assert(t.Timeout >= rtt && t.Timeout < rtt + rtt / 2 + MISSION_TRANSFER_MIN_TIMEOUT);
+		}
+	}
+
+	// Downloads answer any request, and resend the count and the last item if nothing comes back.
+	MissionTransferInit(&t);
+	MissionTransferStartSend(&t, 3);
+	assert(!MissionTransferRequest(&t, 3));
+	for (i = 0; i < MISSION_TRANSFER_INITIAL_TIMEOUT - 1; ++i) {
+		MissionTransferTick(&t);
+		assert(MissionTransferDue(&t, seqs) == 0);
+	}
+	MissionTransferTick(&t);
+	assert(MissionTransferDue(&t, seqs) == 1 && seqs[0] == MISSION_TRANSFER_COUNT);
+	MissionTransferTick(&t);
+	assert(MissionTransferRequest(&t, 2));
+	assert(MissionTransferRequest(&t, 0));
+	assert(!t.RttValid && t.Timeout == 2 * MISSION_TRANSFER_INITIAL_TIMEOUT);
+	for (i = 0; i < 2 * MISSION_TRANSFER_INITIAL_TIMEOUT - 1; ++i) {
+		MissionTransferTick(&t);
+	}
+	assert(MissionTransferDue(&t, seqs) == 0);
+	MissionTransferTick(&t);
+	assert(MissionTransferDue(&t, seqs) == 1 && seqs[0] == 0);
+	MissionTransferEnd(&t);
+	assert(MissionTransferDue(&t, seqs) == 0);
+	item.seq = 0;
+	assert(MissionTransferItem(&t, &item) == MISSION_ITEM_UNEXPECTED);
+	printf("Downloads answer requests in any order.\n");
+
+	// And finally compare upload times with the original protocol.
+	{
+		const uint16_t sizes[] = {10, 50, 100, 255};
+		const double losses[] = {0, 0.05, 0.1, 0.2};
+		uint8_t s, l;
+		srand(1);
+		printf("\nUpload time in seconds, original / pipelined, at %u B/s with %ums latency:\n",
+		       LINK_RATE * TICK_RATE, LINK_DELAY * 1000 / TICK_RATE);
+		printf("%-6s", "items");
+		for (l = 0; l < sizeof(losses) / sizeof(losses[0]); ++l) {
+			printf(" %10.0f%% loss", losses[l] * 100);
+		}
+		printf("\n");
+		for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+			printf("%-6u", sizes[s]);
+			for (l = 0; l < sizeof(losses) / sizeof(losses[0]); ++l) {
+				// Average a few runs, as losses make every run different.
+				uint32_t oldTicks = 0, newTicks = 0;
+				uint8_t run;
+				for (run = 0; run < 5; ++run) {
+					oldTicks += SimulateUpload(false, sizes[s], losses[l], &t);
+					const uint32_t ticks = SimulateUpload(true, sizes[s], losses[l], &t);
+					assert(ticks < MAX_TICKS);
+					newTicks += ticks;
+				}
+				printf(" %8.1f / %5.1f", oldTicks / 5.0 / TICK_RATE, newTicks / 5.0 / TICK_RATE);
+				if (losses[l] == 0) {
+					assert(newTicks < oldTicks);
+				}
+			}
+			printf("\n");
+		}
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_MISSION_TRANSFER
@@ -0,0 +1,153 @@
+/**
+ * @file   MissionTransfer.h
+ * @brief  Pipelined MAVLink mission protocol transfers with adaptive timeouts.
+ *
+ * The MAVLink mission protocol has the vehicle request every item of an upload with a
+ * MISSION_REQUEST. Doing that one item at a time costs a full round trip per item, and a lost
+ * message stalls the upload for a whole fixed timeout. A MissionTransfer instead:
+ *  * Keeps up to MISSION_TRANSFER_WINDOW requests outstanding. Groundstations answer every
+ *    MISSION_REQUEST with the item it asks for, so this needs nothing special from them.
+ *  * Tracks which items of the window have arrived in a bitmap and only re-requests the gaps.
+ *    Items that arrive out of order are held back, so they're still delivered in order.
+ *  * Times out requests after an adaptive retransmission timeout, estimated from the measured
+ *    round-trip times like TCP does (RFC 6298), with exponential backoff on repeated losses.
+ *  * Acknowledges a completed upload again if the groundstation resends its last item because the
+ *    first MISSION_ACK was lost.
+ *
+ * Downloads are driven by the groundstation's requests, so here the vehicle answers requests for
+ * any item in any order. MISSION_COUNT is resent until the first request arrives, and the last item
+ * sent is resent if the groundstation goes quiet, using the same timeout.
+ *
+ * All timing is in ticks of MissionTransferTick(), which should be called at a constant rate.
+ *
+ * Unit testing, which includes a simulation of upload times against mission size and packet loss
+ * for both this and the original one-item-at-a-time protocol, is done on x86 by compiling with the
+ * UNIT_TEST_MISSION_TRANSFER macro:
+ * `gcc MissionTransfer.c -DUNIT_TEST_MISSION_TRANSFER -I../MAVLink/seaslug -O2 -Wall`
+ */
+#ifndef MISSION_TRANSFER_H
+#define MISSION_TRANSFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <mavlink.h>
+
+// The most MISSION_REQUESTs outstanding at once during an upload. At most 16.
+#define MISSION_TRANSFER_WINDOW 8
+
+// How often a single request or item is sent before the transfer is given up on.
+#define MISSION_TRANSFER_MAX_TRIES 5
+
+// Bounds on the retransmission timeout, and the timeout used before any round trip was measured.
+// In ticks.
+#define MISSION_TRANSFER_MIN_TIMEOUT 10
+#define MISSION_TRANSFER_MAX_TIMEOUT 300
+#define MISSION_TRANSFER_INITIAL_TIMEOUT 100
+
+// Returned by MissionTransferDue() during a download to resend MISSION_COUNT.
+#define MISSION_TRANSFER_COUNT UINT16_MAX
+
+typedef enum {
+	MISSION_TRANSFER_IDLE,
+	MISSION_TRANSFER_RECEIVING, // An upload from the groundstation is underway.
+	MISSION_TRANSFER_SENDING,   // A download to the groundstation is underway.
+	MISSION_TRANSFER_COMPLETE,  // The last upload was received completely.
+	MISSION_TRANSFER_FAILED     // The last transfer was given up on after too many losses.
+} MissionTransferState;
+
+/**
+ * What to do with a received MISSION_ITEM, see MissionTransferItem().
+ */
+typedef enum {
+	MISSION_ITEM_NEW,        // A new item, deliver what's ready with MissionTransferNext().
+	MISSION_ITEM_IGNORED,    // A duplicate, or an item that wasn't requested yet.
+	MISSION_ITEM_REACK,      // Part of the upload that just completed, so acknowledge it again.
+	MISSION_ITEM_UNEXPECTED  // No upload is underway.
+} MissionItemResult;
+
+/**
+ * The state of a mission transfer. Initialize with MissionTransferInit(), after which it's idle.
+ */
+typedef struct {
+	MissionTransferState State;
+	uint16_t Count;     // Items in the mission being transferred.
+	uint16_t Now;       // The current time in ticks.
+
+	// Uploads. Every item in [Base, Base + MISSION_TRANSFER_WINDOW) has the slot `seq % WINDOW`.
+	uint16_t Base;      // The first item not delivered yet, all earlier ones have been.
+	uint16_t Requested; // Bitmap of slots with a request sent.
+	uint16_t Received;  // Bitmap of slots with their item received and waiting for delivery.
+	uint16_t SentAt[MISSION_TRANSFER_WINDOW]; // When each slot's request was last sent.
+	uint8_t Tries[MISSION_TRANSFER_WINDOW];   // How often each slot's request was sent.
+	mavlink_mission_item_t Items[MISSION_TRANSFER_WINDOW];
+
+	// Downloads.
+	uint16_t LastSent;  // The item sent last, or MISSION_TRANSFER_COUNT before the first request.
+	uint16_t LastSentAt;
+	uint8_t LastTries;
+
+	// The round-trip time estimator, in ticks. Kept across transfers.
+	uint16_t Srtt8;     // The smoothed round-trip time, times 8.
+	uint16_t Rttvar4;   // The round-trip time variation, times 4.
+	uint16_t Timeout;   // The current retransmission timeout.
+	bool RttValid;      // Whether any round trip was measured yet.
+} MissionTransfer;
+
+/**
+ * Resets a transfer to idle with the initial timeout.
+ */
+void MissionTransferInit(MissionTransfer *t);
+
+/**
+ * Advances time by one tick.
+ */
+void MissionTransferTick(MissionTransfer *t);
+
+/**
+ * Starts receiving an upload of `count` items, after a MISSION_COUNT. Any other transfer is
+ * abandoned. The first requests are returned by the next MissionTransferDue().
+ */
+void MissionTransferStartReceive(MissionTransfer *t, uint16_t count);
+
+/**
+ * Handles a received MISSION_ITEM.
+ */
+MissionItemResult MissionTransferItem(MissionTransfer *t, const mavlink_mission_item_t *item);
+
+/**
+ * Takes the next item of an upload that's ready to be stored, in order.
+ * @return False if the next item hasn't arrived yet.
+ */
+bool MissionTransferNext(MissionTransfer *t, mavlink_mission_item_t *item);
+
+/**
+ * Starts a download of `count` items, after a MISSION_REQUEST_LIST. Any other transfer is abandoned.
+ * The caller sends the first MISSION_COUNT.
+ */
+void MissionTransferStartSend(MissionTransfer *t, uint16_t count);
+
+/**
+ * Handles a received MISSION_REQUEST during a download.
+ * @return True if the item should be sent. False if no download is underway or `seq` is out of
+ *         range.
+ */
+bool MissionTransferRequest(MissionTransfer *t, uint16_t seq);
+
+/**
+ * Ends the current transfer, after a MISSION_ACK from the groundstation or when the vehicle
+ * rejects an upload.
+ */
+void MissionTransferEnd(MissionTransfer *t);
+
+/**
+ * Returns what's due to be sent now, marking it as sent. During an upload these are the items to
+ * request with MISSION_REQUEST. During a download it's the item to resend, or
+ * MISSION_TRANSFER_COUNT to resend MISSION_COUNT. If a transfer ran out of tries it moves to
+ * MISSION_TRANSFER_FAILED instead.
+ * @param seqs An array of MISSION_TRANSFER_WINDOW entries.
+ * @return The number of entries in `seqs`.
+ */
+uint8_t MissionTransferDue(MissionTransfer *t, uint16_t seqs[]);
+
+#endif // MISSION_TRANSFER_H
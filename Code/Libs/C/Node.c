@@ -20,5 +20,5 @@ bool NodeTransmitStatus(void)
 {
     CanMessagePackageStatus(&msg, nodeId, nodeCpuLoad, nodeTemp, nodeVoltage, nodeStatus,
                             nodeErrors);
-    return Ecan1Transmit(&msg);
+    return Ecan1TransmitPriority(&msg, ECAN_TX_PRIORITY_LOW);
 }
\ No newline at end of file
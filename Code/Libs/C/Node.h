@@ -17,7 +17,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#if defined(__XC16__)
 #include <xc.h>
+#endif
 
 /**
  * This enum declares the IDs for every node that is in this
@@ -45,9 +47,16 @@ enum CAN_NODE_ID {
 
 /**
  * This macro provides a way to handle fatal errors on the CAN node, where a red error LED is
- * available. This macro turns that LED on then sits and spins in a forever-loop.
+ * available. This macro turns that LED on then sits and spins in a forever-loop. Node code built
+ * for the host has no LED, so it reports where it failed and aborts instead.
  */
+#if defined(__XC16__)
 #define FATAL_ERROR() _TRISA3=0;_LATA3=1;while(1)
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#define FATAL_ERROR() fprintf(stderr, "Fatal error at %s:%d\n", __FILE__, __LINE__);abort()
+#endif
 
 /**
  * This bitfield stores the various status bits for each CAN node.
@@ -0,0 +1,141 @@
+#define _GNU_SOURCE
+#include "NodeHost.h"
+#include "Ecan1Host.h"
+#include "DataStore.h"
+#include "Node.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+// The timestep of the main loop, in ns.
+#define NODE_HOST_TIMESTEP 10000000L
+
+static const char *nodeName;
+static uint32_t ticks;
+static uint32_t endTick = UINT32_MAX;
+static struct timespec nextTick;
+static volatile sig_atomic_t stop = 0;
+
+static void Stop(int signal)
+{
+	(void)signal;
+	stop = 1;
+}
+
+static void Usage(void)
+{
+	fprintf(stderr, "Usage: %s [-b bus | -s ifname] [-r bitrate] [-l ppm] [-t seconds]\n", nodeName);
+	exit(EXIT_FAILURE);
+}
+
+void NodeHostInit(const char *name, int argc, char *argv[])
+{
+	static VirtualCanConfig config = {NODE_CAN_BAUD, 0, 1};
+	const char *bus = "autoboat";
+	bool socketCan = false;
+	char *end;
+	int opt;
+
+	nodeName = name;
+	config.Seed = getpid();
+	while ((opt = getopt(argc, argv, "b:s:r:l:t:")) != -1) {
+		switch (opt) {
+		case 'b':
+			bus = optarg;
+			socketCan = false;
+			break;
+		case 's':
+			bus = optarg;
+			socketCan = true;
+			break;
+		case 'r':
+			config.BitRate = strtoul(optarg, &end, 10);
+			if (*end) {
+				Usage();
+			}
+			break;
+		case 'l':
+			config.LossPpm = strtoul(optarg, &end, 10);
+			if (*end || config.LossPpm > 1000000) {
+				Usage();
+			}
+			break;
+		case 't':
+			endTick = strtoul(optarg, &end, 10) * 100;
+			if (*end) {
+				Usage();
+			}
+			break;
+		default:
+			Usage();
+		}
+	}
+	if (optind != argc) {
+		Usage();
+	}
+	Ecan1HostSetBus(bus, socketCan, &config);
+
+	signal(SIGINT, Stop);
+	signal(SIGTERM, Stop);
+	clock_gettime(CLOCK_MONOTONIC, &nextTick);
+}
+
+bool NodeHostTick(void)
+{
+	struct timespec now;
+
+	if (stop || ticks >= endTick) {
+		return false;
+	}
+
+	nextTick.tv_nsec += NODE_HOST_TIMESTEP;
+	if (nextTick.tv_nsec >= 1000000000L) {
+		nextTick.tv_nsec -= 1000000000L;
+		++nextTick.tv_sec;
+	}
+	// If the process was held up for over a second, skip ahead instead of catching up.
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (now.tv_sec > nextTick.tv_sec + 1) {
+		nextTick = now;
+	}
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextTick, NULL) && !stop);
+
+	++ticks;
+	if (nodeSystemTime < UINT32_MAX) {
+		++nodeSystemTime;
+	}
+	return !stop;
+}
+
+bool NodeHostEvery(unsigned rate)
+{
+	return rate && (ticks * rate) % 100 < rate;
+}
+
+void NodeHostExit(void)
+{
+	VirtualCanStats stats;
+	Ecan1HostGetStats(&stats);
+	printf("%s: sent %u, received %u, filtered %u, lost %u, overflowed %u\n", nodeName,
+	       stats.Sent, stats.Received, stats.Filtered, stats.Lost, stats.Overflows);
+	Ecan1HostClose();
+}
+
+enum DATASTORE_INIT DataStoreInit(void)
+{
+	return DATASTORE_INIT_PRELOADED;
+}
+
+bool DataStoreSaveParameters(void)
+{
+	return true;
+}
+
+bool DataStoreLoadParameters(void)
+{
+	return false;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file   NodeHost.h
+ * @brief  The main loop of node code running as a Linux process.
+ *
+ * A node built for the host (see Ecan1Host.h) replaces its hardware main() with one that calls
+ * NodeHostInit() with its command line, then its init function, and then runs its 100Hz tasks
+ * every time NodeHostTick() returns true. Every node takes the same options:
+ *  * `-b name` attaches to the shared memory bus `name` instead of "autoboat".
+ *  * `-s ifname` attaches to a SocketCAN interface like vcan0 instead.
+ *  * `-r bitrate` sets the bit rate of a new shared memory bus, instead of NODE_CAN_BAUD. 0 sends
+ *    frames instantly.
+ *  * `-l ppm` makes the node miss received frames at random, in parts per million.
+ *  * `-t seconds` stops the node after that long, instead of running until it's interrupted.
+ *
+ * There's no EEPROM on the host, so NodeHost.c also stands in for DataStore.c: nodes start as if
+ * their EEPROM was empty, and parameters aren't kept.
+ */
+#ifndef NODE_HOST_H
+#define NODE_HOST_H
+
+#include <stdbool.h>
+
+/**
+ * Picks the bus from the command line. Prints the usage and exits if it's invalid.
+ * @param name The node's name, for messages.
+ */
+void NodeHostInit(const char *name, int argc, char *argv[]);
+
+/**
+ * Waits for the next 100Hz timestep, keeping real time, and advances nodeSystemTime.
+ * @return False once the node should stop, because it was interrupted or its time is up.
+ */
+bool NodeHostTick(void);
+
+/**
+ * Returns whether this timestep is one of `rate` evenly spread timesteps every second.
+ */
+bool NodeHostEvery(unsigned rate);
+
+/**
+ * Prints the node's bus statistics and detaches it from the bus.
+ */
+void NodeHostExit(void);
+
+#endif // NODE_HOST_H
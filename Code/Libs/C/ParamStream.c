@@ -0,0 +1,322 @@
+#include "ParamStream.h"
+
+#include <string.h>
+
+void ParamStreamInit(ParamStream *s, uint16_t count, uint8_t messageSize, uint16_t tickRate, uint16_t burstBytes)
+{
+	memset(s, 0, sizeof(*s));
+	s->Count = count;
+	s->MessageSize = messageSize;
+	s->TickRate = tickRate;
+	// Never cap the credit below a single message, or the stream could never send anything.
+	s->CreditLimit = (uint32_t)(burstBytes > messageSize ? burstBytes : messageSize) * tickRate;
+}
+
+void ParamStreamRequestAll(ParamStream *s, uint8_t passes)
+{
+	s->Next = 0;
+	s->Remaining = s->Count * passes;
+	s->Credit = s->CreditLimit;
+}
+
+bool ParamStreamRequestOne(ParamStream *s, uint16_t index)
+{
+	uint8_t i;
+	if (index >= s->Count) {
+		return false;
+	}
+	for (i = 0; i < s->RequestCount; ++i) {
+		if (s->Requests[i] == index) {
+			return true;
+		}
+	}
+	if (s->RequestCount == PARAM_STREAM_MAX_REQUESTS) {
+		return false;
+	}
+	s->Requests[s->RequestCount++] = index;
+	return true;
+}
+
+bool ParamStreamBusy(const ParamStream *s)
+{
+	return s->Remaining || s->RequestCount;
+}
+
+uint8_t ParamStreamTick(ParamStream *s, uint32_t bytesPerSecond, uint16_t timestepBytes,
+                        uint16_t indices[], uint8_t maxIndices)
+{
+	const uint32_t cost = (uint32_t)s->MessageSize * s->TickRate;
+	uint8_t n = 0, taken = 0;
+
+	// Credit only accrues while there's something to stream, so an idle stream doesn't save up more
+	// than a single burst.
+	if (s->Remaining) {
+		s->Credit += bytesPerSecond;
+		if (s->Credit > s->CreditLimit) {
+			s->Credit = s->CreditLimit;
+		}
+	}
+
+	// Individual requests go first. They're rare and a groundstation waits for every one of them, so
+	// they only have to fit into this timestep, though they still use up credit.
+	while (n < maxIndices && taken < s->RequestCount && timestepBytes >= s->MessageSize) {
+		indices[n++] = s->Requests[taken++];
+		timestepBytes -= s->MessageSize;
+		s->Credit = s->Credit > cost ? s->Credit - cost : 0;
+	}
+	if (taken) {
+		s->RequestCount -= taken;
+		memmove(s->Requests, &s->Requests[taken], s->RequestCount * sizeof(s->Requests[0]));
+	}
+
+	// And then as much of the stream as the credit pays for.
+	while (n < maxIndices && s->Remaining && timestepBytes >= s->MessageSize && s->Credit >= cost) {
+		indices[n++] = s->Next;
+		timestepBytes -= s->MessageSize;
+		s->Credit -= cost;
+		if (++s->Next == s->Count) {
+			s->Next = 0;
+		}
+		--s->Remaining;
+	}
+
+	return n;
+}
+
+#ifdef UNIT_TEST_PARAM_STREAM
+
+#include <stdio.h>
+#include <assert.h>
+
+#define TICK_RATE 100
+#define PARAM_SIZE 33          // A MAVLink 1 PARAM_VALUE frame.
+#define AIR_RATE 3200          // The 64kbps radio link with ECC, in bytes per second.
+#define TELEMETRY_RATE 1205    // The groundstation schedule's telemetry, in bytes per second.
+#define SECOND_BUDGET 2560     // The groundstation schedule's per-second budget.
+#define TIMESTEP_BUDGET 256    // The groundstation schedule's per-timestep budget.
+#define BURST_BYTES 512
+#define RADIO_BUFFER 1024      // Bytes the radio buffers before it drops frames. An assumption.
+#define GCS_TIMEOUT TICK_RATE  // How long the groundstation waits for progress before retrying.
+#define GCS_RETRY_BATCH 8      // How many missing parameters the groundstation requests per retry.
+#define MAX_PARAMS 200
+#define MAX_TICKS (60 * TICK_RATE)
+
+typedef enum {
+	SIM_OLD, // One parameter per timestep, requests for single parameters are ignored while streaming.
+	SIM_STREAM
+} SimMethod;
+
+// A frame on its way through the radio, with the parameter it carries or -1 for telemetry.
+typedef struct {
+	uint16_t bytes;
+	int16_t param;
+} SimFrame;
+
+#define SIM_MAX_FRAMES 256
+
+/**
+ * Simulates a groundstation connecting over the radio and downloading `count` parameters while
+ * telemetry keeps flowing. The groundstation re-requests parameters individually once the stream
+ * stalls, like QGroundControl does.
+ * @return The time until the groundstation had every parameter, in timesteps.
+ */
+static uint32_t SimulateConnect(SimMethod method, uint16_t count, uint32_t *dropped, uint32_t *sent)
+{
+	SimFrame frames[SIM_MAX_FRAMES];
+	uint16_t head = 0, frameCount = 0;
+	uint32_t buffered = 0, aired = 0, airCredit = 0;
+	bool received[MAX_PARAMS] = {};
+	uint16_t receivedCount = 0;
+	uint32_t lastProgress = 0;
+	uint16_t retryLeft = 0, retryCursor = 0;
+	int32_t readRequest = -1; // Crosses the uplink during the next timestep.
+	bool listRequest = true;
+
+	ParamStream s;
+	uint16_t oldNext = count, oldSingle = UINT16_MAX;
+	ParamStreamInit(&s, count, PARAM_SIZE, TICK_RATE, BURST_BYTES);
+	*dropped = *sent = 0;
+
+	uint32_t t;
+	for (t = 0; t < MAX_TICKS; ++t) {
+		uint16_t indices[TIMESTEP_BUDGET / PARAM_SIZE];
+		uint8_t n = 0, i;
+
+		// Telemetry spread evenly over the second.
+		const uint16_t telemetry = (uint16_t)((uint32_t)TELEMETRY_RATE * (t + 1) / TICK_RATE - (uint32_t)TELEMETRY_RATE * t / TICK_RATE);
+
+		// Handle the groundstation's requests and pick the parameters to send.
+		if (method == SIM_OLD) {
+			if (oldNext == count && oldSingle == UINT16_MAX) {
+				if (listRequest) {
+					oldNext = 0;
+				} else if (readRequest >= 0) {
+					oldSingle = (uint16_t)readRequest;
+				}
+			}
+			if (oldSingle != UINT16_MAX) {
+				indices[n++] = oldSingle;
+				oldSingle = UINT16_MAX;
+			} else if (oldNext < count) {
+				indices[n++] = oldNext++;
+			}
+		} else {
+			if (listRequest) {
+				ParamStreamRequestAll(&s, 1);
+			} else if (readRequest >= 0) {
+				ParamStreamRequestOne(&s, (uint16_t)readRequest);
+			}
+			n = ParamStreamTick(&s, SECOND_BUDGET - TELEMETRY_RATE, TIMESTEP_BUDGET - telemetry, indices,
+			                    sizeof(indices) / sizeof(indices[0]));
+		}
+		listRequest = false;
+		readRequest = -1;
+
+		// Queue everything at the radio, which drops whatever doesn't fit.
+		SimFrame queued[1 + sizeof(indices) / sizeof(indices[0])];
+		queued[0] = (SimFrame){telemetry, -1};
+		for (i = 0; i < n; ++i) {
+			queued[i + 1] = (SimFrame){PARAM_SIZE, (int16_t)indices[i]};
+		}
+		*sent += n;
+		for (i = 0; i <= n; ++i) {
+			if (buffered + queued[i].bytes > RADIO_BUFFER || frameCount == SIM_MAX_FRAMES) {
+				if (queued[i].param >= 0) {
+					++*dropped;
+				}
+				continue;
+			}
+			frames[(head + frameCount++) % SIM_MAX_FRAMES] = queued[i];
+			buffered += queued[i].bytes;
+		}
+
+		// Air whatever the radio can carry this timestep, delivering every completed frame.
+		airCredit += AIR_RATE;
+		while (frameCount && airCredit >= TICK_RATE) {
+			const uint32_t chunk = airCredit / TICK_RATE;
+			const SimFrame *f = &frames[head];
+			const uint32_t left = f->bytes - aired;
+			if (chunk < left) {
+				aired += chunk;
+				airCredit -= chunk * TICK_RATE;
+				break;
+			}
+			airCredit -= left * TICK_RATE;
+			buffered -= f->bytes;
+			aired = 0;
+			if (f->param >= 0 && !received[f->param]) {
+				received[f->param] = true;
+				++receivedCount;
+				lastProgress = t;
+			}
+			head = (head + 1) % SIM_MAX_FRAMES;
+			--frameCount;
+		}
+		if (!frameCount) {
+			airCredit = 0;
+		}
+
+		if (receivedCount == count) {
+			return t + 1;
+		}
+
+		// The groundstation requests missing parameters one per timestep once the stream stalls.
+		if (!retryLeft && t - lastProgress >= GCS_TIMEOUT) {
+			retryLeft = GCS_RETRY_BATCH;
+			lastProgress = t;
+		}
+		if (retryLeft) {
+			while (received[retryCursor]) {
+				retryCursor = (retryCursor + 1) % count;
+			}
+			readRequest = retryCursor;
+			retryCursor = (retryCursor + 1) % count;
+			--retryLeft;
+		}
+	}
+	return MAX_TICKS;
+}
+
+int main(void)
+{
+	ParamStream s;
+	uint16_t indices[16];
+	uint8_t n;
+	uint32_t i;
+
+	// An idle stream sends nothing.
+	ParamStreamInit(&s, 10, PARAM_SIZE, TICK_RATE, 100);
+	assert(!ParamStreamBusy(&s));
+	assert(ParamStreamTick(&s, 10000, 1000, indices, 16) == 0);
+
+	// A new stream starts with a full burst, but no more than fits into the timestep.
+	ParamStreamRequestAll(&s, 1);
+	assert(ParamStreamBusy(&s));
+	n = ParamStreamTick(&s, 0, 1000, indices, 16);
+	assert(n == 3 && indices[0] == 0 && indices[1] == 1 && indices[2] == 2);
+	assert(ParamStreamTick(&s, 0, 1000, indices, 16) == 0);
+	ParamStreamRequestAll(&s, 1);
+	n = ParamStreamTick(&s, 0, 2 * PARAM_SIZE + 1, indices, 16);
+	assert(n == 2);
+	printf("Bursts are limited by credit and the timestep budget.\n");
+
+	// Individual requests go before the stream and don't need credit, but use it up, and duplicates
+	// are merged.
+	assert(ParamStreamRequestOne(&s, 7));
+	assert(ParamStreamRequestOne(&s, 7));
+	assert(ParamStreamRequestOne(&s, 9));
+	assert(!ParamStreamRequestOne(&s, 10));
+	n = ParamStreamTick(&s, 0, 1000, indices, 16);
+	assert(n == 2 && indices[0] == 7 && indices[1] == 9 && s.Credit < PARAM_SIZE * TICK_RATE);
+	// Requests that don't fit wait for the next timestep, in order.
+	for (i = 0; i < PARAM_STREAM_MAX_REQUESTS; ++i) {
+		assert(ParamStreamRequestOne(&s, (uint16_t)i));
+	}
+	assert(!ParamStreamRequestOne(&s, 9));
+	n = ParamStreamTick(&s, 0, PARAM_SIZE, indices, 16);
+	assert(n == 1 && indices[0] == 0 && s.RequestCount == PARAM_STREAM_MAX_REQUESTS - 1);
+	n = ParamStreamTick(&s, 0, 1000, indices, 16);
+	assert(n == PARAM_STREAM_MAX_REQUESTS - 1 && indices[0] == 1 && indices[n - 1] == PARAM_STREAM_MAX_REQUESTS - 1);
+	printf("Individual requests go first.\n");
+
+	// Over time the stream sends as fast as the spare bandwidth allows, and multiple passes wrap
+	// around the table.
+	{
+		uint32_t sentCount = 0, lastIndex = 0;
+		ParamStreamInit(&s, 10, PARAM_SIZE, TICK_RATE, PARAM_SIZE);
+		ParamStreamRequestAll(&s, 100);
+		for (i = 0; i < 10 * TICK_RATE; ++i) {
+			n = ParamStreamTick(&s, 330, 1000, indices, 16);
+			if (n) {
+				assert(n == 1 && indices[0] == (sentCount ? (lastIndex + 1) % 10 : 0));
+				lastIndex = indices[0];
+				sentCount += n;
+			}
+		}
+		assert(sentCount >= 100 && sentCount <= 101);
+		assert(s.Remaining == 1000 - sentCount);
+		printf("Streamed %u parameters in 10s at 10 parameters/s.\n", sentCount);
+	}
+
+	// Now simulate a groundstation connecting and downloading all parameters.
+	{
+		const uint16_t counts[] = {13, MAX_PARAMS};
+		uint8_t c;
+		printf("\nGroundstation connect over a %u B/s link with %u B/s of telemetry:\n", AIR_RATE, TELEMETRY_RATE);
+		printf("%-8s %-26s %8s %8s %8s\n", "params", "method", "time (s)", "sent", "dropped");
+		for (c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+			uint32_t dropped, sent;
+			const uint32_t oldTicks = SimulateConnect(SIM_OLD, counts[c], &dropped, &sent);
+			printf("%-8u %-26s %8.2f %8u %8u\n", counts[c], "one per timestep", (double)oldTicks / TICK_RATE, sent, dropped);
+			const uint32_t newTicks = SimulateConnect(SIM_STREAM, counts[c], &dropped, &sent);
+			printf("%-8u %-26s %8.2f %8u %8u\n", counts[c], "spare bandwidth", (double)newTicks / TICK_RATE, sent, dropped);
+			assert(newTicks < MAX_TICKS && dropped == 0 && sent == counts[c]);
+			assert(newTicks <= oldTicks);
+		}
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
+
+#endif // UNIT_TEST_PARAM_STREAM
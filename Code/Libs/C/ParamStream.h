@@ -0,0 +1,88 @@
+/**
+ * @file   ParamStream.h
+ * @brief  Streams parameters over a link as fast as its spare bandwidth allows.
+ *
+ * Sending one PARAM_VALUE per timestep ignores how busy the link is: on a slow radio it overruns the
+ * link, and on a fast one it takes longer than it needs to. A ParamStream instead decides every
+ * timestep which parameters to send, given the spare bandwidth of the link's schedule:
+ *  * The bytes per second the schedule doesn't use for telemetry accrue as credit, and the stream
+ *    sends as many parameters as the credit pays for. The credit is capped, so after an idle
+ *    period the stream can only burst as much as the link buffers can take.
+ *  * No timestep gets more parameters than fit into its spare per-timestep budget.
+ *  * Parameters requested individually, like replies to PARAM_REQUEST_READ or PARAM_SET, go out
+ *    before the rest of the stream at the very next timestep, even while the whole table is being
+ *    sent. They only need room in the timestep, not credit.
+ *
+ * The stream only picks parameter indices, sending them is up to the caller.
+ *
+ * Unit testing, which includes a simulation of how long a groundstation takes to download the
+ * current 13-parameter table and a 200-parameter one over the 64kbps radio link, with both the old
+ * one-parameter-per-timestep scheme and this one, is done on x86 by compiling with the
+ * UNIT_TEST_PARAM_STREAM macro:
+ * `gcc ParamStream.c -DUNIT_TEST_PARAM_STREAM -O2 -Wall`
+ */
+#ifndef PARAM_STREAM_H
+#define PARAM_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// How many individually requested parameters can be waiting at once.
+#define PARAM_STREAM_MAX_REQUESTS 8
+
+/**
+ * The state of a parameter stream. Initialize with ParamStreamInit().
+ */
+typedef struct {
+	uint16_t Count;        // Parameters in the table.
+	uint16_t Next;         // The next parameter sent by the stream.
+	uint16_t Remaining;    // Parameters left to send in the stream, 0 if it's idle.
+	uint16_t Requests[PARAM_STREAM_MAX_REQUESTS]; // Individually requested parameters, oldest first.
+	uint8_t RequestCount;  // Entries in Requests.
+	uint8_t MessageSize;   // The size of a single parameter message in bytes.
+	uint16_t TickRate;     // How often ParamStreamTick() is called, in Hz.
+	uint32_t Credit;       // Bytes the stream may still send, in units of 1/TickRate bytes.
+	uint32_t CreditLimit;  // The most credit that can accrue, in the same units.
+} ParamStream;
+
+/**
+ * Sets up an idle stream.
+ * @param count The number of parameters in the table.
+ * @param messageSize The size in bytes of a single parameter message, including its framing.
+ * @param tickRate The rate ParamStreamTick() will be called at, in Hz.
+ * @param burstBytes The most bytes of parameters that can be sent back-to-back, on top of the
+ *                   spare bandwidth, after the stream was idle.
+ */
+void ParamStreamInit(ParamStream *s, uint16_t count, uint8_t messageSize, uint16_t tickRate, uint16_t burstBytes);
+
+/**
+ * Starts sending the whole table from the first parameter, restarting a stream already underway.
+ * The stream starts out with a full burst of credit.
+ * @param passes How many times to send the table.
+ */
+void ParamStreamRequestAll(ParamStream *s, uint8_t passes);
+
+/**
+ * Queues a single parameter to be sent with the next timestep that has room for it. Requesting a
+ * parameter that's already waiting does nothing.
+ * @return False if the index is out of range or too many requests are waiting already.
+ */
+bool ParamStreamRequestOne(ParamStream *s, uint16_t index);
+
+/**
+ * Returns true if any parameters are waiting to be sent.
+ */
+bool ParamStreamBusy(const ParamStream *s);
+
+/**
+ * Picks the parameters to send during this timestep, individually requested ones first.
+ * @param bytesPerSecond The bandwidth the link has to spare for parameters.
+ * @param timestepBytes The bytes still free in this timestep's budget.
+ * @param indices Filled with the indices of the parameters to send, in order.
+ * @param maxIndices The size of `indices`.
+ * @return The number of parameters to send.
+ */
+uint8_t ParamStreamTick(ParamStream *s, uint32_t bytesPerSecond, uint16_t timestepBytes,
+                        uint16_t indices[], uint8_t maxIndices);
+
+#endif // PARAM_STREAM_H
@@ -32,8 +32,8 @@ void RudderStartCalibration(void)
 
 	CanMessagePackageRudderSetState(&msg, true, false, true);
 
-	// And finally transmit it.
-	Ecan1Transmit(&msg);
+	// And finally transmit it ahead of any telemetry.
+	Ecan1TransmitPriority(&msg, ECAN_TX_PRIORITY_HIGH);
 }
 
 void RudderSendAngleCommand(uint8_t sourceNode, float angleCommand)
@@ -42,6 +42,6 @@ void RudderSendAngleCommand(uint8_t sourceNode, float angleCommand)
 	CanMessage msg;
 	PackagePgn127245(&msg, sourceNode, 0xFF, 0x3, angleCommand, NAN);
 
-	// And finally transmit it.
-	Ecan1Transmit(&msg);
+	// And finally transmit it ahead of any telemetry.
+	Ecan1TransmitPriority(&msg, ECAN_TX_PRIORITY_HIGH);
 }
\ No newline at end of file
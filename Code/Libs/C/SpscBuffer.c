@@ -0,0 +1,634 @@
+/*
+ * Copyright Bar Smith, Bryant Mairs 2012
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses.
+ */
+
+/**
+ * @file   SpscBuffer.c
+ * @brief  A lock-free single-producer/single-consumer variant of the CircularBuffer.
+ *
+ * See SpscBuffer.h for the ownership rules. Every function here follows the same pattern: take a
+ * snapshot of the other side's index, do all data copying, then publish this side's index with a
+ * single 16-bit store after a compiler/memory barrier.
+ */
+#include "SpscBuffer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Prevents the compiler (and on the host, the CPU) from reordering the data copies across the index
+ * update that publishes them. The dsPIC33 executes in order, so only the compiler needs fencing.
+ */
+#if defined(__XC16__)
+#define SPSC_BARRIER() __asm__ volatile ("" ::: "memory")
+#else
+#define SPSC_BARRIER() __sync_synchronize()
+#endif
+
+// Transfers shorter than this are copied with a plain loop, matching CircularBuffer.c.
+#define SPSC_SHORT_COPY 8
+
+static inline void SPSC_Copy(uint8_t *dst, const uint8_t *src, uint16_t n)
+{
+	if (n < SPSC_SHORT_COPY) {
+		while (n--) {
+			*dst++ = *src++;
+		}
+	} else {
+		memcpy(dst, src, n);
+	}
+}
+
+/**
+ * Copy `size` bytes starting at the free-running index `from` out of the buffer with at most two
+ * block copies.
+ */
+static void SPSC_CopyOut(const SpscBuffer *b, uint16_t from, uint8_t *outData, uint16_t size)
+{
+	const uint16_t start = from & b->mask;
+	const uint16_t firstChunk = b->staticSize - start;
+	if (size <= firstChunk) {
+		SPSC_Copy(outData, &b->data[start], size);
+	} else {
+		SPSC_Copy(outData, &b->data[start], firstChunk);
+		SPSC_Copy(&outData[firstChunk], b->data, size - firstChunk);
+	}
+}
+
+/**
+ * Copy `size` bytes into the buffer starting at the free-running index `to`. The inverse of
+ * SPSC_CopyOut().
+ */
+static void SPSC_CopyIn(SpscBuffer *b, uint16_t to, const uint8_t *inData, uint16_t size)
+{
+	const uint16_t start = to & b->mask;
+	const uint16_t firstChunk = b->staticSize - start;
+	if (size <= firstChunk) {
+		SPSC_Copy(&b->data[start], inData, size);
+	} else {
+		SPSC_Copy(&b->data[start], inData, firstChunk);
+		SPSC_Copy(b->data, &inData[firstChunk], size - firstChunk);
+	}
+}
+
+int SPSC_Init(SpscBuffer *b, uint8_t *data, const uint16_t size)
+{
+	if (!b || !data) {
+		return false;
+	}
+
+	// The size must be a power of two so that the free-running 16-bit indices reduce correctly, and
+	// at most half the index range so that a full buffer can be told apart from an empty one.
+	if (size < 2 || size > 32768 || (size & (size - 1))) {
+		return false;
+	}
+
+	b->data = data;
+	memset(b->data, 0, size);
+	b->staticSize = size;
+	b->mask = size - 1;
+	b->head = 0;
+	b->tail = 0;
+	b->overflowCount = 0;
+
+	return true;
+}
+
+uint16_t SPSC_GetLength(const SpscBuffer *b)
+{
+	return (uint16_t)(b->head - b->tail);
+}
+
+uint16_t SPSC_GetSpace(const SpscBuffer *b)
+{
+	return b->staticSize - (uint16_t)(b->head - b->tail);
+}
+
+int SPSC_WriteByte(SpscBuffer *b, uint8_t inData)
+{
+	if (b) {
+		const uint16_t head = b->head;
+		if ((uint16_t)(head - b->tail) == b->staticSize) {
+			++b->overflowCount;
+			return false;
+		}
+		b->data[head & b->mask] = inData;
+		SPSC_BARRIER();
+		b->head = head + 1;
+		return true;
+	}
+	return false;
+}
+
+int SPSC_WriteMany(SpscBuffer *b, const void *inData, uint16_t size, bool failEarly)
+{
+	if (b && inData) {
+		const uint16_t head = b->head;
+		const uint16_t space = b->staticSize - (uint16_t)(head - b->tail);
+		uint16_t toWrite = size;
+
+		if (space < size) {
+			if (failEarly) {
+				return false;
+			}
+			toWrite = space;
+		}
+
+		SPSC_CopyIn(b, head, (const uint8_t*)inData, toWrite);
+		SPSC_BARRIER();
+		b->head = head + toWrite;
+
+		if (toWrite < size) {
+			b->overflowCount += (size - toWrite);
+			return false;
+		}
+		return true;
+	}
+	return false;
+}
+
+int SPSC_ReadByte(SpscBuffer *b, uint8_t *outData)
+{
+	if (b) {
+		const uint16_t tail = b->tail;
+		if (b->head == tail) {
+			return false;
+		}
+		SPSC_BARRIER();
+		*outData = b->data[tail & b->mask];
+		SPSC_BARRIER();
+		b->tail = tail + 1;
+		return true;
+	}
+	return false;
+}
+
+int SPSC_ReadMany(SpscBuffer *b, void *outData, uint16_t size)
+{
+	if (b && outData) {
+		const uint16_t tail = b->tail;
+		if ((uint16_t)(b->head - tail) >= size) {
+			SPSC_BARRIER();
+			SPSC_CopyOut(b, tail, (uint8_t*)outData, size);
+			SPSC_BARRIER();
+			b->tail = tail + size;
+			return true;
+		}
+	}
+	return false;
+}
+
+int SPSC_Peek(const SpscBuffer *b, uint8_t *outData)
+{
+	if (b) {
+		const uint16_t tail = b->tail;
+		if (b->head != tail) {
+			SPSC_BARRIER();
+			*outData = b->data[tail & b->mask];
+			return true;
+		}
+	}
+	return false;
+}
+
+int SPSC_PeekMany(const SpscBuffer *b, void *outData, uint16_t size)
+{
+	if (b && outData) {
+		const uint16_t tail = b->tail;
+		if ((uint16_t)(b->head - tail) >= size) {
+			SPSC_BARRIER();
+			SPSC_CopyOut(b, tail, (uint8_t*)outData, size);
+			return true;
+		}
+	}
+	return false;
+}
+
+int SPSC_Remove(SpscBuffer *b, uint16_t size)
+{
+	if (b) {
+		// Only the head is read once here, so anything the producer adds afterwards is kept.
+		const uint16_t tail = b->tail;
+		const uint16_t length = (uint16_t)(b->head - tail);
+		SPSC_BARRIER();
+		b->tail = tail + ((size < length) ? size : length);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Describe the `size` bytes starting at the free-running index `from` as at most two spans.
+ */
+static void SPSC_FillSpans(const SpscBuffer *b, uint16_t from, uint16_t size, SpscBufferSpans *spans)
+{
+	const uint16_t start = from & b->mask;
+	const uint16_t firstChunk = b->staticSize - start;
+	spans->data[0] = &b->data[start];
+	spans->data[1] = b->data;
+	if (size <= firstChunk) {
+		spans->length[0] = size;
+		spans->length[1] = 0;
+	} else {
+		spans->length[0] = firstChunk;
+		spans->length[1] = size - firstChunk;
+	}
+}
+
+uint16_t SPSC_GetReadSpans(const SpscBuffer *b, SpscBufferSpans *spans)
+{
+	if (b && spans) {
+		const uint16_t tail = b->tail;
+		const uint16_t length = (uint16_t)(b->head - tail);
+		SPSC_BARRIER();
+		SPSC_FillSpans(b, tail, length, spans);
+		return length;
+	}
+	return 0;
+}
+
+int SPSC_CommitRead(SpscBuffer *b, uint16_t size)
+{
+	if (b) {
+		const uint16_t tail = b->tail;
+		if ((uint16_t)(b->head - tail) >= size) {
+			SPSC_BARRIER();
+			b->tail = tail + size;
+			return true;
+		}
+	}
+	return false;
+}
+
+uint16_t SPSC_GetWriteSpans(SpscBuffer *b, SpscBufferSpans *spans)
+{
+	if (b && spans) {
+		const uint16_t head = b->head;
+		const uint16_t space = b->staticSize - (uint16_t)(head - b->tail);
+		SPSC_FillSpans(b, head, space, spans);
+		return space;
+	}
+	return 0;
+}
+
+int SPSC_CommitWrite(SpscBuffer *b, uint16_t size)
+{
+	if (b) {
+		const uint16_t head = b->head;
+		if (b->staticSize - (uint16_t)(head - b->tail) >= size) {
+			SPSC_BARRIER();
+			b->head = head + size;
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_SPSC_BUFFER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "CircularBuffer.h"
+
+#define STRESS_BYTES 50000000UL
+
+static double Now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * Tiny xorshift PRNG so each thread has its own reproducible chunk sizes.
+ */
+static uint32_t NextRand(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static SpscBuffer stressBuffer;
+static uint8_t stressData[256];
+
+/**
+ * Writes a running byte sequence into the buffer in randomly-sized chunks, retrying when full.
+ */
+static void *StressProducer(void *arg)
+{
+	uint32_t rng = 0x12345678;
+	unsigned long sent = 0;
+	uint8_t chunk[64];
+	(void)arg;
+	while (sent < STRESS_BYTES) {
+		uint16_t n = (NextRand(&rng) % sizeof(chunk)) + 1;
+		uint16_t i;
+		if (n > STRESS_BYTES - sent) {
+			n = STRESS_BYTES - sent;
+		}
+		for (i = 0; i < n; ++i) {
+			chunk[i] = (uint8_t)(sent + i);
+		}
+		if (n % 3 == 0) {
+			// Write through the write spans instead, only if all of the chunk fits.
+			SpscBufferSpans spans;
+			if (SPSC_GetWriteSpans(&stressBuffer, &spans) >= n) {
+				for (i = 0; i < n; ++i) {
+					if (i < spans.length[0]) {
+						spans.data[0][i] = chunk[i];
+					} else {
+						spans.data[1][i - spans.length[0]] = chunk[i];
+					}
+				}
+				assert(SPSC_CommitWrite(&stressBuffer, n));
+				sent += n;
+				continue;
+			}
+		} else if (n == 1) {
+			if (SPSC_WriteByte(&stressBuffer, chunk[0])) {
+				sent += 1;
+				continue;
+			}
+		} else if (SPSC_WriteMany(&stressBuffer, chunk, n, true)) {
+			sent += n;
+			continue;
+		}
+		// Give the consumer a chance to run when the test host has a single core.
+		sched_yield();
+	}
+	return NULL;
+}
+
+/**
+ * Reads the byte sequence back out using every consumer function and checks that nothing was lost,
+ * duplicated, or reordered.
+ */
+static void *StressConsumer(void *arg)
+{
+	uint32_t rng = 0x87654321;
+	unsigned long received = 0;
+	uint8_t chunk[64];
+	(void)arg;
+	while (received < STRESS_BYTES) {
+		uint16_t n = (NextRand(&rng) % sizeof(chunk)) + 1;
+		uint16_t i;
+		int ok;
+		if (n > STRESS_BYTES - received) {
+			n = STRESS_BYTES - received;
+		}
+		switch (NextRand(&rng) % 4) {
+		case 0:
+			n = 1;
+			ok = SPSC_ReadByte(&stressBuffer, chunk);
+			break;
+		case 1:
+			ok = SPSC_ReadMany(&stressBuffer, chunk, n);
+			break;
+		case 2:
+			ok = SPSC_PeekMany(&stressBuffer, chunk, n);
+			if (ok) {
+				SPSC_Remove(&stressBuffer, n);
+			}
+			break;
+		default:
+		{
+			// Copy out of the read spans, committing fewer bytes than were visible.
+			SpscBufferSpans spans;
+			uint16_t visible = SPSC_GetReadSpans(&stressBuffer, &spans);
+			ok = visible > 0;
+			if (ok) {
+				n = (visible < n) ? visible : n;
+				for (i = 0; i < n; ++i) {
+					chunk[i] = (i < spans.length[0]) ? spans.data[0][i] : spans.data[1][i - spans.length[0]];
+				}
+				assert(SPSC_CommitRead(&stressBuffer, n));
+			}
+			break;
+		}
+		}
+		if (ok) {
+			for (i = 0; i < n; ++i) {
+				assert(chunk[i] == (uint8_t)(received + i));
+			}
+			received += n;
+		} else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+/**
+ * The lock-protected CircularBuffer used as the benchmark baseline. This mirrors what the firmware
+ * does today by masking the peripheral interrupt around every buffer access.
+ */
+static CircularBuffer lockedBuffer;
+static uint8_t lockedData[1024];
+static pthread_mutex_t lockedMutex = PTHREAD_MUTEX_INITIALIZER;
+static SpscBuffer freeBuffer;
+static uint8_t freeData[1024];
+
+#define BENCH_BYTES 20000000UL
+
+typedef struct {
+	uint16_t chunk;
+	bool locked;
+} BenchArgs;
+
+static void *BenchProducer(void *arg)
+{
+	const BenchArgs *a = (const BenchArgs*)arg;
+	uint8_t chunk[64] = {0};
+	unsigned long sent = 0;
+	while (sent < BENCH_BYTES) {
+		int ok;
+		if (a->locked) {
+			pthread_mutex_lock(&lockedMutex);
+			ok = (a->chunk == 1) ? CB_WriteByte(&lockedBuffer, chunk[0]) : CB_WriteMany(&lockedBuffer, chunk, a->chunk, true);
+			pthread_mutex_unlock(&lockedMutex);
+		} else {
+			ok = (a->chunk == 1) ? SPSC_WriteByte(&freeBuffer, chunk[0]) : SPSC_WriteMany(&freeBuffer, chunk, a->chunk, true);
+		}
+		if (ok) {
+			sent += a->chunk;
+		} else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static void *BenchConsumer(void *arg)
+{
+	const BenchArgs *a = (const BenchArgs*)arg;
+	uint8_t chunk[64];
+	unsigned long received = 0;
+	while (received < BENCH_BYTES) {
+		int ok;
+		if (a->locked) {
+			pthread_mutex_lock(&lockedMutex);
+			ok = (a->chunk == 1) ? CB_ReadByte(&lockedBuffer, chunk) : CB_ReadMany(&lockedBuffer, chunk, a->chunk);
+			pthread_mutex_unlock(&lockedMutex);
+		} else {
+			ok = (a->chunk == 1) ? SPSC_ReadByte(&freeBuffer, chunk) : SPSC_ReadMany(&freeBuffer, chunk, a->chunk);
+		}
+		if (ok) {
+			received += a->chunk;
+		} else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static double RunBenchmark(uint16_t chunk, bool locked)
+{
+	pthread_t p, c;
+	BenchArgs a = {chunk, locked};
+	double start;
+	CB_Init(&lockedBuffer, lockedData, sizeof(lockedData));
+	SPSC_Init(&freeBuffer, freeData, sizeof(freeData));
+	start = Now();
+	pthread_create(&p, NULL, BenchProducer, &a);
+	pthread_create(&c, NULL, BenchConsumer, &a);
+	pthread_join(p, NULL);
+	pthread_join(c, NULL);
+	return Now() - start;
+}
+
+int main(void)
+{
+	// Test the init function.
+	{
+		SpscBuffer b;
+		uint8_t d[256];
+		assert(!SPSC_Init(NULL, d, sizeof(d)));
+		assert(!SPSC_Init(&b, NULL, sizeof(d)));
+		assert(!SPSC_Init(&b, d, 1));
+		assert(!SPSC_Init(&b, d, 100));
+		assert(SPSC_Init(&b, d, sizeof(d)));
+		assert(SPSC_GetLength(&b) == 0);
+		assert(SPSC_GetSpace(&b) == 256);
+	}
+
+	// Fill, overflow, and drain a buffer, with the indices wrapping through 0xFFFF.
+	{
+		SpscBuffer b;
+		uint8_t d[16];
+		uint8_t in[20], out[20];
+		int i;
+		for (i = 0; i < 20; ++i) {
+			in[i] = i + 1;
+		}
+		assert(SPSC_Init(&b, d, sizeof(d)));
+		b.head = b.tail = 0xFFF8;
+
+		assert(!SPSC_WriteMany(&b, in, 20, true));
+		assert(SPSC_GetLength(&b) == 0);
+		assert(!SPSC_WriteMany(&b, in, 20, false));
+		assert(SPSC_GetLength(&b) == 16);
+		assert(b.overflowCount == 4);
+		assert(!SPSC_WriteByte(&b, 0));
+		assert(b.overflowCount == 5);
+
+		assert(SPSC_Peek(&b, out) && out[0] == 1);
+		assert(!SPSC_ReadMany(&b, out, 17));
+		assert(SPSC_ReadMany(&b, out, 10));
+		assert(memcmp(out, in, 10) == 0);
+		assert(SPSC_ReadByte(&b, out) && out[0] == 11);
+		assert(SPSC_Remove(&b, 2));
+		assert(SPSC_PeekMany(&b, out, 3));
+		assert(memcmp(out, &in[13], 3) == 0);
+		assert(SPSC_Remove(&b, 100));
+		assert(SPSC_GetLength(&b) == 0);
+		assert(!SPSC_ReadByte(&b, out));
+		assert(b.head == b.tail && b.head == 0x0008);
+	}
+
+	// Read and write spans across the wrap-around point.
+	{
+		SpscBuffer b;
+		SpscBufferSpans spans;
+		uint8_t d[8];
+		assert(SPSC_Init(&b, d, sizeof(d)));
+		b.head = b.tail = 0xFFFE;
+		assert(SPSC_GetWriteSpans(&b, &spans) == 8);
+		assert(spans.data[0] == &d[6] && spans.length[0] == 2);
+		assert(spans.data[1] == d && spans.length[1] == 6);
+		spans.data[0][0] = 1;
+		spans.data[0][1] = 2;
+		spans.data[1][0] = 3;
+		assert(!SPSC_CommitWrite(&b, 9));
+		assert(SPSC_GetLength(&b) == 0);
+		assert(SPSC_CommitWrite(&b, 3));
+		assert(SPSC_GetReadSpans(&b, &spans) == 3);
+		assert(spans.data[0] == &d[6] && spans.length[0] == 2 && spans.length[1] == 1);
+		assert(spans.data[0][1] == 2 && spans.data[1][0] == 3);
+		assert(!SPSC_CommitRead(&b, 4));
+		assert(SPSC_CommitRead(&b, 2));
+		assert(SPSC_GetReadSpans(&b, &spans) == 1);
+		assert(spans.data[0] == d && spans.length[0] == 1 && spans.length[1] == 0);
+		assert(SPSC_CommitRead(&b, 1));
+		assert(SPSC_GetReadSpans(&b, &spans) == 0);
+	}
+
+	// Two-thread stress test over a small buffer so it is constantly full and wrapping.
+	{
+		pthread_t p, c;
+		double start;
+		assert(SPSC_Init(&stressBuffer, stressData, sizeof(stressData)));
+		start = Now();
+		pthread_create(&p, NULL, StressProducer, NULL);
+		pthread_create(&c, NULL, StressConsumer, NULL);
+		pthread_join(p, NULL);
+		pthread_join(c, NULL);
+		assert(SPSC_GetLength(&stressBuffer) == 0);
+		printf("Stress test: %lu bytes verified in %.2fs\n", STRESS_BYTES, Now() - start);
+	}
+
+	printf("All tests passed.\n");
+
+	// Throughput of a lock-free buffer versus a CircularBuffer behind a lock, one producer thread and
+	// one consumer thread, 1KiB buffers.
+	{
+		const uint16_t chunks[] = {1, 8, 18, 64};
+		unsigned int i;
+		printf("\n%-6s %12s %12s %8s\n", "chunk", "locked MB/s", "spsc MB/s", "speedup");
+		for (i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+			double locked = RunBenchmark(chunks[i], true);
+			double free = RunBenchmark(chunks[i], false);
+			printf("%-6u %12.1f %12.1f %7.2fx\n", chunks[i], BENCH_BYTES / locked / 1e6,
+			       BENCH_BYTES / free / 1e6, locked / free);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
+
+#endif // UNIT_TEST_SPSC_BUFFER
@@ -0,0 +1,178 @@
+/*
+ * Copyright Bar Smith, Bryant Mairs 2012
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses.
+ */
+
+/**
+ * @file   SpscBuffer.h
+ * @brief  A lock-free single-producer/single-consumer variant of the CircularBuffer.
+ *
+ * This buffer is meant for the common case of one side of a ring being owned by an interrupt and
+ * the other by the main loop, such as UART reception (the RX ISR writes, the main loop reads) or
+ * UART transmission (the main loop writes, the TX ISR reads). Unlike the CircularBuffer, neither
+ * side needs to disable interrupts around its accesses.
+ *
+ * This works by splitting the state into producer-owned and consumer-owned halves. The producer is
+ * the only one that ever writes `head` and `overflowCount`, the consumer is the only one that ever
+ * writes `tail`. Both indices are free-running 16-bit counters which are only reduced into the
+ * backing array when data is copied, so the number of bytes stored is always `head - tail`. As a
+ * 16-bit load/store is atomic on the dsPIC33, each side always sees a consistent snapshot of the
+ * other side's index. For this to work the buffer size must be a power of two no larger than 32768.
+ *
+ * The rules for use are:
+ *  * Only one context may call the producer functions: SPSC_WriteByte(), SPSC_WriteMany(),
+ *    SPSC_GetWriteSpans(), SPSC_CommitWrite().
+ *  * Only one context may call the consumer functions: SPSC_ReadByte(), SPSC_ReadMany(),
+ *    SPSC_Peek(), SPSC_PeekMany(), SPSC_Remove(), SPSC_GetReadSpans(), SPSC_CommitRead().
+ *  * SPSC_GetLength() and SPSC_GetSpace() may be called from either side. The value is exact for the
+ *    caller's purposes: the producer may only underestimate the free space and the consumer may only
+ *    underestimate the available data.
+ *  * SPSC_Init() must not race with either side.
+ *
+ * Unit testing, including a two-thread stress test and a comparison against a lock-protected
+ * CircularBuffer, is done on x86 by compiling with the UNIT_TEST_SPSC_BUFFER macro:
+ * `gcc SpscBuffer.c CircularBuffer.c -DUNIT_TEST_SPSC_BUFFER -Wall -O2 -g -lpthread`
+ */
+#ifndef SPSC_BUFFER_H
+#define SPSC_BUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief The state of a single-producer/single-consumer circular buffer.
+ *
+ * `head` and `overflowCount` belong to the producer, `tail` belongs to the consumer. Everything else
+ * is only written by SPSC_Init().
+ */
+typedef struct {
+	volatile uint16_t head;         //!< Total number of bytes ever written, modulo 2^16. Producer-owned.
+	volatile uint16_t tail;         //!< Total number of bytes ever read, modulo 2^16. Consumer-owned.
+	uint16_t staticSize;            //!< The size of the backing array. Always a power of two.
+	uint16_t mask;                  //!< staticSize - 1, used to reduce head/tail into array indices.
+	volatile uint8_t overflowCount; //!< Tracks how many bytes have been dropped as the buffer was full. Producer-owned.
+	uint8_t *data;                  //!< A pointer to the actual data managed by this buffer.
+} SpscBuffer;
+
+/**
+ * @brief A view of a region of an SpscBuffer as at most two contiguous spans.
+ *
+ * This is the SpscBuffer equivalent of CircularBufferSpans. length[1] is only non-zero if the region
+ * wraps around the end of the backing array.
+ */
+typedef struct {
+	uint8_t *data[2];
+	uint16_t length[2];
+} SpscBufferSpans;
+
+/**
+ * @brief Initializes the buffer.
+ *
+ * Returns false if either pointer is NULL or if `size` is not a power of two in [2, 32768].
+ *
+ * @param b A pointer to the SpscBuffer struct.
+ * @param data A pointer to where the data will be stored.
+ * @param size The length of the buffer.
+ */
+int SPSC_Init(SpscBuffer *b, uint8_t *data, const uint16_t size);
+
+/**
+ * @brief Returns the number of bytes available to be read.
+ */
+uint16_t SPSC_GetLength(const SpscBuffer *b);
+
+/**
+ * @brief Returns the number of bytes that can be written before the buffer is full.
+ */
+uint16_t SPSC_GetSpace(const SpscBuffer *b);
+
+/**
+ * @brief Writes a single byte into the buffer. Producer only.
+ *
+ * If the buffer is full the byte is dropped, overflowCount is incremented, and false is returned.
+ */
+int SPSC_WriteByte(SpscBuffer *b, uint8_t inData);
+
+/**
+ * @brief Writes multiple bytes into the buffer. Producer only.
+ *
+ * Behaves like CB_WriteMany(): if `failEarly` is true nothing is written unless all `size` bytes
+ * fit, otherwise as many bytes as fit are written and the rest are counted as overflow. The data is
+ * only made visible to the consumer once it has all been copied in.
+ */
+int SPSC_WriteMany(SpscBuffer *b, const void *inData, uint16_t size, bool failEarly);
+
+/**
+ * @brief Reads a single byte from the buffer. Consumer only.
+ */
+int SPSC_ReadByte(SpscBuffer *b, uint8_t *outData);
+
+/**
+ * @brief Reads `size` bytes from the buffer. Consumer only.
+ *
+ * If fewer than `size` bytes are available nothing is read and false is returned.
+ */
+int SPSC_ReadMany(SpscBuffer *b, void *outData, uint16_t size);
+
+/**
+ * @brief Copies the next byte out of the buffer without removing it. Consumer only.
+ */
+int SPSC_Peek(const SpscBuffer *b, uint8_t *outData);
+
+/**
+ * @brief Copies the next `size` bytes out of the buffer without removing them. Consumer only.
+ */
+int SPSC_PeekMany(const SpscBuffer *b, void *outData, uint16_t size);
+
+/**
+ * @brief Removes up to `size` bytes from the buffer. Consumer only.
+ *
+ * If fewer than `size` bytes are available the buffer is emptied of everything the consumer can
+ * currently see.
+ */
+int SPSC_Remove(SpscBuffer *b, uint16_t size);
+
+/**
+ * @brief Exposes the readable data as at most two spans for parsing in place. Consumer only.
+ *
+ * Returns the total number of bytes described by `spans`. Data the producer adds afterwards is not
+ * included. The bytes stay in the buffer, and the producer won't overwrite them, until they're
+ * released with SPSC_CommitRead().
+ */
+uint16_t SPSC_GetReadSpans(const SpscBuffer *b, SpscBufferSpans *spans);
+
+/**
+ * @brief Releases `size` bytes previously exposed by SPSC_GetReadSpans(). Consumer only.
+ *
+ * Fails, and does nothing, if fewer than `size` bytes are in the buffer.
+ */
+int SPSC_CommitRead(SpscBuffer *b, uint16_t size);
+
+/**
+ * @brief Exposes the free space as at most two spans for filling in place. Producer only.
+ *
+ * Returns the total number of bytes described by `spans`. Nothing written there is visible to the
+ * consumer until SPSC_CommitWrite() is called.
+ */
+uint16_t SPSC_GetWriteSpans(SpscBuffer *b, SpscBufferSpans *spans);
+
+/**
+ * @brief Publishes `size` bytes previously filled in through SPSC_GetWriteSpans(). Producer only.
+ *
+ * Fails, and does nothing, if there are fewer than `size` bytes of free space.
+ */
+int SPSC_CommitWrite(SpscBuffer *b, uint16_t size);
+
+#endif /* SPSC_BUFFER_H */
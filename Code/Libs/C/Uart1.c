@@ -5,13 +5,25 @@
 #include <xc.h>
 #include <uart.h>
 
-#include "CircularBuffer.h"
+#include "SpscBuffer.h"
 
-static CircularBuffer uart1RxBuffer;
+// SPSC_Init() refuses any other size, which would leave the UART dropping everything.
+#if (UART1_BUFFER_SIZE & (UART1_BUFFER_SIZE - 1)) != 0 || UART1_BUFFER_SIZE > 32768
+#error UART1_BUFFER_SIZE must be a power of two no larger than 32768
+#endif
+
+static SpscBuffer uart1RxBuffer;
 static uint8_t u1RxBuf[UART1_BUFFER_SIZE];
-static CircularBuffer uart1TxBuffer;
+static SpscBuffer uart1TxBuffer;
 static uint8_t u1TxBuf[UART1_BUFFER_SIZE];
 
+/*
+ * Both buffers are single-producer/single-consumer: the RX ISR is the only writer of the RX buffer
+ * and the main loop its only reader, while the main loop is the only writer of the TX buffer. The
+ * TX buffer is read from both the TX ISR and Uart1StartTransmission(), so only that read still needs
+ * the TX interrupt masked.
+ */
+
 /*
  * Private functions.
  */
@@ -28,8 +40,8 @@ void Uart1StartTransmission(void);
 void Uart1Init(uint16_t brgRegister)
 {
     // First initialize the necessary circular buffers.
-    CB_Init(&uart1RxBuffer, u1RxBuf, sizeof(u1RxBuf));
-    CB_Init(&uart1TxBuffer, u1TxBuf, sizeof(u1TxBuf));
+    SPSC_Init(&uart1RxBuffer, u1RxBuf, sizeof(u1RxBuf));
+    SPSC_Init(&uart1TxBuffer, u1TxBuf, sizeof(u1TxBuf));
 
     // If the UART was already opened, close it first. This should also clear the transmit/receive
     // buffers so we won't have left-over data around when we re-initialize, if we are.
@@ -75,13 +87,18 @@ void Uart1ChangeBaudRate(uint16_t brgRegister)
  */
 void Uart1StartTransmission(void)
 {
-    while (uart1TxBuffer.dataSize > 0 && !U1STAbits.UTXBF) {
+    while (SPSC_GetLength(&uart1TxBuffer) > 0 && !U1STAbits.UTXBF) {
         // A temporary variable is used here because writing directly into U1TXREG causes some weird issues.
         uint8_t c;
         IEC0bits.U1TXIE = 0;
-        CB_ReadByte(&uart1TxBuffer, &c);
+        int rv = SPSC_ReadByte(&uart1TxBuffer, &c);
         IEC0bits.U1TXIE = 1;
 
+        // The TX interrupt may have drained the buffer since we checked its length.
+        if (!rv) {
+            break;
+        }
+
         // We process the char before we try to send it in case writing directly into U1TXREG has
         // weird side effects.
         U1TXREG = c;
@@ -90,10 +107,17 @@ void Uart1StartTransmission(void)
 
 int Uart1ReadByte(uint8_t *datum)
 {
-    IEC0bits.U1RXIE = 0;
-    int rv = CB_ReadByte(&uart1RxBuffer, datum);
-    IEC0bits.U1RXIE = 1;
-    return rv;
+    return SPSC_ReadByte(&uart1RxBuffer, datum);
+}
+
+uint16_t Uart1GetReadSpans(SpscBufferSpans *spans)
+{
+    return SPSC_GetReadSpans(&uart1RxBuffer, spans);
+}
+
+int Uart1CommitRead(uint16_t length)
+{
+    return SPSC_CommitRead(&uart1RxBuffer, length);
 }
 
 /**
@@ -102,21 +126,32 @@ int Uart1ReadByte(uint8_t *datum)
  */
 void Uart1WriteByte(uint8_t datum)
 {
-    IEC0bits.U1TXIE = 0;
-    CB_WriteByte(&uart1TxBuffer, datum);
-    IEC0bits.U1TXIE = 1;
+    SPSC_WriteByte(&uart1TxBuffer, datum);
     Uart1StartTransmission();
 }
 
+uint16_t Uart1GetWriteSpans(SpscBufferSpans *spans)
+{
+    return SPSC_GetWriteSpans(&uart1TxBuffer, spans);
+}
+
+int Uart1CommitWrite(uint16_t length)
+{
+    int success = SPSC_CommitWrite(&uart1TxBuffer, length);
+    if (success) {
+        Uart1StartTransmission();
+    }
+
+    return success;
+}
+
 /**
  * This function enqueues all bytes in the passed data character array according to the passed
  * length.
  */
 int Uart1WriteData(const void *data, size_t length)
 {
-    IEC0bits.U1TXIE = 0;
-    int success = CB_WriteMany(&uart1TxBuffer, data, length, true);
-    IEC0bits.U1TXIE = 1;
+    int success = SPSC_WriteMany(&uart1TxBuffer, data, length, true);
     if (success) {
         Uart1StartTransmission();
     }
@@ -142,7 +177,7 @@ void _ISR _U1RXInterrupt(void)
             c = U1RXREG;
         } else {
             c = U1RXREG;
-            CB_WriteByte(&uart1RxBuffer, (uint8_t)c);
+            SPSC_WriteByte(&uart1RxBuffer, (uint8_t)c);
         }
     }
 
@@ -163,10 +198,10 @@ void _ISR _U1TXInterrupt(void)
     // TRMT bit to stall until the character is properly transmit.
     while (!U1STAbits.TRMT);
 
-    while (uart1TxBuffer.dataSize > 0 && !U1STAbits.UTXBF) {
+    while (SPSC_GetLength(&uart1TxBuffer) > 0 && !U1STAbits.UTXBF) {
         // A temporary variable is used here because writing directly into U1TXREG causes some weird issues.
         uint8_t c;
-        CB_ReadByte(&uart1TxBuffer, &c);
+        SPSC_ReadByte(&uart1TxBuffer, &c);
 
         // We process the char before we try to send it in case writing directly into U1TXREG has
         // weird side effects.
@@ -4,11 +4,15 @@
 // USAGE:
 // Add Uart1Init() to an initialization sequence called once on startup.
 // Use Uart1Write*Data() to push appropriately-sized data chunks into the queue and begin transmission.
-// Use Uart1ReadByte() to read bytes out of the buffer
+// Use Uart1GetWriteSpans()/Uart1CommitWrite() to format data in place, such as whole packets.
+// Use Uart1ReadByte() to read bytes out of the buffer, or Uart1GetReadSpans()/Uart1CommitRead() to
+// parse them in place.
 
 #include <stddef.h>
 #include <stdint.h>
 
+#include "SpscBuffer.h"
+
 #define UART1_BUFFER_SIZE 1024
 
 /**
@@ -30,6 +34,20 @@ void Uart1ChangeBaudRate(uint16_t brgRegister);
  */
 int Uart1ReadByte(uint8_t *datum);
 
+/**
+ * Exposes all received data for UART1 as at most two contiguous spans without copying it out. The
+ * data stays in the buffer until released with Uart1CommitRead().
+ * @param spans Filled with the received data.
+ * @return The total number of bytes in the spans.
+ */
+uint16_t Uart1GetReadSpans(SpscBufferSpans *spans);
+
+/**
+ * Releases `length` bytes previously exposed through Uart1GetReadSpans().
+ * @return A boolean value of whether that much data was available.
+ */
+int Uart1CommitRead(uint16_t length);
+
 /**
  * This function starts a transmission sequence after enqueuing a single byte into
  * the buffer.
@@ -42,4 +60,19 @@ void Uart1WriteByte(uint8_t datum);
  */
 int Uart1WriteData(const void *data, size_t length);
 
+/**
+ * Exposes the free space in the UART1 transmit buffer as at most two contiguous spans so that
+ * data can be formatted directly into it. Nothing is sent until Uart1CommitWrite() is called.
+ * @param spans Filled with the free space.
+ * @return The total number of bytes in the spans.
+ */
+uint16_t Uart1GetWriteSpans(SpscBufferSpans *spans);
+
+/**
+ * Queues `length` bytes previously written through Uart1GetWriteSpans() for transmission and starts
+ * transmitting them.
+ * @return A boolean value of whether there was that much free space.
+ */
+int Uart1CommitWrite(uint16_t length);
+
 #endif // UART1_H
@@ -5,13 +5,25 @@
 #include <xc.h>
 #include <uart.h>
 
-#include "CircularBuffer.h"
+#include "SpscBuffer.h"
 
-static CircularBuffer uart2RxBuffer;
+// SPSC_Init() refuses any other size, which would leave the UART dropping everything.
+#if (UART2_BUFFER_SIZE & (UART2_BUFFER_SIZE - 1)) != 0 || UART2_BUFFER_SIZE > 32768
+#error UART2_BUFFER_SIZE must be a power of two no larger than 32768
+#endif
+
+static SpscBuffer uart2RxBuffer;
 static uint8_t u2RxBuf[UART2_BUFFER_SIZE];
-static CircularBuffer uart2TxBuffer;
+static SpscBuffer uart2TxBuffer;
 static uint8_t u2TxBuf[UART2_BUFFER_SIZE];
 
+/*
+ * Both buffers are single-producer/single-consumer: the RX ISR is the only writer of the RX buffer
+ * and the main loop its only reader, while the main loop is the only writer of the TX buffer. The
+ * TX buffer is read from both the TX ISR and Uart2StartTransmission(), so only that read still needs
+ * the TX interrupt masked.
+ */
+
 /*
  * Private functions.
  */
@@ -28,8 +40,8 @@ void Uart2StartTransmission(void);
 void Uart2Init(uint16_t brgRegister)
 {
     // First initialize the necessary circular buffers.
-    CB_Init(&uart2RxBuffer, u2RxBuf, sizeof(u2RxBuf));
-    CB_Init(&uart2TxBuffer, u2TxBuf, sizeof(u2TxBuf));
+    SPSC_Init(&uart2RxBuffer, u2RxBuf, sizeof(u2RxBuf));
+    SPSC_Init(&uart2TxBuffer, u2TxBuf, sizeof(u2TxBuf));
 
     // If the UART was already opened, close it first. This should also clear the transmit/receive
     // buffers so we won't have left-over data around when we re-initialize, if we are.
@@ -75,13 +87,18 @@ void Uart2ChangeBaudRate(uint16_t brgRegister)
  */
 void Uart2StartTransmission(void)
 {
-    while (uart2TxBuffer.dataSize > 0 && !U2STAbits.UTXBF) {
+    while (SPSC_GetLength(&uart2TxBuffer) > 0 && !U2STAbits.UTXBF) {
         // A temporary variable is used here because writing directly into U2TXREG causes some weird issues.
         uint8_t c;
         IEC1bits.U2TXIE = 0;
-        CB_ReadByte(&uart2TxBuffer, &c);
+        int rv = SPSC_ReadByte(&uart2TxBuffer, &c);
         IEC1bits.U2TXIE = 1;
 
+        // The TX interrupt may have drained the buffer since we checked its length.
+        if (!rv) {
+            break;
+        }
+
         // We process the char before we try to send it in case writing directly into U2TXREG has
         // weird side effects.
         U2TXREG = c;
@@ -90,10 +107,17 @@ void Uart2StartTransmission(void)
 
 int Uart2ReadByte(uint8_t *datum)
 {
-    IEC1bits.U2RXIE = 0;
-    int rv = CB_ReadByte(&uart2RxBuffer, datum);
-    IEC1bits.U2RXIE = 1;
-    return rv;
+    return SPSC_ReadByte(&uart2RxBuffer, datum);
+}
+
+uint16_t Uart2GetReadSpans(SpscBufferSpans *spans)
+{
+    return SPSC_GetReadSpans(&uart2RxBuffer, spans);
+}
+
+int Uart2CommitRead(uint16_t length)
+{
+    return SPSC_CommitRead(&uart2RxBuffer, length);
 }
 
 /**
@@ -102,21 +126,32 @@ int Uart2ReadByte(uint8_t *datum)
  */
 void Uart2WriteByte(uint8_t datum)
 {
-    IEC1bits.U2TXIE = 0;
-    CB_WriteByte(&uart2TxBuffer, datum);
-    IEC1bits.U2TXIE = 1;
+    SPSC_WriteByte(&uart2TxBuffer, datum);
     Uart2StartTransmission();
 }
 
+uint16_t Uart2GetWriteSpans(SpscBufferSpans *spans)
+{
+    return SPSC_GetWriteSpans(&uart2TxBuffer, spans);
+}
+
+int Uart2CommitWrite(uint16_t length)
+{
+    int success = SPSC_CommitWrite(&uart2TxBuffer, length);
+    if (success) {
+        Uart2StartTransmission();
+    }
+
+    return success;
+}
+
 /**
  * This function enqueues all bytes in the passed data character array according to the passed
  * length.
  */
 int Uart2WriteData(const void *data, size_t length)
 {
-    IEC1bits.U2TXIE = 0;
-    int success = CB_WriteMany(&uart2TxBuffer, data, length, true);
-    IEC1bits.U2TXIE = 1;
+    int success = SPSC_WriteMany(&uart2TxBuffer, data, length, true);
     if (success) {
         Uart2StartTransmission();
     }
@@ -142,7 +177,7 @@ void _ISR _U2RXInterrupt(void)
             c = U2RXREG;
         } else {
             c = U2RXREG;
-            CB_WriteByte(&uart2RxBuffer, (uint8_t)c);
+            SPSC_WriteByte(&uart2RxBuffer, (uint8_t)c);
         }
     }
 
@@ -163,10 +198,10 @@ void _ISR _U2TXInterrupt(void)
     // TRMT bit to stall until the character is properly transmit.
     while (!U2STAbits.TRMT);
 
-    while (uart2TxBuffer.dataSize > 0 && !U2STAbits.UTXBF) {
+    while (SPSC_GetLength(&uart2TxBuffer) > 0 && !U2STAbits.UTXBF) {
         // A temporary variable is used here because writing directly into U2TXREG causes some weird issues.
         uint8_t c;
-        CB_ReadByte(&uart2TxBuffer, &c);
+        SPSC_ReadByte(&uart2TxBuffer, &c);
 
         // We process the char before we try to send it in case writing directly into U2TXREG has
         // weird side effects.
@@ -0,0 +1,896 @@
+#define _GNU_SOURCE
+#include "VirtualCan.h"
+#include "CanBusMonitor.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#endif
+
+// Marks a bus that's been fully initialized by the process that created it.
+#define VIRTUAL_CAN_MAGIC 0x5643414EUL
+
+// How long to wait for another process to finish creating a bus, in ms.
+#define VIRTUAL_CAN_OPEN_TIMEOUT 1000
+
+/**
+ * The shared state of a node.
+ */
+typedef struct {
+	pid_t Pid;                                // The process attached as this node, or 0 if it's free.
+	uint8_t Loaded;                           // Bit n is set while buffer n holds a frame.
+	CanMessage Buffers[VIRTUAL_CAN_BUFFERS];
+	uint64_t LoadedAt[VIRTUAL_CAN_BUFFERS];   // When each buffer was loaded, see VirtualCanNow().
+	bool Filtered;
+	EcanFilterRegisters Filters;
+	CanMessage Rx[VIRTUAL_CAN_RX_LENGTH];
+	uint32_t RxHead;                          // Free-running, the next frame received goes here.
+	uint32_t RxTail;                          // Free-running, the next frame taken off comes from here.
+	VirtualCanStats Stats;
+} VirtualCanNode;
+
+struct VirtualCanBus {
+	volatile uint32_t Magic;
+	pthread_mutex_t Lock;
+	VirtualCanConfig Config;
+	uint32_t Random;       // The state of the loss injection's random number generator.
+	uint64_t FreeAt;       // When the frame on the bus is done, or the bus was last free.
+	bool Busy;             // Whether a frame is on the bus until FreeAt.
+	uint8_t Sender;        // The node the frame on the bus is from,
+	uint8_t SenderBuffer;  // and the buffer it's in.
+	VirtualCanNode Nodes[VIRTUAL_CAN_MAX_NODES];
+};
+
+/**
+ * Returns the current time in ns. It's the same in every process.
+ */
+static uint64_t VirtualCanNow(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+/**
+ * Locks the bus. If the process holding the lock died, the bus is still consistent, as every
+ * update is made before the next one starts, so it's just taken over.
+ */
+static void VirtualCanLock(VirtualCanBus *bus)
+{
+	if (pthread_mutex_lock(&bus->Lock) == EOWNERDEAD) {
+		pthread_mutex_consistent(&bus->Lock);
+	}
+}
+
+static void VirtualCanUnlock(VirtualCanBus *bus)
+{
+	pthread_mutex_unlock(&bus->Lock);
+}
+
+/**
+ * Returns whether a frame is lost, with the probability of `lossPpm` in a million. Uses xorshift32.
+ */
+static bool VirtualCanLose(uint32_t *random, uint32_t lossPpm)
+{
+	if (!lossPpm) {
+		return false;
+	}
+	*random ^= *random << 13;
+	*random ^= *random >> 17;
+	*random ^= *random << 5;
+	return *random % 1000000UL < lossPpm;
+}
+
+/**
+ * Returns the arbitration field of a frame as a number that's lower for frames that win: the base
+ * ID, then the RTR bit of standard frames or the SRR bit of extended ones, the IDE bit, the
+ * extended ID, and the RTR bit of extended frames.
+ */
+static uint32_t VirtualCanArbitration(const CanMessage *msg)
+{
+	const uint32_t rtr = msg->message_type == CAN_MSG_RTR;
+	if (msg->frame_type == CAN_FRAME_EXT) {
+		return ((msg->id >> 18) & 0x7FF) << 21 | 3UL << 19 | (msg->id & 0x3FFFF) << 1 | rtr;
+	} else {
+		return (msg->id & 0x7FF) << 21 | rtr << 20;
+	}
+}
+
+/**
+ * Delivers a frame that was sent to every node but the sender.
+ */
+static void VirtualCanDeliver(VirtualCanBus *bus, uint8_t sender, const CanMessage *msg)
+{
+	uint8_t i;
+	for (i = 0; i < VIRTUAL_CAN_MAX_NODES; ++i) {
+		VirtualCanNode *n = &bus->Nodes[i];
+		if (i == sender || !n->Pid) {
+			continue;
+		}
+		if (n->Filtered && !EcanFilterAccepts(&n->Filters, msg->id, msg->frame_type == CAN_FRAME_EXT)) {
+			++n->Stats.Filtered;
+		} else if (VirtualCanLose(&bus->Random, bus->Config.LossPpm)) {
+			++n->Stats.Lost;
+		} else if (n->RxHead - n->RxTail == VIRTUAL_CAN_RX_LENGTH) {
+			++n->Stats.Overflows;
+		} else {
+			n->Rx[n->RxHead++ & (VIRTUAL_CAN_RX_LENGTH - 1)] = *msg;
+			++n->Stats.Received;
+		}
+	}
+}
+
+/**
+ * Sends every frame there's been time for. Must be called with the bus locked.
+ */
+static void VirtualCanRun(VirtualCanBus *bus, uint64_t now)
+{
+	for (;;) {
+		uint64_t start = UINT64_MAX;
+		uint32_t best = UINT32_MAX;
+		int8_t winner = -1;
+		uint8_t winnerBuffer = 0;
+		uint8_t i;
+
+		// Finish the frame on the bus.
+		if (bus->Busy) {
+			VirtualCanNode *n = &bus->Nodes[bus->Sender];
+			if (bus->FreeAt > now) {
+				return;
+			}
+			bus->Busy = false;
+			if (n->Loaded & (1 << bus->SenderBuffer)) {
+				VirtualCanDeliver(bus, bus->Sender, &n->Buffers[bus->SenderBuffer]);
+				n->Loaded &= ~(1 << bus->SenderBuffer);
+				++n->Stats.Sent;
+			}
+		}
+
+		// The next frame starts as soon as the bus is free and a frame has been loaded, and every frame
+		// loaded by then takes part in the arbitration.
+		for (i = 0; i < VIRTUAL_CAN_MAX_NODES; ++i) {
+			const VirtualCanNode *n = &bus->Nodes[i];
+			if (n->Pid && n->Loaded) {
+				const uint8_t b = __builtin_ctz(n->Loaded);
+				if (n->LoadedAt[b] < start) {
+					start = n->LoadedAt[b];
+				}
+			}
+		}
+		if (start == UINT64_MAX) {
+			return;
+		}
+		if (start < bus->FreeAt) {
+			start = bus->FreeAt;
+		}
+		for (i = 0; i < VIRTUAL_CAN_MAX_NODES; ++i) {
+			const VirtualCanNode *n = &bus->Nodes[i];
+			if (n->Pid && n->Loaded) {
+				const uint8_t b = __builtin_ctz(n->Loaded);
+				const uint32_t arbitration = VirtualCanArbitration(&n->Buffers[b]);
+				if (n->LoadedAt[b] <= start && (winner < 0 || arbitration < best)) {
+					best = arbitration;
+					winner = i;
+					winnerBuffer = b;
+				}
+			}
+		}
+
+		bus->Busy = true;
+		bus->Sender = winner;
+		bus->SenderBuffer = winnerBuffer;
+		bus->FreeAt = start;
+		if (bus->Config.BitRate) {
+			bus->FreeAt += (uint64_t)CanBusMonitorFrameBits(&bus->Nodes[winner].Buffers[winnerBuffer]) * 1000000000ULL / bus->Config.BitRate;
+		}
+	}
+}
+
+/**
+ * Maps a shared memory bus that another process is creating, once it's done.
+ */
+static VirtualCanBus *VirtualCanMapExisting(const char *path)
+{
+	VirtualCanBus *bus = MAP_FAILED;
+	struct stat st;
+	uint16_t waited;
+	const int fd = shm_open(path, O_RDWR, 0600);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	for (waited = 0; waited < VIRTUAL_CAN_OPEN_TIMEOUT; ++waited) {
+		if (bus == MAP_FAILED && fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(VirtualCanBus)) {
+			bus = mmap(NULL, sizeof(VirtualCanBus), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+		if (bus != MAP_FAILED && bus->Magic == VIRTUAL_CAN_MAGIC) {
+			__sync_synchronize();
+			close(fd);
+			return bus;
+		}
+		usleep(1000);
+	}
+
+	if (bus != MAP_FAILED) {
+		munmap(bus, sizeof(VirtualCanBus));
+	}
+	close(fd);
+	return NULL;
+}
+
+/**
+ * Creates and maps a new shared memory bus, or maps the existing one.
+ */
+static VirtualCanBus *VirtualCanMap(const char *name, const VirtualCanConfig *config)
+{
+	char path[NAME_MAX];
+	pthread_mutexattr_t attr;
+	VirtualCanBus *bus;
+	int fd;
+
+	if (snprintf(path, sizeof(path), "/%s", name) >= (int)sizeof(path)) {
+		return NULL;
+	}
+	fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if (fd < 0) {
+		return (errno == EEXIST) ? VirtualCanMapExisting(path) : NULL;
+	}
+
+	if (ftruncate(fd, sizeof(VirtualCanBus)) != 0 ||
+	    (bus = mmap(NULL, sizeof(VirtualCanBus), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		close(fd);
+		shm_unlink(path);
+		return NULL;
+	}
+	close(fd);
+
+	// The object starts out zeroed, so only the lock and configuration need setting up.
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+	pthread_mutex_init(&bus->Lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+	if (config) {
+		bus->Config = *config;
+	}
+	bus->Random = bus->Config.Seed ? bus->Config.Seed : 1;
+	__sync_synchronize();
+	bus->Magic = VIRTUAL_CAN_MAGIC;
+	return bus;
+}
+
+bool VirtualCanOpen(VirtualCanPort *port, const char *name, const VirtualCanConfig *config)
+{
+	VirtualCanBus *bus = VirtualCanMap(name, config);
+	uint8_t i;
+
+	memset(port, 0, sizeof(*port));
+	port->socket = -1;
+	if (!bus) {
+		return false;
+	}
+
+	// Take a free slot, or the slot of a process that's gone without detaching.
+	VirtualCanLock(bus);
+	for (i = 0; i < VIRTUAL_CAN_MAX_NODES; ++i) {
+		VirtualCanNode *n = &bus->Nodes[i];
+		if (!n->Pid || (kill(n->Pid, 0) != 0 && errno == ESRCH)) {
+			if (bus->Busy && bus->Sender == i) {
+				bus->Busy = false;
+			}
+			memset(n, 0, sizeof(*n));
+			n->Pid = getpid();
+			break;
+		}
+	}
+	VirtualCanUnlock(bus);
+
+	if (i == VIRTUAL_CAN_MAX_NODES) {
+		munmap(bus, sizeof(VirtualCanBus));
+		return false;
+	}
+	port->bus = bus;
+	port->node = i;
+	return true;
+}
+
+bool VirtualCanOpenSocket(VirtualCanPort *port, const char *interface, const VirtualCanConfig *config)
+{
+	memset(port, 0, sizeof(*port));
+	port->socket = -1;
+#ifdef __linux__
+	{
+		struct sockaddr_can address = {.can_family = AF_CAN};
+		struct ifreq request;
+		const int s = socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK, CAN_RAW);
+		if (s < 0) {
+			return false;
+		}
+		memset(&request, 0, sizeof(request));
+		strncpy(request.ifr_name, interface, IFNAMSIZ - 1);
+		if (ioctl(s, SIOCGIFINDEX, &request) != 0) {
+			close(s);
+			return false;
+		}
+		address.can_ifindex = request.ifr_ifindex;
+		if (bind(s, (struct sockaddr *)&address, sizeof(address)) != 0) {
+			close(s);
+			return false;
+		}
+		port->socket = s;
+		if (config) {
+			port->config = *config;
+		}
+		port->random = port->config.Seed ? port->config.Seed : 1;
+		return true;
+	}
+#else
+	(void)interface;
+	(void)config;
+	return false;
+#endif
+}
+
+void VirtualCanClose(VirtualCanPort *port)
+{
+	if (port->bus) {
+		VirtualCanNode *n = &port->bus->Nodes[port->node];
+		VirtualCanLock(port->bus);
+		if (port->bus->Busy && port->bus->Sender == port->node) {
+			port->bus->Busy = false;
+		}
+		n->Loaded = 0;
+		n->Pid = 0;
+		VirtualCanUnlock(port->bus);
+		munmap(port->bus, sizeof(VirtualCanBus));
+		port->bus = NULL;
+	}
+	if (port->socket >= 0) {
+		close(port->socket);
+		port->socket = -1;
+	}
+}
+
+bool VirtualCanRemove(const char *name)
+{
+	char path[NAME_MAX];
+	if (snprintf(path, sizeof(path), "/%s", name) >= (int)sizeof(path)) {
+		return false;
+	}
+	return shm_unlink(path) == 0;
+}
+
+void VirtualCanSetFilters(VirtualCanPort *port, const EcanFilterRegisters *filters)
+{
+	bool *filtered = &port->filtered;
+	EcanFilterRegisters *regs = &port->filters;
+
+	if (port->bus) {
+		VirtualCanLock(port->bus);
+		filtered = &port->bus->Nodes[port->node].Filtered;
+		regs = &port->bus->Nodes[port->node].Filters;
+	}
+	*filtered = filters != NULL;
+	if (filters) {
+		*regs = *filters;
+	}
+	if (port->bus) {
+		VirtualCanUnlock(port->bus);
+	}
+}
+
+bool VirtualCanLoad(VirtualCanPort *port, uint8_t buffer, const CanMessage *msg)
+{
+	bool loaded = false;
+	if (buffer >= VIRTUAL_CAN_BUFFERS) {
+		return false;
+	}
+
+	if (port->bus) {
+		VirtualCanNode *n = &port->bus->Nodes[port->node];
+		const uint64_t now = VirtualCanNow();
+		VirtualCanLock(port->bus);
+		if (!(n->Loaded & (1 << buffer))) {
+			n->Buffers[buffer] = *msg;
+			n->LoadedAt[buffer] = now;
+			n->Loaded |= 1 << buffer;
+			loaded = true;
+		}
+		VirtualCanUnlock(port->bus);
+	} else if (!(port->loaded & (1 << buffer))) {
+		port->buffers[buffer] = *msg;
+		port->loaded |= 1 << buffer;
+		loaded = true;
+	}
+	return loaded;
+}
+
+bool VirtualCanIsLoaded(VirtualCanPort *port, uint8_t buffer)
+{
+	if (buffer >= VIRTUAL_CAN_BUFFERS) {
+		return false;
+	}
+	// A single byte is read atomically, so this doesn't need the lock.
+	if (port->bus) {
+		return (*(volatile uint8_t *)&port->bus->Nodes[port->node].Loaded >> buffer) & 1;
+	}
+	return (port->loaded >> buffer) & 1;
+}
+
+void VirtualCanService(VirtualCanPort *port)
+{
+	if (port->bus) {
+		const uint64_t now = VirtualCanNow();
+		VirtualCanLock(port->bus);
+		VirtualCanRun(port->bus, now);
+		VirtualCanUnlock(port->bus);
+	}
+#ifdef __linux__
+	// Write out the loaded buffers in order, until the interface's queue is full.
+	while (port->socket >= 0 && port->loaded) {
+		const uint8_t b = __builtin_ctz(port->loaded);
+		const CanMessage *msg = &port->buffers[b];
+		struct can_frame frame = {.can_id = msg->id};
+		if (msg->frame_type == CAN_FRAME_EXT) {
+			frame.can_id = (msg->id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+		} else {
+			frame.can_id = msg->id & CAN_SFF_MASK;
+		}
+		if (msg->message_type == CAN_MSG_RTR) {
+			frame.can_id |= CAN_RTR_FLAG;
+		}
+		frame.can_dlc = (msg->validBytes < 8) ? msg->validBytes : 8;
+		memcpy(frame.data, msg->payload, frame.can_dlc);
+		if (write(port->socket, &frame, sizeof(frame)) != sizeof(frame)) {
+			break;
+		}
+		port->loaded &= ~(1 << b);
+		++port->stats.Sent;
+	}
+#endif
+}
+
+uint8_t VirtualCanReceive(VirtualCanPort *port, CanMessage *msgs, uint8_t maxFrames)
+{
+	uint8_t found = 0;
+
+	if (port->bus) {
+		VirtualCanNode *n = &port->bus->Nodes[port->node];
+		VirtualCanLock(port->bus);
+		while (found < maxFrames && n->RxTail != n->RxHead) {
+			msgs[found++] = n->Rx[n->RxTail++ & (VIRTUAL_CAN_RX_LENGTH - 1)];
+		}
+		VirtualCanUnlock(port->bus);
+	}
+#ifdef __linux__
+	while (port->socket >= 0 && found < maxFrames) {
+		struct can_frame frame;
+		CanMessage *msg = &msgs[found];
+		if (read(port->socket, &frame, sizeof(frame)) != sizeof(frame)) {
+			break;
+		}
+		if (frame.can_id & CAN_ERR_FLAG) {
+			continue;
+		}
+		memset(msg, 0, sizeof(*msg));
+		if (frame.can_id & CAN_EFF_FLAG) {
+			msg->frame_type = CAN_FRAME_EXT;
+			msg->id = frame.can_id & CAN_EFF_MASK;
+		} else {
+			msg->frame_type = CAN_FRAME_STD;
+			msg->id = frame.can_id & CAN_SFF_MASK;
+		}
+		msg->message_type = (frame.can_id & CAN_RTR_FLAG) ? CAN_MSG_RTR : CAN_MSG_DATA;
+		msg->validBytes = (frame.can_dlc < 8) ? frame.can_dlc : 8;
+		memcpy(msg->payload, frame.data, msg->validBytes);
+
+		if (port->filtered && !EcanFilterAccepts(&port->filters, msg->id, msg->frame_type == CAN_FRAME_EXT)) {
+			++port->stats.Filtered;
+		} else if (VirtualCanLose(&port->random, port->config.LossPpm)) {
+			++port->stats.Lost;
+		} else {
+			++port->stats.Received;
+			++found;
+		}
+	}
+#endif
+	return found;
+}
+
+void VirtualCanGetStats(VirtualCanPort *port, VirtualCanStats *stats)
+{
+	if (port->bus) {
+		VirtualCanLock(port->bus);
+		*stats = port->bus->Nodes[port->node].Stats;
+		VirtualCanUnlock(port->bus);
+	} else {
+		*stats = port->stats;
+	}
+}
+
+/**
+ * This begins the unit testing code. Directions for compilation are at the top of the header file.
+ */
+#ifdef UNIT_TEST_VIRTUAL_CAN
+
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include <sched.h>
+#include <sys/wait.h>
+
+#include "Nmea2000.h"
+
+static char busName[64];
+
+static CanMessage Frame(uint32_t id, bool extended, uint8_t length)
+{
+	CanMessage m;
+	uint8_t i;
+	memset(&m, 0, sizeof(m));
+	m.id = id;
+	m.frame_type = extended ? CAN_FRAME_EXT : CAN_FRAME_STD;
+	m.message_type = CAN_MSG_DATA;
+	m.validBytes = length;
+	for (i = 0; i < length; ++i) {
+		m.payload[i] = rand();
+	}
+	return m;
+}
+
+static double Seconds(void)
+{
+	return VirtualCanNow() / 1e9;
+}
+
+/**
+ * Returns whether any node's queue of received frames is more than half full.
+ */
+static bool Backlogged(const VirtualCanBus *bus)
+{
+	uint8_t i;
+	for (i = 0; i < VIRTUAL_CAN_MAX_NODES; ++i) {
+		const volatile VirtualCanNode *n = &bus->Nodes[i];
+		if (n->Pid && n->RxHead - n->RxTail > VIRTUAL_CAN_RX_LENGTH / 2) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Keeps the buffers of a port full of frames until `count` frames have been loaded.
+ * @param paced Whether to hold off while the receivers are backlogged, so that a bus without a bit
+ *              rate doesn't just overflow them.
+ */
+static void SendFrames(VirtualCanPort *p, uint32_t count, uint32_t id, bool paced)
+{
+	CanMessage msgs[16];
+	uint32_t loaded = 0;
+	while (loaded < count) {
+		uint8_t b;
+		// Other senders' frames are of no interest.
+		while (VirtualCanReceive(p, msgs, 16));
+		if (paced && Backlogged(p->bus)) {
+			sched_yield();
+			continue;
+		}
+		for (b = 0; b < VIRTUAL_CAN_BUFFERS && loaded < count; ++b) {
+			if (!VirtualCanIsLoaded(p, b)) {
+				CanMessage m = Frame(id, false, 8);
+				m.payload[0] = loaded;
+				assert(VirtualCanLoad(p, b, &m));
+				++loaded;
+			}
+		}
+		VirtualCanService(p);
+		// Let the other nodes run while the buffers are full, or on a single core they'd only get to
+		// service the bus once this one's time slice is up.
+		if (loaded < count && VirtualCanIsLoaded(p, VIRTUAL_CAN_BUFFERS - 1)) {
+			sched_yield();
+		}
+	}
+	while (p->bus->Nodes[p->node].Loaded) {
+		VirtualCanService(p);
+	}
+}
+
+/**
+ * Sends frames as fast as possible from `senders` processes to this one, which takes them off its
+ * queue as fast as it can. Without a bit rate, the senders hold off while it's backlogged.
+ * @param dropped Set to the share of the frames that overflowed the receiving queue.
+ * @return The frames per second sent over the bus.
+ */
+static double Benchmark(uint8_t senders, uint32_t count, const VirtualCanConfig *config, double *dropped)
+{
+	VirtualCanPort rx;
+	VirtualCanStats stats;
+	CanMessage msgs[16];
+	pid_t pids[VIRTUAL_CAN_MAX_NODES];
+	uint8_t running = senders;
+	double start;
+	uint8_t i;
+
+	VirtualCanRemove(busName);
+	assert(VirtualCanOpen(&rx, busName, config));
+	for (i = 0; i < senders; ++i) {
+		if (!(pids[i] = fork())) {
+			VirtualCanPort tx;
+			assert(VirtualCanOpen(&tx, busName, NULL));
+			SendFrames(&tx, count, 0x100 + i, config->BitRate == 0);
+			VirtualCanClose(&tx);
+			_exit(0);
+		}
+	}
+
+	// Only start timing once the first frame is in, so process startup isn't part of it.
+	do {
+		VirtualCanService(&rx);
+		VirtualCanGetStats(&rx, &stats);
+	} while (!stats.Received && !stats.Overflows);
+	start = Seconds();
+
+	while (running) {
+		int status;
+		VirtualCanService(&rx);
+		if (!VirtualCanReceive(&rx, msgs, 16)) {
+			sched_yield();
+		}
+		for (i = 0; i < senders; ++i) {
+			if (pids[i] && waitpid(pids[i], &status, WNOHANG) == pids[i]) {
+				assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+				pids[i] = 0;
+				--running;
+			}
+		}
+	}
+	start = Seconds() - start;
+
+	VirtualCanGetStats(&rx, &stats);
+	assert(stats.Received + stats.Overflows == senders * count);
+	*dropped = (double)stats.Overflows / (senders * count);
+	VirtualCanClose(&rx);
+	return senders * count / start;
+}
+
+int main(int argc, char *argv[])
+{
+	const VirtualCanConfig instant = {0, 0, 1};
+	const VirtualCanConfig slow = {250000, 0, 1};
+	VirtualCanPort a, b, c, d;
+	CanMessage m, msgs[16];
+	VirtualCanStats stats;
+
+	snprintf(busName, sizeof(busName), "virtual-can-test-%d", (int)getpid());
+	srand(5);
+
+	// Frames go to every node but the sender.
+	{
+		assert(VirtualCanOpen(&a, busName, &instant));
+		assert(VirtualCanOpen(&b, busName, &slow));
+		assert(VirtualCanOpen(&c, busName, &slow));
+		assert(a.bus->Config.BitRate == 0);
+		m = Frame(0x123, false, 5);
+		assert(VirtualCanLoad(&a, 3, &m));
+		assert(!VirtualCanLoad(&a, 3, &m));
+		assert(VirtualCanIsLoaded(&a, 3));
+		assert(VirtualCanReceive(&b, msgs, 16) == 0);
+		VirtualCanService(&c);
+		assert(!VirtualCanIsLoaded(&a, 3));
+		assert(VirtualCanReceive(&a, msgs, 16) == 0);
+		assert(VirtualCanReceive(&b, msgs, 16) == 1 && !memcmp(&msgs[0], &m, sizeof(m)));
+		assert(VirtualCanReceive(&c, msgs, 16) == 1 && !memcmp(&msgs[0], &m, sizeof(m)));
+		VirtualCanGetStats(&a, &stats);
+		assert(stats.Sent == 1 && stats.Received == 0);
+		VirtualCanClose(&a);
+		VirtualCanClose(&b);
+		VirtualCanClose(&c);
+		assert(VirtualCanRemove(busName));
+		printf("Frames reach every other node.\n");
+	}
+
+	// Frames offered while the bus is busy go in order of arbitration, each node offering the frame in
+	// its lowest-numbered buffer.
+	{
+		const uint32_t ext = 0x1F4UL << 18 | 0x1234; // The same base ID as 0x1F4
+		const uint32_t order[] = {0x7FF, 0x1F4, 0x1F0, 0x1F4 | 0x800, ext, 0x300, 0x050};
+		uint8_t i;
+		assert(VirtualCanOpen(&a, busName, &slow));
+		assert(VirtualCanOpen(&b, busName, NULL));
+		assert(VirtualCanOpen(&c, busName, NULL));
+		assert(VirtualCanOpen(&d, busName, NULL));
+		m = Frame(0x7FF, false, 8);
+		assert(VirtualCanLoad(&a, 0, &m));
+		VirtualCanService(&a);
+		assert(a.bus->Busy);
+
+		m = Frame(0x300, false, 8);
+		assert(VirtualCanLoad(&b, 0, &m));
+		m = Frame(0x050, false, 8);
+		assert(VirtualCanLoad(&b, 1, &m)); // Waits for the one in buffer 0
+		m = Frame(ext, true, 8);
+		assert(VirtualCanLoad(&c, 2, &m));
+		m = Frame(0x1F4, false, 0);
+		m.message_type = CAN_MSG_RTR;
+		assert(VirtualCanLoad(&c, 0, &m));  // Remote, so loses from the data frame with the same ID
+		m = Frame(0x1F4, false, 2);
+		assert(VirtualCanLoad(&a, 1, &m));
+		m = Frame(0x1F0, false, 8);
+		assert(VirtualCanLoad(&a, 2, &m));
+
+		// Every frame takes about 0.5ms at 250kbit/s, so they're all in by then.
+		usleep(10000);
+		VirtualCanService(&d);
+		assert(VirtualCanReceive(&d, msgs, 16) == 7);
+		printf("Arbitration order:");
+		for (i = 0; i < 7; ++i) {
+			const uint32_t id = msgs[i].id | (msgs[i].message_type == CAN_MSG_RTR ? 0x800 : 0);
+			printf(" %s%X", msgs[i].frame_type == CAN_FRAME_EXT ? "ext " : "", msgs[i].id);
+			assert(id == order[i]);
+		}
+		printf("\n");
+		VirtualCanClose(&a);
+		VirtualCanClose(&b);
+		VirtualCanClose(&c);
+		VirtualCanClose(&d);
+		assert(VirtualCanRemove(busName));
+	}
+
+	// At 250kbit/s, frames take as long as they would on a real bus.
+	{
+		const uint32_t count = 2000;
+		double start, elapsed, expected;
+		assert(VirtualCanOpen(&a, busName, &slow));
+		assert(VirtualCanOpen(&b, busName, NULL));
+		m = Frame(0x100, false, 8);
+		expected = count * (double)CanBusMonitorFrameBits(&m) / slow.BitRate;
+		start = Seconds();
+		SendFrames(&a, count, 0x100, false);
+		elapsed = Seconds() - start;
+		// Nobody's taking frames off, so most overflow the receiving node's queue.
+		VirtualCanGetStats(&b, &stats);
+		assert(stats.Received == VIRTUAL_CAN_RX_LENGTH && stats.Received + stats.Overflows == count);
+		printf("%u frames at 250kbit/s took %.3fs, expected about %.3fs.\n", count, elapsed, expected);
+		assert(fabs(elapsed - expected) < expected * 0.05);
+		VirtualCanClose(&a);
+		VirtualCanClose(&b);
+		assert(VirtualCanRemove(busName));
+	}
+
+	// Acceptance filters and loss injection.
+	{
+		const VirtualCanConfig lossy = {0, 100000, 7};
+		const EcanFilterTarget targets[] = {{0x100, false}, {127245, true}};
+		EcanFilterRegisters regs;
+		const uint32_t count = 20000;
+		uint32_t received;
+		assert(EcanFilterPlan(targets, 2, &regs, NULL));
+		assert(VirtualCanOpen(&a, busName, &lossy));
+		assert(VirtualCanOpen(&b, busName, NULL));
+		assert(VirtualCanOpen(&c, busName, NULL));
+		VirtualCanSetFilters(&c, &regs);
+
+		m = Frame(0x101, false, 8);
+		assert(VirtualCanLoad(&a, 0, &m));
+		m = Frame(Iso11783Encode(127245, 5, 0xFF, 2), true, 8);
+		assert(VirtualCanLoad(&a, 1, &m));
+		VirtualCanService(&a);
+		VirtualCanGetStats(&c, &stats);
+		assert(stats.Filtered == 1 && stats.Received + stats.Lost == 1);
+		VirtualCanReceive(&b, msgs, 16);
+		VirtualCanReceive(&c, msgs, 16);
+
+		received = 0;
+		while (received < count) {
+			uint8_t i;
+			for (i = 0; i < VIRTUAL_CAN_BUFFERS; ++i) {
+				m = Frame(0x100, false, 8);
+				VirtualCanLoad(&a, i, &m);
+			}
+			VirtualCanService(&a);
+			received += VIRTUAL_CAN_BUFFERS;
+			VirtualCanReceive(&b, msgs, 16);
+			VirtualCanReceive(&c, msgs, 16);
+		}
+		VirtualCanGetStats(&b, &stats);
+		printf("With 10%% loss injected, %.2f%% of frames were lost.\n", 100.0 * stats.Lost / (stats.Lost + stats.Received));
+		assert(stats.Received + stats.Lost == count + 2 && stats.Overflows == 0);
+		assert(abs((int)stats.Lost - (int)count / 10) < (int)count / 100);
+		VirtualCanClose(&a);
+		VirtualCanClose(&b);
+		VirtualCanClose(&c);
+		assert(VirtualCanRemove(busName));
+	}
+
+	// A node that dies holding the lock with a frame on the bus doesn't take the bus down with it.
+	{
+		pid_t pid;
+		int status;
+		assert(VirtualCanOpen(&a, busName, &slow));
+		if (!(pid = fork())) {
+			VirtualCanPort p;
+			assert(VirtualCanOpen(&p, busName, NULL));
+			m = Frame(0x200, false, 8);
+			VirtualCanLoad(&p, 0, &m);
+			VirtualCanService(&p);
+			VirtualCanLock(p.bus);
+			_exit(0);
+		}
+		waitpid(pid, &status, 0);
+		assert(VirtualCanOpen(&b, busName, NULL) && b.node == 1);
+		m = Frame(0x300, false, 8);
+		VirtualCanLoad(&b, 0, &m);
+		usleep(10000);
+		VirtualCanService(&b);
+		assert(VirtualCanReceive(&a, msgs, 16) == 1 && msgs[0].id == 0x300);
+		VirtualCanClose(&a);
+		VirtualCanClose(&b);
+		assert(VirtualCanRemove(busName));
+		printf("Recovered from a node dying while holding the lock.\n");
+	}
+
+	// SocketCAN, if an interface is given.
+	if (argc > 1) {
+		const VirtualCanConfig config = {0, 0, 1};
+		uint32_t received;
+		assert(VirtualCanOpenSocket(&a, argv[1], &config));
+		assert(VirtualCanOpenSocket(&b, argv[1], &config));
+		m = Frame(Iso11783Encode(130306, 7, 0xFF, 2), true, 8);
+		assert(VirtualCanLoad(&a, 0, &m));
+		m = Frame(0x123, false, 0);
+		m.message_type = CAN_MSG_RTR;
+		assert(VirtualCanLoad(&a, 1, &m));
+		VirtualCanService(&a);
+		usleep(10000);
+		received = VirtualCanReceive(&b, msgs, 16);
+		assert(received == 2 && msgs[1].id == 0x123 && msgs[1].message_type == CAN_MSG_RTR);
+		assert(msgs[0].frame_type == CAN_FRAME_EXT && Iso11783Decode(msgs[0].id, NULL, NULL, NULL) == 130306);
+		assert(VirtualCanReceive(&a, msgs, 16) == 0);
+		VirtualCanClose(&a);
+		VirtualCanClose(&b);
+		printf("Frames pass through %s.\n", argv[1]);
+	} else {
+		printf("Skipping SocketCAN, give the name of an interface to test it.\n");
+	}
+
+	// Finally the benchmark: how many frames per second can get through the bus between processes.
+	// Timed at 1Mbit/s, the bus itself should be the bottleneck.
+	{
+		const VirtualCanConfig fast = {1000000, 0, 1};
+		const uint8_t senders[] = {1, 2, 4, 8};
+		const CanMessage f = Frame(0x100, false, 8);
+		const double limit = 1e6 / CanBusMonitorFrameBits(&f);
+		uint8_t i;
+		printf("%-8s %16s %10s %16s %10s\n", "senders", "instant frames/s", "overflowed", "1Mbit/s frames/s", "overflowed");
+		for (i = 0; i < sizeof(senders) / sizeof(senders[0]); ++i) {
+			double instantDropped, fastDropped;
+			const double instantRate = Benchmark(senders[i], 400000 / senders[i], &instant, &instantDropped);
+			const double fastRate = Benchmark(senders[i], 20000 / senders[i], &fast, &fastDropped);
+			printf("%-8u %16.0f %9.1f%% %16.0f %9.1f%%\n", senders[i], instantRate, 100 * instantDropped, fastRate, 100 * fastDropped);
+			assert(fastRate < limit * 1.01 && fastRate > limit * 0.9 && fastDropped == 0);
+		}
+		VirtualCanRemove(busName);
+	}
+
+	printf("All tests passed.\n");
+	return EXIT_SUCCESS;
+}
+
+#endif // UNIT_TEST_VIRTUAL_CAN
@@ -0,0 +1,159 @@
+/**
+ * @file   VirtualCan.h
+ * @brief  A CAN bus between processes on a Linux host, for running node firmware off-target.
+ *
+ * The bus lives in a POSIX shared memory object, which the first process to open it creates. Every
+ * process then attaches as a node, with transmission buffers like those of the ECAN module and a
+ * queue of received frames. A frame is put on the bus by loading it into a buffer, and is sent
+ * whenever any node services the bus:
+ *  * Of the frames loaded into a node's buffers, the one in the lowest-numbered buffer is offered to
+ *    the bus first, like the ECAN module does with the buffer of the highest TXnPRI.
+ *  * Between nodes, arbitration goes like on a real bus: when the bus frees up, the offered frame
+ *    with the lowest arbitration field wins. So the lowest ID wins, and a standard frame wins from an
+ *    extended one with the same base ID, and a data frame from a remote one.
+ *  * With a bit rate set, every frame takes as long as it would on a real bus, going by its length
+ *    including stuff bits as estimated by CanBusMonitorFrameBits(). Frames only arrive once they've
+ *    been fully sent, and the bus is busy until then. The bus keeps real time, so frames are sent
+ *    when they would have been even if the bus is serviced late. With a bit rate of 0 frames are
+ *    sent instantly.
+ *  * Every other node receives the frame if its acceptance filters let it through. For testing how
+ *    nodes cope with losing frames, loss injection makes a node miss a frame at random with a given
+ *    probability.
+ *
+ * Frames are only sent while nodes service the bus, which they do whenever they send or receive, so
+ * a node that's waiting for frames has to keep polling for them.
+ *
+ * Alternatively the same interface can be backed by a SocketCAN interface, like a `vcan` interface,
+ * to use Linux's CAN tools alongside the nodes or to bridge them to a real bus. Arbitration and
+ * timing are then left to the interface, while acceptance filtering and loss injection still
+ * apply.
+ *
+ * Nodes that crash while holding the bus lock don't hang the bus: the lock is robust, and the slots
+ * of nodes whose process is gone are reused.
+ *
+ * Unit testing, and a benchmark of the frames per second the bus can pass between processes, are
+ * done by compiling with the UNIT_TEST_VIRTUAL_CAN macro:
+ * `gcc VirtualCan.c CanBusMonitor.c EcanFilterPlanner.c Nmea2000.c -DUNIT_TEST_VIRTUAL_CAN -I. -O2 -Wall -pthread -lrt -lm`
+ * Given the name of a SocketCAN interface, it tests that backend as well. One can be set up with:
+ * `sudo modprobe vcan && sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0`
+ */
+#ifndef VIRTUAL_CAN_H
+#define VIRTUAL_CAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "EcanDefines.h"
+#include "EcanFilterPlanner.h"
+
+// The most nodes on a bus.
+#define VIRTUAL_CAN_MAX_NODES 16
+
+// The transmission buffers of every node, like the ECAN module has up to 8.
+#define VIRTUAL_CAN_BUFFERS 8
+
+// The frames a node can have received before it starts dropping them. Must be a power of 2.
+#define VIRTUAL_CAN_RX_LENGTH 64
+
+/**
+ * How a bus behaves. It's set by the process that creates the bus.
+ */
+typedef struct {
+	uint32_t BitRate; // The bit rate frames are sent at, or 0 to send them instantly.
+	uint32_t LossPpm; // The chance, in parts per million, that a node misses a frame.
+	uint32_t Seed;    // Seeds the random number generator of the loss injection.
+} VirtualCanConfig;
+
+/**
+ * The statistics of a node, since it attached.
+ */
+typedef struct {
+	uint32_t Sent;      // Frames this node sent.
+	uint32_t Received;  // Frames this node received.
+	uint32_t Filtered;  // Frames its acceptance filters rejected.
+	uint32_t Lost;      // Frames it missed through loss injection.
+	uint32_t Overflows; // Frames dropped because its queue of received frames was full.
+} VirtualCanStats;
+
+// The shared state of a bus.
+typedef struct VirtualCanBus VirtualCanBus;
+
+/**
+ * A node's connection to a bus. Use the VirtualCan*() functions instead of accessing it directly.
+ */
+typedef struct {
+	VirtualCanBus *bus;     // The shared memory bus, or NULL for SocketCAN.
+	uint8_t node;           // This node's slot on a shared memory bus.
+	int socket;             // The SocketCAN socket, or -1.
+
+	// The state of a SocketCAN node, which isn't shared.
+	VirtualCanConfig config;
+	CanMessage buffers[VIRTUAL_CAN_BUFFERS];
+	uint8_t loaded;         // Bit n is set while buffer n holds a frame.
+	bool filtered;
+	EcanFilterRegisters filters;
+	uint32_t random;
+	VirtualCanStats stats;
+} VirtualCanPort;
+
+/**
+ * Attaches to a shared memory bus as a new node, creating the bus if it doesn't exist yet.
+ * @param name The name of the bus, without a leading slash.
+ * @param config How a newly created bus behaves. It's ignored when the bus already exists.
+ * @return False if the bus couldn't be created or opened, or all its node slots are taken.
+ */
+bool VirtualCanOpen(VirtualCanPort *port, const char *name, const VirtualCanConfig *config);
+
+/**
+ * Attaches to a SocketCAN interface instead. Only the LossPpm and Seed of `config` apply.
+ * @param interface The name of the interface, like "vcan0".
+ * @return False if the interface doesn't exist or can't be opened, or this isn't Linux.
+ */
+bool VirtualCanOpenSocket(VirtualCanPort *port, const char *interface, const VirtualCanConfig *config);
+
+/**
+ * Detaches from the bus. Frames still loaded are dropped, and the bus stays around for other nodes.
+ */
+void VirtualCanClose(VirtualCanPort *port);
+
+/**
+ * Removes a shared memory bus, so the next node to open it creates a new one. Nodes still attached
+ * to it keep using the old one.
+ */
+bool VirtualCanRemove(const char *name);
+
+/**
+ * Sets the acceptance filters this node receives frames through, like Ecan1InitFiltered().
+ * @param filters The filters, or NULL to receive all frames.
+ */
+void VirtualCanSetFilters(VirtualCanPort *port, const EcanFilterRegisters *filters);
+
+/**
+ * Loads a frame into a transmission buffer, which it's sent from when the bus is next serviced.
+ * @param buffer Which buffer, lower-numbered buffers being sent first.
+ * @return False if the buffer is still loaded or doesn't exist.
+ */
+bool VirtualCanLoad(VirtualCanPort *port, uint8_t buffer, const CanMessage *msg);
+
+/**
+ * Returns whether a transmission buffer still holds a frame that hasn't been sent.
+ */
+bool VirtualCanIsLoaded(VirtualCanPort *port, uint8_t buffer);
+
+/**
+ * Sends every frame the bus has had time for since it was last serviced, by any node.
+ */
+void VirtualCanService(VirtualCanPort *port);
+
+/**
+ * Takes up to `maxFrames` of the oldest received frames off this node's queue.
+ * @return The number of frames written to `msgs`.
+ */
+uint8_t VirtualCanReceive(VirtualCanPort *port, CanMessage *msgs, uint8_t maxFrames);
+
+/**
+ * Returns the statistics of this node.
+ */
+void VirtualCanGetStats(VirtualCanPort *port, VirtualCanStats *stats);
+
+#endif // VIRTUAL_CAN_H
@@ -21,7 +21,24 @@ extern "C" {
 #define X25_INIT_CRC 0xffff
 #define X25_VALIDATE_CRC 0xf0b8
 
+/**
+ * Selects how the CRC is computed when crc_accumulate() isn't provided externally:
+ *   0: bit-serial, one byte at a time, without any tables.
+ *   1: a single 256-entry table, one byte at a time (512 bytes of tables).
+ *   4: the same for single bytes, but crc_accumulate_buffer() folds in 4 bytes per step using
+ *      slicing-by-4 (2KiB of tables).
+ *   8: likewise with slicing-by-8 (4KiB of tables).
+ * All of them produce identical checksums. On the dsPIC the tables live in program memory.
+ */
+#ifndef MAVLINK_CRC_SLICING
+#define MAVLINK_CRC_SLICING 4
+#endif
+
 #ifndef HAVE_CRC_ACCUMULATE
+#if MAVLINK_CRC_SLICING
+#include "checksum_tables.h"
+#endif
+
 /**
  * @brief Accumulate the X.25 CRC by adding one char at a time.
  *
@@ -33,12 +50,17 @@ extern "C" {
  **/
 static inline void crc_accumulate(uint8_t data, uint16_t *crcAccum)
 {
+#if MAVLINK_CRC_SLICING
+        /*Accumulate one byte of data into the CRC with a single table lookup*/
+        *crcAccum = (*crcAccum >> 8) ^ crc_x25_table[0][(uint8_t)(*crcAccum ^ data)];
+#else
         /*Accumulate one byte of data into the CRC*/
         uint8_t tmp;
 
         tmp = data ^ (uint8_t)(*crcAccum &0xff);
         tmp ^= (tmp<<4);
         *crcAccum = (*crcAccum>>8) ^ (tmp<<8) ^ (tmp <<3) ^ (tmp>>4);
+#endif
 }
 #endif
 
@@ -54,29 +76,11 @@ static inline void crc_init(uint16_t* crcAccum)
 }
 
 
-/**
- * @brief Calculates the X.25 checksum on a byte buffer
- *
- * @param  pBuffer buffer containing the byte array to hash
- * @param  length  length of the byte array
- * @return the checksum over the buffer bytes
- **/
-static inline uint16_t crc_calculate(const uint8_t* pBuffer, uint16_t length)
-{
-        uint16_t crcTmp;
-        crc_init(&crcTmp);
-	while (length--) {
-                crc_accumulate(*pBuffer++, &crcTmp);
-        }
-        return crcTmp;
-}
-
-
 /**
  * @brief Accumulate the X.25 CRC by adding an array of bytes
  *
- * The checksum function adds the hash of one char at a time to the
- * 16 bit checksum (uint16_t).
+ * The checksum function adds the hash of the bytes to the 16 bit
+ * checksum (uint16_t), 4 or 8 at a time if MAVLINK_CRC_SLICING allows.
  *
  * @param data new bytes to hash
  * @param crcAccum the already accumulated checksum
@@ -84,9 +88,47 @@ static inline uint16_t crc_calculate(const uint8_t* pBuffer, uint16_t length)
 static inline void crc_accumulate_buffer(uint16_t *crcAccum, const char *pBuffer, uint16_t length)
 {
 	const uint8_t *p = (const uint8_t *)pBuffer;
+	uint16_t crc = *crcAccum;
+#if !defined(HAVE_CRC_ACCUMULATE) && MAVLINK_CRC_SLICING >= 8
+	/* Fold the next two bytes into the CRC and then look up the effect of all 8 bytes at once */
+	while (length >= 8) {
+		crc ^= p[0] | ((uint16_t)p[1] << 8);
+		crc = crc_x25_table[7][crc & 0xff] ^ crc_x25_table[6][crc >> 8] ^
+		      crc_x25_table[5][p[2]] ^ crc_x25_table[4][p[3]] ^
+		      crc_x25_table[3][p[4]] ^ crc_x25_table[2][p[5]] ^
+		      crc_x25_table[1][p[6]] ^ crc_x25_table[0][p[7]];
+		p += 8;
+		length -= 8;
+	}
+#endif
+#if !defined(HAVE_CRC_ACCUMULATE) && MAVLINK_CRC_SLICING >= 4
+	while (length >= 4) {
+		crc ^= p[0] | ((uint16_t)p[1] << 8);
+		crc = crc_x25_table[3][crc & 0xff] ^ crc_x25_table[2][crc >> 8] ^
+		      crc_x25_table[1][p[2]] ^ crc_x25_table[0][p[3]];
+		p += 4;
+		length -= 4;
+	}
+#endif
 	while (length--) {
-                crc_accumulate(*p++, crcAccum);
+                crc_accumulate(*p++, &crc);
         }
+	*crcAccum = crc;
+}
+
+/**
+ * @brief Calculates the X.25 checksum on a byte buffer
+ *
+ * @param  pBuffer buffer containing the byte array to hash
+ * @param  length  length of the byte array
+ * @return the checksum over the buffer bytes
+ **/
+static inline uint16_t crc_calculate(const uint8_t* pBuffer, uint16_t length)
+{
+        uint16_t crcTmp;
+        crc_init(&crcTmp);
+        crc_accumulate_buffer(&crcTmp, (const char *)pBuffer, length);
+        return crcTmp;
 }
 
 #endif /* _CHECKSUM_H_ */
@@ -354,9 +354,10 @@ MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_messa
 
 	case MAVLINK_PARSE_STATE_GOT_MSGID:
 		_MAV_PAYLOAD_NON_CONST(rxmsg)[status->packet_idx++] = (char)c;
-		mavlink_update_checksum(rxmsg, c);
 		if (status->packet_idx == rxmsg->len)
 		{
+			// The payload is checksummed all at once, as that's much faster than byte by byte.
+			crc_accumulate_buffer(&rxmsg->checksum, _MAV_PAYLOAD(rxmsg), rxmsg->len);
 			status->parse_state = MAVLINK_PARSE_STATE_GOT_PAYLOAD;
 		}
 		break;
@@ -386,6 +387,14 @@ MAVLINK_HELPER uint8_t mavlink_frame_char(uint8_t chan, uint8_t c, mavlink_messa
                 _MAV_PAYLOAD_NON_CONST(rxmsg)[status->packet_idx+1] = (char)c;
                 memcpy(r_message, rxmsg, sizeof(mavlink_message_t));
 		break;
+
+	case MAVLINK_PARSE_STATE_GOT_INCOMPAT_FLAGS:
+	case MAVLINK_PARSE_STATE_GOT_COMPAT_FLAGS:
+	case MAVLINK_PARSE_STATE_GOT_MSGID1:
+	case MAVLINK_PARSE_STATE_GOT_MSGID2:
+		// Only MavlinkHelpers.c parses MAVLink 2 frames, so start over.
+		status->parse_state = MAVLINK_PARSE_STATE_IDLE;
+		break;
 	}
 
 	bufferIndex++;
@@ -27,6 +27,16 @@
 
 #define MAVLINK_MAX_PACKET_LEN (MAVLINK_MAX_PAYLOAD_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES) ///< Maximum packet length
 
+// MAVLink 2 frames add incompatibility and compatibility flags and a 3-byte message ID to the header.
+// Their payload has its trailing zero bytes removed, down to a single byte, and the receiver fills
+// them back in. Message signing isn't supported, so the signature is never present.
+#define MAVLINK_STX_MAVLINK1 0xFE ///< Start of a MAVLink 1 frame
+#define MAVLINK_STX_MAVLINK2 0xFD ///< Start of a MAVLink 2 frame
+#define MAVLINK2_CORE_HEADER_LEN 9 ///< Length, incompat flags, compat flags, sequence, system id, component id, and 3 bytes of message id
+#define MAVLINK2_NUM_HEADER_BYTES (MAVLINK2_CORE_HEADER_LEN + 1)
+#define MAVLINK2_NUM_NON_PAYLOAD_BYTES (MAVLINK2_NUM_HEADER_BYTES + MAVLINK_NUM_CHECKSUM_BYTES)
+#define MAVLINK_IFLAG_SIGNED 0x01 ///< Incompatibility flag for a signed frame
+
 #define MAVLINK_MSG_ID_EXTENDED_MESSAGE 255
 #define MAVLINK_EXTENDED_HEADER_LEN 14
 
@@ -114,8 +124,8 @@ typedef struct __mavlink_system {
 MAVPACKED(
 typedef struct __mavlink_message {
 	uint16_t checksum; ///< sent at end of packet
-	uint8_t magic;   ///< protocol magic marker
-	uint8_t len;     ///< Length of payload
+	uint8_t magic;   ///< protocol magic marker, MAVLINK_STX_MAVLINK2 for a MAVLink 2 frame
+	uint8_t len;     ///< Length of payload, as sent, so without the zeros trimmed from a MAVLink 2 payload
 	uint8_t seq;     ///< Sequence of packet
 	uint8_t sysid;   ///< ID of message sender system/aircraft
 	uint8_t compid;  ///< ID of the message sender component
@@ -201,7 +211,11 @@ typedef enum {
     MAVLINK_PARSE_STATE_GOT_MSGID,
     MAVLINK_PARSE_STATE_GOT_PAYLOAD,
     MAVLINK_PARSE_STATE_GOT_CRC1,
-    MAVLINK_PARSE_STATE_GOT_BAD_CRC1
+    MAVLINK_PARSE_STATE_GOT_BAD_CRC1,
+    MAVLINK_PARSE_STATE_GOT_INCOMPAT_FLAGS,
+    MAVLINK_PARSE_STATE_GOT_COMPAT_FLAGS,
+    MAVLINK_PARSE_STATE_GOT_MSGID1,
+    MAVLINK_PARSE_STATE_GOT_MSGID2
 } mavlink_parse_state_t; ///< The state machine for the comm parser
 
 typedef enum {
@@ -220,8 +234,12 @@ typedef struct __mavlink_status {
     uint8_t current_tx_seq;             ///< Sequence number of last packet sent
     uint16_t packet_rx_success_count;   ///< Received packets
     uint16_t packet_rx_drop_count;      ///< Number of packet drops
+    uint8_t flags;                      ///< MAVLINK_STATUS_FLAG_* bits
 } mavlink_status_t;
 
+#define MAVLINK_STATUS_FLAG_IN_MAVLINK2  0x01 ///< The frame being parsed is a MAVLink 2 frame
+#define MAVLINK_STATUS_FLAG_OUT_MAVLINK2 0x02 ///< Frames on this channel may be sent as MAVLink 2
+
 #define MAVLINK_BIG_ENDIAN 0
 #define MAVLINK_LITTLE_ENDIAN 1
 
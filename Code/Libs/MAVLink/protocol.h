@@ -44,6 +44,8 @@
     MAVLINK_HELPER mavlink_status_t* mavlink_get_channel_status(uint8_t chan);
     #endif
     MAVLINK_HELPER void mavlink_reset_channel_status(uint8_t chan);
+    MAVLINK_HELPER void mavlink_set_proto_version(uint8_t chan, unsigned int version);
+    MAVLINK_HELPER unsigned int mavlink_get_proto_version(uint8_t chan);
     #if MAVLINK_CRC_EXTRA
     MAVLINK_HELPER uint16_t mavlink_finalize_message_chan(mavlink_message_t* msg, uint8_t system_id, uint8_t component_id,
                                   uint8_t chan, uint8_t length, uint8_t crc_extra);
@@ -86,9 +88,73 @@
  */
 static inline uint16_t mavlink_msg_get_send_buffer_length(const mavlink_message_t* msg)
 {
+	if (msg->magic == MAVLINK_STX_MAVLINK2) {
+		return msg->len + MAVLINK2_NUM_NON_PAYLOAD_BYTES;
+	}
 	return msg->len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
 }
 
+/**
+ * @brief Get the length of a payload without its trailing zero bytes, as sent in a MAVLink 2 frame.
+ * The first byte is always kept.
+ */
+static inline uint8_t _mav_trim_payload(const char *payload, uint8_t length)
+{
+	while (length > 1 && payload[length - 1] == 0) {
+		length--;
+	}
+	return length;
+}
+
+/**
+ * @brief Decide whether a payload goes out in a MAVLink 2 frame.
+ *
+ * A channel allowed to send MAVLink 2 does so only for payloads with enough trailing zeros to make up
+ * for its longer header, every other frame goes out as MAVLink 1. So no frame is ever longer than its
+ * MAVLink 1 equivalent.
+ * @param length The length of the payload, updated to its trimmed length if MAVLink 2 is used.
+ * @return True to send a MAVLink 2 frame.
+ */
+static inline uint8_t _mav_use_mavlink2(const mavlink_status_t *status, const char *payload, uint8_t *length)
+{
+	if (status->flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK2) {
+		const uint8_t trimmed = _mav_trim_payload(payload, *length);
+		if (trimmed + MAVLINK2_NUM_NON_PAYLOAD_BYTES < *length + MAVLINK_NUM_NON_PAYLOAD_BYTES) {
+			*length = trimmed;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Write the header of a frame as it goes out on the wire, either the MAVLink 1 or the MAVLink 2
+ * one depending on `magic`.
+ * @return The length of the header.
+ */
+static inline uint8_t _mav_put_header(uint8_t *buf, uint8_t magic, uint8_t len, uint8_t seq, uint8_t sysid,
+                                      uint8_t compid, uint8_t msgid)
+{
+	buf[0] = magic;
+	buf[1] = len;
+	if (magic == MAVLINK_STX_MAVLINK2) {
+		buf[2] = 0; // No incompatibility flags, as frames are never signed.
+		buf[3] = 0; // No compatibility flags.
+		buf[4] = seq;
+		buf[5] = sysid;
+		buf[6] = compid;
+		buf[7] = msgid;
+		buf[8] = 0; // Message IDs in this dialect all fit into the first byte.
+		buf[9] = 0;
+		return MAVLINK2_NUM_HEADER_BYTES;
+	}
+	buf[2] = seq;
+	buf[3] = sysid;
+	buf[4] = compid;
+	buf[5] = msgid;
+	return MAVLINK_NUM_HEADER_BYTES;
+}
+
 #if MAVLINK_NEED_BYTE_SWAP
 static inline void byte_swap_2(char *dst, const char *src)
 {
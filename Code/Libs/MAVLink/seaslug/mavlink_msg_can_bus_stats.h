@@ -0,0 +1,425 @@
+// MESSAGE CAN_BUS_STATS PACKING
+
+#define MAVLINK_MSG_ID_CAN_BUS_STATS 177
+
+typedef struct __mavlink_can_bus_stats_t
+{
+ uint32_t frames; ///< Frames since boot.
+ uint32_t untracked; ///< Frames since boot whose ID or PGN didn't fit the monitor and is missing from CAN_TRAFFIC.
+ uint32_t bit_rate; ///< Bits during the last second, including estimated stuff bits.
+ uint16_t load; ///< Bus load during the last second (% * 10), a lower bound as it only includes the frames the primary node sees.
+ uint16_t peak_load; ///< Highest bus load since boot (% * 10).
+ uint16_t frame_rate; ///< Frames during the last second.
+ uint8_t tx_errors; ///< The ECAN transmit error count.
+ uint8_t rx_errors; ///< The ECAN receive error count.
+ uint8_t ids; ///< The number of IDs and PGNs tracked.
+ uint8_t drifting; ///< The number of IDs and PGNs whose rate is off from nominal.
+} mavlink_can_bus_stats_t;
+
+#define MAVLINK_MSG_ID_CAN_BUS_STATS_LEN 22
+#define MAVLINK_MSG_ID_177_LEN 22
+
+#define MAVLINK_MSG_ID_CAN_BUS_STATS_CRC 196
+#define MAVLINK_MSG_ID_177_CRC 196
+
+
+
+#define MAVLINK_MESSAGE_INFO_CAN_BUS_STATS { \
+	"CAN_BUS_STATS", \
+	10, \
+	{  { "frames", NULL, MAVLINK_TYPE_UINT32_T, 0, 0, offsetof(mavlink_can_bus_stats_t, frames) }, \
+         { "untracked", NULL, MAVLINK_TYPE_UINT32_T, 0, 4, offsetof(mavlink_can_bus_stats_t, untracked) }, \
+         { "bit_rate", NULL, MAVLINK_TYPE_UINT32_T, 0, 8, offsetof(mavlink_can_bus_stats_t, bit_rate) }, \
+         { "load", NULL, MAVLINK_TYPE_UINT16_T, 0, 12, offsetof(mavlink_can_bus_stats_t, load) }, \
+         { "peak_load", NULL, MAVLINK_TYPE_UINT16_T, 0, 14, offsetof(mavlink_can_bus_stats_t, peak_load) }, \
+         { "frame_rate", NULL, MAVLINK_TYPE_UINT16_T, 0, 16, offsetof(mavlink_can_bus_stats_t, frame_rate) }, \
+         { "tx_errors", NULL, MAVLINK_TYPE_UINT8_T, 0, 18, offsetof(mavlink_can_bus_stats_t, tx_errors) }, \
+         { "rx_errors", NULL, MAVLINK_TYPE_UINT8_T, 0, 19, offsetof(mavlink_can_bus_stats_t, rx_errors) }, \
+         { "ids", NULL, MAVLINK_TYPE_UINT8_T, 0, 20, offsetof(mavlink_can_bus_stats_t, ids) }, \
+         { "drifting", NULL, MAVLINK_TYPE_UINT8_T, 0, 21, offsetof(mavlink_can_bus_stats_t, drifting) }, \
+         } \
+}
+
+
+/**
+ * @brief Pack a can_bus_stats message
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ *
+ * @param frames Frames since boot.
+ * @param untracked Frames since boot whose ID or PGN didn't fit the monitor and is missing from CAN_TRAFFIC.
+ * @param bit_rate Bits during the last second, including estimated stuff bits.
+ * @param load Bus load during the last second (% * 10), a lower bound as it only includes the frames the primary node sees.
+ * @param peak_load Highest bus load since boot (% * 10).
+ * @param frame_rate Frames during the last second.
+ * @param tx_errors The ECAN transmit error count.
+ * @param rx_errors The ECAN receive error count.
+ * @param ids The number of IDs and PGNs tracked.
+ * @param drifting The number of IDs and PGNs whose rate is off from nominal.
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_can_bus_stats_pack(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg,
+						       uint32_t frames, uint32_t untracked, uint32_t bit_rate, uint16_t load, uint16_t peak_load, uint16_t frame_rate, uint8_t tx_errors, uint8_t rx_errors, uint8_t ids, uint8_t drifting)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[MAVLINK_MSG_ID_CAN_BUS_STATS_LEN];
+	_mav_put_uint32_t(buf, 0, frames);
+	_mav_put_uint32_t(buf, 4, untracked);
+	_mav_put_uint32_t(buf, 8, bit_rate);
+	_mav_put_uint16_t(buf, 12, load);
+	_mav_put_uint16_t(buf, 14, peak_load);
+	_mav_put_uint16_t(buf, 16, frame_rate);
+	_mav_put_uint8_t(buf, 18, tx_errors);
+	_mav_put_uint8_t(buf, 19, rx_errors);
+	_mav_put_uint8_t(buf, 20, ids);
+	_mav_put_uint8_t(buf, 21, drifting);
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#else
+	mavlink_can_bus_stats_t packet;
+	packet.frames = frames;
+	packet.untracked = untracked;
+	packet.bit_rate = bit_rate;
+	packet.load = load;
+	packet.peak_load = peak_load;
+	packet.frame_rate = frame_rate;
+	packet.tx_errors = tx_errors;
+	packet.rx_errors = rx_errors;
+	packet.ids = ids;
+	packet.drifting = drifting;
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_CAN_BUS_STATS;
+#if MAVLINK_CRC_EXTRA
+    return mavlink_finalize_message(msg, system_id, component_id, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN, MAVLINK_MSG_ID_CAN_BUS_STATS_CRC);
+#else
+    return mavlink_finalize_message(msg, system_id, component_id, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#endif
+}
+
+/**
+ * @brief Pack a can_bus_stats message on a channel
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param chan The MAVLink channel this message will be sent over
+ * @param msg The MAVLink message to compress the data into
+ * @param frames Frames since boot.
+ * @param untracked Frames since boot whose ID or PGN didn't fit the monitor and is missing from CAN_TRAFFIC.
+ * @param bit_rate Bits during the last second, including estimated stuff bits.
+ * @param load Bus load during the last second (% * 10), a lower bound as it only includes the frames the primary node sees.
+ * @param peak_load Highest bus load since boot (% * 10).
+ * @param frame_rate Frames during the last second.
+ * @param tx_errors The ECAN transmit error count.
+ * @param rx_errors The ECAN receive error count.
+ * @param ids The number of IDs and PGNs tracked.
+ * @param drifting The number of IDs and PGNs whose rate is off from nominal.
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_can_bus_stats_pack_chan(uint8_t system_id, uint8_t component_id, uint8_t chan,
+							   mavlink_message_t* msg,
+						           uint32_t frames,uint32_t untracked,uint32_t bit_rate,uint16_t load,uint16_t peak_load,uint16_t frame_rate,uint8_t tx_errors,uint8_t rx_errors,uint8_t ids,uint8_t drifting)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[MAVLINK_MSG_ID_CAN_BUS_STATS_LEN];
+	_mav_put_uint32_t(buf, 0, frames);
+	_mav_put_uint32_t(buf, 4, untracked);
+	_mav_put_uint32_t(buf, 8, bit_rate);
+	_mav_put_uint16_t(buf, 12, load);
+	_mav_put_uint16_t(buf, 14, peak_load);
+	_mav_put_uint16_t(buf, 16, frame_rate);
+	_mav_put_uint8_t(buf, 18, tx_errors);
+	_mav_put_uint8_t(buf, 19, rx_errors);
+	_mav_put_uint8_t(buf, 20, ids);
+	_mav_put_uint8_t(buf, 21, drifting);
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#else
+	mavlink_can_bus_stats_t packet;
+	packet.frames = frames;
+	packet.untracked = untracked;
+	packet.bit_rate = bit_rate;
+	packet.load = load;
+	packet.peak_load = peak_load;
+	packet.frame_rate = frame_rate;
+	packet.tx_errors = tx_errors;
+	packet.rx_errors = rx_errors;
+	packet.ids = ids;
+	packet.drifting = drifting;
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_CAN_BUS_STATS;
+#if MAVLINK_CRC_EXTRA
+    return mavlink_finalize_message_chan(msg, system_id, component_id, chan, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN, MAVLINK_MSG_ID_CAN_BUS_STATS_CRC);
+#else
+    return mavlink_finalize_message_chan(msg, system_id, component_id, chan, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#endif
+}
+
+/**
+ * @brief Encode a can_bus_stats struct
+ *
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ * @param can_bus_stats C-struct to read the message contents from
+ */
+static inline uint16_t mavlink_msg_can_bus_stats_encode(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg, const mavlink_can_bus_stats_t* can_bus_stats)
+{
+	return mavlink_msg_can_bus_stats_pack(system_id, component_id, msg, can_bus_stats->frames, can_bus_stats->untracked, can_bus_stats->bit_rate, can_bus_stats->load, can_bus_stats->peak_load, can_bus_stats->frame_rate, can_bus_stats->tx_errors, can_bus_stats->rx_errors, can_bus_stats->ids, can_bus_stats->drifting);
+}
+
+/**
+ * @brief Encode a can_bus_stats struct on a channel
+ *
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param chan The MAVLink channel this message will be sent over
+ * @param msg The MAVLink message to compress the data into
+ * @param can_bus_stats C-struct to read the message contents from
+ */
+static inline uint16_t mavlink_msg_can_bus_stats_encode_chan(uint8_t system_id, uint8_t component_id, uint8_t chan, mavlink_message_t* msg, const mavlink_can_bus_stats_t* can_bus_stats)
+{
+	return mavlink_msg_can_bus_stats_pack_chan(system_id, component_id, chan, msg, can_bus_stats->frames, can_bus_stats->untracked, can_bus_stats->bit_rate, can_bus_stats->load, can_bus_stats->peak_load, can_bus_stats->frame_rate, can_bus_stats->tx_errors, can_bus_stats->rx_errors, can_bus_stats->ids, can_bus_stats->drifting);
+}
+
+/**
+ * @brief Send a can_bus_stats message
+ * @param chan MAVLink channel to send the message
+ *
+ * @param frames Frames since boot.
+ * @param untracked Frames since boot whose ID or PGN didn't fit the monitor and is missing from CAN_TRAFFIC.
+ * @param bit_rate Bits during the last second, including estimated stuff bits.
+ * @param load Bus load during the last second (% * 10), a lower bound as it only includes the frames the primary node sees.
+ * @param peak_load Highest bus load since boot (% * 10).
+ * @param frame_rate Frames during the last second.
+ * @param tx_errors The ECAN transmit error count.
+ * @param rx_errors The ECAN receive error count.
+ * @param ids The number of IDs and PGNs tracked.
+ * @param drifting The number of IDs and PGNs whose rate is off from nominal.
+ */
+#ifdef MAVLINK_USE_CONVENIENCE_FUNCTIONS
+
+static inline void mavlink_msg_can_bus_stats_send(mavlink_channel_t chan, uint32_t frames, uint32_t untracked, uint32_t bit_rate, uint16_t load, uint16_t peak_load, uint16_t frame_rate, uint8_t tx_errors, uint8_t rx_errors, uint8_t ids, uint8_t drifting)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[MAVLINK_MSG_ID_CAN_BUS_STATS_LEN];
+	_mav_put_uint32_t(buf, 0, frames);
+	_mav_put_uint32_t(buf, 4, untracked);
+	_mav_put_uint32_t(buf, 8, bit_rate);
+	_mav_put_uint16_t(buf, 12, load);
+	_mav_put_uint16_t(buf, 14, peak_load);
+	_mav_put_uint16_t(buf, 16, frame_rate);
+	_mav_put_uint8_t(buf, 18, tx_errors);
+	_mav_put_uint8_t(buf, 19, rx_errors);
+	_mav_put_uint8_t(buf, 20, ids);
+	_mav_put_uint8_t(buf, 21, drifting);
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_BUS_STATS, buf, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN, MAVLINK_MSG_ID_CAN_BUS_STATS_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_BUS_STATS, buf, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#endif
+#else
+	mavlink_can_bus_stats_t packet;
+	packet.frames = frames;
+	packet.untracked = untracked;
+	packet.bit_rate = bit_rate;
+	packet.load = load;
+	packet.peak_load = peak_load;
+	packet.frame_rate = frame_rate;
+	packet.tx_errors = tx_errors;
+	packet.rx_errors = rx_errors;
+	packet.ids = ids;
+	packet.drifting = drifting;
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_BUS_STATS, (const char *)&packet, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN, MAVLINK_MSG_ID_CAN_BUS_STATS_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_BUS_STATS, (const char *)&packet, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#endif
+#endif
+}
+
+#if MAVLINK_MSG_ID_CAN_BUS_STATS_LEN <= MAVLINK_MAX_PAYLOAD_LEN
+/*
+  This varient of _send() can be used to save stack space by re-using
+  memory from the receive buffer.  The caller provides a
+  mavlink_message_t which is the size of a full mavlink message. This
+  is usually the receive buffer for the channel, and allows a reply to an
+  incoming message with minimum stack space usage.
+ */
+static inline void mavlink_msg_can_bus_stats_send_buf(mavlink_message_t *msgbuf, mavlink_channel_t chan,  uint32_t frames, uint32_t untracked, uint32_t bit_rate, uint16_t load, uint16_t peak_load, uint16_t frame_rate, uint8_t tx_errors, uint8_t rx_errors, uint8_t ids, uint8_t drifting)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char *buf = (char *)msgbuf;
+	_mav_put_uint32_t(buf, 0, frames);
+	_mav_put_uint32_t(buf, 4, untracked);
+	_mav_put_uint32_t(buf, 8, bit_rate);
+	_mav_put_uint16_t(buf, 12, load);
+	_mav_put_uint16_t(buf, 14, peak_load);
+	_mav_put_uint16_t(buf, 16, frame_rate);
+	_mav_put_uint8_t(buf, 18, tx_errors);
+	_mav_put_uint8_t(buf, 19, rx_errors);
+	_mav_put_uint8_t(buf, 20, ids);
+	_mav_put_uint8_t(buf, 21, drifting);
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_BUS_STATS, buf, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN, MAVLINK_MSG_ID_CAN_BUS_STATS_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_BUS_STATS, buf, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#endif
+#else
+	mavlink_can_bus_stats_t *packet = (mavlink_can_bus_stats_t *)msgbuf;
+	packet->frames = frames;
+	packet->untracked = untracked;
+	packet->bit_rate = bit_rate;
+	packet->load = load;
+	packet->peak_load = peak_load;
+	packet->frame_rate = frame_rate;
+	packet->tx_errors = tx_errors;
+	packet->rx_errors = rx_errors;
+	packet->ids = ids;
+	packet->drifting = drifting;
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_BUS_STATS, (const char *)packet, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN, MAVLINK_MSG_ID_CAN_BUS_STATS_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_BUS_STATS, (const char *)packet, MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#endif
+#endif
+}
+#endif
+
+#endif
+
+// MESSAGE CAN_BUS_STATS UNPACKING
+
+
+/**
+ * @brief Get field frames from can_bus_stats message
+ *
+ * @return Frames since boot.
+ */
+static inline uint32_t mavlink_msg_can_bus_stats_get_frames(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  0);
+}
+
+/**
+ * @brief Get field untracked from can_bus_stats message
+ *
+ * @return Frames since boot whose ID or PGN didn't fit the monitor and is missing from CAN_TRAFFIC.
+ */
+static inline uint32_t mavlink_msg_can_bus_stats_get_untracked(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  4);
+}
+
+/**
+ * @brief Get field bit_rate from can_bus_stats message
+ *
+ * @return Bits during the last second, including estimated stuff bits.
+ */
+static inline uint32_t mavlink_msg_can_bus_stats_get_bit_rate(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  8);
+}
+
+/**
+ * @brief Get field load from can_bus_stats message
+ *
+ * @return Bus load during the last second (% * 10), a lower bound as it only includes the frames the primary node sees.
+ */
+static inline uint16_t mavlink_msg_can_bus_stats_get_load(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  12);
+}
+
+/**
+ * @brief Get field peak_load from can_bus_stats message
+ *
+ * @return Highest bus load since boot (% * 10).
+ */
+static inline uint16_t mavlink_msg_can_bus_stats_get_peak_load(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  14);
+}
+
+/**
+ * @brief Get field frame_rate from can_bus_stats message
+ *
+ * @return Frames during the last second.
+ */
+static inline uint16_t mavlink_msg_can_bus_stats_get_frame_rate(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  16);
+}
+
+/**
+ * @brief Get field tx_errors from can_bus_stats message
+ *
+ * @return The ECAN transmit error count.
+ */
+static inline uint8_t mavlink_msg_can_bus_stats_get_tx_errors(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint8_t(msg,  18);
+}
+
+/**
+ * @brief Get field rx_errors from can_bus_stats message
+ *
+ * @return The ECAN receive error count.
+ */
+static inline uint8_t mavlink_msg_can_bus_stats_get_rx_errors(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint8_t(msg,  19);
+}
+
+/**
+ * @brief Get field ids from can_bus_stats message
+ *
+ * @return The number of IDs and PGNs tracked.
+ */
+static inline uint8_t mavlink_msg_can_bus_stats_get_ids(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint8_t(msg,  20);
+}
+
+/**
+ * @brief Get field drifting from can_bus_stats message
+ *
+ * @return The number of IDs and PGNs whose rate is off from nominal.
+ */
+static inline uint8_t mavlink_msg_can_bus_stats_get_drifting(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint8_t(msg,  21);
+}
+
+/**
+ * @brief Decode a can_bus_stats message into a struct
+ *
+ * @param msg The message to decode
+ * @param can_bus_stats C-struct to decode the message contents into
+ */
+static inline void mavlink_msg_can_bus_stats_decode(const mavlink_message_t* msg, mavlink_can_bus_stats_t* can_bus_stats)
+{
+#if MAVLINK_NEED_BYTE_SWAP
+	can_bus_stats->frames = mavlink_msg_can_bus_stats_get_frames(msg);
+	can_bus_stats->untracked = mavlink_msg_can_bus_stats_get_untracked(msg);
+	can_bus_stats->bit_rate = mavlink_msg_can_bus_stats_get_bit_rate(msg);
+	can_bus_stats->load = mavlink_msg_can_bus_stats_get_load(msg);
+	can_bus_stats->peak_load = mavlink_msg_can_bus_stats_get_peak_load(msg);
+	can_bus_stats->frame_rate = mavlink_msg_can_bus_stats_get_frame_rate(msg);
+	can_bus_stats->tx_errors = mavlink_msg_can_bus_stats_get_tx_errors(msg);
+	can_bus_stats->rx_errors = mavlink_msg_can_bus_stats_get_rx_errors(msg);
+	can_bus_stats->ids = mavlink_msg_can_bus_stats_get_ids(msg);
+	can_bus_stats->drifting = mavlink_msg_can_bus_stats_get_drifting(msg);
+#else
+	memcpy(can_bus_stats, _MAV_PAYLOAD(msg), MAVLINK_MSG_ID_CAN_BUS_STATS_LEN);
+#endif
+}
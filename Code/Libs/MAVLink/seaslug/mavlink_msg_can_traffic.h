@@ -0,0 +1,377 @@
+// MESSAGE CAN_TRAFFIC PACKING
+
+#define MAVLINK_MSG_ID_CAN_TRAFFIC 178
+
+typedef struct __mavlink_can_traffic_t
+{
+ uint32_t id; ///< The standard ID, PGN, or source address.
+ uint32_t frames; ///< Frames since boot.
+ uint32_t bit_rate; ///< Bits during the last second, including estimated stuff bits.
+ uint16_t rate; ///< Frames during the last second.
+ uint16_t average_rate; ///< The running average of the frame rate (Hz * 10). Not kept for source addresses.
+ uint16_t nominal_rate; ///< The expected frame rate (Hz * 10), or 0 if it isn't known (yet). Not kept for source addresses.
+ uint8_t type; ///< What id is: 0 for a standard ID, 1 for a PGN, and 2 for a source address.
+ uint8_t drifting; ///< 1 if the average rate is too far off from nominal.
+} mavlink_can_traffic_t;
+
+#define MAVLINK_MSG_ID_CAN_TRAFFIC_LEN 20
+#define MAVLINK_MSG_ID_178_LEN 20
+
+#define MAVLINK_MSG_ID_CAN_TRAFFIC_CRC 231
+#define MAVLINK_MSG_ID_178_CRC 231
+
+
+
+#define MAVLINK_MESSAGE_INFO_CAN_TRAFFIC { \
+	"CAN_TRAFFIC", \
+	8, \
+	{  { "id", NULL, MAVLINK_TYPE_UINT32_T, 0, 0, offsetof(mavlink_can_traffic_t, id) }, \
+         { "frames", NULL, MAVLINK_TYPE_UINT32_T, 0, 4, offsetof(mavlink_can_traffic_t, frames) }, \
+         { "bit_rate", NULL, MAVLINK_TYPE_UINT32_T, 0, 8, offsetof(mavlink_can_traffic_t, bit_rate) }, \
+         { "rate", NULL, MAVLINK_TYPE_UINT16_T, 0, 12, offsetof(mavlink_can_traffic_t, rate) }, \
+         { "average_rate", NULL, MAVLINK_TYPE_UINT16_T, 0, 14, offsetof(mavlink_can_traffic_t, average_rate) }, \
+         { "nominal_rate", NULL, MAVLINK_TYPE_UINT16_T, 0, 16, offsetof(mavlink_can_traffic_t, nominal_rate) }, \
+         { "type", NULL, MAVLINK_TYPE_UINT8_T, 0, 18, offsetof(mavlink_can_traffic_t, type) }, \
+         { "drifting", NULL, MAVLINK_TYPE_UINT8_T, 0, 19, offsetof(mavlink_can_traffic_t, drifting) }, \
+         } \
+}
+
+
+/**
+ * @brief Pack a can_traffic message
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ *
+ * @param id The standard ID, PGN, or source address.
+ * @param frames Frames since boot.
+ * @param bit_rate Bits during the last second, including estimated stuff bits.
+ * @param rate Frames during the last second.
+ * @param average_rate The running average of the frame rate (Hz * 10). Not kept for source addresses.
+ * @param nominal_rate The expected frame rate (Hz * 10), or 0 if it isn't known (yet). Not kept for source addresses.
+ * @param type What id is: 0 for a standard ID, 1 for a PGN, and 2 for a source address.
+ * @param drifting 1 if the average rate is too far off from nominal.
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_can_traffic_pack(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg,
+						       uint32_t id, uint32_t frames, uint32_t bit_rate, uint16_t rate, uint16_t average_rate, uint16_t nominal_rate, uint8_t type, uint8_t drifting)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[MAVLINK_MSG_ID_CAN_TRAFFIC_LEN];
+	_mav_put_uint32_t(buf, 0, id);
+	_mav_put_uint32_t(buf, 4, frames);
+	_mav_put_uint32_t(buf, 8, bit_rate);
+	_mav_put_uint16_t(buf, 12, rate);
+	_mav_put_uint16_t(buf, 14, average_rate);
+	_mav_put_uint16_t(buf, 16, nominal_rate);
+	_mav_put_uint8_t(buf, 18, type);
+	_mav_put_uint8_t(buf, 19, drifting);
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#else
+	mavlink_can_traffic_t packet;
+	packet.id = id;
+	packet.frames = frames;
+	packet.bit_rate = bit_rate;
+	packet.rate = rate;
+	packet.average_rate = average_rate;
+	packet.nominal_rate = nominal_rate;
+	packet.type = type;
+	packet.drifting = drifting;
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_CAN_TRAFFIC;
+#if MAVLINK_CRC_EXTRA
+    return mavlink_finalize_message(msg, system_id, component_id, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN, MAVLINK_MSG_ID_CAN_TRAFFIC_CRC);
+#else
+    return mavlink_finalize_message(msg, system_id, component_id, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#endif
+}
+
+/**
+ * @brief Pack a can_traffic message on a channel
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param chan The MAVLink channel this message will be sent over
+ * @param msg The MAVLink message to compress the data into
+ * @param id The standard ID, PGN, or source address.
+ * @param frames Frames since boot.
+ * @param bit_rate Bits during the last second, including estimated stuff bits.
+ * @param rate Frames during the last second.
+ * @param average_rate The running average of the frame rate (Hz * 10). Not kept for source addresses.
+ * @param nominal_rate The expected frame rate (Hz * 10), or 0 if it isn't known (yet). Not kept for source addresses.
+ * @param type What id is: 0 for a standard ID, 1 for a PGN, and 2 for a source address.
+ * @param drifting 1 if the average rate is too far off from nominal.
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_can_traffic_pack_chan(uint8_t system_id, uint8_t component_id, uint8_t chan,
+							   mavlink_message_t* msg,
+						           uint32_t id,uint32_t frames,uint32_t bit_rate,uint16_t rate,uint16_t average_rate,uint16_t nominal_rate,uint8_t type,uint8_t drifting)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[MAVLINK_MSG_ID_CAN_TRAFFIC_LEN];
+	_mav_put_uint32_t(buf, 0, id);
+	_mav_put_uint32_t(buf, 4, frames);
+	_mav_put_uint32_t(buf, 8, bit_rate);
+	_mav_put_uint16_t(buf, 12, rate);
+	_mav_put_uint16_t(buf, 14, average_rate);
+	_mav_put_uint16_t(buf, 16, nominal_rate);
+	_mav_put_uint8_t(buf, 18, type);
+	_mav_put_uint8_t(buf, 19, drifting);
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#else
+	mavlink_can_traffic_t packet;
+	packet.id = id;
+	packet.frames = frames;
+	packet.bit_rate = bit_rate;
+	packet.rate = rate;
+	packet.average_rate = average_rate;
+	packet.nominal_rate = nominal_rate;
+	packet.type = type;
+	packet.drifting = drifting;
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_CAN_TRAFFIC;
+#if MAVLINK_CRC_EXTRA
+    return mavlink_finalize_message_chan(msg, system_id, component_id, chan, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN, MAVLINK_MSG_ID_CAN_TRAFFIC_CRC);
+#else
+    return mavlink_finalize_message_chan(msg, system_id, component_id, chan, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#endif
+}
+
+/**
+ * @brief Encode a can_traffic struct
+ *
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ * @param can_traffic C-struct to read the message contents from
+ */
+static inline uint16_t mavlink_msg_can_traffic_encode(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg, const mavlink_can_traffic_t* can_traffic)
+{
+	return mavlink_msg_can_traffic_pack(system_id, component_id, msg, can_traffic->id, can_traffic->frames, can_traffic->bit_rate, can_traffic->rate, can_traffic->average_rate, can_traffic->nominal_rate, can_traffic->type, can_traffic->drifting);
+}
+
+/**
+ * @brief Encode a can_traffic struct on a channel
+ *
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param chan The MAVLink channel this message will be sent over
+ * @param msg The MAVLink message to compress the data into
+ * @param can_traffic C-struct to read the message contents from
+ */
+static inline uint16_t mavlink_msg_can_traffic_encode_chan(uint8_t system_id, uint8_t component_id, uint8_t chan, mavlink_message_t* msg, const mavlink_can_traffic_t* can_traffic)
+{
+	return mavlink_msg_can_traffic_pack_chan(system_id, component_id, chan, msg, can_traffic->id, can_traffic->frames, can_traffic->bit_rate, can_traffic->rate, can_traffic->average_rate, can_traffic->nominal_rate, can_traffic->type, can_traffic->drifting);
+}
+
+/**
+ * @brief Send a can_traffic message
+ * @param chan MAVLink channel to send the message
+ *
+ * @param id The standard ID, PGN, or source address.
+ * @param frames Frames since boot.
+ * @param bit_rate Bits during the last second, including estimated stuff bits.
+ * @param rate Frames during the last second.
+ * @param average_rate The running average of the frame rate (Hz * 10). Not kept for source addresses.
+ * @param nominal_rate The expected frame rate (Hz * 10), or 0 if it isn't known (yet). Not kept for source addresses.
+ * @param type What id is: 0 for a standard ID, 1 for a PGN, and 2 for a source address.
+ * @param drifting 1 if the average rate is too far off from nominal.
+ */
+#ifdef MAVLINK_USE_CONVENIENCE_FUNCTIONS
+
+static inline void mavlink_msg_can_traffic_send(mavlink_channel_t chan, uint32_t id, uint32_t frames, uint32_t bit_rate, uint16_t rate, uint16_t average_rate, uint16_t nominal_rate, uint8_t type, uint8_t drifting)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[MAVLINK_MSG_ID_CAN_TRAFFIC_LEN];
+	_mav_put_uint32_t(buf, 0, id);
+	_mav_put_uint32_t(buf, 4, frames);
+	_mav_put_uint32_t(buf, 8, bit_rate);
+	_mav_put_uint16_t(buf, 12, rate);
+	_mav_put_uint16_t(buf, 14, average_rate);
+	_mav_put_uint16_t(buf, 16, nominal_rate);
+	_mav_put_uint8_t(buf, 18, type);
+	_mav_put_uint8_t(buf, 19, drifting);
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_TRAFFIC, buf, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN, MAVLINK_MSG_ID_CAN_TRAFFIC_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_TRAFFIC, buf, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#endif
+#else
+	mavlink_can_traffic_t packet;
+	packet.id = id;
+	packet.frames = frames;
+	packet.bit_rate = bit_rate;
+	packet.rate = rate;
+	packet.average_rate = average_rate;
+	packet.nominal_rate = nominal_rate;
+	packet.type = type;
+	packet.drifting = drifting;
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_TRAFFIC, (const char *)&packet, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN, MAVLINK_MSG_ID_CAN_TRAFFIC_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_TRAFFIC, (const char *)&packet, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#endif
+#endif
+}
+
+#if MAVLINK_MSG_ID_CAN_TRAFFIC_LEN <= MAVLINK_MAX_PAYLOAD_LEN
+/*
+  This varient of _send() can be used to save stack space by re-using
+  memory from the receive buffer.  The caller provides a
+  mavlink_message_t which is the size of a full mavlink message. This
+  is usually the receive buffer for the channel, and allows a reply to an
+  incoming message with minimum stack space usage.
+ */
+static inline void mavlink_msg_can_traffic_send_buf(mavlink_message_t *msgbuf, mavlink_channel_t chan,  uint32_t id, uint32_t frames, uint32_t bit_rate, uint16_t rate, uint16_t average_rate, uint16_t nominal_rate, uint8_t type, uint8_t drifting)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char *buf = (char *)msgbuf;
+	_mav_put_uint32_t(buf, 0, id);
+	_mav_put_uint32_t(buf, 4, frames);
+	_mav_put_uint32_t(buf, 8, bit_rate);
+	_mav_put_uint16_t(buf, 12, rate);
+	_mav_put_uint16_t(buf, 14, average_rate);
+	_mav_put_uint16_t(buf, 16, nominal_rate);
+	_mav_put_uint8_t(buf, 18, type);
+	_mav_put_uint8_t(buf, 19, drifting);
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_TRAFFIC, buf, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN, MAVLINK_MSG_ID_CAN_TRAFFIC_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_TRAFFIC, buf, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#endif
+#else
+	mavlink_can_traffic_t *packet = (mavlink_can_traffic_t *)msgbuf;
+	packet->id = id;
+	packet->frames = frames;
+	packet->bit_rate = bit_rate;
+	packet->rate = rate;
+	packet->average_rate = average_rate;
+	packet->nominal_rate = nominal_rate;
+	packet->type = type;
+	packet->drifting = drifting;
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_TRAFFIC, (const char *)packet, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN, MAVLINK_MSG_ID_CAN_TRAFFIC_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_CAN_TRAFFIC, (const char *)packet, MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#endif
+#endif
+}
+#endif
+
+#endif
+
+// MESSAGE CAN_TRAFFIC UNPACKING
+
+
+/**
+ * @brief Get field id from can_traffic message
+ *
+ * @return The standard ID, PGN, or source address.
+ */
+static inline uint32_t mavlink_msg_can_traffic_get_id(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  0);
+}
+
+/**
+ * @brief Get field frames from can_traffic message
+ *
+ * @return Frames since boot.
+ */
+static inline uint32_t mavlink_msg_can_traffic_get_frames(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  4);
+}
+
+/**
+ * @brief Get field bit_rate from can_traffic message
+ *
+ * @return Bits during the last second, including estimated stuff bits.
+ */
+static inline uint32_t mavlink_msg_can_traffic_get_bit_rate(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  8);
+}
+
+/**
+ * @brief Get field rate from can_traffic message
+ *
+ * @return Frames during the last second.
+ */
+static inline uint16_t mavlink_msg_can_traffic_get_rate(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  12);
+}
+
+/**
+ * @brief Get field average_rate from can_traffic message
+ *
+ * @return The running average of the frame rate (Hz * 10). Not kept for source addresses.
+ */
+static inline uint16_t mavlink_msg_can_traffic_get_average_rate(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  14);
+}
+
+/**
+ * @brief Get field nominal_rate from can_traffic message
+ *
+ * @return The expected frame rate (Hz * 10), or 0 if it isn't known (yet). Not kept for source addresses.
+ */
+static inline uint16_t mavlink_msg_can_traffic_get_nominal_rate(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  16);
+}
+
+/**
+ * @brief Get field type from can_traffic message
+ *
+ * @return What id is: 0 for a standard ID, 1 for a PGN, and 2 for a source address.
+ */
+static inline uint8_t mavlink_msg_can_traffic_get_type(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint8_t(msg,  18);
+}
+
+/**
+ * @brief Get field drifting from can_traffic message
+ *
+ * @return 1 if the average rate is too far off from nominal.
+ */
+static inline uint8_t mavlink_msg_can_traffic_get_drifting(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint8_t(msg,  19);
+}
+
+/**
+ * @brief Decode a can_traffic message into a struct
+ *
+ * @param msg The message to decode
+ * @param can_traffic C-struct to decode the message contents into
+ */
+static inline void mavlink_msg_can_traffic_decode(const mavlink_message_t* msg, mavlink_can_traffic_t* can_traffic)
+{
+#if MAVLINK_NEED_BYTE_SWAP
+	can_traffic->id = mavlink_msg_can_traffic_get_id(msg);
+	can_traffic->frames = mavlink_msg_can_traffic_get_frames(msg);
+	can_traffic->bit_rate = mavlink_msg_can_traffic_get_bit_rate(msg);
+	can_traffic->rate = mavlink_msg_can_traffic_get_rate(msg);
+	can_traffic->average_rate = mavlink_msg_can_traffic_get_average_rate(msg);
+	can_traffic->nominal_rate = mavlink_msg_can_traffic_get_nominal_rate(msg);
+	can_traffic->type = mavlink_msg_can_traffic_get_type(msg);
+	can_traffic->drifting = mavlink_msg_can_traffic_get_drifting(msg);
+#else
+	memcpy(can_traffic, _MAV_PAYLOAD(msg), MAVLINK_MSG_ID_CAN_TRAFFIC_LEN);
+#endif
+}
@@ -0,0 +1,497 @@
+// MESSAGE LINK_STATS PACKING
+
+#define MAVLINK_MSG_ID_LINK_STATS 176
+
+typedef struct __mavlink_link_stats_t
+{
+ uint32_t rx_bytes; ///< Bytes received.
+ uint32_t rx_messages; ///< Messages received with a valid length and checksum.
+ uint32_t rx_discarded; ///< Received bytes that were discarded as they weren't part of a valid message.
+ uint32_t rx_lost; ///< Messages lost according to gaps in the sequence numbers of the groundstation.
+ uint32_t tx_bytes; ///< Bytes queued for transmission.
+ uint32_t tx_messages; ///< Messages queued for transmission.
+ uint32_t tx_dropped; ///< Bytes not transmitted because the transmit buffer was full.
+ uint16_t rx_rate; ///< Bytes received during the last second.
+ uint16_t tx_rate; ///< Bytes queued for transmission during the last second.
+ uint16_t tx_scheduled_rate; ///< Bytes per second of telemetry scheduled on this link.
+ uint16_t rx_high_water; ///< The most bytes ever waiting in the receive buffer.
+ uint16_t tx_high_water; ///< The most bytes ever waiting in the transmit buffer.
+ uint8_t channel; ///< The link these statistics are for. 0 is the groundstation and 1 the datalogger.
+} mavlink_link_stats_t;
+
+#define MAVLINK_MSG_ID_LINK_STATS_LEN 39
+#define MAVLINK_MSG_ID_176_LEN 39
+
+#define MAVLINK_MSG_ID_LINK_STATS_CRC 119
+#define MAVLINK_MSG_ID_176_CRC 119
+
+
+
+#define MAVLINK_MESSAGE_INFO_LINK_STATS { \
+	"LINK_STATS", \
+	13, \
+	{  { "rx_bytes", NULL, MAVLINK_TYPE_UINT32_T, 0, 0, offsetof(mavlink_link_stats_t, rx_bytes) }, \
+         { "rx_messages", NULL, MAVLINK_TYPE_UINT32_T, 0, 4, offsetof(mavlink_link_stats_t, rx_messages) }, \
+         { "rx_discarded", NULL, MAVLINK_TYPE_UINT32_T, 0, 8, offsetof(mavlink_link_stats_t, rx_discarded) }, \
+         { "rx_lost", NULL, MAVLINK_TYPE_UINT32_T, 0, 12, offsetof(mavlink_link_stats_t, rx_lost) }, \
+         { "tx_bytes", NULL, MAVLINK_TYPE_UINT32_T, 0, 16, offsetof(mavlink_link_stats_t, tx_bytes) }, \
+         { "tx_messages", NULL, MAVLINK_TYPE_UINT32_T, 0, 20, offsetof(mavlink_link_stats_t, tx_messages) }, \
+         { "tx_dropped", NULL, MAVLINK_TYPE_UINT32_T, 0, 24, offsetof(mavlink_link_stats_t, tx_dropped) }, \
+         { "rx_rate", NULL, MAVLINK_TYPE_UINT16_T, 0, 28, offsetof(mavlink_link_stats_t, rx_rate) }, \
+         { "tx_rate", NULL, MAVLINK_TYPE_UINT16_T, 0, 30, offsetof(mavlink_link_stats_t, tx_rate) }, \
+         { "tx_scheduled_rate", NULL, MAVLINK_TYPE_UINT16_T, 0, 32, offsetof(mavlink_link_stats_t, tx_scheduled_rate) }, \
+         { "rx_high_water", NULL, MAVLINK_TYPE_UINT16_T, 0, 34, offsetof(mavlink_link_stats_t, rx_high_water) }, \
+         { "tx_high_water", NULL, MAVLINK_TYPE_UINT16_T, 0, 36, offsetof(mavlink_link_stats_t, tx_high_water) }, \
+         { "channel", NULL, MAVLINK_TYPE_UINT8_T, 0, 38, offsetof(mavlink_link_stats_t, channel) }, \
+         } \
+}
+
+
+/**
+ * @brief Pack a link_stats message
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ *
+ * @param channel The link these statistics are for. 0 is the groundstation and 1 the datalogger.
+ * @param rx_bytes Bytes received.
+ * @param rx_messages Messages received with a valid length and checksum.
+ * @param rx_discarded Received bytes that were discarded as they weren't part of a valid message.
+ * @param rx_lost Messages lost according to gaps in the sequence numbers of the groundstation.
+ * @param tx_bytes Bytes queued for transmission.
+ * @param tx_messages Messages queued for transmission.
+ * @param tx_dropped Bytes not transmitted because the transmit buffer was full.
+ * @param rx_rate Bytes received during the last second.
+ * @param tx_rate Bytes queued for transmission during the last second.
+ * @param tx_scheduled_rate Bytes per second of telemetry scheduled on this link.
+ * @param rx_high_water The most bytes ever waiting in the receive buffer.
+ * @param tx_high_water The most bytes ever waiting in the transmit buffer.
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_link_stats_pack(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg,
+						       uint8_t channel, uint32_t rx_bytes, uint32_t rx_messages, uint32_t rx_discarded, uint32_t rx_lost, uint32_t tx_bytes, uint32_t tx_messages, uint32_t tx_dropped, uint16_t rx_rate, uint16_t tx_rate, uint16_t tx_scheduled_rate, uint16_t rx_high_water, uint16_t tx_high_water)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[MAVLINK_MSG_ID_LINK_STATS_LEN];
+	_mav_put_uint32_t(buf, 0, rx_bytes);
+	_mav_put_uint32_t(buf, 4, rx_messages);
+	_mav_put_uint32_t(buf, 8, rx_discarded);
+	_mav_put_uint32_t(buf, 12, rx_lost);
+	_mav_put_uint32_t(buf, 16, tx_bytes);
+	_mav_put_uint32_t(buf, 20, tx_messages);
+	_mav_put_uint32_t(buf, 24, tx_dropped);
+	_mav_put_uint16_t(buf, 28, rx_rate);
+	_mav_put_uint16_t(buf, 30, tx_rate);
+	_mav_put_uint16_t(buf, 32, tx_scheduled_rate);
+	_mav_put_uint16_t(buf, 34, rx_high_water);
+	_mav_put_uint16_t(buf, 36, tx_high_water);
+	_mav_put_uint8_t(buf, 38, channel);
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#else
+	mavlink_link_stats_t packet;
+	packet.rx_bytes = rx_bytes;
+	packet.rx_messages = rx_messages;
+	packet.rx_discarded = rx_discarded;
+	packet.rx_lost = rx_lost;
+	packet.tx_bytes = tx_bytes;
+	packet.tx_messages = tx_messages;
+	packet.tx_dropped = tx_dropped;
+	packet.rx_rate = rx_rate;
+	packet.tx_rate = tx_rate;
+	packet.tx_scheduled_rate = tx_scheduled_rate;
+	packet.rx_high_water = rx_high_water;
+	packet.tx_high_water = tx_high_water;
+	packet.channel = channel;
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_LINK_STATS;
+#if MAVLINK_CRC_EXTRA
+    return mavlink_finalize_message(msg, system_id, component_id, MAVLINK_MSG_ID_LINK_STATS_LEN, MAVLINK_MSG_ID_LINK_STATS_CRC);
+#else
+    return mavlink_finalize_message(msg, system_id, component_id, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#endif
+}
+
+/**
+ * @brief Pack a link_stats message on a channel
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param chan The MAVLink channel this message will be sent over
+ * @param msg The MAVLink message to compress the data into
+ * @param channel The link these statistics are for. 0 is the groundstation and 1 the datalogger.
+ * @param rx_bytes Bytes received.
+ * @param rx_messages Messages received with a valid length and checksum.
+ * @param rx_discarded Received bytes that were discarded as they weren't part of a valid message.
+ * @param rx_lost Messages lost according to gaps in the sequence numbers of the groundstation.
+ * @param tx_bytes Bytes queued for transmission.
+ * @param tx_messages Messages queued for transmission.
+ * @param tx_dropped Bytes not transmitted because the transmit buffer was full.
+ * @param rx_rate Bytes received during the last second.
+ * @param tx_rate Bytes queued for transmission during the last second.
+ * @param tx_scheduled_rate Bytes per second of telemetry scheduled on this link.
+ * @param rx_high_water The most bytes ever waiting in the receive buffer.
+ * @param tx_high_water The most bytes ever waiting in the transmit buffer.
+ * @return length of the message in bytes (excluding serial stream start sign)
+ */
+static inline uint16_t mavlink_msg_link_stats_pack_chan(uint8_t system_id, uint8_t component_id, uint8_t chan,
+							   mavlink_message_t* msg,
+						           uint8_t channel,uint32_t rx_bytes,uint32_t rx_messages,uint32_t rx_discarded,uint32_t rx_lost,uint32_t tx_bytes,uint32_t tx_messages,uint32_t tx_dropped,uint16_t rx_rate,uint16_t tx_rate,uint16_t tx_scheduled_rate,uint16_t rx_high_water,uint16_t tx_high_water)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[MAVLINK_MSG_ID_LINK_STATS_LEN];
+	_mav_put_uint32_t(buf, 0, rx_bytes);
+	_mav_put_uint32_t(buf, 4, rx_messages);
+	_mav_put_uint32_t(buf, 8, rx_discarded);
+	_mav_put_uint32_t(buf, 12, rx_lost);
+	_mav_put_uint32_t(buf, 16, tx_bytes);
+	_mav_put_uint32_t(buf, 20, tx_messages);
+	_mav_put_uint32_t(buf, 24, tx_dropped);
+	_mav_put_uint16_t(buf, 28, rx_rate);
+	_mav_put_uint16_t(buf, 30, tx_rate);
+	_mav_put_uint16_t(buf, 32, tx_scheduled_rate);
+	_mav_put_uint16_t(buf, 34, rx_high_water);
+	_mav_put_uint16_t(buf, 36, tx_high_water);
+	_mav_put_uint8_t(buf, 38, channel);
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), buf, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#else
+	mavlink_link_stats_t packet;
+	packet.rx_bytes = rx_bytes;
+	packet.rx_messages = rx_messages;
+	packet.rx_discarded = rx_discarded;
+	packet.rx_lost = rx_lost;
+	packet.tx_bytes = tx_bytes;
+	packet.tx_messages = tx_messages;
+	packet.tx_dropped = tx_dropped;
+	packet.rx_rate = rx_rate;
+	packet.tx_rate = tx_rate;
+	packet.tx_scheduled_rate = tx_scheduled_rate;
+	packet.rx_high_water = rx_high_water;
+	packet.tx_high_water = tx_high_water;
+	packet.channel = channel;
+
+        memcpy(_MAV_PAYLOAD_NON_CONST(msg), &packet, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#endif
+
+	msg->msgid = MAVLINK_MSG_ID_LINK_STATS;
+#if MAVLINK_CRC_EXTRA
+    return mavlink_finalize_message_chan(msg, system_id, component_id, chan, MAVLINK_MSG_ID_LINK_STATS_LEN, MAVLINK_MSG_ID_LINK_STATS_CRC);
+#else
+    return mavlink_finalize_message_chan(msg, system_id, component_id, chan, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#endif
+}
+
+/**
+ * @brief Encode a link_stats struct
+ *
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param msg The MAVLink message to compress the data into
+ * @param link_stats C-struct to read the message contents from
+ */
+static inline uint16_t mavlink_msg_link_stats_encode(uint8_t system_id, uint8_t component_id, mavlink_message_t* msg, const mavlink_link_stats_t* link_stats)
+{
+	return mavlink_msg_link_stats_pack(system_id, component_id, msg, link_stats->channel, link_stats->rx_bytes, link_stats->rx_messages, link_stats->rx_discarded, link_stats->rx_lost, link_stats->tx_bytes, link_stats->tx_messages, link_stats->tx_dropped, link_stats->rx_rate, link_stats->tx_rate, link_stats->tx_scheduled_rate, link_stats->rx_high_water, link_stats->tx_high_water);
+}
+
+/**
+ * @brief Encode a link_stats struct on a channel
+ *
+ * @param system_id ID of this system
+ * @param component_id ID of this component (e.g. 200 for IMU)
+ * @param chan The MAVLink channel this message will be sent over
+ * @param msg The MAVLink message to compress the data into
+ * @param link_stats C-struct to read the message contents from
+ */
+static inline uint16_t mavlink_msg_link_stats_encode_chan(uint8_t system_id, uint8_t component_id, uint8_t chan, mavlink_message_t* msg, const mavlink_link_stats_t* link_stats)
+{
+	return mavlink_msg_link_stats_pack_chan(system_id, component_id, chan, msg, link_stats->channel, link_stats->rx_bytes, link_stats->rx_messages, link_stats->rx_discarded, link_stats->rx_lost, link_stats->tx_bytes, link_stats->tx_messages, link_stats->tx_dropped, link_stats->rx_rate, link_stats->tx_rate, link_stats->tx_scheduled_rate, link_stats->rx_high_water, link_stats->tx_high_water);
+}
+
+/**
+ * @brief Send a link_stats message
+ * @param chan MAVLink channel to send the message
+ *
+ * @param channel The link these statistics are for. 0 is the groundstation and 1 the datalogger.
+ * @param rx_bytes Bytes received.
+ * @param rx_messages Messages received with a valid length and checksum.
+ * @param rx_discarded Received bytes that were discarded as they weren't part of a valid message.
+ * @param rx_lost Messages lost according to gaps in the sequence numbers of the groundstation.
+ * @param tx_bytes Bytes queued for transmission.
+ * @param tx_messages Messages queued for transmission.
+ * @param tx_dropped Bytes not transmitted because the transmit buffer was full.
+ * @param rx_rate Bytes received during the last second.
+ * @param tx_rate Bytes queued for transmission during the last second.
+ * @param tx_scheduled_rate Bytes per second of telemetry scheduled on this link.
+ * @param rx_high_water The most bytes ever waiting in the receive buffer.
+ * @param tx_high_water The most bytes ever waiting in the transmit buffer.
+ */
+#ifdef MAVLINK_USE_CONVENIENCE_FUNCTIONS
+
+static inline void mavlink_msg_link_stats_send(mavlink_channel_t chan, uint8_t channel, uint32_t rx_bytes, uint32_t rx_messages, uint32_t rx_discarded, uint32_t rx_lost, uint32_t tx_bytes, uint32_t tx_messages, uint32_t tx_dropped, uint16_t rx_rate, uint16_t tx_rate, uint16_t tx_scheduled_rate, uint16_t rx_high_water, uint16_t tx_high_water)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char buf[MAVLINK_MSG_ID_LINK_STATS_LEN];
+	_mav_put_uint32_t(buf, 0, rx_bytes);
+	_mav_put_uint32_t(buf, 4, rx_messages);
+	_mav_put_uint32_t(buf, 8, rx_discarded);
+	_mav_put_uint32_t(buf, 12, rx_lost);
+	_mav_put_uint32_t(buf, 16, tx_bytes);
+	_mav_put_uint32_t(buf, 20, tx_messages);
+	_mav_put_uint32_t(buf, 24, tx_dropped);
+	_mav_put_uint16_t(buf, 28, rx_rate);
+	_mav_put_uint16_t(buf, 30, tx_rate);
+	_mav_put_uint16_t(buf, 32, tx_scheduled_rate);
+	_mav_put_uint16_t(buf, 34, rx_high_water);
+	_mav_put_uint16_t(buf, 36, tx_high_water);
+	_mav_put_uint8_t(buf, 38, channel);
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LINK_STATS, buf, MAVLINK_MSG_ID_LINK_STATS_LEN, MAVLINK_MSG_ID_LINK_STATS_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LINK_STATS, buf, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#endif
+#else
+	mavlink_link_stats_t packet;
+	packet.rx_bytes = rx_bytes;
+	packet.rx_messages = rx_messages;
+	packet.rx_discarded = rx_discarded;
+	packet.rx_lost = rx_lost;
+	packet.tx_bytes = tx_bytes;
+	packet.tx_messages = tx_messages;
+	packet.tx_dropped = tx_dropped;
+	packet.rx_rate = rx_rate;
+	packet.tx_rate = tx_rate;
+	packet.tx_scheduled_rate = tx_scheduled_rate;
+	packet.rx_high_water = rx_high_water;
+	packet.tx_high_water = tx_high_water;
+	packet.channel = channel;
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LINK_STATS, (const char *)&packet, MAVLINK_MSG_ID_LINK_STATS_LEN, MAVLINK_MSG_ID_LINK_STATS_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LINK_STATS, (const char *)&packet, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#endif
+#endif
+}
+
+#if MAVLINK_MSG_ID_LINK_STATS_LEN <= MAVLINK_MAX_PAYLOAD_LEN
+/*
+  This varient of _send() can be used to save stack space by re-using
+  memory from the receive buffer.  The caller provides a
+  mavlink_message_t which is the size of a full mavlink message. This
+  is usually the receive buffer for the channel, and allows a reply to an
+  incoming message with minimum stack space usage.
+ */
+static inline void mavlink_msg_link_stats_send_buf(mavlink_message_t *msgbuf, mavlink_channel_t chan,  uint8_t channel, uint32_t rx_bytes, uint32_t rx_messages, uint32_t rx_discarded, uint32_t rx_lost, uint32_t tx_bytes, uint32_t tx_messages, uint32_t tx_dropped, uint16_t rx_rate, uint16_t tx_rate, uint16_t tx_scheduled_rate, uint16_t rx_high_water, uint16_t tx_high_water)
+{
+#if MAVLINK_NEED_BYTE_SWAP || !MAVLINK_ALIGNED_FIELDS
+	char *buf = (char *)msgbuf;
+	_mav_put_uint32_t(buf, 0, rx_bytes);
+	_mav_put_uint32_t(buf, 4, rx_messages);
+	_mav_put_uint32_t(buf, 8, rx_discarded);
+	_mav_put_uint32_t(buf, 12, rx_lost);
+	_mav_put_uint32_t(buf, 16, tx_bytes);
+	_mav_put_uint32_t(buf, 20, tx_messages);
+	_mav_put_uint32_t(buf, 24, tx_dropped);
+	_mav_put_uint16_t(buf, 28, rx_rate);
+	_mav_put_uint16_t(buf, 30, tx_rate);
+	_mav_put_uint16_t(buf, 32, tx_scheduled_rate);
+	_mav_put_uint16_t(buf, 34, rx_high_water);
+	_mav_put_uint16_t(buf, 36, tx_high_water);
+	_mav_put_uint8_t(buf, 38, channel);
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LINK_STATS, buf, MAVLINK_MSG_ID_LINK_STATS_LEN, MAVLINK_MSG_ID_LINK_STATS_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LINK_STATS, buf, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#endif
+#else
+	mavlink_link_stats_t *packet = (mavlink_link_stats_t *)msgbuf;
+	packet->rx_bytes = rx_bytes;
+	packet->rx_messages = rx_messages;
+	packet->rx_discarded = rx_discarded;
+	packet->rx_lost = rx_lost;
+	packet->tx_bytes = tx_bytes;
+	packet->tx_messages = tx_messages;
+	packet->tx_dropped = tx_dropped;
+	packet->rx_rate = rx_rate;
+	packet->tx_rate = tx_rate;
+	packet->tx_scheduled_rate = tx_scheduled_rate;
+	packet->rx_high_water = rx_high_water;
+	packet->tx_high_water = tx_high_water;
+	packet->channel = channel;
+
+#if MAVLINK_CRC_EXTRA
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LINK_STATS, (const char *)packet, MAVLINK_MSG_ID_LINK_STATS_LEN, MAVLINK_MSG_ID_LINK_STATS_CRC);
+#else
+    _mav_finalize_message_chan_send(chan, MAVLINK_MSG_ID_LINK_STATS, (const char *)packet, MAVLINK_MSG_ID_LINK_STATS_LEN);
+#endif
+#endif
+}
+#endif
+
+#endif
+
+// MESSAGE LINK_STATS UNPACKING
+
+
+/**
+ * @brief Get field channel from link_stats message
+ *
+ * @return The link these statistics are for. 0 is the groundstation and 1 the datalogger.
+ */
+static inline uint8_t mavlink_msg_link_stats_get_channel(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint8_t(msg,  38);
+}
+
+/**
+ * @brief Get field rx_bytes from link_stats message
+ *
+ * @return Bytes received.
+ */
+static inline uint32_t mavlink_msg_link_stats_get_rx_bytes(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  0);
+}
+
+/**
+ * @brief Get field rx_messages from link_stats message
+ *
+ * @return Messages received with a valid length and checksum.
+ */
+static inline uint32_t mavlink_msg_link_stats_get_rx_messages(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  4);
+}
+
+/**
+ * @brief Get field rx_discarded from link_stats message
+ *
+ * @return Received bytes that were discarded as they weren't part of a valid message.
+ */
+static inline uint32_t mavlink_msg_link_stats_get_rx_discarded(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  8);
+}
+
+/**
+ * @brief Get field rx_lost from link_stats message
+ *
+ * @return Messages lost according to gaps in the sequence numbers of the groundstation.
+ */
+static inline uint32_t mavlink_msg_link_stats_get_rx_lost(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  12);
+}
+
+/**
+ * @brief Get field tx_bytes from link_stats message
+ *
+ * @return Bytes queued for transmission.
+ */
+static inline uint32_t mavlink_msg_link_stats_get_tx_bytes(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  16);
+}
+
+/**
+ * @brief Get field tx_messages from link_stats message
+ *
+ * @return Messages queued for transmission.
+ */
+static inline uint32_t mavlink_msg_link_stats_get_tx_messages(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  20);
+}
+
+/**
+ * @brief Get field tx_dropped from link_stats message
+ *
+ * @return Bytes not transmitted because the transmit buffer was full.
+ */
+static inline uint32_t mavlink_msg_link_stats_get_tx_dropped(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint32_t(msg,  24);
+}
+
+/**
+ * @brief Get field rx_rate from link_stats message
+ *
+ * @return Bytes received during the last second.
+ */
+static inline uint16_t mavlink_msg_link_stats_get_rx_rate(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  28);
+}
+
+/**
+ * @brief Get field tx_rate from link_stats message
+ *
+ * @return Bytes queued for transmission during the last second.
+ */
+static inline uint16_t mavlink_msg_link_stats_get_tx_rate(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  30);
+}
+
+/**
+ * @brief Get field tx_scheduled_rate from link_stats message
+ *
+ * @return Bytes per second of telemetry scheduled on this link.
+ */
+static inline uint16_t mavlink_msg_link_stats_get_tx_scheduled_rate(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  32);
+}
+
+/**
+ * @brief Get field rx_high_water from link_stats message
+ *
+ * @return The most bytes ever waiting in the receive buffer.
+ */
+static inline uint16_t mavlink_msg_link_stats_get_rx_high_water(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  34);
+}
+
+/**
+ * @brief Get field tx_high_water from link_stats message
+ *
+ * @return The most bytes ever waiting in the transmit buffer.
+ */
+static inline uint16_t mavlink_msg_link_stats_get_tx_high_water(const mavlink_message_t* msg)
+{
+	return _MAV_RETURN_uint16_t(msg,  36);
+}
+
+/**
+ * @brief Decode a link_stats message into a struct
+ *
+ * @param msg The message to decode
+ * @param link_stats C-struct to decode the message contents into
+ */
+static inline void mavlink_msg_link_stats_decode(const mavlink_message_t* msg, mavlink_link_stats_t* link_stats)
+{
+#if MAVLINK_NEED_BYTE_SWAP
+	link_stats->rx_bytes = mavlink_msg_link_stats_get_rx_bytes(msg);
+	link_stats->rx_messages = mavlink_msg_link_stats_get_rx_messages(msg);
+	link_stats->rx_discarded = mavlink_msg_link_stats_get_rx_discarded(msg);
+	link_stats->rx_lost = mavlink_msg_link_stats_get_rx_lost(msg);
+	link_stats->tx_bytes = mavlink_msg_link_stats_get_tx_bytes(msg);
+	link_stats->tx_messages = mavlink_msg_link_stats_get_tx_messages(msg);
+	link_stats->tx_dropped = mavlink_msg_link_stats_get_tx_dropped(msg);
+	link_stats->rx_rate = mavlink_msg_link_stats_get_rx_rate(msg);
+	link_stats->tx_rate = mavlink_msg_link_stats_get_tx_rate(msg);
+	link_stats->tx_scheduled_rate = mavlink_msg_link_stats_get_tx_scheduled_rate(msg);
+	link_stats->rx_high_water = mavlink_msg_link_stats_get_rx_high_water(msg);
+	link_stats->tx_high_water = mavlink_msg_link_stats_get_tx_high_water(msg);
+	link_stats->channel = mavlink_msg_link_stats_get_channel(msg);
+#else
+	memcpy(link_stats, _MAV_PAYLOAD(msg), MAVLINK_MSG_ID_LINK_STATS_LEN);
+#endif
+}
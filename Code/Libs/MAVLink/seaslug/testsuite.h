@@ -686,6 +686,162 @@ static void mavlink_test_basic_state2(uint8_t system_id, uint8_t component_id, m
         MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
 }
 
+static void mavlink_test_link_stats(uint8_t system_id, uint8_t component_id, mavlink_message_t *last_msg)
+{
+	mavlink_message_t msg;
+        uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+        uint16_t i;
+	mavlink_link_stats_t packet_in = {
+		963497464,963497672,963497880,963498088,963498296,963498504,963498712,18691,18795,18899,19003,19107,247
+    };
+	mavlink_link_stats_t packet1, packet2;
+        memset(&packet1, 0, sizeof(packet1));
+        	packet1.rx_bytes = packet_in.rx_bytes;
+        	packet1.rx_messages = packet_in.rx_messages;
+        	packet1.rx_discarded = packet_in.rx_discarded;
+        	packet1.rx_lost = packet_in.rx_lost;
+        	packet1.tx_bytes = packet_in.tx_bytes;
+        	packet1.tx_messages = packet_in.tx_messages;
+        	packet1.tx_dropped = packet_in.tx_dropped;
+        	packet1.rx_rate = packet_in.rx_rate;
+        	packet1.tx_rate = packet_in.tx_rate;
+        	packet1.tx_scheduled_rate = packet_in.tx_scheduled_rate;
+        	packet1.rx_high_water = packet_in.rx_high_water;
+        	packet1.tx_high_water = packet_in.tx_high_water;
+        	packet1.channel = packet_in.channel;
+        
+        
+
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_link_stats_encode(system_id, component_id, &msg, &packet1);
+	mavlink_msg_link_stats_decode(&msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_link_stats_pack(system_id, component_id, &msg , packet1.channel , packet1.rx_bytes , packet1.rx_messages , packet1.rx_discarded , packet1.rx_lost , packet1.tx_bytes , packet1.tx_messages , packet1.tx_dropped , packet1.rx_rate , packet1.tx_rate , packet1.tx_scheduled_rate , packet1.rx_high_water , packet1.tx_high_water );
+	mavlink_msg_link_stats_decode(&msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_link_stats_pack_chan(system_id, component_id, MAVLINK_COMM_0, &msg , packet1.channel , packet1.rx_bytes , packet1.rx_messages , packet1.rx_discarded , packet1.rx_lost , packet1.tx_bytes , packet1.tx_messages , packet1.tx_dropped , packet1.rx_rate , packet1.tx_rate , packet1.tx_scheduled_rate , packet1.rx_high_water , packet1.tx_high_water );
+	mavlink_msg_link_stats_decode(&msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+
+        memset(&packet2, 0, sizeof(packet2));
+        mavlink_msg_to_send_buffer(buffer, &msg);
+        for (i=0; i<mavlink_msg_get_send_buffer_length(&msg); i++) {
+        	comm_send_ch(MAVLINK_COMM_0, buffer[i]);
+        }
+	mavlink_msg_link_stats_decode(last_msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+        
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_link_stats_send(MAVLINK_COMM_1 , packet1.channel , packet1.rx_bytes , packet1.rx_messages , packet1.rx_discarded , packet1.rx_lost , packet1.tx_bytes , packet1.tx_messages , packet1.tx_dropped , packet1.rx_rate , packet1.tx_rate , packet1.tx_scheduled_rate , packet1.rx_high_water , packet1.tx_high_water );
+	mavlink_msg_link_stats_decode(last_msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+}
+
+static void mavlink_test_can_bus_stats(uint8_t system_id, uint8_t component_id, mavlink_message_t *last_msg)
+{
+	mavlink_message_t msg;
+        uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+        uint16_t i;
+	mavlink_can_bus_stats_t packet_in = {
+		963497464,963497672,963497880,17859,17963,18067,187,254,65,132
+    };
+	mavlink_can_bus_stats_t packet1, packet2;
+        memset(&packet1, 0, sizeof(packet1));
+        	packet1.frames = packet_in.frames;
+        	packet1.untracked = packet_in.untracked;
+        	packet1.bit_rate = packet_in.bit_rate;
+        	packet1.load = packet_in.load;
+        	packet1.peak_load = packet_in.peak_load;
+        	packet1.frame_rate = packet_in.frame_rate;
+        	packet1.tx_errors = packet_in.tx_errors;
+        	packet1.rx_errors = packet_in.rx_errors;
+        	packet1.ids = packet_in.ids;
+        	packet1.drifting = packet_in.drifting;
+        
+        
+
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_can_bus_stats_encode(system_id, component_id, &msg, &packet1);
+	mavlink_msg_can_bus_stats_decode(&msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_can_bus_stats_pack(system_id, component_id, &msg , packet1.frames , packet1.untracked , packet1.bit_rate , packet1.load , packet1.peak_load , packet1.frame_rate , packet1.tx_errors , packet1.rx_errors , packet1.ids , packet1.drifting );
+	mavlink_msg_can_bus_stats_decode(&msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_can_bus_stats_pack_chan(system_id, component_id, MAVLINK_COMM_0, &msg , packet1.frames , packet1.untracked , packet1.bit_rate , packet1.load , packet1.peak_load , packet1.frame_rate , packet1.tx_errors , packet1.rx_errors , packet1.ids , packet1.drifting );
+	mavlink_msg_can_bus_stats_decode(&msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+
+        memset(&packet2, 0, sizeof(packet2));
+        mavlink_msg_to_send_buffer(buffer, &msg);
+        for (i=0; i<mavlink_msg_get_send_buffer_length(&msg); i++) {
+        	comm_send_ch(MAVLINK_COMM_0, buffer[i]);
+        }
+	mavlink_msg_can_bus_stats_decode(last_msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+        
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_can_bus_stats_send(MAVLINK_COMM_1 , packet1.frames , packet1.untracked , packet1.bit_rate , packet1.load , packet1.peak_load , packet1.frame_rate , packet1.tx_errors , packet1.rx_errors , packet1.ids , packet1.drifting );
+	mavlink_msg_can_bus_stats_decode(last_msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+}
+static void mavlink_test_can_traffic(uint8_t system_id, uint8_t component_id, mavlink_message_t *last_msg)
+{
+	mavlink_message_t msg;
+        uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+        uint16_t i;
+	mavlink_can_traffic_t packet_in = {
+		963497464,963497672,963497880,17859,17963,18067,187,254
+    };
+	mavlink_can_traffic_t packet1, packet2;
+        memset(&packet1, 0, sizeof(packet1));
+        	packet1.id = packet_in.id;
+        	packet1.frames = packet_in.frames;
+        	packet1.bit_rate = packet_in.bit_rate;
+        	packet1.rate = packet_in.rate;
+        	packet1.average_rate = packet_in.average_rate;
+        	packet1.nominal_rate = packet_in.nominal_rate;
+        	packet1.type = packet_in.type;
+        	packet1.drifting = packet_in.drifting;
+        
+        
+
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_can_traffic_encode(system_id, component_id, &msg, &packet1);
+	mavlink_msg_can_traffic_decode(&msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_can_traffic_pack(system_id, component_id, &msg , packet1.id , packet1.frames , packet1.bit_rate , packet1.rate , packet1.average_rate , packet1.nominal_rate , packet1.type , packet1.drifting );
+	mavlink_msg_can_traffic_decode(&msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_can_traffic_pack_chan(system_id, component_id, MAVLINK_COMM_0, &msg , packet1.id , packet1.frames , packet1.bit_rate , packet1.rate , packet1.average_rate , packet1.nominal_rate , packet1.type , packet1.drifting );
+	mavlink_msg_can_traffic_decode(&msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+
+        memset(&packet2, 0, sizeof(packet2));
+        mavlink_msg_to_send_buffer(buffer, &msg);
+        for (i=0; i<mavlink_msg_get_send_buffer_length(&msg); i++) {
+        	comm_send_ch(MAVLINK_COMM_0, buffer[i]);
+        }
+	mavlink_msg_can_traffic_decode(last_msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+        
+        memset(&packet2, 0, sizeof(packet2));
+	mavlink_msg_can_traffic_send(MAVLINK_COMM_1 , packet1.id , packet1.frames , packet1.bit_rate , packet1.rate , packet1.average_rate , packet1.nominal_rate , packet1.type , packet1.drifting );
+	mavlink_msg_can_traffic_decode(last_msg, &packet2);
+        MAVLINK_ASSERT(memcmp(&packet1, &packet2, sizeof(packet1)) == 0);
+}
+
 static void mavlink_test_controller_data(uint8_t system_id, uint8_t component_id, mavlink_message_t *last_msg)
 {
 	mavlink_message_t msg;
@@ -886,6 +1042,9 @@ static void mavlink_test_seaslug(uint8_t system_id, uint8_t component_id, mavlin
 	mavlink_test_node_status(system_id, component_id, last_msg);
 	mavlink_test_waypoint_status(system_id, component_id, last_msg);
 	mavlink_test_basic_state2(system_id, component_id, last_msg);
+	mavlink_test_link_stats(system_id, component_id, last_msg);
+	mavlink_test_can_bus_stats(system_id, component_id, last_msg);
+	mavlink_test_can_traffic(system_id, component_id, last_msg);
 	mavlink_test_controller_data(system_id, component_id, last_msg);
 	mavlink_test_tokimec_with_time(system_id, component_id, last_msg);
 	mavlink_test_param_value_with_time(system_id, component_id, last_msg);
@@ -1,8 +1,10 @@
 // Microchip standard library includes
+#if defined(__XC16__)
 #include <xc.h>
 #include <pps.h>
 #include <adc.h>
 #include <dma.h>
+#endif
 
 // Project includes
 #include "Ecan1.h"
@@ -10,8 +12,11 @@
 #include "CanMessages.h"
 #include "Types.h"
 #include "Node.h"
-#include "Timer2.h"
 #include "MessageScheduler.h"
+#include "PowerNode.h"
+#if defined(__XC16__)
+#include "Timer2.h"
+#endif
 
 // ADC input struct. Provides enough space for 16 inputs (as req'd by the docs). Really only index
 // position 1 (temperature sensor) and 5 (voltage sensor) will be populated. But with the scatter-
@@ -21,6 +26,9 @@
 static volatile uint16_t adcDmaBuffer[16] __attribute__((space(dma),aligned(32)));
 #elif __dsPIC33EP256MC502__
 static volatile uint16_t adcDmaBuffer[16] __attribute__((aligned(32)));
+#else
+// On the host there's no ADC, so the readings all stay at 0.
+static volatile uint16_t adcDmaBuffer[16];
 #endif
 
 // Set up the message scheduler for running 3 tasks:
@@ -38,14 +46,20 @@ uint8_t taskIds[NUM_TASKS] = {
 	TASK_TRANSMIT_STATUS,
 	TASK_TRANSMIT_POWER
 };
-uint16_t taskTimeSteps[NUM_TASKS][2][8] = {};
+uint8_t  taskTimestepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+uint16_t taskTimestepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+MessageScheduleSlot taskSlots[NUM_TASKS] = {};
 uint8_t  taskWeights[NUM_TASKS] = {1, 1, 1}; // All tasks have an equal weighting, as it doesn't matter.
 MessageSchedule taskSchedule = {
 	NUM_TASKS,
 	taskIds,
 	taskWeights,
 	0,
-	taskTimeSteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	taskTimestepLists,
+	taskTimestepBytes,
+	taskSlots
 };
 
 // Flag for triggering a run of the primary loop. Set by the timer interrupt.
@@ -58,7 +72,6 @@ bool runTasks = false;
 #define ANmax 4095.0f
 
 // Set some function prototypes.
-void RunTasks(void);
 void Adc1Init(void);
 void SetTaskFlag(void);
 
@@ -83,6 +96,7 @@ void SetTaskFlag(void);
 	_FICD(JTAGEN_OFF & ICS_PGD2);
 #endif
 
+#if defined(__XC16__)
 int main()
 {
 	/// First step is to move over to the FRC w/ PLL clock from the default FRC clock.
@@ -110,29 +124,12 @@ int main()
 	// Initialize ADCs for reading voltage and temperature sensors
 	Adc1Init();
 	
-	// Set up some standard node stuff
-	nodeId = CAN_NODE_POWER_SENSOR;
-	
-    // Initialize ECAN1 for input and output using DMA buffers 0 & 2
-    Ecan1Init(F_OSC, 250000);
+	// Set up ECAN1 and the tasks.
+	PowerNodeInit();
 
 	// Set up a timer at 100.0320Hz, where F_timer = F_CY / 256 / prescalar.
 	Timer2Init(SetTaskFlag, F_OSC / 2 / 256 / 100);
 	
-	// Set up all of our tasks.
-	// Blink at 1Hz
-	if (!AddMessageRepeating(&taskSchedule, TASK_BLINK, 1)) {
-		FATAL_ERROR();
-	}
-	// Transmit node status at 2Hz
-	if (!AddMessageRepeating(&taskSchedule, TASK_TRANSMIT_STATUS, 2)) {
-		FATAL_ERROR();
-	}
-	// Transmit power data at 10Hz
-	if (!AddMessageRepeating(&taskSchedule, TASK_TRANSMIT_POWER, 10)) {
-		FATAL_ERROR();
-	}
-	
 	// And configure the Peripheral Pin Select pins:
 	PPSUnLock;
 
@@ -156,6 +153,30 @@ int main()
 		}
 	}
 }
+#endif
+
+void PowerNodeInit(void)
+{
+	// Set up some standard node stuff
+	nodeId = CAN_NODE_POWER_SENSOR;
+	
+    // Initialize ECAN1 for input and output using DMA buffers 0 & 2
+    Ecan1Init(F_OSC, 250000);
+
+	// Set up all of our tasks.
+	// Blink at 1Hz
+	if (!AddMessageRepeating(&taskSchedule, TASK_BLINK, 1)) {
+		FATAL_ERROR();
+	}
+	// Transmit node status at 2Hz
+	if (!AddMessageRepeating(&taskSchedule, TASK_TRANSMIT_STATUS, 2)) {
+		FATAL_ERROR();
+	}
+	// Transmit power data at 10Hz
+	if (!AddMessageRepeating(&taskSchedule, TASK_TRANSMIT_POWER, 10)) {
+		FATAL_ERROR();
+	}
+}
 
 void RunTasks(void)
 {
@@ -174,7 +195,9 @@ void RunTasks(void)
 	for (i = 0; i < count; ++i) {
 		switch (tasks[i]) {
 			case TASK_BLINK:
+#if defined(__XC16__)
 				_LATA4 ^= 1;
+#endif
 			break;
 
 			case TASK_TRANSMIT_POWER: {
@@ -192,6 +215,7 @@ void RunTasks(void)
 	}
 }
 
+#if defined(__XC16__)
 void Adc1Init(void)
 {
 	// Initialize ADC for reading temperature, 2x power rail voltage, and current draw.
@@ -258,4 +282,5 @@ void Adc1Init(void)
 void SetTaskFlag(void)
 {
 	runTasks = true;
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
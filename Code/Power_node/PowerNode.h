@@ -0,0 +1,14 @@
+#ifndef POWER_NODE_H
+#define POWER_NODE_H
+
+/**
+ * Sets up ECAN1 and schedules the node's tasks.
+ */
+void PowerNodeInit(void);
+
+/**
+ * Runs the scheduled tasks for this timestep. Called at 100Hz.
+ */
+void RunTasks(void);
+
+#endif // POWER_NODE_H
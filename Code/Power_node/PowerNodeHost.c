@@ -0,0 +1,24 @@
+/**
+ * @file   PowerNodeHost.c
+ * @brief  Runs the power node as a Linux process on a virtual CAN bus, see NodeHost.h.
+ *
+ * Without the ADC, it reports 0V and 0A.
+ *
+ * Build on the host with:
+ * `gcc PowerNodeHost.c PowerNode.c ../Libs/C/{NodeHost,Ecan1Host,VirtualCan,CanBusMonitor,EcanFilterPlanner,EcanTxScheduler,CanFrameQueue,Node,CanMessages,MessageScheduler,Nmea2000,Nmea2000Encode}.c -I. -I../Libs/C -O2 -Wall -pthread -lrt -lm -o PowerNode`
+ */
+#include "NodeHost.h"
+#include "PowerNode.h"
+
+int main(int argc, char *argv[])
+{
+	NodeHostInit("power", argc, argv);
+	PowerNodeInit();
+
+	while (NodeHostTick()) {
+		RunTasks();
+	}
+
+	NodeHostExit();
+	return 0;
+}
@@ -7,6 +7,7 @@
 #include "Types.h"
 #include "Node.h"
 #include "Tokimec.h"
+#include "CanDispatch.h"
 
 // Store data from the Rudder Node.
 struct RudderCanData  {
@@ -196,6 +197,20 @@ void GetGpsData(GpsData *data);
   */
 void ClearGpsData(void);
 
+/**
+ * Registers the handlers of every message ProcessAllEcanMessages() processes, and starts monitoring
+ * the bus. Call this once at startup after initializing ECAN1, before processing any messages.
+ */
+void EcanSensorsInit(void);
+
+/**
+ * Returns how many times a message has been processed and when it was last processed, in units of
+ * .01s (@see nodeSystemTime), or NULL if it isn't processed at all.
+ * @param id A standard CAN ID, or a PGN.
+ * @param pgn Whether `id` is a PGN.
+ */
+const CanDispatchStats *GetEcanMessageStats(uint32_t id, bool pgn);
+
 /**
  * This function should be called every timestep to process any received ECAN messages.
  */
@@ -6,11 +6,19 @@
  * The main functions are at the bottom: MavLinkTransmit() and MavLinkReceive()
  * handle the dispatching of messages (and sending of non-FSM reliant ones) and
  * the reception of messages and forwarding of reception events to the relevent
- * FSMs. The two state machine functions (MavLinkEvaluateMissionState and
- * MavLinkEvaluateParameterState) both contain all of the state logic for the
- * MAVLink mission and parameter protocols. As the specifications for those two
- * protocols are not fully defined they have been tested with QGroundControl to
- * work correctly.
+ * FSMs. Mission uploads and downloads are pipelined through a MissionTransfer
+ * (see MissionTransfer.h), while parameters are streamed using whatever
+ * bandwidth the schedules leave spare (see ParamStream.h). As the
+ * specifications for those two protocols are not fully defined they have been
+ * tested with QGroundControl to work correctly.
+ *
+ * Sensor and status messages that sit still most of the time are only sent to
+ * the groundstation when they changed (see TelemetryFilters.h), and the bytes
+ * they would have taken go to the parameter stream instead.
+ *
+ * The groundstation telemetry can also be packed into one frame per timestep
+ * (see GROUNDSTATION_BATCHING and MavlinkBatch.h), for when the radio link is
+ * saturated. This needs Scripts/C/MavlinkUnbatch.c running on the groundstation.
  *
  * This code was written to be as generic as possible. If you remove all of the
  * custom messages and switch the transmission from uart1EnqueueData() it should
@@ -20,12 +28,23 @@
 #include "Ecan1.h"
 
 // C standard library includes
+#include <stddef.h>
 #include <stdio.h>
 
 // User code includes
 #include "Uart1.h"
 #include "Uart2.h"
 #include "MessageScheduler.h"
+#include "MavlinkSerializer.h"
+#include "MavlinkReceiver.h"
+#include "MavlinkDispatch.h"
+#include "LinkStats.h"
+#include "MavlinkBatch.h"
+#include "ParamStream.h"
+#include "MissionTransfer.h"
+#include "LogStream.h"
+#include "ChangeFilter.h"
+#include "TelemetryFilters.h"
 #include "EcanSensors.h"
 #include "Rudder.h"
 #include "MavlinkGlue.h"
@@ -42,15 +61,6 @@
 // Declare our internal variable data store for some miscellaneous data output over MAVLink.
 InternalVariables controllerVars;
 
-// Store a single txMessage copy here. This is shared by all of the Send*() functions in this file
-// to reduce stack usage. Note that since all Send*() functions use this shared memory, NONE of them
-// are re-entrant.
-// This fixes an AddressError trap bug I was experiencing when each function had their own local
-// copy. This was an odd error to receive, since compilation with Stack.s forces the stack below
-// the 32K boundary. This code is redundant as of the xc16-1.20 release that defaults to keeping the
-// stack below this boundary and outside of extended data space.
-static mavlink_message_t txMessage;
-
 /**
  * This function converts latitude/longitude/altitude into a north/east/down local tangent plane. The
  * code I use by default is auto-generated C code from a Simulink block in the autonomous controller.
@@ -59,80 +69,6 @@ static mavlink_message_t txMessage;
  */
 extern void lla2ltp(const int32_t[3], float[3]);
 
-// Set up some state machine variables for the parameter protocol.
-enum PARAM_STATE {
-	PARAM_STATE_INACTIVE = 0,
-
-	PARAM_STATE_SINGLETON_SEND_VALUE,
-
-	PARAM_STATE_STREAM_SEND_VALUE,
-	PARAM_STATE_STREAM_DELAY
-};
-
-// Events that trigger changes in the parameter protocol state machine.
-// This follows almost exactly from MAVLink's parameter protocol as described in their docs.
-// Note, however, the addition of the TRANSMIT_ALL differs from that.
-enum PARAM_EVENT {
-	PARAM_EVENT_NONE,
-	PARAM_EVENT_ENTER_STATE,
-	PARAM_EVENT_EXIT_STATE,
-
-	PARAM_EVENT_REQUEST_LIST_RECEIVED,
-	PARAM_EVENT_REQUEST_READ_RECEIVED,
-	PARAM_EVENT_SET_RECEIVED
-};
-
-// Set up state machine variables for the mission protocol
-enum MISSION_STATE {
-	MISSION_STATE_INACTIVE = 0,
-
-	// States handling transmitting the mission count. It needs to be retransmit twice.
-	MISSION_STATE_SEND_MISSION_COUNT,
-	MISSION_STATE_MISSION_COUNT_TIMEOUT,
-	MISSION_STATE_SEND_MISSION_COUNT2,
-	MISSION_STATE_MISSION_COUNT_TIMEOUT2,
-	MISSION_STATE_SEND_MISSION_COUNT3,
-	MISSION_STATE_MISSION_COUNT_TIMEOUT3,
-
-	// States handling transmitting a mission item. It needs to be retransmit twice.
-	MISSION_STATE_SEND_MISSION_ITEM,
-	MISSION_STATE_MISSION_ITEM_TIMEOUT,
-	MISSION_STATE_SEND_MISSION_ITEM2,
-	MISSION_STATE_MISSION_ITEM_TIMEOUT2,
-	MISSION_STATE_SEND_MISSION_ITEM3,
-	MISSION_STATE_MISSION_ITEM_TIMEOUT3,
-
-	// States handling transmission of the current mission
-	MISSION_STATE_SEND_CURRENT,
-	MISSION_STATE_CURRENT_TIMEOUT,
-	MISSION_STATE_SEND_CURRENT2,
-	MISSION_STATE_CURRENT_TIMEOUT2,
-
-	// States handling sending a mission request
-	MISSION_STATE_SEND_MISSION_REQUEST,
-	MISSION_STATE_MISSION_REQUEST_TIMEOUT,
-	MISSION_STATE_SEND_MISSION_REQUEST2,
-	MISSION_STATE_MISSION_REQUEST_TIMEOUT2,
-	MISSION_STATE_SEND_MISSION_REQUEST3,
-	MISSION_STATE_MISSION_REQUEST_TIMEOUT3
-};
-
-// Set up the events necessary for the mission protocol state machine.
-enum MISSION_EVENT {
-	MISSION_EVENT_NONE = 0,
-	MISSION_EVENT_ENTER_STATE,
-	MISSION_EVENT_EXIT_STATE,
-
-	// Message reception events
-	MISSION_EVENT_COUNT_RECEIVED,
-	MISSION_EVENT_ACK_RECEIVED,
-	MISSION_EVENT_REQUEST_RECEIVED,
-	MISSION_EVENT_REQUEST_LIST_RECEIVED,
-	MISSION_EVENT_CLEAR_ALL_RECEIVED,
-	MISSION_EVENT_SET_CURRENT_RECEIVED,
-	MISSION_EVENT_ITEM_RECEIVED
-};
-
 // These flags are for use with the SYS_STATUS MAVLink message as a mapping from the Autoboat's
 // sensors to the sensors/controllers available in SYS_STATUS.
 enum ONBOARD_SENSORS {
@@ -179,24 +115,171 @@ static MavlinkVehicle mavlink_system = {
 static uint8_t groundStationSystemId = 0;
 static uint8_t groundStationComponentId = 0;
 
-// Declare a character buffer here to prevent continual allocation/deallocation of MAVLink buffers.
-static uint8_t buf[MAVLINK_MAX_PACKET_LEN];
-static uint16_t len;
+// Health and throughput of both links, reported to the groundstation in LINK_STATS messages.
+static LinkStats groundstationLinkStats;
+static LinkStats dataloggerLinkStats;
 
-// Variable for counting timesteps for the delaying parameter transmission
-static uint8_t parameterTimeoutCounter = 0;
+// Set this to 1 to pack all groundstation messages sent during a timestep into a single frame, which
+// cuts the framing overhead of the radio link down to 2 bytes per message. Groundstations don't
+// understand these frames, so Scripts/C/MavlinkUnbatch.c has to unpack them in between.
+#define GROUNDSTATION_BATCHING 0
+#if GROUNDSTATION_BATCHING
+static MavlinkBatch groundstationBatch;
+static bool groundstationBatching = false; // Only while MavLinkTransmitGroundstation() runs.
 
-// Specify how long between transmitting parameters in a parameter transmission stream. This is in
-// units of timesteps. Conversion to real time depends on call rate of IncrementParameterCounter().
-#define INTRA_PARAM_DELAY 1
+/**
+ * Queues the groundstation batch for transmission, if there's anything in it. Like any other frame,
+ * it's dropped if there isn't room for all of it.
+ */
+static void MavLinkFlushGroundstationBatch(void)
+{
+    SpscBufferSpans spans;
+    const uint16_t space = Uart1GetWriteSpans(&spans);
+    const uint16_t n = MavlinkBatchFinish(&groundstationBatch);
+    if (!n) {
+        return;
+    }
+    if (Uart1WriteData(groundstationBatch.Frame, n)) {
+        LinkStatsTransmit(&groundstationLinkStats, n, true, UART1_BUFFER_SIZE - space + n);
+    } else {
+        LinkStatsTransmit(&groundstationLinkStats, n, false, 0);
+    }
+}
+#endif
 
-// Internal counter variable for use with the COUNTDOWN state
-static uint8_t missionTimeoutCounter = 0;
+// Bytes queued by MavLinkTransmitPayload() and MavLinkLogToDatalogger() since this was last cleared.
+// The transmit handlers report it to their dispatch table, see MAVLINK_TX_HANDLER().
+static uint16_t mavlinkQueuedBytes;
 
-// Define a timeout (in units of main timesteps of MavlinkReceive()) for transmitting
-// MAVLink messages as part of the MISSION protocol. Messages will be retransmit
-// twice before giving up.
-#define MISSION_RESEND_TIMEOUT 100
+/**
+ * Serializes a MAVLink payload struct straight into the transmit buffer of the UART for `channel`
+ * and starts sending it. Frames are never queued partially: if there isn't room for the whole frame
+ * it's dropped without touching the buffer.
+ *
+ * The Send*() functions fill in the mavlink_*_t struct for their message on the stack and pass it to
+ * MAVLINK_TRANSMIT(). This replaces packing into a shared mavlink_message_t, flattening that into a
+ * byte buffer, and then copying that buffer into the UART.
+ *
+ * With GROUNDSTATION_BATCHING, groundstation messages sent during MavLinkTransmitGroundstation() are
+ * added to its batch instead, which is queued once it's full or the timestep is over.
+ * @return True if the frame was queued.
+ */
+static bool MavLinkTransmitPayload(uint8_t channel, uint8_t msgid, const void *payload, uint8_t length, uint8_t crcExtra)
+{
+    SpscBufferSpans spans;
+    uint16_t space, n;
+#if GROUNDSTATION_BATCHING
+    if (channel == MAVLINK_CHAN_GROUNDSTATION && groundstationBatching) {
+        // A batched message counts the bytes it adds to the batch.
+        const uint16_t batched = groundstationBatch.Length;
+        if (MavlinkBatchAdd(&groundstationBatch, msgid, payload, length)) {
+            mavlinkQueuedBytes += groundstationBatch.Length - batched;
+            return true;
+        }
+        MavLinkFlushGroundstationBatch();
+        if (MavlinkBatchAdd(&groundstationBatch, msgid, payload, length)) {
+            mavlinkQueuedBytes += groundstationBatch.Length;
+            return true;
+        }
+        // Too long for any batch, so it goes out as a regular frame.
+    }
+#endif
+    if (channel == MAVLINK_CHAN_DATALOGGER) {
+        space = Uart2GetWriteSpans(&spans);
+    } else {
+        space = Uart1GetWriteSpans(&spans);
+    }
+
+    n = MavlinkSerialize(&spans, space, channel, mavlink_system.sysid, mavlink_system.compid, msgid, payload, length, crcExtra);
+    if (!n) {
+        LinkStatsTransmit(channel == MAVLINK_CHAN_DATALOGGER ? &dataloggerLinkStats : &groundstationLinkStats,
+                          length + MAVLINK_NUM_NON_PAYLOAD_BYTES, false, 0);
+        return false;
+    }
+
+    mavlinkQueuedBytes += n;
+    if (channel == MAVLINK_CHAN_DATALOGGER) {
+        LinkStatsTransmit(&dataloggerLinkStats, n, true, UART2_BUFFER_SIZE - space + n);
+        return Uart2CommitWrite(n);
+    } else {
+        LinkStatsTransmit(&groundstationLinkStats, n, true, UART1_BUFFER_SIZE - space + n);
+        return Uart1CommitWrite(n);
+    }
+}
+#define MAVLINK_TRANSMIT(channel, name, payload) \
+    MavLinkTransmitPayload(channel, MAVLINK_MSG_ID_##name, payload, MAVLINK_MSG_ID_##name##_LEN, MAVLINK_MSG_ID_##name##_CRC)
+
+// Scheduled groundstation messages that are only sent when they changed, see TelemetryFilters.h.
+// The bytes of the ones skipped during a timestep are handed to the parameter stream instead.
+static ChangeFilter groundstationFilters[TELEMETRY_FILTER_COUNT];
+static uint16_t groundstationSuppressedBytes;
+
+/**
+ * Like MavLinkTransmitPayload(), but groundstation messages with a change filter are skipped if they
+ * didn't change since they were last sent.
+ * @return True if the frame was queued.
+ */
+static bool MavLinkTransmitChanged(uint8_t channel, uint8_t msgid, const void *payload, uint8_t length, uint8_t crcExtra)
+{
+    if (channel == MAVLINK_CHAN_GROUNDSTATION) {
+        uint8_t i;
+        for (i = 0; i < TELEMETRY_FILTER_COUNT; ++i) {
+            if (telemetryFilterConfigs[i].MsgId == msgid) {
+                ChangeFilter *const filter = &groundstationFilters[i];
+                if (!ChangeFilterCheck(filter, payload, nodeSystemTime)) {
+                    groundstationSuppressedBytes += length + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+                    return false;
+                }
+                if (!MavLinkTransmitPayload(channel, msgid, payload, length, crcExtra)) {
+                    return false;
+                }
+                ChangeFilterSent(filter, payload, nodeSystemTime);
+                return true;
+            }
+        }
+    }
+    return MavLinkTransmitPayload(channel, msgid, payload, length, crcExtra);
+}
+#define MAVLINK_TRANSMIT_CHANGED(channel, name, payload) \
+    MavLinkTransmitChanged(channel, MAVLINK_MSG_ID_##name, payload, MAVLINK_MSG_ID_##name##_LEN, MAVLINK_MSG_ID_##name##_CRC)
+
+/**
+ * Encodes a payload as a log stream frame and queues it for the datalogger. A frame that doesn't fit
+ * into the transmit buffer is dropped, and the next one is then sent as a keyframe so that decoding
+ * picks up again right away.
+ * @return True if the frame was queued.
+ */
+static bool MavLinkLogToDatalogger(LogEncoder *encoder, const void *payload)
+{
+    static uint8_t frame[LOG_STREAM_MAX_FRAME_LEN];
+    SpscBufferSpans spans;
+    const uint16_t space = Uart2GetWriteSpans(&spans);
+    const uint16_t n = LogEncode(encoder, payload, frame);
+
+    if (!Uart2WriteData(frame, n)) {
+        LogEncoderRestart(encoder);
+        LinkStatsTransmit(&dataloggerLinkStats, n, false, 0);
+        return false;
+    }
+    LinkStatsTransmit(&dataloggerLinkStats, n, true, UART2_BUFFER_SIZE - space + n);
+    mavlinkQueuedBytes += n;
+    return true;
+}
+
+// Parameters are streamed to the groundstation and the datalogger using whatever bandwidth their
+// schedules leave spare, see ParamStream.h. After being idle, a stream can send up to half of the
+// transmit buffer at once.
+static ParamStream groundstationParamStream;
+static ParamStream dataloggerParamStream;
+#define GROUNDSTATION_PARAM_BURST (UART1_BUFFER_SIZE / 2)
+#define DATALOGGER_PARAM_BURST (UART2_BUFFER_SIZE / 2)
+
+// The mission upload or download with the groundstation, timed by IncrementMissionCounter().
+static MissionTransfer missionTransfer;
+
+// The vessel's local position when the current mission upload started. Any LOCAL_OFFSET_NED
+// missions are all referenced relative to it.
+static float referenceLocalPosition[3];
 
 // This is a variable declared in Simulink that contains the GPS origin used for global/local
 // coordinate conversions. It's organized as latitude (1e7 degrees), longitude (1e7 degrees), and
@@ -209,6 +292,9 @@ extern int32_t gpsOrigin[3];
 static uint16_t mavLinkMessagesReceived = 0;
 static uint16_t mavLinkMessagesFailedParsing = 0;
 
+// Frame synchronization state of the groundstation link.
+static MavlinkReceiver groundstationReceiver;
+
 // Store radio telemetry information from the 3DRs.
 static mavlink_radio_status_t radioStatus;
 
@@ -229,8 +315,14 @@ static uint32_t gcsLastTimeSeen = UINT32_MAX;
 static uint8_t dataloggerChanUsage = 0;
 static uint8_t groundstationChanUsage = 0;
 
-// Set up the message scheduler for MAVLink transmission to the groundstation
-#define GROUNDSTATION_SCHEDULE_NUM_MSGS 18
+// Set up the message scheduler for MAVLink transmission to the groundstation. No single timestep
+// may queue more than a quarter of the transmit buffer.
+#define GROUNDSTATION_SCHEDULE_NUM_MSGS 25
+#define GROUNDSTATION_BUDGET_BPS (64000UL / 10 / 2 * 80 / 100)
+#define GROUNDSTATION_BUDGET_PER_TIMESTEP (UART1_BUFFER_SIZE / 4)
+// The radio link uses MAVLink 2 framing, which trims trailing zeros off payloads whenever that makes a
+// frame shorter. Set this to 1 for groundstations that only understand MAVLink 1.
+#define GROUNDSTATION_MAVLINK_VERSION 2
 static uint8_t groundstationMavlinkScheduleIds[GROUNDSTATION_SCHEDULE_NUM_MSGS] = {
 	MAVLINK_MSG_ID_HEARTBEAT,
 	MAVLINK_MSG_ID_SYS_STATUS,
@@ -249,23 +341,48 @@ static uint8_t groundstationMavlinkScheduleIds[GROUNDSTATION_SCHEDULE_NUM_MSGS]
 	MAVLINK_MSG_ID_TOKIMEC,
 	MAVLINK_MSG_ID_RADIO_STATUS,
 	MAVLINK_MSG_ID_VFR_HUD,
-	MAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT
+	MAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT,
+	MAVLINK_MSG_ID_LINK_STATS,
+	MAVLINK_MSG_ID_CAN_BUS_STATS,
+	MAVLINK_MSG_ID_CAN_TRAFFIC,
+	MAVLINK_MSG_ID_MISSION_COUNT,
+	MAVLINK_MSG_ID_MISSION_ITEM,
+	MAVLINK_MSG_ID_MISSION_REQUEST,
+	MAVLINK_MSG_ID_MISSION_ACK
 };
-static uint16_t groundstationMavlinkScheduleTSteps[GROUNDSTATION_SCHEDULE_NUM_MSGS][2][8] = {};
+static uint8_t  groundstationMavlinkScheduleTimestepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+static uint16_t groundstationMavlinkScheduleTimestepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+static MessageScheduleSlot groundstationMavlinkScheduleSlots[GROUNDSTATION_SCHEDULE_NUM_MSGS] = {};
 static uint8_t  groundstationMavlinkScheduleSizes[GROUNDSTATION_SCHEDULE_NUM_MSGS];
 static MessageSchedule groundstationMavlinkSchedule = {
 	GROUNDSTATION_SCHEDULE_NUM_MSGS,
 	groundstationMavlinkScheduleIds,
 	groundstationMavlinkScheduleSizes,
 	0,
-	groundstationMavlinkScheduleTSteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	groundstationMavlinkScheduleTimestepLists,
+	groundstationMavlinkScheduleTimestepBytes,
+	groundstationMavlinkScheduleSlots
 };
 
-// Specify how many times each parameter should be transmit to the datalogger for reference.
+// Specify how many times the parameter table should be transmit to the datalogger for reference.
 #define DATALOGGER_PARAM_TRANSMIT_COUNT 2
 
-// Set up the message scheduler for MAVLink transmission to the datalogger
+// Set up the message scheduler for MAVLink transmission to the datalogger. No single timestep may
+// queue more than a quarter of the transmit buffer.
 #define DATALOGGER_SCHEDULE_NUM_MSGS 9
+#define DATALOGGER_BUDGET_BPS (115200UL / 10 * 90 / 100)
+#define DATALOGGER_BUDGET_PER_TIMESTEP (UART2_BUFFER_SIZE / 4)
+// CONTROLLER_DATA is logged as a compact log stream (see LogStream.h) in between the MAVLink
+// frames, with a keyframe every second. Decode captures with Scripts/C/LogDecode.c. Set this to 0
+// to log it as a regular MAVLink message instead.
+#define DATALOGGER_COMPACT_LOG 1
+#define DATALOGGER_LOG_KEYFRAME_INTERVAL 100
+// The schedule budgets log frames at this size. That's the typical size with some margin, as most
+// fields barely change between samples. Keyframes are larger but rare enough for the transmit
+// buffer to absorb.
+#define DATALOGGER_LOG_FRAME_BUDGET 40
 static uint8_t dataloggerMavlinkScheduleIds[DATALOGGER_SCHEDULE_NUM_MSGS] = {
 	MAVLINK_MSG_ID_HEARTBEAT,
 	MAVLINK_MSG_ID_SYS_STATUS,
@@ -277,16 +394,59 @@ static uint8_t dataloggerMavlinkScheduleIds[DATALOGGER_SCHEDULE_NUM_MSGS] = {
     MAVLINK_MSG_ID_GPS_RAW_INT,
     MAVLINK_MSG_ID_MAIN_POWER
 };
-static uint16_t dataloggerMavlinkScheduleTSteps[DATALOGGER_SCHEDULE_NUM_MSGS][2][8] = {};
+static uint8_t  dataloggerMavlinkScheduleTimestepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+static uint16_t dataloggerMavlinkScheduleTimestepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+static MessageScheduleSlot dataloggerMavlinkScheduleSlots[DATALOGGER_SCHEDULE_NUM_MSGS] = {};
 static uint8_t  dataloggerMavlinkScheduleSizes[DATALOGGER_SCHEDULE_NUM_MSGS];
 static MessageSchedule dataloggerMavlinkSchedule = {
 	DATALOGGER_SCHEDULE_NUM_MSGS,
 	dataloggerMavlinkScheduleIds,
 	dataloggerMavlinkScheduleSizes,
 	0,
-	dataloggerMavlinkScheduleTSteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	dataloggerMavlinkScheduleTimestepLists,
+	dataloggerMavlinkScheduleTimestepBytes,
+	dataloggerMavlinkScheduleSlots
 };
 
+// Replies to the mission protocol are sent to the groundstation as urgent messages, so that they go
+// out with the next timestep and displace telemetry if there's no room for them. The HEARTBEAT
+// shares their priority so that it's never displaced.
+#define MAVLINK_REPLY_PRIORITY 1
+#define MAVLINK_REPLY_DEADLINE 10
+
+// The arguments of the replies waiting to be sent by MavLinkTransmitGroundstation(). Only one of
+// every kind can be waiting at once, and `pending` has a REPLY_* bit set for every one that is.
+enum {
+	REPLY_MISSION_COUNT   = 0x01,
+	REPLY_MISSION_ITEM    = 0x02,
+	REPLY_MISSION_REQUEST = 0x04,
+	REPLY_MISSION_ACK     = 0x08
+};
+static struct {
+	uint8_t pending;
+	uint8_t missionItemIndex;
+	uint8_t missionRequestIndex;
+	uint8_t missionAckType;
+} pendingReplies;
+
+// Every received and transmitted message is handled through one of these dispatch tables, which
+// also keep statistics for every message. They're populated by MavLinkInitDispatch().
+#define RECEIVE_DISPATCH_SLOTS 14
+static MavlinkDispatchSlot receiveDispatchSlots[RECEIVE_DISPATCH_SLOTS];
+static MavlinkDispatchTable receiveDispatch = {.Slots = receiveDispatchSlots, .SlotCount = RECEIVE_DISPATCH_SLOTS};
+static MavlinkDispatchSlot groundstationDispatchSlots[GROUNDSTATION_SCHEDULE_NUM_MSGS];
+static MavlinkDispatchTable groundstationDispatch = {.Slots = groundstationDispatchSlots, .SlotCount = GROUNDSTATION_SCHEDULE_NUM_MSGS};
+static MavlinkDispatchSlot dataloggerDispatchSlots[DATALOGGER_SCHEDULE_NUM_MSGS];
+static MavlinkDispatchTable dataloggerDispatch = {.Slots = dataloggerDispatchSlots, .SlotCount = DATALOGGER_SCHEDULE_NUM_MSGS};
+
+#if DATALOGGER_COMPACT_LOG
+static const mavlink_message_info_t controllerDataInfo = MAVLINK_MESSAGE_INFO_CONTROLLER_DATA;
+static LogSchema controllerDataSchema;
+static LogEncoder controllerDataEncoder;
+#endif
+
 void MavLinkSendMissionCount(void);
 void MavLinkSendMissionItem(uint8_t currentMissionIndex);
 void MavLinkSendMissionRequest(uint8_t currentMissionIndex);
@@ -302,8 +462,16 @@ void MavLinkSendAttitude(void);
 void MavLinkSendSystemTime(uint8_t channel);
 void MavLinkSendVfrHud(void);
 void MavLinkSendParamValue(uint16_t id);
+void MavLinkQueueMissionCount(void);
+void MavLinkQueueMissionItem(uint8_t currentMissionIndex);
+void MavLinkQueueMissionRequest(uint8_t currentMissionIndex);
+void MavLinkQueueMissionAck(uint8_t type);
 int MavLinkAppendMission(const mavlink_mission_item_t *mission, const float refNED[3]);
-void MavLinkSendDataloggerParameters(bool reset);
+void MavLinkSendDataloggerParameter(uint16_t id);
+void MavLinkSendLinkStats(void);
+void MavLinkSendCanBusStats(void);
+void MavLinkSendCanTraffic(void);
+static void MavLinkInitDispatch(void);
 
 /**
  * Inverse of MATLAB's lla2ltp.
@@ -325,33 +493,76 @@ void MavLinkInit(void)
 {
     const uint8_t const mavMessageSizes[] = MAVLINK_MESSAGE_LENGTHS;
 
-    // First initialize the MessageSchedule struct with the proper sizes.
+    MavlinkReceiverInit(&groundstationReceiver);
+    LinkStatsInit(&groundstationLinkStats, MSCHED_DEFAULT_TIMESTEP_RATE);
+    LinkStatsInit(&dataloggerLinkStats, MSCHED_DEFAULT_TIMESTEP_RATE);
+    MavLinkInitDispatch();
+    MissionTransferInit(&missionTransfer);
+#if GROUNDSTATION_BATCHING
+    MavlinkBatchInit(&groundstationBatch, MAVLINK_CHAN_GROUNDSTATION, mavlink_system.sysid, mavlink_system.compid);
+#endif
+
+    {
+        uint8_t i;
+        for (i = 0; i < TELEMETRY_FILTER_COUNT; ++i) {
+            if (!ChangeFilterInit(&groundstationFilters[i], telemetryFilterConfigs[i].Info, telemetryFilterConfigs[i].Deadbands,
+                                  TELEMETRY_FILTER_MAX_INTERVAL)) {
+                FATAL_ERROR();
+            }
+        }
+    }
+
+    // Parameter messages are sized as MAVLink 1 frames, which is an upper bound for MAVLink 2 ones.
+    // The datalogger records every parameter at startup.
+    ParamStreamInit(&groundstationParamStream, PARAMETERS_TOTAL, MAVLINK_MSG_ID_PARAM_VALUE_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES,
+                    MSCHED_DEFAULT_TIMESTEP_RATE, GROUNDSTATION_PARAM_BURST);
+    ParamStreamInit(&dataloggerParamStream, PARAMETERS_TOTAL, MAVLINK_MSG_ID_PARAM_VALUE_WITH_TIME_LEN + MAVLINK_NUM_NON_PAYLOAD_BYTES,
+                    MSCHED_DEFAULT_TIMESTEP_RATE, DATALOGGER_PARAM_BURST);
+    ParamStreamRequestAll(&dataloggerParamStream, DATALOGGER_PARAM_TRANSMIT_COUNT);
+
+#if DATALOGGER_COMPACT_LOG
+    if (!LogSchemaInit(&controllerDataSchema, MAVLINK_MSG_ID_CONTROLLER_DATA, &controllerDataInfo)) {
+        FATAL_ERROR();
+    }
+    LogEncoderInit(&controllerDataEncoder, &controllerDataSchema, DATALOGGER_LOG_KEYFRAME_INTERVAL);
+#endif
+
+    // Only the groundstation link switches versions. The datalogger's regular messages stay MAVLink 1
+    // frames, but with DATALOGGER_COMPACT_LOG its CONTROLLER_DATA goes out as compact log frames in
+    // between them, which only Scripts/C/LogDecode.c understands.
+    mavlink_set_proto_version(MAVLINK_CHAN_GROUNDSTATION, GROUNDSTATION_MAVLINK_VERSION);
+
+    // First initialize the MessageSchedule struct with the proper sizes. These include the MAVLink
+    // framing so they match the bytes actually sent. MAVLink 2 frames are only used when they're
+    // shorter, so the MAVLink 1 sizes are an upper bound for either version.
     {
         int i;
         for (i = 0; i < GROUNDSTATION_SCHEDULE_NUM_MSGS; ++i) {
-            groundstationMavlinkSchedule.MessageSizes[i] = mavMessageSizes[groundstationMavlinkScheduleIds[i]];
+            groundstationMavlinkSchedule.MessageSizes[i] = mavMessageSizes[groundstationMavlinkScheduleIds[i]] + MAVLINK_NUM_NON_PAYLOAD_BYTES;
         }
 
+        // Make sure that we never exceed the total number of bytes/s available on this connection.
+        // While we're connecting at 115200, we expect the airspeed of the radios to be 64kbps.
+        // Additionally, ECC should be turned on, so that halves that data rate. And I don't want to
+        // exceed 80% of that total bandwidth. This makes sure we have space for transient messages like
+        // missions, parameters, or waypoint/state changes.
+        SetScheduleBudget(&groundstationMavlinkSchedule, GROUNDSTATION_BUDGET_BPS, GROUNDSTATION_BUDGET_PER_TIMESTEP);
+
         // We only report things that the GUI needs at 2Hz because it only updates at 1 or 2Hz.
         // We output the VFR_HUD message at a fast 5Hz because it has the throttle value and that's
-        // nice to have quick response to.
-        const uint8_t const periodicities[GROUNDSTATION_SCHEDULE_NUM_MSGS] = {2, 2, 1, 5, 4, 4, 1, 1, 1, 1, 2, 0, 1, 1, 1, 0, 5, 2};
+        // nice to have quick response to. Messages may be downgraded to fit the budget, but every
+        // one of them needs to be sent. The mission and parameter replies are only sent on request.
+        const uint8_t const periodicities[GROUNDSTATION_SCHEDULE_NUM_MSGS] = {2, 2, 1, 5, 4, 4, 1, 1, 1, 1, 2, 0, 1, 1, 1, 0, 5, 2, 2, 1, 2, 0, 0, 0, 0};
+        SetMessagePriority(&groundstationMavlinkSchedule, MAVLINK_MSG_ID_HEARTBEAT, MAVLINK_REPLY_PRIORITY);
         for (i = 0; i < GROUNDSTATION_SCHEDULE_NUM_MSGS; ++i) {
             if (periodicities[i] && !AddMessageRepeating(&groundstationMavlinkSchedule, groundstationMavlinkScheduleIds[i], periodicities[i])) {
                 FATAL_ERROR();
             }
         }
 
-        // Make sure that we haven't exceeded the total number of bytes/s available on this connection.
-        // While we're connecting at 115200, we expect the airspeed of the radios to be 64kbps.
-        // Additionally, ECC should be turned on, so that halves that data rate. And I don't want to
-        // exceed 80% of that total bandwidth. This makes sure we have space for transient messages like
-        // missions, parameters, or waypoint/state changes.
         uint32_t bps = GetBps(&groundstationMavlinkSchedule);
         groundstationChanUsage = (uint8_t)(((float)bps / (64000.0f / 10.0f / 2.0f)) * 100);
-        if (groundstationChanUsage > 80) {
-            FATAL_ERROR();
-        }
+        LinkStatsSetScheduledRate(&groundstationLinkStats, bps);
     }
 
     // Initialize the MAVLink message scheduler for the datalogger
@@ -359,9 +570,20 @@ void MavLinkInit(void)
 	// First initialize the MessageSchedule struct with the proper sizes.
 	int i;
 	for (i = 0; i < DATALOGGER_SCHEDULE_NUM_MSGS; ++i) {
-            dataloggerMavlinkSchedule.MessageSizes[i] = mavMessageSizes[dataloggerMavlinkScheduleIds[i]];
+            dataloggerMavlinkSchedule.MessageSizes[i] = mavMessageSizes[dataloggerMavlinkScheduleIds[i]] + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+#if DATALOGGER_COMPACT_LOG
+            if (dataloggerMavlinkScheduleIds[i] == MAVLINK_MSG_ID_CONTROLLER_DATA) {
+                dataloggerMavlinkSchedule.MessageSizes[i] = DATALOGGER_LOG_FRAME_BUDGET;
+            }
+#endif
 	}
 
+        // Make sure that we never exceed the total number of bytes/s available on this connection.
+        // We're connecting at 115200, with all bandwidth available to us, almost all are scheduled.
+        // Every so often some SEASLUG_PARAMETER messages will be sent, so if we don't exceed 90%,
+        // it'll be fine.
+        SetScheduleBudget(&dataloggerMavlinkSchedule, DATALOGGER_BUDGET_BPS, DATALOGGER_BUDGET_PER_TIMESTEP);
+
         // We want the HEARTBEAT/SYS_STATUS messages so this stream can be used with QGC. And then
         // for datalogging having the status of all nodes at 5Hz + the controller's input/output at
         // 100Hz is awesome.
@@ -372,13 +594,18 @@ void MavLinkInit(void)
             }
         }
 
-        // Make sure that we haven't exceeded the total number of bytes/s available on this connection.
-        // We're connecting at 115200, with all bandwidth available to us, almost all are scheduled.
-        // Every so often some SEASLUG_PARAMETER messages will be sent, so if we don't exceed 90%,
-        // it'll be fine.
         uint32_t bps = GetBps(&dataloggerMavlinkSchedule);
         dataloggerChanUsage = (uint8_t)(((float)bps / (115200.0f / 10.0f)) * 100);
-        if (dataloggerChanUsage > 90) {
+        LinkStatsSetScheduledRate(&dataloggerLinkStats, bps);
+    }
+
+    // Both schedules are dispatched from the same 100Hz loop, but each placed its messages without
+    // knowing about the other. So spread their messages out together to keep the worst-case work
+    // done in any one timestep down.
+    {
+        MessageSchedule *const schedules[] = {&groundstationMavlinkSchedule, &dataloggerMavlinkSchedule};
+        uint16_t load[MSCHED_DEFAULT_TIMESTEPS];
+        if (!BalanceSchedules(schedules, sizeof(schedules) / sizeof(schedules[0]), load)) {
             FATAL_ERROR();
         }
     }
@@ -441,20 +668,14 @@ void MavLinkSendHeartbeat(uint8_t channel)
         mavlink_system.custom_mode = (((uint32_t)nodeStatus) << 16) | (uint32_t)nodeErrors;
 
 	// Pack the message
-	mavlink_msg_heartbeat_pack_chan(mavlink_system.sysid, mavlink_system.compid, channel,
-            &txMessage,
-            mavlink_system.type, mavlink_system.autopilot, mavlink_system.mode,
-            mavlink_system.custom_mode, mavlink_system.state);
-
-	// Copy the message to the send buffer
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-        // Send to the correct channel
-        if (channel == MAVLINK_CHAN_DATALOGGER) {
-            Uart2WriteData(buf, (uint8_t)len);
-        } else {
-            Uart1WriteData(buf, (uint8_t)len);
-        }
+	mavlink_heartbeat_t heartbeat = {
+		.type = mavlink_system.type,
+		.autopilot = mavlink_system.autopilot,
+		.base_mode = mavlink_system.mode,
+		.custom_mode = mavlink_system.custom_mode,
+		.system_status = mavlink_system.state
+	};
+	MAVLINK_TRANSMIT(channel, HEARTBEAT, &heartbeat);
 }
 
 /**
@@ -465,18 +686,11 @@ void MavLinkSendHeartbeat(uint8_t channel)
 void MavLinkSendSystemTime(uint8_t channel)
 {
     // Pack the message
-    mavlink_msg_system_time_pack_chan(mavlink_system.sysid, mavlink_system.compid, channel,
-        &txMessage, dateTimeDataStore.usecSinceEpoch, nodeSystemTime*10);
-
-    // Copy the message to the send buffer
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    // Send to the correct channel
-    if (channel == MAVLINK_CHAN_DATALOGGER) {
-        Uart2WriteData(buf, (uint8_t)len);
-    } else {
-        Uart1WriteData(buf, (uint8_t)len);
-    }
+    mavlink_system_time_t systemTime = {
+        .time_unix_usec = dateTimeDataStore.usecSinceEpoch,
+        .time_boot_ms = nodeSystemTime*10
+    };
+    MAVLINK_TRANSMIT(channel, SYSTEM_TIME, &systemTime);
 }
 
 /**
@@ -532,66 +746,80 @@ void MavLinkSendStatus(uint8_t channel)
         uint8_t ecanTxErrorCount, ecanRxErrorCount;
         Ecan1GetErrorCounts(&ecanTxErrorCount, &ecanRxErrorCount);
 
-	mavlink_msg_sys_status_pack_chan(mavlink_system.sysid, mavlink_system.compid, channel,
-            &txMessage,
-            systemsPresent, systemsEnabled, systemsActive,
-            (uint16_t)(nodeCpuLoad)*10,
-            voltage, amperage, -1,
-            dropRate, mavLinkMessagesFailedParsing,
-            ecanTxErrorCount, ecanRxErrorCount, 0, 0);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-        if (channel == MAVLINK_CHAN_DATALOGGER) {
-            Uart2WriteData(buf, (uint8_t)len);
-        } else {
-            Uart1WriteData(buf, (uint8_t)len);
-        }
+	mavlink_sys_status_t sysStatus = {
+		.onboard_control_sensors_present = systemsPresent,
+		.onboard_control_sensors_enabled = systemsEnabled,
+		.onboard_control_sensors_health = systemsActive,
+		.load = (uint16_t)(nodeCpuLoad)*10,
+		.voltage_battery = voltage,
+		.current_battery = amperage,
+		.battery_remaining = -1,
+		.drop_rate_comm = dropRate,
+		.errors_comm = mavLinkMessagesFailedParsing,
+		.errors_count1 = ecanTxErrorCount,
+		.errors_count2 = ecanRxErrorCount,
+		.errors_count3 = 0,
+		.errors_count4 = 0
+	};
+	MAVLINK_TRANSMIT(channel, SYS_STATUS, &sysStatus);
 }
 
 void MavLinkSendStatusText(enum MAV_SEVERITY severity, const char *text)
 {
-	char msgText[MAVLINK_MSG_ID_STATUSTEXT_LEN] = {};
-	strncpy(msgText, text, MAVLINK_MSG_STATUSTEXT_FIELD_TEXT_LEN);
-	mavlink_msg_statustext_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage, severity, msgText);
-
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_statustext_t statustext = {
+		.severity = severity
+	};
+	strncpy(statustext.text, text, MAVLINK_MSG_STATUSTEXT_FIELD_TEXT_LEN);
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, STATUSTEXT, &statustext);
 }
 
 void MavLinkSendTokimec(void)
 {
-    mavlink_msg_tokimec_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-        tokimecDataStore.yaw, tokimecDataStore.pitch, tokimecDataStore.roll,
-        tokimecDataStore.x_angle_vel, tokimecDataStore.y_angle_vel, tokimecDataStore.z_angle_vel,
-        tokimecDataStore.x_accel, tokimecDataStore.y_accel, tokimecDataStore.z_accel,
-        tokimecDataStore.magneticBearing,
-        tokimecDataStore.latitude, tokimecDataStore.longitude,
-        tokimecDataStore.est_latitude, tokimecDataStore.est_longitude,
-        tokimecDataStore.gpsDirection, tokimecDataStore.gpsSpeed,
-        tokimecDataStore.status);
-
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    Uart1WriteData(buf, (uint8_t)len);
+    mavlink_tokimec_t tokimec = {
+        .yaw = tokimecDataStore.yaw,
+        .pitch = tokimecDataStore.pitch,
+        .roll = tokimecDataStore.roll,
+        .x_angle_vel = tokimecDataStore.x_angle_vel,
+        .y_angle_vel = tokimecDataStore.y_angle_vel,
+        .z_angle_vel = tokimecDataStore.z_angle_vel,
+        .x_accel = tokimecDataStore.x_accel,
+        .y_accel = tokimecDataStore.y_accel,
+        .z_accel = tokimecDataStore.z_accel,
+        .mag_bearing = tokimecDataStore.magneticBearing,
+        .latitude = tokimecDataStore.latitude,
+        .longitude = tokimecDataStore.longitude,
+        .est_latitude = tokimecDataStore.est_latitude,
+        .est_longitude = tokimecDataStore.est_longitude,
+        .gps_heading = tokimecDataStore.gpsDirection,
+        .gps_speed = tokimecDataStore.gpsSpeed,
+        .status = tokimecDataStore.status
+    };
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, TOKIMEC, &tokimec);
 }
 
 void MavLinkSendTokimecWithTime(void)
 {
-    mavlink_msg_tokimec_with_time_pack_chan(mavlink_system.sysid, mavlink_system.compid, MAVLINK_CHAN_DATALOGGER, &txMessage,
-        nodeSystemTime*10,
-        tokimecDataStore.yaw, tokimecDataStore.pitch, tokimecDataStore.roll,
-        tokimecDataStore.x_angle_vel, tokimecDataStore.y_angle_vel, tokimecDataStore.z_angle_vel,
-        tokimecDataStore.x_accel, tokimecDataStore.y_accel, tokimecDataStore.z_accel,
-        tokimecDataStore.magneticBearing,
-        tokimecDataStore.latitude, tokimecDataStore.longitude,
-        tokimecDataStore.est_latitude, tokimecDataStore.est_longitude,
-        tokimecDataStore.gpsDirection, tokimecDataStore.gpsSpeed,
-        tokimecDataStore.status);
-
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    Uart2WriteData(buf, (uint8_t)len);
+    mavlink_tokimec_with_time_t tokimecWithTime = {
+        .time_boot_ms = nodeSystemTime*10,
+        .yaw = tokimecDataStore.yaw,
+        .pitch = tokimecDataStore.pitch,
+        .roll = tokimecDataStore.roll,
+        .x_angle_vel = tokimecDataStore.x_angle_vel,
+        .y_angle_vel = tokimecDataStore.y_angle_vel,
+        .z_angle_vel = tokimecDataStore.z_angle_vel,
+        .x_accel = tokimecDataStore.x_accel,
+        .y_accel = tokimecDataStore.y_accel,
+        .z_accel = tokimecDataStore.z_accel,
+        .mag_bearing = tokimecDataStore.magneticBearing,
+        .latitude = tokimecDataStore.latitude,
+        .longitude = tokimecDataStore.longitude,
+        .est_latitude = tokimecDataStore.est_latitude,
+        .est_longitude = tokimecDataStore.est_longitude,
+        .gps_heading = tokimecDataStore.gpsDirection,
+        .gps_speed = tokimecDataStore.gpsSpeed,
+        .status = tokimecDataStore.status
+    };
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_DATALOGGER, TOKIMEC_WITH_TIME, &tokimecWithTime);
 }
 
 /**
@@ -603,25 +831,20 @@ void MavLinkSendVfrHud(void)
     float actRudderCommand;
     int16_t actThrottleCommand;
     GetCurrentActuatorCommands(&actRudderCommand, &actThrottleCommand);
-    mavlink_msg_vfr_hud_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-        waterDataStore.speed, gpsDataStore.sog / 100.0,
-        (uint16_t)((float)tokimecDataStore.yaw / 8192.0),
-        (uint16_t)(fabs(actThrottleCommand / 1023.0) * 100),
-        gpsDataStore.altitude / 1000000.0,
-        0);
-
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    Uart1WriteData(buf, (uint8_t)len);
+    mavlink_vfr_hud_t vfrHud = {
+        .airspeed = waterDataStore.speed,
+        .groundspeed = gpsDataStore.sog / 100.0,
+        .heading = (uint16_t)((float)tokimecDataStore.yaw / 8192.0),
+        .throttle = (uint16_t)(fabs(actThrottleCommand / 1023.0) * 100),
+        .alt = gpsDataStore.altitude / 1000000.0,
+        .climb = 0
+    };
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, VFR_HUD, &vfrHud);
 }
 
 void MavLinkSendRadioStatus(void)
 {
-    mavlink_msg_radio_status_encode(mavlink_system.sysid, mavlink_system.compid, &txMessage, &radioStatus);
-
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    Uart1WriteData(buf, (uint8_t)len);
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, RADIO_STATUS, &radioStatus);
 }
 
 /**
@@ -638,22 +861,19 @@ void MavLinkSendRawGps(uint8_t channel)
 	//    1        |   2      | 2D fix
 	uint8_t mavlinkGpsMode = gpsDataStore.mode == 2?3:(gpsDataStore.mode == 1?2:0);
 
-	mavlink_msg_gps_raw_int_pack_chan(mavlink_system.sysid, mavlink_system.compid, channel,
-        &txMessage,
-        ((uint64_t)nodeSystemTime)*10000,
-		mavlinkGpsMode, gpsDataStore.latitude, gpsDataStore.longitude,
-        gpsDataStore.altitude, // FIXME: Convert this value to AMSL.
-		gpsDataStore.hdop, gpsDataStore.vdop,
-		gpsDataStore.sog, (uint16_t)(((float)gpsDataStore.cog) * 180 / M_PI / 100),
-		gpsDataStore.satellites);
-
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    if (channel == MAVLINK_CHAN_DATALOGGER) {
-        Uart2WriteData(buf, (uint8_t)len);
-    } else {
-        Uart1WriteData(buf, (uint8_t)len);
-    }
+	mavlink_gps_raw_int_t gpsRawInt = {
+		.time_usec = ((uint64_t)nodeSystemTime)*10000,
+		.fix_type = mavlinkGpsMode,
+		.lat = gpsDataStore.latitude,
+		.lon = gpsDataStore.longitude,
+		.alt = gpsDataStore.altitude, // FIXME: Convert this value to AMSL.
+		.eph = gpsDataStore.hdop,
+		.epv = gpsDataStore.vdop,
+		.vel = gpsDataStore.sog,
+		.cog = (uint16_t)(((float)gpsDataStore.cog) * 180 / M_PI / 100),
+		.satellites_visible = gpsDataStore.satellites
+	};
+	MAVLINK_TRANSMIT(channel, GPS_RAW_INT, &gpsRawInt);
 }
 
 /**
@@ -661,19 +881,15 @@ void MavLinkSendRawGps(uint8_t channel)
   */
 void MavLinkSendMainPower(uint8_t channel)
 {
-    mavlink_msg_main_power_pack_chan(mavlink_system.sysid, mavlink_system.compid, channel,
-        &txMessage,
-        (uint16_t)(GetPowerRailVoltage() * 1000.0f), (uint16_t)(GetPowerRailCurrent() * 1000.0f),
-        (uint16_t)(powerDataStore.voltage * 1000.0f), (uint16_t)(powerDataStore.current * 1000.0f),
-        solarDataStore.voltage, solarDataStore.current);
-
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    if (channel == MAVLINK_CHAN_DATALOGGER) {
-        Uart2WriteData(buf, (uint8_t)len);
-    } else {
-        Uart1WriteData(buf, (uint8_t)len);
-    }
+    mavlink_main_power_t mainPower = {
+        .electronics_voltage = (uint16_t)(GetPowerRailVoltage() * 1000.0f),
+        .electronics_current = (uint16_t)(GetPowerRailCurrent() * 1000.0f),
+        .actuator_voltage = (uint16_t)(powerDataStore.voltage * 1000.0f),
+        .actuator_current = (uint16_t)(powerDataStore.current * 1000.0f),
+        .solar_voltage = solarDataStore.voltage,
+        .solar_current = solarDataStore.current
+    };
+    MAVLINK_TRANSMIT_CHANGED(channel, MAIN_POWER, &mainPower);
 }
 
 /**
@@ -685,20 +901,22 @@ void MavLinkSendBasicState2(void)
     float actRudderAngleCommand;
     int16_t actThrottleCommand;
     GetCurrentActuatorCommands(&actRudderAngleCommand, &actThrottleCommand);
-    mavlink_msg_basic_state2_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-        currentCommands.autonomousRudderCommand, currentCommands.primaryManualRudderCommand, currentCommands.secondaryManualRudderCommand,
-        actRudderAngleCommand,
-        rudderSensorData.RudderAngle,
-        currentCommands.autonomousThrottleCommand, currentCommands.primaryManualThrottleCommand, currentCommands.secondaryManualThrottleCommand,
-        actThrottleCommand,
-        0,
-        controllerVars.Acmd,
-        controllerVars.L2Vector[0], controllerVars.L2Vector[1]
-    );
-
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    Uart1WriteData(buf, (uint8_t)len);
+    mavlink_basic_state2_t basicState2 = {
+        .commanded_auto_rudder_angle = currentCommands.autonomousRudderCommand,
+        .commanded_primary_rudder_angle = currentCommands.primaryManualRudderCommand,
+        .commanded_secondary_rudder_angle = currentCommands.secondaryManualRudderCommand,
+        .commanded_rudder_angle = actRudderAngleCommand,
+        .rudder_angle = rudderSensorData.RudderAngle,
+        .commanded_auto_throttle = currentCommands.autonomousThrottleCommand,
+        .commanded_primary_throttle = currentCommands.primaryManualThrottleCommand,
+        .commanded_secondary_throttle = currentCommands.secondaryManualThrottleCommand,
+        .commanded_throttle = actThrottleCommand,
+        .prop_speed = 0,
+        .a_cmd = controllerVars.Acmd,
+        .L2_north = controllerVars.L2Vector[0],
+        .L2_east = controllerVars.L2Vector[1]
+    };
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, BASIC_STATE2, &basicState2);
 }
 
 /**
@@ -707,11 +925,10 @@ void MavLinkSendBasicState2(void)
  */
 void MavLinkSendDsp3000(void)
 {
-	mavlink_msg_dsp3000_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage, gyroDataStore.zRate);
-
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_dsp3000_t dsp3000 = {
+		.z_rate = gyroDataStore.zRate
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, DSP3000, &dsp3000);
 }
 
 /**
@@ -727,14 +944,16 @@ void MavLinkSendAttitude(void)
         float rollRate = (float)tokimecDataStore.x_angle_vel / 4096.0;
         float pitchRate = (float)tokimecDataStore.y_angle_vel / 4096.0;
         float yawRate = (float)tokimecDataStore.z_angle_vel / 4096.0;
-	mavlink_msg_attitude_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                          nodeSystemTime*10,
-                                  roll, pitch, yaw,
-                                  rollRate, pitchRate, yawRate);
-
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_attitude_t attitude = {
+		.time_boot_ms = nodeSystemTime*10,
+		.roll = roll,
+		.pitch = pitch,
+		.yaw = yaw,
+		.rollspeed = rollRate,
+		.pitchspeed = pitchRate,
+		.yawspeed = yawRate
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, ATTITUDE, &attitude);
 }
 
 /**
@@ -743,14 +962,16 @@ void MavLinkSendAttitude(void)
  */
 void MavLinkSendLocalPosition(void)
 {
-	mavlink_msg_local_position_ned_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                                    nodeSystemTime*10,
-	                                    controllerVars.LocalPosition[0], controllerVars.LocalPosition[1], NAN,
-	                                    controllerVars.Velocity[0], controllerVars.Velocity[1], NAN);
-
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_local_position_ned_t localPositionNed = {
+		.time_boot_ms = nodeSystemTime*10,
+		.x = controllerVars.LocalPosition[0],
+		.y = controllerVars.LocalPosition[1],
+		.z = NAN,
+		.vx = controllerVars.Velocity[0],
+		.vy = controllerVars.Velocity[1],
+		.vz = NAN
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, LOCAL_POSITION_NED, &localPositionNed);
 }
 
 /**
@@ -759,12 +980,12 @@ void MavLinkSendLocalPosition(void)
  */
 void MavLinkSendGpsGlobalOrigin(void)
 {
-	mavlink_msg_gps_global_origin_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                                   gpsOrigin[0], gpsOrigin[1], gpsOrigin[2]);
-
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_gps_global_origin_t gpsGlobalOrigin = {
+		.latitude = gpsOrigin[0],
+		.longitude = gpsOrigin[1],
+		.altitude = gpsOrigin[2]
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, GPS_GLOBAL_ORIGIN, &gpsGlobalOrigin);
 }
 
 /**
@@ -774,9 +995,10 @@ void MavLinkSendGpsGlobalOrigin(void)
 void MavLinkSendCurrentMission(int8_t missionIndex)
 {
     if (missionIndex != -1) {
-        mavlink_msg_mission_current_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage, (uint16_t)missionIndex);
-        len = mavlink_msg_to_send_buffer(buf, &txMessage);
-        Uart1WriteData(buf, (uint8_t)len);
+        mavlink_mission_current_t missionCurrent = {
+            .seq = (uint16_t)missionIndex
+        };
+        MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, MISSION_CURRENT, &missionCurrent);
     }
 }
 
@@ -787,10 +1009,10 @@ void MavLinkSendCurrentMission(int8_t missionIndex)
 void MavLinkSendMissionItemReached(int8_t missionIndex)
 {
     if (missionIndex != -1) {
-        mavlink_msg_mission_item_reached_pack(mavlink_system.sysid, mavlink_system.compid,
-                                              &txMessage, (uint16_t)(missionIndex));
-        len = mavlink_msg_to_send_buffer(buf, &txMessage);
-        Uart1WriteData(buf, (uint8_t)len);
+        mavlink_mission_item_reached_t missionItemReached = {
+            .seq = (uint16_t)(missionIndex)
+        };
+        MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, MISSION_ITEM_REACHED, &missionItemReached);
     }
 }
 
@@ -800,10 +1022,12 @@ void MavLinkSendMissionItemReached(int8_t missionIndex)
  */
 void MavLinkSendMissionAck(uint8_t type)
 {
-	mavlink_msg_mission_ack_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                             groundStationSystemId, groundStationComponentId, type);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_mission_ack_t missionAck = {
+		.target_system = groundStationSystemId,
+		.target_component = groundStationComponentId,
+		.type = type
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, MISSION_ACK, &missionAck);
 }
 
 /**
@@ -812,10 +1036,11 @@ void MavLinkSendMissionAck(uint8_t type)
  */
 void MavLinkSendCommandAck(uint8_t command, uint8_t result)
 {
-	mavlink_msg_command_ack_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                             command, result);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_command_ack_t commandAck = {
+		.command = command,
+		.result = result
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, COMMAND_ACK, &commandAck);
 }
 
 /**
@@ -840,42 +1065,60 @@ void MavLinkSendControllerData(const ImuData *imu, const GpsData *gps, float wat
     float actRudderAngleCommand;
     int16_t actThrottleCommand;
     GetCurrentActuatorCommands(&actRudderAngleCommand, &actThrottleCommand);
-    mavlink_msg_controller_data_pack_chan(
-        mavlink_system.sysid, mavlink_system.compid, MAVLINK_CHAN_DATALOGGER, &txMessage,
-        controllerVars.wp0[0] * 10, controllerVars.wp0[1] * 10,
-        controllerVars.wp1[0] * 10, controllerVars.wp1[1] * 10,
-        imu->attitude[0] * 8192.0, imu->attitude[1] * 8192.0, imu->attitude[2] * 8192.0,
-        imu->gyros[0] * 4096.0, imu->gyros[1] * 4096.0, imu->gyros[2] * 4096.0,
-        imu->accels[0] * 256.0, imu->accels[1] * 256.0, imu->accels[2] * 256.0,
-        waterSpeed * 1e4,
-        gps->newData, gps->latitude, gps->longitude, gps->sog, gps->cog, gps->hdop,
-        reset,
-        nodeSystemTime*10,
-        controllerVars.LocalPosition[0] * 1e3, controllerVars.LocalPosition[1] * 1e3,
-        controllerVars.Velocity[0] * 1e3, controllerVars.Velocity[1] * 1e3,
-        clampedACmd,
-        controllerVars.AimPoint[0] * 10, controllerVars.AimPoint[1] * 10,
-        controllerVars.sensedYawRate * 4096.0,
-        commandedRudder * 1e4,
-        commandedThrottle,
-        actRudderAngleCommand * 1e4,
-        actThrottleCommand,
-        rudderAngle * 1e4
-    );
-
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    Uart2WriteData(buf, (uint8_t)len);
+    mavlink_controller_data_t controllerData = {
+        .last_wp_north = controllerVars.wp0[0] * 10,
+        .last_wp_east = controllerVars.wp0[1] * 10,
+        .next_wp_north = controllerVars.wp1[0] * 10,
+        .next_wp_east = controllerVars.wp1[1] * 10,
+        .yaw = imu->attitude[0] * 8192.0,
+        .pitch = imu->attitude[1] * 8192.0,
+        .roll = imu->attitude[2] * 8192.0,
+        .x_angle_vel = imu->gyros[0] * 4096.0,
+        .y_angle_vel = imu->gyros[1] * 4096.0,
+        .z_angle_vel = imu->gyros[2] * 4096.0,
+        .x_accel = imu->accels[0] * 256.0,
+        .y_accel = imu->accels[1] * 256.0,
+        .z_accel = imu->accels[2] * 256.0,
+        .water_speed = waterSpeed * 1e4,
+        .new_gps_fix = gps->newData,
+        .lat = gps->latitude,
+        .lon = gps->longitude,
+        .sog = gps->sog,
+        .cog = gps->cog,
+        .hdop = gps->hdop,
+        .reset = reset,
+        .time_boot_ms = nodeSystemTime*10,
+        .north = controllerVars.LocalPosition[0] * 1e3,
+        .east = controllerVars.LocalPosition[1] * 1e3,
+        .north_speed = controllerVars.Velocity[0] * 1e3,
+        .east_speed = controllerVars.Velocity[1] * 1e3,
+        .a_cmd = clampedACmd,
+        .aim_point_n = controllerVars.AimPoint[0] * 10,
+        .aim_point_e = controllerVars.AimPoint[1] * 10,
+        .yaw_rate = controllerVars.sensedYawRate * 4096.0,
+        .commanded_rudder_angle = commandedRudder * 1e4,
+        .commanded_throttle = commandedThrottle,
+        .actual_commanded_rudder_angle = actRudderAngleCommand * 1e4,
+        .actual_commanded_throttle = actThrottleCommand,
+        .rudder_angle = rudderAngle * 1e4
+    };
+#if DATALOGGER_COMPACT_LOG
+    MavLinkLogToDatalogger(&controllerDataEncoder, &controllerData);
+#else
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_DATALOGGER, CONTROLLER_DATA, &controllerData);
+#endif
 }
 
 void MavLinkSendMissionCount(void)
 {
 	uint8_t missionCount;
 	GetMissionCount(&missionCount);
-	mavlink_msg_mission_count_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                               groundStationSystemId, groundStationComponentId, missionCount);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_mission_count_t count = {
+		.target_system = groundStationSystemId,
+		.target_component = groundStationComponentId,
+		.count = missionCount
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, MISSION_COUNT, &count);
 }
 
 /**
@@ -898,33 +1141,45 @@ void MavLinkSendMissionItem(uint8_t currentMissionIndex)
         // Always send the mission back in the global frame. This makes the mission viewable
         // on the main map, which doesn't support waypoints in the local frame. It should also be
         // visibile in the HSI widget.
+        mavlink_mission_item_t missionItem = {
+            .target_system = groundStationSystemId,
+            .target_component = groundStationComponentId,
+            .seq = currentMissionIndex,
+            .command = m.action,
+            .current = (currentMissionIndex == (uint8_t)missionManagerCurrentIndex),
+            .autocontinue = m.autocontinue,
+            .param1 = m.parameters[0],
+            .param2 = m.parameters[1],
+            .param3 = m.parameters[2],
+            .param4 = m.parameters[3]
+        };
         if (m.refFrame == MAV_FRAME_GLOBAL || m.refFrame == MAV_FRAME_GLOBAL_RELATIVE_ALT) {
-            mavlink_msg_mission_item_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-                                          groundStationSystemId, groundStationComponentId, currentMissionIndex,
-                                          m.refFrame, m.action, (currentMissionIndex == (uint8_t)missionManagerCurrentIndex),
-                                          m.autocontinue, m.parameters[0], m.parameters[1], m.parameters[2], m.parameters[3],
-                                          m.coordinates[0], m.coordinates[1], m.coordinates[2]);
+            missionItem.frame = m.refFrame;
+            missionItem.x = m.coordinates[0];
+            missionItem.y = m.coordinates[1];
+            missionItem.z = m.coordinates[2];
         } else if (m.refFrame == MAV_FRAME_LOCAL_NED || m.refFrame == MAV_FRAME_LOCAL_OFFSET_NED) {
-            mavlink_msg_mission_item_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-                                          groundStationSystemId, groundStationComponentId, currentMissionIndex,
-                                          MAV_FRAME_GLOBAL, m.action, (currentMissionIndex == (uint8_t)missionManagerCurrentIndex),
-                                          m.autocontinue, m.parameters[0], m.parameters[1], m.parameters[2], m.parameters[3],
-                                          m.otherCoordinates[0], m.otherCoordinates[1], m.otherCoordinates[2]);
+            missionItem.frame = MAV_FRAME_GLOBAL;
+            missionItem.x = m.otherCoordinates[0];
+            missionItem.y = m.otherCoordinates[1];
+            missionItem.z = m.otherCoordinates[2];
         } else {
             // TODO: This should be handled somehow
+            return;
         }
 
-		len = mavlink_msg_to_send_buffer(buf, &txMessage);
-		Uart1WriteData(buf, (uint8_t)len);
+        MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, MISSION_ITEM, &missionItem);
 	}
 }
 
 void MavLinkSendMissionRequest(uint8_t currentMissionIndex)
 {
-	mavlink_msg_mission_request_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                                 groundStationSystemId, groundStationComponentId, currentMissionIndex);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_mission_request_t missionRequest = {
+		.target_system = groundStationSystemId,
+		.target_component = groundStationComponentId,
+		.seq = currentMissionIndex
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, MISSION_REQUEST, &missionRequest);
 }
 
 /**
@@ -940,11 +1195,67 @@ void MavLinkSendParamValue(uint16_t id)
         ParameterGetValueById(id, &param_value);
 
         // Finally encode the message and transmit.
-        mavlink_msg_param_value_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-            onboardParameters[id].name, param_value, onboardParameters[id].dataType,
-            PARAMETERS_TOTAL, id);
-        len = mavlink_msg_to_send_buffer(buf, &txMessage);
-        Uart1WriteData(buf, (uint8_t)len);
+        mavlink_param_value_t paramValue = {
+            .param_value = param_value,
+            .param_type = onboardParameters[id].dataType,
+            .param_count = PARAMETERS_TOTAL,
+            .param_index = id
+        };
+        strncpy(paramValue.param_id, onboardParameters[id].name, MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN);
+        MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, PARAM_VALUE, &paramValue);
+    }
+}
+
+/**
+ * Schedules a reply to the groundstation as an urgent message. If one of the same kind is already
+ * waiting, or it can't be scheduled before its deadline, false is returned and it should be sent
+ * right away instead so that the protocol doesn't stall.
+ * @param flag The REPLY_* bit for this reply.
+ */
+static bool MavLinkScheduleReply(uint8_t id, uint8_t flag)
+{
+    if ((pendingReplies.pending & flag) ||
+        !AddMessageUrgent(&groundstationMavlinkSchedule, id, MAVLINK_REPLY_PRIORITY, MAVLINK_REPLY_DEADLINE)) {
+        return false;
+    }
+    pendingReplies.pending |= flag;
+    return true;
+}
+
+/**
+ * The following functions queue up replies for the mission protocol, see MavLinkScheduleReply().
+ */
+void MavLinkQueueMissionCount(void)
+{
+    if (!MavLinkScheduleReply(MAVLINK_MSG_ID_MISSION_COUNT, REPLY_MISSION_COUNT)) {
+        MavLinkSendMissionCount();
+    }
+}
+
+void MavLinkQueueMissionItem(uint8_t currentMissionIndex)
+{
+    if (MavLinkScheduleReply(MAVLINK_MSG_ID_MISSION_ITEM, REPLY_MISSION_ITEM)) {
+        pendingReplies.missionItemIndex = currentMissionIndex;
+    } else {
+        MavLinkSendMissionItem(currentMissionIndex);
+    }
+}
+
+void MavLinkQueueMissionRequest(uint8_t currentMissionIndex)
+{
+    if (MavLinkScheduleReply(MAVLINK_MSG_ID_MISSION_REQUEST, REPLY_MISSION_REQUEST)) {
+        pendingReplies.missionRequestIndex = currentMissionIndex;
+    } else {
+        MavLinkSendMissionRequest(currentMissionIndex);
+    }
+}
+
+void MavLinkQueueMissionAck(uint8_t type)
+{
+    if (MavLinkScheduleReply(MAVLINK_MSG_ID_MISSION_ACK, REPLY_MISSION_ACK)) {
+        pendingReplies.missionAckType = type;
+    } else {
+        MavLinkSendMissionAck(type);
     }
 }
 
@@ -959,106 +1270,194 @@ void MavLinkTransmitAllParameters(void)
 
 void MavLinkSendRudderRaw(void)
 {
-	mavlink_msg_rudder_raw_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-                                rudderSensorData.RudderPotValue, rudderSensorData.LimitHitPort, 0, rudderSensorData.LimitHitStarboard,
-                                rudderSensorData.RudderPotLimitPort, rudderSensorData.RudderPotLimitStarboard);
-
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_rudder_raw_t rudderRaw = {
+		.raw_position = rudderSensorData.RudderPotValue,
+		.port_limit = rudderSensorData.LimitHitPort,
+		.center_limit = 0,
+		.starboard_limit = rudderSensorData.LimitHitStarboard,
+		.port_limit_val = rudderSensorData.RudderPotLimitPort,
+		.starboard_limit_val = rudderSensorData.RudderPotLimitStarboard
+	};
+	MAVLINK_TRANSMIT_CHANGED(MAVLINK_CHAN_GROUNDSTATION, RUDDER_RAW, &rudderRaw);
 }
 
 void MavLinkSendWindAirData(void)
 {
-	mavlink_msg_wso100_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-		windDataStore.speed, windDataStore.direction,
-		airDataStore.temp, airDataStore.pressure, airDataStore.humidity);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_wso100_t wso100 = {
+		.speed = windDataStore.speed,
+		.direction = windDataStore.direction,
+		.temperature = airDataStore.temp,
+		.pressure = airDataStore.pressure,
+		.humidity = airDataStore.humidity
+	};
+	MAVLINK_TRANSMIT_CHANGED(MAVLINK_CHAN_GROUNDSTATION, WSO100, &wso100);
 }
 
 void MavLinkSendDst800Data(void)
 {
-	mavlink_msg_dst800_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                        waterDataStore.speed, waterDataStore.temp, waterDataStore.depth);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_dst800_t dst800 = {
+		.speed = waterDataStore.speed,
+		.temperature = waterDataStore.temp,
+		.depth = waterDataStore.depth
+	};
+	MAVLINK_TRANSMIT_CHANGED(MAVLINK_CHAN_GROUNDSTATION, DST800, &dst800);
 }
 
 void MavLinkSendRevoGsData(void)
 {
-	mavlink_msg_revo_gs_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-		revoGsDataStore.heading, revoGsDataStore.magStatus,
-		revoGsDataStore.pitch, revoGsDataStore.pitchStatus,
-		revoGsDataStore.roll, revoGsDataStore.rollStatus,
-		revoGsDataStore.dip, revoGsDataStore.magneticMagnitude);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_revo_gs_t revoGs = {
+		.heading = revoGsDataStore.heading,
+		.mag_status = revoGsDataStore.magStatus,
+		.pitch = revoGsDataStore.pitch,
+		.pitch_status = revoGsDataStore.pitchStatus,
+		.roll = revoGsDataStore.roll,
+		.roll_status = revoGsDataStore.rollStatus,
+		.dip = revoGsDataStore.dip,
+		.mag_horiz_comp = revoGsDataStore.magneticMagnitude
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, REVO_GS, &revoGs);
 }
 
 void MavLinkSendGps200Data(void)
 {
-	mavlink_msg_gps200_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                        gpsDataStore.variation);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_gps200_t gps200 = {
+		.magnetic_variation = gpsDataStore.variation
+	};
+	MAVLINK_TRANSMIT_CHANGED(MAVLINK_CHAN_GROUNDSTATION, GPS200, &gps200);
 }
 
 void MavLinkSendNavControllerOutput(void)
 {
-    mavlink_msg_nav_controller_output_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-            NAN, NAN, INT16_MAX, // Roll, pitch, and yaw not commanded
-            BearingToNextWaypoint(),
-            DistanceToNextWaypoint(),
-            NAN, NAN, // Altitude and airspeed not commanded
-            CrossTrackError()
-    );
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-    Uart1WriteData(buf, (uint8_t)len);
+    mavlink_nav_controller_output_t navControllerOutput = {
+        .nav_roll = NAN,
+        .nav_pitch = NAN,
+        .nav_bearing = INT16_MAX, // Roll, pitch, and yaw not commanded
+        .target_bearing = BearingToNextWaypoint(),
+        .wp_dist = DistanceToNextWaypoint(),
+        .alt_error = NAN,
+        .aspd_error = NAN, // Altitude and airspeed not commanded
+        .xtrack_error = CrossTrackError()
+    };
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, NAV_CONTROLLER_OUTPUT, &navControllerOutput);
 }
 
-void MavLinkSendNodeStatus(uint8_t channel)
+/**
+ * Transmits the statistics of one of the links to the groundstation, alternating between the
+ * groundstation and datalogger links with every call.
+ */
+void MavLinkSendLinkStats(void)
 {
-    mavlink_msg_node_status_pack_chan(mavlink_system.sysid, mavlink_system.compid, channel,
-        &txMessage,
-        nodeStatusDataStore[CAN_NODE_HIL - 1].status,
-        nodeStatusDataStore[CAN_NODE_HIL - 1].errors,
-        nodeStatusDataStore[CAN_NODE_HIL - 1].temp,
-        nodeStatusDataStore[CAN_NODE_HIL - 1].load,
-        nodeStatusDataStore[CAN_NODE_HIL - 1].voltage,
-        nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].status,
-        nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].errors,
-        nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].temp,
-        nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].load,
-        nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].voltage,
-        nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].status,
-        nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].errors,
-        nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].temp,
-        nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].load,
-        nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].voltage,
-        nodeStatus,
-        nodeErrors,
-        nodeTemp,
-        nodeCpuLoad,
-        nodeVoltage,
-        nodeStatusDataStore[CAN_NODE_RC - 1].status,
-        nodeStatusDataStore[CAN_NODE_RC - 1].errors,
-        nodeStatusDataStore[CAN_NODE_RC - 1].temp,
-        nodeStatusDataStore[CAN_NODE_RC - 1].load,
-        nodeStatusDataStore[CAN_NODE_RC - 1].voltage,
-        nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].status,
-        nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].errors,
-        nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].temp,
-        nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].load,
-        nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].voltage);
-    len = mavlink_msg_to_send_buffer(buf, &txMessage);
-
-    // Send to the correct channel
-    if (channel == MAVLINK_CHAN_DATALOGGER) {
-        Uart2WriteData(buf, (uint8_t)len);
+    static uint8_t channel = MAVLINK_CHAN_GROUNDSTATION;
+    mavlink_link_stats_t linkStats;
+    LinkStatsEncode(MavLinkGetLinkStats(channel), channel, &linkStats);
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, LINK_STATS, &linkStats);
+    channel = (channel == MAVLINK_CHAN_GROUNDSTATION) ? MAVLINK_CHAN_DATALOGGER : MAVLINK_CHAN_GROUNDSTATION;
+}
+
+/**
+ * Transmits the load of the CAN bus and the totals of its monitor to the groundstation.
+ */
+void MavLinkSendCanBusStats(void)
+{
+    CanBusMonitorTotals totals;
+    if (!Ecan1GetMonitorTotals(&totals)) {
+        return;
+    }
+    mavlink_can_bus_stats_t canBusStats = {
+        .frames = totals.Frames,
+        .untracked = totals.Untracked,
+        .bit_rate = totals.BitRate,
+        .load = totals.Load,
+        .peak_load = totals.PeakLoad,
+        .frame_rate = totals.Rate,
+        .ids = totals.Ids,
+        .drifting = totals.Drifting
+    };
+    Ecan1GetErrorCounts(&canBusStats.tx_errors, &canBusStats.rx_errors);
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, CAN_BUS_STATS, &canBusStats);
+}
+
+/**
+ * Transmits the traffic of one CAN ID, PGN, or source address to the groundstation, cycling through
+ * all the IDs and PGNs and then all the source addresses with every call.
+ */
+void MavLinkSendCanTraffic(void)
+{
+    static uint8_t next = 0;
+    CanBusMonitorTotals totals;
+    CanBusMonitorEntry e;
+    CanBusMonitorSource source;
+    mavlink_can_traffic_t canTraffic = {};
+
+    // The monitor counts frames from the ECAN1 interrupt, so it's only read through copies.
+    if (!Ecan1GetMonitorTotals(&totals)) {
+        return;
+    }
+
+    // Start over after the last source address in use.
+    if (next >= totals.Ids && !Ecan1GetMonitorSource(next - totals.Ids, &source)) {
+        next = 0;
+    }
+
+    if (next < totals.Ids && Ecan1GetMonitorEntry(next, &e)) {
+        canTraffic.id = e.Key & ~CAN_BUS_MONITOR_PGN;
+        canTraffic.type = (e.Key & CAN_BUS_MONITOR_PGN) ? 1 : 0;
+        canTraffic.frames = e.Frames;
+        canTraffic.bit_rate = e.BitRate;
+        canTraffic.rate = e.Rate;
+        // The monitor keeps rates in 1/16 Hz.
+        canTraffic.average_rate = (uint16_t)(((uint32_t)e.Average * 10 + 8) / 16);
+        canTraffic.nominal_rate = (uint16_t)(((uint32_t)e.Nominal * 10 + 8) / 16);
+        canTraffic.drifting = e.Drifting;
+    } else if (next >= totals.Ids && Ecan1GetMonitorSource(next - totals.Ids, &source)) {
+        canTraffic.id = source.Address;
+        canTraffic.type = 2;
+        canTraffic.frames = source.Frames;
+        canTraffic.bit_rate = source.BitRate;
+        canTraffic.rate = source.Rate;
     } else {
-        Uart1WriteData(buf, (uint8_t)len);
+        // Nothing to send until the bus has seen some traffic.
+        return;
     }
+    MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, CAN_TRAFFIC, &canTraffic);
+    ++next;
+}
+
+void MavLinkSendNodeStatus(uint8_t channel)
+{
+    mavlink_node_status_t status = {
+        .hil_status = nodeStatusDataStore[CAN_NODE_HIL - 1].status,
+        .hil_errors = nodeStatusDataStore[CAN_NODE_HIL - 1].errors,
+        .hil_temp = nodeStatusDataStore[CAN_NODE_HIL - 1].temp,
+        .hil_load = nodeStatusDataStore[CAN_NODE_HIL - 1].load,
+        .hil_voltage = nodeStatusDataStore[CAN_NODE_HIL - 1].voltage,
+        .imu_status = nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].status,
+        .imu_errors = nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].errors,
+        .imu_temp = nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].temp,
+        .imu_load = nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].load,
+        .imu_voltage = nodeStatusDataStore[CAN_NODE_IMU_SENSOR - 1].voltage,
+        .power_status = nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].status,
+        .power_errors = nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].errors,
+        .power_temp = nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].temp,
+        .power_load = nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].load,
+        .power_voltage = nodeStatusDataStore[CAN_NODE_POWER_SENSOR - 1].voltage,
+        .primary_status = nodeStatus,
+        .primary_errors = nodeErrors,
+        .primary_temp = nodeTemp,
+        .primary_load = nodeCpuLoad,
+        .primary_voltage = nodeVoltage,
+        .rc_status = nodeStatusDataStore[CAN_NODE_RC - 1].status,
+        .rc_errors = nodeStatusDataStore[CAN_NODE_RC - 1].errors,
+        .rc_temp = nodeStatusDataStore[CAN_NODE_RC - 1].temp,
+        .rc_load = nodeStatusDataStore[CAN_NODE_RC - 1].load,
+        .rc_voltage = nodeStatusDataStore[CAN_NODE_RC - 1].voltage,
+        .rudder_status = nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].status,
+        .rudder_errors = nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].errors,
+        .rudder_temp = nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].temp,
+        .rudder_load = nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].load,
+        .rudder_voltage = nodeStatusDataStore[CAN_NODE_RUDDER_CONTROLLER - 1].voltage
+    };
+    MAVLINK_TRANSMIT_CHANGED(channel, NODE_STATUS, &status);
 }
 
 void MavLinkSendWaypointStatusData(void)
@@ -1066,11 +1465,17 @@ void MavLinkSendWaypointStatusData(void)
     // Don't output the global waypoint coordinates anymore as that requires access to the
     // MissionManager. I actually never care about those coordinates anyways, so just pull the
     // coordinates from the controller.
-	mavlink_msg_waypoint_status_pack(mavlink_system.sysid, mavlink_system.compid, &txMessage,
-	                                 NAN, NAN, controllerVars.wp0[0], controllerVars.wp0[1],
-									 NAN, NAN, controllerVars.wp1[0], controllerVars.wp1[1]);
-	len = mavlink_msg_to_send_buffer(buf, &txMessage);
-	Uart1WriteData(buf, (uint8_t)len);
+	mavlink_waypoint_status_t waypointStatus = {
+		.last_wp_lat = NAN,
+		.last_wp_lon = NAN,
+		.last_wp_north = controllerVars.wp0[0],
+		.last_wp_east = controllerVars.wp0[1],
+		.next_wp_lat = NAN,
+		.next_wp_lon = NAN,
+		.next_wp_north = controllerVars.wp1[0],
+		.next_wp_east = controllerVars.wp1[1]
+	};
+	MAVLINK_TRANSMIT(MAVLINK_CHAN_GROUNDSTATION, WAYPOINT_STATUS, &waypointStatus);
 }
 
 void MavLinkReceiveCommandLong(const mavlink_command_long_t *msg)
@@ -1166,593 +1571,38 @@ void GetMavLinkManualControl(float *rc, int16_t *tc)
 /** Core MAVLink functions handling transmission and state machines **/
 
 /**
- *
- * @param event An event from PARAM_EVENT.
- * @param data A pointer to data, its meaning depends on the current state of the parameter protocol.
- */
-void MavLinkEvaluateParameterState(enum PARAM_EVENT event, const void *data)
-{
-	// Track the parameter protocol state
-	static uint8_t state = PARAM_STATE_INACTIVE;
-
-	// Keep a record of the current parameter being used
-	static uint16_t currentParameter;
-
-	// Store the state to change into
-	uint8_t nextState = state;
-
-	// First check the parameter protocol state
-	switch (state) {
-		case PARAM_STATE_INACTIVE:
-			if (event == PARAM_EVENT_REQUEST_LIST_RECEIVED) {
-				currentParameter = 0;
-				nextState = PARAM_STATE_STREAM_SEND_VALUE;
-			} else if (event == PARAM_EVENT_SET_RECEIVED) {
-                            // Decode the message
-                            mavlink_param_set_t *x = (mavlink_param_set_t *)data;
-
-                            // Only allow setting a parameter if we're in manual mode unless it's
-                            // the automode parameter.
-                            if (!IS_AUTONOMOUS() || strcmp(x->param_id, "ModeAuto") == 0) {
-                                currentParameter = ParameterSetValueByName(x->param_id, &x->param_value);
-                                // If there was an error, just reset.
-                                if (currentParameter == UINT16_MAX) {
-                                    currentParameter = 0;
-                                }
-                                nextState = PARAM_STATE_SINGLETON_SEND_VALUE;
-                            } else {
-                                // There no way to report errors with the parameter protocol.
-                                // See MAVLink issue #337: https://github.com/mavlink/mavlink/issues/337
-                            }
-			} else if (event == PARAM_EVENT_REQUEST_READ_RECEIVED) {
-				currentParameter = *(uint16_t*)data;
-				nextState = PARAM_STATE_SINGLETON_SEND_VALUE;
-			}
-		break;
-
-		case PARAM_STATE_SINGLETON_SEND_VALUE: {
-			if (event == PARAM_EVENT_NONE) {
-				MavLinkSendParamValue(currentParameter);
-				nextState = PARAM_STATE_INACTIVE;
-			}
-		} break;
-
-		case PARAM_STATE_STREAM_SEND_VALUE: {
-			if (event == PARAM_EVENT_NONE) {
-				MavLinkSendParamValue(currentParameter);
-
-				// And increment the current parameter index for the next iteration and
-				// we finish if we've hit the limit of parameters.
-				if (++currentParameter == PARAMETERS_TOTAL) {
-					nextState = PARAM_STATE_INACTIVE;
-				} else {
-					nextState = PARAM_STATE_STREAM_DELAY;
-				}
-			}
-		} break;
-
-		// Add a delay of INTRA_PARAM_DELAY timesteps before attempting to schedule another one
-                // This counter variable should be incremented by the `IncrementParameterCounter()`
-                // function, which should be called at a constant rate. This rate should be the same
-                // as the units for INTRA_PARAM_DELAY.
-		case PARAM_STATE_STREAM_DELAY: {
-			if (event == PARAM_EVENT_ENTER_STATE) {
-					parameterTimeoutCounter = 0;
-			} else if (event == PARAM_EVENT_NONE) {
-				if (parameterTimeoutCounter >= INTRA_PARAM_DELAY) {
-					nextState = PARAM_STATE_STREAM_SEND_VALUE;
-				}
-			}
-		} break;
-
-		default: break;
-	}
-
-	// Here is when we actually transition between states, calling init/exit code as necessary
-	if (nextState != state) {
-		MavLinkEvaluateParameterState(PARAM_EVENT_EXIT_STATE, NULL);
-		state = nextState;
-		MavLinkEvaluateParameterState(PARAM_EVENT_ENTER_STATE, NULL);
-	}
-}
-
-void IncrementParameterCounter(void)
-{
-    if (parameterTimeoutCounter < UINT8_MAX) {
-        ++parameterTimeoutCounter;
-    }
-}
-
-/**
- * This function implements the mission protocol state machine for the MAVLink protocol.
- * events can be passed as the first argument, or NO_EVENT if desired. data is a pointer
- * to data if there is any to be passed to the state logic. data is not guaranteed to persist
- * beyond the single call to this function.
+ * Sends whatever the mission transfer has due. If it ran out of tries during an upload, the
+ * groundstation is told so that it doesn't keep waiting for requests.
  */
-void MavLinkEvaluateMissionState(enum MISSION_EVENT event, const void *data)
+static void MavLinkServiceMissionTransfer(void)
 {
-	// Keep track of the expected length of the incoming mission list
-	static uint16_t mavlinkNewMissionListSize;
-
-	// Track a mission index for some multi-state loops.
-	static uint8_t currentMissionIndex;
-
-	// Track the state
-	static uint8_t state = MISSION_STATE_INACTIVE;
-
-    // Store the vessel's local position at the beginning of receiving mission parameters.
-    static float referenceLocalPosition[3];
-
-	// Keep track of the next state to transition into
-	uint8_t nextState = state;
-
-	// Then check the mission protocol state
-	switch (state) {
-		case MISSION_STATE_INACTIVE:
-			// If a REQUEST_LIST is received, reset the current mission and move into the receive
-			// missions mode.
-			if (event == MISSION_EVENT_REQUEST_LIST_RECEIVED) {
-				currentMissionIndex = 0;
-				nextState = MISSION_STATE_SEND_MISSION_COUNT;
-			}
-			// Otherwise if a mission count was received, prepare to receive new missions.
-			else if (event == MISSION_EVENT_COUNT_RECEIVED) {
-				// Don't allow for writing of new missions if we're in autonomous mode.
-				if (IS_AUTONOMOUS()) {
-					MavLinkSendMissionAck(MAV_MISSION_ERROR);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-
-				uint8_t newListSize = *(uint8_t *)data;
-
-				// If we received a 0-length mission list, just respond with a MISSION_ACK error.
-				if (newListSize == 0) {
-					MavLinkSendMissionAck(MAV_MISSION_ERROR);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-				// If there isn't enough room, respond with a MISSION_ACK error.
-				else if (newListSize > mList.maxSize) { // mList is exported by MATLAB code.
-					MavLinkSendMissionAck(MAV_MISSION_NO_SPACE);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-				// Otherwise we're set to start retrieving a new mission list so we request the first mission.
-				else {
-					// Update the size of the mission list to the new list size.
-					mavlinkNewMissionListSize = newListSize;
-
-					// Clear all the old waypoints.
-					ClearMissionList();
-
-					// And wait for info on the first mission.
-					currentMissionIndex = 0;
-
-                    // Latch the vessel's local position here so that any LOCAL_OFFSET_NED missions
-                    // are all referenced relative to the same vessel position.
-                    referenceLocalPosition[0] = controllerVars.LocalPosition[0];
-                    referenceLocalPosition[1] = controllerVars.LocalPosition[1];
-                    referenceLocalPosition[2] = controllerVars.LocalPosition[2];
-
-					// And finally trigger the proper response.
-					nextState = MISSION_STATE_SEND_MISSION_REQUEST;
-				}
-			} else if (event == MISSION_EVENT_CLEAR_ALL_RECEIVED) {
-				// If we're in autonomous mode, don't allow for clearing the mission list
-				if (IS_AUTONOMOUS()) {
-					MavLinkSendMissionAck(MAV_MISSION_ERROR);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-				// But if we're in manual mode, go ahead and clear everything.
-				else {
-					// Clear the old list
-					ClearMissionList();
-
-					// And then send our acknowledgement.
-					MavLinkSendMissionAck(MAV_MISSION_ACCEPTED);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			} else if (event == MISSION_EVENT_SET_CURRENT_RECEIVED) {
-                            uint8_t newCurrentMissionIndex = *(uint8_t*)data;
-                            SetCurrentMission(newCurrentMissionIndex);
-                            MavLinkSendCurrentMission(newCurrentMissionIndex);
-                            nextState = MISSION_STATE_INACTIVE;
-			}
-                        // At this point we shouldn't see anything else, so report an error if we do.
-                        else if (event > MISSION_EVENT_EXIT_STATE) {
-                                MavLinkSendMissionAck(MAV_MISSION_ERROR);
-                                nextState = MISSION_STATE_INACTIVE;
-                        }
-		break;
-
-		case MISSION_STATE_SEND_MISSION_COUNT:
-			if (event == MISSION_EVENT_NONE) {
-				MavLinkSendMissionCount();
-				nextState = MISSION_STATE_MISSION_COUNT_TIMEOUT;
-			}
-		break;
-
-		case MISSION_STATE_MISSION_COUNT_TIMEOUT:
-			if (event == MISSION_EVENT_ENTER_STATE) {
-				missionTimeoutCounter = 0;
-			} else if (event == MISSION_EVENT_NONE) {
-				if (missionTimeoutCounter >= MISSION_RESEND_TIMEOUT) {
-					nextState = MISSION_STATE_SEND_MISSION_COUNT2;
-				}
-			} else if (event == MISSION_EVENT_REQUEST_LIST_RECEIVED) {
-				nextState = MISSION_STATE_SEND_MISSION_COUNT;
-			} else if (event == MISSION_EVENT_REQUEST_RECEIVED) {
-				// If the current mission is requested, send it.
-				if (data && *(uint8_t *)data == currentMissionIndex) {
-					MavLinkSendMissionItem(currentMissionIndex);
-					nextState = MISSION_STATE_MISSION_ITEM_TIMEOUT;
-				} else {
-					MavLinkSendMissionAck(MAV_MISSION_INVALID_SEQUENCE);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			}
-		break;
+	const bool receiving = (missionTransfer.State == MISSION_TRANSFER_RECEIVING);
+	uint16_t seqs[MISSION_TRANSFER_WINDOW];
+	uint8_t count = MissionTransferDue(&missionTransfer, seqs);
+	uint8_t i;
 
-		case MISSION_STATE_SEND_MISSION_COUNT2:
-			if (event == MISSION_EVENT_NONE) {
-				MavLinkSendMissionCount();
-				nextState = MISSION_STATE_MISSION_COUNT_TIMEOUT2;
-			}
-		break;
-
-		case MISSION_STATE_MISSION_COUNT_TIMEOUT2:
-			if (event == MISSION_EVENT_ENTER_STATE) {
-				missionTimeoutCounter = 0;
-			} else if (event == MISSION_EVENT_NONE) {
-				if (missionTimeoutCounter >= MISSION_RESEND_TIMEOUT) {
-					nextState = MISSION_STATE_SEND_MISSION_COUNT3;
-				}
-			} else if (event == MISSION_EVENT_REQUEST_LIST_RECEIVED) {
-				nextState = MISSION_STATE_SEND_MISSION_COUNT;
-			} else if (event == MISSION_EVENT_REQUEST_RECEIVED) {
-				// If the current mission is requested, send it.
-				if (data && *(uint8_t *)data == currentMissionIndex) {
-					MavLinkSendMissionItem(currentMissionIndex);
-					nextState = MISSION_STATE_MISSION_ITEM_TIMEOUT;
-				} else {
-					MavLinkSendMissionAck(MAV_MISSION_INVALID_SEQUENCE);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			}
-		break;
-
-		case MISSION_STATE_SEND_MISSION_COUNT3:
-			if (event == MISSION_EVENT_NONE) {
-				MavLinkSendMissionCount();
-				nextState = MISSION_STATE_MISSION_COUNT_TIMEOUT3;
-			}
-		break;
-
-		case MISSION_STATE_MISSION_COUNT_TIMEOUT3:
-			if (event == MISSION_EVENT_ENTER_STATE) {
-				missionTimeoutCounter = 0;
-			} else if (event == MISSION_EVENT_NONE) {
-				if (missionTimeoutCounter >= MISSION_RESEND_TIMEOUT) {
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			} else if (event == MISSION_EVENT_REQUEST_LIST_RECEIVED) {
-				nextState = MISSION_STATE_SEND_MISSION_COUNT;
-			} else if (event == MISSION_EVENT_REQUEST_RECEIVED) {
-				// If the current mission is requested, send it.
-				if (data && *(uint8_t *)data == currentMissionIndex) {
-					MavLinkSendMissionItem(currentMissionIndex);
-					nextState = MISSION_STATE_MISSION_ITEM_TIMEOUT;
-				} else {
-					MavLinkSendMissionAck(MAV_MISSION_INVALID_SEQUENCE);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			}
-		break;
-
-		case MISSION_STATE_SEND_MISSION_ITEM: {
-			if (event == MISSION_EVENT_NONE) {
-				MavLinkSendMissionItem(currentMissionIndex);
-				nextState = MISSION_STATE_MISSION_ITEM_TIMEOUT2;
-			}
-		} break;
-
-		case MISSION_STATE_MISSION_ITEM_TIMEOUT:
-			if (event == MISSION_EVENT_ENTER_STATE) {
-				missionTimeoutCounter = 0;
-			} else if (event == MISSION_EVENT_NONE) {
-				// Keep track of how long it's taking for a request to be received so we can timeout
-				// if necessary.
-				if (missionTimeoutCounter >= MISSION_RESEND_TIMEOUT) {
-					nextState = MISSION_STATE_SEND_MISSION_ITEM2;
-				}
-			} else if (event == MISSION_EVENT_REQUEST_RECEIVED) {
-				// If the mission that was already sent was requested again, retransmit it.
-				if (*(uint8_t *)data == currentMissionIndex) {
-					nextState = MISSION_STATE_SEND_MISSION_ITEM;
-				}
-				// Otherwise if the next mission was requested, move on to sending that one.
-				else if (*(uint8_t *)data == currentMissionIndex + 1) {
-					++currentMissionIndex;
-					nextState = MISSION_STATE_SEND_MISSION_ITEM;
-				} else {
-					MavLinkSendMissionAck(MAV_MISSION_INVALID_SEQUENCE);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			} else if (event == MISSION_EVENT_ACK_RECEIVED) {
-				nextState = MISSION_STATE_INACTIVE;
-			}
-		break;
-
-		case MISSION_STATE_SEND_MISSION_ITEM2: {
-			if (event == MISSION_EVENT_NONE) {
-				MavLinkSendMissionItem(currentMissionIndex);
-				nextState = MISSION_STATE_MISSION_ITEM_TIMEOUT2;
-			}
-		} break;
-
-		case MISSION_STATE_MISSION_ITEM_TIMEOUT2:
-			if (event == MISSION_EVENT_ENTER_STATE) {
-				missionTimeoutCounter = 0;
-			} else if (event == MISSION_EVENT_NONE) {
-				// Keep track of how long it's taking for a request to be received so we can timeout
-				// if necessary.
-				if (missionTimeoutCounter >= MISSION_RESEND_TIMEOUT) {
-					nextState = MISSION_STATE_SEND_MISSION_ITEM3;
-				}
-			} else if (event == MISSION_EVENT_REQUEST_RECEIVED) {
-				// If the mission that was already sent was requested again, retransmit it.
-				if (*(uint8_t *)data == currentMissionIndex) {
-					nextState = MISSION_STATE_SEND_MISSION_ITEM;
-				}
-				// Otherwise if the next mission was requested, move on to sending that one.
-				else if (*(uint8_t *)data == currentMissionIndex + 1) {
-					++currentMissionIndex;
-					nextState = MISSION_STATE_SEND_MISSION_ITEM;
-				} else {
-					MavLinkSendMissionAck(MAV_MISSION_INVALID_SEQUENCE);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			} else if (event == MISSION_EVENT_ACK_RECEIVED) {
-				nextState = MISSION_STATE_INACTIVE;
-			}
-		break;
-
-		case MISSION_STATE_SEND_MISSION_ITEM3: {
-			if (event == MISSION_EVENT_NONE) {
-				MavLinkSendMissionItem(currentMissionIndex);
-				nextState = MISSION_STATE_MISSION_ITEM_TIMEOUT3;
-			}
-		} break;
-
-		case MISSION_STATE_MISSION_ITEM_TIMEOUT3:
-			if (event == MISSION_EVENT_ENTER_STATE) {
-				missionTimeoutCounter = 0;
-			} else if (event == MISSION_EVENT_NONE) {
-				// Keep track of how long it's taking for a request to be received so we can timeout
-				// if necessary.
-				if (missionTimeoutCounter >= MISSION_RESEND_TIMEOUT) {
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			} else if (event == MISSION_EVENT_REQUEST_RECEIVED) {
-				// If the mission that was already sent was requested again, retransmit it.
-				if (*(uint8_t *)data == currentMissionIndex) {
-					nextState = MISSION_STATE_SEND_MISSION_ITEM;
-				}
-				// Otherwise if the next mission was requested, move on to sending that one.
-				else if (*(uint8_t *)data == currentMissionIndex + 1) {
-					++currentMissionIndex;
-					nextState = MISSION_STATE_SEND_MISSION_ITEM;
-				} else {
-					MavLinkSendMissionAck(MAV_MISSION_INVALID_SEQUENCE);
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			} else if (event == MISSION_EVENT_ACK_RECEIVED) {
-				nextState = MISSION_STATE_INACTIVE;
-			}
-		break;
-
-		case MISSION_STATE_SEND_MISSION_REQUEST: {
-			if (event == MISSION_EVENT_NONE) {
-				MavLinkSendMissionRequest(currentMissionIndex);
-				nextState = MISSION_STATE_MISSION_REQUEST_TIMEOUT;
-			}
-		} break;
-
-		// Implement the countdown timer for receiving a mission item
-		case MISSION_STATE_MISSION_REQUEST_TIMEOUT:
-			if (event == MISSION_EVENT_ENTER_STATE) {
-				missionTimeoutCounter = 0;
-			} else if (event == MISSION_EVENT_NONE) {
-				// Keep track of how long it's taking for a request to be received so we can timeout
-				// if necessary.
-				if (missionTimeoutCounter >= MISSION_RESEND_TIMEOUT) {
-					nextState = MISSION_STATE_SEND_MISSION_REQUEST2;
-				}
-			}
-			// If an ACK was received, we just stop. One shouldn't have been received, so just stop
-			// for now.
-			else if (event == MISSION_EVENT_ACK_RECEIVED) {
-				nextState = MISSION_STATE_INACTIVE;
-			}
-			//
-			else if (event == MISSION_EVENT_ITEM_RECEIVED) {
-				const mavlink_mission_item_t *incomingMission = (mavlink_mission_item_t *)data;
-
-				// Make sure that they're coming in in the right order, and if they don't return an error in
-				// the acknowledgment response.
-				if (currentMissionIndex == incomingMission->seq) {
-					int missionAddStatus = MavLinkAppendMission(incomingMission, referenceLocalPosition);
-					if (missionAddStatus != -1) {
-						// If this is going to be the new current mission, then we should set it as such.
-						if (incomingMission->current) {
-							SetCurrentMission(incomingMission->seq);
-						}
-
-						// If this was the last mission we were expecting, respond with an ACK
-						// confirming that we've successfully received the entire mission list.
-						if (currentMissionIndex == mavlinkNewMissionListSize - 1) {
-							MavLinkSendMissionAck(MAV_MISSION_ACCEPTED);
-							nextState = MISSION_STATE_INACTIVE;
-						}
-						// Otherwise we just increment and request the next mission.
-						else {
-							++currentMissionIndex;
-							MavLinkSendMissionRequest(currentMissionIndex);
-							nextState = MISSION_STATE_MISSION_REQUEST_TIMEOUT;
-						}
-					}
-					// If we've run out of space before the last message, respond saying so.
-					else {
-						MavLinkSendMissionAck(MAV_MISSION_NO_SPACE);
-						nextState = MISSION_STATE_INACTIVE;
-					}
-				}
-			}
-		break;
-
-		case MISSION_STATE_SEND_MISSION_REQUEST2: {
-			if (event == MISSION_EVENT_NONE) {
-				MavLinkSendMissionRequest(currentMissionIndex);
-				nextState = MISSION_STATE_MISSION_REQUEST_TIMEOUT2;
-			}
-		} break;
-
-		// Implement the countdown timer for receiving a mission item
-		case MISSION_STATE_MISSION_REQUEST_TIMEOUT2:
-			if (event == MISSION_EVENT_ENTER_STATE) {
-				missionTimeoutCounter = 0;
-			} else if (event == MISSION_EVENT_NONE) {
-				// Keep track of how long it's taking for a request to be received so we can timeout
-				// if necessary.
-				if (missionTimeoutCounter >= MISSION_RESEND_TIMEOUT) {
-					nextState = MISSION_STATE_SEND_MISSION_REQUEST3;
-				}
-			}
-			// If an ACK was received, we just stop. One shouldn't have been received, so just stop
-			// for now.
-			else if (event == MISSION_EVENT_ACK_RECEIVED) {
-				nextState = MISSION_STATE_INACTIVE;
-			}
-			//
-			else if (event == MISSION_EVENT_ITEM_RECEIVED) {
-				const mavlink_mission_item_t *incomingMission = (mavlink_mission_item_t *)data;
-
-				// Make sure that they're coming in in the right order, and if they don't return an error in
-				// the acknowledgment response.
-				if (currentMissionIndex == incomingMission->seq) {
-					int missionAddStatus = MavLinkAppendMission(incomingMission, referenceLocalPosition);
-					if (missionAddStatus != -1) {
-						// If this is going to be the new current mission, then we should set it as such.
-						if (incomingMission->current) {
-							SetCurrentMission(incomingMission->seq);
-						}
-
-						// If this was the last mission we were expecting, respond with an ACK
-						// confirming that we've successfully received the entire mission list.
-						if (currentMissionIndex == mavlinkNewMissionListSize - 1) {
-							MavLinkSendMissionAck(MAV_MISSION_ACCEPTED);
-							nextState = MISSION_STATE_INACTIVE;
-						}
-						// Otherwise we just increment and request the next mission.
-						else {
-							++currentMissionIndex;
-							MavLinkSendMissionRequest(currentMissionIndex);
-							nextState = MISSION_STATE_MISSION_REQUEST_TIMEOUT;
-						}
-					}
-					// If we've run out of space before the last message, respond saying so.
-					else {
-						MavLinkSendMissionAck(MAV_MISSION_NO_SPACE);
-						nextState = MISSION_STATE_INACTIVE;
-					}
-				}
-			}
-		break;
-
-		case MISSION_STATE_SEND_MISSION_REQUEST3: {
-			if (event == MISSION_EVENT_NONE) {
-				MavLinkSendMissionRequest(currentMissionIndex);
-				nextState = MISSION_STATE_MISSION_REQUEST_TIMEOUT3;
-			}
-		} break;
-
-		// Implement the countdown timer for receiving a mission item
-		case MISSION_STATE_MISSION_REQUEST_TIMEOUT3:
-			if (event == MISSION_EVENT_ENTER_STATE) {
-				missionTimeoutCounter = 0;
-			} else if (event == MISSION_EVENT_NONE) {
-				// Keep track of how long it's taking for a request to be received so we can timeout
-				// if necessary.
-				if (missionTimeoutCounter >= MISSION_RESEND_TIMEOUT) {
-					nextState = MISSION_STATE_INACTIVE;
-				}
-			}
-			// If an ACK was received, we just stop. One shouldn't have been received, so just stop
-			// for now.
-			else if (event == MISSION_EVENT_ACK_RECEIVED) {
-				nextState = MISSION_STATE_INACTIVE;
-			}
-			//
-			else if (event == MISSION_EVENT_ITEM_RECEIVED) {
-				const mavlink_mission_item_t *incomingMission = (mavlink_mission_item_t *)data;
-
-				// Make sure the messages are in a supported reference frame.
-                if (incomingMission->frame != MAV_FRAME_LOCAL_NED ||
-                    incomingMission->frame != MAV_FRAME_LOCAL_OFFSET_NED ||
-                    incomingMission->frame != MAV_FRAME_GLOBAL ||
-                    incomingMission->frame != MAV_FRAME_GLOBAL_RELATIVE_ALT) {
-                    MavLinkSendMissionAck(MAV_MISSION_UNSUPPORTED_FRAME);
-                    nextState = MISSION_STATE_INACTIVE;
-                }
-				// Make sure the messages are coming in the right order, ACKing an error if they
-                // aren't.
-                else if (currentMissionIndex != incomingMission->seq) {
-					MavLinkSendMissionAck(MAV_MISSION_INVALID_SEQUENCE);
-					nextState = MISSION_STATE_INACTIVE;
-                }
-				// At this point we have a valid mission, so try to add it.
-                else {
-					int missionAddStatus = MavLinkAppendMission(incomingMission, referenceLocalPosition);
-					if (missionAddStatus != -1) {
-						// If this is going to be the new current mission, then we should set it as such.
-						if (incomingMission->current) {
-							SetCurrentMission(incomingMission->seq);
-						}
-
-						// If this was the last mission we were expecting, respond with an ACK
-						// confirming that we've successfully received the entire mission list.
-						if (currentMissionIndex == mavlinkNewMissionListSize - 1) {
-							MavLinkSendMissionAck(MAV_MISSION_ACCEPTED);
-							nextState = MISSION_STATE_INACTIVE;
-						}
-						// Otherwise we just increment and request the next mission.
-						else {
-							++currentMissionIndex;
-							MavLinkSendMissionRequest(currentMissionIndex);
-							nextState = MISSION_STATE_MISSION_REQUEST_TIMEOUT;
-						}
-					}
-					// If we've run out of space before the last message, respond saying so.
-					else {
-						MavLinkSendMissionAck(MAV_MISSION_NO_SPACE);
-						nextState = MISSION_STATE_INACTIVE;
-					}
-				}
-			}
-		break;
+	for (i = 0; i < count; ++i) {
+		if (receiving) {
+			MavLinkQueueMissionRequest(seqs[i]);
+		} else if (seqs[i] == MISSION_TRANSFER_COUNT) {
+			MavLinkQueueMissionCount();
+		} else {
+			MavLinkQueueMissionItem(seqs[i]);
+		}
 	}
 
-	// Here is when we actually transition between states, calling init/exit code as necessary
-	if (nextState != state) {
-		MavLinkEvaluateMissionState(MISSION_EVENT_EXIT_STATE, NULL);
-		state = nextState;
-		MavLinkEvaluateMissionState(MISSION_EVENT_ENTER_STATE, NULL);
+	if (missionTransfer.State == MISSION_TRANSFER_FAILED) {
+		if (receiving) {
+			MavLinkQueueMissionAck(MAV_MISSION_ERROR);
+		}
+		MissionTransferEnd(&missionTransfer);
 	}
 }
 
 void IncrementMissionCounter(void)
 {
-    if (missionTimeoutCounter < UINT8_MAX) {
-        ++missionTimeoutCounter;
-    }
+	MissionTransferTick(&missionTransfer);
+	MavLinkServiceMissionTransfer();
 }
 
 /**
@@ -1833,265 +1683,479 @@ int MavLinkAppendMission(const mavlink_mission_item_t *mission, const float refN
 }
 
 /**
-* @brief Receive communication packets and handle them. Should be called at the system sample rate.
-*
-* This function decodes packets on the protocol level and also handles
-* their value by calling the appropriate functions.
-*/
-void MavLinkReceive(void)
+ * Received message handlers. These are dispatched from MavLinkReceive() through
+ * `receiveDispatch`, which counts the received frames, so they all return 0.
+ */
+
+// Check for commands like write data to EEPROM
+static uint16_t MavLinkHandleCommandLong(uint8_t channel, const mavlink_message_t *msg)
 {
-	mavlink_message_t rxMessage;
-	mavlink_status_t status;
-
-	// Track if a mission message was processed in this call. This is used to determine if a
-	// NONE_EVENT should be sent to the mission manager. The manager needs to be called every
-	// timestep such that its internal state machine works properly.
-	bool processedMissionMessage = false;
-
-	// Track if a parameter message was processed in this call. This is used to determine if a
-	// NONE_EVENT should be sent to the parameter manager. The manager needs to be called every
-	// timestep such that its internal state machine works properly.
-	bool processedParameterMessage = false;
-
-        uint8_t c;
-	while (Uart1ReadByte(&c)) {
-		// Parse another byte and if there's a message found process it.
-		if (mavlink_parse_char(MAVLINK_COMM_0, c, &rxMessage, &status)) {
-
-			// Latch the groundstation system and component ID if we haven't yet. We exclude the
-			// combination of systemid:3/compid:D, because that's the combo used by the 3DR radios.
-			if (!groundStationSystemId && !groundStationComponentId &&
-			    (rxMessage.sysid != '3' && rxMessage.compid != 'D')) {
-				groundStationSystemId = rxMessage.sysid;
-				groundStationComponentId = rxMessage.compid;
-			}
+	mavlink_command_long_t mavCommand;
+	mavlink_msg_command_long_decode(msg, &mavCommand);
+	MavLinkReceiveCommandLong(&mavCommand);
+	return 0;
+}
 
-                        // If the message is from the groundstation, update the received time
-                        if (rxMessage.sysid == groundStationSystemId &&
-                            rxMessage.compid == groundStationComponentId) {
-                            gcsLastTimeSeen = nodeSystemTime;
-                        }
+static uint16_t MavLinkHandleSetMode(uint8_t channel, const mavlink_message_t *msg)
+{
+	mavlink_set_mode_t modeMessage;
+	mavlink_msg_set_mode_decode(msg, &modeMessage);
+	MavLinkReceiveSetMode(&modeMessage);
+	return 0;
+}
+
+// Check for manual commands via Joystick from QGC.
+static uint16_t MavLinkHandleManualControl(uint8_t channel, const mavlink_message_t *msg)
+{
+	mavlink_manual_control_t manualControl;
+	mavlink_msg_manual_control_decode(msg, &manualControl);
+	MavLinkReceiveManualControl(&manualControl);
+	return 0;
+}
+
+// Start receiving a new mission list, which replaces the old one right away. Any transfer that was
+// underway is abandoned, as the groundstation has started over.
+static uint16_t MavLinkHandleMissionCount(uint8_t channel, const mavlink_message_t *msg)
+{
+	uint16_t newListSize = mavlink_msg_mission_count_get_count(msg);
+
+	// Don't allow for writing of new missions if we're in autonomous mode.
+	if (IS_AUTONOMOUS()) {
+		MavLinkQueueMissionAck(MAV_MISSION_ERROR);
+	}
+	// If we received a 0-length mission list, just respond with a MISSION_ACK error.
+	else if (newListSize == 0) {
+		MavLinkQueueMissionAck(MAV_MISSION_ERROR);
+	}
+	// If there isn't enough room, respond with a MISSION_ACK error.
+	else if (newListSize > mList.maxSize) { // mList is exported by MATLAB code.
+		MavLinkQueueMissionAck(MAV_MISSION_NO_SPACE);
+	}
+	// Otherwise clear the old waypoints and request the first window of new ones.
+	else {
+		ClearMissionList();
 
-			switch(rxMessage.msgid) {
-
-				// Check for commands like write data to EEPROM
-				case MAVLINK_MSG_ID_COMMAND_LONG: {
-					mavlink_command_long_t mavCommand;
-					mavlink_msg_command_long_decode(&rxMessage, &mavCommand);
-					MavLinkReceiveCommandLong(&mavCommand);
-				} break;
-
-				case MAVLINK_MSG_ID_SET_MODE: {
-                                        mavlink_set_mode_t modeMessage;
-                                        mavlink_msg_set_mode_decode(&rxMessage, &modeMessage);
-                                        MavLinkReceiveSetMode(&modeMessage);
-				} break;
-
-				// Check for manual commands via Joystick from QGC.
-				case MAVLINK_MSG_ID_MANUAL_CONTROL: {
-					mavlink_manual_control_t manualControl;
-					mavlink_msg_manual_control_decode(&rxMessage, &manualControl);
-					MavLinkReceiveManualControl(&manualControl);
-				} break;
-
-				// If we are not doing any mission protocol operations, record the size of the incoming mission
-				// list and transition into the write missions state machine loop.
-				case MAVLINK_MSG_ID_MISSION_COUNT: {
-					uint8_t mavlinkNewMissionListSize = mavlink_msg_mission_count_get_count(&rxMessage);
-					MavLinkEvaluateMissionState(MISSION_EVENT_COUNT_RECEIVED, &mavlinkNewMissionListSize);
-					processedMissionMessage = true;
-				} break;
-
-				// Handle receiving a mission.
-				case MAVLINK_MSG_ID_MISSION_ITEM: {
-					mavlink_mission_item_t currentMission;
-					mavlink_msg_mission_item_decode(&rxMessage, &currentMission);
-					MavLinkEvaluateMissionState(MISSION_EVENT_ITEM_RECEIVED, &currentMission);
-					processedMissionMessage = true;
-				} break;
-
-				// Responding to a mission request entails moving into the first active state and scheduling a MISSION_COUNT message.
-				// Will also schedule a transmission of a GPS_ORIGIN message. This is used for translating global to local coordinates
-				// in QGC.
-				case MAVLINK_MSG_ID_MISSION_REQUEST_LIST: {
-					MavLinkSendGpsGlobalOrigin();
-					MavLinkEvaluateMissionState(MISSION_EVENT_REQUEST_LIST_RECEIVED, NULL);
-					processedMissionMessage = true;
-				} break;
-
-				// When a mission request message is received, respond with that mission information from the MissionManager
-				case MAVLINK_MSG_ID_MISSION_REQUEST: {
-					uint8_t receivedMissionIndex = mavlink_msg_mission_request_get_seq(&rxMessage);
-					MavLinkEvaluateMissionState(MISSION_EVENT_REQUEST_RECEIVED, &receivedMissionIndex);
-					processedMissionMessage = true;
-				} break;
-
-				// Allow for clearing waypoints. Here we respond simply with an ACK message if we successfully
-				// cleared the mission list.
-				case MAVLINK_MSG_ID_MISSION_CLEAR_ALL:
-					MavLinkEvaluateMissionState(MISSION_EVENT_CLEAR_ALL_RECEIVED, NULL);
-					processedMissionMessage = true;
-				break;
-
-				// Allow for the groundstation to set the current mission. This requires a WAYPOINT_CURRENT response message agreeing with the received current message index.
-				case MAVLINK_MSG_ID_MISSION_SET_CURRENT: {
-					uint8_t newCurrentMission = mavlink_msg_mission_set_current_get_seq(&rxMessage);
-					MavLinkEvaluateMissionState(MISSION_EVENT_SET_CURRENT_RECEIVED, &newCurrentMission);
-					processedMissionMessage = true;
-				} break;
-
-				case MAVLINK_MSG_ID_MISSION_ACK: {
-					uint8_t type = mavlink_msg_mission_ack_get_type(&rxMessage);
-					MavLinkEvaluateMissionState(MISSION_EVENT_ACK_RECEIVED, &type);
-					processedMissionMessage = true;
-				} break;
-
-				// If they're requesting a list of all parameters, call a separate function that'll track the state and transmit the necessary messages.
-				// This reason that this is an external function is so that it can be run separately at 20Hz.
-				case MAVLINK_MSG_ID_PARAM_REQUEST_LIST: {
-					MavLinkEvaluateParameterState(PARAM_EVENT_REQUEST_LIST_RECEIVED, NULL);
-					processedParameterMessage = true;
-				} break;
-
-				// If a request comes for a single parameter then set that to be the current parameter and move into the proper state.
-				case MAVLINK_MSG_ID_PARAM_REQUEST_READ: {
-					uint16_t currentParameter = mavlink_msg_param_request_read_get_param_index(&rxMessage);
-					MavLinkEvaluateParameterState(PARAM_EVENT_REQUEST_READ_RECEIVED, &currentParameter);
-					processedParameterMessage = true;
-				} break;
-
-				case MAVLINK_MSG_ID_PARAM_SET: {
-					mavlink_param_set_t p;
-					mavlink_msg_param_set_decode(&rxMessage, &p);
-					MavLinkEvaluateParameterState(PARAM_EVENT_SET_RECEIVED, &p);
-					processedParameterMessage = true;
-				} break;
-
-				case MAVLINK_MSG_ID_RADIO_STATUS:
-					mavlink_msg_radio_status_decode(&rxMessage, &radioStatus);
-				break;
-
-                                default:
-                                    break;
+		// Latch the vessel's local position here so that any LOCAL_OFFSET_NED missions
+		// are all referenced relative to the same vessel position.
+		referenceLocalPosition[0] = controllerVars.LocalPosition[0];
+		referenceLocalPosition[1] = controllerVars.LocalPosition[1];
+		referenceLocalPosition[2] = controllerVars.LocalPosition[2];
+
+		MissionTransferStartReceive(&missionTransfer, newListSize);
+		MavLinkServiceMissionTransfer();
+	}
+	return 0;
+}
+
+// Handle receiving a mission. Items can arrive out of order, they're stored in order as soon as
+// every earlier one has arrived.
+static uint16_t MavLinkHandleMissionItem(uint8_t channel, const mavlink_message_t *msg)
+{
+	mavlink_mission_item_t incomingMission;
+	mavlink_msg_mission_item_decode(msg, &incomingMission);
+
+	switch (MissionTransferItem(&missionTransfer, &incomingMission)) {
+	case MISSION_ITEM_NEW:
+		while (MissionTransferNext(&missionTransfer, &incomingMission)) {
+			// If we've run out of space before the last message, respond saying so.
+			if (MavLinkAppendMission(&incomingMission, referenceLocalPosition) == -1) {
+				MavLinkQueueMissionAck(MAV_MISSION_NO_SPACE);
+				MissionTransferEnd(&missionTransfer);
+				return 0;
+			}
+
+			// If this is going to be the new current mission, then we should set it as such.
+			if (incomingMission.current) {
+				SetCurrentMission(incomingMission.seq);
 			}
 		}
 
-                // Update our stats of both messages received and number of message failures.
-                // The `packet_rx_success_count` is a global and persistent count of successfully-
-                // received messages, while `packet_rx_drop_count` is a local value and will be 0 or
-                // 1 depending on if the character decoded successfully.
-                mavLinkMessagesReceived = status.packet_rx_success_count;
-                mavLinkMessagesFailedParsing += status.packet_rx_drop_count;
-        }
+		// Confirm the entire mission list once it's in, otherwise request what the window now
+		// has room for.
+		if (missionTransfer.State == MISSION_TRANSFER_COMPLETE) {
+			MavLinkQueueMissionAck(MAV_MISSION_ACCEPTED);
+		} else {
+			MavLinkServiceMissionTransfer();
+		}
+		break;
+
+	// The groundstation resent part of the list because it missed our ACK.
+	case MISSION_ITEM_REACK:
+		MavLinkQueueMissionAck(MAV_MISSION_ACCEPTED);
+		break;
+
+	case MISSION_ITEM_UNEXPECTED:
+		MavLinkQueueMissionAck(MAV_MISSION_ERROR);
+		break;
 
-	// Now if no mission messages were received, trigger the Mission Manager anyways with a NONE
-	// event.
-	if (!processedMissionMessage) {
-		MavLinkEvaluateMissionState(MISSION_EVENT_NONE, NULL);
+	default:
+		break;
 	}
+	return 0;
+}
+
+// Responding to a mission request list entails starting a download and sending a MISSION_COUNT message.
+// Will also schedule a transmission of a GPS_ORIGIN message. This is used for translating global to local coordinates
+// in QGC.
+static uint16_t MavLinkHandleMissionRequestList(uint8_t channel, const mavlink_message_t *msg)
+{
+	uint8_t missionCount;
+	GetMissionCount(&missionCount);
 
-	// Now if no parameter messages were received, trigger the Parameter Manager anyways with a NONE
-	// event.
-	if (!processedParameterMessage) {
-		MavLinkEvaluateParameterState(PARAM_EVENT_NONE, NULL);
+	MavLinkSendGpsGlobalOrigin();
+	MissionTransferStartSend(&missionTransfer, missionCount);
+	MavLinkQueueMissionCount();
+	return 0;
+}
+
+// When a mission request message is received, respond with that mission information from the
+// MissionManager. Requests can come in any order.
+static uint16_t MavLinkHandleMissionRequest(uint8_t channel, const mavlink_message_t *msg)
+{
+	uint16_t receivedMissionIndex = mavlink_msg_mission_request_get_seq(msg);
+
+	if (missionTransfer.State != MISSION_TRANSFER_SENDING) {
+		MavLinkQueueMissionAck(MAV_MISSION_ERROR);
+	} else if (MissionTransferRequest(&missionTransfer, receivedMissionIndex)) {
+		MavLinkQueueMissionItem(receivedMissionIndex);
+	} else {
+		MavLinkQueueMissionAck(MAV_MISSION_INVALID_SEQUENCE);
+		MissionTransferEnd(&missionTransfer);
 	}
+	return 0;
 }
 
-/**
- * This function handles transmission of MavLink messages taking into account transmission
- * speed, message size, and desired transmission rate.
- */
-void MavLinkTransmitGroundstation(void)
+// Allow for clearing waypoints. Here we respond simply with an ACK message if we successfully
+// cleared the mission list.
+static uint16_t MavLinkHandleMissionClearAll(uint8_t channel, const mavlink_message_t *msg)
 {
-	// And now transmit all messages for this timestep
-	uint8_t msgs[GROUNDSTATION_SCHEDULE_NUM_MSGS];
-	uint8_t count = GetMessagesForTimestep(&groundstationMavlinkSchedule, msgs);
-	int i;
-	for (i = 0; i < count; ++i) {
+	// If we're in autonomous mode, don't allow for clearing the mission list
+	if (IS_AUTONOMOUS()) {
+		MavLinkQueueMissionAck(MAV_MISSION_ERROR);
+	}
+	// But if we're in manual mode, go ahead and clear everything, including any upload underway.
+	else {
+		MissionTransferEnd(&missionTransfer);
+		ClearMissionList();
+		MavLinkQueueMissionAck(MAV_MISSION_ACCEPTED);
+	}
+	return 0;
+}
 
-		switch (msgs[i]) {
+// Allow for the groundstation to set the current mission. This requires a WAYPOINT_CURRENT response message agreeing with the received current message index.
+static uint16_t MavLinkHandleMissionSetCurrent(uint8_t channel, const mavlink_message_t *msg)
+{
+	uint8_t newCurrentMission = mavlink_msg_mission_set_current_get_seq(msg);
+	SetCurrentMission(newCurrentMission);
+	MavLinkSendCurrentMission(newCurrentMission);
+	return 0;
+}
 
-			/** Common Messages **/
+// The groundstation acknowledges the end of a download this way, or cancels an upload.
+static uint16_t MavLinkHandleMissionAck(uint8_t channel, const mavlink_message_t *msg)
+{
+	if (missionTransfer.State == MISSION_TRANSFER_SENDING ||
+	    missionTransfer.State == MISSION_TRANSFER_RECEIVING) {
+		MissionTransferEnd(&missionTransfer);
+	}
+	return 0;
+}
 
-			case MAVLINK_MSG_ID_HEARTBEAT: {
-				MavLinkSendHeartbeat(MAVLINK_CHAN_GROUNDSTATION);
-			} break;
+// If they're requesting a list of all parameters, (re)start streaming them all. They're sent by
+// MavLinkTransmitGroundstation() as fast as the link allows.
+static uint16_t MavLinkHandleParamRequestList(uint8_t channel, const mavlink_message_t *msg)
+{
+	ParamStreamRequestAll(&groundstationParamStream, 1);
+	return 0;
+}
 
-			case MAVLINK_MSG_ID_SYSTEM_TIME: {
-				MavLinkSendSystemTime(MAVLINK_CHAN_GROUNDSTATION);
-			} break;
+// A single parameter goes out with the next timestep, ahead of any stream that's underway.
+static uint16_t MavLinkHandleParamRequestRead(uint8_t channel, const mavlink_message_t *msg)
+{
+	ParamStreamRequestOne(&groundstationParamStream, mavlink_msg_param_request_read_get_param_index(msg));
+	return 0;
+}
 
-			case MAVLINK_MSG_ID_SYS_STATUS: {
-				MavLinkSendStatus(MAVLINK_CHAN_GROUNDSTATION);
-			} break;
+static uint16_t MavLinkHandleParamSet(uint8_t channel, const mavlink_message_t *msg)
+{
+	mavlink_param_set_t p;
+	mavlink_msg_param_set_decode(msg, &p);
+
+	// Only allow setting a parameter if we're in manual mode unless it's the automode parameter.
+	// There no way to report errors with the parameter protocol, so those are ignored.
+	// See MAVLink issue #337: https://github.com/mavlink/mavlink/issues/337
+	if (!IS_AUTONOMOUS() || strcmp(p.param_id, "ModeAuto") == 0) {
+		uint16_t id = ParameterSetValueByName(p.param_id, &p.param_value);
+		// If there was an error, just reply with the first parameter.
+		if (id == UINT16_MAX) {
+			id = 0;
+		}
+		ParamStreamRequestOne(&groundstationParamStream, id);
+	}
+	return 0;
+}
 
-			case MAVLINK_MSG_ID_ATTITUDE: {
-				MavLinkSendAttitude();
-			} break;
+static uint16_t MavLinkHandleRadioStatus(uint8_t channel, const mavlink_message_t *msg)
+{
+	mavlink_msg_radio_status_decode(msg, &radioStatus);
+	return 0;
+}
 
-			case MAVLINK_MSG_ID_LOCAL_POSITION_NED: {
-				MavLinkSendLocalPosition();
-			} break;
+/**
+ * Transmit handlers. These adapt the MavLinkSend*() functions to the dispatch tables used by
+ * MavLinkTransmitGroundstation() and MavLinkTransmitDatalogger(), returning the bytes they queued.
+ */
+#define MAVLINK_TX_HANDLER(name, send) \
+	static uint16_t MavLinkTx##name(uint8_t channel, const mavlink_message_t *msg) { mavlinkQueuedBytes = 0; send; return mavlinkQueuedBytes; }
+
+/** Common Messages **/
+MAVLINK_TX_HANDLER(Heartbeat, MavLinkSendHeartbeat(channel))
+MAVLINK_TX_HANDLER(SystemTime, MavLinkSendSystemTime(channel))
+MAVLINK_TX_HANDLER(Status, MavLinkSendStatus(channel))
+MAVLINK_TX_HANDLER(Attitude, MavLinkSendAttitude())
+MAVLINK_TX_HANDLER(LocalPosition, MavLinkSendLocalPosition())
+MAVLINK_TX_HANDLER(RawGps, MavLinkSendRawGps(channel))
+MAVLINK_TX_HANDLER(RadioStatus, MavLinkSendRadioStatus())
+MAVLINK_TX_HANDLER(VfrHud, MavLinkSendVfrHud())
+MAVLINK_TX_HANDLER(NavControllerOutput, MavLinkSendNavControllerOutput())
+
+/** SeaSlug Messages **/
+MAVLINK_TX_HANDLER(NodeStatus, MavLinkSendNodeStatus(channel))
+MAVLINK_TX_HANDLER(WaypointStatus, MavLinkSendWaypointStatusData())
+MAVLINK_TX_HANDLER(Wso100, MavLinkSendWindAirData())
+MAVLINK_TX_HANDLER(BasicState2, MavLinkSendBasicState2())
+MAVLINK_TX_HANDLER(RudderRaw, MavLinkSendRudderRaw())
+MAVLINK_TX_HANDLER(Dst800, MavLinkSendDst800Data())
+MAVLINK_TX_HANDLER(Gps200, MavLinkSendGps200Data())
+MAVLINK_TX_HANDLER(Tokimec, MavLinkSendTokimec())
+MAVLINK_TX_HANDLER(TokimecWithTime, MavLinkSendTokimecWithTime())
+MAVLINK_TX_HANDLER(MainPower, MavLinkSendMainPower(channel))
+MAVLINK_TX_HANDLER(DataloggerParameters, ParamStreamRequestAll(&dataloggerParamStream, DATALOGGER_PARAM_TRANSMIT_COUNT))
+MAVLINK_TX_HANDLER(LinkStats, MavLinkSendLinkStats())
+MAVLINK_TX_HANDLER(CanBusStats, MavLinkSendCanBusStats())
+MAVLINK_TX_HANDLER(CanTraffic, MavLinkSendCanTraffic())
+
+/** Mission protocol replies **/
+MAVLINK_TX_HANDLER(MissionCount, pendingReplies.pending &= ~REPLY_MISSION_COUNT; MavLinkSendMissionCount())
+MAVLINK_TX_HANDLER(MissionItem, pendingReplies.pending &= ~REPLY_MISSION_ITEM; MavLinkSendMissionItem(pendingReplies.missionItemIndex))
+MAVLINK_TX_HANDLER(MissionRequest, pendingReplies.pending &= ~REPLY_MISSION_REQUEST; MavLinkSendMissionRequest(pendingReplies.missionRequestIndex))
+MAVLINK_TX_HANDLER(MissionAck, pendingReplies.pending &= ~REPLY_MISSION_ACK; MavLinkSendMissionAck(pendingReplies.missionAckType))
 
-			case MAVLINK_MSG_ID_GPS_RAW_INT: {
-				MavLinkSendRawGps(MAVLINK_CHAN_GROUNDSTATION);
-			} break;
+/**
+ * The handler of every message ID in each of the dispatch tables.
+ */
+typedef struct {
+	uint8_t MsgId;
+	MavlinkHandler Handler;
+} MavLinkHandlerEntry;
+
+static const MavLinkHandlerEntry receiveHandlers[] = {
+	{MAVLINK_MSG_ID_COMMAND_LONG, MavLinkHandleCommandLong},
+	{MAVLINK_MSG_ID_SET_MODE, MavLinkHandleSetMode},
+	{MAVLINK_MSG_ID_MANUAL_CONTROL, MavLinkHandleManualControl},
+	{MAVLINK_MSG_ID_MISSION_COUNT, MavLinkHandleMissionCount},
+	{MAVLINK_MSG_ID_MISSION_ITEM, MavLinkHandleMissionItem},
+	{MAVLINK_MSG_ID_MISSION_REQUEST_LIST, MavLinkHandleMissionRequestList},
+	{MAVLINK_MSG_ID_MISSION_REQUEST, MavLinkHandleMissionRequest},
+	{MAVLINK_MSG_ID_MISSION_CLEAR_ALL, MavLinkHandleMissionClearAll},
+	{MAVLINK_MSG_ID_MISSION_SET_CURRENT, MavLinkHandleMissionSetCurrent},
+	{MAVLINK_MSG_ID_MISSION_ACK, MavLinkHandleMissionAck},
+	{MAVLINK_MSG_ID_PARAM_REQUEST_LIST, MavLinkHandleParamRequestList},
+	{MAVLINK_MSG_ID_PARAM_REQUEST_READ, MavLinkHandleParamRequestRead},
+	{MAVLINK_MSG_ID_PARAM_SET, MavLinkHandleParamSet},
+	{MAVLINK_MSG_ID_RADIO_STATUS, MavLinkHandleRadioStatus}
+};
 
-			case MAVLINK_MSG_ID_RADIO_STATUS: {
-				MavLinkSendRadioStatus();
-			} break;
+static const MavLinkHandlerEntry groundstationHandlers[] = {
+	{MAVLINK_MSG_ID_HEARTBEAT, MavLinkTxHeartbeat},
+	{MAVLINK_MSG_ID_SYSTEM_TIME, MavLinkTxSystemTime},
+	{MAVLINK_MSG_ID_SYS_STATUS, MavLinkTxStatus},
+	{MAVLINK_MSG_ID_ATTITUDE, MavLinkTxAttitude},
+	{MAVLINK_MSG_ID_LOCAL_POSITION_NED, MavLinkTxLocalPosition},
+	{MAVLINK_MSG_ID_GPS_RAW_INT, MavLinkTxRawGps},
+	{MAVLINK_MSG_ID_RADIO_STATUS, MavLinkTxRadioStatus},
+	{MAVLINK_MSG_ID_VFR_HUD, MavLinkTxVfrHud},
+	{MAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT, MavLinkTxNavControllerOutput},
+	{MAVLINK_MSG_ID_NODE_STATUS, MavLinkTxNodeStatus},
+	{MAVLINK_MSG_ID_WAYPOINT_STATUS, MavLinkTxWaypointStatus},
+	{MAVLINK_MSG_ID_WSO100, MavLinkTxWso100},
+	{MAVLINK_MSG_ID_BASIC_STATE2, MavLinkTxBasicState2},
+	{MAVLINK_MSG_ID_RUDDER_RAW, MavLinkTxRudderRaw},
+	{MAVLINK_MSG_ID_DST800, MavLinkTxDst800},
+	{MAVLINK_MSG_ID_GPS200, MavLinkTxGps200},
+	{MAVLINK_MSG_ID_TOKIMEC, MavLinkTxTokimec},
+	{MAVLINK_MSG_ID_MAIN_POWER, MavLinkTxMainPower},
+	{MAVLINK_MSG_ID_LINK_STATS, MavLinkTxLinkStats},
+	{MAVLINK_MSG_ID_CAN_BUS_STATS, MavLinkTxCanBusStats},
+	{MAVLINK_MSG_ID_CAN_TRAFFIC, MavLinkTxCanTraffic},
+	{MAVLINK_MSG_ID_MISSION_COUNT, MavLinkTxMissionCount},
+	{MAVLINK_MSG_ID_MISSION_ITEM, MavLinkTxMissionItem},
+	{MAVLINK_MSG_ID_MISSION_REQUEST, MavLinkTxMissionRequest},
+	{MAVLINK_MSG_ID_MISSION_ACK, MavLinkTxMissionAck}
+};
 
-        case MAVLINK_MSG_ID_VFR_HUD:
-            MavLinkSendVfrHud();
-        break;
+// CONTROLLER_DATA has no handler, as it's sent by MavLinkSendControllerData() every time the
+// controller runs. It's only scheduled to budget for it.
+static const MavLinkHandlerEntry dataloggerHandlers[] = {
+	{MAVLINK_MSG_ID_HEARTBEAT, MavLinkTxHeartbeat},
+	{MAVLINK_MSG_ID_SYS_STATUS, MavLinkTxStatus},
+	{MAVLINK_MSG_ID_NODE_STATUS, MavLinkTxNodeStatus},
+	{MAVLINK_MSG_ID_SYSTEM_TIME, MavLinkTxSystemTime},
+	{MAVLINK_MSG_ID_TOKIMEC_WITH_TIME, MavLinkTxTokimecWithTime},
+	{MAVLINK_MSG_ID_PARAM_VALUE_WITH_TIME, MavLinkTxDataloggerParameters},
+	{MAVLINK_MSG_ID_GPS_RAW_INT, MavLinkTxRawGps},
+	{MAVLINK_MSG_ID_MAIN_POWER, MavLinkTxMainPower}
+};
 
-        case MAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT:
-            MavLinkSendNavControllerOutput();
-        break;
+/**
+ * Times dispatched handlers in instruction cycles. Timer2 free-runs at F_OSC/2/256 and is only
+ * reset by the main loop, never while a handler is running.
+ */
+static uint32_t MavLinkDispatchClock(void)
+{
+	return (uint32_t)TMR2 << 8;
+}
 
-			/** SeaSlug Messages **/
+static void MavLinkRegisterHandlers(MavlinkDispatchTable *table, const MavLinkHandlerEntry *handlers, uint8_t count)
+{
+	uint8_t i;
+	MavlinkDispatchInit(table, MavLinkDispatchClock);
+	for (i = 0; i < count; ++i) {
+		if (!MavlinkDispatchRegister(table, handlers[i].MsgId, handlers[i].Handler)) {
+			FATAL_ERROR();
+		}
+	}
+}
 
-			case MAVLINK_MSG_ID_NODE_STATUS: {
-				MavLinkSendNodeStatus(MAVLINK_CHAN_GROUNDSTATION);
-			} break;
+static void MavLinkInitDispatch(void)
+{
+	MavLinkRegisterHandlers(&receiveDispatch, receiveHandlers, sizeof(receiveHandlers) / sizeof(receiveHandlers[0]));
+	MavLinkRegisterHandlers(&groundstationDispatch, groundstationHandlers, sizeof(groundstationHandlers) / sizeof(groundstationHandlers[0]));
+	MavLinkRegisterHandlers(&dataloggerDispatch, dataloggerHandlers, sizeof(dataloggerHandlers) / sizeof(dataloggerHandlers[0]));
+}
 
-			case MAVLINK_MSG_ID_WAYPOINT_STATUS: {
-				MavLinkSendWaypointStatusData();
-			} break;
+const MavlinkDispatchStats *MavLinkGetReceiveStats(uint8_t msgid)
+{
+	return MavlinkDispatchGetStats(&receiveDispatch, msgid);
+}
 
-			case MAVLINK_MSG_ID_WSO100: {
-				MavLinkSendWindAirData();
-			} break;
+const MavlinkDispatchStats *MavLinkGetTransmitStats(uint8_t channel, uint8_t msgid)
+{
+	if (channel == MAVLINK_CHAN_DATALOGGER) {
+		return MavlinkDispatchGetStats(&dataloggerDispatch, msgid);
+	} else if (channel == MAVLINK_CHAN_GROUNDSTATION) {
+		return MavlinkDispatchGetStats(&groundstationDispatch, msgid);
+	} else {
+		return NULL;
+	}
+}
 
-			case MAVLINK_MSG_ID_BASIC_STATE2:
-				MavLinkSendBasicState2();
-			break;
+const LinkStats *MavLinkGetLinkStats(uint8_t channel)
+{
+	if (channel == MAVLINK_CHAN_DATALOGGER) {
+		return &dataloggerLinkStats;
+	} else if (channel == MAVLINK_CHAN_GROUNDSTATION) {
+		return &groundstationLinkStats;
+	} else {
+		return NULL;
+	}
+}
 
-			case MAVLINK_MSG_ID_RUDDER_RAW:
-				MavLinkSendRudderRaw();
-			break;
+/**
+* @brief Receive communication packets and handle them. Should be called at the system sample rate.
+*
+* This function decodes packets on the protocol level and also handles
+* their value by calling the appropriate functions.
+*/
+void MavLinkReceive(void)
+{
+	mavlink_message_t rxMessage;
 
-			case MAVLINK_MSG_ID_DST800:
-				MavLinkSendDst800Data();
-			break;
+	// Parse everything received so far in place and release it from the UART buffer in one go
+	// afterwards, rather than pulling it out a byte at a time.
+	SpscBufferSpans rxSpans;
+	const uint16_t rxLength = Uart1GetReadSpans(&rxSpans);
+	uint16_t rxOffset = 0;
+	const uint32_t rxDiscarded = groundstationReceiver.stats.discardedBytes;
+	while (MavlinkReceiverNext(&groundstationReceiver, &rxSpans, rxLength, &rxOffset, &rxMessage)) {
+
+		// Latch the groundstation system and component ID if we haven't yet. We exclude the
+		// combination of systemid:3/compid:D, because that's the combo used by the 3DR radios.
+		if (!groundStationSystemId && !groundStationComponentId &&
+		    (rxMessage.sysid != '3' && rxMessage.compid != 'D')) {
+			groundStationSystemId = rxMessage.sysid;
+			groundStationComponentId = rxMessage.compid;
+		}
 
-			case MAVLINK_MSG_ID_GPS200:
-				MavLinkSendGps200Data();
-			break;
+                        // If the message is from the groundstation, update the received time
+                        if (rxMessage.sysid == groundStationSystemId &&
+                            rxMessage.compid == groundStationComponentId) {
+                            gcsLastTimeSeen = nodeSystemTime;
+                        }
+
+		// Only the groundstation's sequence numbers are tracked for lost messages, the radios
+		// number theirs separately.
+		LinkStatsReceiveMessage(&groundstationLinkStats,
+		                        rxMessage.sysid == groundStationSystemId && rxMessage.compid == groundStationComponentId,
+		                        rxMessage.seq);
 
-			case MAVLINK_MSG_ID_TOKIMEC:
-				MavLinkSendTokimec();
-			break;
+		MavlinkDispatch(&receiveDispatch, MAVLINK_CHAN_GROUNDSTATION, rxMessage.msgid, &rxMessage);
+	}
+	Uart1CommitRead(rxOffset);
+	LinkStatsReceive(&groundstationLinkStats, rxLength, rxOffset,
+	                 (uint16_t)(groundstationReceiver.stats.discardedBytes - rxDiscarded));
 
-			case MAVLINK_MSG_ID_MAIN_POWER:
-				MavLinkSendMainPower(MAVLINK_CHAN_GROUNDSTATION);
-			break;
+	// Update our stats of both messages received and number of times the link lost sync.
+	mavLinkMessagesReceived = groundstationReceiver.stats.messages;
+	mavLinkMessagesFailedParsing = groundstationReceiver.stats.resyncs;
+}
 
-			default: {
+/**
+ * Sends as many parameters from a stream as its schedule has bandwidth to spare for.
+ * @param spare The bytes left in the budget of the timestep that was just dispatched.
+ * @param freed The bytes of scheduled messages that were skipped during it, which the stream gets
+ *              both as room in the timestep and as credit.
+ * @param send The function sending a single parameter.
+ */
+static void MavLinkStreamParameters(ParamStream *stream, const MessageSchedule *schedule, uint16_t spare, uint16_t freed, void (*send)(uint16_t))
+{
+	uint16_t params[8];
+	uint32_t bps = GetSpareBps(schedule);
+	if (bps != UINT32_MAX) {
+		bps += (uint32_t)freed * schedule->TimestepRate;
+	}
+	uint8_t count = ParamStreamTick(stream, bps, spare + freed, params, sizeof(params) / sizeof(params[0]));
+	uint8_t i;
+	for (i = 0; i < count; ++i) {
+		send(params[i]);
+	}
+}
 
-			} break;
-		}
+/**
+ * This function handles transmission of MavLink messages taking into account transmission
+ * speed, message size, and desired transmission rate.
+ */
+void MavLinkTransmitGroundstation(void)
+{
+	// And now transmit all messages for this timestep, filling whatever room is left with parameters.
+	uint8_t msgs[GROUNDSTATION_SCHEDULE_NUM_MSGS];
+	const uint16_t spare = GetTimestepSpareBytes(&groundstationMavlinkSchedule);
+	uint8_t count = GetMessagesForTimestep(&groundstationMavlinkSchedule, msgs);
+	int i;
+	groundstationSuppressedBytes = 0;
+#if GROUNDSTATION_BATCHING
+	groundstationBatching = true;
+#endif
+	for (i = 0; i < count; ++i) {
+		MavlinkDispatch(&groundstationDispatch, MAVLINK_CHAN_GROUNDSTATION, msgs[i], NULL);
 	}
+	MavLinkStreamParameters(&groundstationParamStream, &groundstationMavlinkSchedule, spare, groundstationSuppressedBytes, MavLinkSendParamValue);
+#if GROUNDSTATION_BATCHING
+	MavLinkFlushGroundstationBatch();
+	groundstationBatching = false;
+#endif
+
+	LinkStatsTick(&groundstationLinkStats);
 }
 
 /**
@@ -2101,78 +2165,41 @@ void MavLinkTransmitGroundstation(void)
 void MavLinkTransmitDatalogger(void)
 {
     uint8_t msgs[DATALOGGER_SCHEDULE_NUM_MSGS];
+    const uint16_t spare = GetTimestepSpareBytes(&dataloggerMavlinkSchedule);
     uint8_t count = GetMessagesForTimestep(&dataloggerMavlinkSchedule, msgs);
     int i;
     for (i = 0; i < count; ++i) {
-        switch (msgs[i]) {
-            case MAVLINK_MSG_ID_HEARTBEAT:
-                MavLinkSendHeartbeat(MAVLINK_CHAN_DATALOGGER);
-                break;
-            case MAVLINK_MSG_ID_SYS_STATUS:
-                MavLinkSendStatus(MAVLINK_CHAN_DATALOGGER);
-                break;
-            case MAVLINK_MSG_ID_NODE_STATUS:
-                MavLinkSendNodeStatus(MAVLINK_CHAN_DATALOGGER);
-                break;
-            case MAVLINK_MSG_ID_SYSTEM_TIME:
-                MavLinkSendSystemTime(MAVLINK_CHAN_DATALOGGER);
-                break;
-            case MAVLINK_MSG_ID_TOKIMEC_WITH_TIME:
-                MavLinkSendTokimecWithTime();
-                break;
-            case MAVLINK_MSG_ID_PARAM_VALUE_WITH_TIME:
-                MavLinkSendDataloggerParameters(true);
-                break;
-            case MAVLINK_MSG_ID_GPS_RAW_INT:
-                MavLinkSendRawGps(MAVLINK_CHAN_DATALOGGER);
-			break;
-            case MAVLINK_MSG_ID_MAIN_POWER:
-                MavLinkSendMainPower(MAVLINK_CHAN_DATALOGGER);
-			break;
-            default:
-            break;
-         }
-     }
+        // CONTROLLER_DATA is sent along with the controller's output instead.
+        if (msgs[i] != MAVLINK_MSG_ID_CONTROLLER_DATA) {
+            MavlinkDispatch(&dataloggerDispatch, MAVLINK_CHAN_DATALOGGER, msgs[i], NULL);
+        }
+    }
+    MavLinkStreamParameters(&dataloggerParamStream, &dataloggerMavlinkSchedule, spare, 0, MavLinkSendDataloggerParameter);
 
-    // Always attempt to send the datalogger parameters. This simplifies the logic somewhat.
-    MavLinkSendDataloggerParameters(false);
+    LinkStatsTick(&dataloggerLinkStats);
 }
 
 /**
- * Every call to this function transmits another parameter using the timestamped
- * PARAM_VALUE_WITH_TIME message. These are transmit out on the datalogger channel
- * @param reset True to reset the internal counter. If true, this **will not** transmit a message.
+ * Transmits a parameter to the datalogger using the timestamped PARAM_VALUE_WITH_TIME message.
+ * @param id The ID of this parameter.
  */
-void MavLinkSendDataloggerParameters(bool reset)
+void MavLinkSendDataloggerParameter(uint16_t id)
 {
-    static uint8_t pid = 0, count = 0;
-    if (reset) {
-        pid = 0;
-        count = 0;
-    } else if (pid < PARAMETERS_TOTAL) {
+    if (id < PARAMETERS_TOTAL) {
         // Get the value from the Parameter library using it's provided numeric ID
         float param_value = 0.0;
-        ParameterGetValueById(pid, &param_value);
+        ParameterGetValueById(id, &param_value);
 
         // Finally encode the message and transmit.
-        mavlink_msg_param_value_with_time_pack_chan(
-            mavlink_system.sysid, mavlink_system.compid, MAVLINK_CHAN_DATALOGGER,
-            &txMessage,
-            nodeSystemTime * 10,
-            onboardParameters[pid].name, param_value, onboardParameters[pid].dataType,
-            PARAMETERS_TOTAL, pid);
-        len = mavlink_msg_to_send_buffer(buf, &txMessage);
-        Uart2WriteData(buf, (uint8_t)len);
-
-        // Track how many times this message had been sent.
-        ++count;
-        if (count == DATALOGGER_PARAM_TRANSMIT_COUNT) {
-            // Reset the counter
-            count = 0;
-
-            // And increment the pid for next time
-            ++pid;
-        }
+        mavlink_param_value_with_time_t paramValueWithTime = {
+            .time_boot_ms = nodeSystemTime * 10,
+            .param_value = param_value,
+            .param_type = onboardParameters[id].dataType,
+            .param_count = PARAMETERS_TOTAL,
+            .param_index = id
+        };
+        strncpy(paramValueWithTime.param_id, onboardParameters[id].name, MAVLINK_MSG_PARAM_VALUE_WITH_TIME_FIELD_PARAM_ID_LEN);
+        MAVLINK_TRANSMIT(MAVLINK_CHAN_DATALOGGER, PARAM_VALUE_WITH_TIME, &paramValueWithTime);
     }
 }
 
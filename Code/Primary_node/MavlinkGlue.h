@@ -6,11 +6,11 @@
  * The main functions are at the bottom: MavLinkTransmit() and MavLinkReceive()
  * handle the dispatching of messages (and sending of non-FSM reliant ones) and
  * the reception of messages and forwarding of reception events to the relevent
- * FSMs. The two state machine functions (MavLinkEvaluateMissionState and
- * MavLinkEvaluateParameterState) both contain all of the state logic for the
- * MAVLink mission and parameter protocols. As the specifications for those two
- * protocols are not fully defined they have been tested with QGroundControl to
- * work correctly.
+ * FSMs. Mission uploads and downloads are pipelined through a MissionTransfer
+ * (see MissionTransfer.h), while parameters are streamed using whatever
+ * bandwidth the schedules leave spare (see ParamStream.h). As the
+ * specifications for those two protocols are not fully defined they have been
+ * tested with QGroundControl to work correctly.
  *
  * This code was written to be as generic as possible. If you remove all of the
  * custom messages and switch the transmission from uart1EnqueueData() it should
@@ -23,6 +23,8 @@
 
 // Need this in the header because of MavLinkSendStatusText()
 #include <mavlink.h>
+#include "MavlinkDispatch.h"
+#include "LinkStats.h"
 
 #include "Types.h"
 // Define M_PI_2 here for the MAVLink library as the XC16 doesn't provide this constant by default.
@@ -50,6 +52,32 @@ void MavLinkInit(void);
  */
 uint8_t MavLinkGetChannelUsage(uint8_t channel);
 
+/**
+ * Returns how often a received message was handled, how many bytes of it were handled, and how many
+ * instruction cycles its handler took in total.
+ * @param msgid The ID of the message.
+ * @return The statistics, or NULL if the message isn't handled.
+ */
+const MavlinkDispatchStats *MavLinkGetReceiveStats(uint8_t msgid);
+
+/**
+ * Returns how often a scheduled message was transmitted over a channel, how many bytes of it were
+ * actually queued, and how many instruction cycles transmitting it took in total. Messages dropped
+ * for lack of room or skipped as unchanged count no bytes.
+ * @param channel The channel selected, see enum SeaslugMavlinkChannel
+ * @param msgid The ID of the message.
+ * @return The statistics, or NULL if the message isn't scheduled on this channel.
+ */
+const MavlinkDispatchStats *MavLinkGetTransmitStats(uint8_t channel, uint8_t msgid);
+
+/**
+ * Returns the byte and message counters, losses, buffer high-water marks, and throughput of a
+ * channel. These are also reported to the groundstation in LINK_STATS messages.
+ * @param channel The channel selected, see enum SeaslugMavlinkChannel
+ * @return The statistics, or NULL for an unknown channel.
+ */
+const LinkStats *MavLinkGetLinkStats(uint8_t channel);
+
 /**
  * This function creates a MAVLink heartbeat message with some basic parameters and
  * caches that message (along with its size) in the module-level variables declared
@@ -89,14 +117,8 @@ void MavLinkSendControllerData(const ImuData *imu, const GpsData *gps, float wat
 void GetMavLinkManualControl(float *rc, int16_t *tc);
 
 /**
- * Increments the parameter counter for use within MAVLink's parameter protocol. Should be called at
- * a constant rate.
- */
-void IncrementParameterCounter(void);
-
-/**
- * Increments the mission counter for use within MAVLink's parameter protocol. Should be called at
- * a constant rate.
+ * Advances the timing of the mission protocol and sends any requests or items that timed out.
+ * Should be called at a constant rate, before the groundstation messages are transmitted.
  */
 void IncrementMissionCounter(void);
 
@@ -123,11 +145,10 @@ void MavLinkTransmitGroundstation(void);
 void MavLinkTransmitDatalogger(void);
 
 /**
- * Transmit all MAVLink parameters as double-transmitted PARAM_VALUE messages. This useful for
- * debugging purposes as then the log contains a record of all parameter settings. Note that if this
- * process is interrupted by a request for all parameters, it will stop doing its state machine and
- * switch over to following the parameter protocol. This is not the case when receiving a SET message,
- * that will be ignored and have to be caught by a timeout on the groundstation side.
+ * Transmit all MAVLink parameters to the datalogger as PARAM_VALUE_WITH_TIME messages, sending the
+ * whole table twice. This useful for debugging purposes as then the log contains a record of all
+ * parameter settings. The parameters are streamed using the datalogger's spare bandwidth, separately
+ * from any requested by the groundstation.
  */
 void MavLinkTransmitAllParameters(void);
 
@@ -0,0 +1,55 @@
+/**
+ * @file   PrimaryCanFilters.h
+ * @brief  The CAN messages the primary node receives, see EcanFilterPlanner.h.
+ *
+ * These are the messages ProcessAllEcanMessages() in EcanSensors.c handles, and everything else is
+ * rejected by the ECAN hardware. Its handlers are registered from the same list. They're also
+ * shared with Scripts/C/EcanFilterReport.c, which measures how well the filters do on recorded bus
+ * traffic.
+ */
+#ifndef PRIMARY_CAN_FILTERS_H
+#define PRIMARY_CAN_FILTERS_H
+
+#include "EcanFilterPlanner.h"
+#include "Acs300.h"
+#include "CanMessages.h"
+#include "Nmea2000.h"
+
+// Every message as (ID or PGN, whether it's a PGN, the EcanSensors.c function handling it). This
+// is expanded into both the filter targets below and the dispatch table of ProcessAllEcanMessages(),
+// so a handled message can't be missing from the filters.
+#define PRIMARY_CAN_MESSAGES(MESSAGE) \
+	/* From the ACS300 */ \
+	MESSAGE(ACS300_CAN_ID_HRTBT, false, HandleAcs300Heartbeat) \
+	MESSAGE(ACS300_CAN_ID_WR_PARAM, false, HandleAcs300WriteParam) \
+	/* From the other nodes and the IMU */ \
+	MESSAGE(CAN_MSG_ID_STATUS, false, HandleNodeStatus) \
+	MESSAGE(CAN_MSG_ID_RUDDER_DETAILS, false, HandleRudderDetails) \
+	MESSAGE(CAN_MSG_ID_IMU_DATA, false, HandleImuData) \
+	MESSAGE(CAN_MSG_ID_ANG_VEL_DATA, false, HandleAngularVelocityData) \
+	MESSAGE(CAN_MSG_ID_ACCEL_DATA, false, HandleAccelerationData) \
+	MESSAGE(CAN_MSG_ID_GPS_POS_DATA, false, HandleGpsPosData) \
+	MESSAGE(CAN_MSG_ID_GPS_EST_POS_DATA, false, HandleGpsEstPosData) \
+	MESSAGE(CAN_MSG_ID_GPS_VEL_DATA, false, HandleGpsVelData) \
+	/* NMEA2000 sensors, the RC and rudder nodes, and the power node */ \
+	MESSAGE(PGN_ID_SYSTEM_TIME, true, HandleSystemTime) \
+	MESSAGE(PGN_ID_RUDDER, true, HandleRudder) \
+	MESSAGE(PGN_ID_BATTERY_STATUS, true, HandleBatteryStatus) \
+	MESSAGE(PGN_ID_SPEED, true, HandleSpeed) \
+	MESSAGE(PGN_ID_WATER_DEPTH, true, HandleWaterDepth) \
+	MESSAGE(PGN_ID_POSITION_RAP_UPD, true, HandlePositionRapidUpdate) \
+	MESSAGE(PGN_ID_COG_SOG_RAP_UPD, true, HandleCogSogRapidUpdate) \
+	MESSAGE(PGN_ID_GNSS_DOPS, true, HandleGnssDops) \
+	MESSAGE(PGN_ID_WIND_DATA, true, HandleWindData) \
+	MESSAGE(PGN_ID_ENV_PARAMETERS, true, HandleEnvParameters) \
+	MESSAGE(PGN_ID_ENV_PARAMETERS2, true, HandleEnvParameters2) \
+	MESSAGE(PGN_ID_DC_SOURCE_STATUS, true, HandleDcSourceStatus) \
+	MESSAGE(PGN_ID_GNSS_POSITION_DATA, true, HandleGnssPositionData)
+
+#define PRIMARY_CAN_FILTER_TARGET(id, pgn, handler) {id, pgn},
+static const EcanFilterTarget primaryCanFilterTargets[] = {
+	PRIMARY_CAN_MESSAGES(PRIMARY_CAN_FILTER_TARGET)
+};
+#define PRIMARY_CAN_FILTER_TARGET_COUNT (sizeof(primaryCanFilterTargets) / sizeof(primaryCanFilterTargets[0]))
+
+#endif // PRIMARY_CAN_FILTERS_H
@@ -20,6 +20,7 @@
 #include "PrimaryNode.h"
 #include "DataStore.h"
 #include "EcanSensors.h"
+#include "PrimaryCanFilters.h"
 #include "Rudder.h"
 #include "Actuators.h"
 #include "MissionManager.h"
@@ -183,8 +184,15 @@ int main(void)
         FATAL_ERROR();
     }
 
-    // Initialize ECAN1
-    Ecan1Init(F_OSC, NODE_CAN_BAUD);
+    // Initialize ECAN1, only receiving the messages ProcessAllEcanMessages() handles.
+    {
+        EcanFilterRegisters canFilters;
+        if (!EcanFilterPlan(primaryCanFilterTargets, PRIMARY_CAN_FILTER_TARGET_COUNT, &canFilters, NULL)) {
+            FATAL_ERROR();
+        }
+        Ecan1InitFiltered(F_OSC, NODE_CAN_BAUD, &canFilters);
+    }
+    EcanSensorsInit();
 
     // Set up the ADC
     Adc1Init();
@@ -487,15 +495,16 @@ void PrimaryNode100HzLoop(void)
     // First update the status of any onboard sensors.
     UpdateSensorsAvailability();
 
-    // Increment the counters for the mission and parameter protocols. They need to time some things
-    // this way, as they're normally called as fast as possible, so this external counter method is
-    // used.
+    // Advance the timeouts of the mission protocol. Its messages are handled as fast as possible
+    // in MavLinkReceive(), so its retransmissions are timed from here instead.
     IncrementMissionCounter();
-    IncrementParameterCounter();
 
     // Clear state on when errors
     ClearStateWhenErrors();
 
+    // Roll over the CAN bus statistics every second.
+    Ecan1TickMonitor();
+
     // Check ADC inputs
     // Battery voltage in Volts
     analogSensors.powerRailVoltage = (3.3 / ANmax) / .06369 * (float)adcDmaBuffer[0];
@@ -0,0 +1,86 @@
+/**
+ * @file   PrimaryNodeHost.c
+ * @brief  Runs the CAN side of the primary node as a Linux process on a virtual CAN bus.
+ *
+ * The controller, MAVLink, and mission code need the generated controller.h, so only the CAN side
+ * runs: every message EcanSensors.c handles is received and tracked as in PrimaryNode100HzLoop(),
+ * and the status is sent at 2Hz. In place of the controller, it has the rudder calibrate and then
+ * sweeps it 0.4 rad either way every 20s. Every second it prints which nodes it hears, the rudder
+ * angle, and the bus load. See NodeHost.h for its options.
+ *
+ * Build on the host with:
+ * `gcc PrimaryNodeHost.c EcanSensors.c ../Libs/C/{NodeHost,Ecan1Host,VirtualCan,CanBusMonitor,CanDispatch,EcanFilterPlanner,EcanTxScheduler,CanFrameQueue,Node,CanMessages,Nmea2000,Nmea2000Encode,Rudder,Acs300,Tokimec}.c -I. -I../Libs/C -O2 -Wall -pthread -lrt -lm -o PrimaryNode`
+ */
+#include "NodeHost.h"
+#include "Node.h"
+#include "Ecan1.h"
+#include "Rudder.h"
+#include "EcanSensors.h"
+#include "PrimaryCanFilters.h"
+#include "PrimaryNode.h"
+
+#include <math.h>
+#include <stdio.h>
+
+// Keep track of the processor's operating frequency.
+#define F_OSC 80000000L
+
+// The period of the rudder sweep in .01s, and its amplitude in radians.
+#define SWEEP_PERIOD    2000
+#define SWEEP_AMPLITUDE 0.4f
+
+// Normally set by the controller, and by the RC node for manual control.
+ActuatorCommands currentCommands;
+
+int main(int argc, char *argv[])
+{
+    NodeHostInit("primary", argc, argv);
+    nodeId = CAN_NODE_PRIMARY_CONTROLLER;
+
+    // Initialize ECAN1, only receiving the messages ProcessAllEcanMessages() handles.
+    {
+        EcanFilterRegisters canFilters;
+        if (!EcanFilterPlan(primaryCanFilterTargets, PRIMARY_CAN_FILTER_TARGET_COUNT, &canFilters, NULL)) {
+            FATAL_ERROR();
+        }
+        Ecan1InitFiltered(F_OSC, NODE_CAN_BAUD, &canFilters);
+    }
+    EcanSensorsInit();
+
+    while (NodeHostTick()) {
+        ProcessAllEcanMessages();
+        UpdateSensorsAvailability();
+        Ecan1TickMonitor();
+
+        // Have the rudder calibrate once it's up, then sweep it.
+        if (sensorAvailability.rudder.enabled && NodeHostEvery(10)) {
+            if (rudderSensorData.Calibrated && !rudderSensorData.Calibrating) {
+                currentCommands.autonomousRudderCommand =
+                    SWEEP_AMPLITUDE * sinf(2 * M_PI * (nodeSystemTime % SWEEP_PERIOD) / SWEEP_PERIOD);
+                RudderSendAngleCommand(nodeId, currentCommands.autonomousRudderCommand);
+            } else if (!rudderSensorData.Calibrating && NodeHostEvery(1)) {
+                RudderStartCalibration();
+            }
+        }
+
+        if (NodeHostEvery(2)) {
+            NodeTransmitStatus();
+        }
+
+        if (NodeHostEvery(1)) {
+            CanBusMonitorTotals totals = {};
+            Ecan1GetMonitorTotals(&totals);
+            printf("primary: %4us, rudder %s %+.3f rad (commanded %+.3f), power %s, rc %s, "
+                   "bus load %.1f%%, %u frames/s\n",
+                   nodeSystemTime / 100,
+                   sensorAvailability.rudder.enabled ? "on" : "off",
+                   rudderSensorData.RudderAngle, currentCommands.autonomousRudderCommand,
+                   sensorAvailability.power.enabled ? "on" : "off",
+                   sensorAvailability.rcNode.enabled ? "on" : "off",
+                   totals.Load / 10.0, totals.Rate);
+        }
+    }
+
+    NodeHostExit();
+    return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file   TelemetryFilters.h
+ * @brief  The change filters of the scheduled groundstation telemetry, see ChangeFilter.h.
+ *
+ * These messages are only sent to the groundstation when they changed beyond the deadbands below, or
+ * TELEMETRY_FILTER_MAX_INTERVAL passed since they were last sent. They're shared by MavlinkGlue.c and
+ * Scripts/C/TelemetryReplay.c, which measures what they save on recorded runs.
+ */
+#ifndef TELEMETRY_FILTERS_H
+#define TELEMETRY_FILTERS_H
+
+#include <stdint.h>
+
+#include <mavlink.h>
+
+// The longest an unchanged message goes unsent, in 10ms ticks of nodeSystemTime. Long enough to cut
+// the repeats of the 1-2Hz sensor messages down, short enough that a stale value doesn't sit on the
+// groundstation's display unnoticed.
+#define TELEMETRY_FILTER_MAX_INTERVAL 500
+
+/**
+ * The filter of a single message type.
+ */
+typedef struct {
+	uint8_t MsgId;
+	const mavlink_message_info_t *Info;
+	const float *Deadbands; // One per field of Info, in its order, in the units of that field.
+} TelemetryFilterConfig;
+
+static const mavlink_message_info_t telemetryFilterGps200Info = MAVLINK_MESSAGE_INFO_GPS200;
+static const mavlink_message_info_t telemetryFilterDst800Info = MAVLINK_MESSAGE_INFO_DST800;
+static const mavlink_message_info_t telemetryFilterWso100Info = MAVLINK_MESSAGE_INFO_WSO100;
+static const mavlink_message_info_t telemetryFilterNodeStatusInfo = MAVLINK_MESSAGE_INFO_NODE_STATUS;
+static const mavlink_message_info_t telemetryFilterMainPowerInfo = MAVLINK_MESSAGE_INFO_MAIN_POWER;
+static const mavlink_message_info_t telemetryFilterRudderRawInfo = MAVLINK_MESSAGE_INFO_RUDDER_RAW;
+
+// Magnetic variation, degrees.
+static const float telemetryFilterGps200Deadbands[] = {0.1f};
+
+// Water speed m/s, temperature C, depth m.
+static const float telemetryFilterDst800Deadbands[] = {0.05f, 0.2f, 0.2f};
+
+// Wind speed m/s, direction rad, air temperature C, pressure Pa, humidity %.
+static const float telemetryFilterWso100Deadbands[] = {0.2f, 0.05f, 0.2f, 20.0f, 1.0f};
+
+// Status and error bitfields are sent on any change. Temperatures C, loads %, voltages 0.1V.
+static const float telemetryFilterNodeStatusDeadbands[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 5, 1, 1, 5, 1, 1, 5, 1, 1, 5, 1, 1, 5, 1, 1, 5, 1
+};
+
+// Voltages mV and currents mA.
+static const float telemetryFilterMainPowerDeadbands[] = {50, 50, 50, 50, 50, 50};
+
+// The rudder potentiometer in ADC counts, its calibration and limit switches on any change.
+static const float telemetryFilterRudderRawDeadbands[] = {4, 0, 0, 0, 0, 0};
+
+#define TELEMETRY_FILTER_COUNT 6
+static const TelemetryFilterConfig telemetryFilterConfigs[TELEMETRY_FILTER_COUNT] = {
+	{MAVLINK_MSG_ID_GPS200, &telemetryFilterGps200Info, telemetryFilterGps200Deadbands},
+	{MAVLINK_MSG_ID_DST800, &telemetryFilterDst800Info, telemetryFilterDst800Deadbands},
+	{MAVLINK_MSG_ID_WSO100, &telemetryFilterWso100Info, telemetryFilterWso100Deadbands},
+	{MAVLINK_MSG_ID_NODE_STATUS, &telemetryFilterNodeStatusInfo, telemetryFilterNodeStatusDeadbands},
+	{MAVLINK_MSG_ID_MAIN_POWER, &telemetryFilterMainPowerInfo, telemetryFilterMainPowerDeadbands},
+	{MAVLINK_MSG_ID_RUDDER_RAW, &telemetryFilterRudderRawInfo, telemetryFilterRudderRawDeadbands}
+};
+
+#endif // TELEMETRY_FILTERS_H
@@ -0,0 +1,20 @@
+/**
+ * @file   RcCanFilters.h
+ * @brief  The CAN messages the RC node receives, see EcanFilterPlanner.h.
+ *
+ * These are the messages ProcessAllEcanMessages() in RcNode.c handles, and everything else is
+ * rejected by the ECAN hardware, so anything handled there needs to be listed here too. They're
+ * shared with Scripts/C/EcanFilterReport.c.
+ */
+#ifndef RC_CAN_FILTERS_H
+#define RC_CAN_FILTERS_H
+
+#include "EcanFilterPlanner.h"
+#include "CanMessages.h"
+
+static const EcanFilterTarget rcCanFilterTargets[] = {
+	{CAN_MSG_ID_STATUS, false}
+};
+#define RC_CAN_FILTER_TARGET_COUNT (sizeof(rcCanFilterTargets) / sizeof(rcCanFilterTargets[0]))
+
+#endif // RC_CAN_FILTERS_H
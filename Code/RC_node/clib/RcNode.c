@@ -1,6 +1,7 @@
 #include "Uart1.h"
 #include "Ecan1.h"
 #include "CanMessages.h"
+#include "RcCanFilters.h"
 #include "Node.h"
 #include "RcNode.h"
 #include "DataStore.h"
@@ -15,8 +16,12 @@ void RcNodeInit(void)
 {
 	nodeId = CAN_NODE_RC;
 
-	// Initialize our ECAN peripheral
-	Ecan1Init(F_OSC, NODE_CAN_BAUD);
+	// Initialize our ECAN peripheral, only receiving the messages ProcessAllEcanMessages() handles.
+	EcanFilterRegisters canFilters;
+	if (!EcanFilterPlan(rcCanFilterTargets, RC_CAN_FILTER_TARGET_COUNT, &canFilters, NULL)) {
+		FATAL_ERROR();
+	}
+	Ecan1InitFiltered(F_OSC, NODE_CAN_BAUD, &canFilters);
 	
 	// Initialize the EEPROM for storing the onboard parameters.
 	enum DATASTORE_INIT x = DataStoreInit();
@@ -1,6 +1,7 @@
 #ifndef RC_NODE_H
 #define RC_NODE_H
 
+#include <stdint.h>
 #include <stdbool.h>
 
 // Keep track of the processor's operating frequency.
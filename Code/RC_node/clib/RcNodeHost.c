@@ -0,0 +1,41 @@
+/**
+ * @file   RcNodeHost.c
+ * @brief  Runs the RC node as a Linux process on a virtual CAN bus, see NodeHost.h.
+ *
+ * Only its CAN side runs: there's no RC receiver, so it reports that the transmitter is
+ * disconnected, and it prints when the primary node enters or leaves e-stop.
+ *
+ * Build on the host with:
+ * `gcc RcNodeHost.c RcNode.c ../../Libs/C/{NodeHost,Ecan1Host,VirtualCan,CanBusMonitor,EcanFilterPlanner,EcanTxScheduler,CanFrameQueue,Node,CanMessages,Nmea2000}.c -I. -I../../Libs/C -O2 -Wall -pthread -lrt -lm -o RcNode`
+ */
+#include "NodeHost.h"
+#include "RcNode.h"
+#include "Node.h"
+
+#include <stdio.h>
+
+int main(int argc, char *argv[])
+{
+	bool estop = false;
+
+	NodeHostInit("rc", argc, argv);
+	RcNodeInit();
+	if (!restoredCalibration) {
+		nodeErrors |= RC_NODE_RESET_UNCALIBRATED;
+	}
+
+	while (NodeHostTick()) {
+		ProcessAllEcanMessages();
+		if (GetEstopStatus() != estop) {
+			estop = GetEstopStatus();
+			printf("rc: e-stop %s\n", estop ? "engaged" : "released");
+		}
+
+		if (NodeHostEvery(2)) {
+			NodeTransmitStatus();
+		}
+	}
+
+	NodeHostExit();
+	return 0;
+}
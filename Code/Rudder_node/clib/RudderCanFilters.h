@@ -0,0 +1,24 @@
+/**
+ * @file   RudderCanFilters.h
+ * @brief  The CAN messages the rudder node receives, see EcanFilterPlanner.h.
+ *
+ * These are the messages ProcessAllEcanMessages() in RudderNode.c handles, and everything else is
+ * rejected by the ECAN hardware, so anything handled there needs to be listed here too. They're
+ * shared with Scripts/C/EcanFilterReport.c.
+ */
+#ifndef RUDDER_CAN_FILTERS_H
+#define RUDDER_CAN_FILTERS_H
+
+#include "EcanFilterPlanner.h"
+#include "CanMessages.h"
+#include "Nmea2000.h"
+
+static const EcanFilterTarget rudderCanFilterTargets[] = {
+	{CAN_MSG_ID_RUDDER_SET_STATE, false},
+	{CAN_MSG_ID_RUDDER_SET_TX_RATE, false},
+	{CAN_MSG_ID_STATUS, false},
+	{PGN_ID_RUDDER, true}
+};
+#define RUDDER_CAN_FILTER_TARGET_COUNT (sizeof(rudderCanFilterTargets) / sizeof(rudderCanFilterTargets[0]))
+
+#endif // RUDDER_CAN_FILTERS_H
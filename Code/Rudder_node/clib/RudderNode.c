@@ -1,13 +1,16 @@
 #include <math.h>
 
 #include "Ecan1.h"
+#if defined(__XC16__)
 #include "rudder_node.h"
+#endif
 #include "MessageScheduler.h"
 #include "RudderNode.h"
 #include "Node.h"
 #include "Nmea2000.h"
 #include "Nmea2000Encode.h"
 #include "CanMessages.h"
+#include "RudderCanFilters.h"
 #include "Types.h"
 #include "DataStore.h"
 
@@ -102,14 +105,20 @@ static uint8_t ids[ECAN_MSGS_SIZE] = {
     SCHED_ID_TEMPERATURE,
     SCHED_ID_STATUS
 };
-static uint16_t tsteps[ECAN_MSGS_SIZE][2][8] = {};
+static uint8_t  tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+static uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+static MessageScheduleSlot slots[ECAN_MSGS_SIZE] = {};
 static uint8_t  mSizes[ECAN_MSGS_SIZE];
 static MessageSchedule sched = {
 	ECAN_MSGS_SIZE,
 	ids,
 	mSizes,
 	0,
-	tsteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	tstepLists,
+	tstepBytes,
+	slots
 };
 
 // Function prototypes
@@ -119,18 +128,26 @@ void RudderNodeInit(void)
 {
 	nodeId = CAN_NODE_RUDDER_CONTROLLER;
 
-	// Initialize our ECAN peripheral
-	Ecan1Init(F_OSC, NODE_CAN_BAUD);
+	// Initialize our ECAN peripheral, only receiving the messages ProcessAllEcanMessages() handles.
+	EcanFilterRegisters canFilters;
+	if (!EcanFilterPlan(rudderCanFilterTargets, RUDDER_CAN_FILTER_TARGET_COUNT, &canFilters, NULL)) {
+		FATAL_ERROR();
+	}
+	Ecan1InitFiltered(F_OSC, NODE_CAN_BAUD, &canFilters);
 
+#if defined(__XC16__)
     // Enable the red error LED by setting its driving pin to an output
     _TRISA3 = 0;
+#endif
 
 	// Initialize the EEPROM for storing the onboard parameters.
 	enum DATASTORE_INIT x = DataStoreInit();
 	if (x == DATASTORE_INIT_SUCCESS) {
 		rudderCalData.RestoredCalibration = true;
 		rudderCalData.Calibrated = true;
+#if defined(__XC16__)
 		LATAbits.LATA3 = 1;
+#endif
 	} else if (x == DATASTORE_INIT_FAIL) {
 		FATAL_ERROR();
 	}
@@ -345,11 +362,13 @@ void SendAndReceiveEcan(void)
     // if the rudder or propeller subsystems go offline and back online that they'll receive
     // the message and hopefully respond properly.
     if (nodeErrors != lastErrorState) {
+#if defined(__XC16__)
         if (nodeErrors) {
             _LATA3 = 1; // Turn on the red LED if there are errors
         } else {
             _LATA3 = 0; // And turn it off if there aren't.
         }
+#endif
         lastErrorState = nodeErrors;
     }
 
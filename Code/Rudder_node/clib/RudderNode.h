@@ -53,6 +53,12 @@ extern struct RudderSensorData rudderSensorData;
  */
 void RudderSubsystemInit(void);
 
+/**
+ * Initialize the rudder node: ECAN1, the stored calibration, and
+ * the scheduled CAN messages.
+ */
+void RudderNodeInit(void);
+
 void RudderCalibrate(void);
 
 /**
@@ -105,4 +111,9 @@ float GetNewAngle(void);
  */
 float PotToRads(uint16_t input, uint16_t highSide, uint16_t lowSide);
 
+/**
+ * Update the rudder angle from the potentiometer reading.
+ */
+void CalculateRudderAngle(void);
+
 #endif // RUDDER_NODE_H
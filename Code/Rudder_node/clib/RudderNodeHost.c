@@ -0,0 +1,94 @@
+/**
+ * @file   RudderNodeHost.c
+ * @brief  Runs the rudder node as a Linux process on a virtual CAN bus, see NodeHost.h.
+ *
+ * The motor, potentiometer, and limit switches are simulated: the rudder turns at the rate
+ * RudderCheckForMotorStall() expects, towards the commanded angle once calibrated. Without an
+ * EEPROM it starts uncalibrated, and calibrates when the primary node asks it to.
+ *
+ * Build on the host with:
+ * `gcc RudderNodeHost.c RudderNode.c ../../Libs/C/{NodeHost,Ecan1Host,VirtualCan,CanBusMonitor,EcanFilterPlanner,EcanTxScheduler,CanFrameQueue,Node,CanMessages,MessageScheduler,Nmea2000,Nmea2000Encode}.c -I. -I../../Libs/C -O2 -Wall -pthread -lrt -lm -o RudderNode`
+ */
+#include "NodeHost.h"
+#include "RudderNode.h"
+#include "Node.h"
+
+#include <stdio.h>
+
+// The potentiometer readings at the limit switches.
+#define POT_PORT_END      1000
+#define POT_STARBOARD_END 3000
+
+// How far the potentiometer turns every timestep, for 0.343 rad/s over the 90 degree range.
+#define POT_STEP 4
+
+// How close the rudder gets to the commanded angle before the motor stops, in radians.
+#define ANGLE_DEADBAND 0.01f
+
+/**
+ * Runs the motor for a timestep, in the direction calibration wants or else towards the commanded
+ * angle, and updates the sensors.
+ */
+static void SimulateRudder(void)
+{
+    int direction = 0; // Positive to starboard, which increases the potentiometer reading.
+
+    if (rudderCalData.CommandedRun) {
+        direction = rudderCalData.CommandedDirection ? -1 : 1;
+    } else if (rudderCalData.Calibrated && !nodeErrors) {
+        float error = rudderSensorData.CommandedRudderAngle - rudderSensorData.RudderPositionAngle;
+        if (error > ANGLE_DEADBAND) {
+            direction = -1;
+        } else if (error < -ANGLE_DEADBAND) {
+            direction = 1;
+        }
+    }
+
+    int pot = (int)rudderSensorData.PotValue + direction * POT_STEP;
+    if (pot < POT_PORT_END) {
+        pot = POT_PORT_END;
+    } else if (pot > POT_STARBOARD_END) {
+        pot = POT_STARBOARD_END;
+    }
+    rudderSensorData.PotValue = pot;
+    rudderSensorData.PortLimit = pot == POT_PORT_END;
+    rudderSensorData.StarLimit = pot == POT_STARBOARD_END;
+
+    if (rudderCalData.Calibrated) {
+        CalculateRudderAngle();
+    }
+
+    nodeStatus = (rudderCalData.Calibrated ? RUDDER_NODE_STATUS_CALIBRATED : 0) |
+                 (rudderCalData.Calibrating ? RUDDER_NODE_STATUS_CALIBRATING : 0) |
+                 (rudderSensorData.StarLimit ? RUDDER_NODE_STATUS_STARBOARD_LIMIT : 0) |
+                 (rudderSensorData.PortLimit ? RUDDER_NODE_STATUS_PORT_LIMIT : 0);
+}
+
+int main(int argc, char *argv[])
+{
+    bool calibrating = false;
+
+    NodeHostInit("rudder", argc, argv);
+    RudderNodeInit();
+    rudderSensorData.PotValue = (POT_PORT_END + POT_STARBOARD_END) / 2;
+    rudderSensorData.Temperature = 25.0f;
+
+    while (NodeHostTick()) {
+        SendAndReceiveEcan();
+        RudderCalibrate();
+        SimulateRudder();
+
+        if (rudderCalData.Calibrating != calibrating) {
+            calibrating = rudderCalData.Calibrating;
+            if (calibrating) {
+                printf("rudder: calibrating\n");
+            } else {
+                printf("rudder: calibrated, port limit %u, starboard limit %u\n",
+                       rudderCalData.PortLimitValue, rudderCalData.StarLimitValue);
+            }
+        }
+    }
+
+    NodeHostExit();
+    return 0;
+}
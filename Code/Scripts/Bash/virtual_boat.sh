@@ -0,0 +1,44 @@
+#!/bin/bash
+# This script runs the primary, rudder, power, and RC nodes as Linux processes that talk over a
+# virtual CAN bus (see Code/Libs/C/Ecan1Host.h and NodeHost.h).
+# Inputs:
+#   * Any options are passed on to every node, like `-t 60` to stop after a minute, `-l 1000` to
+#     lose 0.1% of frames, or `-s vcan0` to use a SocketCAN interface instead.
+#
+# Requirements
+#   * gcc
+#
+# Actions
+#   * Builds the nodes into $BUILD_DIR, /tmp/autoboat-host by default
+#   * Creates a fresh shared memory bus named "autoboat", unless another one was picked
+#   * Runs the nodes until they stop, stopping them all when this script is interrupted
+CODE_DIR=$(cd "$(dirname "$0")/../.." && pwd)
+BUILD_DIR=${BUILD_DIR:-/tmp/autoboat-host}
+LIBS=$CODE_DIR/Libs/C
+CFLAGS="-I$LIBS -O2 -Wall"
+LDFLAGS="-pthread -lrt -lm"
+HOST="$LIBS/NodeHost.c $LIBS/Ecan1Host.c $LIBS/VirtualCan.c $LIBS/CanBusMonitor.c $LIBS/EcanFilterPlanner.c $LIBS/EcanTxScheduler.c $LIBS/CanFrameQueue.c $LIBS/Node.c $LIBS/CanMessages.c $LIBS/Nmea2000.c"
+
+set -e
+mkdir -p $BUILD_DIR
+gcc $CFLAGS -I$CODE_DIR/Primary_node -o $BUILD_DIR/PrimaryNode \
+	$CODE_DIR/Primary_node/PrimaryNodeHost.c $CODE_DIR/Primary_node/EcanSensors.c $HOST \
+	$LIBS/CanDispatch.c $LIBS/Nmea2000Encode.c $LIBS/Rudder.c $LIBS/Acs300.c $LIBS/Tokimec.c $LDFLAGS
+gcc $CFLAGS -I$CODE_DIR/Rudder_node/clib -o $BUILD_DIR/RudderNode \
+	$CODE_DIR/Rudder_node/clib/RudderNodeHost.c $CODE_DIR/Rudder_node/clib/RudderNode.c $HOST \
+	$LIBS/MessageScheduler.c $LIBS/Nmea2000Encode.c $LDFLAGS
+gcc $CFLAGS -I$CODE_DIR/Power_node -o $BUILD_DIR/PowerNode \
+	$CODE_DIR/Power_node/PowerNodeHost.c $CODE_DIR/Power_node/PowerNode.c $HOST \
+	$LIBS/MessageScheduler.c $LIBS/Nmea2000Encode.c $LDFLAGS
+gcc $CFLAGS -I$CODE_DIR/RC_node/clib -o $BUILD_DIR/RcNode \
+	$CODE_DIR/RC_node/clib/RcNodeHost.c $CODE_DIR/RC_node/clib/RcNode.c $HOST $LDFLAGS
+set +e
+
+# Start from an empty bus, so it's set up by these options rather than a previous run's.
+rm -f /dev/shm/autoboat
+
+trap 'kill $(jobs -p) 2>/dev/null' EXIT
+for node in PrimaryNode RudderNode PowerNode RcNode; do
+	$BUILD_DIR/$node "$@" &
+done
+wait
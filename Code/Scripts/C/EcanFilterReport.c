@@ -0,0 +1,158 @@
+/**
+ * @file   EcanFilterReport.c
+ * @brief  Reports how well the nodes' ECAN acceptance filters do on recorded bus traffic.
+ *
+ * The acceptance filters of the primary, rudder, RC, and HIL nodes are planned from their lists of
+ * received messages just like the nodes do at startup (see Libs/C/EcanFilterPlanner.h), and printed
+ * as the register values they load. Every frame of the given traces is then run through them, and
+ * for every node it reports how many frames it handles, how many the filters let through, and how
+ * many of those it then throws away: the false accepts. Without filters, every frame is one.
+ *
+ * A frame the node handles but the filters rejected would be a bug in the planner, and is reported
+ * as missed.
+ *
+ * The traces are SocketCAN log files, as recorded with `candump -l`, where every line is a frame:
+ *   (1436509052.249713) can0 09F10D23#FF7F0000FF7FFFFF
+ * IDs of 3 hex digits are standard frames, and of 8 extended ones.
+ *
+ * Build and run on the host with:
+ * `gcc EcanFilterReport.c ../../Libs/C/EcanFilterPlanner.c -I../../Libs/C -I../../Primary_node -I../../Rudder_node/clib -I../../RC_node/clib -I../../HIL_node -O2 -Wall -o EcanFilterReport`
+ * `./EcanFilterReport run1.log run2.log`
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "EcanFilterPlanner.h"
+#include "PrimaryCanFilters.h"
+#include "RudderCanFilters.h"
+#include "RcCanFilters.h"
+#include "HilCanFilters.h"
+
+// A node's filters and how they fared.
+typedef struct {
+	const char *name;
+	const EcanFilterTarget *targets;
+	uint8_t count;
+	EcanFilterRegisters regs;
+	uint32_t falseAcceptIds; // As counted by EcanFilterPlan().
+	uint32_t wanted;         // Frames the node handles.
+	uint32_t accepted;       // Frames let through.
+	uint32_t missed;         // Frames the node handles that weren't let through.
+} Node;
+
+static Node nodes[] = {
+	{"Primary", primaryCanFilterTargets, PRIMARY_CAN_FILTER_TARGET_COUNT},
+	{"Rudder", rudderCanFilterTargets, RUDDER_CAN_FILTER_TARGET_COUNT},
+	{"RC", rcCanFilterTargets, RC_CAN_FILTER_TARGET_COUNT},
+	{"HIL", hilCanFilterTargets, HIL_CAN_FILTER_TARGET_COUNT}
+};
+#define NUM_NODES (sizeof(nodes) / sizeof(nodes[0]))
+
+/**
+ * Prints the register values of a node's filters, in the order Ecan1InitFiltered() loads them.
+ */
+static void PrintRegisters(const Node *n)
+{
+	uint8_t i;
+	printf("%s node: %u messages, %u unwanted IDs let through.\n", n->name, n->count, n->falseAcceptIds);
+	for (i = 0; i < ECAN_FILTER_MASK_COUNT; ++i) {
+		printf("  C1RXM%uSID = 0x%04X  C1RXM%uEID = 0x%04X\n", i, n->regs.MaskSid[i], i, n->regs.MaskEid[i]);
+	}
+	for (i = 0; i < ECAN_FILTER_COUNT; ++i) {
+		if (n->regs.Enable & (1 << i)) {
+			printf("  C1RXF%uSID = 0x%04X  C1RXF%uEID = 0x%04X\n", i, n->regs.FilterSid[i], i, n->regs.FilterEid[i]);
+		}
+	}
+	printf("  C1FMSKSEL1 = 0x%04X  C1FMSKSEL2 = 0x%04X  C1FEN1 = 0x%04X\n\n", n->regs.MaskSelect[0],
+	       n->regs.MaskSelect[1], n->regs.Enable);
+}
+
+/**
+ * Runs every frame of a trace through the nodes' filters.
+ * @param frames Incremented by the number of frames.
+ * @return False if the file couldn't be read.
+ */
+static bool ProcessFile(const char *path, uint32_t *frames)
+{
+	char line[256];
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		return false;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		// The ID is the last field before the '#'.
+		char *hash = strchr(line, '#');
+		char *start, *end;
+		uint32_t id;
+		bool extended;
+		uint8_t i;
+		if (!hash) {
+			continue;
+		}
+		for (start = hash; start > line && start[-1] != ' '; --start);
+		id = strtoul(start, &end, 16);
+		if (end != hash || (hash - start != 3 && hash - start != 8)) {
+			continue;
+		}
+		extended = (hash - start == 8);
+
+		++*frames;
+		for (i = 0; i < NUM_NODES; ++i) {
+			Node *const n = &nodes[i];
+			const bool wanted = EcanFilterWanted(n->targets, n->count, id, extended);
+			const bool accepted = EcanFilterAccepts(&n->regs, id, extended);
+			n->wanted += wanted;
+			n->accepted += accepted;
+			n->missed += wanted && !accepted;
+		}
+	}
+	fclose(f);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t frames = 0;
+	uint8_t i;
+	int arg;
+
+	if (argc < 2) {
+		printf("Usage: %s TRACE...\n", argv[0]);
+		return 1;
+	}
+
+	for (i = 0; i < NUM_NODES; ++i) {
+		if (!EcanFilterPlan(nodes[i].targets, nodes[i].count, &nodes[i].regs, &nodes[i].falseAcceptIds)) {
+			printf("The %s node's messages can't be filtered.\n", nodes[i].name);
+			return 1;
+		}
+		PrintRegisters(&nodes[i]);
+	}
+
+	for (arg = 1; arg < argc; ++arg) {
+		if (!ProcessFile(argv[arg], &frames)) {
+			printf("Failed to read '%s'.\n", argv[arg]);
+			return 1;
+		}
+	}
+	if (!frames) {
+		printf("No frames found.\n");
+		return 1;
+	}
+
+	printf("%u frames.\n\n", frames);
+	printf("%-8s %10s %10s %10s %12s %12s %8s\n", "node", "handled", "accepted", "false acc.", "rate", "unfiltered", "missed");
+	for (i = 0; i < NUM_NODES; ++i) {
+		const Node *n = &nodes[i];
+		const uint32_t falseAccepts = n->accepted - (n->wanted - n->missed);
+		printf("%-8s %10u %10u %10u %11.1f%% %11.1f%% %8u\n", n->name, n->wanted, n->accepted, falseAccepts,
+		       100.0 * falseAccepts / frames, 100.0 * (frames - n->wanted) / frames, n->missed);
+	}
+	printf("\nThe rate is the share of all frames that are accepted but not handled, unfiltered what it'd be\n"
+	       "without filters.\n");
+	return 0;
+}
@@ -0,0 +1,254 @@
+/**
+ * @file   LogDecode.c
+ * @brief  Decodes the compact log stream in datalogger captures, and benchmarks it on MAVLink ones.
+ *
+ * Every log stream frame (see LogStream.h) in the given captures is decoded into the exact payload
+ * that was logged, and written as a row of `<MESSAGE_NAME>.csv` in the current directory, with a
+ * column per field. MAVLink frames and anything else between the log frames are skipped. Frames that
+ * can't be decoded because an earlier one was lost are counted and left out.
+ *
+ * With -b, the MAVLink frames in the captures are instead run through a log stream encoder per
+ * message type, the way the datalogger link would send them, and their size is compared to MAVLink 1
+ * framing alongside the time taken to encode them. This works on any raw UART capture or
+ * QGroundControl telemetry log.
+ *
+ * Build and run on the host with:
+ * `gcc LogDecode.c ../../Libs/C/LogStream.c ../../Libs/C/MavlinkReceiver.c ../../Libs/C/SpscBuffer.c ../../Libs/C/MavlinkHelpers.c -DMAVLINK_SEPARATE_HELPERS -I../../Libs/C -I../../Libs/MAVLink/seaslug -O2 -Wall -o LogDecode`
+ * `./LogDecode run1.bin run2.bin` or `./LogDecode -b run1.tlog`
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "LogStream.h"
+#include "MavlinkReceiver.h"
+#include "SpscBuffer.h"
+
+#define CHUNK_SIZE 4096
+#define KEYFRAME_INTERVAL 100
+
+// Everything needed per message type.
+typedef struct {
+	bool valid;
+	LogSchema schema;
+	LogDecoder decoder;
+	LogEncoder encoder;
+	FILE *csv;
+	const char *names[LOG_STREAM_MAX_FIELDS];
+	uint8_t types[LOG_STREAM_MAX_FIELDS];
+	uint8_t indices[LOG_STREAM_MAX_FIELDS]; // The array index of every field, or 0xFF.
+	uint32_t count;
+	uint32_t mavlinkBytes;
+	uint32_t logBytes;
+	double encodeSeconds;
+} Stream;
+
+static Stream streams[256];
+static const mavlink_message_info_t messageInfo[256] = MAVLINK_MESSAGE_INFO;
+
+/**
+ * Sets up the stream for a message the first time it's seen.
+ * @return NULL if the message can't be logged.
+ */
+static Stream *GetStream(uint8_t msgid)
+{
+	Stream *s = &streams[msgid];
+	if (!s->valid) {
+		const mavlink_message_info_t *info = &messageInfo[msgid];
+		uint8_t n = 0;
+		unsigned offset = 0;
+		if (!info->name || !LogSchemaInit(&s->schema, msgid, info)) {
+			return NULL;
+		}
+
+		// Name every field in wire order, the same way LogSchemaInit() orders them.
+		while (n < s->schema.Count) {
+			unsigned i, j;
+			for (i = 0; info->fields[i].wire_offset != offset; ++i);
+			const unsigned elements = info->fields[i].array_length ? info->fields[i].array_length : 1;
+			for (j = 0; j < elements; ++j, ++n) {
+				s->names[n] = info->fields[i].name;
+				s->types[n] = info->fields[i].type;
+				s->indices[n] = info->fields[i].array_length ? j : 0xFF;
+				offset += s->schema.Widths[n];
+			}
+		}
+
+		LogDecoderInit(&s->decoder, &s->schema);
+		LogEncoderInit(&s->encoder, &s->schema, KEYFRAME_INTERVAL);
+		s->valid = true;
+	}
+	return s;
+}
+
+static void WriteRow(Stream *s, const uint8_t *payload)
+{
+	uint8_t i;
+
+	if (!s->csv) {
+		char path[64];
+		snprintf(path, sizeof(path), "%s.csv", messageInfo[s->schema.MsgId].name);
+		s->csv = fopen(path, "w");
+		if (!s->csv) {
+			printf("Failed to create '%s'.\n", path);
+			exit(1);
+		}
+		for (i = 0; i < s->schema.Count; ++i) {
+			if (s->indices[i] == 0xFF) {
+				fprintf(s->csv, i ? ",%s" : "%s", s->names[i]);
+			} else {
+				fprintf(s->csv, i ? ",%s_%u" : "%s_%u", s->names[i], s->indices[i]);
+			}
+		}
+		fprintf(s->csv, "\n");
+	}
+
+	for (i = 0; i < s->schema.Count; ++i) {
+		if (i) {
+			fputc(',', s->csv);
+		}
+		switch (s->types[i]) {
+		case MAVLINK_TYPE_CHAR:    fprintf(s->csv, "%d", *(const char *)payload); break;
+		case MAVLINK_TYPE_UINT8_T: fprintf(s->csv, "%u", *payload); break;
+		case MAVLINK_TYPE_INT8_T:  fprintf(s->csv, "%d", *(const int8_t *)payload); break;
+		case MAVLINK_TYPE_UINT16_T: { uint16_t v; memcpy(&v, payload, 2); fprintf(s->csv, "%u", v); } break;
+		case MAVLINK_TYPE_INT16_T:  { int16_t v;  memcpy(&v, payload, 2); fprintf(s->csv, "%d", v); } break;
+		case MAVLINK_TYPE_UINT32_T: { uint32_t v; memcpy(&v, payload, 4); fprintf(s->csv, "%u", v); } break;
+		case MAVLINK_TYPE_INT32_T:  { int32_t v;  memcpy(&v, payload, 4); fprintf(s->csv, "%d", v); } break;
+		case MAVLINK_TYPE_FLOAT:    { float v;    memcpy(&v, payload, 4); fprintf(s->csv, "%.9g", v); } break;
+		}
+		payload += s->schema.Widths[i];
+	}
+	fputc('\n', s->csv);
+	++s->count;
+}
+
+/**
+ * Decodes every log stream frame in a capture.
+ * @return False if the file couldn't be read.
+ */
+static bool DecodeFile(const char *path)
+{
+	static uint8_t data[CHUNK_SIZE];
+	uint8_t payload[LOG_STREAM_MAX_PAYLOAD_LEN];
+	uint16_t length = 0;
+	size_t n;
+
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return false;
+	}
+	while ((n = fread(&data[length], 1, sizeof(data) - length, f)) > 0) {
+		uint16_t offset = 0, frameLength;
+		length += n;
+		while ((frameLength = LogStreamNextFrame(data, length, &offset))) {
+			Stream *s = GetStream(data[offset + 2]);
+			if (s && LogDecode(&s->decoder, &data[offset], payload)) {
+				WriteRow(s, payload);
+			}
+			offset += frameLength;
+		}
+		// Keep what may still start a frame.
+		length -= offset;
+		memmove(data, &data[offset], length);
+	}
+	fclose(f);
+	return true;
+}
+
+/**
+ * Encodes every MAVLink frame in a capture as the log stream would.
+ * @return False if the file couldn't be read.
+ */
+static bool BenchmarkFile(const char *path)
+{
+	static uint8_t ringData[CHUNK_SIZE * 2];
+	SpscBuffer ring;
+	MavlinkReceiver r;
+	mavlink_message_t msg;
+	uint8_t chunk[CHUNK_SIZE];
+	uint8_t frame[LOG_STREAM_MAX_FRAME_LEN];
+	size_t n;
+
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return false;
+	}
+	SPSC_Init(&ring, ringData, sizeof(ringData));
+	MavlinkReceiverInit(&r);
+	while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+		SpscBufferSpans spans;
+		uint16_t length, offset = 0;
+		SPSC_WriteMany(&ring, chunk, (uint16_t)n, true);
+		length = SPSC_GetReadSpans(&ring, &spans);
+		while (MavlinkReceiverNext(&r, &spans, length, &offset, &msg)) {
+			Stream *s = GetStream(msg.msgid);
+			if (!s || msg.len > s->schema.Length) {
+				continue;
+			}
+			struct timespec start, end;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			s->logBytes += LogEncode(&s->encoder, _MAV_PAYLOAD(&msg), frame);
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			s->encodeSeconds += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+			s->mavlinkBytes += s->schema.Length + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+			++s->count;
+		}
+		SPSC_CommitRead(&ring, offset);
+	}
+	fclose(f);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	bool benchmark = false;
+	uint16_t i;
+	int arg = 1;
+
+	if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+		benchmark = true;
+		++arg;
+	}
+	if (arg == argc) {
+		printf("Usage: %s [-b] CAPTURE...\n", argv[0]);
+		return 1;
+	}
+	for (; arg < argc; ++arg) {
+		if (!(benchmark ? BenchmarkFile(argv[arg]) : DecodeFile(argv[arg]))) {
+			printf("Failed to read '%s'.\n", argv[arg]);
+			return 1;
+		}
+	}
+
+	if (benchmark) {
+		uint32_t totalMavlink = 0, totalLog = 0;
+		printf("%-24s %8s %10s %10s %6s %8s\n", "Message", "Count", "MAVLink B", "Log B", "Ratio", "ns/frame");
+		for (i = 0; i < 256; ++i) {
+			const Stream *s = &streams[i];
+			if (s->count) {
+				printf("%-24s %8u %10u %10u %6.2f %8.0f\n", messageInfo[i].name, s->count, s->mavlinkBytes,
+				       s->logBytes, (double)s->mavlinkBytes / s->logBytes, s->encodeSeconds * 1e9 / s->count);
+				totalMavlink += s->mavlinkBytes;
+				totalLog += s->logBytes;
+			}
+		}
+		if (totalLog) {
+			printf("%-24s %8s %10u %10u %6.2f\n", "Total", "", totalMavlink, totalLog, (double)totalMavlink / totalLog);
+		}
+	} else {
+		printf("%-24s %8s %10s %8s\n", "Message", "Rows", "Keyframes", "Skipped");
+		for (i = 0; i < 256; ++i) {
+			const Stream *s = &streams[i];
+			if (s->csv) {
+				printf("%-24s %8u %10u %8u\n", messageInfo[i].name, s->count, s->decoder.Keyframes, s->decoder.Skipped);
+				fclose(s->csv);
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,153 @@
+/**
+ * @file   Mavlink2Savings.c
+ * @brief  Measures how many bytes MAVLink 2 framing saves on recorded MAVLink streams.
+ *
+ * Every valid frame in the given files is run through the same receiver the boat uses, and for every
+ * message type it tallies what the frames cost as MAVLink 1, as MAVLink 2 with their trailing zeros
+ * trimmed, and with the per-frame choice between the two that a channel set to MAVLink 2 makes (see
+ * _mav_use_mavlink2()). Frames that were recorded as MAVLink 2 are counted the same way, as their
+ * zeros are filled back in on reception.
+ *
+ * The files can be raw captures of either UART or QGroundControl telemetry logs, whose timestamps
+ * are skipped like any other noise between frames.
+ *
+ * Build and run on the host with:
+ * `gcc Mavlink2Savings.c ../../Libs/C/MavlinkReceiver.c ../../Libs/C/SpscBuffer.c ../../Libs/C/MavlinkHelpers.c -DMAVLINK_SEPARATE_HELPERS -I../../Libs/C -I../../Libs/MAVLink/seaslug -O2 -Wall -o Mavlink2Savings`
+ * `./Mavlink2Savings run1.tlog run2.tlog`
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "MavlinkReceiver.h"
+#include "SpscBuffer.h"
+
+#define RING_SIZE 4096
+
+// What a single message type costs in each framing.
+typedef struct {
+	uint32_t count;
+	uint32_t v1Bytes;       // Every frame as MAVLink 1.
+	uint32_t v2Bytes;       // Every frame as MAVLink 2 with its payload trimmed.
+	uint32_t shortestBytes; // Every frame in the shorter of the two.
+	uint32_t v2Frames;      // Frames for which MAVLink 2 is the shorter one.
+} MessageTally;
+
+static MessageTally tallies[256];
+static const uint8_t messageLengths[256] = MAVLINK_MESSAGE_LENGTHS;
+static const mavlink_message_info_t messageInfo[256] = MAVLINK_MESSAGE_INFO;
+
+static void Tally(const mavlink_message_t *msg)
+{
+	MessageTally *t = &tallies[msg->msgid];
+	const uint8_t length = messageLengths[msg->msgid] ? messageLengths[msg->msgid] : msg->len;
+	const uint16_t v1 = length + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+	const uint16_t v2 = _mav_trim_payload(_MAV_PAYLOAD(msg), length) + MAVLINK2_NUM_NON_PAYLOAD_BYTES;
+	++t->count;
+	t->v1Bytes += v1;
+	t->v2Bytes += v2;
+	if (v2 < v1) {
+		t->shortestBytes += v2;
+		++t->v2Frames;
+	} else {
+		t->shortestBytes += v1;
+	}
+}
+
+/**
+ * Runs a file through the receiver, tallying every frame in it.
+ * @return False if the file couldn't be read.
+ */
+static bool ProcessFile(const char *path, MavlinkReceiverStats *stats)
+{
+	static uint8_t ringData[RING_SIZE];
+	SpscBuffer ring;
+	MavlinkReceiver r;
+	mavlink_message_t msg;
+	uint8_t chunk[RING_SIZE / 2];
+	size_t n;
+
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return false;
+	}
+	SPSC_Init(&ring, ringData, sizeof(ringData));
+	MavlinkReceiverInit(&r);
+	while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+		SpscBufferSpans spans;
+		uint16_t length, offset = 0;
+		SPSC_WriteMany(&ring, chunk, (uint16_t)n, true);
+		length = SPSC_GetReadSpans(&ring, &spans);
+		while (MavlinkReceiverNext(&r, &spans, length, &offset, &msg)) {
+			Tally(&msg);
+		}
+		SPSC_CommitRead(&ring, offset);
+	}
+	fclose(f);
+
+	stats->messages += r.stats.messages;
+	stats->badFrames += r.stats.badFrames;
+	stats->discardedBytes += r.stats.discardedBytes;
+	return true;
+}
+
+static int CompareSavings(const void *a, const void *b)
+{
+	const MessageTally *ta = &tallies[*(const uint8_t *)a], *tb = &tallies[*(const uint8_t *)b];
+	const uint32_t sa = ta->v1Bytes - ta->shortestBytes, sb = tb->v1Bytes - tb->shortestBytes;
+	return (sa < sb) - (sa > sb);
+}
+
+int main(int argc, char *argv[])
+{
+	MavlinkReceiverStats stats = {};
+	MessageTally total = {};
+	uint8_t ids[256];
+	uint16_t nIds = 0, i;
+	int arg;
+
+	if (argc < 2) {
+		printf("Usage: %s LOG...\n", argv[0]);
+		return 1;
+	}
+	for (arg = 1; arg < argc; ++arg) {
+		if (!ProcessFile(argv[arg], &stats)) {
+			printf("Failed to read '%s'.\n", argv[arg]);
+			return 1;
+		}
+	}
+
+	for (i = 0; i < 256; ++i) {
+		if (tallies[i].count) {
+			ids[nIds++] = (uint8_t)i;
+			total.count += tallies[i].count;
+			total.v1Bytes += tallies[i].v1Bytes;
+			total.v2Bytes += tallies[i].v2Bytes;
+			total.shortestBytes += tallies[i].shortestBytes;
+			total.v2Frames += tallies[i].v2Frames;
+		}
+	}
+	qsort(ids, nIds, 1, CompareSavings);
+
+	printf("%u frames found, %u bytes discarded between them.\n\n", stats.messages, stats.discardedBytes);
+	printf("%-28s %8s %9s %9s %10s %8s %9s %7s\n", "message", "count", "v1 B/msg", "v2 B/msg",
+	       "best B/msg", "v2 used", "saved B", "saved");
+	for (i = 0; i < nIds; ++i) {
+		const MessageTally *t = &tallies[ids[i]];
+		const char *name = messageLengths[ids[i]] ? messageInfo[ids[i]].name : "(unknown)";
+		printf("%-28s %8u %9.1f %9.1f %10.1f %7.0f%% %9u %6.1f%%\n", name, t->count,
+		       (double)t->v1Bytes / t->count, (double)t->v2Bytes / t->count,
+		       (double)t->shortestBytes / t->count, 100.0 * t->v2Frames / t->count,
+		       t->v1Bytes - t->shortestBytes, 100.0 * (t->v1Bytes - t->shortestBytes) / t->v1Bytes);
+	}
+	if (total.count) {
+		printf("%-28s %8u %9.1f %9.1f %10.1f %7.0f%% %9u %6.1f%%\n", "total", total.count,
+		       (double)total.v1Bytes / total.count, (double)total.v2Bytes / total.count,
+		       (double)total.shortestBytes / total.count, 100.0 * total.v2Frames / total.count,
+		       total.v1Bytes - total.shortestBytes, 100.0 * (total.v1Bytes - total.shortestBytes) / total.v1Bytes);
+	}
+	return 0;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file   MavlinkUnbatch.c
+ * @brief  Unpacks the batches of the groundstation link for QGroundControl.
+ *
+ * When the boat batches its groundstation telemetry (see GROUNDSTATION_BATCHING in
+ * Primary_node/MavlinkGlue.c and Libs/C/MavlinkBatch.h), this sits between the radio and
+ * QGroundControl. Every batch read from the radio is expanded back into MAVLink 1 frames with the
+ * sequence numbers, system and component IDs the messages were batched with, so the groundstation's
+ * loss statistics stay correct. Everything else, like the regular MAVLink frames the boat still sends
+ * outside of batches, is passed through untouched.
+ *
+ * The frames are sent as UDP datagrams to QGroundControl's default port on the local machine, or the
+ * given one, and whatever comes back from there is written to the radio as is.
+ *
+ * Bytes that may start a batch are held until the rest of it arrives or nothing has been read for
+ * HOLD_TIMEOUT ms, so frames right after a stray sync byte can be delayed by that much.
+ *
+ * The radio is expected to be a serial port at 115200 baud. Anything else, like a raw capture of the
+ * radio's output, is read through once and only unpacked.
+ *
+ * Build and run on the host with:
+ * `gcc MavlinkUnbatch.c ../../Libs/C/MavlinkBatch.c ../../Libs/C/MavlinkHelpers.c -DMAVLINK_SEPARATE_HELPERS -I../../Libs/C -I../../Libs/MAVLink/seaslug -O2 -Wall -o MavlinkUnbatch`
+ * `./MavlinkUnbatch /dev/ttyUSB0 [PORT]`
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "MavlinkBatch.h"
+
+#include <mavlink.h>
+
+#define DEFAULT_PORT 14550
+#define HOLD_TIMEOUT 100
+
+// Unpacked frames are finalized on this channel, as it's never used for anything else here.
+#define UNBATCH_CHAN MAVLINK_COMM_1
+
+static const uint8_t messageLengths[256] = MAVLINK_MESSAGE_LENGTHS;
+static const uint8_t messageCrcs[256] = MAVLINK_MESSAGE_CRCS;
+
+static int groundstation;
+static struct sockaddr_in groundstationAddress;
+
+static void SendToGroundstation(const uint8_t *data, uint16_t length)
+{
+	if (length) {
+		sendto(groundstation, data, length, 0, (const struct sockaddr *)&groundstationAddress,
+		       sizeof(groundstationAddress));
+	}
+}
+
+/**
+ * Sends every message of a batch to the groundstation as a regular MAVLink frame.
+ * @return The number of messages sent.
+ */
+static uint8_t SendBatch(const uint8_t *frame)
+{
+	MavlinkBatchEntry entry;
+	mavlink_message_t msg;
+	uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+	uint16_t position = 0;
+	uint8_t count = 0;
+
+	while (MavlinkBatchNextEntry(frame, &position, &entry)) {
+		// Unknown messages can't be padded back out or checksummed.
+		if (!messageLengths[entry.MsgId] || entry.Length > messageLengths[entry.MsgId]) {
+			continue;
+		}
+		memset(_MAV_PAYLOAD_NON_CONST(&msg), 0, messageLengths[entry.MsgId]);
+		memcpy(_MAV_PAYLOAD_NON_CONST(&msg), entry.Payload, entry.Length);
+		msg.msgid = entry.MsgId;
+		mavlink_get_channel_status(UNBATCH_CHAN)->current_tx_seq = entry.Seq;
+		mavlink_finalize_message_chan(&msg, entry.SysId, entry.CompId, UNBATCH_CHAN, messageLengths[entry.MsgId],
+		                              messageCrcs[entry.MsgId]);
+		SendToGroundstation(buffer, mavlink_msg_to_send_buffer(buffer, &msg));
+		++count;
+	}
+	return count;
+}
+
+/**
+ * Sends everything complete in the buffer on to the groundstation, unpacking any batches.
+ * @param flush Whether bytes that may still start a batch are sent as they are.
+ * @return The number of bytes consumed from the start of the buffer.
+ */
+static uint16_t Process(const uint8_t *data, uint16_t length, bool flush, uint32_t *batches, uint32_t *messages)
+{
+	uint16_t start = 0, offset = 0, frameLength;
+
+	while ((frameLength = MavlinkBatchNextFrame(data, length, &offset))) {
+		SendToGroundstation(&data[start], offset - start);
+		*messages += SendBatch(&data[offset]);
+		++*batches;
+		offset += frameLength;
+		start = offset;
+	}
+	if (flush) {
+		offset = length;
+	}
+	SendToGroundstation(&data[start], offset - start);
+	return offset;
+}
+
+/**
+ * Sets a serial port up for raw 8N1 at 115200 baud.
+ * @return False if it isn't a serial port.
+ */
+static bool SetUpSerial(int fd)
+{
+	struct termios t;
+	if (tcgetattr(fd, &t)) {
+		return false;
+	}
+	cfmakeraw(&t);
+	cfsetispeed(&t, B115200);
+	cfsetospeed(&t, B115200);
+	t.c_cflag |= CLOCAL | CREAD;
+	t.c_cflag &= ~CRTSCTS;
+	return tcsetattr(fd, TCSANOW, &t) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static uint8_t data[4 * MAVLINK_BATCH_MAX_FRAME_LEN];
+	uint8_t reply[MAVLINK_MAX_PACKET_LEN * 4];
+	uint16_t length = 0;
+	uint32_t batches = 0, messages = 0;
+	struct pollfd fds[2];
+	bool serial;
+
+	if (argc < 2 || argc > 3) {
+		printf("Usage: %s DEVICE [PORT]\n", argv[0]);
+		return 1;
+	}
+
+	const int radio = open(argv[1], O_RDWR | O_NOCTTY);
+	if (radio < 0) {
+		printf("Failed to open '%s'.\n", argv[1]);
+		return 1;
+	}
+	serial = SetUpSerial(radio);
+
+	groundstation = socket(AF_INET, SOCK_DGRAM, 0);
+	if (groundstation < 0) {
+		printf("Failed to create a UDP socket.\n");
+		return 1;
+	}
+	memset(&groundstationAddress, 0, sizeof(groundstationAddress));
+	groundstationAddress.sin_family = AF_INET;
+	groundstationAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	groundstationAddress.sin_port = htons(argc == 3 ? atoi(argv[2]) : DEFAULT_PORT);
+
+	printf("Unpacking batches from '%s' to 127.0.0.1:%u.\n", argv[1], ntohs(groundstationAddress.sin_port));
+
+	fds[0].fd = radio;
+	fds[0].events = POLLIN;
+	fds[1].fd = groundstation;
+	fds[1].events = POLLIN;
+	while (true) {
+		const int ready = poll(fds, serial ? 2 : 1, HOLD_TIMEOUT);
+		if (ready < 0) {
+			break;
+		}
+
+		// Nothing's coming to complete a batch, so what's held is sent as it is.
+		if (ready == 0) {
+			Process(data, length, true, &batches, &messages);
+			length = 0;
+			continue;
+		}
+
+		if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+			const ssize_t n = read(radio, &data[length], sizeof(data) - length);
+			if (n <= 0) {
+				Process(data, length, true, &batches, &messages);
+				break;
+			}
+			length += n;
+
+			// What's held is always shorter than a batch, so there's room for the rest of it.
+			const uint16_t consumed = Process(data, length, false, &batches, &messages);
+			memmove(data, &data[consumed], length - consumed);
+			length -= consumed;
+		}
+
+		if (serial && (fds[1].revents & POLLIN)) {
+			const ssize_t n = recv(groundstation, reply, sizeof(reply), 0);
+			if (n > 0 && write(radio, reply, n) != n) {
+				printf("Failed to write to '%s'.\n", argv[1]);
+			}
+		}
+	}
+
+	printf("Unpacked %u messages from %u batches.\n", messages, batches);
+	close(groundstation);
+	close(radio);
+	return 0;
+}
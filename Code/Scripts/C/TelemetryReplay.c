@@ -0,0 +1,158 @@
+/**
+ * @file   TelemetryReplay.c
+ * @brief  Measures the bandwidth the groundstation's change filters save on recorded MAVLink streams.
+ *
+ * Every valid frame in the given files is run through the same receiver the boat uses, and the
+ * messages the groundstation link filters (see Primary_node/TelemetryFilters.h) through the same
+ * change filters, with the same deadbands and keep-alive interval. Time is taken from the boat's own
+ * clock in SYSTEM_TIME messages, so messages before the first one are all counted as sent. Every
+ * file starts the filters over, as every file is expected to be a separate run.
+ *
+ * For every filtered message type it reports how many frames were recorded, how many the filter
+ * would have let through, and the bytes that would have been freed, both in total and as a share of
+ * all recorded traffic. Frames are counted at the size they were recorded at.
+ *
+ * The files can be raw captures of either UART or QGroundControl telemetry logs, whose timestamps
+ * are skipped like any other noise between frames.
+ *
+ * Build and run on the host with:
+ * `gcc TelemetryReplay.c ../../Libs/C/ChangeFilter.c ../../Libs/C/MavlinkReceiver.c ../../Libs/C/SpscBuffer.c ../../Libs/C/MavlinkHelpers.c -DMAVLINK_SEPARATE_HELPERS -I../../Primary_node -I../../Libs/C -I../../Libs/MAVLink/seaslug -O2 -Wall -o TelemetryReplay`
+ * `./TelemetryReplay run1.tlog run2.tlog`
+ */
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ChangeFilter.h"
+#include "MavlinkReceiver.h"
+#include "SpscBuffer.h"
+#include "TelemetryFilters.h"
+
+#define RING_SIZE 4096
+
+// What a single filtered message type would have cost.
+typedef struct {
+	ChangeFilter filter;
+	uint32_t count;
+	uint32_t sent;
+	uint32_t bytes;     // Of every recorded frame.
+	uint32_t sentBytes; // Of the frames let through.
+} Replay;
+
+static Replay replays[TELEMETRY_FILTER_COUNT];
+
+/**
+ * Runs a file through the receiver and the filters.
+ * @param totalBytes Incremented by the size of every frame.
+ * @param seconds Incremented by the time covered by the SYSTEM_TIME messages.
+ * @return False if the file couldn't be read.
+ */
+static bool ProcessFile(const char *path, uint32_t *totalBytes, double *seconds)
+{
+	static uint8_t ringData[RING_SIZE];
+	SpscBuffer ring;
+	MavlinkReceiver r;
+	mavlink_message_t msg;
+	uint8_t chunk[RING_SIZE / 2];
+	uint32_t start = 0, now = 0;
+	bool clocked = false;
+	size_t n;
+	uint8_t i;
+
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		return false;
+	}
+	for (i = 0; i < TELEMETRY_FILTER_COUNT; ++i) {
+		if (!ChangeFilterInit(&replays[i].filter, telemetryFilterConfigs[i].Info, telemetryFilterConfigs[i].Deadbands,
+		                      TELEMETRY_FILTER_MAX_INTERVAL)) {
+			printf("The %s filter doesn't fit a ChangeFilter.\n", telemetryFilterConfigs[i].Info->name);
+			exit(1);
+		}
+	}
+
+	SPSC_Init(&ring, ringData, sizeof(ringData));
+	MavlinkReceiverInit(&r);
+	while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+		SpscBufferSpans spans;
+		uint16_t length, offset = 0;
+		SPSC_WriteMany(&ring, chunk, (uint16_t)n, true);
+		length = SPSC_GetReadSpans(&ring, &spans);
+		while (MavlinkReceiverNext(&r, &spans, length, &offset, &msg)) {
+			const uint16_t size = mavlink_msg_get_send_buffer_length(&msg);
+			*totalBytes += size;
+
+			// nodeSystemTime counts 10ms ticks.
+			if (msg.msgid == MAVLINK_MSG_ID_SYSTEM_TIME) {
+				now = mavlink_msg_system_time_get_time_boot_ms(&msg) / 10;
+				if (!clocked) {
+					start = now;
+					clocked = true;
+				}
+			}
+
+			for (i = 0; i < TELEMETRY_FILTER_COUNT; ++i) {
+				if (telemetryFilterConfigs[i].MsgId == msg.msgid) {
+					Replay *const p = &replays[i];
+					++p->count;
+					p->bytes += size;
+					if (!clocked || ChangeFilterCheck(&p->filter, _MAV_PAYLOAD(&msg), now)) {
+						ChangeFilterSent(&p->filter, _MAV_PAYLOAD(&msg), now);
+						++p->sent;
+						p->sentBytes += size;
+					}
+					break;
+				}
+			}
+		}
+		SPSC_CommitRead(&ring, offset);
+	}
+	fclose(f);
+
+	*seconds += (now - start) / 100.0;
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t totalBytes = 0, bytes = 0, sentBytes = 0;
+	double seconds = 0;
+	uint8_t i;
+	int arg;
+
+	if (argc < 2) {
+		printf("Usage: %s LOG...\n", argv[0]);
+		return 1;
+	}
+	for (arg = 1; arg < argc; ++arg) {
+		if (!ProcessFile(argv[arg], &totalBytes, &seconds)) {
+			printf("Failed to read '%s'.\n", argv[arg]);
+			return 1;
+		}
+	}
+
+	printf("%u bytes of frames over %.0f s, filtered with a %.1f s keep-alive.\n\n", totalBytes, seconds,
+	       TELEMETRY_FILTER_MAX_INTERVAL / 100.0);
+	printf("%-16s %8s %8s %10s %10s %7s\n", "message", "count", "sent", "bytes", "sent B", "saved");
+	for (i = 0; i < TELEMETRY_FILTER_COUNT; ++i) {
+		const Replay *p = &replays[i];
+		if (p->count) {
+			printf("%-16s %8u %8u %10u %10u %6.1f%%\n", telemetryFilterConfigs[i].Info->name, p->count, p->sent,
+			       p->bytes, p->sentBytes, 100.0 * (p->bytes - p->sentBytes) / p->bytes);
+			bytes += p->bytes;
+			sentBytes += p->sentBytes;
+		}
+	}
+	if (bytes) {
+		printf("%-16s %8s %8s %10u %10u %6.1f%%\n", "total", "", "", bytes, sentBytes, 100.0 * (bytes - sentBytes) / bytes);
+		printf("\n%u bytes freed, %.1f%% of all traffic", bytes - sentBytes, 100.0 * (bytes - sentBytes) / totalBytes);
+		if (seconds > 0) {
+			printf(", %.1f B/s", (bytes - sentBytes) / seconds);
+		}
+		printf(".\n");
+	}
+	return 0;
+}
@@ -136,14 +136,20 @@ uint8_t ids[MAVLINK_MSGS_SIZE] = {
 	MAVLINK_MSG_ID_DSP3000,
 	MAVLINK_MSG_ID_TOKIMEC
 };
-uint16_t tsteps[MAVLINK_MSGS_SIZE][2][8] = {};
+uint8_t  tstepLists[MSCHED_DEFAULT_TIMESTEPS] = {};
+uint16_t tstepBytes[MSCHED_DEFAULT_TIMESTEPS] = {};
+MessageScheduleSlot slots[MAVLINK_MSGS_SIZE] = {};
 uint8_t  mSizes[MAVLINK_MSGS_SIZE];
 MessageSchedule mavlinkSchedule = {
 	MAVLINK_MSGS_SIZE,
 	ids,
 	mSizes,
 	0,
-	tsteps
+	MSCHED_DEFAULT_TIMESTEPS,
+	MSCHED_DEFAULT_TIMESTEP_RATE,
+	tstepLists,
+	tstepBytes,
+	slots
 };
 
 /**